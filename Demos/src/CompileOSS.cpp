@@ -0,0 +1,135 @@
+/*
+  CompileOSS - a demo program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cstdlib>
+#include <iostream>
+
+#include <osmscout/TypeConfig.h>
+#include <osmscout/StyleConfig.h>
+
+#include <osmscout/util/CmdLineParsing.h>
+#include <osmscout/util/StopClock.h>
+
+/*
+ * Example:
+ *   src/CompileOSS ../maps/nordrhein-westfalen ../stylesheets/standard.oss standard.ossc
+ *
+ * The compiled style sheet can be passed to StyleConfig::Load() instead of the original style sheet.
+ */
+
+struct Arguments
+{
+  bool        help;
+  std::string databaseDirectory;
+  std::string ossFile;
+  std::string outputFile;
+
+  Arguments()
+    : help(false)
+  {
+    // no code
+  }
+};
+
+int main(int argc, char* argv[])
+{
+  osmscout::CmdLineParser   argParser("CompileOSS",
+                                      argc,argv);
+  std::vector<std::string>  helpArgs{"h","help"};
+  Arguments                 args;
+
+  argParser.AddOption(osmscout::CmdLineFlag([&args](const bool& value) {
+                        args.help=value;
+                      }),
+                      helpArgs,
+                      "Return argument help",
+                      true);
+
+  argParser.AddPositional(osmscout::CmdLineStringOption([&args](const std::string& value) {
+                            args.databaseDirectory=value;
+                          }),
+                          "DATABASE",
+                          "Directory of the database the style sheet is compiled for");
+
+  argParser.AddPositional(osmscout::CmdLineStringOption([&args](const std::string& value) {
+                            args.ossFile=value;
+                          }),
+                          "OSS",
+                          "Path to the OSS file");
+
+  argParser.AddPositional(osmscout::CmdLineStringOption([&args](const std::string& value) {
+                            args.outputFile=value;
+                          }),
+                          "OUTPUT",
+                          "Path to the compiled style sheet");
+
+  osmscout::CmdLineParseResult result=argParser.Parse();
+
+  if (result.HasError()) {
+    std::cerr << "ERROR: " << result.GetErrorDescription() << std::endl;
+    std::cout << argParser.GetHelp() << std::endl;
+    return 1;
+  }
+  else if (args.help) {
+    std::cout << argParser.GetHelp() << std::endl;
+    return 0;
+  }
+
+  osmscout::TypeConfigRef typeConfig=std::make_shared<osmscout::TypeConfig>();
+
+  if (!typeConfig->LoadFromDataFile(args.databaseDirectory)) {
+    std::cerr << "Cannot load type configuration of database '" << args.databaseDirectory << "'" << std::endl;
+    return 1;
+  }
+
+  osmscout::StyleConfig styleConfig(typeConfig);
+  osmscout::StopClock   parseTimer;
+
+  if (!styleConfig.Load(args.ossFile)) {
+    std::cerr << "Cannot load OSS file '" << args.ossFile << "'" << std::endl;
+
+    for (const auto& error : styleConfig.GetErrors()) {
+      std::cerr << error << std::endl;
+    }
+
+    return 1;
+  }
+
+  parseTimer.Stop();
+
+  if (!styleConfig.StoreCompiled(args.outputFile)) {
+    std::cerr << "Cannot store compiled style sheet '" << args.outputFile << "'" << std::endl;
+    return 1;
+  }
+
+  osmscout::StyleConfig compiledStyleConfig(typeConfig);
+  osmscout::StopClock   loadTimer;
+
+  if (!compiledStyleConfig.LoadCompiled(args.outputFile)) {
+    std::cerr << "Cannot load compiled style sheet '" << args.outputFile << "'" << std::endl;
+    return 1;
+  }
+
+  loadTimer.Stop();
+
+  std::cout << "Parsing OSS file: " << parseTimer.ResultString() << std::endl;
+  std::cout << "Loading compiled style sheet: " << loadTimer.ResultString() << std::endl;
+
+  return 0;
+}
@@ -816,6 +816,10 @@ int main(int argc, char* argv[])
 
   std::cout << "Postprocessing time: " << postprocessTimer.ResultString() << std::endl;
 
+  for (size_t i=0; i<postprocessor.GetTimings().size(); i++) {
+    std::cout << "  Postprocessor " << i+1 << ": " << postprocessor.GetTimings()[i] << " ms" << std::endl;
+  }
+
   osmscout::StopClock                 generateTimer;
   osmscout::RouteDescriptionGenerator generator;
   RouteDescriptionGeneratorCallback   generatorCallback;
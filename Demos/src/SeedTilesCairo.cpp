@@ -0,0 +1,289 @@
+/*
+  SeedTilesCairo - a demo program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include <osmscout/Database.h>
+#include <osmscout/MapService.h>
+#include <osmscout/TileSeeder.h>
+#include <osmscout/TileStorage.h>
+
+#include <osmscout/MapPainterCairo.h>
+
+#include <osmscout/util/File.h>
+
+/*
+  Example for the nordrhein-westfalen.osm (to be executed in the Demos top
+  level directory), seeding the "Ruhrgebiet" into a single tile pack file using
+  four threads and metatiles of 8x8 tiles:
+
+  src/SeedTilesCairo ../maps/nordrhein-westfalen ../stylesheets/standard.oss 51.7 6.5 51.2 8 10 15 ruhrgebiet.pack 4 8
+
+  If the output is an existing directory, tiles are stored as <output>/<level>/<x>/<y>.png
+  instead. Running the same command again after an interruption (Ctrl-C) continues
+  where the last run stopped.
+*/
+
+static osmscout::BreakerRef breaker=std::make_shared<osmscout::ThreadedBreaker>();
+
+static void InterruptHandler(int /*signal*/)
+{
+  breaker->Break();
+}
+
+static cairo_status_t AppendToString(void* closure,
+                                     const unsigned char* data,
+                                     unsigned int length)
+{
+  static_cast<std::string*>(closure)->append((const char*)data,length);
+
+  return CAIRO_STATUS_SUCCESS;
+}
+
+/**
+ * Renders a metatile onto a cairo image surface and encodes the contained tiles as PNG
+ */
+class CairoMetatileRenderer : public osmscout::MetatileRenderer
+{
+private:
+  osmscout::MapPainterCairo painter;
+  osmscout::MapParameter    drawParameter;
+
+public:
+  CairoMetatileRenderer(const osmscout::StyleConfigRef& styleConfig,
+                        const osmscout::MapParameter& drawParameter)
+  : painter(styleConfig),
+    drawParameter(drawParameter)
+  {
+    // no code
+  }
+
+  bool RenderMetatile(const osmscout::Metatile& metatile,
+                      const osmscout::TileProjection& projection,
+                      const osmscout::MapData& data,
+                      std::vector<std::string>& tiles) override
+  {
+    cairo_surface_t *surface=cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+                                                        (int)metatile.GetCanvasWidth(),
+                                                        (int)metatile.GetCanvasHeight());
+
+    if (cairo_surface_status(surface)!=CAIRO_STATUS_SUCCESS) {
+      cairo_surface_destroy(surface);
+      return false;
+    }
+
+    cairo_t *cairo=cairo_create(surface);
+    bool    success=painter.DrawMap(projection,
+                                    drawParameter,
+                                    data,
+                                    cairo);
+
+    cairo_destroy(cairo);
+
+    cairo_surface_t *tileSurface=cairo_image_surface_create(CAIRO_FORMAT_RGB24,
+                                                            (int)metatile.GetTileWidth(),
+                                                            (int)metatile.GetTileHeight());
+
+    for (const auto& tile : metatile.GetTiles()) {
+      if (!success) {
+        break;
+      }
+
+      size_t      x;
+      size_t      y;
+      std::string content;
+
+      metatile.GetTileOffset(tile,x,y);
+
+      cairo_t *tileCairo=cairo_create(tileSurface);
+
+      cairo_set_source_surface(tileCairo,
+                               surface,
+                               -(double)x,
+                               -(double)y);
+      cairo_paint(tileCairo);
+      cairo_destroy(tileCairo);
+
+      success=cairo_surface_write_to_png_stream(tileSurface,
+                                                AppendToString,
+                                                &content)==CAIRO_STATUS_SUCCESS;
+
+      tiles.push_back(content);
+    }
+
+    cairo_surface_destroy(tileSurface);
+    cairo_surface_destroy(surface);
+
+    return success;
+  }
+};
+
+int main(int argc, char* argv[])
+{
+  std::string  map;
+  std::string  style;
+  std::string  output;
+  double       latTop,latBottom,lonLeft,lonRight;
+  unsigned int startLevel;
+  unsigned int endLevel;
+  unsigned int threadCount=std::max(1u,std::thread::hardware_concurrency());
+  unsigned int metatileSize=8;
+
+  if (argc<10 || argc>12) {
+    std::cerr << "SeedTilesCairo ";
+    std::cerr << "<map directory> <style-file> ";
+    std::cerr << "<lat_top> <lon_left> <lat_bottom> <lon_right> ";
+    std::cerr << "<start_zoom> <end_zoom> <output> [threads] [metatile_size]" << std::endl;
+    return 1;
+  }
+
+  map=argv[1];
+  style=argv[2];
+  output=argv[9];
+
+  if (sscanf(argv[3],"%lf",&latTop)!=1) {
+    std::cerr << "lat is not numeric!" << std::endl;
+    return 1;
+  }
+
+  if (sscanf(argv[4],"%lf",&lonLeft)!=1) {
+    std::cerr << "lon is not numeric!" << std::endl;
+    return 1;
+  }
+
+  if (sscanf(argv[5],"%lf",&latBottom)!=1) {
+    std::cerr << "lat is not numeric!" << std::endl;
+    return 1;
+  }
+
+  if (sscanf(argv[6],"%lf",&lonRight)!=1) {
+    std::cerr << "lon is not numeric!" << std::endl;
+    return 1;
+  }
+
+  if (sscanf(argv[7],"%u",&startLevel)!=1) {
+    std::cerr << "start zoom is not numeric!" << std::endl;
+    return 1;
+  }
+
+  if (sscanf(argv[8],"%u",&endLevel)!=1) {
+    std::cerr << "end zoom is not numeric!" << std::endl;
+    return 1;
+  }
+
+  if (argc>=11) {
+    if (sscanf(argv[10],"%u",&threadCount)!=1 ||
+        threadCount==0) {
+      std::cerr << "thread count is not a positive number!" << std::endl;
+      return 1;
+    }
+  }
+
+  if (argc>=12) {
+    if (sscanf(argv[11],"%u",&metatileSize)!=1 ||
+        metatileSize==0) {
+      std::cerr << "metatile size is not a positive number!" << std::endl;
+      return 1;
+    }
+  }
+
+  osmscout::DatabaseParameter databaseParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
+  osmscout::MapServiceRef     mapService=std::make_shared<osmscout::MapService>(database);
+
+  if (!database->Open(map)) {
+    std::cerr << "Cannot open database" << std::endl;
+    return 1;
+  }
+
+  osmscout::StyleConfigRef styleConfig=std::make_shared<osmscout::StyleConfig>(database->GetTypeConfig());
+
+  if (!styleConfig->Load(style)) {
+    std::cerr << "Cannot open style" << std::endl;
+    return 1;
+  }
+
+  osmscout::TileStorageRef     storage;
+  osmscout::TilePackStorageRef packStorage;
+
+  if (osmscout::ExistsInFilesystem(output) &&
+      osmscout::IsDirectory(output)) {
+    storage=std::make_shared<osmscout::DirectoryTileStorage>(output,"png");
+  }
+  else {
+    packStorage=std::make_shared<osmscout::TilePackStorage>();
+
+    if (!packStorage->Open(output)) {
+      std::cerr << "Cannot open tile pack '" << output << "'" << std::endl;
+      return 1;
+    }
+
+    std::cout << "Resuming with " << packStorage->GetTileCount() << " stored tiles" << std::endl;
+
+    storage=packStorage;
+  }
+
+  osmscout::MapParameter        drawParameter;
+  osmscout::TileSeederParameter seederParameter;
+
+  drawParameter.SetFontSize(3.0);
+  // Fadings make problems with tile approach, we disable it
+  drawParameter.SetDrawFadings(false);
+  // To get accurate label drawing at metatile borders, we take into account labels
+  // of other than the current metatile, too.
+  drawParameter.SetDropNotVisiblePointLabels(false);
+
+  seederParameter.SetMetatileSize(metatileSize);
+  seederParameter.SetBreaker(breaker);
+
+  std::vector<osmscout::MetatileRendererRef> renderers;
+
+  for (unsigned int i=0; i<threadCount; i++) {
+    renderers.push_back(std::make_shared<CairoMetatileRenderer>(styleConfig,
+                                                                drawParameter));
+  }
+
+  std::signal(SIGINT,InterruptHandler);
+
+  osmscout::ConsoleProgress progress;
+  osmscout::TileSeeder      seeder(mapService,
+                                   styleConfig,
+                                   storage,
+                                   seederParameter);
+
+  bool success=seeder.Seed(osmscout::GeoBox(osmscout::GeoCoord(latBottom,lonLeft),
+                                            osmscout::GeoCoord(latTop,lonRight)),
+                           osmscout::MagnificationLevel(startLevel),
+                           osmscout::MagnificationLevel(endLevel),
+                           renderers,
+                           progress);
+
+  if (packStorage &&
+      !packStorage->Close()) {
+    success=false;
+  }
+
+  database->Close();
+
+  return success ? 0 : 1;
+}
@@ -17,12 +17,15 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <vector>
 
 #include <osmscout/Database.h>
 #include <osmscout/MapService.h>
+#include <osmscout/Metatile.h>
 
 #include <osmscout/MapPainterAgg.h>
 
@@ -34,12 +37,17 @@
   level directory), drawing the "Ruhrgebiet":
 
   src/Tiler ../maps/nordrhein-westfalen ../stylesheets/standard.oss 51.2 6.5 51.7 8 10 13
+
+  An optional metatile size renders blocks of NxN tiles as one canvas, with one data load
+  and one label layout, and splits them into tiles afterwards:
+
+  src/Tiler ../maps/nordrhein-westfalen ../stylesheets/standard.oss 51.2 6.5 51.7 8 10 13 4
 */
 
 static const unsigned int tileWidth=256;
 static const unsigned int tileHeight=256;
 static const double       DPI=96.0;
-static const int          tileRingSize=1;
+static const uint32_t     tileRingSize=1;
 
 bool write_ppm(const agg::rendering_buffer& buffer,
                const char* file_name)
@@ -63,43 +71,30 @@ bool write_ppm(const agg::rendering_buffer& buffer,
   return false;
 }
 
-void MergeTilesToMapData(const std::list<osmscout::TileRef>& centerTiles,
-                         const osmscout::MapService::TypeDefinition& ringTypeDefinition,
-                         const std::list<osmscout::TileRef>& ringTiles,
-                         osmscout::MapData& data)
+/**
+  Add the objects of the ring tiles, that match the ring type definition, to the
+  given data of the metatile. Objects already contained in the data are not added again.
+*/
+void AddRingTilesToMapData(const osmscout::MapService::TypeDefinition& ringTypeDefinition,
+                           const std::list<osmscout::TileRef>& ringTiles,
+                           osmscout::MapData& data)
 {
   std::unordered_map<osmscout::FileOffset,osmscout::NodeRef> nodeMap(10000);
   std::unordered_map<osmscout::FileOffset,osmscout::WayRef>  wayMap(10000);
   std::unordered_map<osmscout::FileOffset,osmscout::AreaRef> areaMap(10000);
-  std::unordered_map<osmscout::FileOffset,osmscout::WayRef>  optimizedWayMap(10000);
-  std::unordered_map<osmscout::FileOffset,osmscout::AreaRef> optimizedAreaMap(10000);
 
   osmscout::StopClock uniqueTime;
 
-  for (const auto& tile : centerTiles) {
-    tile->GetNodeData().CopyData([&nodeMap](const osmscout::NodeRef& node) {
-      nodeMap[node->GetFileOffset()]=node;
-    });
-
-    //---
-
-    tile->GetOptimizedWayData().CopyData([&optimizedWayMap](const osmscout::WayRef& way) {
-      optimizedWayMap[way->GetFileOffset()]=way;
-    });
-
-    tile->GetWayData().CopyData([&wayMap](const osmscout::WayRef& way) {
-      wayMap[way->GetFileOffset()]=way;
-    });
-
-    //---
+  for (const auto& node : data.nodes) {
+    nodeMap[node->GetFileOffset()]=node;
+  }
 
-    tile->GetOptimizedAreaData().CopyData([&optimizedAreaMap](const osmscout::AreaRef& area) {
-      optimizedAreaMap[area->GetFileOffset()]=area;
-    });
+  for (const auto& way : data.ways) {
+    wayMap[way->GetFileOffset()]=way;
+  }
 
-    tile->GetAreaData().CopyData([&areaMap](const osmscout::AreaRef& area) {
-      areaMap[area->GetFileOffset()]=area;
-    });
+  for (const auto& area : data.areas) {
+    areaMap[area->GetFileOffset()]=area;
   }
 
   for (const auto& tile : ringTiles) {
@@ -111,9 +106,9 @@ void MergeTilesToMapData(const std::list<osmscout::TileRef>& centerTiles,
 
     //---
 
-    tile->GetOptimizedWayData().CopyData([&ringTypeDefinition,&optimizedWayMap](const osmscout::WayRef& way) {
+    tile->GetOptimizedWayData().CopyData([&ringTypeDefinition,&wayMap](const osmscout::WayRef& way) {
       if (ringTypeDefinition.optimizedWayTypes.IsSet(way->GetType())) {
-        optimizedWayMap[way->GetFileOffset()]=way;
+        wayMap[way->GetFileOffset()]=way;
       }
     });
 
@@ -125,9 +120,9 @@ void MergeTilesToMapData(const std::list<osmscout::TileRef>& centerTiles,
 
     //---
 
-    tile->GetOptimizedAreaData().CopyData([&ringTypeDefinition,&optimizedAreaMap](const osmscout::AreaRef& area) {
+    tile->GetOptimizedAreaData().CopyData([&ringTypeDefinition,&areaMap](const osmscout::AreaRef& area) {
       if (ringTypeDefinition.optimizedAreaTypes.IsSet(area->GetType())) {
-        optimizedAreaMap[area->GetFileOffset()]=area;
+        areaMap[area->GetFileOffset()]=area;
       }
     });
 
@@ -144,9 +139,13 @@ void MergeTilesToMapData(const std::list<osmscout::TileRef>& centerTiles,
 
   osmscout::StopClock copyTime;
 
+  data.nodes.clear();
+  data.ways.clear();
+  data.areas.clear();
+
   data.nodes.reserve(nodeMap.size());
-  data.ways.reserve(wayMap.size()+optimizedWayMap.size());
-  data.areas.reserve(areaMap.size()+optimizedAreaMap.size());
+  data.ways.reserve(wayMap.size());
+  data.areas.reserve(areaMap.size());
 
   for (const auto& nodeEntry : nodeMap) {
     data.nodes.push_back(nodeEntry.second);
@@ -156,18 +155,10 @@ void MergeTilesToMapData(const std::list<osmscout::TileRef>& centerTiles,
     data.ways.push_back(wayEntry.second);
   }
 
-  for (const auto& wayEntry : optimizedWayMap) {
-    data.ways.push_back(wayEntry.second);
-  }
-
   for (const auto& areaEntry : areaMap) {
     data.areas.push_back(areaEntry.second);
   }
 
-  for (const auto& areaEntry : optimizedAreaMap) {
-    data.areas.push_back(areaEntry.second);
-  }
-
   copyTime.Stop();
 
   if (copyTime.GetMilliseconds()>20) {
@@ -182,13 +173,14 @@ int main(int argc, char* argv[])
   double       latTop,latBottom,lonLeft,lonRight;
   unsigned int startLevel;
   unsigned int endLevel;
+  unsigned int metatileSize=1;
 
-  if (argc!=9) {
+  if (argc!=9 && argc!=10) {
     std::cerr << "DrawMap ";
     std::cerr << "<map directory> <style-file> ";
     std::cerr << "<lat_top> <lon_left> <lat_bottom> <lon_right> ";
     std::cerr << "<start_zoom>" << std::endl;
-    std::cerr << "<end_zoom>" << std::endl;
+    std::cerr << "<end_zoom> [metatile_size]" << std::endl;
     return 1;
   }
 
@@ -225,6 +217,14 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  if (argc==10) {
+    if (sscanf(argv[9],"%u",&metatileSize)!=1 ||
+        metatileSize==0) {
+      std::cerr << "metatile size is not a positive number!" << std::endl;
+      return 1;
+    }
+  }
+
   osmscout::DatabaseParameter databaseParameter;
   osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(databaseParameter);
   osmscout::MapServiceRef     mapService=std::make_shared<osmscout::MapService>(database);
@@ -325,94 +325,122 @@ int main(int argc, char* argv[])
       }
     }
 
-    for (uint32_t y=yTileStart; y<=yTileEnd; y++) {
-      for (uint32_t x=xTileStart; x<=xTileEnd; x++) {
-        agg::pixfmt_rgb24   pf(rbuf);
-        osmscout::StopClock timer;
-        osmscout::GeoBox    boundingBox;
-        osmscout::MapData   data;
-
-        projection.Set(osmscout::OSMTileId(x,y),
-                       magnification,
-                       DPI,
-                       tileWidth,
-                       tileHeight);
-
-        projection.GetDimensions(boundingBox);
+    uint32_t                      maxTileCoord=(uint32_t)(magnification.GetMagnification()-1.0);
+    osmscout::OSMTileIdBox        levelTiles(osmscout::OSMTileId(xTileStart,yTileStart),
+                                             osmscout::OSMTileId(xTileEnd,yTileEnd));
+    std::list<osmscout::Metatile> metatiles=osmscout::Metatile::GetMetatiles(magnification,
+                                                                             levelTiles,
+                                                                             metatileSize,
+                                                                             0,
+                                                                             tileWidth,
+                                                                             tileHeight);
+
+    for (const auto& metatile : metatiles) {
+      osmscout::StopClock timer;
+      osmscout::GeoBox    boundingBox=metatile.GetBoundingBox();
+      osmscout::MapData   data;
+
+      metatile.GetProjection(projection,
+                             DPI);
+
+      std::cout << "Drawing metatile " << level << " " << metatile.GetTiles().GetDisplayText() << " " << boundingBox.GetDisplayText() << std::endl;
+
+      metatile.LoadData(*mapService,
+                        *styleConfig,
+                        searchParameter,
+                        data);
+
+      // Labels of objects in the ring of tiles around the metatile might reach into it
+      const osmscout::OSMTileIdBox& renderTiles=metatile.GetRenderTiles();
+      uint32_t                      ringXStart=renderTiles.GetMinX()-std::min(tileRingSize,renderTiles.GetMinX());
+      uint32_t                      ringXEnd=std::min(renderTiles.GetMaxX()+tileRingSize,maxTileCoord);
+      uint32_t                      ringYStart=renderTiles.GetMinY()-std::min(tileRingSize,renderTiles.GetMinY());
+      uint32_t                      ringYEnd=std::min(renderTiles.GetMaxY()+tileRingSize,maxTileCoord);
+
+      std::map<osmscout::TileKey,osmscout::TileRef> ringTileMap;
+
+      for (uint32_t ringY=ringYStart; ringY<=ringYEnd; ringY++) {
+        for (uint32_t ringX=ringXStart; ringX<=ringXEnd; ringX++) {
+          if (ringX>=renderTiles.GetMinX() && ringX<=renderTiles.GetMaxX() &&
+              ringY>=renderTiles.GetMinY() && ringY<=renderTiles.GetMaxY()) {
+            continue;
+          }
 
-        std::cout << "Drawing tile " << level << "." << y << "." << x << " " << boundingBox.GetDisplayText() << std::endl;
+          osmscout::GeoBox ringBoundingBox(osmscout::OSMTileId(ringX,ringY).GetBoundingBox(magnification));
 
+          std::list<osmscout::TileRef> tiles;
 
-        std::list<osmscout::TileRef> centerTiles;
+          mapService->LookupTiles(magnification,
+                                  ringBoundingBox,
+                                  tiles);
 
-        mapService->LookupTiles(magnification,
-                                boundingBox,
-                                centerTiles);
+          for (const auto& tile : tiles) {
+            ringTileMap[tile->GetKey()]=tile;
+          }
+        }
+      }
 
-        mapService->LoadMissingTileData(searchParameter,
-                                        *styleConfig,
-                                        centerTiles);
+      std::list<osmscout::TileRef> ringTiles;
 
-        std::map<osmscout::TileKey,osmscout::TileRef> ringTileMap;
+      for (const auto& tileEntry : ringTileMap) {
+        ringTiles.push_back(tileEntry.second);
+      }
 
-        for (uint32_t ringY=y-tileRingSize; ringY<=y+tileRingSize; ringY++) {
-          for (uint32_t ringX=x-tileRingSize; ringX<=x+tileRingSize; ringX++) {
-            if (ringX==x && ringY==y) {
-              continue;
-            }
+      mapService->LoadMissingTileData(searchParameter,
+                                      magnification,
+                                      typeDefinition,
+                                      ringTiles);
 
-            osmscout::GeoBox boundingBox(osmscout::OSMTileId(ringX,ringY).GetBoundingBox(magnification));
+      AddRingTilesToMapData(typeDefinition,
+                            ringTiles,
+                            data);
 
+      std::vector<unsigned char> canvas(metatile.GetCanvasWidth()*metatile.GetCanvasHeight()*3,0);
+      agg::rendering_buffer      canvasBuffer(canvas.data(),
+                                              metatile.GetCanvasWidth(),
+                                              metatile.GetCanvasHeight(),
+                                              metatile.GetCanvasWidth()*3);
+      agg::pixfmt_rgb24          pf(canvasBuffer);
 
-            std::list<osmscout::TileRef> tiles;
+      painter.DrawMap(projection,
+                      drawParameter,
+                      data,
+                      &pf);
 
-            mapService->LookupTiles(magnification,
-                                    boundingBox,
-                                    tiles);
+      timer.Stop();
 
-            for (const auto& tile : tiles) {
-              ringTileMap[tile->GetKey()]=tile;
-            }
-          }
-        }
+      double time=timer.GetMilliseconds();
 
-        std::list<osmscout::TileRef> ringTiles;
+      minTime=std::min(minTime,time);
+      maxTime=std::max(maxTime,time);
+      totalTime+=time;
 
-        for (const auto& tileEntry : ringTileMap) {
-          ringTiles.push_back(tileEntry.second);
+      // Split the canvas into tiles, tiles outside of the requested region are dropped
+      for (const auto& tile : metatile.GetTiles()) {
+        if (!levelTiles.Includes(tile)) {
+          continue;
         }
 
-        mapService->LoadMissingTileData(searchParameter,
-                                        magnification,
-                                        typeDefinition,
-                                        ringTiles);
+        size_t canvasX;
+        size_t canvasY;
+        size_t bufferOffset=xTileCount*tileWidth*3*(tile.GetY()-yTileStart)*tileHeight+
+                            (tile.GetX()-xTileStart)*tileWidth*3;
 
-        MergeTilesToMapData(centerTiles,
-                            typeDefinition,
-                            ringTiles,
-                            data);
-
-        size_t bufferOffset=xTileCount*tileWidth*3*(y-yTileStart)*tileHeight+
-                            (x-xTileStart)*tileWidth*3;
+        metatile.GetTileOffset(tile,
+                               canvasX,
+                               canvasY);
 
         rbuf.attach(buffer+bufferOffset,
                     tileWidth,tileHeight,
                     tileWidth*xTileCount*3);
 
-        painter.DrawMap(projection,
-                        drawParameter,
-                        data,
-                        &pf);
-
-        timer.Stop();
-
-        double time=timer.GetMilliseconds();
-
-        minTime=std::min(minTime,time);
-        maxTime=std::max(maxTime,time);
-        totalTime+=time;
+        for (size_t row=0; row<tileHeight; row++) {
+          std::memcpy(rbuf.row_ptr(row),
+                      canvasBuffer.row_ptr(canvasY+row)+canvasX*3,
+                      tileWidth*3);
+        }
 
-        std::string output=std::to_string(level.Get())+"_"+std::to_string(x)+"_"+std::to_string(y)+".ppm";
+        std::string output=std::to_string(level.Get())+"_"+std::to_string(tile.GetX())+"_"+std::to_string(tile.GetY())+".ppm";
 
         write_ppm(rbuf,output.c_str());
       }
@@ -431,9 +459,10 @@ int main(int argc, char* argv[])
 
     std::cout << "=> Time: ";
     std::cout << "total: " << totalTime << " msec ";
-    std::cout << "min: " << minTime << " msec ";
-    std::cout << "avg: " << totalTime/(xTileCount*yTileCount) << " msec ";
-    std::cout << "max: " << maxTime << " msec" << std::endl;
+    std::cout << "min: " << minTime << " msec/metatile ";
+    std::cout << "avg: " << totalTime/metatiles.size() << " msec/metatile ";
+    std::cout << "max: " << maxTime << " msec/metatile ";
+    std::cout << "avg: " << totalTime/(xTileCount*yTileCount) << " msec/tile" << std::endl;
   }
 
   database->Close();
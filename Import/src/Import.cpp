@@ -105,6 +105,7 @@ void DumpHelp(osmscout::ImportParameter& parameter)
   std::cout << " --wayDataCacheSize <number>          way data cache size (default: " << parameter.GetWayDataCacheSize() << ")" << std::endl;
 
   std::cout << " --routeNodeBlockSize <number>        number of route nodes resolved in block (default: " << parameter.GetRouteNodeBlockSize() << ")" << std::endl;
+  std::cout << " --routerContractionHierarchy true|false generate contraction hierarchies for fast routing (default: " << osmscout::BoolToString(parameter.GetRouterContractionHierarchy()) << ")" << std::endl;
   std::cout << std::endl;
   std::cout << " --langOrder <#|lang1[,#|lang2]..>    language order when parsing lang[:language] and place_name[:language] tags" << std::endl
             << "                                      # is the default language (no :language) (default: #)" << std::endl;
@@ -305,6 +306,8 @@ static void DumpParameter(const osmscout::ImportParameter& parameter,
 
   progress.Info(std::string("RouteNodeBlockSize: ")+
                 std::to_string(parameter.GetRouteNodeBlockSize()));
+  progress.Info(std::string("RouterContractionHierarchy: ")+
+                (parameter.GetRouterContractionHierarchy() ? "true" : "false"));
 
 
   progress.Info(std::string("MaxAdminLevel: ")+
@@ -751,6 +754,19 @@ int main(int argc, char* argv[])
         parameterError=true;
       }
     }
+    else if (strcmp(argv[i],"--routerContractionHierarchy")==0) {
+      bool routerContractionHierarchy;
+
+      if (osmscout::ParseBoolArgument(argc,
+                                      argv,
+                                      i,
+                                      routerContractionHierarchy)) {
+        parameter.SetRouterContractionHierarchy(routerContractionHierarchy);
+      }
+      else {
+        parameterError=true;
+      }
+    }
     else if (strcmp(argv[i],"--langOrder")==0) {
         std::vector<std::string> langOrder;
 
@@ -0,0 +1,367 @@
+/*
+  RoutingGrid - a test helper for libosmscout
+  Copyright (C) 2026  agent
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef TEST_ROUTING_GRID_H
+#define TEST_ROUTING_GRID_H
+
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/import/Import.h>
+#include <osmscout/import/Preprocessor.h>
+
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/Geometry.h>
+#include <osmscout/util/Progress.h>
+
+/**
+ * Synthetic road network for routing tests: a grid of routingGridSize x routingGridSize
+ * nodes, each edge of the grid is a way of its own. Every third row is a primary road,
+ * the other ways are residential roads. Some of the ways are oneways, in both
+ * directions of the grid.
+ *
+ * East of the grid there is an island of routingGridIslandSize nodes in a north-south
+ * line, connected by residential roads, that cannot be reached from the grid. A short
+ * road to the east starts at the middle node of the island, so that the island has a
+ * junction, even if the importer merges the roads of the line.
+ *
+ * The grid nodes (x,y) with x%3==2 and y%3==2 are motorway junctions with the name
+ * "Exit x-y" and the ref "xy".
+ *
+ * Optionally going straight on at (1,3) from the way coming from (1,2) to the way
+ * leading to (1,4) is forbidden by a turn restriction. The primary road passes
+ * through (1,3), so the paths and the objects of its route node are indexed
+ * differently.
+ */
+static const size_t routingGridSize=10;
+static const size_t routingGridIslandSize=3;
+
+inline osmscout::GeoCoord GetRoutingGridCoord(size_t x,
+                                              size_t y)
+{
+  // Slightly distorted, so that there are no routes with equal costs
+  return osmscout::GeoCoord(51.0+y*0.001+((x*7+y*13)%11)*0.00003,
+                            7.0+x*0.0015+((x*5+y*3)%7)*0.00004);
+}
+
+inline osmscout::GeoCoord GetRoutingGridIslandCoord(size_t i)
+{
+  return osmscout::GeoCoord(51.0+i*0.001,
+                            7.03);
+}
+
+/**
+ * The way from (x,y) to (x+1,y) is a oneway
+ */
+inline bool IsRoutingGridHorizontalOneway(size_t x,
+                                          size_t y)
+{
+  return y%3!=0 && (x+2*y)%4==1;
+}
+
+/**
+ * The way from (x,y) to (x,y+1) is a oneway
+ */
+inline bool IsRoutingGridVerticalOneway(size_t x,
+                                        size_t y)
+{
+  return (2*x+y)%5==2;
+}
+
+class RoutingGridPreprocessor : public osmscout::Preprocessor
+{
+private:
+  osmscout::PreprocessorCallback& callback;
+  bool                            turnRestriction;
+
+public:
+  RoutingGridPreprocessor(osmscout::PreprocessorCallback& callback,
+                          bool turnRestriction)
+  : callback(callback),
+    turnRestriction(turnRestriction)
+  {
+    // no code
+  }
+
+  bool Import(const osmscout::TypeConfigRef& typeConfig,
+              const osmscout::ImportParameter& /*parameter*/,
+              osmscout::Progress& /*progress*/,
+              const std::string& /*filename*/) override
+  {
+    osmscout::TagId                                 tagHighway=typeConfig->GetTagId("highway");
+    osmscout::TagId                                 tagOneway=typeConfig->GetTagId("oneway");
+    osmscout::TagId                                 tagName=typeConfig->GetTagId("name");
+    osmscout::TagId                                 tagRef=typeConfig->GetTagId("ref");
+    osmscout::PreprocessorCallback::RawBlockDataRef data=std::make_shared<osmscout::PreprocessorCallback::RawBlockData>();
+    osmscout::OSMId                                 wayId=1;
+    osmscout::OSMId                                 restrictionFromWayId=0;
+    osmscout::OSMId                                 restrictionToWayId=0;
+
+    auto getNodeId=[](size_t x, size_t y) {
+      return (osmscout::OSMId)(y*routingGridSize+x+1);
+    };
+
+    auto getIslandNodeId=[](size_t i) {
+      return (osmscout::OSMId)(routingGridSize*routingGridSize+i+1);
+    };
+
+    auto addWay=[&](osmscout::OSMId from,
+                    osmscout::OSMId to,
+                    bool primary,
+                    bool oneway) -> osmscout::OSMId {
+      osmscout::PreprocessorCallback::RawWayData wayData;
+      osmscout::OSMId                            id=wayId++;
+
+      wayData.id=id;
+      wayData.tags[tagHighway]=primary ? "primary" : "residential";
+
+      if (oneway) {
+        wayData.tags[tagOneway]="yes";
+      }
+
+      wayData.nodes.push_back(from);
+      wayData.nodes.push_back(to);
+
+      data->wayData.push_back(std::move(wayData));
+
+      return id;
+    };
+
+    for (size_t y=0; y<routingGridSize; y++) {
+      for (size_t x=0; x<routingGridSize; x++) {
+        data->nodeData.emplace_back(getNodeId(x,y),
+                                    GetRoutingGridCoord(x,y));
+
+        if (x%3==2 && y%3==2) {
+          data->nodeData.back().tags[tagHighway]="motorway_junction";
+          data->nodeData.back().tags[tagName]="Exit "+std::to_string(x)+"-"+std::to_string(y);
+          data->nodeData.back().tags[tagRef]=std::to_string(x)+std::to_string(y);
+        }
+      }
+    }
+
+    for (size_t y=0; y<routingGridSize; y++) {
+      for (size_t x=0; x<routingGridSize; x++) {
+        // Oneways alternate their direction
+        if (x+1<routingGridSize) {
+          bool oneway=IsRoutingGridHorizontalOneway(x,y);
+
+          if (oneway && y%2==1) {
+            addWay(getNodeId(x+1,y),getNodeId(x,y),y%3==0,true);
+          }
+          else {
+            addWay(getNodeId(x,y),getNodeId(x+1,y),y%3==0,oneway);
+          }
+        }
+
+        if (y+1<routingGridSize) {
+          bool oneway=IsRoutingGridVerticalOneway(x,y);
+
+          if (oneway && x%2==1) {
+            addWay(getNodeId(x,y+1),getNodeId(x,y),false,true);
+          }
+          else {
+            osmscout::OSMId id=addWay(getNodeId(x,y),getNodeId(x,y+1),false,oneway);
+
+            if (x==1 && y==2) {
+              restrictionFromWayId=id;
+            }
+            else if (x==1 && y==3) {
+              restrictionToWayId=id;
+            }
+          }
+        }
+      }
+    }
+
+    for (size_t i=0; i<routingGridIslandSize; i++) {
+      data->nodeData.emplace_back(getIslandNodeId(i),
+                                  GetRoutingGridIslandCoord(i));
+
+      if (i>0) {
+        addWay(getIslandNodeId(i-1),getIslandNodeId(i),false,false);
+      }
+    }
+
+    data->nodeData.emplace_back(getIslandNodeId(routingGridIslandSize),
+                                osmscout::GeoCoord(GetRoutingGridIslandCoord(routingGridIslandSize/2).GetLat(),
+                                                   GetRoutingGridIslandCoord(routingGridIslandSize/2).GetLon()+0.001));
+    addWay(getIslandNodeId(routingGridIslandSize/2),getIslandNodeId(routingGridIslandSize),false,false);
+
+    if (turnRestriction) {
+      osmscout::PreprocessorCallback::RawRelationData relationData;
+
+      relationData.id=1;
+      relationData.tags[typeConfig->GetTagId("type")]="restriction";
+      relationData.tags[typeConfig->GetTagId("restriction")]="no_straight_on";
+      relationData.members.push_back({osmscout::RawRelation::memberWay,restrictionFromWayId,"from"});
+      relationData.members.push_back({osmscout::RawRelation::memberNode,getNodeId(1,3),"via"});
+      relationData.members.push_back({osmscout::RawRelation::memberWay,restrictionToWayId,"to"});
+
+      data->relationData.push_back(std::move(relationData));
+    }
+
+    callback.ProcessBlock(data);
+
+    return true;
+  }
+};
+
+class RoutingGridPreprocessorFactory : public osmscout::PreprocessorFactory
+{
+private:
+  bool turnRestriction;
+
+public:
+  explicit RoutingGridPreprocessorFactory(bool turnRestriction)
+  : turnRestriction(turnRestriction)
+  {
+    // no code
+  }
+
+  std::unique_ptr<osmscout::Preprocessor> GetProcessor(const std::string& /*filename*/,
+                                                       osmscout::PreprocessorCallback& callback) const override
+  {
+    return std::unique_ptr<osmscout::Preprocessor>(new RoutingGridPreprocessor(callback,
+                                                                               turnRestriction));
+  }
+};
+
+/**
+ * Import the routing grid (optionally with its turn restriction and contraction
+ * hierarchies) into the given directory, using the standard type definition. The
+ * test source directory is taken from the environment variable 'TESTS_TOP_DIR'.
+ */
+inline bool ImportRoutingGrid(const std::string& destinationDirectory,
+                              bool turnRestriction=false,
+                              bool contractionHierarchy=false)
+{
+  const char* testsTopDir=getenv("TESTS_TOP_DIR");
+
+  if (testsTopDir==nullptr ||
+      *testsTopDir=='\0') {
+    std::cerr << "Expected environment variable 'TESTS_TOP_DIR' not set" << std::endl;
+    return false;
+  }
+
+  if (!osmscout::ExistsInFilesystem(destinationDirectory) &&
+      !osmscout::MakeDirectory(destinationDirectory)) {
+    std::cerr << "Cannot create directory '" << destinationDirectory << "'" << std::endl;
+    return false;
+  }
+
+  osmscout::ImportParameter importParameter;
+  osmscout::SilentProgress  progress;
+
+  importParameter.SetTypefile(osmscout::AppendFileToDir(testsTopDir,"../stylesheets/map.ost"));
+  importParameter.SetMapfiles(std::list<std::string>{"grid"});
+  importParameter.SetDestinationDirectory(destinationDirectory);
+  importParameter.AddRouter(osmscout::ImportParameter::Router(osmscout::vehicleCar|osmscout::vehicleBicycle|osmscout::vehicleFoot,
+                                                              osmscout::RoutingService::DEFAULT_FILENAME_BASE));
+  importParameter.SetPreprocessorFactory(std::make_shared<RoutingGridPreprocessorFactory>(turnRestriction));
+  importParameter.SetRouterContractionHierarchy(contractionHierarchy);
+
+  try {
+    osmscout::Importer importer(importParameter);
+
+    return importer.Import(progress);
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << "Import failed: " << e.GetDescription() << std::endl;
+    return false;
+  }
+}
+
+/**
+ * Open the database in the given directory. On first use in this process the routing
+ * grid (optionally with its turn restriction and contraction hierarchies) is imported
+ * into the directory. Returns nullptr, if the import or opening the database fails.
+ */
+inline osmscout::DatabaseRef OpenRoutingGridDatabase(const std::string& databaseDirectory,
+                                                     const osmscout::DatabaseParameter& parameter=osmscout::DatabaseParameter(),
+                                                     bool turnRestriction=false,
+                                                     bool contractionHierarchy=false)
+{
+  static std::mutex            importMutex;
+  static std::set<std::string> importedDirectories;
+
+  {
+    std::lock_guard<std::mutex> guard(importMutex);
+
+    if (importedDirectories.find(databaseDirectory)==importedDirectories.end()) {
+      if (!ImportRoutingGrid(databaseDirectory,
+                             turnRestriction,
+                             contractionHierarchy)) {
+        return nullptr;
+      }
+
+      importedDirectories.insert(databaseDirectory);
+    }
+  }
+
+  osmscout::DatabaseRef database=std::make_shared<osmscout::Database>(parameter);
+
+  if (!database->Open(databaseDirectory)) {
+    std::cerr << "Cannot open database '" << databaseDirectory << "'" << std::endl;
+    return nullptr;
+  }
+
+  return database;
+}
+
+/**
+ * Calculate the length of the given route in km
+ */
+inline bool GetRouteLength(osmscout::SimpleRoutingService& router,
+                           const osmscout::RouteData& route,
+                           double& length)
+{
+  std::list<osmscout::Point> points;
+
+  if (!router.TransformRouteDataToPoints(route,points)) {
+    std::cerr << "Cannot transform route to points" << std::endl;
+    return false;
+  }
+
+  length=0.0;
+
+  for (auto point=points.begin(); point!=points.end(); ++point) {
+    auto next=point;
+
+    ++next;
+
+    if (next!=points.end()) {
+      length+=osmscout::GetSphericalDistance(point->GetCoord(),
+                                             next->GetCoord()).As<osmscout::Kilometer>();
+    }
+  }
+
+  return true;
+}
+
+#endif
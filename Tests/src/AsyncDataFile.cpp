@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <osmscout/WayDataFile.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace {
+
+  const std::string databaseDir="AsyncDataFile.db";
+
+  struct TestData
+  {
+    osmscout::TypeConfigRef           typeConfig;
+    std::vector<osmscout::Way>        ways;
+    std::vector<osmscout::FileOffset> wayOffsets;
+  };
+
+  /**
+   * Write ways of very different size to "ways.dat", so that some of them
+   * do not fit into the data read ahead, and read them back as reference.
+   */
+  TestData WriteData()
+  {
+    TestData              data;
+    osmscout::TypeInfoRef wayType=std::make_shared<osmscout::TypeInfo>("test_way");
+    std::string           filename=osmscout::AppendFileToDir(databaseDir,osmscout::WayDataFile::WAYS_DAT);
+
+    wayType->CanBeWay(true);
+
+    data.typeConfig=std::make_shared<osmscout::TypeConfig>();
+    data.typeConfig->RegisterType(wayType);
+
+    if (!osmscout::ExistsInFilesystem(databaseDir)) {
+      REQUIRE(osmscout::MakeDirectory(databaseDir));
+    }
+
+    osmscout::FileWriter writer;
+
+    writer.Open(filename);
+
+    for (size_t i=0; i<300; i++) {
+      osmscout::Way way;
+      size_t        nodeCount=i%50==0 ? 5000+i : 2+i%17;
+
+      way.SetType(wayType);
+
+      for (size_t n=0; n<nodeCount; n++) {
+        way.nodes.push_back(osmscout::Point(0,osmscout::GeoCoord(50.0+0.01*i+0.0001*n,
+                                                                 7.0+0.0003*n)));
+      }
+
+      data.wayOffsets.push_back(writer.GetPos());
+      way.Write(*data.typeConfig,writer);
+    }
+
+    writer.Close();
+
+    osmscout::FileScanner scanner;
+
+    scanner.Open(filename,osmscout::FileScanner::Normal,false);
+
+    for (const auto offset : data.wayOffsets) {
+      osmscout::Way way;
+
+      scanner.SetPos(offset);
+      way.Read(*data.typeConfig,scanner);
+      data.ways.push_back(way);
+    }
+
+    scanner.Close();
+
+    return data;
+  }
+
+  bool Equals(const osmscout::Way& a,
+              const osmscout::Way& b)
+  {
+    if (a.GetFileOffset()!=b.GetFileOffset() ||
+        a.nodes.size()!=b.nodes.size()) {
+      return false;
+    }
+
+    for (size_t i=0; i<a.nodes.size(); i++) {
+      if (a.nodes[i].GetCoord()!=b.nodes[i].GetCoord()) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+}
+
+TEST_CASE("Async prefetch decodes the same values as the file scanner") {
+  TestData data=WriteData();
+
+  for (bool memoryMapped : {false,true}) {
+    osmscout::WayDataFile wayDataFile(1000);
+
+    wayDataFile.SetAsyncPrefetch(true);
+
+    REQUIRE(wayDataFile.Open(data.typeConfig,databaseDir,memoryMapped));
+
+    std::vector<size_t> indexes;
+
+    for (size_t i=0; i<data.wayOffsets.size(); i+=1+i%3) {
+      indexes.push_back(i);
+    }
+
+    // Duplicates are decoded once
+    indexes.push_back(indexes[4]);
+
+    std::shuffle(indexes.begin(),indexes.end(),std::mt19937(42));
+
+    std::vector<osmscout::FileOffset> offsets;
+
+    for (const auto index : indexes) {
+      offsets.push_back(data.wayOffsets[index]);
+    }
+
+    std::vector<osmscout::WayRef> ways;
+
+    REQUIRE(wayDataFile.GetByOffset(offsets.begin(),
+                                    offsets.end(),
+                                    offsets.size(),
+                                    ways));
+    REQUIRE(ways.size()==indexes.size());
+
+    for (size_t i=0; i<indexes.size(); i++) {
+      REQUIRE(Equals(*ways[i],data.ways[indexes[i]]));
+    }
+
+    wayDataFile.Close();
+  }
+}
+
+TEST_CASE("Async prefetch of block spans decodes the same values as the file scanner") {
+  TestData data=WriteData();
+
+  osmscout::WayDataFile wayDataFile(1000);
+
+  wayDataFile.SetAsyncPrefetch(true);
+
+  REQUIRE(wayDataFile.Open(data.typeConfig,databaseDir,false));
+
+  std::vector<osmscout::DataBlockSpan> spans(2);
+
+  spans[0].startOffset=data.wayOffsets[0];
+  spans[0].count=120;
+  spans[1].startOffset=data.wayOffsets[180];
+  spans[1].count=120;
+
+  std::vector<osmscout::WayRef> ways;
+
+  REQUIRE(wayDataFile.GetByBlockSpans(spans.begin(),
+                                      spans.end(),
+                                      ways));
+  REQUIRE(ways.size()==240);
+
+  for (size_t i=0; i<120; i++) {
+    REQUIRE(Equals(*ways[i],data.ways[i]));
+    REQUIRE(Equals(*ways[120+i],data.ways[180+i]));
+  }
+
+  wayDataFile.Close();
+}
@@ -0,0 +1,235 @@
+/*
+  AsyncFileReader - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <osmscout/util/AsyncFileReader.h>
+#include <osmscout/util/Exception.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+
+static const size_t fileSize=1024*1024;
+
+int main()
+{
+  std::vector<char> content(fileSize);
+  std::mt19937      random(42);
+
+  for (auto& c : content) {
+    c=(char)(random() & 0xff);
+  }
+
+  try {
+    osmscout::FileWriter writer;
+
+    writer.Open("AsyncFileReader.dat");
+    writer.Write(content.data(),content.size());
+    writer.Close();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << "Error while writing file: " << e.GetDescription() << std::endl;
+    return 1;
+  }
+
+  osmscout::AsyncFileReader reader;
+
+  try {
+    reader.Open("AsyncFileReader.dat",16);
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << "Error while opening file: " << e.GetDescription() << std::endl;
+    return 1;
+  }
+
+  std::cout << "Using " << (reader.IsKernelAsync() ? "io_uring" : "thread pool") << " backend" << std::endl;
+
+  size_t                                              errors=0;
+  std::vector<osmscout::AsyncFileReader::ReadRequest> requests(200);
+  std::vector<std::vector<char>>                      buffers(requests.size());
+
+  for (size_t i=0; i<requests.size(); i++) {
+    size_t offset=random() % fileSize;
+    size_t length=1+random() % std::min((size_t)65536,fileSize-offset);
+
+    buffers[i].resize(length);
+
+    requests[i].offset=offset;
+    requests[i].length=length;
+    requests[i].buffer=buffers[i].data();
+  }
+
+  size_t completed=0;
+
+  if (!reader.Read(requests,
+                   [&completed](osmscout::AsyncFileReader::ReadRequest& /*request*/) {
+                     completed++;
+                   })) {
+    std::cerr << "Read failed" << std::endl;
+    errors++;
+  }
+
+  if (completed!=requests.size()) {
+    std::cerr << "Expected " << requests.size() << " completions, got " << completed << std::endl;
+    errors++;
+  }
+
+  for (const auto& request : requests) {
+    if (!request.success ||
+        memcmp(request.buffer,&content[request.offset],request.length)!=0) {
+      std::cerr << "Wrong data for request at " << request.offset << " length " << request.length << std::endl;
+      errors++;
+    }
+  }
+
+  // Reading beyond the end of the file must fail
+  std::vector<char>                                   buffer(100);
+  std::vector<osmscout::AsyncFileReader::ReadRequest> invalid(1);
+
+  invalid[0].offset=fileSize-10;
+  invalid[0].length=buffer.size();
+  invalid[0].buffer=buffer.data();
+
+  if (reader.Read(invalid)) {
+    std::cerr << "Read beyond end of file did not fail" << std::endl;
+    errors++;
+  }
+
+  // A throwing handler aborts the batch, the remaining requests must be finished or cancelled
+  for (auto& buffer : buffers) {
+    std::fill(buffer.begin(),buffer.end(),0);
+  }
+
+  try {
+    reader.Read(requests,
+                [](osmscout::AsyncFileReader::ReadRequest& /*request*/) {
+                  throw std::runtime_error("abort");
+                });
+
+    std::cerr << "Exception of the handler was not propagated" << std::endl;
+    errors++;
+  }
+  catch (std::runtime_error&) {
+    // expected
+  }
+
+  // The reader must still be usable afterwards
+  if (!reader.Read(requests)) {
+    std::cerr << "Read after aborted batch failed" << std::endl;
+    errors++;
+  }
+
+  for (const auto& request : requests) {
+    if (!request.success ||
+        memcmp(request.buffer,&content[request.offset],request.length)!=0) {
+      std::cerr << "Wrong data after aborted batch for request at " << request.offset << std::endl;
+      errors++;
+    }
+  }
+
+  // Threads reading at the same time must not interfere
+  std::vector<std::thread> threads;
+  std::vector<size_t>      threadErrors(4,0);
+
+  for (size_t t=0; t<threadErrors.size(); t++) {
+    threads.push_back(std::thread([&reader,&content,&threadErrors,t]() {
+      std::vector<char>                                   threadBuffer(4096*16);
+      std::vector<osmscout::AsyncFileReader::ReadRequest> threadRequests(16);
+
+      for (size_t i=0; i<threadRequests.size(); i++) {
+        threadRequests[i].offset=(t*threadRequests.size()+i)*4096;
+        threadRequests[i].length=4096;
+        threadRequests[i].buffer=threadBuffer.data()+i*4096;
+      }
+
+      for (size_t round=0; round<20; round++) {
+        if (!reader.Read(threadRequests)) {
+          threadErrors[t]++;
+        }
+
+        for (const auto& request : threadRequests) {
+          if (memcmp(request.buffer,&content[request.offset],request.length)!=0) {
+            threadErrors[t]++;
+          }
+        }
+      }
+    }));
+  }
+
+  for (size_t t=0; t<threads.size(); t++) {
+    threads[t].join();
+
+    if (threadErrors[t]!=0) {
+      std::cerr << "Wrong data in concurrent reads of thread " << t << std::endl;
+      errors++;
+    }
+  }
+
+  reader.Close();
+
+  // A scanner reading from a buffer uses file offsets
+  try {
+    osmscout::FileScanner scanner;
+    char                  value;
+
+    scanner.Open("AsyncFileReader.dat",
+                 &content[1000],
+                 1000,
+                 100);
+
+    scanner.SetPos(1050);
+    scanner.Read(&value,1);
+
+    if (value!=content[1050] ||
+        scanner.GetPos()!=1051) {
+      std::cerr << "Wrong data or position reading from a buffer" << std::endl;
+      errors++;
+    }
+
+    try {
+      scanner.SetPos(1100);
+
+      std::cerr << "Position beyond the end of the buffer did not fail" << std::endl;
+      errors++;
+    }
+    catch (osmscout::IOException&) {
+      // expected
+    }
+
+    scanner.CloseFailsafe();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << "Error while reading from buffer: " << e.GetDescription() << std::endl;
+    errors++;
+  }
+
+  if (errors!=0) {
+    std::cerr << errors << " error(s)" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
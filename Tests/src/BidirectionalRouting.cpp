@@ -0,0 +1,467 @@
+/*
+  BidirectionalRouting - a test program for libosmscout
+  Copyright (C) 2026  agent
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <limits>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <osmscout/routing/AbstractRoutingService.h>
+#include <osmscout/routing/RoutingProfile.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace {
+
+  const size_t gridSize=8;
+
+  osmscout::Point GetPoint(size_t x,
+                           size_t y)
+  {
+    // Slightly distorted grid, so that there are no routes with equal costs. All nodes
+    // are junctions and so are relevant.
+    return osmscout::Point(1,
+                           osmscout::GeoCoord(50.0+y*0.001+((x*7+y*13)%11)*0.00003,
+                                              7.0+x*0.0015+((x*5+y*3)%7)*0.00004));
+  }
+
+  /**
+   * Routing service on an in-memory grid. Each edge of the grid is a way with two nodes,
+   * every third way is a oneway. Costs are the distances in km.
+   */
+  class GridRoutingService : public osmscout::AbstractRoutingService<osmscout::RoutingProfile>
+  {
+  public:
+    std::unordered_map<osmscout::FileOffset,osmscout::WayRef>                    ways;
+    std::unordered_set<const osmscout::Way*>                                     oneways;
+    std::unordered_map<osmscout::Id,osmscout::RouteNodeRef>                      routeNodes;
+    std::unordered_map<osmscout::Id,std::vector<osmscout::ObjectFileRef>>        junctions;
+    std::unordered_map<osmscout::FileOffset,size_t>                              wayLoadCounts; //!< Single way loads by offset
+
+  private:
+    void AddWay(size_t fromX,
+                size_t fromY,
+                size_t toX,
+                size_t toY,
+                bool oneway)
+    {
+      osmscout::FileOffset offset=ways.size()+1;
+      osmscout::WayRef     way=std::make_shared<osmscout::Way>();
+
+      way->nodes.push_back(GetPoint(fromX,fromY));
+      way->nodes.push_back(GetPoint(toX,toY));
+
+      ways[offset]=way;
+
+      if (oneway) {
+        oneways.insert(way.get());
+      }
+
+      osmscout::ObjectFileRef object(offset,osmscout::refWay);
+
+      for (size_t i=0; i<2; i++) {
+        osmscout::Id               id=way->GetId(i);
+        osmscout::RouteNodeRef&    routeNode=routeNodes[id];
+
+        if (!routeNode) {
+          routeNode=std::make_shared<osmscout::RouteNode>();
+          routeNode->Initialize(0,way->nodes[i]);
+        }
+
+        junctions[id].push_back(object);
+
+        if (i==1 && oneway) {
+          continue;
+        }
+
+        osmscout::RouteNode::Path path;
+
+        path.id=way->GetId(1-i);
+        path.distance=osmscout::GetSphericalDistance(way->nodes[0].GetCoord(),
+                                                     way->nodes[1].GetCoord());
+        path.objectIndex=routeNode->AddObject(object,0);
+        path.flags=osmscout::RouteNode::usableByCar;
+
+        routeNode->paths.push_back(path);
+      }
+    }
+
+  public:
+    GridRoutingService()
+    : osmscout::AbstractRoutingService<osmscout::RoutingProfile>(osmscout::RouterParameter())
+    {
+      for (size_t y=0; y<gridSize; y++) {
+        for (size_t x=0; x<gridSize; x++) {
+          // Oneways alternate their direction
+          if (x+1<gridSize) {
+            bool oneway=(x+2*y)%3==0;
+
+            if (oneway && (x+y)%2==0) {
+              AddWay(x+1,y,x,y,true);
+            }
+            else {
+              AddWay(x,y,x+1,y,oneway);
+            }
+          }
+
+          if (y+1<gridSize) {
+            bool oneway=(2*x+y)%3==1;
+
+            if (oneway && (x+y)%2==1) {
+              AddWay(x,y+1,x,y,true);
+            }
+            else {
+              AddWay(x,y,x,y+1,oneway);
+            }
+          }
+        }
+      }
+    }
+
+    osmscout::RoutePosition GetPosition(size_t x,
+                                        size_t y) const
+    {
+      osmscout::Id id=GetPoint(x,y).GetId();
+
+      for (const auto& entry : ways) {
+        size_t nodeIndex;
+
+        if (entry.second->GetNodeIndexByNodeId(id,nodeIndex)) {
+          return osmscout::RoutePosition(osmscout::ObjectFileRef(entry.first,osmscout::refWay),
+                                         nodeIndex,
+                                         0);
+        }
+      }
+
+      return osmscout::RoutePosition();
+    }
+
+    bool CanUseBackward(const osmscout::WayRef& way) const
+    {
+      return oneways.find(way.get())==oneways.end();
+    }
+
+    /**
+     * Reference costs using Dijkstra on the route nodes
+     */
+    double GetReferenceCosts(size_t startX,
+                             size_t startY,
+                             size_t targetX,
+                             size_t targetY) const
+    {
+      std::unordered_map<osmscout::Id,double>   costs;
+      std::set<std::pair<double,osmscout::Id>>  open;
+      osmscout::Id                              targetId=GetPoint(targetX,targetY).GetId();
+
+      costs[GetPoint(startX,startY).GetId()]=0.0;
+      open.insert(std::make_pair(0.0,GetPoint(startX,startY).GetId()));
+
+      while (!open.empty()) {
+        auto current=*open.begin();
+
+        open.erase(open.begin());
+
+        if (current.second==targetId) {
+          return current.first;
+        }
+
+        for (const auto& path : routeNodes.at(current.second)->paths) {
+          double cost=current.first+path.distance.As<osmscout::Kilometer>();
+          auto   entry=costs.find(path.id);
+
+          if (entry==costs.end() ||
+              cost<entry->second) {
+            if (entry!=costs.end()) {
+              open.erase(std::make_pair(entry->second,path.id));
+            }
+
+            costs[path.id]=cost;
+            open.insert(std::make_pair(cost,path.id));
+          }
+        }
+      }
+
+      return -1.0;
+    }
+
+    /**
+     * Costs of the route, calculated from the way nodes of the route
+     */
+    double GetRouteCosts(const osmscout::RouteData& route) const
+    {
+      double costs=0.0;
+
+      for (const auto& entry : route.Entries()) {
+        if (!entry.GetPathObject().Valid()) {
+          continue;
+        }
+
+        const osmscout::Way& way=*ways.at(entry.GetPathObject().GetFileOffset());
+
+        costs+=osmscout::GetSphericalDistance(way.nodes[entry.GetCurrentNodeIndex()].GetCoord(),
+                                              way.nodes[entry.GetTargetNodeIndex()].GetCoord()).As<osmscout::Kilometer>();
+      }
+
+      return costs;
+    }
+
+  protected:
+    osmscout::Vehicle GetVehicle(const osmscout::RoutingProfile& /*state*/) override
+    {
+      return osmscout::vehicleCar;
+    }
+
+    bool CanUse(const osmscout::RoutingProfile& /*state*/,
+                osmscout::DatabaseId /*database*/,
+                const osmscout::RouteNode& routeNode,
+                size_t pathIndex) override
+    {
+      return (routeNode.paths[pathIndex].flags & osmscout::RouteNode::usableByCar)!=0;
+    }
+
+    bool CanUseForward(const osmscout::RoutingProfile& /*state*/,
+                       const osmscout::DatabaseId& /*database*/,
+                       const osmscout::WayRef& /*way*/) override
+    {
+      return true;
+    }
+
+    bool CanUseBackward(const osmscout::RoutingProfile& /*state*/,
+                        const osmscout::DatabaseId& /*database*/,
+                        const osmscout::WayRef& way) override
+    {
+      return CanUseBackward(way);
+    }
+
+    double GetCosts(const osmscout::RoutingProfile& /*state*/,
+                    osmscout::DatabaseId /*database*/,
+                    const osmscout::RouteNode& routeNode,
+                    size_t pathIndex) override
+    {
+      return routeNode.paths[pathIndex].distance.As<osmscout::Kilometer>();
+    }
+
+    double GetCosts(const osmscout::RoutingProfile& /*state*/,
+                    osmscout::DatabaseId /*database*/,
+                    const osmscout::WayRef& /*way*/,
+                    const osmscout::Distance& wayLength) override
+    {
+      return wayLength.As<osmscout::Kilometer>();
+    }
+
+    double GetEstimateCosts(const osmscout::RoutingProfile& /*state*/,
+                            osmscout::DatabaseId /*database*/,
+                            const osmscout::Distance& targetDistance) override
+    {
+      return targetDistance.As<osmscout::Kilometer>();
+    }
+
+    double GetCostLimit(const osmscout::RoutingProfile& /*state*/,
+                        osmscout::DatabaseId /*database*/,
+                        const osmscout::Distance& /*targetDistance*/) override
+    {
+      return std::numeric_limits<double>::max();
+    }
+
+    bool GetRouteNodes(const std::set<osmscout::DBId>& routeNodeIds,
+                       std::unordered_map<osmscout::DBId,osmscout::RouteNodeRef>& routeNodeMap) override
+    {
+      for (const auto& id : routeNodeIds) {
+        osmscout::RouteNodeRef routeNode;
+
+        if (!GetRouteNode(id,routeNode) ||
+            !routeNode) {
+          return false;
+        }
+
+        routeNodeMap[id]=routeNode;
+      }
+
+      return true;
+    }
+
+    bool GetRouteNode(const osmscout::DBId& id,
+                      osmscout::RouteNodeRef& node) override
+    {
+      auto entry=routeNodes.find(id.id);
+
+      node=entry!=routeNodes.end() ? entry->second : nullptr;
+
+      return true;
+    }
+
+    bool GetWayByOffset(const osmscout::DBFileOffset& offset,
+                        osmscout::WayRef& way) override
+    {
+      auto entry=ways.find(offset.offset);
+
+      if (entry==ways.end()) {
+        return false;
+      }
+
+      wayLoadCounts[offset.offset]++;
+      way=entry->second;
+
+      return true;
+    }
+
+    bool GetWaysByOffset(const std::set<osmscout::DBFileOffset>& wayOffsets,
+                         std::unordered_map<osmscout::DBFileOffset,osmscout::WayRef>& wayMap) override
+    {
+      for (const auto& offset : wayOffsets) {
+        auto entry=ways.find(offset.offset);
+
+        if (entry==ways.end()) {
+          return false;
+        }
+
+        wayMap[offset]=entry->second;
+      }
+
+      return true;
+    }
+
+    bool GetAreaByOffset(const osmscout::DBFileOffset& /*offset*/,
+                         osmscout::AreaRef& /*area*/) override
+    {
+      return false;
+    }
+
+    bool GetAreasByOffset(const std::set<osmscout::DBFileOffset>& areaOffsets,
+                          std::unordered_map<osmscout::DBFileOffset,osmscout::AreaRef>& /*areaMap*/) override
+    {
+      return areaOffsets.empty();
+    }
+
+    bool ResolveRouteDataJunctions(osmscout::RouteData& /*route*/) override
+    {
+      return true;
+    }
+
+    std::vector<osmscout::DBId> GetNodeTwins(const osmscout::RoutingProfile& /*state*/,
+                                             const osmscout::DatabaseId /*database*/,
+                                             const osmscout::Id /*id*/) override
+    {
+      return std::vector<osmscout::DBId>();
+    }
+
+    bool GetJunctionObjects(const osmscout::DBId& id,
+                            std::vector<osmscout::ObjectFileRef>& objects) override
+    {
+      auto entry=junctions.find(id.id);
+
+      if (entry==junctions.end()) {
+        return false;
+      }
+
+      objects=entry->second;
+
+      return true;
+    }
+  };
+}
+
+TEST_CASE("Bidirectional and unidirectional search return routes with equal costs") {
+  GridRoutingService                   service;
+  osmscout::ShortestPathRoutingProfile profile(std::make_shared<osmscout::TypeConfig>());
+  osmscout::RoutingParameter           unidirectional;
+  osmscout::RoutingParameter           bidirectional;
+  size_t                               routeCount=0;
+
+  bidirectional.SetBidirectional(true);
+
+  REQUIRE(!service.oneways.empty());
+
+  for (size_t start=0; start<gridSize*gridSize; start+=5) {
+    for (size_t target=0; target<gridSize*gridSize; target+=3) {
+      size_t startX=start%gridSize;
+      size_t startY=start/gridSize;
+      size_t targetX=target%gridSize;
+      size_t targetY=target/gridSize;
+
+      if (start==target) {
+        continue;
+      }
+
+      double referenceCosts=service.GetReferenceCosts(startX,startY,targetX,targetY);
+
+      if (referenceCosts<0.0) {
+        continue;
+      }
+
+      osmscout::RoutePosition startPosition=service.GetPosition(startX,startY);
+      osmscout::RoutePosition targetPosition=service.GetPosition(targetX,targetY);
+
+      osmscout::RoutingResult unidirectionalResult=service.CalculateRoute(profile,
+                                                                          startPosition,
+                                                                          targetPosition,
+                                                                          unidirectional);
+      osmscout::RoutingResult bidirectionalResult=service.CalculateRoute(profile,
+                                                                         startPosition,
+                                                                         targetPosition,
+                                                                         bidirectional);
+
+      INFO("Route from " << startX << "," << startY << " to " << targetX << "," << targetY);
+
+      REQUIRE(unidirectionalResult.Success());
+      REQUIRE(bidirectionalResult.Success());
+
+      REQUIRE(service.GetRouteCosts(unidirectionalResult.GetRoute())==Approx(referenceCosts));
+      REQUIRE(service.GetRouteCosts(bidirectionalResult.GetRoute())==Approx(referenceCosts));
+
+      routeCount++;
+    }
+  }
+
+  REQUIRE(routeCount>50);
+}
+
+TEST_CASE("Bidirectional search loads each way only once per query") {
+  GridRoutingService                   service;
+  osmscout::ShortestPathRoutingProfile profile(std::make_shared<osmscout::TypeConfig>());
+  osmscout::RoutingParameter           bidirectional;
+
+  bidirectional.SetBidirectional(true);
+
+  osmscout::RoutePosition start=service.GetPosition(0,0);
+  osmscout::RoutePosition target=service.GetPosition(gridSize-1,gridSize-1);
+  osmscout::RoutingResult result=service.CalculateRoute(profile,
+                                                        start,
+                                                        target,
+                                                        bidirectional);
+
+  REQUIRE(result.Success());
+  REQUIRE(!service.wayLoadCounts.empty());
+
+  // The ways of the start and the target position are additionally loaded for the route nodes
+  // of the positions
+  for (const auto& entry : service.wayLoadCounts) {
+    INFO("Way " << entry.first);
+
+    if (entry.first==start.GetObjectFileRef().GetFileOffset() ||
+        entry.first==target.GetObjectFileRef().GetFileOffset()) {
+      REQUIRE(entry.second<=2);
+    }
+    else {
+      REQUIRE(entry.second==1);
+    }
+  }
+}
@@ -18,7 +18,10 @@
 */
 
 #include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <random>
 #include <vector>
 
 #include <osmscout/util/Cache.h>
@@ -30,6 +33,7 @@
   * cache insertion
   * cache hit
   * cache miss
+  * the different cache policies on a replayed (or synthetic) trace of file offsets
 */
 
 /**
@@ -180,7 +184,112 @@ bool TestData()
   return true;
 }
 
-int main(int /*argc*/, char* /*argv*/[])
+typedef osmscout::Cache<osmscout::FileOffset,size_t> OffsetCache;
+
+/**
+  Generate a trace similar to rendering: A skewed working set of
+  objects that is repeatedly accessed, interrupted by large viewport scans
+  touching objects that are never accessed again.
+  */
+void GenerateTrace(std::vector<osmscout::FileOffset>& trace)
+{
+  static const size_t hotSetSize=50000;
+  static const size_t scanSize=200000;
+  static const size_t rounds=20;
+  static const size_t accessesPerRound=500000;
+
+  std::mt19937                            generator(42);
+  std::exponential_distribution<double>   hotDistribution(3.0/hotSetSize);
+  osmscout::FileOffset                    scanOffset=100000000;
+
+  for (size_t round=1; round<=rounds; round++) {
+    for (size_t i=0; i<accessesPerRound; i++) {
+      osmscout::FileOffset offset=(osmscout::FileOffset)hotDistribution(generator);
+
+      trace.push_back(1000+(offset % hotSetSize)*137);
+    }
+
+    for (size_t i=0; i<scanSize; i++) {
+      trace.push_back(scanOffset);
+      scanOffset+=211;
+    }
+  }
+}
+
+/**
+  Read a trace of file offsets (one decimal offset per line)
+  */
+bool LoadTrace(const char* filename,
+               std::vector<osmscout::FileOffset>& trace)
+{
+  std::ifstream        stream(filename);
+  osmscout::FileOffset offset;
+
+  if (!stream) {
+    std::cerr << "Cannot open trace file '" << filename << "'" << std::endl;
+    return false;
+  }
+
+  while (stream >> offset) {
+    trace.push_back(offset);
+  }
+
+  return true;
+}
+
+void ReplayTrace(const std::vector<osmscout::FileOffset>& trace,
+                 osmscout::CachePolicy policy,
+                 const char* policyName,
+                 size_t size)
 {
-  return TestData() ? 0:1;
+  OffsetCache         cache(size,policy);
+  osmscout::StopClock timer;
+
+  for (const auto offset : trace) {
+    OffsetCache::CacheRef ref;
+
+    if (!cache.GetEntry(offset,ref)) {
+      cache.SetEntry(OffsetCache::CacheEntry(offset,(size_t)offset));
+    }
+  }
+
+  timer.Stop();
+
+  double hitRate=100.0*cache.GetHits()/(cache.GetHits()+cache.GetMisses());
+
+  std::cout << std::setfill(' ') << std::setw(6) << policyName << " " << std::setw(8) << size << ": ";
+  std::cout << "hit rate " << std::fixed << std::setprecision(2) << hitRate << "%, ";
+  std::cout << cache.GetEvictions() << " evictions, " << timer << std::endl;
+}
+
+bool TestPolicies(const std::vector<osmscout::FileOffset>& trace)
+{
+  std::cout << "*** Cache policies on trace of " << trace.size() << " accesses ***" << std::endl;
+
+  for (size_t size : {10000,50000,100000}) {
+    ReplayTrace(trace,osmscout::CachePolicy::LRU,"LRU",size);
+    ReplayTrace(trace,osmscout::CachePolicy::Clock,"Clock",size);
+  }
+
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<osmscout::FileOffset> trace;
+
+  if (argc==2) {
+    if (!LoadTrace(argv[1],trace)) {
+      return 1;
+    }
+  }
+  else {
+    GenerateTrace(trace);
+  }
+
+  if (!TestData()) {
+    return 1;
+  }
+
+  return TestPolicies(trace) ? 0:1;
 }
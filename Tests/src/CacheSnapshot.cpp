@@ -0,0 +1,160 @@
+#include <string>
+#include <vector>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileWriter.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace {
+
+  const std::string databaseDir="CacheSnapshot.db";
+  const std::string snapshotFile=osmscout::AppendFileToDir(databaseDir,"snapshot.dat");
+
+  /**
+   * Write a database consisting of "types.dat" and "ways.dat" and return the
+   * offsets of the ways
+   */
+  std::vector<osmscout::FileOffset> WriteDatabase()
+  {
+    osmscout::TypeConfig              typeConfig;
+    osmscout::TypeInfoRef             wayType=std::make_shared<osmscout::TypeInfo>("test_way");
+    std::vector<osmscout::FileOffset> offsets;
+
+    wayType->CanBeWay(true);
+    typeConfig.RegisterType(wayType);
+
+    if (!osmscout::ExistsInFilesystem(databaseDir)) {
+      REQUIRE(osmscout::MakeDirectory(databaseDir));
+    }
+
+    REQUIRE(typeConfig.StoreToDataFile(databaseDir));
+
+    osmscout::FileWriter writer;
+
+    writer.Open(osmscout::AppendFileToDir(databaseDir,osmscout::WayDataFile::WAYS_DAT));
+
+    for (size_t i=0; i<20; i++) {
+      osmscout::Way way;
+
+      way.SetType(wayType);
+
+      for (size_t n=0; n<2+i; n++) {
+        way.nodes.push_back(osmscout::Point(0,osmscout::GeoCoord(50.0+0.01*i,7.0+0.001*n)));
+      }
+
+      offsets.push_back(writer.GetPos());
+      way.Write(typeConfig,writer);
+    }
+
+    writer.Close();
+
+    return offsets;
+  }
+
+  std::vector<osmscout::FileOffset> GetCachedOffsets(const osmscout::Database& database)
+  {
+    std::vector<osmscout::FileOffset> offsets;
+
+    database.GetWayDataFile()->GetCachedOffsets(offsets);
+
+    return offsets;
+  }
+}
+
+TEST_CASE("Cache snapshot restores the cached entries in cache order") {
+  std::vector<osmscout::FileOffset> offsets=WriteDatabase();
+  std::vector<size_t>               accessOrder={7,3,12,0,19,5,3,8};
+  std::vector<osmscout::FileOffset> expected;
+
+  {
+    osmscout::Database database(osmscout::DatabaseParameter{});
+
+    REQUIRE(database.Open(databaseDir));
+
+    for (const auto index : accessOrder) {
+      osmscout::WayRef way;
+
+      REQUIRE(database.GetWayByOffset(offsets[index],way));
+    }
+
+    expected=GetCachedOffsets(database);
+
+    // Most recently used first
+    REQUIRE(expected.size()==7);
+    REQUIRE(expected[0]==offsets[8]);
+    REQUIRE(expected[1]==offsets[3]);
+    REQUIRE(expected[6]==offsets[7]);
+
+    REQUIRE(database.SaveCacheSnapshot(snapshotFile));
+
+    database.Close();
+  }
+
+  {
+    osmscout::Database database(osmscout::DatabaseParameter{});
+
+    REQUIRE(database.Open(databaseDir));
+    REQUIRE(database.LoadCacheSnapshot(snapshotFile,1000));
+    REQUIRE(GetCachedOffsets(database)==expected);
+
+    database.Close();
+  }
+
+  // Without any bytes to read nothing is restored
+  {
+    osmscout::Database database(osmscout::DatabaseParameter{});
+
+    REQUIRE(database.Open(databaseDir));
+    REQUIRE(database.LoadCacheSnapshot(snapshotFile,0));
+    REQUIRE(GetCachedOffsets(database).empty());
+
+    database.Close();
+  }
+
+  // The hottest entries must survive, if the cache is too small for the whole snapshot
+  {
+    osmscout::DatabaseParameter parameter;
+
+    parameter.SetWayDataCacheSize(4);
+
+    osmscout::Database database(parameter);
+
+    REQUIRE(database.Open(databaseDir));
+    REQUIRE(database.LoadCacheSnapshot(snapshotFile,1000));
+    REQUIRE(GetCachedOffsets(database)==std::vector<osmscout::FileOffset>(expected.begin(),
+                                                                           expected.begin()+4));
+
+    database.Close();
+  }
+
+  osmscout::RemoveFile(snapshotFile);
+}
+
+TEST_CASE("Cache snapshot with an entry count exceeding the file is rejected") {
+  WriteDatabase();
+
+  osmscout::FileWriter writer;
+
+  writer.Open(snapshotFile);
+  writer.Write((uint32_t)1);
+  writer.Write((uint32_t)1);
+  writer.Write(std::string(osmscout::WayDataFile::WAYS_DAT));
+  writer.WriteFileOffset(osmscout::GetFileSize(osmscout::AppendFileToDir(databaseDir,osmscout::WayDataFile::WAYS_DAT)));
+  writer.Write((uint32_t)0xffffffff);
+  writer.WriteFileOffset(0);
+  writer.Close();
+
+  osmscout::Database database(osmscout::DatabaseParameter{});
+
+  REQUIRE(database.Open(databaseDir));
+  REQUIRE_FALSE(database.LoadCacheSnapshot(snapshotFile,1000));
+  REQUIRE(GetCachedOffsets(database).empty());
+
+  database.Close();
+
+  osmscout::RemoveFile(snapshotFile);
+}
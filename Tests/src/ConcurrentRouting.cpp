@@ -0,0 +1,223 @@
+/*
+  ConcurrentRouting - a test program for libosmscout
+  Copyright (C) 2026  agent
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <RoutingGrid.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace {
+
+  const std::string databaseDir="ConcurrentRouting.db";
+
+  /**
+   * Parameter of a profile, profiles are created anew for each route
+   */
+  struct ProfileParameter
+  {
+    bool   fastest;
+    double vehicleMaxSpeed;
+  };
+
+  const std::vector<ProfileParameter> profileParameters={{false,100.0},
+                                                         {true,100.0},
+                                                         {true,40.0},
+                                                         {true,20.0},
+                                                         {true,15.0},
+                                                         {true,10.0}};
+
+  const std::vector<std::pair<size_t,size_t>> routeNodes={{0,0},{9,9},
+                                                          {8,1},{1,7},
+                                                          {4,9},{5,0},
+                                                          {0,6},{9,2}};
+
+  std::unique_ptr<osmscout::AbstractRoutingProfile> CreateProfile(const osmscout::TypeConfigRef& typeConfig,
+                                                                  const ProfileParameter& parameter)
+  {
+    std::unique_ptr<osmscout::AbstractRoutingProfile> profile;
+
+    if (parameter.fastest) {
+      profile.reset(new osmscout::FastestPathRoutingProfile(typeConfig));
+    }
+    else {
+      profile.reset(new osmscout::ShortestPathRoutingProfile(typeConfig));
+    }
+
+    profile->ParametrizeForCar(*typeConfig,
+                               std::map<std::string,double>{{"highway_primary",50.0},
+                                                            {"highway_residential",30.0}},
+                               parameter.vehicleMaxSpeed);
+
+    return profile;
+  }
+
+  /**
+   * Calculate all routes for all profile parameters and return the route node ids
+   * of each route. An empty route signals an error.
+   */
+  std::vector<std::vector<osmscout::Id>> CalculateRoutes(osmscout::SimpleRoutingService& router,
+                                                         const osmscout::TypeConfigRef& typeConfig)
+  {
+    std::vector<std::vector<osmscout::Id>> routes;
+
+    for (const auto& parameter : profileParameters) {
+      for (size_t i=0; i+1<routeNodes.size(); i+=2) {
+        std::unique_ptr<osmscout::AbstractRoutingProfile> profile=CreateProfile(typeConfig,parameter);
+        osmscout::RoutePosition                           start=router.GetClosestRoutableNode(GetRoutingGridCoord(routeNodes[i].first,routeNodes[i].second),
+                                                                                               *profile,
+                                                                                               osmscout::Distance::Of<osmscout::Meter>(50.0));
+        osmscout::RoutePosition                           target=router.GetClosestRoutableNode(GetRoutingGridCoord(routeNodes[i+1].first,routeNodes[i+1].second),
+                                                                                                *profile,
+                                                                                                osmscout::Distance::Of<osmscout::Meter>(50.0));
+        osmscout::RoutingResult                           result=router.CalculateRoute(*profile,
+                                                                                       start,
+                                                                                       target,
+                                                                                       osmscout::RoutingParameter());
+
+        routes.push_back(std::vector<osmscout::Id>());
+
+        if (result.Success()) {
+          for (const auto& entry : result.GetRoute().Entries()) {
+            routes.back().push_back(entry.GetCurrentNodeId());
+          }
+        }
+      }
+    }
+
+    return routes;
+  }
+}
+
+TEST_CASE("Concurrent routes with the flat routing graph match serial routes") {
+  osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir);
+
+  REQUIRE(database);
+
+  osmscout::RouterParameter      flatParameter;
+  osmscout::SimpleRoutingService referenceRouter(database,
+                                                 osmscout::RouterParameter(),
+                                                 osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+
+  flatParameter.SetFlatRouteGraph(true);
+
+  osmscout::SimpleRoutingService flatRouter(database,
+                                            flatParameter,
+                                            osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+
+  REQUIRE(referenceRouter.Open());
+  REQUIRE(flatRouter.Open());
+
+  std::vector<std::vector<osmscout::Id>> reference=CalculateRoutes(referenceRouter,
+                                                                   database->GetTypeConfig());
+
+  for (const auto& route : reference) {
+    REQUIRE(route.size()>1);
+  }
+
+  // The maximum speed of the vehicle changes the routes
+  REQUIRE(reference[routeNodes.size()/2]!=reference[3*routeNodes.size()/2]);
+
+  // More different profiles than cached costs, so costs get evicted and recalculated
+  std::vector<std::vector<std::vector<osmscout::Id>>> results(4);
+  std::vector<std::thread>                            threads;
+
+  for (auto& result : results) {
+    threads.emplace_back([&flatRouter,&database,&result] {
+      result=CalculateRoutes(flatRouter,
+                             database->GetTypeConfig());
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& result : results) {
+    REQUIRE(result==reference);
+  }
+
+  // And once more serially, with the costs of the last profiles still cached
+  REQUIRE(CalculateRoutes(flatRouter,database->GetTypeConfig())==reference);
+
+  flatRouter.Close();
+  referenceRouter.Close();
+  database->Close();
+}
+
+TEST_CASE("Concurrent routes reading route node pages asynchronously match serial routes") {
+  osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir);
+
+  REQUIRE(database);
+
+  osmscout::SimpleRoutingService referenceRouter(database,
+                                                 osmscout::RouterParameter(),
+                                                 osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+
+  REQUIRE(referenceRouter.Open());
+
+  std::vector<std::vector<osmscout::Id>> reference=CalculateRoutes(referenceRouter,
+                                                                   database->GetTypeConfig());
+
+  referenceRouter.Close();
+  database->Close();
+
+  osmscout::DatabaseParameter asyncParameter;
+
+  asyncParameter.SetDataAsyncPrefetch(true);
+
+  osmscout::DatabaseRef asyncDatabase=OpenRoutingGridDatabase(databaseDir,asyncParameter);
+
+  REQUIRE(asyncDatabase);
+
+  osmscout::SimpleRoutingService asyncRouter(asyncDatabase,
+                                             osmscout::RouterParameter(),
+                                             osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+
+  REQUIRE(asyncRouter.Open());
+
+  std::vector<std::vector<std::vector<osmscout::Id>>> results(4);
+  std::vector<std::thread>                            threads;
+
+  for (auto& result : results) {
+    threads.emplace_back([&asyncRouter,&asyncDatabase,&result] {
+      result=CalculateRoutes(asyncRouter,
+                             asyncDatabase->GetTypeConfig());
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& result : results) {
+    REQUIRE(result==reference);
+  }
+
+  asyncRouter.Close();
+  asyncDatabase->Close();
+}
@@ -0,0 +1,268 @@
+/*
+  ContractionHierarchy - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include <osmscout/routing/ContractionHierarchy.h>
+
+#include <osmscout/util/Progress.h>
+
+#include <osmscout/import/GenContractionHierarchy.h>
+
+typedef osmscout::ContractionHierarchyGenerator::InputEdge InputEdge;
+
+static const size_t gridSize=30;
+static const size_t nodeCount=gridSize*gridSize;
+
+/**
+ * Grid with random costs, some edges are one way
+ */
+static std::vector<InputEdge> CreateGraph()
+{
+  std::mt19937                           random(42);
+  std::uniform_real_distribution<double> costs(1.0,10.0);
+  std::vector<InputEdge>                 edges;
+  size_t                                 objectIndex=1;
+
+  auto addEdge=[&](uint32_t source,
+                   uint32_t target) {
+    osmscout::ObjectFileRef object(objectIndex++,osmscout::refWay);
+    double                  edgeCosts=costs(random);
+
+    edges.push_back(InputEdge{source,target,edgeCosts,object});
+
+    if (random()%5!=0) {
+      edges.push_back(InputEdge{target,source,edgeCosts,object});
+    }
+  };
+
+  for (uint32_t y=0; y<gridSize; y++) {
+    for (uint32_t x=0; x<gridSize; x++) {
+      uint32_t node=y*gridSize+x;
+
+      if (x+1<gridSize) {
+        addEdge(node,node+1);
+      }
+
+      if (y+1<gridSize) {
+        addEdge(node,node+gridSize);
+      }
+    }
+  }
+
+  return edges;
+}
+
+static double Dijkstra(const std::vector<InputEdge>& edges,
+                       uint32_t source,
+                       uint32_t target)
+{
+  typedef std::pair<double,uint32_t> QueueEntry;
+
+  std::vector<double> costs(nodeCount,std::numeric_limits<double>::max());
+  std::priority_queue<QueueEntry,std::vector<QueueEntry>,std::greater<QueueEntry>> queue;
+
+  costs[source]=0.0;
+  queue.push(std::make_pair(0.0,source));
+
+  while (!queue.empty()) {
+    QueueEntry entry=queue.top();
+
+    queue.pop();
+
+    if (entry.first>costs[entry.second]) {
+      continue;
+    }
+
+    if (entry.second==target) {
+      return entry.first;
+    }
+
+    for (const auto& edge : edges) {
+      if (edge.source==entry.second &&
+          entry.first+edge.costs<costs[edge.target]) {
+        costs[edge.target]=entry.first+edge.costs;
+        queue.push(std::make_pair(costs[edge.target],edge.target));
+      }
+    }
+  }
+
+  return std::numeric_limits<double>::max();
+}
+
+/**
+ * Check that the route is a chain of edges of the graph with the given costs
+ */
+static bool CheckRoute(const std::vector<InputEdge>& edges,
+                       const std::vector<osmscout::ContractionHierarchy::Step>& steps,
+                       uint32_t source,
+                       uint32_t target,
+                       double expectedCosts)
+{
+  if (steps.empty() ||
+      steps.front().id!=source+1 ||
+      steps.back().id!=target+1) {
+    std::cerr << "Route does not connect " << source << " and " << target << std::endl;
+    return false;
+  }
+
+  double costs=0.0;
+
+  for (size_t i=1; i<steps.size(); i++) {
+    bool found=false;
+
+    for (const auto& edge : edges) {
+      if (edge.source+1==steps[i-1].id &&
+          edge.target+1==steps[i].id &&
+          edge.object==steps[i].object) {
+        costs+=edge.costs;
+        found=true;
+        break;
+      }
+    }
+
+    if (!found) {
+      std::cerr << "No edge from " << steps[i-1].id << " to " << steps[i].id << std::endl;
+      return false;
+    }
+  }
+
+  if (std::fabs(costs-expectedCosts)>1e-6) {
+    std::cerr << "Route costs " << costs << " != " << expectedCosts << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+int main()
+{
+  osmscout::SilentProgress            progress;
+  std::vector<InputEdge>              edges=CreateGraph();
+  osmscout::ContractionHierarchy      hierarchy;
+  std::vector<osmscout::Id>           ids(nodeCount);
+  std::vector<uint8_t>                excludes(nodeCount,0);
+  size_t                              errors=0;
+
+  // Ids are node index+1, since 0 is not a valid id
+  for (size_t i=0; i<nodeCount; i++) {
+    ids[i]=i+1;
+  }
+
+  hierarchy.SetMetric(osmscout::vehicleCar,
+                      160.0,
+                      std::vector<double>());
+  hierarchy.SetNodes(std::move(ids),
+                     std::move(excludes));
+
+  osmscout::ContractionHierarchyGenerator::Contract(nodeCount,
+                                                    edges,
+                                                    progress,
+                                                    hierarchy);
+
+  // Write and read the hierarchy again, all queries use the loaded copy
+  osmscout::ContractionHierarchy loaded;
+  std::string                    filename="ContractionHierarchy.dat";
+
+  try {
+    osmscout::FileWriter  writer;
+    osmscout::FileScanner scanner;
+
+    writer.Open(filename);
+    hierarchy.Write(writer);
+    writer.Close();
+
+    scanner.Open(filename,
+                 osmscout::FileScanner::Sequential,
+                 false);
+    loaded.Read(scanner);
+    scanner.Close();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << e.GetDescription() << std::endl;
+    return 1;
+  }
+
+  std::remove(filename.c_str());
+
+  if (loaded.GetNodeCount()!=hierarchy.GetNodeCount() ||
+      loaded.GetEdgeCount()!=hierarchy.GetEdgeCount()) {
+    std::cerr << "Loaded hierarchy differs" << std::endl;
+    errors++;
+  }
+
+  std::mt19937 random(4711);
+
+  for (size_t i=0; i<200; i++) {
+    uint32_t source=random()%nodeCount;
+    uint32_t target=random()%nodeCount;
+    double   expected=Dijkstra(edges,source,target);
+
+    std::vector<osmscout::ContractionHierarchy::Step> steps;
+    double                                            costs;
+    size_t                                            settledNodes;
+
+    bool found=loaded.CalculateRoute({osmscout::ContractionHierarchy::Terminal{source+1,0.0}},
+                                     {osmscout::ContractionHierarchy::Terminal{target+1,0.0}},
+                                     steps,
+                                     costs,
+                                     settledNodes);
+
+    if (expected==std::numeric_limits<double>::max()) {
+      if (found) {
+        std::cerr << "Found route from " << source << " to " << target << " that does not exist" << std::endl;
+        errors++;
+      }
+
+      continue;
+    }
+
+    if (!found) {
+      std::cerr << "No route found from " << source << " to " << target << std::endl;
+      errors++;
+      continue;
+    }
+
+    if (std::fabs(costs-expected)>1e-6) {
+      std::cerr << "Costs from " << source << " to " << target << ": " << costs << " != " << expected << std::endl;
+      errors++;
+      continue;
+    }
+
+    if (!CheckRoute(edges,steps,source,target,expected)) {
+      errors++;
+    }
+  }
+
+  if (errors!=0) {
+    std::cerr << errors << " errors" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
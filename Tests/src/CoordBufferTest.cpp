@@ -57,4 +57,26 @@ TEST_CASE("Check bounding box of generated parallel way")
 
   REQUIRE(buffer.GenerateParallelWay(/*from*/0, /*to*/3, /*offset*/1, trFrom, trTo));
   REQUIRE(trFrom > 7);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Check appending of another buffer")
+{
+  CoordBuffer buffer;
+  CoordBuffer other;
+
+  buffer.PushCoord(0,0);
+  buffer.PushCoord(10,0);
+
+  for (size_t i=0; i<200000; i++) {
+    other.PushCoord((double)i,1);
+  }
+
+  size_t offset=buffer.PushCoords(other);
+
+  REQUIRE(offset==2);
+  REQUIRE(buffer.GetSize()==200002);
+  REQUIRE(buffer.buffer[1].GetX()==10);
+  REQUIRE(buffer.buffer[offset].GetX()==0);
+  REQUIRE(buffer.buffer[offset+199999].GetX()==199999);
+  REQUIRE(buffer.buffer[offset+199999].GetY()==1);
+}
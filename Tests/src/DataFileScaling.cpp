@@ -0,0 +1,208 @@
+/*
+  DataFileScaling - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/util/StopClock.h>
+
+/**
+  Measure how way loading via DataFile::GetByOffset scales with the
+  number of reading threads for different numbers of cache shards.
+*/
+
+static const size_t THREAD_COUNTS[]={1,2,4,8,16,32};
+static const size_t SHARD_COUNTS[]={1,16,64};
+static const size_t LOOKUPS_PER_THREAD=200000;
+static const size_t BATCH_SIZE=64;
+
+void LoadWays(const osmscout::WayDataFileRef& wayDataFile,
+              const std::vector<osmscout::FileOffset>& offsets,
+              size_t seed,
+              bool& result)
+{
+  std::mt19937                               generator(seed);
+  std::uniform_int_distribution<size_t>      distribution(0,offsets.size()-1);
+  std::vector<osmscout::FileOffset>          batch;
+  std::vector<osmscout::WayRef>              ways;
+
+  result=true;
+  batch.reserve(BATCH_SIZE);
+
+  for (size_t i=0; i<LOOKUPS_PER_THREAD; i+=BATCH_SIZE) {
+    batch.clear();
+    ways.clear();
+
+    for (size_t b=0; b<BATCH_SIZE; b++) {
+      batch.push_back(offsets[distribution(generator)]);
+    }
+
+    if (!wayDataFile->GetByOffset(batch.begin(),
+                                  batch.end(),
+                                  batch.size(),
+                                  ways)) {
+      result=false;
+      return;
+    }
+
+    for (size_t b=0; b<BATCH_SIZE; b++) {
+      if (ways[b]->GetFileOffset()!=batch[b]) {
+        result=false;
+        return;
+      }
+    }
+  }
+}
+
+bool CollectWayOffsets(const std::string& path,
+                       std::vector<osmscout::FileOffset>& offsets)
+{
+  osmscout::DatabaseParameter parameter;
+  osmscout::Database          database(parameter);
+
+  if (!database.Open(path)) {
+    std::cerr << "Cannot open database" << std::endl;
+    return false;
+  }
+
+  osmscout::AreaWayIndexRef areaWayIndex=database.GetAreaWayIndex();
+  osmscout::GeoBox          boundingBox;
+  osmscout::TypeInfoSet     wayTypes(database.GetTypeConfig()->GetWayTypes());
+  osmscout::TypeInfoSet     loadedWayTypes;
+
+  if (!areaWayIndex ||
+      !database.GetBoundingBox(boundingBox) ||
+      !areaWayIndex->GetOffsets(boundingBox,
+                                wayTypes,
+                                offsets,
+                                loadedWayTypes)) {
+    std::cerr << "Cannot collect way offsets" << std::endl;
+    return false;
+  }
+
+  database.Close();
+
+  return !offsets.empty();
+}
+
+bool RunBenchmark(const std::string& path,
+                  const std::vector<osmscout::FileOffset>& offsets,
+                  size_t shardCount,
+                  size_t threadCount)
+{
+  osmscout::DatabaseParameter parameter;
+
+  // Cache a quarter of the ways, so we measure a mix of hits and misses
+  parameter.SetWayDataCacheSize(std::max(offsets.size()/4,(size_t)1));
+  parameter.SetDataCacheShardCount(shardCount);
+
+  osmscout::Database database(parameter);
+
+  if (!database.Open(path)) {
+    std::cerr << "Cannot open database" << std::endl;
+    return false;
+  }
+
+  osmscout::WayDataFileRef wayDataFile=database.GetWayDataFile();
+
+  if (!wayDataFile) {
+    return false;
+  }
+
+  std::vector<std::thread> threads(threadCount);
+  std::vector<char>        results(threadCount);
+  bool                     result=true;
+  osmscout::StopClock      timer;
+
+  for (size_t i=0; i<threads.size(); i++) {
+    threads[i]=std::thread([&wayDataFile,&offsets,&results,i]() {
+      bool threadResult;
+
+      LoadWays(wayDataFile,
+               offsets,
+               i,
+               threadResult);
+
+      results[i]=threadResult;
+    });
+  }
+
+  for (size_t i=0; i<threads.size(); i++) {
+    threads[i].join();
+
+    if (!results[i]) {
+      result=false;
+    }
+  }
+
+  timer.Stop();
+
+  double lookups=(double)threadCount*LOOKUPS_PER_THREAD;
+
+  std::cout << std::setw(6) << shardCount << " shard(s) ";
+  std::cout << std::setw(3) << threadCount << " thread(s): ";
+  std::cout << timer.ResultString() << ", ";
+  std::cout << std::fixed << std::setprecision(0) << lookups*1000.0/timer.GetMilliseconds() << " lookups/s";
+  std::cout << (result ? "" : " ERROR") << std::endl;
+
+  database.Close();
+
+  return result;
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc!=2) {
+    std::cerr << "DataFileScaling <database directory>" << std::endl;
+    return 1;
+  }
+
+  std::vector<osmscout::FileOffset> offsets;
+
+  std::cout << "Collecting way offsets..." << std::endl;
+
+  if (!CollectWayOffsets(argv[1],
+                         offsets)) {
+    return 1;
+  }
+
+  std::cout << "Found " << offsets.size() << " way(s)" << std::endl;
+
+  bool result=true;
+
+  for (size_t shardCount : SHARD_COUNTS) {
+    for (size_t threadCount : THREAD_COUNTS) {
+      if (!RunBenchmark(argv[1],
+                        offsets,
+                        shardCount,
+                        threadCount)) {
+        result=false;
+      }
+    }
+  }
+
+  return result ? 0 : 1;
+}
@@ -2,6 +2,8 @@
 #include <iostream>
 #include <limits>
 
+#include <osmscout/PointsView.h>
+
 #include <osmscout/util/FileScanner.h>
 #include <osmscout/util/FileWriter.h>
 
@@ -38,6 +40,92 @@ bool Equals(const std::vector<osmscout::Point>& coordsA, const std::vector<osmsc
   return true;
 }
 
+bool Equals(const osmscout::PointsView& view, const std::vector<osmscout::Point>& coords)
+{
+  if (view.size()!=coords.size()) {
+    std::cerr << "Expected " << coords.size() << " points, got " << view.size() << std::endl;
+    return false;
+  }
+
+  size_t i=0;
+
+  for (const auto& point : view) {
+    if (point.GetCoord().GetDisplayText()!=coords[i].GetCoord().GetDisplayText() ||
+        point.GetSerial()!=coords[i].GetSerial()) {
+      std::cerr << "Difference at offset " << i << " " << coords[i].GetCoord().GetDisplayText() << " <=> " << point.GetCoord().GetDisplayText() << std::endl;
+      return false;
+    }
+
+    i++;
+  }
+
+  return true;
+}
+
+/**
+ * Write lists of points with and without ids and read them back via PointsView
+ */
+void CheckPointsView(const std::vector<std::vector<osmscout::Point>>& coordsList,
+                     bool useMmap)
+{
+  osmscout::FileWriter   writer;
+  osmscout::FileScanner  scanner;
+  osmscout::PointsView   view;
+  osmscout::FileOffset   finalWriteFileOffset;
+
+  try {
+    writer.Open("points.dat");
+
+    for (const auto& coords : coordsList) {
+      writer.Write(coords,true);
+      writer.Write(coords,false);
+    }
+
+    finalWriteFileOffset=writer.GetPos();
+
+    writer.Close();
+
+    scanner.Open("points.dat",osmscout::FileScanner::Normal,useMmap);
+
+    for (size_t i=0; i<coordsList.size(); i++) {
+      std::vector<osmscout::Point> withoutIds(coordsList[i]);
+
+      for (auto& point : withoutIds) {
+        point.ClearSerial();
+      }
+
+      scanner.Read(view,true);
+      if (!Equals(view,coordsList[i])) {
+        std::cerr << "Read(PointsView) " << i+1 << " with ids, mmap: " << useMmap << " failed" << std::endl;
+        errors++;
+      }
+
+      if (useMmap && !view.IsMemoryMapped()) {
+        std::cerr << "Read(PointsView) " << i+1 << " does not reference memory mapped data" << std::endl;
+        errors++;
+      }
+
+      scanner.Read(view,false);
+      if (!Equals(view,withoutIds)) {
+        std::cerr << "Read(PointsView) " << i+1 << " without ids, mmap: " << useMmap << " failed" << std::endl;
+        errors++;
+      }
+    }
+
+    if (scanner.GetPos()!=finalWriteFileOffset) {
+      std::cerr << "Read(PointsView) final file offset check: Expected " << finalWriteFileOffset << ", got " << scanner.GetPos() << std::endl;
+      errors++;
+    }
+
+    scanner.Close();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << e.GetDescription() << std::endl;
+    errors++;
+  }
+}
+
+
 int main()
 {
   osmscout::FileWriter  writer;
@@ -459,6 +547,21 @@ int main()
     errors++;
   }
 
+  std::vector<osmscout::Point> serialCoords(outCoords3);
+
+  for (size_t i=0; i<serialCoords.size(); i+=3) {
+    serialCoords[i].SetSerial((uint8_t)(i+1));
+  }
+
+  std::vector<std::vector<osmscout::Point>> viewCoords={outCoords1,
+                                                        outCoords4,
+                                                        outCoords5,
+                                                        serialCoords,
+                                                        {outCoords1.front()}};
+
+  CheckPointsView(viewCoords,false);
+  CheckPointsView(viewCoords,true);
+
   if (errors!=0) {
     return 1;
   }
@@ -0,0 +1,239 @@
+/*
+  Isochrone - a test program for libosmscout
+  Copyright (C) 2026  agent
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <map>
+#include <vector>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <osmscout/util/Geometry.h>
+
+#include <RoutingGrid.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace {
+
+  const std::string databaseDir="Isochrone.db";
+
+  const osmscout::ReachableNode* FindReachableNode(const osmscout::IsochroneResult& result,
+                                                   const osmscout::GeoCoord& coord)
+  {
+    for (const auto& node : result.GetNodes()) {
+      if (osmscout::GetSphericalDistance(node.coord,coord).AsMeter()<1.0) {
+        return &node;
+      }
+    }
+
+    return nullptr;
+  }
+
+  void ParametrizeProfile(osmscout::ShortestPathRoutingProfile& profile,
+                          const osmscout::TypeConfig& typeConfig)
+  {
+    profile.ParametrizeForCar(typeConfig,
+                              std::map<std::string,double>{{"highway_primary",50.0},
+                                                           {"highway_residential",30.0}},
+                              100.0);
+  }
+}
+
+TEST_CASE("Isochrone contains exactly the route nodes within the budget") {
+  osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir);
+
+  REQUIRE(database);
+
+  osmscout::SimpleRoutingService       router(database,
+                                              osmscout::RouterParameter(),
+                                              osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::ShortestPathRoutingProfile profile(database->GetTypeConfig());
+  osmscout::IsochroneParameter         isochroneParameter;
+  const double                         budget=0.5;
+
+  REQUIRE(router.Open());
+
+  ParametrizeProfile(profile,*database->GetTypeConfig());
+
+  osmscout::RoutePosition start=router.GetClosestRoutableNode(GetRoutingGridCoord(2,3),
+                                                              profile,
+                                                              osmscout::Distance::Of<osmscout::Meter>(50.0));
+
+  REQUIRE(start.IsValid());
+
+  isochroneParameter.SetMaxDistance(osmscout::Distance::Of<osmscout::Kilometer>(budget));
+  isochroneParameter.SetPolygonCellSize(osmscout::Distance::Of<osmscout::Meter>(40.0));
+
+  osmscout::IsochroneResult result=router.CalculateIsochrone(profile,
+                                                             start,
+                                                             isochroneParameter,
+                                                             osmscout::RoutingParameter());
+
+  REQUIRE(result.Success());
+
+  size_t reached=0;
+
+  for (size_t y=0; y<routingGridSize; y++) {
+    for (size_t x=0; x<routingGridSize; x++) {
+      INFO("Node " << x << "," << y);
+
+      const osmscout::ReachableNode* node=FindReachableNode(result,GetRoutingGridCoord(x,y));
+
+      if (x==2 && y==3) {
+        REQUIRE(node!=nullptr);
+        REQUIRE(node->distance.AsMeter()==Approx(0.0));
+        reached++;
+        continue;
+      }
+
+      osmscout::RoutePosition target=router.GetClosestRoutableNode(GetRoutingGridCoord(x,y),
+                                                                   profile,
+                                                                   osmscout::Distance::Of<osmscout::Meter>(50.0));
+
+      REQUIRE(target.IsValid());
+
+      osmscout::RoutingResult route=router.CalculateRoute(profile,
+                                                          start,
+                                                          target,
+                                                          osmscout::RoutingParameter());
+
+      REQUIRE(route.Success());
+
+      double length;
+
+      REQUIRE(GetRouteLength(router,route.GetRoute(),length));
+
+      // The distances of the route nodes are stored with limited precision
+      if (length<budget*0.99) {
+        REQUIRE(node!=nullptr);
+        REQUIRE(node->distance.As<osmscout::Kilometer>()==Approx(length).epsilon(0.001));
+        reached++;
+      }
+      else if (length>budget*1.01) {
+        REQUIRE(node==nullptr);
+      }
+      else if (node!=nullptr) {
+        reached++;
+      }
+    }
+  }
+
+  REQUIRE(reached>1);
+  REQUIRE(reached<routingGridSize*routingGridSize);
+  REQUIRE(result.GetNodes().size()==reached);
+
+  for (const auto& node : result.GetNodes()) {
+    REQUIRE(node.distance.As<osmscout::Kilometer>()<=budget);
+  }
+
+  // The outline is a closed ring of axis parallel segments containing all reached nodes
+  const std::vector<osmscout::GeoCoord>& polygon=result.GetPolygon();
+
+  REQUIRE(polygon.size()>=4);
+
+  for (size_t i=0; i<polygon.size(); i++) {
+    const osmscout::GeoCoord& from=polygon[i];
+    const osmscout::GeoCoord& to=polygon[(i+1)%polygon.size()];
+
+    INFO("Segment " << i);
+    REQUIRE((from.GetLat()==to.GetLat())!=(from.GetLon()==to.GetLon()));
+  }
+
+  for (const auto& node : result.GetNodes()) {
+    REQUIRE(osmscout::IsCoordInArea(node.coord,polygon));
+  }
+
+  router.Close();
+  database->Close();
+}
+
+TEST_CASE("Isochrone respects the time budget") {
+  osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir);
+
+  REQUIRE(database);
+
+  osmscout::SimpleRoutingService       router(database,
+                                              osmscout::RouterParameter(),
+                                              osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::ShortestPathRoutingProfile profile(database->GetTypeConfig());
+  osmscout::IsochroneParameter         isochroneParameter;
+  const double                         budget=0.01;
+
+  REQUIRE(router.Open());
+
+  ParametrizeProfile(profile,*database->GetTypeConfig());
+
+  osmscout::RoutePosition start=router.GetClosestRoutableNode(GetRoutingGridCoord(5,5),
+                                                              profile,
+                                                              osmscout::Distance::Of<osmscout::Meter>(50.0));
+
+  REQUIRE(start.IsValid());
+
+  isochroneParameter.SetMaxTime(budget);
+
+  osmscout::IsochroneResult result=router.CalculateIsochrone(profile,
+                                                             start,
+                                                             isochroneParameter,
+                                                             osmscout::RoutingParameter());
+
+  REQUIRE(result.Success());
+  REQUIRE(result.GetNodes().size()<routingGridSize*routingGridSize);
+  REQUIRE(result.GetPolygon().empty());
+
+  for (const auto& node : result.GetNodes()) {
+    REQUIRE(node.time<=budget);
+  }
+
+  router.Close();
+  database->Close();
+}
+
+TEST_CASE("Isochrone without budget is rejected") {
+  osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir);
+
+  REQUIRE(database);
+
+  osmscout::SimpleRoutingService       router(database,
+                                              osmscout::RouterParameter(),
+                                              osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::ShortestPathRoutingProfile profile(database->GetTypeConfig());
+
+  REQUIRE(router.Open());
+
+  ParametrizeProfile(profile,*database->GetTypeConfig());
+
+  osmscout::RoutePosition start=router.GetClosestRoutableNode(GetRoutingGridCoord(5,5),
+                                                              profile,
+                                                              osmscout::Distance::Of<osmscout::Meter>(50.0));
+
+  REQUIRE(start.IsValid());
+
+  osmscout::IsochroneResult result=router.CalculateIsochrone(profile,
+                                                             start,
+                                                             osmscout::IsochroneParameter(),
+                                                             osmscout::RoutingParameter());
+
+  REQUIRE_FALSE(result.Success());
+  REQUIRE(result.GetPolygon().empty());
+
+  router.Close();
+  database->Close();
+}
@@ -0,0 +1,258 @@
+/*
+  MapMatching - a test program for libosmscout
+  Copyright (C) 2026  agent
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/routing/MapMatcher.h>
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <RoutingGrid.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace {
+
+  const std::string databaseDir="MapMatching.db";
+
+  osmscout::GeoCoord Interpolate(const osmscout::GeoCoord& from,
+                                 const osmscout::GeoCoord& to,
+                                 double fraction,
+                                 double latOffset)
+  {
+    return osmscout::GeoCoord(from.GetLat()+(to.GetLat()-from.GetLat())*fraction+latOffset,
+                              from.GetLon()+(to.GetLon()-from.GetLon())*fraction);
+  }
+
+  /**
+   * Trace along the bottom row of the grid from column 0 to column 6. The points are
+   * up to 13 meter north or south of the road, so near the crossings the vertical
+   * roads are candidates, too.
+   */
+  std::vector<osmscout::GeoCoord> GetRowTrace()
+  {
+    std::vector<osmscout::GeoCoord> trace;
+
+    for (size_t x=0; x<6; x++) {
+      for (size_t i=0; i<3; i++) {
+        trace.push_back(Interpolate(GetRoutingGridCoord(x,0),
+                                    GetRoutingGridCoord(x+1,0),
+                                    i/3.0,
+                                    (x+i)%2==0 ? 0.00012 : -0.00008));
+      }
+    }
+
+    trace.push_back(GetRoutingGridCoord(6,0));
+
+    return trace;
+  }
+
+  std::list<osmscout::Point> GetRoutePoints(osmscout::SimpleRoutingService& router,
+                                            const osmscout::RouteData& route)
+  {
+    std::list<osmscout::Point> points;
+
+    REQUIRE(router.TransformRouteDataToPoints(route,points));
+
+    return points;
+  }
+
+  /**
+   * All points must be on the bottom row of the grid
+   */
+  void CheckOnBottomRow(const std::list<osmscout::Point>& points)
+  {
+    for (const auto& point : points) {
+      INFO("Point " << point.GetCoord().GetDisplayText());
+      REQUIRE(point.GetCoord().GetLat()<51.0005);
+      REQUIRE(point.GetCoord().GetLon()<GetRoutingGridCoord(6,0).GetLon()+0.0001);
+    }
+  }
+}
+
+TEST_CASE("Trace along a road is matched onto the road") {
+  osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir);
+
+  REQUIRE(database);
+
+  osmscout::SimpleRoutingService       router(database,
+                                              osmscout::RouterParameter(),
+                                              osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::ShortestPathRoutingProfile profile(database->GetTypeConfig());
+
+  REQUIRE(router.Open());
+
+  profile.ParametrizeForCar(*database->GetTypeConfig(),
+                            std::map<std::string,double>{{"highway_primary",50.0},
+                                                         {"highway_residential",30.0}},
+                            100.0);
+
+  std::vector<osmscout::GeoCoord> trace=GetRowTrace();
+  osmscout::MapMatcher            matcher(database,
+                                          router,
+                                          profile,
+                                          osmscout::MapMatcherParameter(),
+                                          osmscout::RoutingParameter());
+  osmscout::RoutingResult         result=matcher.Match(trace);
+
+  REQUIRE(result.Success());
+  REQUIRE(matcher.GetPointCount()==trace.size());
+  REQUIRE(matcher.GetMatchedCount()==trace.size());
+  REQUIRE(matcher.GetBreakCount()==0);
+
+  std::list<osmscout::Point> points=GetRoutePoints(router,result.GetRoute());
+
+  REQUIRE(points.size()>=7);
+  REQUIRE(osmscout::GetSphericalDistance(points.front().GetCoord(),GetRoutingGridCoord(0,0)).AsMeter()<1.0);
+  REQUIRE(osmscout::GetSphericalDistance(points.back().GetCoord(),GetRoutingGridCoord(6,0)).AsMeter()<1.0);
+
+  CheckOnBottomRow(points);
+
+  router.Close();
+  database->Close();
+}
+
+TEST_CASE("Converged points are decided before the end of the trace") {
+  osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir);
+
+  REQUIRE(database);
+
+  osmscout::SimpleRoutingService       router(database,
+                                              osmscout::RouterParameter(),
+                                              osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::ShortestPathRoutingProfile profile(database->GetTypeConfig());
+  osmscout::MapMatcherParameter        parameter;
+
+  REQUIRE(router.Open());
+
+  profile.ParametrizeForCar(*database->GetTypeConfig(),
+                            std::map<std::string,double>{{"highway_primary",50.0},
+                                                         {"highway_residential",30.0}},
+                            100.0);
+
+  std::vector<osmscout::GeoCoord> trace=GetRowTrace();
+
+  // The window is large enough for the whole trace, so only convergence decides points
+  parameter.SetWindowSize(trace.size()+1);
+
+  osmscout::MapMatcher matcher(database,
+                               router,
+                               profile,
+                               parameter,
+                               osmscout::RoutingParameter());
+
+  for (const auto& coord : trace) {
+    REQUIRE(matcher.AddPoint(coord));
+  }
+
+  osmscout::RouteData decided=matcher.TakeRoute();
+
+  REQUIRE_FALSE(decided.IsEmpty());
+
+  std::list<osmscout::Point> decidedPoints=GetRoutePoints(router,decided);
+
+  REQUIRE(osmscout::GetSphericalDistance(decidedPoints.front().GetCoord(),GetRoutingGridCoord(0,0)).AsMeter()<1.0);
+  CheckOnBottomRow(decidedPoints);
+
+  REQUIRE(matcher.Finish());
+
+  // The last entry taken before is the start of the remaining route
+  osmscout::RouteData rest=matcher.TakeRoute();
+
+  REQUIRE_FALSE(rest.IsEmpty());
+
+  size_t decidedCount=decided.Entries().size();
+
+  decided.Append(rest);
+
+  REQUIRE(decided.Entries().size()>decidedCount);
+
+  std::list<osmscout::Point> points=GetRoutePoints(router,decided);
+
+  REQUIRE(osmscout::GetSphericalDistance(points.back().GetCoord(),GetRoutingGridCoord(6,0)).AsMeter()<1.0);
+  CheckOnBottomRow(points);
+
+  router.Close();
+  database->Close();
+}
+
+TEST_CASE("Trace is split, if no candidate can be reached") {
+  osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir);
+
+  REQUIRE(database);
+
+  osmscout::SimpleRoutingService       router(database,
+                                              osmscout::RouterParameter(),
+                                              osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::ShortestPathRoutingProfile profile(database->GetTypeConfig());
+
+  REQUIRE(router.Open());
+
+  profile.ParametrizeForCar(*database->GetTypeConfig(),
+                            std::map<std::string,double>{{"highway_primary",50.0},
+                                                         {"highway_residential",30.0}},
+                            100.0);
+
+  std::vector<osmscout::GeoCoord> trace=GetRowTrace();
+
+  // Jump to the island, which is not connected to the grid
+  for (size_t i=0; i<4; i++) {
+    trace.push_back(Interpolate(GetRoutingGridIslandCoord(0),
+                                GetRoutingGridIslandCoord(2),
+                                0.1+i*0.25,
+                                0.0));
+  }
+
+  osmscout::MapMatcher    matcher(database,
+                                  router,
+                                  profile,
+                                  osmscout::MapMatcherParameter(),
+                                  osmscout::RoutingParameter());
+  osmscout::RoutingResult result=matcher.Match(trace);
+
+  REQUIRE(result.Success());
+  REQUIRE(matcher.GetMatchedCount()==trace.size());
+  REQUIRE(matcher.GetBreakCount()==1);
+
+  std::list<osmscout::Point> points=GetRoutePoints(router,result.GetRoute());
+  size_t                     gridPoints=0;
+  size_t                     islandPoints=0;
+
+  for (const auto& point : points) {
+    if (point.GetCoord().GetLon()<GetRoutingGridCoord(routingGridSize-1,0).GetLon()+0.001) {
+      // No point of the grid after the first point of the island
+      REQUIRE(islandPoints==0);
+      gridPoints++;
+    }
+    else {
+      REQUIRE(point.GetCoord().GetLon()==Approx(GetRoutingGridIslandCoord(0).GetLon()));
+      islandPoints++;
+    }
+  }
+
+  REQUIRE(gridPoints>=7);
+  REQUIRE(islandPoints>=2);
+
+  router.Close();
+  database->Close();
+}
@@ -0,0 +1,216 @@
+/*
+  MemoryBudget - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+#include <osmscout/util/Cache.h>
+#include <osmscout/util/MemoryBudget.h>
+#include <osmscout/util/MemoryMonitor.h>
+
+/**
+ * Cache of fixed size values, memory limited by the budget
+ */
+class TestConsumer : public osmscout::MemoryBudget::Consumer
+{
+private:
+  typedef osmscout::Cache<size_t,size_t> ValueCache;
+
+  struct ValueSizer : public ValueCache::ValueSizer
+  {
+    size_t GetSize(const size_t& /*value*/) const override
+    {
+      return 100;
+    }
+  };
+
+private:
+  std::string name;
+  ValueCache  cache;
+
+public:
+  explicit TestConsumer(const std::string& name)
+  : name(name),
+    cache(1000000)
+  {
+    // no code
+  }
+
+  std::string GetMemoryConsumerName() const override
+  {
+    return name;
+  }
+
+  size_t GetMemoryUsage() const override
+  {
+    return cache.GetCurrentMemory();
+  }
+
+  void GetCacheStatistics(size_t& hits,
+                          size_t& misses) const override
+  {
+    hits=cache.GetHits();
+    misses=cache.GetMisses();
+  }
+
+  void SetMemoryLimit(size_t bytes) override
+  {
+    cache.SetMaxMemory(bytes,std::make_shared<ValueSizer>());
+  }
+
+  /**
+   * Access the given key, loading it on a miss
+   */
+  void Access(size_t key)
+  {
+    ValueCache::CacheRef ref;
+
+    if (!cache.GetEntry(key,ref)) {
+      cache.SetEntry(ValueCache::CacheEntry(key,key));
+    }
+  }
+
+  size_t GetMemoryLimit() const
+  {
+    return cache.GetMaxMemory();
+  }
+};
+
+static size_t errors=0;
+
+static void Check(bool condition,
+                  const std::string& message)
+{
+  if (!condition) {
+    std::cerr << "ERROR: " << message << std::endl;
+    errors++;
+  }
+}
+
+int main()
+{
+  osmscout::MemoryBudget budget(100000);
+  TestConsumer           hot("hot");
+  TestConsumer           streaming("streaming");
+
+  budget.Register(hot);
+  budget.Register(streaming);
+
+  Check(hot.GetMemoryLimit()+streaming.GetMemoryLimit()<=100000,"Initial limits exceed budget");
+  Check(hot.GetMemoryLimit()==streaming.GetMemoryLimit(),"Initial limits are not equal");
+
+  // "hot" repeatedly accesses a working set of 450 entries (45000 bytes), "streaming"
+  // never accesses an entry twice
+  size_t streamKey=0;
+
+  for (size_t round=0; round<10; round++) {
+    for (size_t i=0; i<3000; i++) {
+      hot.Access(i%450);
+      streaming.Access(streamKey++);
+    }
+
+    budget.Rebalance();
+  }
+
+  std::cout << "hot: " << hot.GetMemoryLimit() << ", streaming: " << streaming.GetMemoryLimit() << std::endl;
+
+  Check(hot.GetMemoryLimit()>=45000,"Hot cache did not get enough memory for its working set");
+  Check(streaming.GetMemoryLimit()<hot.GetMemoryLimit(),"Streaming cache got more memory than hot cache");
+  Check(streaming.GetMemoryLimit()>=100000/4/2,"Streaming cache got less than its base share");
+  Check(budget.GetMemoryUsage()<=100000,"Budget exceeded");
+
+  // Shrinking the budget must evict entries immediately
+  budget.SetBudget(20000);
+
+  Check(hot.GetMemoryUsage()+streaming.GetMemoryUsage()<=20000,"Shrinking budget did not evict entries");
+  Check(hot.GetMemoryLimit()+streaming.GetMemoryLimit()<=20000,"Limits exceed shrunk budget");
+
+  // Removing a consumer assigns its memory to the others
+  budget.Unregister(streaming);
+
+  Check(hot.GetMemoryLimit()>=19000,"Memory of unregistered consumer not redistributed");
+
+  // Automatic rebalancing only happens after the rebalance interval has passed
+  osmscout::MemoryBudget autoBudget(100000);
+  TestConsumer           autoHot("autoHot");
+  TestConsumer           autoCold("autoCold");
+
+  autoBudget.Register(autoHot);
+  autoBudget.Register(autoCold);
+  autoBudget.SetRebalanceInterval(std::chrono::hours(1));
+
+  for (size_t i=0; i<3000; i++) {
+    autoHot.Access(i%200);
+  }
+
+  autoBudget.RebalanceIfDue();
+
+  Check(autoHot.GetMemoryLimit()==autoCold.GetMemoryLimit(),"Rebalanced before the interval has passed");
+
+  autoBudget.SetRebalanceInterval(std::chrono::milliseconds(0));
+  autoBudget.RebalanceIfDue();
+
+  Check(autoHot.GetMemoryLimit()>autoCold.GetMemoryLimit(),"Not rebalanced after the interval has passed");
+
+#ifdef __linux__
+  // The memory monitor shrinks the budget on memory pressure and grows it back afterwards
+  osmscout::MemoryBudgetRef monitoredBudget=std::make_shared<osmscout::MemoryBudget>(100000);
+  TestConsumer              monitored("monitored");
+  double                    vmUsage;
+  double                    residentSet;
+
+  monitoredBudget->Register(monitored);
+
+  {
+    osmscout::MemoryMonitor monitor;
+
+    monitor.SetMemoryBudget(monitoredBudget,1);
+    monitor.GetMaxValue(vmUsage,residentSet);
+
+    Check(monitoredBudget->GetBudget()==0,"Budget not shrunk on memory pressure");
+    Check(monitored.GetMemoryLimit()<=1,"Consumer limit not shrunk on memory pressure");
+
+    monitor.SetMemoryBudget(nullptr,0);
+  }
+
+  monitoredBudget->SetBudget(100000);
+
+  {
+    osmscout::MemoryMonitor monitor;
+
+    monitor.SetMemoryBudget(monitoredBudget,std::numeric_limits<size_t>::max()/2);
+    monitoredBudget->SetBudget(1000);
+    monitor.GetMaxValue(vmUsage,residentSet);
+
+    Check(monitoredBudget->GetBudget()==100000,"Budget not grown back without memory pressure");
+
+    monitor.SetMemoryBudget(nullptr,0);
+  }
+#endif
+
+  if (errors!=0) {
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
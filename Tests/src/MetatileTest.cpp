@@ -0,0 +1,123 @@
+#include <map>
+
+#include <osmscout/Metatile.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+TEST_CASE("Metatiles are aligned and cover every tile exactly once") {
+  osmscout::Magnification magnification(osmscout::MagnificationLevel(10));
+  osmscout::OSMTileIdBox  tiles(osmscout::OSMTileId(529,339),
+                                osmscout::OSMTileId(541,350));
+
+  std::list<osmscout::Metatile> metatiles=osmscout::Metatile::GetMetatiles(magnification,
+                                                                           tiles,
+                                                                           8,
+                                                                           1,
+                                                                           256,
+                                                                           256);
+  std::map<std::pair<uint32_t,uint32_t>,size_t> coverage;
+
+  for (const auto& metatile : metatiles) {
+    REQUIRE(metatile.GetTiles().GetWidth()==8);
+    REQUIRE(metatile.GetTiles().GetHeight()==8);
+
+    for (const auto& tile : metatile.GetTiles()) {
+      osmscout::OSMTileIdBox box=osmscout::Metatile::GetMetatileBox(magnification,tile,8);
+
+      REQUIRE(box.GetMinX()%8==0);
+      REQUIRE(box.GetMinY()%8==0);
+      REQUIRE(metatile.GetTiles().GetMin()==box.GetMin());
+      REQUIRE(metatile.GetTiles().GetMax()==box.GetMax());
+
+      if (tiles.Includes(tile)) {
+        coverage[std::make_pair(tile.GetX(),tile.GetY())]++;
+      }
+    }
+  }
+
+  REQUIRE(coverage.size()==tiles.GetCount());
+
+  for (const auto& tile : tiles) {
+    REQUIRE(coverage[std::make_pair(tile.GetX(),tile.GetY())]==1);
+  }
+}
+
+TEST_CASE("Metatiles do not depend on the requested tiles") {
+  osmscout::Magnification magnification(osmscout::MagnificationLevel(10));
+
+  std::list<osmscout::Metatile> metatiles=osmscout::Metatile::GetMetatiles(magnification,
+                                                                           osmscout::OSMTileIdBox(osmscout::OSMTileId(530,340),
+                                                                                                  osmscout::OSMTileId(531,341)),
+                                                                           8,
+                                                                           0,
+                                                                           256,
+                                                                           256);
+
+  REQUIRE(metatiles.size()==1);
+  REQUIRE(metatiles.front().GetTiles().GetMinX()==528);
+  REQUIRE(metatiles.front().GetTiles().GetMinY()==336);
+  REQUIRE(metatiles.front().GetTiles().GetMaxX()==535);
+  REQUIRE(metatiles.front().GetTiles().GetMaxY()==343);
+  REQUIRE(metatiles.front().GetCanvasWidth()==8*256);
+  REQUIRE(metatiles.front().GetCanvasHeight()==8*256);
+}
+
+TEST_CASE("Metatile margin is clipped at the border of the world") {
+  osmscout::Magnification magnification(osmscout::MagnificationLevel(2));
+  osmscout::Metatile      metatile(magnification,
+                                   osmscout::OSMTileIdBox(osmscout::OSMTileId(0,0),
+                                                          osmscout::OSMTileId(1,1)),
+                                   2,
+                                   256,
+                                   256);
+
+  REQUIRE(metatile.GetRenderTiles().GetMinX()==0);
+  REQUIRE(metatile.GetRenderTiles().GetMinY()==0);
+  REQUIRE(metatile.GetRenderTiles().GetMaxX()==3);
+  REQUIRE(metatile.GetRenderTiles().GetMaxY()==3);
+  REQUIRE(metatile.GetCanvasWidth()==4*256);
+  REQUIRE(metatile.GetCanvasHeight()==4*256);
+
+  osmscout::OSMTileIdBox box=osmscout::Metatile::GetMetatileBox(magnification,
+                                                                osmscout::OSMTileId(3,3),
+                                                                8);
+
+  REQUIRE(box.GetMinX()==0);
+  REQUIRE(box.GetMaxX()==3);
+  REQUIRE(box.GetMaxY()==3);
+}
+
+TEST_CASE("Tile offsets match the projection of the metatile") {
+  osmscout::Magnification  magnification(osmscout::MagnificationLevel(14));
+  osmscout::Metatile       metatile(magnification,
+                                    osmscout::OSMTileIdBox(osmscout::OSMTileId(8520,5480),
+                                                           osmscout::OSMTileId(8523,5483)),
+                                    1,
+                                    256,
+                                    256);
+  osmscout::TileProjection projection;
+
+  REQUIRE(metatile.GetProjection(projection,96.0));
+  REQUIRE(projection.GetWidth()==metatile.GetCanvasWidth());
+  REQUIRE(projection.GetHeight()==metatile.GetCanvasHeight());
+
+  for (const auto& tile : metatile.GetTiles()) {
+    size_t x;
+    size_t y;
+    double pixelX;
+    double pixelY;
+
+    metatile.GetTileOffset(tile,x,y);
+
+    REQUIRE(x>=256);
+    REQUIRE(y>=256);
+
+    REQUIRE(projection.GeoToPixel(tile.GetTopLeftCoord(magnification),
+                                  pixelX,
+                                  pixelY));
+
+    REQUIRE(pixelX==Approx(x).margin(0.5));
+    REQUIRE(pixelY==Approx(y).margin(0.5));
+  }
+}
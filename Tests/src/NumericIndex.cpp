@@ -0,0 +1,235 @@
+/*
+  NumericIndex - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <osmscout/NumericIndex.h>
+#include <osmscout/TypeConfig.h>
+
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/MemoryBudget.h>
+#include <osmscout/util/SharedMemoryCache.h>
+
+#include <osmscout/import/GenNumericIndex.h>
+
+static const uint32_t dataCount=20000;
+
+/**
+ * Minimal data object, just an id
+ */
+struct Data
+{
+  osmscout::Id id;
+
+  osmscout::Id GetId() const
+  {
+    return id;
+  }
+
+  void Read(const osmscout::TypeConfig& /*typeConfig*/,
+            osmscout::FileScanner& scanner)
+  {
+    scanner.ReadNumber(id);
+  }
+};
+
+static bool WriteData(std::vector<osmscout::Id>& ids,
+                      std::vector<osmscout::FileOffset>& offsets)
+{
+  try {
+    osmscout::FileWriter writer;
+
+    writer.Open("numeric.dat");
+    writer.Write(dataCount);
+
+    for (uint32_t i=0; i<dataCount; i++) {
+      osmscout::Id id=10+i*8+(i%7);
+
+      ids.push_back(id);
+      offsets.push_back(writer.GetPos());
+
+      writer.WriteNumber(id);
+    }
+
+    writer.Close();
+  }
+  catch (osmscout::IOException& e) {
+    std::cerr << "Error while writing data: " << e.GetDescription() << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+static size_t CheckIndex(const std::vector<osmscout::Id>& ids,
+                         const std::vector<osmscout::FileOffset>& offsets,
+                         size_t cacheSize,
+                         const osmscout::SharedMemoryCacheRef& sharedCache=nullptr,
+                         size_t memoryLimit=0,
+                         size_t cacheShardCount=8,
+                         const osmscout::MemoryBudgetRef& budget=nullptr)
+{
+  osmscout::NumericIndex<osmscout::Id> index("numeric.idx",
+                                             cacheSize,
+                                             cacheShardCount);
+
+  index.SetSharedCache(sharedCache);
+  index.SetMemoryLimit(memoryLimit);
+
+  if (!index.Open(".",false)) {
+    std::cerr << "Cannot open index" << std::endl;
+    return 1;
+  }
+
+  if (budget) {
+    budget->Register(index);
+  }
+
+  std::atomic<size_t>      errors(0);
+  std::vector<std::thread> threads;
+
+  for (size_t t=0; t<4; t++) {
+    threads.push_back(std::thread([&ids,&offsets,&index,&errors,t]() {
+      for (size_t i=t; i<ids.size(); i+=4) {
+        osmscout::FileOffset offset;
+
+        if (!index.GetOffset(ids[i],offset) ||
+            offset!=offsets[i]) {
+          errors++;
+        }
+
+        // Ids between two existing ids and before the first id must not be found
+        if (index.GetOffset(ids[i]-1,offset)) {
+          errors++;
+        }
+      }
+    }));
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  osmscout::FileOffset offset;
+
+  if (index.GetOffset(ids.back()+1,offset)) {
+    errors++;
+  }
+
+  if (budget) {
+    if (index.GetMemoryUsage()>budget->GetBudget()) {
+      std::cerr << "Index uses " << index.GetMemoryUsage() << " bytes, but budget is " << budget->GetBudget() << std::endl;
+      errors++;
+    }
+
+    budget->Unregister(index);
+  }
+
+  index.Close();
+
+  std::cout << "Cache size " << cacheSize << ", memory limit " << memoryLimit << ", shards " << cacheShardCount << ": " << errors << " error(s)" << std::endl;
+
+  return errors;
+}
+
+int main()
+{
+  std::vector<osmscout::Id>         ids;
+  std::vector<osmscout::FileOffset> offsets;
+
+  if (!WriteData(ids,offsets)) {
+    return 1;
+  }
+
+  osmscout::ImportParameter                          parameter;
+  osmscout::SilentProgress                           progress;
+  osmscout::NumericIndexGenerator<osmscout::Id,Data> generator("Generating index",
+                                                               "numeric.dat",
+                                                               "numeric.idx");
+
+  parameter.SetDestinationDirectory(".");
+  // Small pages result in a deep index
+  parameter.SetNumericIndexPageSize(64);
+
+  if (!generator.Import(std::make_shared<osmscout::TypeConfig>(),
+                        parameter,
+                        progress)) {
+    std::cerr << "Cannot generate index" << std::endl;
+    return 1;
+  }
+
+  size_t errors=0;
+
+  // Only the root level, some upper levels, the complete index
+  for (size_t cacheSize : {0,10,200,100000}) {
+    errors+=CheckIndex(ids,offsets,cacheSize);
+  }
+
+  // Lower level pages limited by memory instead of page count
+  errors+=CheckIndex(ids,offsets,10,nullptr,4096);
+
+  // One shard per level, all lookups of a level share one mutex
+  errors+=CheckIndex(ids,offsets,200,nullptr,0,1);
+
+  // Lower level pages limited by a memory budget
+  errors+=CheckIndex(ids,offsets,10,nullptr,0,8,std::make_shared<osmscout::MemoryBudget>(64*1024));
+
+  // The second index gets its pages from the shared cache filled by the first one
+  if (osmscout::SharedMemoryCache::IsSupported()) {
+    std::string                    name="osmscout-numericindex-test";
+    osmscout::SharedMemoryCacheRef sharedCache=std::make_shared<osmscout::SharedMemoryCache>();
+
+    osmscout::SharedMemoryCache::Remove(name);
+
+    if (!sharedCache->Open(name,4*1024*1024,4096)) {
+      std::cerr << "Cannot open shared cache" << std::endl;
+      return 1;
+    }
+
+    osmscout::SharedMemoryCache::Remove(name);
+
+    errors+=CheckIndex(ids,offsets,0,sharedCache);
+    errors+=CheckIndex(ids,offsets,0,sharedCache);
+
+    size_t hits;
+    size_t misses;
+
+    sharedCache->GetStatistics(hits,misses);
+
+    std::cout << "Shared cache: " << hits << " hits, " << misses << " misses" << std::endl;
+
+    if (hits==0) {
+      std::cerr << "Shared cache was not used" << std::endl;
+      errors++;
+    }
+  }
+
+  if (errors!=0) {
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
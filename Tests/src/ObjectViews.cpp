@@ -0,0 +1,182 @@
+#include <vector>
+
+#include <osmscout/WayDataFile.h>
+
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace {
+
+  struct TestData
+  {
+    osmscout::TypeConfigRef           typeConfig;
+    std::vector<osmscout::Way>        ways;
+    std::vector<osmscout::FileOffset> wayOffsets;
+  };
+
+  std::vector<osmscout::Point> CreateNodes(size_t count,
+                                           double lat,
+                                           double lon,
+                                           bool withSerials)
+  {
+    std::vector<osmscout::Point> nodes;
+
+    for (size_t i=0; i<count; i++) {
+      nodes.push_back(osmscout::Point(withSerials && i%3==0 ? (uint8_t)(i/3+1) : 0,
+                                      osmscout::GeoCoord(lat+0.0001*i*i,
+                                                         lon-0.0003*i)));
+    }
+
+    return nodes;
+  }
+
+  /**
+   * Write some ways to "ways.dat" and read them back as Way objects, which are
+   * used as the reference for the views.
+   */
+  TestData WriteData()
+  {
+    TestData              data;
+    osmscout::TypeInfoRef wayType=std::make_shared<osmscout::TypeInfo>("test_way");
+
+    wayType->CanBeWay(true);
+    wayType->CanRouteCar(true);
+
+    data.typeConfig=std::make_shared<osmscout::TypeConfig>();
+    data.typeConfig->RegisterType(wayType);
+
+    osmscout::FileWriter writer;
+
+    writer.Open(osmscout::WayDataFile::WAYS_DAT);
+
+    for (size_t i=0; i<5; i++) {
+      osmscout::Way way;
+
+      way.SetType(wayType);
+      way.nodes=CreateNodes(2+i*7,50.0+i*0.01,8.0+i*0.02,true);
+
+      data.wayOffsets.push_back(writer.GetPos());
+      way.Write(*data.typeConfig,writer);
+    }
+
+    writer.Close();
+
+    osmscout::FileScanner scanner;
+
+    scanner.Open(osmscout::WayDataFile::WAYS_DAT,osmscout::FileScanner::Normal,false);
+
+    for (const auto offset : data.wayOffsets) {
+      osmscout::Way way;
+
+      scanner.SetPos(offset);
+      way.Read(*data.typeConfig,scanner);
+      data.ways.push_back(way);
+    }
+
+    scanner.Close();
+
+    return data;
+  }
+
+  bool Equals(const osmscout::PointsView& view,
+              const std::vector<osmscout::Point>& nodes)
+  {
+    if (view.size()!=nodes.size()) {
+      return false;
+    }
+
+    size_t i=0;
+
+    for (const auto& point : view) {
+      if (point.GetSerial()!=nodes[i].GetSerial() ||
+          point.GetCoord()!=nodes[i].GetCoord()) {
+        return false;
+      }
+
+      i++;
+    }
+
+    return true;
+  }
+
+  void CheckWayView(const TestData& data,
+                    const osmscout::WayView& view,
+                    size_t index)
+  {
+    const osmscout::Way& way=data.ways[index];
+
+    REQUIRE(view.GetFileOffset()==data.wayOffsets[index]);
+    REQUIRE(view.GetNextFileOffset()==way.GetNextFileOffset());
+    REQUIRE(view.GetObjectFileRef()==way.GetObjectFileRef());
+    REQUIRE(view.GetType()==way.GetType());
+    REQUIRE(Equals(view.GetNodes(),way.nodes));
+  }
+
+}
+
+TEST_CASE("WayView matches the decoded ways") {
+  TestData data=WriteData();
+
+  for (bool memoryMapped : {false,true}) {
+    osmscout::FileScanner scanner;
+    osmscout::WayView     view;
+
+    scanner.Open(osmscout::WayDataFile::WAYS_DAT,osmscout::FileScanner::Normal,memoryMapped);
+
+    // Backwards, so a long way is followed by a shorter one reusing the view
+    for (size_t i=data.wayOffsets.size(); i>0; i--) {
+      scanner.SetPos(data.wayOffsets[i-1]);
+      view.Read(*data.typeConfig,scanner);
+
+      CheckWayView(data,view,i-1);
+      REQUIRE(view.GetNodes().IsMemoryMapped()==memoryMapped);
+    }
+
+    scanner.Close();
+  }
+}
+
+TEST_CASE("VisitByOffset visits all offsets in the given order") {
+  TestData data=WriteData();
+
+  for (bool memoryMapped : {false,true}) {
+    osmscout::WayDataFile             wayDataFile(10);
+    std::vector<osmscout::FileOffset> wayOffsets={data.wayOffsets[3],
+                                                  data.wayOffsets[0],
+                                                  data.wayOffsets[4],
+                                                  data.wayOffsets[0]};
+    std::vector<size_t>               wayIndexes={3,0,4,0};
+    size_t                            visited=0;
+
+    REQUIRE(wayDataFile.Open(data.typeConfig,".",memoryMapped));
+
+    REQUIRE(wayDataFile.VisitByOffset<osmscout::WayView>(wayOffsets.begin(),
+                                                         wayOffsets.end(),
+                                                         [&](const osmscout::WayView& view) {
+                                                           CheckWayView(data,view,wayIndexes[visited]);
+                                                           visited++;
+                                                         }));
+    REQUIRE(visited==wayOffsets.size());
+
+    // Nothing to visit
+    REQUIRE(wayDataFile.VisitByOffset<osmscout::WayView>(wayOffsets.end(),
+                                                         wayOffsets.end(),
+                                                         [&](const osmscout::WayView&) {
+                                                           visited++;
+                                                         }));
+    REQUIRE(visited==wayOffsets.size());
+
+    // The cache is neither queried nor filled
+    size_t hits;
+    size_t misses;
+
+    wayDataFile.GetCacheStatistics(hits,misses);
+
+    REQUIRE(hits+misses==0);
+
+    wayDataFile.Close();
+  }
+}
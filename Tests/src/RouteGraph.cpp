@@ -0,0 +1,185 @@
+/*
+  RouteGraph - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <iostream>
+#include <vector>
+
+#include <osmscout/routing/RouteGraph.h>
+
+static const size_t gridSize=10;
+
+static osmscout::Point GetPoint(size_t x,
+                                size_t y)
+{
+  return osmscout::Point(0,
+                         osmscout::GeoCoord(50.0+y*0.001,
+                                            7.0+x*0.001));
+}
+
+/**
+ * Grid of route nodes, each node has a path to its right and upper neighbour.
+ * The nodes in the last column have a path to a node, that is not part of the graph.
+ */
+static std::vector<osmscout::RouteNode> CreateNodes()
+{
+  std::vector<osmscout::RouteNode> nodes;
+
+  for (size_t y=0; y<gridSize; y++) {
+    for (size_t x=0; x<gridSize; x++) {
+      osmscout::RouteNode node;
+
+      node.Initialize(0,GetPoint(x,y));
+
+      // Not used by any path, so that path and object indexes differ
+      node.AddObject(osmscout::ObjectFileRef(2000+y*gridSize+x,osmscout::refWay),2);
+      node.AddObject(osmscout::ObjectFileRef(y+1,osmscout::refWay),0);
+      node.AddObject(osmscout::ObjectFileRef(1000+x,osmscout::refWay),1);
+
+      osmscout::RouteNode::Path right;
+
+      right.id=GetPoint(x+1,y).GetId();
+      right.distance=osmscout::Distance::Of<osmscout::Meter>(100.0+x);
+      right.objectIndex=1;
+      right.flags=osmscout::RouteNode::usableByCar;
+
+      node.paths.push_back(right);
+
+      if (y+1<gridSize) {
+        osmscout::RouteNode::Path up;
+
+        up.id=GetPoint(x,y+1).GetId();
+        up.distance=osmscout::Distance::Of<osmscout::Meter>(200.0+y);
+        up.objectIndex=2;
+        up.flags=osmscout::RouteNode::usableByFoot | osmscout::RouteNode::restrictedForCar;
+
+        node.paths.push_back(up);
+      }
+
+      osmscout::RouteNode::Exclude exclude;
+
+      exclude.source=osmscout::ObjectFileRef(1000+x,osmscout::refWay);
+      exclude.targetIndex=0;
+
+      node.excludes.push_back(exclude);
+
+      // Target index of a path that does not exist
+      exclude.targetIndex=2;
+
+      node.excludes.push_back(exclude);
+
+      nodes.push_back(node);
+    }
+  }
+
+  return nodes;
+}
+
+int main()
+{
+  std::vector<osmscout::RouteNode> nodes=CreateNodes();
+  osmscout::RouteGraph             graph;
+  size_t                           errors=0;
+
+  // Add in reverse order, so that node index and id order differ
+  for (auto node=nodes.rbegin(); node!=nodes.rend(); ++node) {
+    graph.AddNode(*node);
+  }
+
+  graph.Finish();
+
+  if (graph.GetNodeCount()!=nodes.size()) {
+    std::cerr << "Node count " << graph.GetNodeCount() << " != " << nodes.size() << std::endl;
+    errors++;
+  }
+
+  if (graph.GetNodeIndex(GetPoint(gridSize+5,0).GetId())!=osmscout::RouteGraph::invalidIndex) {
+    std::cerr << "Found node that is not part of the graph" << std::endl;
+    errors++;
+  }
+
+  for (const auto& node : nodes) {
+    uint32_t index=graph.GetNodeIndex(node.GetId());
+
+    if (index==osmscout::RouteGraph::invalidIndex ||
+        graph.GetNodeId(index)!=node.GetId()) {
+      std::cerr << "Cannot find node " << node.GetId() << std::endl;
+      errors++;
+      continue;
+    }
+
+    if (graph.GetNodeCoord(index).GetLat()!=node.GetCoord().GetLat() ||
+        graph.GetNodeCoord(index).GetLon()!=node.GetCoord().GetLon()) {
+      std::cerr << "Wrong coordinate for node " << node.GetId() << std::endl;
+      errors++;
+    }
+
+    if (graph.GetPathEnd(index)-graph.GetPathBegin(index)!=node.paths.size()) {
+      std::cerr << "Wrong path count for node " << node.GetId() << std::endl;
+      errors++;
+      continue;
+    }
+
+    for (size_t i=0; i<node.paths.size(); i++) {
+      uint32_t path=graph.GetPathBegin(index)+(uint32_t)i;
+      uint32_t target=graph.GetPathTarget(path);
+
+      if (target==osmscout::RouteGraph::invalidIndex) {
+        if (graph.GetNodeIndex(node.paths[i].id)!=osmscout::RouteGraph::invalidIndex) {
+          std::cerr << "Unresolved path target " << node.paths[i].id << std::endl;
+          errors++;
+        }
+      }
+      else if (graph.GetNodeId(target)!=node.paths[i].id) {
+        std::cerr << "Wrong path target " << graph.GetNodeId(target) << " != " << node.paths[i].id << std::endl;
+        errors++;
+      }
+
+      if (graph.GetPathDistance(path).AsMeter()!=node.paths[i].distance.AsMeter() ||
+          !(graph.GetPathObject(index,path)==node.objects[node.paths[i].objectIndex].object) ||
+          graph.IsPathRestricted(path,osmscout::vehicleCar)!=node.paths[i].IsRestricted(osmscout::vehicleCar)) {
+        std::cerr << "Wrong path attributes for node " << node.GetId() << std::endl;
+        errors++;
+      }
+    }
+
+    // Only the exclude with a valid target index is kept
+    if (graph.GetExcludeEnd(index)-graph.GetExcludeBegin(index)!=1) {
+      std::cerr << "Wrong exclude count for node " << node.GetId() << std::endl;
+      errors++;
+      continue;
+    }
+
+    uint32_t exclude=graph.GetExcludeBegin(index);
+
+    if (!(graph.GetExcludeSource(exclude)==node.excludes[0].source) ||
+        !(graph.GetExcludeTarget(index,exclude)==node.objects[node.paths[0].objectIndex].object)) {
+      std::cerr << "Wrong exclude for node " << node.GetId() << std::endl;
+      errors++;
+    }
+  }
+
+  if (errors!=0) {
+    std::cerr << errors << " errors" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
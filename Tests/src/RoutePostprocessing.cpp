@@ -0,0 +1,190 @@
+/*
+  RoutePostprocessing - a test program for libosmscout
+  Copyright (C) 2026  agent
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/routing/RoutePostprocessor.h>
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <RoutingGrid.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace {
+
+  const std::string databaseDir="RoutePostprocessing.db";
+
+  /**
+   * Wraps a postprocessor, so that it is not executed concurrently with others
+   */
+  class SerialPostprocessor : public osmscout::RoutePostprocessor::Postprocessor
+  {
+  private:
+    osmscout::RoutePostprocessor::PostprocessorRef postprocessor;
+
+  public:
+    explicit SerialPostprocessor(const osmscout::RoutePostprocessor::PostprocessorRef& postprocessor)
+    : postprocessor(postprocessor)
+    {
+      // no code
+    }
+
+    bool Process(const osmscout::RoutePostprocessor& routePostprocessor,
+                 osmscout::RouteDescription& description) override
+    {
+      return postprocessor->Process(routePostprocessor,description);
+    }
+  };
+
+  std::list<osmscout::RoutePostprocessor::PostprocessorRef> GetPostprocessors()
+  {
+    return std::list<osmscout::RoutePostprocessor::PostprocessorRef>{
+      std::make_shared<osmscout::RoutePostprocessor::DistanceAndTimePostprocessor>(),
+      std::make_shared<osmscout::RoutePostprocessor::StartPostprocessor>("Start"),
+      std::make_shared<osmscout::RoutePostprocessor::TargetPostprocessor>("Target"),
+      std::make_shared<osmscout::RoutePostprocessor::WayNamePostprocessor>(),
+      std::make_shared<osmscout::RoutePostprocessor::WayTypePostprocessor>(),
+      std::make_shared<osmscout::RoutePostprocessor::CrossingWaysPostprocessor>(),
+      std::make_shared<osmscout::RoutePostprocessor::DirectionPostprocessor>(),
+      std::make_shared<osmscout::RoutePostprocessor::MotorwayJunctionPostprocessor>(),
+      std::make_shared<osmscout::RoutePostprocessor::DestinationPostprocessor>(),
+      std::make_shared<osmscout::RoutePostprocessor::MaxSpeedPostprocessor>(),
+      std::make_shared<osmscout::RoutePostprocessor::InstructionPostprocessor>(),
+      std::make_shared<osmscout::RoutePostprocessor::POIsPostprocessor>()
+    };
+  }
+
+  /**
+   * The descriptions of all nodes of the route, in the order they were added
+   */
+  std::vector<std::vector<std::string>> GetDescriptions(const osmscout::RouteDescription& description)
+  {
+    std::vector<std::vector<std::string>> descriptions;
+
+    for (const auto& node : description.Nodes()) {
+      descriptions.push_back(std::vector<std::string>());
+
+      for (const auto& nodeDescription : node.GetDescriptions()) {
+        descriptions.back().push_back(nodeDescription->GetDebugString());
+      }
+    }
+
+    return descriptions;
+  }
+}
+
+TEST_CASE("Concurrent postprocessing matches sequential postprocessing") {
+  osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir);
+
+  REQUIRE(database);
+
+  osmscout::SimpleRoutingService                            router(database,
+                                                                   osmscout::RouterParameter(),
+                                                                   osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  std::shared_ptr<osmscout::ShortestPathRoutingProfile>     profile=std::make_shared<osmscout::ShortestPathRoutingProfile>(database->GetTypeConfig());
+  std::vector<osmscout::RoutingProfileRef>                  profiles={profile};
+  std::vector<osmscout::DatabaseRef>                        databases={database};
+  std::list<osmscout::RoutePostprocessor::PostprocessorRef> serialPostprocessors;
+  osmscout::RoutePostprocessor                              postprocessor;
+  std::set<std::string>                                     junctionTypeNames={"highway_motorway_junction"};
+  size_t                                                    junctionCount=0;
+
+  REQUIRE(router.Open());
+
+  profile->ParametrizeForCar(*database->GetTypeConfig(),
+                             std::map<std::string,double>{{"highway_primary",50.0},
+                                                          {"highway_residential",30.0}},
+                             100.0);
+
+  for (const auto& processor : GetPostprocessors()) {
+    serialPostprocessors.push_back(std::make_shared<SerialPostprocessor>(processor));
+  }
+
+  // The same postprocessor is used for several routes, so its workers are reused
+  for (const auto& route : {std::make_pair(std::make_pair(0,0),std::make_pair(9,9)),
+                            std::make_pair(std::make_pair(8,1),std::make_pair(1,7)),
+                            std::make_pair(std::make_pair(4,9),std::make_pair(5,0))}) {
+    osmscout::RoutePosition start=router.GetClosestRoutableNode(GetRoutingGridCoord(route.first.first,route.first.second),
+                                                                *profile,
+                                                                osmscout::Distance::Of<osmscout::Meter>(50.0));
+    osmscout::RoutePosition target=router.GetClosestRoutableNode(GetRoutingGridCoord(route.second.first,route.second.second),
+                                                                 *profile,
+                                                                 osmscout::Distance::Of<osmscout::Meter>(50.0));
+
+    REQUIRE(start.IsValid());
+    REQUIRE(target.IsValid());
+
+    osmscout::RoutingResult result=router.CalculateRoute(*profile,
+                                                         start,
+                                                         target,
+                                                         osmscout::RoutingParameter());
+
+    REQUIRE(result.Success());
+
+    osmscout::RouteDescription concurrentDescription;
+    osmscout::RouteDescription serialDescription;
+
+    REQUIRE(router.TransformRouteDataToRouteDescription(result.GetRoute(),
+                                                        concurrentDescription));
+    REQUIRE(router.TransformRouteDataToRouteDescription(result.GetRoute(),
+                                                        serialDescription));
+
+    // Only the concurrent run prefetches the junctions, the wrapped
+    // MotorwayJunctionPostprocessor of the serial run loads them on demand
+    REQUIRE(postprocessor.PostprocessRouteDescription(concurrentDescription,
+                                                      profiles,
+                                                      databases,
+                                                      GetPostprocessors(),
+                                                      std::set<std::string>(),
+                                                      std::set<std::string>(),
+                                                      junctionTypeNames));
+    REQUIRE(postprocessor.PostprocessRouteDescription(serialDescription,
+                                                      profiles,
+                                                      databases,
+                                                      serialPostprocessors,
+                                                      std::set<std::string>(),
+                                                      std::set<std::string>(),
+                                                      junctionTypeNames));
+
+    std::vector<std::vector<std::string>> concurrentDescriptions=GetDescriptions(concurrentDescription);
+    std::vector<std::vector<std::string>> serialDescriptions=GetDescriptions(serialDescription);
+
+    REQUIRE(concurrentDescriptions.size()>1);
+    REQUIRE(concurrentDescriptions.front().size()>1);
+    REQUIRE(concurrentDescriptions==serialDescriptions);
+
+    for (const auto& node : concurrentDescription.Nodes()) {
+      if (node.HasDescription(osmscout::RouteDescription::MOTORWAY_JUNCTION_DESC)) {
+        junctionCount++;
+      }
+    }
+  }
+
+  REQUIRE(junctionCount>0);
+
+  router.Close();
+  database->Close();
+}
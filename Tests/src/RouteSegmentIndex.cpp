@@ -0,0 +1,232 @@
+/*
+  RouteSegmentIndex - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <osmscout/TypeFeatures.h>
+
+#include <osmscout/routing/RouteSegmentIndex.h>
+
+#include <osmscout/util/Progress.h>
+
+#include <osmscout/import/GenRouteSegmentIndex.h>
+
+static const size_t segmentCount=5000;
+
+/**
+ * Round the coordinate to the resolution of the data files, so that the
+ * segments compared against are equal to the segments stored in the index
+ */
+static osmscout::GeoCoord RoundCoord(const osmscout::GeoCoord& coord)
+{
+  unsigned char      buffer[osmscout::coordByteSize];
+  osmscout::GeoCoord result;
+
+  coord.EncodeToBuffer(buffer);
+  result.DecodeFromBuffer(buffer);
+
+  return result;
+}
+
+/**
+ * Random short segments with random access in a small area
+ */
+static std::vector<osmscout::RouteSegment> CreateSegments()
+{
+  std::mt19937                           random(42);
+  std::uniform_real_distribution<double> lat(50.0,50.1);
+  std::uniform_real_distribution<double> lon(8.0,8.15);
+  std::uniform_real_distribution<double> offset(-0.002,0.002);
+  std::vector<osmscout::RouteSegment>    segments;
+  const uint8_t                          accesses[]={
+    osmscout::AccessFeatureValue::footForward|osmscout::AccessFeatureValue::footBackward,
+    osmscout::AccessFeatureValue::carForward,
+    osmscout::AccessFeatureValue::footForward|osmscout::AccessFeatureValue::footBackward|
+    osmscout::AccessFeatureValue::bicycleForward|osmscout::AccessFeatureValue::bicycleBackward|
+    osmscout::AccessFeatureValue::carForward|osmscout::AccessFeatureValue::carBackward
+  };
+
+  for (size_t i=0; i<segmentCount; i++) {
+    osmscout::RouteSegment segment;
+    osmscout::GeoCoord     from(lat(random),lon(random));
+
+    segment.from=RoundCoord(from);
+    segment.to=RoundCoord(osmscout::GeoCoord(from.GetLat()+offset(random),
+                                             from.GetLon()+offset(random)));
+    segment.way=i+1;
+    segment.nodeIndex=(uint32_t)i;
+    segment.typeIndex=(uint16_t)(i%10);
+    segment.access=accesses[random()%3];
+
+    segments.push_back(segment);
+  }
+
+  return segments;
+}
+
+/**
+ * Return the closest segments by evaluating all segments
+ */
+static std::vector<osmscout::RouteSegmentMatch> GetClosestSegments(const std::vector<osmscout::RouteSegment>& segments,
+                                                                   const osmscout::GeoCoord& coord,
+                                                                   osmscout::Vehicle vehicle,
+                                                                   const osmscout::Distance& maxDistance,
+                                                                   size_t maxCount,
+                                                                   const osmscout::RouteSegmentIndex::SegmentFilter& filter)
+{
+  std::vector<osmscout::RouteSegmentMatch> matches;
+
+  for (const auto& segment : segments) {
+    if (!osmscout::AccessFeatureValue(segment.access).CanRoute(vehicle) ||
+        (filter && !filter(segment))) {
+      continue;
+    }
+
+    osmscout::RouteSegmentMatch match;
+
+    osmscout::RouteSegmentIndex::Project(coord,
+                                         segment,
+                                         match);
+
+    if (match.distance<=maxDistance) {
+      matches.push_back(match);
+    }
+  }
+
+  std::sort(matches.begin(),
+            matches.end(),
+            [](const osmscout::RouteSegmentMatch& a,
+               const osmscout::RouteSegmentMatch& b) {
+    return a.distance<b.distance;
+  });
+
+  if (matches.size()>maxCount) {
+    matches.resize(maxCount);
+  }
+
+  return matches;
+}
+
+int main()
+{
+  osmscout::SilentProgress            progress;
+  std::vector<osmscout::RouteSegment> segments=CreateSegments();
+  std::string                         filename="RouteSegmentIndex.idx";
+  size_t                              errors=0;
+
+  if (!osmscout::RouteSegmentIndexGenerator::WriteIndex(filename,
+                                                        osmscout::vehicleFoot|osmscout::vehicleCar,
+                                                        segments,
+                                                        progress)) {
+    std::cerr << "Cannot write index" << std::endl;
+    return 1;
+  }
+
+  osmscout::RouteSegmentIndex index;
+
+  if (!index.Open(filename,
+                  false)) {
+    std::cerr << "Cannot open index" << std::endl;
+    return 1;
+  }
+
+  if (index.GetSegmentCount()!=segmentCount) {
+    std::cerr << "Segment count " << index.GetSegmentCount() << " != " << segmentCount << std::endl;
+    errors++;
+  }
+
+  if (!index.SupportsVehicle(osmscout::vehicleCar) ||
+      index.SupportsVehicle(osmscout::vehicleBicycle)) {
+    std::cerr << "Vehicle mask not stored" << std::endl;
+    errors++;
+  }
+
+  std::mt19937                               random(4711);
+  std::uniform_real_distribution<double>     lat(49.99,50.11);
+  std::uniform_real_distribution<double>     lon(7.99,8.16);
+  osmscout::RouteSegmentIndex::SegmentFilter evenTypes=[](const osmscout::RouteSegment& segment) {
+    return segment.typeIndex%2==0;
+  };
+
+  for (size_t i=0; i<300; i++) {
+    osmscout::GeoCoord                         coord(lat(random),lon(random));
+    osmscout::Vehicle                          vehicle=i%2==0 ? osmscout::vehicleFoot : osmscout::vehicleCar;
+    osmscout::Distance                         maxDistance=osmscout::Distance::Of<osmscout::Meter>(50.0+(i%4)*100.0);
+    size_t                                     maxCount=1+i%8;
+    osmscout::RouteSegmentIndex::SegmentFilter filter=i%3==0 ? evenTypes : nullptr;
+    std::vector<osmscout::RouteSegmentMatch>   matches;
+
+    if (!index.GetClosestSegments(coord,
+                                  vehicle,
+                                  maxDistance,
+                                  maxCount,
+                                  filter,
+                                  matches)) {
+      std::cerr << "Error reading index" << std::endl;
+      errors++;
+      continue;
+    }
+
+    std::vector<osmscout::RouteSegmentMatch> expected=GetClosestSegments(segments,
+                                                                         coord,
+                                                                         vehicle,
+                                                                         maxDistance,
+                                                                         maxCount,
+                                                                         filter);
+
+    if (matches.size()!=expected.size()) {
+      std::cerr << "Query " << i << ": " << matches.size() << " match(es) != " << expected.size() << std::endl;
+      errors++;
+      continue;
+    }
+
+    for (size_t m=0; m<matches.size(); m++) {
+      if (std::fabs(matches[m].distance.AsMeter()-expected[m].distance.AsMeter())>1e-6) {
+        std::cerr << "Query " << i << ": distance " << matches[m].distance.AsMeter() << " != " << expected[m].distance.AsMeter() << std::endl;
+        errors++;
+        break;
+      }
+
+      if (!osmscout::AccessFeatureValue(matches[m].segment.access).CanRoute(vehicle) ||
+          (filter && !filter(matches[m].segment))) {
+        std::cerr << "Query " << i << ": segment of way " << matches[m].segment.way << " not usable" << std::endl;
+        errors++;
+        break;
+      }
+    }
+  }
+
+  index.Close();
+
+  std::remove(filename.c_str());
+
+  if (errors!=0) {
+    std::cerr << errors << " errors" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+/*
+  RoutingMatrix - a test program for libosmscout
+  Copyright (C) 2026  agent
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <map>
+#include <vector>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <RoutingGrid.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace {
+
+  const std::string databaseDir="RoutingMatrix.db";
+
+}
+
+TEST_CASE("Matrix cells match the single routes") {
+  osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir);
+
+  REQUIRE(database);
+
+  osmscout::SimpleRoutingService         router(database,
+                                                osmscout::RouterParameter(),
+                                                osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::ShortestPathRoutingProfile   profile(database->GetTypeConfig());
+  osmscout::RoutingParameter             parameter;
+  std::vector<osmscout::RoutePosition>   sources;
+  std::vector<osmscout::RoutePosition>   targets;
+
+  REQUIRE(router.Open());
+
+  profile.ParametrizeForCar(*database->GetTypeConfig(),
+                            std::map<std::string,double>{{"highway_primary",50.0},
+                                                         {"highway_residential",30.0}},
+                            100.0);
+
+  for (const auto& node : {std::make_pair(0,0),
+                           std::make_pair(9,9),
+                           std::make_pair(3,7)}) {
+    sources.push_back(router.GetClosestRoutableNode(GetRoutingGridCoord(node.first,node.second),
+                                                    profile,
+                                                    osmscout::Distance::Of<osmscout::Meter>(50.0)));
+    REQUIRE(sources.back().IsValid());
+  }
+
+  for (const auto& node : {std::make_pair(9,0),
+                           std::make_pair(0,9),
+                           std::make_pair(5,5),
+                           std::make_pair(3,7)}) {
+    targets.push_back(router.GetClosestRoutableNode(GetRoutingGridCoord(node.first,node.second),
+                                                    profile,
+                                                    osmscout::Distance::Of<osmscout::Meter>(50.0)));
+    REQUIRE(targets.back().IsValid());
+  }
+
+  for (size_t threadCount : {1,4}) {
+    parameter.SetThreadCount(threadCount);
+
+    osmscout::RoutingMatrix matrix=router.CalculateMatrix(profile,
+                                                          sources,
+                                                          targets,
+                                                          parameter);
+
+    REQUIRE(matrix.GetSourceCount()==sources.size());
+    REQUIRE(matrix.GetTargetCount()==targets.size());
+
+    for (size_t s=0; s<sources.size(); s++) {
+      for (size_t t=0; t<targets.size(); t++) {
+        INFO("Source " << s << ", target " << t);
+
+        REQUIRE(matrix.IsReachable(s,t));
+
+        if (sources[s].GetObjectFileRef()==targets[t].GetObjectFileRef() &&
+            sources[s].GetNodeIndex()==targets[t].GetNodeIndex()) {
+          REQUIRE(matrix.GetCosts(s,t)==Approx(0.0));
+          REQUIRE(matrix.GetTime(s,t)==Approx(0.0));
+          continue;
+        }
+
+        osmscout::RoutingResult route=router.CalculateRoute(profile,
+                                                            sources[s],
+                                                            targets[t],
+                                                            osmscout::RoutingParameter());
+
+        REQUIRE(route.Success());
+
+        double length;
+
+        REQUIRE(GetRouteLength(router,route.GetRoute(),length));
+
+        // For the shortest path the costs are the length of the route. The distances
+        // of the route nodes are stored with limited precision.
+        REQUIRE(matrix.GetCosts(s,t)==Approx(length).epsilon(0.001));
+        REQUIRE(matrix.GetDistance(s,t).As<osmscout::Kilometer>()==Approx(length).epsilon(0.001));
+        REQUIRE(matrix.GetTime(s,t)>=Approx(length/50.0).epsilon(0.001));
+        REQUIRE(matrix.GetTime(s,t)<=Approx(length/30.0).epsilon(0.001));
+      }
+    }
+  }
+
+  router.Close();
+  database->Close();
+}
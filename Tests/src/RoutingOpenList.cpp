@@ -0,0 +1,277 @@
+/*
+  RoutingOpenList - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <osmscout/routing/DBIdHashMap.h>
+#include <osmscout/routing/RoutingService.h>
+
+/**
+ * Make the protected routing types accessible
+ */
+struct RoutingTypes : public osmscout::RoutingService
+{
+  using osmscout::RoutingService::RNode;
+  using osmscout::RoutingService::RNodeRef;
+  using osmscout::RoutingService::RNodeCostCompare;
+  using osmscout::RoutingService::OpenList;
+  using osmscout::RoutingService::OpenMap;
+};
+
+typedef RoutingTypes::RNode    RNode;
+typedef RoutingTypes::RNodeRef RNodeRef;
+
+static size_t CheckHashMap()
+{
+  std::mt19937                       random(42);
+  std::map<osmscout::DBId,size_t>    expected;
+  osmscout::DBIdHashMap<size_t>      map;
+  size_t                             errors=0;
+
+  for (size_t i=0; i<100000; i++) {
+    // Small key range to get many collisions and erases
+    osmscout::DBId key((osmscout::DatabaseId)(random()%3),
+                       1+random()%5000);
+
+    if (random()%3==0) {
+      if (map.Erase(key)!=(expected.erase(key)>0)) {
+        std::cerr << "Erase of " << key << " returned wrong result" << std::endl;
+        errors++;
+      }
+    }
+    else {
+      map[key]=i;
+      expected[key]=i;
+    }
+  }
+
+  if (map.size()!=expected.size()) {
+    std::cerr << "Size " << map.size() << " != " << expected.size() << std::endl;
+    errors++;
+  }
+
+  for (const auto& entry : expected) {
+    const size_t* value=map.Find(entry.first);
+
+    if (value==nullptr ||
+        *value!=entry.second) {
+      std::cerr << "Wrong value for " << entry.first << std::endl;
+      errors++;
+    }
+  }
+
+  size_t iterated=0;
+
+  for (auto value=map.begin(); value!=map.end(); ++value) {
+    iterated++;
+  }
+
+  if (iterated!=expected.size()) {
+    std::cerr << "Iterated over " << iterated << " values instead of " << expected.size() << std::endl;
+    errors++;
+  }
+
+  if (map.Insert(expected.begin()->first,0) ||
+      *map.Find(expected.begin()->first)!=expected.begin()->second) {
+    std::cerr << "Insert replaced existing value" << std::endl;
+    errors++;
+  }
+
+  return errors;
+}
+
+static size_t CheckOpenList()
+{
+  std::mt19937                                        random(42);
+  std::uniform_real_distribution<double>              costs(0.0,1000.0);
+  RoutingTypes::OpenList                              openList;
+  RoutingTypes::OpenMap                               openMap;
+  std::set<RNodeRef,RoutingTypes::RNodeCostCompare>   expected;
+  size_t                                              errors=0;
+  osmscout::Id                                        nextId=1;
+
+  while (nextId<50000 || !expected.empty()) {
+    size_t operation=random()%4;
+
+    if (nextId<50000 && (operation<2 || expected.empty())) {
+      RNodeRef node=std::make_shared<RNode>(osmscout::DBId(1,nextId++),
+                                            nullptr,
+                                            osmscout::ObjectFileRef());
+
+      node->overallCost=costs(random);
+
+      openList.Push(node);
+      openMap[node->id]=node.get();
+      expected.insert(node);
+    }
+    else if (operation==2 && nextId<50000) {
+      // Change the costs of a node already in the list
+      osmscout::DBId id(1,1+random()%(nextId-1));
+      RNode**        entry=openMap.Find(id);
+
+      if (entry!=nullptr) {
+        RNode* node=*entry;
+        auto   current=expected.find(openList.begin()[node->heapIndex]);
+
+        RNodeRef ref=*current;
+
+        expected.erase(current);
+        node->overallCost=random()%2==0 ? node->overallCost/2 : costs(random);
+        expected.insert(ref);
+
+        openList.Update(*node);
+      }
+    }
+    else {
+      RNodeRef node=openList.Pop();
+
+      openMap.Erase(node->id);
+
+      if (node!=*expected.begin()) {
+        std::cerr << "Wrong node " << node->id << " " << node->overallCost << " popped, expected " << (*expected.begin())->id << " " << (*expected.begin())->overallCost << std::endl;
+        errors++;
+      }
+
+      expected.erase(node);
+    }
+
+    if (openList.size()!=expected.size() ||
+        openMap.size()!=expected.size()) {
+      std::cerr << "Size " << openList.size() << " != " << expected.size() << std::endl;
+      return errors+1;
+    }
+  }
+
+  return errors;
+}
+
+/**
+ * Check that every node knows its position in the heap and that each of the
+ * (up to four) children of a node has equal or higher costs
+ */
+static bool IsValidHeap(const RoutingTypes::OpenList& openList)
+{
+  RoutingTypes::RNodeCostCompare less;
+  size_t                         size=openList.size();
+
+  for (size_t i=0; i<size; i++) {
+    const RNodeRef& node=openList.begin()[i];
+
+    if (node->heapIndex!=i) {
+      return false;
+    }
+
+    for (size_t child=4*i+1; child<=4*i+4 && child<size; child++) {
+      if (less(openList.begin()[child],node)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Check the 4-ary heap structure after each operation for all small sizes (where
+ * the last level is partially filled), with equal costs, and with cost changes
+ * in both directions
+ */
+static size_t CheckOpenListStructure()
+{
+  std::mt19937 random(4711);
+  size_t       errors=0;
+
+  for (size_t count=1; count<=21; count++) {
+    RoutingTypes::OpenList openList;
+    std::vector<RNodeRef>  nodes;
+
+    for (size_t i=0; i<count; i++) {
+      RNodeRef node=std::make_shared<RNode>(osmscout::DBId(1,count-i),
+                                            nullptr,
+                                            osmscout::ObjectFileRef());
+
+      // Few distinct values, so that ties have to be resolved by id
+      node->overallCost=(double)(random()%3);
+
+      openList.Push(node);
+      nodes.push_back(node);
+
+      if (!IsValidHeap(openList)) {
+        std::cerr << "Invalid heap after push of " << i+1 << "/" << count << " nodes" << std::endl;
+        errors++;
+      }
+    }
+
+    for (size_t i=0; i<count; i++) {
+      RNode& node=*nodes[random()%count];
+
+      // Alternately move nodes to the top and to the bottom
+      node.overallCost=i%2==0 ? node.overallCost-10.0 : node.overallCost+20.0;
+      openList.Update(node);
+
+      if (!IsValidHeap(openList)) {
+        std::cerr << "Invalid heap after update of node " << node.id << " of " << count << " nodes" << std::endl;
+        errors++;
+      }
+    }
+
+    RNodeRef last;
+
+    while (!openList.empty()) {
+      RNodeRef node=openList.Pop();
+
+      if (last &&
+          RoutingTypes::RNodeCostCompare()(node,last)) {
+        std::cerr << "Node " << node->id << " popped after node " << last->id << " with higher costs" << std::endl;
+        errors++;
+      }
+
+      if (!IsValidHeap(openList)) {
+        std::cerr << "Invalid heap after pop of " << count << " nodes" << std::endl;
+        errors++;
+      }
+
+      last=node;
+    }
+  }
+
+  return errors;
+}
+
+int main()
+{
+  size_t errors=0;
+
+  errors+=CheckHashMap();
+  errors+=CheckOpenList();
+  errors+=CheckOpenListStructure();
+
+  if (errors!=0) {
+    std::cerr << errors << " errors" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
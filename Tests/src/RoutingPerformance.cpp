@@ -0,0 +1,209 @@
+/*
+  RoutingPerformance - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <osmscout/Database.h>
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <osmscout/util/CmdLineParsing.h>
+#include <osmscout/util/StopClock.h>
+
+/*
+ * Calculates the same route several times and prints the wall time of each
+ * calculation. The routing service additionally prints its statistics
+ * (loaded nodes, maximum open list and closed set size) for each run.
+ */
+
+struct Arguments
+{
+  bool               help=false;
+  std::string        databaseDirectory;
+  osmscout::GeoCoord start;
+  osmscout::GeoCoord target;
+  size_t             iterations=5;
+  bool               bidirectional=false;
+};
+
+void GetCarSpeedTable(std::map<std::string,double>& map)
+{
+  map["highway_motorway"]=110.0;
+  map["highway_motorway_trunk"]=100.0;
+  map["highway_motorway_primary"]=70.0;
+  map["highway_motorway_link"]=60.0;
+  map["highway_motorway_junction"]=60.0;
+  map["highway_trunk"]=100.0;
+  map["highway_trunk_link"]=60.0;
+  map["highway_primary"]=70.0;
+  map["highway_primary_link"]=60.0;
+  map["highway_secondary"]=60.0;
+  map["highway_secondary_link"]=50.0;
+  map["highway_tertiary"]=55.0;
+  map["highway_tertiary_link"]=55.0;
+  map["highway_unclassified"]=50.0;
+  map["highway_road"]=50.0;
+  map["highway_residential"]=40.0;
+  map["highway_roundabout"]=40.0;
+  map["highway_living_street"]=10.0;
+  map["highway_service"]=30.0;
+}
+
+int main(int argc, char* argv[])
+{
+  osmscout::CmdLineParser   argParser("RoutingPerformance",
+                                      argc,argv);
+  std::vector<std::string>  helpArgs{"h","help"};
+  Arguments                 args;
+
+  argParser.AddOption(osmscout::CmdLineFlag([&args](const bool& value) {
+                        args.help=value;
+                      }),
+                      helpArgs,
+                      "Return argument help",
+                      true);
+
+  argParser.AddOption(osmscout::CmdLineSizeTOption([&args](const size_t& value) {
+                        args.iterations=value;
+                      }),
+                      "iterations",
+                      "Number of route calculations (default: 5)");
+
+  argParser.AddOption(osmscout::CmdLineFlag([&args](const bool& value) {
+                        args.bidirectional=value;
+                      }),
+                      "bidirectional",
+                      "Use the bidirectional search (default: false)");
+
+  argParser.AddPositional(osmscout::CmdLineStringOption([&args](const std::string& value) {
+                            args.databaseDirectory=value;
+                          }),
+                          "DATABASE",
+                          "Directory of the database to use");
+
+  argParser.AddPositional(osmscout::CmdLineGeoCoordOption([&args](const osmscout::GeoCoord& value) {
+                            args.start=value;
+                          }),
+                          "START",
+                          "start coordinate");
+
+  argParser.AddPositional(osmscout::CmdLineGeoCoordOption([&args](const osmscout::GeoCoord& value) {
+                            args.target=value;
+                          }),
+                          "TARGET",
+                          "target coordinate");
+
+  osmscout::CmdLineParseResult result=argParser.Parse();
+
+  if (result.HasError()) {
+    std::cerr << "ERROR: " << result.GetErrorDescription() << std::endl;
+    std::cout << argParser.GetHelp() << std::endl;
+    return 1;
+  }
+
+  if (args.help) {
+    std::cout << argParser.GetHelp() << std::endl;
+    return 0;
+  }
+
+  osmscout::DatabaseParameter dbParameter;
+  osmscout::DatabaseRef       database=std::make_shared<osmscout::Database>(dbParameter);
+
+  if (!database->Open(args.databaseDirectory)) {
+    std::cerr << "Cannot open database" << std::endl;
+    return 1;
+  }
+
+  osmscout::RouterParameter routerParameter;
+
+  routerParameter.SetDebugPerformance(true);
+
+  osmscout::SimpleRoutingServiceRef router=std::make_shared<osmscout::SimpleRoutingService>(database,
+                                                                                            routerParameter,
+                                                                                            osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+
+  if (!router->Open()) {
+    std::cerr << "Cannot open routing database" << std::endl;
+    return 1;
+  }
+
+  osmscout::FastestPathRoutingProfile routingProfile(database->GetTypeConfig());
+  std::map<std::string,double>        carSpeedTable;
+
+  GetCarSpeedTable(carSpeedTable);
+  routingProfile.ParametrizeForCar(*database->GetTypeConfig(),
+                                   carSpeedTable,
+                                   160.0);
+
+  osmscout::RoutePosition start=router->GetClosestRoutableNode(args.start,
+                                                               routingProfile,
+                                                               osmscout::Distance::Of<osmscout::Kilometer>(1));
+  osmscout::RoutePosition target=router->GetClosestRoutableNode(args.target,
+                                                                routingProfile,
+                                                                osmscout::Distance::Of<osmscout::Kilometer>(1));
+
+  if (!start.IsValid() ||
+      !target.IsValid()) {
+    std::cerr << "Cannot find routing node near start or target location" << std::endl;
+    return 1;
+  }
+
+  double minTime=0.0;
+  double maxTime=0.0;
+  double sumTime=0.0;
+
+  for (size_t i=0; i<args.iterations; i++) {
+    osmscout::RoutingParameter parameter;
+
+    parameter.SetBidirectional(args.bidirectional);
+
+    osmscout::StopClock        clock;
+
+    osmscout::RoutingResult route=router->CalculateRoute(routingProfile,
+                                                         start,
+                                                         target,
+                                                         parameter);
+
+    clock.Stop();
+
+    if (!route.Success()) {
+      std::cerr << "Route failed" << std::endl;
+      return 1;
+    }
+
+    double time=clock.GetMilliseconds();
+
+    std::cout << "Run " << (i+1) << ": " << clock.ResultString() << std::endl;
+
+    minTime=i==0 ? time : std::min(minTime,time);
+    maxTime=std::max(maxTime,time);
+    sumTime+=time;
+  }
+
+  if (args.iterations>0) {
+    std::cout << "Min/avg/max: " << minTime << "/" << sumTime/args.iterations << "/" << maxTime << " ms" << std::endl;
+  }
+
+  router->Close();
+  database->Close();
+
+  return 0;
+}
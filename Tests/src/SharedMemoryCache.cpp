@@ -0,0 +1,195 @@
+/*
+  SharedMemoryCache - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <osmscout/util/SharedMemoryCache.h>
+
+static const size_t valueCount=1000;
+
+/**
+ * Fill the buffer with a value that can be verified for the given key
+ */
+static size_t MakeValue(uint64_t key,
+                        std::vector<uint64_t>& value)
+{
+  value.resize(1+key%16);
+
+  for (size_t i=0; i<value.size(); i++) {
+    value[i]=key*31+i;
+  }
+
+  return value.size()*sizeof(uint64_t);
+}
+
+static bool CheckValue(uint64_t key,
+                       const std::vector<uint64_t>& value,
+                       size_t valueSize)
+{
+  std::vector<uint64_t> expected;
+
+  if (MakeValue(key,expected)!=valueSize) {
+    return false;
+  }
+
+  for (size_t i=0; i<expected.size(); i++) {
+    if (value[i]!=expected[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main()
+{
+  if (!osmscout::SharedMemoryCache::IsSupported()) {
+    std::cout << "Shared memory not supported, skipping" << std::endl;
+    return 0;
+  }
+
+  std::string name="osmscout-test-"+std::to_string(getpid());
+  uint64_t    fileKey=osmscout::SharedMemoryCache::GetFileKey("test.dat");
+  size_t      errors=0;
+
+  // The child process fills the cache, the parent reads the values afterwards
+  pid_t child=fork();
+
+  if (child==0) {
+    osmscout::SharedMemoryCache cache;
+
+    if (!cache.Open(name,1024*1024,256)) {
+      _exit(1);
+    }
+
+    std::vector<uint64_t> value;
+
+    for (uint64_t key=0; key<valueCount; key++) {
+      size_t size=MakeValue(key,value);
+
+      cache.Put(fileKey,key,value.data(),size);
+    }
+
+    cache.Close();
+    _exit(0);
+  }
+
+  int status;
+
+  waitpid(child,&status,0);
+
+  if (!WIFEXITED(status) ||
+      WEXITSTATUS(status)!=0) {
+    std::cerr << "Child process failed" << std::endl;
+    osmscout::SharedMemoryCache::Remove(name);
+    return 1;
+  }
+
+  osmscout::SharedMemoryCache cache;
+
+  // Size and value size of the existing segment are used
+  if (!cache.Open(name,1,1)) {
+    std::cerr << "Cannot open shared memory cache created by child process" << std::endl;
+    osmscout::SharedMemoryCache::Remove(name);
+    return 1;
+  }
+
+  osmscout::SharedMemoryCache::Remove(name);
+
+  std::vector<uint64_t> value(32);
+  size_t                found=0;
+
+  for (uint64_t key=0; key<valueCount; key++) {
+    size_t valueSize;
+
+    if (cache.Get(fileKey,key,value.data(),value.size()*sizeof(uint64_t),valueSize)) {
+      found++;
+
+      if (!CheckValue(key,value,valueSize)) {
+        std::cerr << "Wrong value for key " << key << std::endl;
+        errors++;
+      }
+    }
+  }
+
+  std::cout << found << " of " << valueCount << " values found" << std::endl;
+
+  if (found<valueCount*9/10) {
+    std::cerr << "Too many values lost" << std::endl;
+    errors++;
+  }
+
+  size_t valueSize;
+
+  if (cache.Get(fileKey+1,0,value.data(),value.size()*sizeof(uint64_t),valueSize)) {
+    std::cerr << "Found value for wrong file key" << std::endl;
+    errors++;
+  }
+
+  // Concurrent readers and writers must never see a torn value
+  std::atomic<size_t>      wrongValues(0);
+  std::vector<std::thread> threads;
+
+  for (size_t t=0; t<4; t++) {
+    threads.push_back(std::thread([&cache,&wrongValues,fileKey,t]() {
+      std::vector<uint64_t> buffer(32);
+
+      for (uint64_t i=0; i<20000; i++) {
+        uint64_t key=(i*7+t)%(4*valueCount);
+        size_t   size;
+
+        if (i%3==t%3) {
+          size=MakeValue(key,buffer);
+          cache.Put(fileKey,key,buffer.data(),size);
+        }
+        else if (cache.Get(fileKey,key,buffer.data(),buffer.size()*sizeof(uint64_t),size) &&
+                 !CheckValue(key,buffer,size)) {
+          wrongValues++;
+        }
+      }
+    }));
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (wrongValues>0) {
+    std::cerr << wrongValues << " torn values read" << std::endl;
+    errors++;
+  }
+
+  cache.Close();
+
+  if (errors!=0) {
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,186 @@
+/*
+  StyleCache - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <osmscout/TypeConfig.h>
+#include <osmscout/StyleConfig.h>
+
+#include <osmscout/util/Projection.h>
+
+/**
+ * Test objects: for each type without features, with exactly one feature and
+ * with all features
+ */
+static std::vector<std::shared_ptr<osmscout::FeatureValueBuffer>> CreateBuffers(const osmscout::TypeConfig& typeConfig)
+{
+  std::vector<std::shared_ptr<osmscout::FeatureValueBuffer>> buffers;
+
+  for (const auto& type : typeConfig.GetTypes()) {
+    if (type->GetIgnore() ||
+        (!type->CanBeWay() && !type->CanBeArea())) {
+      continue;
+    }
+
+    for (size_t variant=0; variant<=type->GetFeatureCount()+1; variant++) {
+      auto buffer=std::make_shared<osmscout::FeatureValueBuffer>();
+
+      buffer->SetType(type);
+
+      for (size_t idx=0; idx<type->GetFeatureCount(); idx++) {
+        if (variant==type->GetFeatureCount()+1 ||
+            variant==idx+1) {
+          buffer->AllocateValue(idx);
+        }
+      }
+
+      buffers.push_back(buffer);
+    }
+  }
+
+  return buffers;
+}
+
+/**
+ * Description of the resolved way and area styles of an object
+ */
+static std::string ResolveStyles(const osmscout::StyleConfig& styleConfig,
+                                 const osmscout::FeatureValueBuffer& buffer,
+                                 const osmscout::Projection& projection)
+{
+  std::ostringstream                       stream;
+  std::vector<osmscout::LineStyleRef>      lineStyles;
+  std::vector<osmscout::BorderStyleRef>    borderStyles;
+  osmscout::TypeInfoRef                    type=buffer.GetType();
+
+  if (type->CanBeWay()) {
+    styleConfig.GetWayLineStyles(buffer,
+                                 projection,
+                                 lineStyles);
+
+    for (const auto& style : lineStyles) {
+      stream << "line " << style->GetSlot() << " " << style->GetLineColor().ToHexString() << " ";
+      stream << style->GetWidth() << " " << style->GetDisplayWidth() << " " << style->GetOffset() << ";";
+    }
+  }
+
+  if (type->CanBeArea()) {
+    osmscout::FillStyleRef fillStyle=styleConfig.GetAreaFillStyle(type,
+                                                                  buffer,
+                                                                  projection);
+
+    if (fillStyle) {
+      stream << "fill " << fillStyle->GetFillColor().ToHexString() << " " << fillStyle->GetPatternName() << ";";
+    }
+
+    styleConfig.GetAreaBorderStyles(type,
+                                    buffer,
+                                    projection,
+                                    borderStyles);
+
+    for (const auto& style : borderStyles) {
+      stream << "border " << style->GetSlot() << " " << style->GetColor().ToHexString() << " " << style->GetWidth() << ";";
+    }
+  }
+
+  return stream.str();
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc!=3) {
+    std::cerr << "StyleCache <map.ost> <map.oss>" << std::endl;
+    return 1;
+  }
+
+  osmscout::TypeConfigRef typeConfig=std::make_shared<osmscout::TypeConfig>();
+
+  if (!typeConfig->LoadFromOSTFile(argv[1])) {
+    std::cerr << "Cannot load type configuration '" << argv[1] << "'" << std::endl;
+    return 1;
+  }
+
+  // Both style configurations resolve the same objects in different order, so
+  // objects wrongly sharing a cache entry get different styles
+
+  osmscout::StyleConfig forwardStyleConfig(typeConfig);
+  osmscout::StyleConfig backwardStyleConfig(typeConfig);
+
+  if (!forwardStyleConfig.Load(argv[2]) ||
+      !backwardStyleConfig.Load(argv[2])) {
+    std::cerr << "Cannot load style sheet '" << argv[2] << "'" << std::endl;
+    return 1;
+  }
+
+  std::vector<std::shared_ptr<osmscout::FeatureValueBuffer>> buffers=CreateBuffers(*typeConfig);
+  size_t                                                     errors=0;
+
+  for (double dpi : {96.0,300.0}) {
+    for (uint32_t level=10; level<=20; level++) {
+      osmscout::MercatorProjection projection;
+      std::vector<std::string>     forward(buffers.size());
+      std::vector<std::string>     backward(buffers.size());
+
+      projection.Set(osmscout::GeoCoord(51.0,7.0),
+                     osmscout::Magnification(osmscout::MagnificationLevel(level)),
+                     dpi,
+                     640,
+                     480);
+
+      for (size_t i=0; i<buffers.size(); i++) {
+        forward[i]=ResolveStyles(forwardStyleConfig,
+                                 *buffers[i],
+                                 projection);
+      }
+
+      for (size_t i=buffers.size(); i>0; i--) {
+        backward[i-1]=ResolveStyles(backwardStyleConfig,
+                                    *buffers[i-1],
+                                    projection);
+      }
+
+      for (size_t i=0; i<buffers.size(); i++) {
+        // Resolving again must return the cached styles
+        std::string again=ResolveStyles(forwardStyleConfig,
+                                        *buffers[i],
+                                        projection);
+
+        if (forward[i]!=backward[i] ||
+            forward[i]!=again) {
+          std::cerr << "Type " << buffers[i]->GetType()->GetName() << ", level " << level << ", dpi " << dpi << ": ";
+          std::cerr << "'" << forward[i] << "' != '" << backward[i] << "' != '" << again << "'" << std::endl;
+          errors++;
+        }
+      }
+    }
+  }
+
+  if (errors!=0) {
+    std::cerr << errors << " errors" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,379 @@
+/*
+  StyleCompiled - a test program for libosmscout
+  Copyright (C) 2018  Tim Teulings
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <osmscout/TypeConfig.h>
+#include <osmscout/StyleConfig.h>
+
+#include <osmscout/util/Projection.h>
+#include <osmscout/util/StopClock.h>
+
+/**
+ * Test objects: for each type without features, with exactly one feature and
+ * with all features
+ */
+static std::vector<std::shared_ptr<osmscout::FeatureValueBuffer>> CreateBuffers(const osmscout::TypeConfig& typeConfig)
+{
+  std::vector<std::shared_ptr<osmscout::FeatureValueBuffer>> buffers;
+
+  for (const auto& type : typeConfig.GetTypes()) {
+    if (type->GetIgnore()) {
+      continue;
+    }
+
+    for (size_t variant=0; variant<=type->GetFeatureCount()+1; variant++) {
+      auto buffer=std::make_shared<osmscout::FeatureValueBuffer>();
+
+      buffer->SetType(type);
+
+      for (size_t idx=0; idx<type->GetFeatureCount(); idx++) {
+        if (variant==type->GetFeatureCount()+1 ||
+            variant==idx+1) {
+          buffer->AllocateValue(idx);
+        }
+      }
+
+      buffers.push_back(buffer);
+    }
+  }
+
+  return buffers;
+}
+
+static std::string DescribeLabel(const osmscout::LabelProviderRef& label)
+{
+  return label ? label->GetName() : "-";
+}
+
+static std::string DescribeSymbol(const osmscout::SymbolRef& symbol)
+{
+  if (!symbol) {
+    return "-";
+  }
+
+  std::ostringstream stream;
+
+  stream << symbol->GetName() << " " << symbol->GetPrimitives().size() << " " << symbol->GetWidth() << "x" << symbol->GetHeight();
+
+  return stream.str();
+}
+
+static void Describe(std::ostream& stream,
+                     const osmscout::TextStyleRef& style)
+{
+  stream << "text " << style->GetSlot() << " " << DescribeLabel(style->GetLabel()) << " ";
+  stream << style->GetPriority() << " " << style->GetSize() << " " << style->GetPosition() << " ";
+  stream << style->GetTextColor().ToHexString() << " " << style->GetStyle() << " ";
+  stream << style->GetScaleAndFadeMag().GetMagnification() << " " << style->GetAutoSize() << ";";
+}
+
+static void Describe(std::ostream& stream,
+                     const osmscout::IconStyleRef& style)
+{
+  if (style) {
+    stream << "icon " << DescribeSymbol(style->GetSymbol()) << " " << style->GetIconName() << " ";
+    stream << style->GetIconId() << " " << style->GetWidth() << " " << style->GetHeight() << " " << style->GetPosition() << ";";
+  }
+}
+
+static void Describe(std::ostream& stream,
+                     const osmscout::LineStyleRef& style)
+{
+  stream << "line " << style->GetSlot() << " " << style->GetLineColor().ToHexString() << " ";
+  stream << style->GetGapColor().ToHexString() << " " << style->GetDisplayWidth() << " " << style->GetWidth() << " ";
+  stream << style->GetDisplayOffset() << " " << style->GetOffset() << " " << style->GetJoinCap() << " ";
+  stream << style->GetEndCap() << " " << style->GetDash().size() << " " << style->GetPriority() << " ";
+  stream << style->GetZIndex() << " " << style->GetOffsetRel() << ";";
+}
+
+static void Describe(std::ostream& stream,
+                     const osmscout::PathTextStyleRef& style)
+{
+  if (style) {
+    stream << "pathText " << DescribeLabel(style->GetLabel()) << " " << style->GetSize() << " ";
+    stream << style->GetTextColor().ToHexString() << " " << style->GetDisplayOffset() << " ";
+    stream << style->GetOffset() << " " << style->GetPriority() << ";";
+  }
+}
+
+static void Describe(std::ostream& stream,
+                     const osmscout::PathSymbolStyleRef& style)
+{
+  if (style) {
+    stream << "pathSymbol " << DescribeSymbol(style->GetSymbol()) << " " << style->GetSymbolSpace() << " ";
+    stream << style->GetDisplayOffset() << " " << style->GetOffset() << ";";
+  }
+}
+
+static void Describe(std::ostream& stream,
+                     const osmscout::PathShieldStyleRef& style)
+{
+  if (style) {
+    stream << "pathShield " << DescribeLabel(style->GetLabel()) << " " << style->GetPriority() << " ";
+    stream << style->GetSize() << " " << style->GetTextColor().ToHexString() << " ";
+    stream << style->GetBgColor().ToHexString() << " " << style->GetBorderColor().ToHexString() << " ";
+    stream << style->GetShieldSpace() << ";";
+  }
+}
+
+static void Describe(std::ostream& stream,
+                     const osmscout::FillStyleRef& style)
+{
+  if (style) {
+    stream << "fill " << style->GetFillColor().ToHexString() << " " << style->GetPatternName() << " ";
+    stream << style->GetPatternId() << " " << style->GetPatternMinMag().GetMagnification() << ";";
+  }
+}
+
+static void Describe(std::ostream& stream,
+                     const osmscout::BorderStyleRef& style)
+{
+  stream << "border " << style->GetSlot() << " " << style->GetColor().ToHexString() << " ";
+  stream << style->GetGapColor().ToHexString() << " " << style->GetWidth() << " " << style->GetDash().size() << " ";
+  stream << style->GetDisplayOffset() << " " << style->GetOffset() << " " << style->GetPriority() << ";";
+}
+
+/**
+ * Description of all resolved styles of an object
+ */
+static std::string ResolveStyles(const osmscout::StyleConfig& styleConfig,
+                                 const osmscout::FeatureValueBuffer& buffer,
+                                 const osmscout::Projection& projection)
+{
+  std::ostringstream stream;
+  osmscout::TypeInfoRef type=buffer.GetType();
+
+  if (type->CanBeNode()) {
+    std::vector<osmscout::TextStyleRef> textStyles;
+
+    styleConfig.GetNodeTextStyles(buffer,
+                                  projection,
+                                  textStyles);
+
+    for (const auto& style : textStyles) {
+      Describe(stream,style);
+    }
+
+    Describe(stream,styleConfig.GetNodeIconStyle(buffer,projection));
+  }
+
+  if (type->CanBeWay()) {
+    std::vector<osmscout::LineStyleRef> lineStyles;
+
+    styleConfig.GetWayLineStyles(buffer,
+                                 projection,
+                                 lineStyles);
+
+    for (const auto& style : lineStyles) {
+      Describe(stream,style);
+    }
+
+    Describe(stream,styleConfig.GetWayPathTextStyle(buffer,projection));
+    Describe(stream,styleConfig.GetWayPathSymbolStyle(buffer,projection));
+    Describe(stream,styleConfig.GetWayPathShieldStyle(buffer,projection));
+    stream << "prio " << styleConfig.GetWayPrio(type) << ";";
+  }
+
+  if (type->CanBeArea()) {
+    std::vector<osmscout::BorderStyleRef> borderStyles;
+    std::vector<osmscout::TextStyleRef>   textStyles;
+
+    Describe(stream,styleConfig.GetAreaFillStyle(type,buffer,projection));
+
+    styleConfig.GetAreaBorderStyles(type,
+                                    buffer,
+                                    projection,
+                                    borderStyles);
+
+    for (const auto& style : borderStyles) {
+      Describe(stream,style);
+    }
+
+    styleConfig.GetAreaTextStyles(type,
+                                  buffer,
+                                  projection,
+                                  textStyles);
+
+    for (const auto& style : textStyles) {
+      Describe(stream,style);
+    }
+
+    Describe(stream,styleConfig.GetAreaIconStyle(type,buffer,projection));
+    Describe(stream,styleConfig.GetAreaBorderTextStyle(type,buffer,projection));
+    Describe(stream,styleConfig.GetAreaBorderSymbolStyle(type,buffer,projection));
+  }
+
+  return stream.str();
+}
+
+static std::string DescribeTypeSets(const osmscout::StyleConfig& styleConfig,
+                                    const osmscout::Magnification& magnification)
+{
+  std::ostringstream    stream;
+  osmscout::TypeInfoSet nodeTypes;
+  osmscout::TypeInfoSet wayTypes;
+  osmscout::TypeInfoSet areaTypes;
+
+  styleConfig.GetNodeTypesWithMaxMag(magnification,nodeTypes);
+  styleConfig.GetWayTypesWithMaxMag(magnification,wayTypes);
+  styleConfig.GetAreaTypesWithMaxMag(magnification,areaTypes);
+
+  for (const auto& type : nodeTypes) {
+    stream << "node " << type->GetName() << ";";
+  }
+
+  for (const auto& type : wayTypes) {
+    stream << "way " << type->GetName() << ";";
+  }
+
+  for (const auto& type : areaTypes) {
+    stream << "area " << type->GetName() << ";";
+  }
+
+  return stream.str();
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc!=4) {
+    std::cerr << "StyleCompiled <map.ost> <map.oss> <compiled output file>" << std::endl;
+    return 1;
+  }
+
+  osmscout::TypeConfigRef typeConfig=std::make_shared<osmscout::TypeConfig>();
+
+  if (!typeConfig->LoadFromOSTFile(argv[1])) {
+    std::cerr << "Cannot load type configuration '" << argv[1] << "'" << std::endl;
+    return 1;
+  }
+
+  osmscout::StyleConfig parsedStyleConfig(typeConfig);
+  osmscout::StopClock   parseTimer;
+
+  if (!parsedStyleConfig.Load(argv[2])) {
+    std::cerr << "Cannot load style sheet '" << argv[2] << "'" << std::endl;
+    return 1;
+  }
+
+  parseTimer.Stop();
+
+  if (osmscout::StyleConfig::IsCompiled(argv[2])) {
+    std::cerr << "Style sheet '" << argv[2] << "' is wrongly detected as compiled" << std::endl;
+    return 1;
+  }
+
+  if (!parsedStyleConfig.StoreCompiled(argv[3])) {
+    std::cerr << "Cannot store compiled style sheet '" << argv[3] << "'" << std::endl;
+    return 1;
+  }
+
+  if (!osmscout::StyleConfig::IsCompiled(argv[3])) {
+    std::cerr << "Compiled style sheet '" << argv[3] << "' is not detected" << std::endl;
+    return 1;
+  }
+
+  osmscout::StyleConfig compiledStyleConfig(typeConfig);
+  osmscout::StopClock   loadTimer;
+
+  // Load() must detect the compiled form by itself
+  if (!compiledStyleConfig.Load(argv[3])) {
+    std::cerr << "Cannot load compiled style sheet '" << argv[3] << "'" << std::endl;
+    return 1;
+  }
+
+  loadTimer.Stop();
+
+  std::cout << "Parsing: " << parseTimer.ResultString() << ", loading compiled: " << loadTimer.ResultString() << std::endl;
+
+  size_t errors=0;
+
+  if (parsedStyleConfig.GetFlags()!=compiledStyleConfig.GetFlags()) {
+    std::cerr << "Flags differ" << std::endl;
+    errors++;
+  }
+
+  std::vector<std::shared_ptr<osmscout::FeatureValueBuffer>> buffers=CreateBuffers(*typeConfig);
+
+  for (uint32_t level=0; level<=20; level++) {
+    osmscout::Magnification magnification{osmscout::MagnificationLevel(level)};
+
+    std::string parsedTypes=DescribeTypeSets(parsedStyleConfig,magnification);
+    std::string compiledTypes=DescribeTypeSets(compiledStyleConfig,magnification);
+
+    if (parsedTypes!=compiledTypes) {
+      std::cerr << "Level " << level << ": type sets differ: '" << parsedTypes << "' != '" << compiledTypes << "'" << std::endl;
+      errors++;
+    }
+
+    for (double dpi : {96.0,300.0}) {
+      osmscout::MercatorProjection projection;
+
+      projection.Set(osmscout::GeoCoord(51.0,7.0),
+                     magnification,
+                     dpi,
+                     640,
+                     480);
+
+      for (const auto& buffer : buffers) {
+        std::string parsed=ResolveStyles(parsedStyleConfig,
+                                         *buffer,
+                                         projection);
+        std::string compiled=ResolveStyles(compiledStyleConfig,
+                                           *buffer,
+                                           projection);
+
+        if (parsed!=compiled) {
+          std::cerr << "Type " << buffer->GetType()->GetName() << ", level " << level << ", dpi " << dpi << ": ";
+          std::cerr << "'" << parsed << "' != '" << compiled << "'" << std::endl;
+          errors++;
+        }
+      }
+    }
+  }
+
+  // Flags set by the client must match the flags the style sheet was compiled with
+  osmscout::StyleConfig mismatchStyleConfig(typeConfig);
+
+  for (const auto& flag : parsedStyleConfig.GetFlags()) {
+    mismatchStyleConfig.AddFlag(flag.first,!flag.second);
+  }
+
+  if (!parsedStyleConfig.GetFlags().empty() &&
+      mismatchStyleConfig.Load(argv[3])) {
+    std::cerr << "Compiled style sheet was loaded with different flags" << std::endl;
+    errors++;
+  }
+
+  std::remove(argv[3]);
+
+  if (errors!=0) {
+    std::cerr << errors << " errors" << std::endl;
+    return 1;
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include <cstdio>
+#include <set>
+
+#include <osmscout/TileSeeder.h>
+#include <osmscout/TileStorage.h>
+
+#include <osmscout/util/File.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+TEST_CASE("Metatiles are ordered along a Hilbert curve") {
+  osmscout::Magnification magnification(osmscout::MagnificationLevel(4));
+  osmscout::OSMTileIdBox  tiles(osmscout::OSMTileId(0,0),
+                                osmscout::OSMTileId(15,15));
+
+  std::vector<osmscout::Metatile> metatiles=osmscout::TileSeeder::GetOrderedMetatiles(magnification,
+                                                                                     tiles,
+                                                                                     2,
+                                                                                     0,
+                                                                                     256,
+                                                                                     256);
+  std::set<std::pair<uint32_t,uint32_t>> covered;
+
+  REQUIRE(metatiles.size()==64);
+
+  for (size_t i=0; i<metatiles.size(); i++) {
+    for (const auto& tile : metatiles[i].GetTiles()) {
+      REQUIRE(covered.insert(std::make_pair(tile.GetX(),tile.GetY())).second);
+    }
+
+    if (i>0) {
+      // Consecutive metatiles are neighbours
+      uint32_t dx=std::max(metatiles[i].GetTiles().GetMinX(),metatiles[i-1].GetTiles().GetMinX())-
+                  std::min(metatiles[i].GetTiles().GetMinX(),metatiles[i-1].GetTiles().GetMinX());
+      uint32_t dy=std::max(metatiles[i].GetTiles().GetMinY(),metatiles[i-1].GetTiles().GetMinY())-
+                  std::min(metatiles[i].GetTiles().GetMinY(),metatiles[i-1].GetTiles().GetMinY());
+
+      REQUIRE(dx+dy==2);
+    }
+  }
+
+  REQUIRE(covered.size()==tiles.GetCount());
+}
+
+TEST_CASE("Hilbert order does not depend on the seeded region") {
+  osmscout::Magnification magnification(osmscout::MagnificationLevel(4));
+
+  std::vector<osmscout::Metatile> all=osmscout::TileSeeder::GetOrderedMetatiles(magnification,
+                                                                               osmscout::OSMTileIdBox(osmscout::OSMTileId(0,0),
+                                                                                                      osmscout::OSMTileId(15,15)),
+                                                                               2,
+                                                                               0,
+                                                                               256,
+                                                                               256);
+  std::vector<osmscout::Metatile> part=osmscout::TileSeeder::GetOrderedMetatiles(magnification,
+                                                                                osmscout::OSMTileIdBox(osmscout::OSMTileId(4,2),
+                                                                                                       osmscout::OSMTileId(11,9)),
+                                                                                2,
+                                                                                0,
+                                                                                256,
+                                                                                256);
+  size_t                          idx=0;
+
+  REQUIRE(part.size()==16);
+
+  for (const auto& metatile : all) {
+    if (idx<part.size() &&
+        metatile.GetTiles().GetMin()==part[idx].GetTiles().GetMin()) {
+      idx++;
+    }
+  }
+
+  REQUIRE(idx==part.size());
+}
+
+TEST_CASE("Tile pack storage can be resumed") {
+  std::string                 filename="TileSeederTest.pack";
+  osmscout::MagnificationLevel level(12);
+
+  if (osmscout::ExistsInFilesystem(filename)) {
+    REQUIRE(osmscout::RemoveFile(filename));
+  }
+
+  {
+    osmscout::TilePackStorage storage;
+
+    REQUIRE(storage.Open(filename));
+    REQUIRE(storage.StoreTile(level,osmscout::OSMTileId(1,2),"tile 1,2"));
+    REQUIRE(storage.StoreTile(level,osmscout::OSMTileId(2,2),""));
+    REQUIRE(storage.StoreTile(level,osmscout::OSMTileId(1,2),"tile 1,2 replaced"));
+    REQUIRE(storage.HasTile(level,osmscout::OSMTileId(2,2)));
+    REQUIRE_FALSE(storage.HasTile(level,osmscout::OSMTileId(3,2)));
+    REQUIRE(storage.GetTileCount()==2);
+    REQUIRE(storage.Close());
+  }
+
+  // A partial record of an interrupted process after the committed data
+  std::FILE* file=std::fopen(filename.c_str(),"ab");
+
+  REQUIRE(file!=nullptr);
+  REQUIRE(std::fwrite("garbage",1,7,file)==7);
+  REQUIRE(std::fclose(file)==0);
+
+  {
+    osmscout::TilePackStorage storage;
+    std::string               content;
+
+    REQUIRE(storage.Open(filename));
+    REQUIRE(storage.GetTileCount()==2);
+    REQUIRE(storage.GetTile(level,osmscout::OSMTileId(1,2),content));
+    REQUIRE(content=="tile 1,2 replaced");
+    REQUIRE(storage.GetTile(level,osmscout::OSMTileId(2,2),content));
+    REQUIRE(content.empty());
+    REQUIRE(storage.StoreTile(level,osmscout::OSMTileId(3,2),"tile 3,2"));
+    REQUIRE(storage.GetTile(level,osmscout::OSMTileId(3,2),content));
+    REQUIRE(content=="tile 3,2");
+    REQUIRE(storage.Close());
+  }
+
+  {
+    osmscout::TilePackStorage storage;
+    std::string               content;
+
+    REQUIRE(storage.Open(filename));
+    REQUIRE(storage.GetTileCount()==3);
+    REQUIRE(storage.GetTile(level,osmscout::OSMTileId(3,2),content));
+    REQUIRE(content=="tile 3,2");
+    REQUIRE_FALSE(storage.GetTile(osmscout::MagnificationLevel(13),osmscout::OSMTileId(3,2),content));
+    REQUIRE(storage.Close());
+  }
+}
+
+TEST_CASE("Directory tile storage") {
+  std::string                     directory="TileSeederTest.tiles";
+  osmscout::MagnificationLevel    level(3);
+  osmscout::OSMTileId             tile(5,6);
+  osmscout::DirectoryTileStorage  storage(directory,"png");
+  std::string                     filename=osmscout::AppendFileToDir(osmscout::AppendFileToDir(osmscout::AppendFileToDir(directory,"3"),"5"),"6.png");
+  std::vector<char>               content;
+
+  REQUIRE(osmscout::MakeDirectory(directory));
+
+  if (osmscout::ExistsInFilesystem(filename)) {
+    REQUIRE(osmscout::RemoveFile(filename));
+  }
+
+  REQUIRE_FALSE(storage.HasTile(level,tile));
+  REQUIRE(storage.StoreTile(level,tile,"tile"));
+  REQUIRE(storage.HasTile(level,tile));
+  REQUIRE(storage.Flush());
+  REQUIRE(osmscout::ReadFile(filename,content));
+  REQUIRE(std::string(content.begin(),content.end())=="tile");
+}
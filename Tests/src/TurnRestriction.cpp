@@ -0,0 +1,195 @@
+/*
+  TurnRestriction - a test program for libosmscout
+  Copyright (C) 2026  agent
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <map>
+
+#include <osmscout/Database.h>
+
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <osmscout/import/GenContractionHierarchy.h>
+
+#include <RoutingGrid.h>
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+namespace {
+
+  const std::string databaseDir="TurnRestriction.db";
+
+  const size_t column=1; //!< Column of the grid with the turn restriction
+
+  /**
+   * Length of the straight route along the column from (column,fromY) to (column,toY) in km
+   */
+  double GetStraightLength(size_t fromY,
+                           size_t toY)
+  {
+    double length=0.0;
+
+    for (size_t y=std::min(fromY,toY); y<std::max(fromY,toY); y++) {
+      length+=osmscout::GetSphericalDistance(GetRoutingGridCoord(column,y),
+                                             GetRoutingGridCoord(column,y+1)).As<osmscout::Kilometer>();
+    }
+
+    return length;
+  }
+
+  osmscout::RoutePosition GetRoutePosition(osmscout::SimpleRoutingService& router,
+                                           const osmscout::RoutingProfile& profile,
+                                           size_t y)
+  {
+    osmscout::RoutePosition position=router.GetClosestRoutableNode(GetRoutingGridCoord(column,y),
+                                                                   profile,
+                                                                   osmscout::Distance::Of<osmscout::Meter>(50.0));
+
+    REQUIRE(position.IsValid());
+
+    return position;
+  }
+
+  /**
+   * Calculate the shortest route from (column,fromY) to (column,toY) and return its length in km
+   */
+  double CalculateRouteLength(osmscout::SimpleRoutingService& router,
+                              osmscout::RoutingProfile& profile,
+                              const osmscout::RoutingParameter& parameter,
+                              size_t fromY,
+                              size_t toY)
+  {
+    osmscout::RoutingResult route=router.CalculateRoute(profile,
+                                                        GetRoutePosition(router,profile,fromY),
+                                                        GetRoutePosition(router,profile,toY),
+                                                        parameter);
+
+    double length;
+
+    REQUIRE(route.Success());
+    REQUIRE(GetRouteLength(router,route.GetRoute(),length));
+
+    return length;
+  }
+
+  osmscout::RoutingProfileRef CreateShortestPathProfile(const osmscout::TypeConfigRef& typeConfig)
+  {
+    osmscout::ShortestPathRoutingProfileRef profile=std::make_shared<osmscout::ShortestPathRoutingProfile>(typeConfig);
+
+    profile->ParametrizeForCar(*typeConfig,
+                               std::map<std::string,double>{{"highway_primary",50.0},
+                                                            {"highway_residential",30.0}},
+                               100.0);
+
+    return profile;
+  }
+
+  /**
+   * The profile the contraction hierarchy for cars is built for
+   */
+  osmscout::RoutingProfileRef CreateHierarchyProfile(const osmscout::TypeConfigRef& typeConfig)
+  {
+    return osmscout::ContractionHierarchyGenerator::CreateProfile(typeConfig,
+                                                                  osmscout::vehicleCar);
+  }
+
+  /**
+   * Going straight on at (column,3) coming from (column,2) is forbidden, the route has to take
+   * a detour. The opposite direction is not restricted.
+   */
+  void CheckTurnRestriction(const osmscout::RouterParameter& routerParameter,
+                            osmscout::RoutingProfileRef (*createProfile)(const osmscout::TypeConfigRef&),
+                            const osmscout::RoutingParameter& parameter=osmscout::RoutingParameter())
+  {
+    osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir,osmscout::DatabaseParameter(),true,true);
+
+    REQUIRE(database);
+
+    osmscout::SimpleRoutingService router(database,
+                                          routerParameter,
+                                          osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+    osmscout::RoutingProfileRef    profile=createProfile(database->GetTypeConfig());
+
+    REQUIRE(profile);
+    REQUIRE(router.Open());
+
+    REQUIRE(CalculateRouteLength(router,*profile,parameter,1,5)>GetStraightLength(1,5)+0.1);
+    REQUIRE(CalculateRouteLength(router,*profile,parameter,5,1)==Approx(GetStraightLength(1,5)).epsilon(0.001));
+
+    router.Close();
+    database->Close();
+  }
+}
+
+TEST_CASE("Search on route nodes respects turn restrictions") {
+  CheckTurnRestriction(osmscout::RouterParameter(),
+                       CreateShortestPathProfile);
+}
+
+TEST_CASE("Search on the flat route graph respects turn restrictions") {
+  osmscout::RouterParameter parameter;
+
+  parameter.SetFlatRouteGraph(true);
+
+  CheckTurnRestriction(parameter,
+                       CreateShortestPathProfile);
+}
+
+TEST_CASE("Bidirectional search respects turn restrictions") {
+  osmscout::RoutingParameter parameter;
+
+  parameter.SetBidirectional(true);
+
+  CheckTurnRestriction(osmscout::RouterParameter(),
+                       CreateShortestPathProfile,
+                       parameter);
+}
+
+TEST_CASE("Search on the contraction hierarchy respects turn restrictions") {
+  CheckTurnRestriction(osmscout::RouterParameter(),
+                       CreateHierarchyProfile);
+}
+
+TEST_CASE("Routing matrix respects turn restrictions") {
+  osmscout::DatabaseRef database=OpenRoutingGridDatabase(databaseDir,osmscout::DatabaseParameter(),true,true);
+
+  REQUIRE(database);
+
+  osmscout::SimpleRoutingService router(database,
+                                        osmscout::RouterParameter(),
+                                        osmscout::RoutingService::DEFAULT_FILENAME_BASE);
+  osmscout::RoutingProfileRef    profile=CreateShortestPathProfile(database->GetTypeConfig());
+
+  REQUIRE(router.Open());
+
+  // For the shortest path the costs are the length of the route
+  osmscout::RoutingMatrix matrix=router.CalculateMatrix(*profile,
+                                                        {GetRoutePosition(router,*profile,1),
+                                                         GetRoutePosition(router,*profile,5)},
+                                                        {GetRoutePosition(router,*profile,5),
+                                                         GetRoutePosition(router,*profile,1)},
+                                                        osmscout::RoutingParameter());
+
+  REQUIRE(matrix.IsReachable(0,0));
+  REQUIRE(matrix.IsReachable(1,1));
+  REQUIRE(matrix.GetCosts(0,0)>GetStraightLength(1,5)+0.1);
+  REQUIRE(matrix.GetCosts(1,1)==Approx(GetStraightLength(1,5)).epsilon(0.001));
+
+  router.Close();
+  database->Close();
+}
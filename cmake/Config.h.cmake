@@ -70,6 +70,11 @@
 #cmakedefine HAVE_LONG_LONG 1
 #endif
 
+/* Define to 1 if you have the <linux/io_uring.h> header file. */
+#ifndef HAVE_LINUX_IO_URING_H
+#cmakedefine HAVE_LINUX_IO_URING_H 1
+#endif
+
 /* Define to 1 if you have the <memory.h> header file. */
 #ifndef HAVE_MEMORY_H
 #cmakedefine HAVE_MEMORY_H 1
@@ -95,6 +100,11 @@
 #cmakedefine HAVE_POSIX_MADVISE 1
 #endif
 
+/* Define to 1 if you have the `shm_open' function. */
+#ifndef HAVE_SHM_OPEN
+#cmakedefine HAVE_SHM_OPEN 1
+#endif
+
 /* Support SSE (Streaming SIMD Extensions) instructions */
 #ifndef HAVE_SSE
 #cmakedefine HAVE_SSE 1
@@ -0,0 +1,89 @@
+#ifndef OSMSCOUT_IMPORT_GENCONTRACTIONHIERARCHY_H
+#define OSMSCOUT_IMPORT_GENCONTRACTIONHIERARCHY_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <vector>
+
+#include <osmscout/ObjectRef.h>
+
+#include <osmscout/routing/ContractionHierarchy.h>
+#include <osmscout/routing/RoutingProfile.h>
+
+#include <osmscout/import/Import.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * Generates the (optional) contraction hierarchies for all routers and all
+   * vehicles of a router based on the route graph written by the RouteDataGenerator.
+   *
+   * The hierarchies are only generated, if ImportParameter::GetRouterContractionHierarchy()
+   * is true.
+   */
+  class OSMSCOUT_IMPORT_API ContractionHierarchyGenerator CLASS_FINAL : public ImportModule
+  {
+  public:
+    /**
+     * An edge of the routing graph, source and target are node indexes
+     */
+    struct OSMSCOUT_IMPORT_API InputEdge
+    {
+      uint32_t      source;  //!< Index of the source node
+      uint32_t      target;  //!< Index of the target node
+      double        costs;   //!< Costs of the edge
+      ObjectFileRef object;  //!< Object (way/area) of the edge
+    };
+
+  private:
+    struct RouterGraph;
+
+  private:
+    bool ReadRouteGraph(const TypeConfigRef& typeConfig,
+                        const ImportParameter& parameter,
+                        const ImportParameter::Router& router,
+                        Progress& progress,
+                        RouterGraph& graph);
+
+    bool WriteContractionHierarchies(const std::string& filename,
+                                     Progress& progress,
+                                     const std::vector<ContractionHierarchyRef>& hierarchies);
+
+  public:
+    static FastestPathRoutingProfileRef CreateProfile(const TypeConfigRef& typeConfig,
+                                                      Vehicle vehicle);
+
+    static void Contract(size_t nodeCount,
+                         const std::vector<InputEdge>& edges,
+                         Progress& progress,
+                         ContractionHierarchy& hierarchy);
+
+    void GetDescription(const ImportParameter& parameter,
+                        ImportModuleDescription& description) const override;
+
+    bool Import(const TypeConfigRef& typeConfig,
+                const ImportParameter& parameter,
+                Progress& progress) override;
+  };
+}
+
+#endif
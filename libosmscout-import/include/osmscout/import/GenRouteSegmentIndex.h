@@ -0,0 +1,71 @@
+#ifndef OSMSCOUT_IMPORT_GENROUTESEGMENTINDEX_H
+#define OSMSCOUT_IMPORT_GENROUTESEGMENTINDEX_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <string>
+#include <vector>
+
+#include <osmscout/routing/RouteSegmentIndex.h>
+
+#include <osmscout/import/Import.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * Generates the spatial index of all routable way segments (RouteSegmentIndex) for
+   * all routers, based on the route nodes written by the RouteDataGenerator.
+   *
+   * Only ways with at least one route node are indexed, since positions on other
+   * ways cannot be used as start or target of a route.
+   */
+  class OSMSCOUT_IMPORT_API RouteSegmentIndexGenerator CLASS_FINAL : public ImportModule
+  {
+  private:
+    bool ReadRouteNodeIds(const ImportParameter& parameter,
+                          const ImportParameter::Router& router,
+                          Progress& progress,
+                          std::vector<Id>& routeNodeIds);
+
+    bool ReadSegments(const TypeConfigRef& typeConfig,
+                      const ImportParameter& parameter,
+                      const ImportParameter::Router& router,
+                      const std::vector<Id>& routeNodeIds,
+                      Progress& progress,
+                      std::vector<RouteSegment>& segments);
+
+  public:
+    static bool WriteIndex(const std::string& filename,
+                           VehicleMask vehicleMask,
+                           std::vector<RouteSegment>& segments,
+                           Progress& progress);
+
+    void GetDescription(const ImportParameter& parameter,
+                        ImportModuleDescription& description) const override;
+
+    bool Import(const TypeConfigRef& typeConfig,
+                const ImportParameter& parameter,
+                Progress& progress) override;
+  };
+}
+
+#endif
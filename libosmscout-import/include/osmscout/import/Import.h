@@ -101,6 +101,16 @@ namespace osmscout {
       {
         return filenamebase+".idx";
       }
+
+      inline std::string GetContractionHierarchyFilename() const
+      {
+        return filenamebase+"_ch.dat";
+      }
+
+      inline std::string GetSegmentIndexFilename() const
+      {
+        return filenamebase+"_segment.idx";
+      }
     };
 
     typedef std::shared_ptr<Router> RouterRef;
@@ -176,6 +186,7 @@ namespace osmscout {
 
     size_t                       routeNodeBlockSize;       //<! Number of route nodes loaded during import until ways get resolved
     uint32_t                     routeNodeTileMag;         //<! Size of a routing tile
+    bool                         routerContractionHierarchy; //<! Generate contraction hierarchies for the routers
 
     AssumeLandStrategy           assumeLand;               //<! During sea/land detection,we either trust coastlines only or make some
                                                            //<! assumptions which tiles are sea and which are land.
@@ -259,6 +270,7 @@ namespace osmscout {
 
     size_t GetRouteNodeBlockSize() const;
     uint32_t GetRouteNodeTileMag() const;
+    bool GetRouterContractionHierarchy() const;
 
     AssumeLandStrategy GetAssumeLand() const;
 
@@ -334,6 +346,7 @@ namespace osmscout {
 
     void SetRouteNodeBlockSize(size_t blockSize);
     void SetRouteNodeTileMag(uint32_t routeNodeTileMag);
+    void SetRouterContractionHierarchy(bool routerContractionHierarchy);
 
     void SetAssumeLand(AssumeLandStrategy assumeLand);
 
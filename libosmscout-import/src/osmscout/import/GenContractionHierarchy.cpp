@@ -0,0 +1,700 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/import/GenContractionHierarchy.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+
+#include <osmscout/ObjectVariantDataFile.h>
+
+#include <osmscout/routing/RouteNode.h>
+#include <osmscout/routing/RoutingService.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+
+namespace osmscout {
+
+  /**
+   * Maximum number of nodes settled by a witness search. A higher value
+   * results in less (unnecessary) shortcuts but a slower contraction.
+   */
+  static const size_t witnessSettleLimit=500;
+
+  /**
+   * The route graph of one router as required for contraction
+   */
+  struct ContractionHierarchyGenerator::RouterGraph
+  {
+    std::vector<Id>                          ids;      //!< Sorted route node ids
+    std::vector<uint8_t>                     excludes; //!< Per route node, 1 if it has turn restrictions
+    std::map<Vehicle,std::vector<InputEdge>> edges;    //!< Edges per vehicle
+  };
+
+  /**
+   * An arc of the graph during contraction
+   */
+  struct ContractionArc
+  {
+    uint32_t      node;    //!< The other node of the arc
+    uint32_t      middle;  //!< Contracted node of a shortcut or noNode
+    double        costs;   //!< Costs of the arc
+    ObjectFileRef object;  //!< Object of an original arc
+  };
+
+  /**
+   * The remaining (not yet contracted) graph during contraction
+   */
+  class ContractionGraph CLASS_FINAL
+  {
+  public:
+    std::vector<std::vector<ContractionArc>> outArcs;
+    std::vector<std::vector<ContractionArc>> inArcs;
+    std::vector<bool>                        contracted;
+    std::vector<uint32_t>                    deletedNeighbours;
+
+  private:
+    typedef std::pair<double,uint32_t> QueueEntry;
+
+    std::vector<double>   witnessCosts; //!< Costs of the witness search, max() for unvisited nodes
+    std::vector<uint32_t> visited;      //!< Nodes with costs set by the last witness search
+
+  private:
+    static ContractionArc* FindArc(std::vector<ContractionArc>& arcs,
+                                   uint32_t node)
+    {
+      for (auto& arc : arcs) {
+        if (arc.node==node) {
+          return &arc;
+        }
+      }
+
+      return nullptr;
+    }
+
+    static void RemoveArcs(std::vector<ContractionArc>& arcs,
+                           uint32_t node)
+    {
+      arcs.erase(std::remove_if(arcs.begin(),
+                                arcs.end(),
+                                [node](const ContractionArc& arc) {
+                                  return arc.node==node;
+                                }),
+                 arcs.end());
+    }
+
+  public:
+    explicit ContractionGraph(size_t nodeCount)
+    : outArcs(nodeCount),
+      inArcs(nodeCount),
+      contracted(nodeCount,false),
+      deletedNeighbours(nodeCount,0),
+      witnessCosts(nodeCount,std::numeric_limits<double>::max())
+    {
+      // no code
+    }
+
+    /**
+     * Add an arc, if there is already an arc between the nodes only the
+     * cheaper one is kept
+     */
+    void AddArc(uint32_t from,
+                uint32_t to,
+                double costs,
+                uint32_t middle,
+                const ObjectFileRef& object)
+    {
+      ContractionArc* outArc=FindArc(outArcs[from],to);
+
+      if (outArc!=nullptr) {
+        if (outArc->costs<=costs) {
+          return;
+        }
+
+        ContractionArc* inArc=FindArc(inArcs[to],from);
+
+        outArc->costs=costs;
+        outArc->middle=middle;
+        outArc->object=object;
+
+        inArc->costs=costs;
+        inArc->middle=middle;
+        inArc->object=object;
+
+        return;
+      }
+
+      outArcs[from].push_back(ContractionArc{to,middle,costs,object});
+      inArcs[to].push_back(ContractionArc{from,middle,costs,object});
+    }
+
+    /**
+     * Bounded Dijkstra from source in the remaining graph ignoring the node
+     * to be contracted. Afterwards witnessCosts contains the costs for all
+     * settled nodes.
+     */
+    void WitnessSearch(uint32_t source,
+                       uint32_t ignoredNode,
+                       double maxCosts)
+    {
+      for (uint32_t node : visited) {
+        witnessCosts[node]=std::numeric_limits<double>::max();
+      }
+
+      visited.clear();
+
+      std::priority_queue<QueueEntry,std::vector<QueueEntry>,std::greater<QueueEntry>> queue;
+      size_t                                                                          settled=0;
+
+      witnessCosts[source]=0.0;
+      visited.push_back(source);
+      queue.push(std::make_pair(0.0,source));
+
+      while (!queue.empty() &&
+             settled<witnessSettleLimit) {
+        QueueEntry entry=queue.top();
+
+        queue.pop();
+
+        if (entry.first>witnessCosts[entry.second]) {
+          continue;
+        }
+
+        if (entry.first>maxCosts) {
+          break;
+        }
+
+        settled++;
+
+        for (const auto& arc : outArcs[entry.second]) {
+          if (arc.node==ignoredNode) {
+            continue;
+          }
+
+          double costs=entry.first+arc.costs;
+
+          if (costs<witnessCosts[arc.node]) {
+            if (witnessCosts[arc.node]==std::numeric_limits<double>::max()) {
+              visited.push_back(arc.node);
+            }
+
+            witnessCosts[arc.node]=costs;
+            queue.push(std::make_pair(costs,arc.node));
+          }
+        }
+      }
+    }
+
+    /**
+     * Contract the given node (or only count the required shortcuts, if
+     * simulate is true) and return the number of shortcuts
+     */
+    size_t Contract(uint32_t node,
+                    bool simulate)
+    {
+      size_t shortcutCount=0;
+      double maxOutCosts=0.0;
+
+      for (const auto& outArc : outArcs[node]) {
+        maxOutCosts=std::max(maxOutCosts,outArc.costs);
+      }
+
+      // Copy, since adding shortcuts may change the arcs of node
+      std::vector<ContractionArc> in(inArcs[node]);
+      std::vector<ContractionArc> out(outArcs[node]);
+
+      for (const auto& inArc : in) {
+        WitnessSearch(inArc.node,
+                      node,
+                      inArc.costs+maxOutCosts);
+
+        for (const auto& outArc : out) {
+          if (outArc.node==inArc.node) {
+            continue;
+          }
+
+          double costs=inArc.costs+outArc.costs;
+
+          if (witnessCosts[outArc.node]<=costs) {
+            continue;
+          }
+
+          shortcutCount++;
+
+          if (!simulate) {
+            AddArc(inArc.node,
+                   outArc.node,
+                   costs,
+                   node,
+                   ObjectFileRef());
+          }
+        }
+      }
+
+      return shortcutCount;
+    }
+
+    int GetPriority(uint32_t node)
+    {
+      size_t shortcutCount=Contract(node,true);
+
+      return (int)shortcutCount-(int)(inArcs[node].size()+outArcs[node].size())+(int)deletedNeighbours[node];
+    }
+
+    /**
+     * Remove the node from the remaining graph after it was contracted
+     */
+    void Remove(uint32_t node)
+    {
+      contracted[node]=true;
+
+      for (const auto& arc : outArcs[node]) {
+        RemoveArcs(inArcs[arc.node],node);
+        deletedNeighbours[arc.node]++;
+      }
+
+      for (const auto& arc : inArcs[node]) {
+        RemoveArcs(outArcs[arc.node],node);
+        deletedNeighbours[arc.node]++;
+      }
+
+      outArcs[node].clear();
+      outArcs[node].shrink_to_fit();
+      inArcs[node].clear();
+      inArcs[node].shrink_to_fit();
+    }
+  };
+
+  static void GetCarSpeedTable(std::map<std::string,double>& map)
+  {
+    map["highway_motorway"]=110.0;
+    map["highway_motorway_trunk"]=100.0;
+    map["highway_motorway_primary"]=70.0;
+    map["highway_motorway_link"]=60.0;
+    map["highway_motorway_junction"]=60.0;
+    map["highway_trunk"]=100.0;
+    map["highway_trunk_link"]=60.0;
+    map["highway_primary"]=70.0;
+    map["highway_primary_link"]=60.0;
+    map["highway_secondary"]=60.0;
+    map["highway_secondary_link"]=50.0;
+    map["highway_tertiary"]=55.0;
+    map["highway_tertiary_link"]=55.0;
+    map["highway_unclassified"]=50.0;
+    map["highway_road"]=50.0;
+    map["highway_residential"]=40.0;
+    map["highway_roundabout"]=40.0;
+    map["highway_living_street"]=10.0;
+    map["highway_service"]=30.0;
+  }
+
+  /**
+   * Create the profile the contraction hierarchy of the given vehicle is
+   * build for. Routing clients must use a profile with the same parameters
+   * to benefit from the hierarchy.
+   */
+  FastestPathRoutingProfileRef ContractionHierarchyGenerator::CreateProfile(const TypeConfigRef& typeConfig,
+                                                                           Vehicle vehicle)
+  {
+    FastestPathRoutingProfileRef profile=std::make_shared<FastestPathRoutingProfile>(typeConfig);
+
+    switch (vehicle) {
+    case vehicleFoot:
+      profile->ParametrizeForFoot(*typeConfig,
+                                  5.0);
+      break;
+    case vehicleBicycle:
+      profile->ParametrizeForBicycle(*typeConfig,
+                                     20.0);
+      break;
+    case vehicleCar: {
+      std::map<std::string,double> carSpeedTable;
+
+      GetCarSpeedTable(carSpeedTable);
+
+      if (!profile->ParametrizeForCar(*typeConfig,
+                                      carSpeedTable,
+                                      160.0)) {
+        return nullptr;
+      }
+      break;
+    }
+    }
+
+    return profile;
+  }
+
+  /**
+   * Contract the graph with the given number of nodes and edges and store the
+   * resulting up and down edges in the hierarchy.
+   *
+   * Nodes are contracted in the order of their edge difference (shortcuts
+   * required minus edges removed) plus the number of already contracted
+   * neighbours. The priority of a node is updated lazily when it is taken
+   * from the queue.
+   */
+  void ContractionHierarchyGenerator::Contract(size_t nodeCount,
+                                               const std::vector<InputEdge>& edges,
+                                               Progress& progress,
+                                               ContractionHierarchy& hierarchy)
+  {
+    typedef std::pair<int,uint32_t> QueueEntry;
+
+    ContractionGraph                                    graph(nodeCount);
+    std::vector<std::vector<ContractionHierarchy::Edge>> up(nodeCount);
+    std::vector<std::vector<ContractionHierarchy::Edge>> down(nodeCount);
+    std::priority_queue<QueueEntry,std::vector<QueueEntry>,std::greater<QueueEntry>> queue;
+
+    for (const auto& edge : edges) {
+      if (edge.source!=edge.target) {
+        graph.AddArc(edge.source,
+                     edge.target,
+                     edge.costs,
+                     ContractionHierarchy::noNode,
+                     edge.object);
+      }
+    }
+
+    for (uint32_t node=0; node<nodeCount; node++) {
+      queue.push(std::make_pair(graph.GetPriority(node),node));
+    }
+
+    size_t contractedCount=0;
+    size_t shortcutCount=0;
+
+    while (!queue.empty()) {
+      uint32_t node=queue.top().second;
+
+      queue.pop();
+
+      if (graph.contracted[node]) {
+        continue;
+      }
+
+      int priority=graph.GetPriority(node);
+
+      if (!queue.empty() &&
+          priority>queue.top().first) {
+        queue.push(std::make_pair(priority,node));
+        continue;
+      }
+
+      progress.SetProgress(contractedCount,nodeCount);
+
+      shortcutCount+=graph.Contract(node,false);
+
+      for (const auto& arc : graph.outArcs[node]) {
+        up[node].push_back(ContractionHierarchy::Edge{arc.node,arc.middle,arc.costs,arc.object});
+      }
+
+      for (const auto& arc : graph.inArcs[node]) {
+        down[node].push_back(ContractionHierarchy::Edge{arc.node,arc.middle,arc.costs,arc.object});
+      }
+
+      graph.Remove(node);
+
+      contractedCount++;
+    }
+
+    std::vector<uint32_t>                   upOffsets(nodeCount+1);
+    std::vector<ContractionHierarchy::Edge> upEdges;
+    std::vector<uint32_t>                   downOffsets(nodeCount+1);
+    std::vector<ContractionHierarchy::Edge> downEdges;
+
+    for (size_t node=0; node<nodeCount; node++) {
+      upOffsets[node]=(uint32_t)upEdges.size();
+      upEdges.insert(upEdges.end(),up[node].begin(),up[node].end());
+      up[node].clear();
+      up[node].shrink_to_fit();
+
+      downOffsets[node]=(uint32_t)downEdges.size();
+      downEdges.insert(downEdges.end(),down[node].begin(),down[node].end());
+      down[node].clear();
+      down[node].shrink_to_fit();
+    }
+
+    upOffsets[nodeCount]=(uint32_t)upEdges.size();
+    downOffsets[nodeCount]=(uint32_t)downEdges.size();
+
+    progress.Info(std::to_string(shortcutCount)+" shortcut(s) added");
+
+    hierarchy.SetEdges(std::move(upOffsets),
+                       std::move(upEdges),
+                       std::move(downOffsets),
+                       std::move(downEdges));
+  }
+
+  void ContractionHierarchyGenerator::GetDescription(const ImportParameter& parameter,
+                                                     ImportModuleDescription& description) const
+  {
+    description.SetName("ContractionHierarchyGenerator");
+    description.SetDescription("Generate contraction hierarchies for the routing graph(s)");
+
+    for (const auto& router : parameter.GetRouter()) {
+      description.AddRequiredFile(router.GetDataFilename());
+      description.AddRequiredFile(router.GetVariantFilename());
+
+      if (parameter.GetRouterContractionHierarchy()) {
+        description.AddProvidedFile(router.GetContractionHierarchyFilename());
+      }
+    }
+  }
+
+  /**
+   * Read all route nodes of the route graph of the router and collect
+   * the edges usable by each vehicle of the router
+   */
+  bool ContractionHierarchyGenerator::ReadRouteGraph(const TypeConfigRef& typeConfig,
+                                                     const ImportParameter& parameter,
+                                                     const ImportParameter::Router& router,
+                                                     Progress& progress,
+                                                     RouterGraph& graph)
+  {
+    ObjectVariantDataFile                         objectVariantDataFile;
+    std::map<Vehicle,FastestPathRoutingProfileRef> profiles;
+
+    if (!objectVariantDataFile.Load(*typeConfig,
+                                    AppendFileToDir(parameter.GetDestinationDirectory(),
+                                                    router.GetVariantFilename()))) {
+      progress.Error("Cannot load object variant data of router '"+router.GetFilenamebase()+"'");
+      return false;
+    }
+
+    for (Vehicle vehicle : {vehicleFoot,vehicleBicycle,vehicleCar}) {
+      if ((router.GetVehicleMask() & vehicle)==0) {
+        continue;
+      }
+
+      FastestPathRoutingProfileRef profile=CreateProfile(typeConfig,
+                                                         vehicle);
+
+      if (!profile) {
+        progress.Error("Cannot create routing profile");
+        return false;
+      }
+
+      profiles[vehicle]=profile;
+    }
+
+    const std::vector<ObjectVariantData>& objectVariantData=objectVariantDataFile.GetData();
+    FileScanner                           scanner;
+
+    struct RawEdge
+    {
+      Id            source;
+      Id            target;
+      double        costs;
+      ObjectFileRef object;
+    };
+
+    std::map<Vehicle,std::vector<RawEdge>> rawEdges;
+    std::vector<std::pair<Id,uint8_t>>     nodes;
+
+    try {
+      FileOffset indexFileOffset;
+      uint32_t   nodeCount;
+      uint32_t   tileMag;
+
+      scanner.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                   router.GetDataFilename()),
+                   FileScanner::Sequential,
+                   true);
+
+      scanner.Read(indexFileOffset);
+      scanner.Read(nodeCount);
+      scanner.Read(tileMag);
+
+      nodes.reserve(nodeCount);
+
+      for (uint32_t n=0; n<nodeCount; n++) {
+        RouteNode routeNode;
+
+        progress.SetProgress(n,nodeCount);
+
+        routeNode.Read(scanner);
+
+        nodes.emplace_back(routeNode.GetId(),
+                           routeNode.excludes.empty() ? 0 : 1);
+
+        for (const auto& entry : profiles) {
+          for (size_t i=0; i<routeNode.paths.size(); i++) {
+            const RouteNode::Path& path=routeNode.paths[i];
+
+            // Restricted paths are only usable for routes to or from them,
+            // the routing graph handles such routes
+            if (path.IsRestricted(entry.first) ||
+                !entry.second->CanUse(routeNode,objectVariantData,i)) {
+              continue;
+            }
+
+            rawEdges[entry.first].push_back(RawEdge{routeNode.GetId(),
+                                                    path.id,
+                                                    entry.second->GetCosts(routeNode,objectVariantData,i),
+                                                    routeNode.objects[path.objectIndex].object});
+          }
+        }
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      scanner.CloseFailsafe();
+      return false;
+    }
+
+    std::sort(nodes.begin(),nodes.end());
+
+    graph.ids.reserve(nodes.size());
+    graph.excludes.reserve(nodes.size());
+
+    for (const auto& node : nodes) {
+      graph.ids.push_back(node.first);
+      graph.excludes.push_back(node.second);
+    }
+
+    for (auto& entry : rawEdges) {
+      std::vector<InputEdge>& edges=graph.edges[entry.first];
+
+      edges.reserve(entry.second.size());
+
+      for (const auto& rawEdge : entry.second) {
+        auto source=std::lower_bound(graph.ids.begin(),graph.ids.end(),rawEdge.source);
+        auto target=std::lower_bound(graph.ids.begin(),graph.ids.end(),rawEdge.target);
+
+        if (target==graph.ids.end() ||
+            *target!=rawEdge.target) {
+          continue;
+        }
+
+        edges.push_back(InputEdge{(uint32_t)(source-graph.ids.begin()),
+                                  (uint32_t)(target-graph.ids.begin()),
+                                  rawEdge.costs,
+                                  rawEdge.object});
+      }
+
+      entry.second.clear();
+      entry.second.shrink_to_fit();
+    }
+
+    for (const auto& entry : profiles) {
+      graph.edges[entry.first];
+    }
+
+    progress.Info(std::to_string(graph.ids.size())+" route node(s) read");
+
+    return true;
+  }
+
+  bool ContractionHierarchyGenerator::WriteContractionHierarchies(const std::string& filename,
+                                                                  Progress& progress,
+                                                                  const std::vector<ContractionHierarchyRef>& hierarchies)
+  {
+    FileWriter writer;
+
+    try {
+      writer.Open(filename);
+
+      writer.Write(ContractionHierarchy::fileFormatVersion);
+      writer.Write((uint32_t)hierarchies.size());
+
+      for (const auto& hierarchy : hierarchies) {
+        hierarchy->Write(writer);
+      }
+
+      writer.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      writer.CloseFailsafe();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool ContractionHierarchyGenerator::Import(const TypeConfigRef& typeConfig,
+                                             const ImportParameter& parameter,
+                                             Progress& progress)
+  {
+    if (!parameter.GetRouterContractionHierarchy()) {
+      progress.Info("Generation of contraction hierarchies is disabled");
+      return true;
+    }
+
+    for (const auto& router : parameter.GetRouter()) {
+      RouterGraph                          graph;
+      std::vector<ContractionHierarchyRef> hierarchies;
+
+      progress.SetAction("Reading route graph '"+router.GetDataFilename()+"'");
+
+      if (!ReadRouteGraph(typeConfig,
+                          parameter,
+                          router,
+                          progress,
+                          graph)) {
+        return false;
+      }
+
+      for (auto& entry : graph.edges) {
+        ContractionHierarchyRef      hierarchy=std::make_shared<ContractionHierarchy>();
+        FastestPathRoutingProfileRef profile=CreateProfile(typeConfig,
+                                                           entry.first);
+
+        progress.SetAction("Contracting route graph '"+router.GetDataFilename()+"' for vehicle "+std::to_string((int)entry.first));
+
+        hierarchy->SetMetric(entry.first,
+                             profile->GetVehicleMaxSpeed(),
+                             profile->GetSpeeds());
+        hierarchy->SetNodes(std::vector<Id>(graph.ids),
+                            std::vector<uint8_t>(graph.excludes));
+
+        Contract(graph.ids.size(),
+                 entry.second,
+                 progress,
+                 *hierarchy);
+
+        entry.second.clear();
+        entry.second.shrink_to_fit();
+
+        progress.Info(std::to_string(hierarchy->GetEdgeCount())+" edge(s) in hierarchy");
+
+        hierarchies.push_back(hierarchy);
+      }
+
+      std::string filename=AppendFileToDir(parameter.GetDestinationDirectory(),
+                                           router.GetContractionHierarchyFilename());
+
+      progress.SetAction("Writing contraction hierarchies '"+filename+"'");
+
+      if (!WriteContractionHierarchies(filename,
+                                       progress,
+                                       hierarchies)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+}
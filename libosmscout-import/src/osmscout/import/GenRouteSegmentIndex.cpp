@@ -0,0 +1,463 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/import/GenRouteSegmentIndex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <osmscout/FeatureReader.h>
+#include <osmscout/TypeFeatures.h>
+#include <osmscout/Way.h>
+#include <osmscout/WayDataFile.h>
+
+#include <osmscout/routing/RouteNode.h>
+
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+
+namespace osmscout {
+
+  /**
+   * Size of the grid (in each dimension) the segment centers are mapped
+   * to for calculation of their Hilbert value
+   */
+  static const uint32_t hilbertGridSize=1 << 16;
+
+  /**
+   * Return the distance of the given cell along the Hilbert curve through the grid
+   */
+  static uint64_t GetHilbertValue(uint32_t x,
+                                  uint32_t y)
+  {
+    uint64_t value=0;
+
+    for (uint32_t s=hilbertGridSize/2; s>0; s/=2) {
+      uint32_t rx=(x & s)>0 ? 1 : 0;
+      uint32_t ry=(y & s)>0 ? 1 : 0;
+
+      value+=(uint64_t)s*s*((3*rx)^ry);
+
+      if (ry==0) {
+        if (rx==1) {
+          x=hilbertGridSize-1-x;
+          y=hilbertGridSize-1-y;
+        }
+
+        std::swap(x,y);
+      }
+    }
+
+    return value;
+  }
+
+  static uint64_t GetHilbertValue(const RouteSegment& segment)
+  {
+    double lat=(segment.from.GetLat()+segment.to.GetLat())/2.0;
+    double lon=(segment.from.GetLon()+segment.to.GetLon())/2.0;
+    auto   x=(uint32_t)std::max(0.0,std::min((double)(hilbertGridSize-1),(lon+180.0)/360.0*hilbertGridSize));
+    auto   y=(uint32_t)std::max(0.0,std::min((double)(hilbertGridSize-1),(lat+90.0)/180.0*hilbertGridSize));
+
+    return GetHilbertValue(x,y);
+  }
+
+  /**
+   * Return a node with an empty bounding box and no access
+   */
+  static RouteSegmentIndex::Node CreateEmptyNode()
+  {
+    RouteSegmentIndex::Node node;
+
+    node.minLat=std::numeric_limits<uint32_t>::max();
+    node.minLon=std::numeric_limits<uint32_t>::max();
+    node.maxLat=0;
+    node.maxLon=0;
+    node.access=0;
+
+    return node;
+  }
+
+  /**
+   * Extend the bounding box of the node by the given coordinate
+   * in data file encoding
+   */
+  static void ExtendNode(RouteSegmentIndex::Node& node,
+                         const GeoCoord& coord)
+  {
+    auto lat=(uint32_t)round((coord.GetLat()+90.0)*latConversionFactor);
+    auto lon=(uint32_t)round((coord.GetLon()+180.0)*lonConversionFactor);
+
+    node.minLat=std::min(node.minLat,lat);
+    node.minLon=std::min(node.minLon,lon);
+    node.maxLat=std::max(node.maxLat,lat);
+    node.maxLon=std::max(node.maxLon,lon);
+  }
+
+  void RouteSegmentIndexGenerator::GetDescription(const ImportParameter& parameter,
+                                                  ImportModuleDescription& description) const
+  {
+    description.SetName("RouteSegmentIndexGenerator");
+    description.SetDescription("Generate spatial index of the routable way segments");
+
+    description.AddRequiredFile(WayDataFile::WAYS_DAT);
+
+    for (const auto& router : parameter.GetRouter()) {
+      description.AddRequiredFile(router.GetDataFilename());
+      description.AddProvidedFile(router.GetSegmentIndexFilename());
+    }
+  }
+
+  /**
+   * Read the ids of all route nodes of the router
+   */
+  bool RouteSegmentIndexGenerator::ReadRouteNodeIds(const ImportParameter& parameter,
+                                                    const ImportParameter::Router& router,
+                                                    Progress& progress,
+                                                    std::vector<Id>& routeNodeIds)
+  {
+    FileScanner scanner;
+
+    try {
+      FileOffset indexFileOffset;
+      uint32_t   nodeCount;
+      uint32_t   tileMag;
+
+      scanner.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                   router.GetDataFilename()),
+                   FileScanner::Sequential,
+                   true);
+
+      scanner.Read(indexFileOffset);
+      scanner.Read(nodeCount);
+      scanner.Read(tileMag);
+
+      routeNodeIds.reserve(nodeCount);
+
+      for (uint32_t n=0; n<nodeCount; n++) {
+        RouteNode routeNode;
+
+        progress.SetProgress(n,nodeCount);
+
+        routeNode.Read(scanner);
+
+        routeNodeIds.push_back(routeNode.GetId());
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      scanner.CloseFailsafe();
+      return false;
+    }
+
+    std::sort(routeNodeIds.begin(),
+              routeNodeIds.end());
+
+    progress.Info(std::to_string(routeNodeIds.size())+" route node(s) read");
+
+    return true;
+  }
+
+  /**
+   * Read all ways routable by the router and create one segment for each pair of
+   * consecutive nodes of ways with at least one route node
+   */
+  bool RouteSegmentIndexGenerator::ReadSegments(const TypeConfigRef& typeConfig,
+                                                const ImportParameter& parameter,
+                                                const ImportParameter::Router& router,
+                                                const std::vector<Id>& routeNodeIds,
+                                                Progress& progress,
+                                                std::vector<RouteSegment>& segments)
+  {
+    AccessFeatureValueReader accessReader(*typeConfig);
+    FileScanner              scanner;
+
+    try {
+      uint32_t dataCount=0;
+
+      scanner.Open(AppendFileToDir(parameter.GetDestinationDirectory(),
+                                   WayDataFile::WAYS_DAT),
+                   FileScanner::Sequential,
+                   parameter.GetWayDataMemoryMaped());
+
+      scanner.Read(dataCount);
+
+      for (uint32_t d=1; d<=dataCount; d++) {
+        progress.SetProgress(d,dataCount);
+
+        Way way;
+
+        way.Read(*typeConfig,
+                 scanner);
+
+        if (way.GetType()->GetIgnore() ||
+            way.nodes.size()<2) {
+          continue;
+        }
+
+        AccessFeatureValue* accessValue=accessReader.GetValue(way.GetFeatureValueBuffer());
+        AccessFeatureValue  access=accessValue!=nullptr ? *accessValue : AccessFeatureValue(way.GetType()->GetDefaultAccess());
+
+        if (!access.CanRoute(router.GetVehicleMask())) {
+          continue;
+        }
+
+        std::vector<uint32_t> routeNodeIndexes;
+
+        for (size_t i=0; i<way.nodes.size(); i++) {
+          if (way.nodes[i].IsRelevant() &&
+              std::binary_search(routeNodeIds.begin(),
+                                 routeNodeIds.end(),
+                                 way.nodes[i].GetId())) {
+            routeNodeIndexes.push_back((uint32_t)i);
+          }
+        }
+
+        if (routeNodeIndexes.empty()) {
+          continue;
+        }
+
+        RouteSegment segment;
+        size_t       nextRouteNode=0;
+
+        segment.way=way.GetFileOffset();
+        segment.typeIndex=(uint16_t)way.GetType()->GetIndex();
+        segment.access=access.GetAccess();
+
+        for (size_t i=0; i<way.nodes.size()-1; i++) {
+          while (nextRouteNode<routeNodeIndexes.size() &&
+                 routeNodeIndexes[nextRouteNode]<i+1) {
+            nextRouteNode++;
+          }
+
+          segment.from=way.nodes[i].GetCoord();
+          segment.to=way.nodes[i+1].GetCoord();
+          segment.nodeIndex=(uint32_t)i;
+
+          if (nextRouteNode>0) {
+            segment.prevRouteNodeIndex=routeNodeIndexes[nextRouteNode-1];
+            segment.prevRouteNode=way.nodes[segment.prevRouteNodeIndex].GetId();
+          }
+          else {
+            segment.prevRouteNodeIndex=0;
+            segment.prevRouteNode=0;
+          }
+
+          if (nextRouteNode<routeNodeIndexes.size()) {
+            segment.nextRouteNodeIndex=routeNodeIndexes[nextRouteNode];
+            segment.nextRouteNode=way.nodes[segment.nextRouteNodeIndex].GetId();
+          }
+          else {
+            segment.nextRouteNodeIndex=0;
+            segment.nextRouteNode=0;
+          }
+
+          segments.push_back(segment);
+        }
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      scanner.CloseFailsafe();
+      return false;
+    }
+
+    progress.Info(std::to_string(segments.size())+" segment(s) read");
+
+    return true;
+  }
+
+  /**
+   * Sort the segments along the Hilbert curve, build the packed tree bottom up and
+   * write the index file (see RouteSegmentIndex).
+   *
+   * @param filename
+   *    Name of the index file
+   * @param vehicleMask
+   *    Vehicles the segments were selected for
+   * @param segments
+   *    The segments, sorted by the method
+   * @param progress
+   *    Progress for error reporting
+   * @return
+   *    false on error, else true
+   */
+  bool RouteSegmentIndexGenerator::WriteIndex(const std::string& filename,
+                                              VehicleMask vehicleMask,
+                                              std::vector<RouteSegment>& segments,
+                                              Progress& progress)
+  {
+    if (segments.size()>std::numeric_limits<uint32_t>::max()) {
+      progress.Error("Too many segments for route segment index");
+      return false;
+    }
+
+    std::vector<std::pair<uint64_t,size_t>> order;
+
+    order.reserve(segments.size());
+
+    for (size_t i=0; i<segments.size(); i++) {
+      order.emplace_back(GetHilbertValue(segments[i]),i);
+    }
+
+    std::sort(order.begin(),
+              order.end());
+
+    std::vector<RouteSegment> sorted;
+
+    sorted.reserve(segments.size());
+
+    for (const auto& entry : order) {
+      sorted.push_back(segments[entry.second]);
+    }
+
+    segments.swap(sorted);
+    sorted.clear();
+    sorted.shrink_to_fit();
+
+    std::vector<std::vector<RouteSegmentIndex::Node>> levels;
+
+    if (!segments.empty()) {
+      std::vector<RouteSegmentIndex::Node> leaves;
+
+      for (size_t i=0; i<segments.size(); i+=RouteSegmentIndex::nodeSize) {
+        RouteSegmentIndex::Node node=CreateEmptyNode();
+        size_t                  last=std::min(i+RouteSegmentIndex::nodeSize,segments.size());
+
+        for (size_t s=i; s<last; s++) {
+          ExtendNode(node,segments[s].from);
+          ExtendNode(node,segments[s].to);
+          node.access|=segments[s].access;
+        }
+
+        leaves.push_back(node);
+      }
+
+      levels.push_back(leaves);
+
+      while (levels.back().size()>1) {
+        const std::vector<RouteSegmentIndex::Node>& children=levels.back();
+        std::vector<RouteSegmentIndex::Node>        parents;
+
+        for (size_t i=0; i<children.size(); i+=RouteSegmentIndex::nodeSize) {
+          RouteSegmentIndex::Node node=CreateEmptyNode();
+          size_t                  last=std::min(i+RouteSegmentIndex::nodeSize,children.size());
+
+          for (size_t c=i; c<last; c++) {
+            node.minLat=std::min(node.minLat,children[c].minLat);
+            node.minLon=std::min(node.minLon,children[c].minLon);
+            node.maxLat=std::max(node.maxLat,children[c].maxLat);
+            node.maxLon=std::max(node.maxLon,children[c].maxLon);
+            node.access|=children[c].access;
+          }
+
+          parents.push_back(node);
+        }
+
+        levels.push_back(parents);
+      }
+    }
+
+    FileWriter writer;
+
+    try {
+      writer.Open(filename);
+
+      writer.Write(RouteSegmentIndex::fileFormatVersion);
+      writer.Write(vehicleMask);
+      writer.Write((uint32_t)segments.size());
+      writer.Write((uint32_t)levels.size());
+
+      for (const auto& level : levels) {
+        writer.Write((uint32_t)level.size());
+      }
+
+      for (const auto& level : levels) {
+        for (const auto& node : level) {
+          node.Write(writer);
+        }
+      }
+
+      for (const auto& segment : segments) {
+        segment.Write(writer);
+      }
+
+      writer.Close();
+    }
+    catch (IOException& e) {
+      progress.Error(e.GetDescription());
+      writer.CloseFailsafe();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool RouteSegmentIndexGenerator::Import(const TypeConfigRef& typeConfig,
+                                          const ImportParameter& parameter,
+                                          Progress& progress)
+  {
+    for (const auto& router : parameter.GetRouter()) {
+      std::vector<Id>           routeNodeIds;
+      std::vector<RouteSegment> segments;
+
+      progress.SetAction("Reading route nodes '"+router.GetDataFilename()+"'");
+
+      if (!ReadRouteNodeIds(parameter,
+                            router,
+                            progress,
+                            routeNodeIds)) {
+        return false;
+      }
+
+      progress.SetAction("Reading routable way segments");
+
+      if (!ReadSegments(typeConfig,
+                        parameter,
+                        router,
+                        routeNodeIds,
+                        progress,
+                        segments)) {
+        return false;
+      }
+
+      routeNodeIds.clear();
+      routeNodeIds.shrink_to_fit();
+
+      std::string filename=AppendFileToDir(parameter.GetDestinationDirectory(),
+                                           router.GetSegmentIndexFilename());
+
+      progress.SetAction("Writing route segment index '"+filename+"'");
+
+      if (!WriteIndex(filename,
+                      router.GetVehicleMask(),
+                      segments,
+                      progress)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+}
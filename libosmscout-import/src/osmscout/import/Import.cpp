@@ -71,6 +71,8 @@
 // Routing
 #include <osmscout/import/GenRouteDat.h>
 #include <osmscout/import/GenIntersectionIndex.h>
+#include <osmscout/import/GenContractionHierarchy.h>
+#include <osmscout/import/GenRouteSegmentIndex.h>
 
 #if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
 #include <osmscout/import/GenTextIndex.h>
@@ -84,9 +86,9 @@ namespace osmscout {
 
   static const size_t defaultStartStep=1;
 #if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
-  static const size_t defaultEndStep=25;
+  static const size_t defaultEndStep=27;
 #else
-  static const size_t defaultEndStep=24;
+  static const size_t defaultEndStep=26;
 #endif
 
   PreprocessorFactory::~PreprocessorFactory()
@@ -143,6 +145,7 @@ namespace osmscout {
      optimizationWayMethod(TransPolygon::quality),
      routeNodeBlockSize(500000),
      routeNodeTileMag(13),
+     routerContractionHierarchy(false),
      assumeLand(AssumeLandStrategy::automatic),
      langOrder({"#"}),
      maxAdminLevel(10),
@@ -382,6 +385,11 @@ namespace osmscout {
     return routeNodeTileMag;
   }
 
+  bool ImportParameter::GetRouterContractionHierarchy() const
+  {
+    return routerContractionHierarchy;
+  }
+
   ImportParameter::AssumeLandStrategy ImportParameter::GetAssumeLand() const
   {
     return assumeLand;
@@ -641,6 +649,11 @@ namespace osmscout {
     this->routeNodeTileMag=routeNodeTileMag;
   }
 
+  void ImportParameter::SetRouterContractionHierarchy(bool routerContractionHierarchy)
+  {
+    this->routerContractionHierarchy=routerContractionHierarchy;
+  }
+
   void ImportParameter::SetAssumeLand(AssumeLandStrategy assumeLand)
   {
     this->assumeLand=assumeLand;
@@ -877,9 +890,14 @@ namespace osmscout {
     /* 24 */
     modules.push_back(std::make_shared<IntersectionIndexGenerator>());
 
+    /* 25 */
+    modules.push_back(std::make_shared<ContractionHierarchyGenerator>());
+
+    /* 26 */
+    modules.push_back(std::make_shared<RouteSegmentIndexGenerator>());
 
 #if defined(OSMSCOUT_IMPORT_HAVE_LIB_MARISA)
-    /* 25 */
+    /* 27 */
     modules.push_back(std::make_shared<TextIndexGenerator>());
 #endif
   }
@@ -20,6 +20,7 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
@@ -396,6 +397,8 @@ namespace osmscout {
              optimizedWayData.IsEmpty() &&
              optimizedAreaData.IsEmpty();
     }
+
+    size_t GetMemory() const;
   };
 
   /**
@@ -415,6 +418,9 @@ namespace osmscout {
    *
    * The cache will free least recently used tiles first,
    *
+   * Optionally the cache is additionally limited by the estimated memory of the tiles
+   * (see SetMaxMemory()). The memory limit is applied on the next cleanup, too. The memory
+   * usage and the cache statistics can be read without locking.
    */
   class OSMSCOUT_MAP_API DataTileCache
   {
@@ -447,7 +453,11 @@ namespace osmscout {
     typedef std::map<TileKey,CacheRef> CacheIndex;
 
   private:
-    size_t             cacheSize;
+    size_t              cacheSize;
+    std::atomic<size_t> maxMemory;  //!< Maximum estimated memory of the tiles, 0 if unlimited
+    std::atomic<size_t> memory;     //!< Estimated memory of the tiles on the last cleanup
+    mutable std::atomic<size_t> hits;   //!< Number of tiles found in the cache
+    mutable std::atomic<size_t> misses; //!< Number of tiles created
 
     mutable CacheIndex tileIndex;
     mutable Cache      tileCache;
@@ -480,6 +490,28 @@ namespace osmscout {
       return tileCache.size();
     }
 
+    void SetMaxMemory(size_t maxMemory);
+
+    inline size_t GetMaxMemory() const
+    {
+      return maxMemory;
+    }
+
+    inline size_t GetMemory() const
+    {
+      return memory;
+    }
+
+    inline size_t GetHits() const
+    {
+      return hits;
+    }
+
+    inline size_t GetMisses() const
+    {
+      return misses;
+    }
+
     void CleanupCache();
 
     void InvalidateCache();
@@ -21,7 +21,9 @@
 */
 
 #include <list>
+#include <memory>
 #include <string>
+#include <thread>
 
 #include <osmscout/MapImportExport.h>
 
@@ -41,6 +43,7 @@
 #include <osmscout/util/Geometry.h>
 #include <osmscout/util/Projection.h>
 #include <osmscout/util/Transformation.h>
+#include <osmscout/util/WorkQueue.h>
 
 #include <osmscout/system/Compiler.h>
 
@@ -264,6 +267,25 @@ namespace osmscout {
       }
     };
 
+  private:
+    /**
+     * State and result of one thread during parallel preprocessing of ways and
+     * areas. Coordinates are transformed into the own buffer of the worker and
+     * are moved to the coordinate buffer of the painter afterwards.
+     */
+    struct PreprocessWorker
+    {
+      TransBuffer               transBuffer;  //!< Buffer of transformed coordinates of this worker
+      std::vector<LineStyleRef> lineStyles;   //!< Temporary storage for StyleConfig return value
+      std::list<WayData>        wayData;
+      std::list<WayPathData>    wayPathData;
+      std::list<AreaData>       areaData;
+
+      PreprocessWorker();
+    };
+
+    typedef std::shared_ptr<PreprocessWorker> PreprocessWorkerRef;
+
   protected:
     CoordBuffer                  *coordBuffer;      //!< Reference to the coordinate buffer
     TextStyleRef                 debugLabel;
@@ -279,6 +301,10 @@ namespace osmscout {
     std::vector<TextStyleRef>    textStyles;     //!< Temporary storage for StyleConfig return value
     std::vector<LineStyleRef>    lineStyles;     //!< Temporary storage for StyleConfig return value
 
+    std::vector<PreprocessWorkerRef> preprocessWorkers; //!< Workers for parallel preprocessing, reused between draw calls
+    WorkQueue<bool>                  preprocessQueue;   //!< Preprocessing tasks to be executed by the preprocess threads
+    std::vector<std::thread>         preprocessThreads; //!< Threads for parallel preprocessing, started on demand and kept until destruction
+
     /**
       Fallback styles in case they are missing for the style sheet
       */
@@ -361,7 +387,29 @@ namespace osmscout {
                         const MapParameter& parameter,
                         const ObjectFileRef& ref,
                         const FeatureValueBuffer& buffer,
-                        const std::vector<Point>& nodes);
+                        const std::vector<Point>& nodes,
+                        TransBuffer& transBuffer,
+                        std::vector<LineStyleRef>& lineStyles,
+                        std::list<WayData>& wayData,
+                        std::list<WayPathData>& wayPathData);
+
+    void PreprocessThreadLoop();
+
+    size_t GetPreprocessWorkerCount(const MapParameter& parameter,
+                                    size_t objectCount);
+
+    void MergePreprocessWorker(PreprocessWorker& worker);
+
+    /**
+     * Preprocessing of ways and areas in several threads. Registered
+     * FillStyleProcessor instances, the StyleConfig and IsVisibleWay()/IsVisibleArea()
+     * are called concurrently from all threads.
+     */
+    void PrepareWaysParallel(const StyleConfig& styleConfig,
+                             const Projection& projection,
+                             const MapParameter& parameter,
+                             const MapData& data,
+                             size_t workerCount);
 
     void PrepareWays(const StyleConfig& styleConfig,
                      const Projection& projection,
@@ -371,7 +419,15 @@ namespace osmscout {
     void PrepareArea(const StyleConfig& styleConfig,
                      const Projection& projection,
                      const MapParameter& parameter,
-                     const AreaRef &area);
+                     const AreaRef &area,
+                     TransBuffer& transBuffer,
+                     std::list<AreaData>& areaData);
+
+    void PrepareAreasParallel(const StyleConfig& styleConfig,
+                              const Projection& projection,
+                              const MapParameter& parameter,
+                              const MapData& data,
+                              size_t workerCount);
 
     void PrepareAreaLabel(const StyleConfig& styleConfig,
                           const Projection& projection,
@@ -497,6 +553,10 @@ namespace osmscout {
   protected:
     /**
        Useful global helper functions.
+
+       IsVisibleArea() and IsVisibleWay() are called concurrently from the
+       preprocessing threads, if MapParameter::SetPreprocessThreadCount() is >1,
+       so they must not modify the state of the painter.
      */
     //@{
     bool IsVisibleArea(const Projection& projection,
@@ -103,6 +103,8 @@ namespace osmscout {
     bool                                debugData;                 //!< Print out some performance relvant information about the data
     bool                                debugPerformance;          //!< Print out some performance information
 
+    size_t                              preprocessThreadCount;     //!< Number of threads preprocessing ways and areas (default 1, no additional threads), if >1 fill processors must be thread-safe
+
     size_t                              warnObjectCountLimit;      //!< Limit for objects/type. If limit is reached a warning is created
     size_t                              warnCoordCountLimit;       //!< Limit for coords/type. If limit is reached a warning is created
 
@@ -162,6 +164,8 @@ namespace osmscout {
     void SetDebugData(bool debug);
     void SetDebugPerformance(bool debug);
 
+    void SetPreprocessThreadCount(size_t threadCount);
+
     void SetWarningObjectCountLimit(size_t limit);
     void SetWarningCoordCountLimit(size_t limit);
 
@@ -340,6 +344,11 @@ namespace osmscout {
       return debugData;
     }
 
+    inline size_t GetPreprocessThreadCount() const
+    {
+      return preprocessThreadCount;
+    }
+
     inline size_t GetWarningObjectCountLimit() const
     {
       return warnObjectCountLimit;
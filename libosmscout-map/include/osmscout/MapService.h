@@ -35,6 +35,7 @@
 
 #include <osmscout/util/Breaker.h>
 #include <osmscout/util/GeoBox.h>
+#include <osmscout/util/MemoryBudget.h>
 #include <osmscout/util/StopClock.h>
 #include <osmscout/util/WorkQueue.h>
 
@@ -88,8 +89,10 @@ namespace osmscout {
    * - Get objects of a certain type in a given area and impose certain
    * limits on the resulting data (size of area, number of objects,
    * low zoom optimizations,...).
+   *
+   * If the database has a MemoryBudget, the tile cache is registered at it.
    */
-  class OSMSCOUT_MAP_API MapService
+  class OSMSCOUT_MAP_API MapService : public MemoryBudget::Consumer
   {
   public:
     class OSMSCOUT_MAP_API TypeDefinition CLASS_FINAL
@@ -226,7 +229,7 @@ namespace osmscout {
 
   public:
     explicit MapService(const DatabaseRef& database);
-    virtual ~MapService();
+    ~MapService() override;
 
     void SetCacheSize(size_t cacheSize);
     size_t GetCacheSize() const;
@@ -236,6 +239,12 @@ namespace osmscout {
     void FlushTileCache();
     void InvalidateTileCache();
 
+    std::string GetMemoryConsumerName() const override;
+    size_t GetMemoryUsage() const override;
+    void GetCacheStatistics(size_t& hits,
+                            size_t& misses) const override;
+    void SetMemoryLimit(size_t bytes) override;
+
     void LookupTiles(const Magnification& magnification,
                      const GeoBox& boundingBox,
                      std::list<TileRef>& tiles) const;
@@ -0,0 +1,135 @@
+#ifndef OSMSCOUT_MAP_METATILE_H
+#define OSMSCOUT_MAP_METATILE_H
+/*
+  This source is part of the libosmscout-map library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <list>
+
+#include <osmscout/MapImportExport.h>
+
+#include <osmscout/util/GeoBox.h>
+#include <osmscout/util/Magnification.h>
+#include <osmscout/util/Projection.h>
+#include <osmscout/util/Tiling.h>
+
+#include <osmscout/MapPainter.h>
+#include <osmscout/MapService.h>
+#include <osmscout/StyleConfig.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Renderer
+   *
+   * A metatile is a rectangular block of OSM tiles that gets rendered as one canvas
+   * and is split into the individual tiles afterwards. Data is loaded and labels are
+   * layouted only once for the whole block, so labels are consistent across the borders
+   * of the contained tiles and are neither cut nor duplicated there.
+   *
+   * Metatiles are aligned to multiples of the metatile size and always cover the complete
+   * aligned block (only clipped at the border of the world), so a tile is always rendered
+   * as part of the same metatile, independent of the region that is rendered. Optionally a margin of additional tiles is rendered
+   * around the metatile (and dropped afterwards), so labels of objects close to the border
+   * of the metatile are placed, too.
+   */
+  class OSMSCOUT_MAP_API Metatile CLASS_FINAL
+  {
+  private:
+    Magnification magnification; //!< Magnification of the tiles
+    OSMTileIdBox  tiles;         //!< The tiles of the metatile
+    OSMTileIdBox  renderTiles;   //!< The rendered tiles, the tiles of the metatile plus the margin
+    size_t        tileWidth;     //!< Width of one tile in pixel
+    size_t        tileHeight;    //!< Height of one tile in pixel
+
+  public:
+    Metatile(const Magnification& magnification,
+             const OSMTileIdBox& tiles,
+             uint32_t margin,
+             size_t tileWidth,
+             size_t tileHeight);
+
+    inline const Magnification& GetMagnification() const
+    {
+      return magnification;
+    }
+
+    /**
+     * The tiles of the metatile
+     */
+    inline const OSMTileIdBox& GetTiles() const
+    {
+      return tiles;
+    }
+
+    /**
+     * The tiles that are rendered, the tiles of the metatile plus the margin
+     */
+    inline const OSMTileIdBox& GetRenderTiles() const
+    {
+      return renderTiles;
+    }
+
+    inline size_t GetTileWidth() const
+    {
+      return tileWidth;
+    }
+
+    inline size_t GetTileHeight() const
+    {
+      return tileHeight;
+    }
+
+    inline size_t GetCanvasWidth() const
+    {
+      return renderTiles.GetWidth()*tileWidth;
+    }
+
+    inline size_t GetCanvasHeight() const
+    {
+      return renderTiles.GetHeight()*tileHeight;
+    }
+
+    GeoBox GetBoundingBox() const;
+
+    bool GetProjection(TileProjection& projection,
+                       double dpi) const;
+
+    void GetTileOffset(const OSMTileId& tile,
+                       size_t& x,
+                       size_t& y) const;
+
+    bool LoadData(const MapService& mapService,
+                  const StyleConfig& styleConfig,
+                  const AreaSearchParameter& parameter,
+                  MapData& data) const;
+
+    static OSMTileIdBox GetMetatileBox(const Magnification& magnification,
+                                       const OSMTileId& tile,
+                                       uint32_t metatileSize);
+
+    static std::list<Metatile> GetMetatiles(const Magnification& magnification,
+                                            const OSMTileIdBox& tiles,
+                                            uint32_t metatileSize,
+                                            uint32_t margin,
+                                            size_t tileWidth,
+                                            size_t tileHeight);
+  };
+}
+
+#endif
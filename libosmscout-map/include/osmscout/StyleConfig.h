@@ -20,9 +20,11 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <array>
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -183,6 +185,46 @@ namespace osmscout {
     void SetMaxMM(double maxMM);
     void SetMaxPx(double maxPx);
 
+    inline bool HasMinMM() const
+    {
+      return minMMSet;
+    }
+
+    inline double GetMinMM() const
+    {
+      return minMM;
+    }
+
+    inline bool HasMinPx() const
+    {
+      return minPxSet;
+    }
+
+    inline double GetMinPx() const
+    {
+      return minPx;
+    }
+
+    inline bool HasMaxMM() const
+    {
+      return maxMMSet;
+    }
+
+    inline double GetMaxMM() const
+    {
+      return maxMM;
+    }
+
+    inline bool HasMaxPx() const
+    {
+      return maxPxSet;
+    }
+
+    inline double GetMaxPx() const
+    {
+      return maxPx;
+    }
+
     bool Evaluate(double meterInPixel, double meterInMM) const;
   };
 
@@ -320,6 +362,16 @@ namespace osmscout {
       return oneway;
     }
 
+    inline const std::list<FeatureFilterData>& GetFeatures() const
+    {
+      return features;
+    }
+
+    inline const SizeConditionRef& GetSizeCondition() const
+    {
+      return sizeCondition;
+    }
+
     bool Matches(const StyleResolveContext& context,
                  const FeatureValueBuffer& buffer,
                  double meterInPixel,
@@ -464,6 +516,16 @@ namespace osmscout {
     {
       // no code
     }
+
+    StyleSelector(const StyleCriteria& criteria,
+                  const std::set<A>& attributes,
+                  const std::shared_ptr<S>& style)
+    : criteria(criteria),
+      attributes(attributes),
+      style(style)
+    {
+      // no code
+    }
   };
 
   typedef PartialStyle<LineStyle,LineStyle::Attribute>     LinePartialStyle;
@@ -520,6 +582,149 @@ namespace osmscout {
   typedef std::list<PathSymbolStyleSelector>                           PathSymbolStyleSelectorList; //! List of selectors
   typedef std::vector<std::vector<PathSymbolStyleSelectorList> >       PathSymbolStyleLookupTable;  //!Index selectors by type and level
 
+  /**
+   * \ingroup Stylesheet
+   *
+   * Collects the object dependent conditions (features, feature flags, oneway and size
+   * conditions) of all style selectors of one type. Evaluating them for an object results
+   * in a fingerprint. Objects of this type with the same fingerprint resolve to the same
+   * styles on the same magnification level.
+   */
+  class OSMSCOUT_MAP_API StyleFingerprint
+  {
+  private:
+    std::vector<size_t>            features;       //!< Features which presence is evaluated
+    std::vector<FeatureFilterData> flags;          //!< Feature flags evaluated
+    bool                           oneway;         //!< The oneway state is evaluated
+    std::vector<SizeConditionRef>  sizeConditions; //!< Size conditions evaluated
+
+  public:
+    StyleFingerprint();
+
+    void AddCriteria(const StyleCriteria& criteria);
+
+    /**
+     * Return true, if all conditions fit into the fingerprint
+     */
+    inline bool IsValid() const
+    {
+      return features.size()+flags.size()+(oneway ? 1 : 0)+sizeConditions.size()<=64;
+    }
+
+    uint64_t Calculate(const StyleResolveContext& context,
+                       const FeatureValueBuffer& buffer,
+                       double meterInPixel,
+                       double meterInMM) const;
+  };
+
+  /**
+   * \ingroup Stylesheet
+   *
+   * Key of resolved styles in a StyleCache
+   */
+  struct OSMSCOUT_MAP_API StyleCacheKey
+  {
+    uint64_t fingerprint; //!< Fingerprint of the object
+    size_t   typeIndex;   //!< Index of the type
+    size_t   level;       //!< Magnification level
+
+    inline bool operator==(const StyleCacheKey& other) const
+    {
+      return fingerprint==other.fingerprint &&
+             typeIndex==other.typeIndex &&
+             level==other.level;
+    }
+  };
+
+  struct OSMSCOUT_MAP_API StyleCacheKeyHasher
+  {
+    inline size_t operator()(const StyleCacheKey& key) const
+    {
+      size_t hash=std::hash<uint64_t>()(key.fingerprint);
+
+      hash^=std::hash<size_t>()(key.typeIndex)+0x9e3779b9+(hash<<6)+(hash>>2);
+      hash^=std::hash<size_t>()(key.level)+0x9e3779b9+(hash<<6)+(hash>>2);
+
+      return hash;
+    }
+  };
+
+  /**
+   * \ingroup Stylesheet
+   *
+   * Cache of resolved styles by StyleCacheKey. The cache is split into shards
+   * with their own lock, to reduce lock contention between concurrent renderers.
+   * A shard is cleared, if it reaches its size limit.
+   *
+   * Methods are thread-safe.
+   */
+  template<class V>
+  class StyleCache
+  {
+  private:
+    static const size_t shardCount=16;
+    static const size_t maxShardSize=4096;
+
+    struct Shard
+    {
+      mutable std::mutex                                  mutex;
+      std::unordered_map<StyleCacheKey,V,StyleCacheKeyHasher> entries;
+    };
+
+  private:
+    std::array<Shard,shardCount> shards;
+
+  private:
+    inline Shard& GetShard(const StyleCacheKey& key)
+    {
+      return shards[StyleCacheKeyHasher()(key)%shardCount];
+    }
+
+    inline const Shard& GetShard(const StyleCacheKey& key) const
+    {
+      return shards[StyleCacheKeyHasher()(key)%shardCount];
+    }
+
+  public:
+    bool Get(const StyleCacheKey& key,
+             V& value) const
+    {
+      const Shard&                shard=GetShard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto                        entry=shard.entries.find(key);
+
+      if (entry==shard.entries.end()) {
+        return false;
+      }
+
+      value=entry->second;
+
+      return true;
+    }
+
+    void Set(const StyleCacheKey& key,
+             const V& value)
+    {
+      Shard&                      shard=GetShard(key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+
+      if (shard.entries.size()>=maxShardSize) {
+        shard.entries.clear();
+      }
+
+      shard.entries[key]=value;
+    }
+
+    void Clear()
+    {
+      for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        shard.entries.clear();
+      }
+    }
+  };
+
   /**
    * \ingroup Stylesheet
    *
@@ -529,9 +734,22 @@ namespace osmscout {
    * * Fastpath: Fastpath means, that we can directly return the style definition from the style sheet. This is normally
    * the case, if there is excactly one match in the style sheet. If there are multiple matches a new style has to be
    * allocated and composed from all matches.
+   * * Style cache: Resolved styles are cached by type, magnification level and the StyleFingerprint
+   * of the object. Objects sharing these values (which are most objects of a type) reuse the styles
+   * resolved for the first object instead of evaluating and composing the style selectors again.
+   * The caches are cleared, if the style sheet gets reloaded.
+   * * Compiled style sheet: The lookup tables (together with symbols, flags and type sets) can be
+   * stored in a binary file (StoreCompiled()) and loaded again (LoadCompiled()) without parsing
+   * and postprocessing the style sheet. Load() detects compiled files automatically.
+   * A compiled style sheet can only be loaded for the type configuration it was compiled for and
+   * with the flag values it was compiled with. Constants are not stored, they are only required
+   * while parsing.
    */
   class OSMSCOUT_MAP_API StyleConfig
   {
+  public:
+    static const uint32_t COMPILED_FORMAT_VERSION=1;
+
   private:
     TypeConfigRef                              typeConfig;             //!< Reference to the type configuration
     mutable StyleResolveContext                styleResolveContext;    //!< Instance of helper class that can get passed around to templated helper methods
@@ -599,6 +817,23 @@ namespace osmscout {
     std::list<std::string>                     errors;
     std::list<std::string>                     warnings;
 
+    // Style cache
+
+    std::vector<StyleFingerprint>              fingerprints;           //!< Object dependent style conditions by type index
+
+    mutable StyleCache<std::vector<TextStyleRef>>   nodeTextStyleCache;
+    mutable StyleCache<IconStyleRef>                nodeIconStyleCache;
+    mutable StyleCache<std::vector<LineStyleRef>>   wayLineStyleCache;
+    mutable StyleCache<PathTextStyleRef>            wayPathTextStyleCache;
+    mutable StyleCache<PathSymbolStyleRef>          wayPathSymbolStyleCache;
+    mutable StyleCache<PathShieldStyleRef>          wayPathShieldStyleCache;
+    mutable StyleCache<FillStyleRef>                areaFillStyleCache;
+    mutable StyleCache<std::vector<BorderStyleRef>> areaBorderStyleCache;
+    mutable StyleCache<std::vector<TextStyleRef>>   areaTextStyleCache;
+    mutable StyleCache<IconStyleRef>                areaIconStyleCache;
+    mutable StyleCache<PathTextStyleRef>            areaBorderTextStyleCache;
+    mutable StyleCache<PathSymbolStyleRef>          areaBorderSymbolStyleCache;
+
   private:
     void Reset();
 
@@ -607,6 +842,14 @@ namespace osmscout {
     void PostprocessAreas();
     void PostprocessIconId();
     void PostprocessPatternId();
+    void PostprocessFingerprints();
+
+    void ClearStyleCaches();
+
+    bool GetStyleCacheKey(const TypeInfoRef& type,
+                          const FeatureValueBuffer& buffer,
+                          const Projection& projection,
+                          StyleCacheKey& key) const;
 
   public:
     explicit StyleConfig(const TypeConfigRef& typeConfig);
@@ -775,6 +1018,16 @@ namespace osmscout {
     const std::list<std::string>&  GetErrors();
     const std::list<std::string>&  GetWarnings();
     //@}
+
+    /**
+     * Methods for storing and loading the compiled form of a style sheet
+     */
+    //@{
+    static bool IsCompiled(const std::string& filename);
+
+    bool StoreCompiled(const std::string& filename) const;
+    bool LoadCompiled(const std::string& filename);
+    //@}
   };
 
   typedef std::shared_ptr<StyleConfig> StyleConfigRef;
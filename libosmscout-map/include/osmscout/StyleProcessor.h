@@ -27,6 +27,15 @@
 #include <osmscout/Styles.h>
 
 namespace osmscout {
+  /**
+   * \ingroup Stylesheet
+   *
+   * Modifies the fill style of areas of a type before they are drawn.
+   *
+   * If parallel preprocessing is enabled (MapParameter::SetPreprocessThreadCount()>1)
+   * Process() is called concurrently from several threads of the MapPainter, so
+   * implementations must be thread-safe.
+   */
   class OSMSCOUT_MAP_API FillStyleProcessor
   {
   public:
@@ -0,0 +1,257 @@
+#ifndef OSMSCOUT_MAP_TILESEEDER_H
+#define OSMSCOUT_MAP_TILESEEDER_H
+/*
+  This source is part of the libosmscout-map library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <osmscout/MapImportExport.h>
+
+#include <osmscout/util/Breaker.h>
+#include <osmscout/util/GeoBox.h>
+#include <osmscout/util/Magnification.h>
+#include <osmscout/util/Progress.h>
+#include <osmscout/util/Projection.h>
+
+#include <osmscout/MapService.h>
+#include <osmscout/Metatile.h>
+#include <osmscout/StyleConfig.h>
+#include <osmscout/TileStorage.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Renderer
+   *
+   * Interface for rendering metatiles for the TileSeeder. Each worker thread of the
+   * seeder uses its own renderer instance, so implementations can hold their own
+   * painter and canvas without locking.
+   */
+  class OSMSCOUT_MAP_API MetatileRenderer
+  {
+  public:
+    virtual ~MetatileRenderer();
+
+    /**
+     * Render the given metatile (including its margin) using the given projection and
+     * data and return the encoded images of all tiles of the metatile (without the margin)
+     * in the iteration order of Metatile::GetTiles(). Tiles outside of the seeded region
+     * are dropped by the seeder.
+     */
+    virtual bool RenderMetatile(const Metatile& metatile,
+                                const TileProjection& projection,
+                                const MapData& data,
+                                std::vector<std::string>& tiles) = 0;
+  };
+
+  typedef std::shared_ptr<MetatileRenderer> MetatileRendererRef;
+
+  /**
+   * \ingroup Renderer
+   *
+   * Parameters for the TileSeeder
+   */
+  class OSMSCOUT_MAP_API TileSeederParameter CLASS_FINAL
+  {
+  private:
+    uint32_t            metatileSize;    //!< Width and height of a metatile in tiles
+    uint32_t            metatileMargin;  //!< Number of additional tiles rendered around each metatile
+    size_t              tileWidth;       //!< Width of one tile in pixel
+    size_t              tileHeight;      //!< Height of one tile in pixel
+    double              dpi;             //!< DPI of the rendered tiles
+    bool                resume;          //!< Skip metatiles that are already completely stored
+    AreaSearchParameter searchParameter; //!< Parameter for loading data
+    BreakerRef          breaker;         //!< Breaker for interrupting seeding
+
+  public:
+    TileSeederParameter();
+
+    void SetMetatileSize(uint32_t metatileSize);
+    void SetMetatileMargin(uint32_t metatileMargin);
+    void SetTileSize(size_t tileWidth,
+                     size_t tileHeight);
+    void SetDPI(double dpi);
+    void SetResume(bool resume);
+    void SetSearchParameter(const AreaSearchParameter& searchParameter);
+    void SetBreaker(const BreakerRef& breaker);
+
+    inline uint32_t GetMetatileSize() const
+    {
+      return metatileSize;
+    }
+
+    inline uint32_t GetMetatileMargin() const
+    {
+      return metatileMargin;
+    }
+
+    inline size_t GetTileWidth() const
+    {
+      return tileWidth;
+    }
+
+    inline size_t GetTileHeight() const
+    {
+      return tileHeight;
+    }
+
+    inline double GetDPI() const
+    {
+      return dpi;
+    }
+
+    inline bool GetResume() const
+    {
+      return resume;
+    }
+
+    inline const AreaSearchParameter& GetSearchParameter() const
+    {
+      return searchParameter;
+    }
+
+    inline BreakerRef GetBreaker() const
+    {
+      return breaker;
+    }
+
+    bool IsAborted() const;
+  };
+
+  /**
+   * \ingroup Renderer
+   *
+   * Statistics of a TileSeeder run
+   */
+  struct OSMSCOUT_MAP_API TileSeederStatistics
+  {
+    size_t   metatilesRendered; //!< Number of rendered metatiles
+    size_t   tilesRendered;     //!< Number of rendered tiles
+    size_t   tilesSkipped;      //!< Number of tiles skipped because they were already stored
+    uint64_t bytesWritten;      //!< Number of bytes of stored tiles
+    size_t   dataTileHits;      //!< Number of data tiles found complete in the data cache
+    size_t   dataTileMisses;    //!< Number of data tiles that had to be loaded
+    size_t   steals;            //!< Number of times a worker stole metatiles from another worker
+    double   seconds;           //!< Overall time in seconds
+
+    TileSeederStatistics();
+
+    double GetTilesPerSecond() const;
+    double GetDataTileHitRate() const;
+  };
+
+  /**
+   * \ingroup Renderer
+   *
+   * Renders all tiles of a region for a range of magnification levels ("seeding" of
+   * a tile pyramid) and stores them in a TileStorage.
+   *
+   * Tiles are rendered as metatiles. Per level the metatiles are ordered along a Hilbert
+   * curve, so consecutive metatiles are close to each other and share cached data tiles.
+   * The ordered metatiles are split into contiguous chunks, one per worker thread. A worker
+   * that runs out of work steals half of the remaining metatiles of the worker with the
+   * most remaining metatiles.
+   *
+   * All workers share the MapService (and thus the database and the data cache), while
+   * each worker renders with its own MetatileRenderer.
+   *
+   * If resuming is enabled, metatiles whose tiles are all already stored are skipped, so
+   * an interrupted seeding can be continued by just running it again.
+   */
+  class OSMSCOUT_MAP_API TileSeeder CLASS_FINAL
+  {
+  private:
+    /**
+     * Queue of metatiles (indexes into the list of metatiles of the current level) of a worker
+     */
+    struct WorkerQueue
+    {
+      std::mutex         mutex;
+      std::deque<size_t> metatiles;
+    };
+
+  private:
+    MapServiceRef                             mapService;        //!< The map service for loading data
+    StyleConfigRef                            styleConfig;       //!< The style configuration
+    TileStorageRef                            storage;           //!< Storage of the rendered tiles
+    TileSeederParameter                       parameter;         //!< Parameters
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;            //!< Queue of each worker
+    std::atomic<size_t>                       pending;           //!< Number of metatiles not yet taken by a worker
+    std::mutex                                queueChangeMutex;  //!< Protects queueChanges
+    std::condition_variable                   queueChanged;      //!< Signals a change of queueChanges
+    size_t                                    queueChanges;      //!< Number of steals and of levels without pending metatiles
+    std::atomic<size_t>                       processed;         //!< Number of processed metatiles of the current level
+    std::atomic<bool>                         failed;            //!< A worker failed
+
+    std::atomic<size_t>                       metatilesRendered; //!< Statistics
+    std::atomic<size_t>                       tilesRendered;     //!< Statistics
+    std::atomic<size_t>                       tilesSkipped;      //!< Statistics
+    std::atomic<uint64_t>                     bytesWritten;      //!< Statistics
+    std::atomic<size_t>                       dataTileHits;      //!< Statistics
+    std::atomic<size_t>                       dataTileMisses;    //!< Statistics
+    std::atomic<size_t>                       steals;            //!< Statistics
+    double                                    seconds;           //!< Statistics
+
+  private:
+    void NotifyQueueChange();
+    bool PopMetatile(size_t worker,
+                     size_t& metatile);
+    bool ProcessMetatile(const Metatile& metatile,
+                         const OSMTileIdBox& seededTiles,
+                         MetatileRenderer& renderer);
+    void ProcessMetatiles(size_t worker,
+                          MetatileRenderer* renderer,
+                          const std::vector<Metatile>* metatiles,
+                          const OSMTileIdBox* seededTiles);
+
+  public:
+    TileSeeder(const MapServiceRef& mapService,
+               const StyleConfigRef& styleConfig,
+               const TileStorageRef& storage,
+               const TileSeederParameter& parameter);
+
+    bool Seed(const GeoBox& boundingBox,
+              const MagnificationLevel& startLevel,
+              const MagnificationLevel& endLevel,
+              const std::vector<MetatileRendererRef>& renderers,
+              Progress& progress);
+
+    TileSeederStatistics GetStatistics() const;
+
+    static uint64_t GetHilbertIndex(uint32_t size,
+                                    uint32_t x,
+                                    uint32_t y);
+
+    static std::vector<Metatile> GetOrderedMetatiles(const Magnification& magnification,
+                                                     const OSMTileIdBox& tiles,
+                                                     uint32_t metatileSize,
+                                                     uint32_t metatileMargin,
+                                                     size_t tileWidth,
+                                                     size_t tileHeight);
+  };
+}
+
+#endif
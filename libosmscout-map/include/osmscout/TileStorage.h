@@ -0,0 +1,191 @@
+#ifndef OSMSCOUT_MAP_TILESTORAGE_H
+#define OSMSCOUT_MAP_TILESTORAGE_H
+/*
+  This source is part of the libosmscout-map library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <osmscout/MapImportExport.h>
+
+#include <osmscout/OSMScoutTypes.h>
+
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+#include <osmscout/util/Magnification.h>
+#include <osmscout/util/Tiling.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Renderer
+   *
+   * Interface for storing rendered tile images. The content of a tile is an
+   * opaque blob of bytes (normally an encoded image).
+   *
+   * All methods must be thread-safe.
+   */
+  class OSMSCOUT_MAP_API TileStorage
+  {
+  public:
+    virtual ~TileStorage();
+
+    /**
+     * Return true, if the given tile is already stored
+     */
+    virtual bool HasTile(const MagnificationLevel& level,
+                         const OSMTileId& tile) const = 0;
+
+    /**
+     * Store the given tile. An already stored tile gets replaced.
+     */
+    virtual bool StoreTile(const MagnificationLevel& level,
+                           const OSMTileId& tile,
+                           const std::string& content) = 0;
+
+    /**
+     * Make all stored tiles persistent, so they survive an interruption of the process
+     */
+    virtual bool Flush() = 0;
+  };
+
+  typedef std::shared_ptr<TileStorage> TileStorageRef;
+
+  /**
+   * \ingroup Renderer
+   *
+   * Stores tiles in a directory tree of the form "<directory>/<level>/<x>/<y>.<extension>".
+   *
+   * Tiles are written to a temporary file first and renamed afterwards, so an
+   * interrupted write never leaves a partial tile behind.
+   */
+  class OSMSCOUT_MAP_API DirectoryTileStorage CLASS_FINAL : public TileStorage
+  {
+  private:
+    std::string        directory;     //!< The root directory
+    std::string        extension;     //!< File extension of the tiles (without '.')
+    mutable std::mutex mutex;         //!< Protects creation of directories
+
+  private:
+    std::string GetTileDirectory(const MagnificationLevel& level,
+                                 const OSMTileId& tile) const;
+    std::string GetTileFilename(const MagnificationLevel& level,
+                                const OSMTileId& tile) const;
+
+  public:
+    DirectoryTileStorage(const std::string& directory,
+                         const std::string& extension);
+
+    bool HasTile(const MagnificationLevel& level,
+                 const OSMTileId& tile) const override;
+
+    bool StoreTile(const MagnificationLevel& level,
+                   const OSMTileId& tile,
+                   const std::string& content) override;
+
+    bool Flush() override;
+  };
+
+  /**
+   * \ingroup Renderer
+   *
+   * Stores all tiles in one single file, similar to a MBTiles container but
+   * without requiring a database.
+   *
+   * The file consists of a header, followed by a sequence of tile records. The
+   * header holds the end of the committed tile records. Records are only appended,
+   * a replaced tile just gets a new record. Records after the committed end (from an
+   * interrupted process) are ignored and overwritten when the file is opened again,
+   * so the file can be resumed after an interruption, losing at most the tiles
+   * written since the last commit.
+   *
+   * The index of the tiles is rebuild on Open().
+   */
+  class OSMSCOUT_MAP_API TilePackStorage CLASS_FINAL : public TileStorage
+  {
+  public:
+    static const char*     FILE_TILES_PACK;           //!< Default name of the file
+    static const uint32_t  FILE_FORMAT_VERSION;       //!< Version of the file format
+    static const size_t    DEFAULT_COMMIT_INTERVAL;   //!< Default number of tiles written between commits
+
+  private:
+    /**
+     * Location of a tile within the file
+     */
+    struct TileEntry
+    {
+      FileOffset offset; //!< Offset of the tile content
+      uint32_t   size;   //!< Size of the tile content
+    };
+
+    typedef std::pair<uint32_t,std::pair<uint32_t,uint32_t>> TileKey;
+
+  private:
+    std::string                   filename;          //!< Name of the file
+    size_t                        commitInterval;    //!< Number of tiles written between commits
+    mutable std::mutex            mutex;             //!< Protects file and index
+    mutable FileWriter            writer;            //!< Writer for appending tiles
+    mutable FileScanner           scanner;           //!< Scanner for reading tiles
+    std::map<TileKey,TileEntry>   index;             //!< Index of the stored tiles
+    FileOffset                    dataEnd;           //!< End of the tile records
+    size_t                        uncommittedTiles;  //!< Number of tiles written since the last commit
+
+  private:
+    static TileKey GetKey(const MagnificationLevel& level,
+                          const OSMTileId& tile);
+
+    void ReadIndex();
+    void Commit();
+
+  public:
+    TilePackStorage();
+    ~TilePackStorage() override;
+
+    void SetCommitInterval(size_t commitInterval);
+
+    bool Open(const std::string& filename);
+    bool Close();
+
+    inline bool IsOpen() const
+    {
+      return writer.IsOpen();
+    }
+
+    size_t GetTileCount() const;
+
+    bool GetTile(const MagnificationLevel& level,
+                 const OSMTileId& tile,
+                 std::string& content) const;
+
+    bool HasTile(const MagnificationLevel& level,
+                 const OSMTileId& tile) const override;
+
+    bool StoreTile(const MagnificationLevel& level,
+                   const OSMTileId& tile,
+                   const std::string& content) override;
+
+    bool Flush() override;
+  };
+
+  typedef std::shared_ptr<TilePackStorage> TilePackStorageRef;
+}
+
+#endif
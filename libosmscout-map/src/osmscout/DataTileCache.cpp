@@ -19,6 +19,8 @@
 
 #include <osmscout/DataTileCache.h>
 
+#include <algorithm>
+
 #include <osmscout/util/Logger.h>
 #include <osmscout/util/String.h>
 #include <osmscout/util/Tiling.h>
@@ -40,11 +42,27 @@ namespace osmscout {
     // no code
   }
 
+  /**
+   * Return the estimated memory of the tile. Only the references to the objects are
+   * counted, the objects themselves are shared with other tiles and the data file caches.
+   */
+  size_t Tile::GetMemory() const
+  {
+    return sizeof(Tile)+
+           nodeData.GetDataSize()*sizeof(NodeRef)+
+           (wayData.GetDataSize()+optimizedWayData.GetDataSize())*sizeof(WayRef)+
+           (areaData.GetDataSize()+optimizedAreaData.GetDataSize())*sizeof(AreaRef);
+  }
+
   /**
    * Create a new tile cache with the given cache size
    */
   DataTileCache::DataTileCache(size_t cacheSize)
-  : cacheSize(cacheSize)
+  : cacheSize(cacheSize),
+    maxMemory(0),
+    memory(0),
+    hits(0),
+    misses(0)
   {
     // no code
   }
@@ -63,20 +81,42 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Limit the cache to the given estimated memory of the tiles in addition to the
+   * number of tiles. Passing 0 removes the limit. The limit is applied on the next
+   * call of CleanupCache().
+   *
+   * Method is thread-safe.
+   */
+  void DataTileCache::SetMaxMemory(size_t maxMemory)
+  {
+    this->maxMemory=maxMemory;
+  }
+
   /**
    * Cleanup the cache. Free least recently used tiles until the given maximum cache
-   * size is reached again.
+   * size (and the maximum memory, if set) is reached again.
    */
   void DataTileCache::CleanupCache()
   {
-    if (tileCache.size()>cacheSize) {
+    size_t currentMemory=0;
+    size_t memoryLimit=maxMemory;
+
+    for (const auto& entry : tileCache) {
+      currentMemory+=sizeof(CacheEntry)+entry.tile->GetMemory();
+    }
+
+    if (tileCache.size()>cacheSize ||
+        (memoryLimit>0 && currentMemory>memoryLimit)) {
       auto currentEntry=tileCache.rbegin();
 
       while (currentEntry!=tileCache.rend() &&
-              tileCache.size()>cacheSize) {
+             (tileCache.size()>cacheSize ||
+              (memoryLimit>0 && currentMemory>memoryLimit))) {
         //if (currentEntry->tile.expired()) {
         if (currentEntry->tile.use_count()==1) {
           //std::cout << "Dropping tile " << (std::string)currentEntry->id << " from cache " << cache.size() << "/" << cacheSize << std::endl;
+          currentMemory-=std::min(currentMemory,sizeof(CacheEntry)+currentEntry->tile->GetMemory());
           tileIndex.erase(currentEntry->key);
 
           ++currentEntry;
@@ -87,6 +127,8 @@ namespace osmscout {
         }
       }
     }
+
+    memory=currentMemory;
   }
 
   /**
@@ -134,6 +176,8 @@ namespace osmscout {
     if (existingEntry==tileIndex.end()) {
       TileRef tile(new Tile(key));
 
+      misses++;
+
       // Updating cache
       CacheEntry cacheEntry(key,
                             tile);
@@ -147,6 +191,8 @@ namespace osmscout {
       tileCache.splice(tileCache.begin(),tileCache,existingEntry->second);
       existingEntry->second=tileCache.begin();
 
+      hits++;
+
       return existingEntry->second->tile;
     }
   }
@@ -19,6 +19,8 @@
 
 #include <osmscout/MapPainter.h>
 
+#include <algorithm>
+#include <future>
 #include <limits>
 
 #include <osmscout/system/Math.h>
@@ -39,6 +41,11 @@
 
 namespace osmscout {
 
+  /**
+   * Minimum number of objects per thread for parallel preprocessing
+   */
+  static const size_t minPreprocessObjectCount=256;
+
   static void GetGridPoints(const std::vector<Point>& nodes,
                             double gridSizeHoriz,
                             double gridSizeVert,
@@ -182,6 +189,12 @@ namespace osmscout {
     return true;
   }
 
+  MapPainter::PreprocessWorker::PreprocessWorker()
+  : transBuffer(new CoordBuffer())
+  {
+    // no code
+  }
+
   MapPainter::MapPainter(const StyleConfigRef& styleConfig,
                          CoordBuffer *buffer)
   : coordBuffer(buffer),
@@ -241,6 +254,21 @@ namespace osmscout {
   MapPainter::~MapPainter()
   {
     log.Debug() << "MapPainter::~MapPainter()";
+
+    preprocessQueue.Stop();
+
+    for (auto& thread : preprocessThreads) {
+      thread.join();
+    }
+  }
+
+  void MapPainter::PreprocessThreadLoop()
+  {
+    std::packaged_task<bool()> task;
+
+    while (preprocessQueue.PopTask(task)) {
+      task();
+    }
   }
 
   void MapPainter::DumpDataStatistics(const Projection& projection,
@@ -1302,7 +1330,9 @@ namespace osmscout {
   void MapPainter::PrepareArea(const StyleConfig& styleConfig,
                                const Projection& projection,
                                const MapParameter& parameter,
-                               const AreaRef &area)
+                               const AreaRef &area,
+                               TransBuffer& transBuffer,
+                               std::list<AreaData>& areaData)
   {
     std::vector<PolyData> td(area->rings.size());
 
@@ -1438,11 +1468,11 @@ namespace osmscout {
           }
 
           if (offset!=0.0) {
-            coordBuffer->GenerateParallelWay(transStart,
-                                             transEnd,
-                                             offset,
-                                             transStart,
-                                             transEnd);
+            transBuffer.buffer->GenerateParallelWay(transStart,
+                                                     transEnd,
+                                                     offset,
+                                                     transStart,
+                                                     transEnd);
           }
 
           a.ref=area->GetObjectFileRef();
@@ -1461,6 +1491,60 @@ namespace osmscout {
     }
   }
 
+  void MapPainter::PrepareAreasParallel(const StyleConfig& styleConfig,
+                                        const Projection& projection,
+                                        const MapParameter& parameter,
+                                        const MapData& data,
+                                        size_t workerCount)
+  {
+    auto process=[&](TransBuffer& transBuffer,
+                     std::list<AreaData>& areaData,
+                     size_t start,
+                     size_t end) {
+      for (size_t i=start; i<end; i++) {
+        PrepareArea(styleConfig,
+                    projection,
+                    parameter,
+                    data.areas[i],
+                    transBuffer,
+                    areaData);
+      }
+    };
+
+    std::vector<std::future<bool>> results;
+
+    for (size_t w=1; w<workerCount; w++) {
+      PreprocessWorker&          worker=*preprocessWorkers[w-1];
+      size_t                     start=data.areas.size()*w/workerCount;
+      size_t                     end=data.areas.size()*(w+1)/workerCount;
+      std::packaged_task<bool()> task([&process,&worker,start,end] {
+        process(worker.transBuffer,
+                worker.areaData,
+                start,
+                end);
+
+        return true;
+      });
+
+      results.push_back(task.get_future());
+      preprocessQueue.PushTask(task);
+    }
+
+    // The first part is processed by the calling thread directly into the buffers of the painter
+    process(transBuffer,
+            areaData,
+            0,
+            data.areas.size()/workerCount);
+
+    for (auto& result : results) {
+      result.get();
+    }
+
+    for (size_t w=1; w<workerCount; w++) {
+      MergePreprocessWorker(*preprocessWorkers[w-1]);
+    }
+  }
+
   void MapPainter::PrepareAreas(const StyleConfig& styleConfig,
                                 const Projection& projection,
                                 const MapParameter& parameter,
@@ -1468,12 +1552,26 @@ namespace osmscout {
   {
     areaData.clear();
 
+    size_t workerCount=GetPreprocessWorkerCount(parameter,
+                                                data.areas.size());
+
     //Areas
-    for (const auto& area : data.areas) {
-      PrepareArea(styleConfig,
-                   projection,
-                   parameter,
-                   area);
+    if (workerCount>1) {
+      PrepareAreasParallel(styleConfig,
+                           projection,
+                           parameter,
+                           data,
+                           workerCount);
+    }
+    else {
+      for (const auto& area : data.areas) {
+        PrepareArea(styleConfig,
+                    projection,
+                    parameter,
+                    area,
+                    transBuffer,
+                    areaData);
+      }
     }
 
     areaData.sort(AreaSorter);
@@ -1483,7 +1581,9 @@ namespace osmscout {
       PrepareArea(styleConfig,
                   projection,
                   parameter,
-                  area);
+                  area,
+                  transBuffer,
+                  areaData);
     }
   }
 
@@ -1492,7 +1592,11 @@ namespace osmscout {
                                   const MapParameter& parameter,
                                   const ObjectFileRef& ref,
                                   const FeatureValueBuffer& buffer,
-                                  const std::vector<Point>& nodes)
+                                  const std::vector<Point>& nodes,
+                                  TransBuffer& transBuffer,
+                                  std::vector<LineStyleRef>& lineStyles,
+                                  std::list<WayData>& wayData,
+                                  std::list<WayPathData>& wayPathData)
   {
     styleConfig.GetWayLineStyles(buffer,
                                  projection,
@@ -1614,10 +1718,10 @@ namespace osmscout {
       }
 
       if (lineOffset!=0.0) {
-        coordBuffer->GenerateParallelWay(transStart,transEnd,
-                                         lineOffset,
-                                         data.transStart,
-                                         data.transEnd);
+        transBuffer.buffer->GenerateParallelWay(transStart,transEnd,
+                                                lineOffset,
+                                                data.transStart,
+                                                data.transEnd);
       }
       else {
         data.transStart=transStart;
@@ -1645,10 +1749,10 @@ namespace osmscout {
         double  laneOffset=-mainSlotWidth/2.0+lanesSpace;
 
         for (size_t lane=1; lane<lanes; lane++) {
-          coordBuffer->GenerateParallelWay(transStart,transEnd,
-                                           laneOffset,
-                                           data.transStart,
-                                           data.transEnd);
+          transBuffer.buffer->GenerateParallelWay(transStart,transEnd,
+                                                  laneOffset,
+                                                  data.transStart,
+                                                  data.transEnd);
           wayData.push_back(data);
           laneOffset+=lanesSpace;
         }
@@ -1659,6 +1763,157 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Return the number of threads (including the calling thread) to use for preprocessing
+   * the given number of objects and create the missing workers and threads. Parallel
+   * preprocessing is only used, if every thread gets a reasonable number of objects.
+   */
+  size_t MapPainter::GetPreprocessWorkerCount(const MapParameter& parameter,
+                                              size_t objectCount)
+  {
+    size_t workerCount=std::min(parameter.GetPreprocessThreadCount(),
+                                objectCount/minPreprocessObjectCount);
+
+    while (preprocessWorkers.size()+1<workerCount) {
+      preprocessWorkers.push_back(std::make_shared<PreprocessWorker>());
+    }
+
+    while (preprocessThreads.size()+1<workerCount) {
+      preprocessThreads.emplace_back(&MapPainter::PreprocessThreadLoop,this);
+    }
+
+    return workerCount;
+  }
+
+  /**
+   * Move the result of the worker to the painter. The coordinates of the worker
+   * are appended to the coordinate buffer of the painter and the ranges of the
+   * prepared data are moved accordingly.
+   */
+  void MapPainter::MergePreprocessWorker(PreprocessWorker& worker)
+  {
+    size_t offset=coordBuffer->PushCoords(*worker.transBuffer.buffer);
+
+    for (auto& data : worker.wayData) {
+      data.transStart+=offset;
+      data.transEnd+=offset;
+    }
+
+    for (auto& data : worker.wayPathData) {
+      data.transStart+=offset;
+      data.transEnd+=offset;
+    }
+
+    for (auto& data : worker.areaData) {
+      data.transStart+=offset;
+      data.transEnd+=offset;
+
+      for (auto& clipping : data.clippings) {
+        clipping.transStart+=offset;
+        clipping.transEnd+=offset;
+      }
+    }
+
+    wayData.splice(wayData.end(),
+                   worker.wayData);
+    wayPathData.splice(wayPathData.end(),
+                       worker.wayPathData);
+    areaData.splice(areaData.end(),
+                    worker.areaData);
+
+    worker.transBuffer.Reset();
+  }
+
+  /**
+   * Split the ways into consecutive parts, one for each thread. Since the results
+   * are merged in the order of the parts, the prepared data is in the same order
+   * as without parallel preprocessing.
+   */
+  void MapPainter::PrepareWaysParallel(const StyleConfig& styleConfig,
+                                       const Projection& projection,
+                                       const MapParameter& parameter,
+                                       const MapData& data,
+                                       size_t workerCount)
+  {
+    std::vector<const Way*> ways;
+
+    ways.reserve(data.ways.size()+data.poiWays.size());
+
+    for (const auto& way : data.ways) {
+      ways.push_back(way.get());
+    }
+
+    for (const auto& way : data.poiWays) {
+      ways.push_back(way.get());
+    }
+
+    auto process=[&](TransBuffer& transBuffer,
+                     std::vector<LineStyleRef>& lineStyles,
+                     std::list<WayData>& wayData,
+                     std::list<WayPathData>& wayPathData,
+                     size_t start,
+                     size_t end) {
+      for (size_t i=start; i<end; i++) {
+        CalculatePaths(styleConfig,
+                       projection,
+                       parameter,
+                       ObjectFileRef(ways[i]->GetFileOffset(),
+                                     refWay),
+                       ways[i]->GetFeatureValueBuffer(),
+                       ways[i]->nodes,
+                       transBuffer,
+                       lineStyles,
+                       wayData,
+                       wayPathData);
+      }
+    };
+
+    std::vector<std::future<bool>> results;
+
+    for (size_t w=1; w<workerCount; w++) {
+      PreprocessWorker&          worker=*preprocessWorkers[w-1];
+      size_t                     start=ways.size()*w/workerCount;
+      size_t                     end=ways.size()*(w+1)/workerCount;
+      std::packaged_task<bool()> task([&process,&worker,start,end] {
+        process(worker.transBuffer,
+                worker.lineStyles,
+                worker.wayData,
+                worker.wayPathData,
+                start,
+                end);
+
+        return true;
+      });
+
+      results.push_back(task.get_future());
+      preprocessQueue.PushTask(task);
+    }
+
+    // The first part is processed by the calling thread directly into the buffers of the painter
+    process(transBuffer,
+            lineStyles,
+            wayData,
+            wayPathData,
+            0,
+            ways.size()/workerCount);
+
+    for (auto& result : results) {
+      result.get();
+    }
+
+    for (size_t w=1; w<workerCount; w++) {
+      MergePreprocessWorker(*preprocessWorkers[w-1]);
+    }
+
+    // The label layouter is not thread-safe, labels are registered afterwards in the original order
+    for (const auto& way : ways) {
+      CalculateWayShieldLabels(styleConfig,
+                               projection,
+                               parameter,
+                               *way);
+    }
+  }
+
   void MapPainter::PrepareWays(const StyleConfig& styleConfig,
                                const Projection& projection,
                                const MapParameter& parameter,
@@ -1669,34 +1924,54 @@ namespace osmscout {
     wayData.clear();
     wayPathData.clear();
 
-    for (const auto& way : data.ways) {
-      CalculatePaths(styleConfig,
-                     projection,
-                     parameter,
-                     ObjectFileRef(way->GetFileOffset(),
-                                   refWay),
-                     way->GetFeatureValueBuffer(),
-                     way->nodes);
+    size_t workerCount=GetPreprocessWorkerCount(parameter,
+                                                data.ways.size()+data.poiWays.size());
 
-      CalculateWayShieldLabels(styleConfig,
-                               projection,
-                               parameter,
-                               *way);
+    if (workerCount>1) {
+      PrepareWaysParallel(styleConfig,
+                          projection,
+                          parameter,
+                          data,
+                          workerCount);
     }
+    else {
+      for (const auto& way : data.ways) {
+        CalculatePaths(styleConfig,
+                       projection,
+                       parameter,
+                       ObjectFileRef(way->GetFileOffset(),
+                                     refWay),
+                       way->GetFeatureValueBuffer(),
+                       way->nodes,
+                       transBuffer,
+                       lineStyles,
+                       wayData,
+                       wayPathData);
+
+        CalculateWayShieldLabels(styleConfig,
+                                 projection,
+                                 parameter,
+                                 *way);
+      }
 
-    for (const auto& way : data.poiWays) {
-      CalculatePaths(styleConfig,
-                     projection,
-                     parameter,
-                     ObjectFileRef(way->GetFileOffset(),
-                                   refWay),
-                     way->GetFeatureValueBuffer(),
-                     way->nodes);
-
-      CalculateWayShieldLabels(styleConfig,
-                               projection,
-                               parameter,
-                               *way);
+      for (const auto& way : data.poiWays) {
+        CalculatePaths(styleConfig,
+                       projection,
+                       parameter,
+                       ObjectFileRef(way->GetFileOffset(),
+                                     refWay),
+                       way->GetFeatureValueBuffer(),
+                       way->nodes,
+                       transBuffer,
+                       lineStyles,
+                       wayData,
+                       wayPathData);
+
+        CalculateWayShieldLabels(styleConfig,
+                                 projection,
+                                 parameter,
+                                 *way);
+      }
     }
 
     wayData.sort();
@@ -53,6 +53,7 @@ namespace osmscout {
     renderUnknowns(false),
     debugData(false),
     debugPerformance(false),
+    preprocessThreadCount(1),
     warnObjectCountLimit(0),
     warnCoordCountLimit(0),
     showAltLanguage(false)
@@ -225,6 +226,18 @@ namespace osmscout {
     debugPerformance=debug;
   }
 
+  /**
+   * Set the number of threads used by MapPainter for preprocessing ways and areas.
+   * With a value >1 the ways and areas are split between the given number of
+   * threads (including the calling thread), the result is the same as with
+   * preprocessing in the calling thread only. Registered FillStyleProcessor
+   * instances then must be thread-safe.
+   */
+  void MapParameter::SetPreprocessThreadCount(size_t threadCount)
+  {
+    preprocessThreadCount=std::max(threadCount,(size_t)1);
+  }
+
   void MapParameter::SetWarningObjectCountLimit(size_t limit)
   {
     warnObjectCountLimit=limit;
@@ -240,6 +253,11 @@ namespace osmscout {
     this->breaker=breaker;
   }
 
+  /**
+   * Register a processor for the fill styles of areas of the type with the given index.
+   * With a preprocess thread count >1 the processor is called concurrently from several
+   * threads and must be thread-safe.
+   */
   void MapParameter::RegisterFillStyleProcessor(size_t typeIndex,
                                                 const FillStyleProcessorRef& processor)
   {
@@ -93,11 +93,17 @@ namespace osmscout {
      areaLowZoomWorkerThread(&MapService::AreaLowZoomWorkerLoop,this),
      nextCallbackId(0)
   {
-    // no code
+    if (database->GetMemoryBudget()) {
+      database->GetMemoryBudget()->Register(*this);
+    }
   }
 
   MapService::~MapService()
   {
+    if (database->GetMemoryBudget()) {
+      database->GetMemoryBudget()->Unregister(*this);
+    }
+
     nodeWorkerQueue.Stop();
     wayWorkerQueue.Stop();
     wayLowZoomWorkerQueue.Stop();
@@ -168,6 +174,47 @@ namespace osmscout {
     cache.InvalidateCache();
   }
 
+  std::string MapService::GetMemoryConsumerName() const
+  {
+    return "tile cache";
+  }
+
+  /**
+   * Return the estimated memory of the tile cache as of the last cleanup.
+   *
+   * Method is thread-safe and does not lock, since the budget may call it
+   * while tile data is loaded.
+   */
+  size_t MapService::GetMemoryUsage() const
+  {
+    return cache.GetMemory();
+  }
+
+  /**
+   * Return the accumulated hits and misses of the tile cache.
+   *
+   * Method is thread-safe and does not lock.
+   */
+  void MapService::GetCacheStatistics(size_t& hits,
+                                      size_t& misses) const
+  {
+    hits=cache.GetHits();
+    misses=cache.GetMisses();
+  }
+
+  /**
+   * Limit the tile cache to the given estimated memory in addition to the
+   * tile count. Tiles are evicted on the next cleanup, for example after
+   * loading missing tile data.
+   *
+   * Method is thread-safe and does not lock, since the budget may call it
+   * while tile data is loaded.
+   */
+  void MapService::SetMemoryLimit(size_t bytes)
+  {
+    cache.SetMaxMemory(bytes);
+  }
+
   /**
    * Create a TypeDefinition based on the given parameter, StyleConfiguration and
    * magnifications. Effectly returns all types needed to load everything that is
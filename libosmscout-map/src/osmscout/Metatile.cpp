@@ -0,0 +1,197 @@
+/*
+  This source is part of the libosmscout-map library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/Metatile.h>
+
+#include <algorithm>
+
+#include <osmscout/system/Assert.h>
+
+namespace osmscout {
+
+  /**
+   * Return the maximum tile coordinate for the given magnification
+   */
+  static uint32_t GetMaxTileCoord(const Magnification& magnification)
+  {
+    return (uint32_t)(magnification.GetMagnification()-1.0);
+  }
+
+  /**
+   * Create a metatile for the given tiles
+   *
+   * @param magnification
+   *    Magnification of the tiles
+   * @param tiles
+   *    The tiles of the metatile
+   * @param margin
+   *    Number of additional tiles rendered on each side of the metatile. The margin is
+   *    clipped at the border of the world.
+   * @param tileWidth
+   *    Width of one tile in pixel
+   * @param tileHeight
+   *    Height of one tile in pixel
+   */
+  Metatile::Metatile(const Magnification& magnification,
+                     const OSMTileIdBox& tiles,
+                     uint32_t margin,
+                     size_t tileWidth,
+                     size_t tileHeight)
+  : magnification(magnification),
+    tiles(tiles),
+    renderTiles(OSMTileId(tiles.GetMinX()-std::min(margin,tiles.GetMinX()),
+                          tiles.GetMinY()-std::min(margin,tiles.GetMinY())),
+                OSMTileId(tiles.GetMaxX()+std::min(margin,GetMaxTileCoord(magnification)-std::min(tiles.GetMaxX(),GetMaxTileCoord(magnification))),
+                          tiles.GetMaxY()+std::min(margin,GetMaxTileCoord(magnification)-std::min(tiles.GetMaxY(),GetMaxTileCoord(magnification))))),
+    tileWidth(tileWidth),
+    tileHeight(tileHeight)
+  {
+    // no code
+  }
+
+  /**
+   * Return the bounding box of the rendered tiles (including the margin)
+   */
+  GeoBox Metatile::GetBoundingBox() const
+  {
+    return renderTiles.GetBoundingBox(magnification);
+  }
+
+  /**
+   * Initialize the given projection for rendering the metatile (including the margin)
+   * onto a canvas of GetCanvasWidth() x GetCanvasHeight() pixel.
+   */
+  bool Metatile::GetProjection(TileProjection& projection,
+                               double dpi) const
+  {
+    return projection.Set(renderTiles,
+                          magnification,
+                          dpi,
+                          GetCanvasWidth(),
+                          GetCanvasHeight());
+  }
+
+  /**
+   * Return the pixel offset of the top left corner of the given tile within the canvas
+   * of the metatile.
+   */
+  void Metatile::GetTileOffset(const OSMTileId& tile,
+                               size_t& x,
+                               size_t& y) const
+  {
+    assert(tile.GetX()>=renderTiles.GetMinX() && tile.GetX()<=renderTiles.GetMaxX());
+    assert(tile.GetY()>=renderTiles.GetMinY() && tile.GetY()<=renderTiles.GetMaxY());
+
+    x=(tile.GetX()-renderTiles.GetMinX())*tileWidth;
+    y=(tile.GetY()-renderTiles.GetMinY())*tileHeight;
+  }
+
+  /**
+   * Load the data required for rendering the metatile (including the margin) in one go.
+   *
+   * Method is thread-safe.
+   */
+  bool Metatile::LoadData(const MapService& mapService,
+                          const StyleConfig& styleConfig,
+                          const AreaSearchParameter& parameter,
+                          MapData& data) const
+  {
+    std::list<TileRef> dataTiles;
+
+    mapService.LookupTiles(magnification,
+                           GetBoundingBox(),
+                           dataTiles);
+
+    if (!mapService.LoadMissingTileData(parameter,
+                                        styleConfig,
+                                        dataTiles)) {
+      return false;
+    }
+
+    mapService.AddTileDataToMapData(dataTiles,
+                                    data);
+
+    return true;
+  }
+
+  /**
+   * Return the box of tiles of the metatile the given tile belongs to. Metatiles are
+   * aligned to multiples of the metatile size and clipped at the border of the world.
+   */
+  OSMTileIdBox Metatile::GetMetatileBox(const Magnification& magnification,
+                                        const OSMTileId& tile,
+                                        uint32_t metatileSize)
+  {
+    assert(metatileSize>0);
+
+    uint32_t maxTileCoord=GetMaxTileCoord(magnification);
+    uint32_t minX=tile.GetX()-tile.GetX()%metatileSize;
+    uint32_t minY=tile.GetY()-tile.GetY()%metatileSize;
+
+    return OSMTileIdBox(OSMTileId(minX,
+                                  minY),
+                        OSMTileId(std::min(minX+metatileSize-1,maxTileCoord),
+                                  std::min(minY+metatileSize-1,maxTileCoord)));
+  }
+
+  /**
+   * Return the metatiles covering the given box of tiles. Metatiles are aligned to
+   * multiples of the metatile size and are not clipped to the given box, so every tile
+   * of the box is part of exactly one metatile and the metatiles do not depend on the
+   * box. Tiles of the metatiles outside of the box should be dropped after rendering.
+   */
+  std::list<Metatile> Metatile::GetMetatiles(const Magnification& magnification,
+                                             const OSMTileIdBox& tiles,
+                                             uint32_t metatileSize,
+                                             uint32_t margin,
+                                             size_t tileWidth,
+                                             size_t tileHeight)
+  {
+    std::list<Metatile> metatiles;
+
+    assert(metatileSize>0);
+
+    uint32_t y=tiles.GetMinY();
+
+    while (y<=tiles.GetMaxY()) {
+      uint32_t x=tiles.GetMinX();
+      uint32_t maxY=y;
+
+      while (x<=tiles.GetMaxX()) {
+        OSMTileIdBox box=GetMetatileBox(magnification,
+                                        OSMTileId(x,y),
+                                        metatileSize);
+
+        maxY=box.GetMaxY();
+
+        metatiles.emplace_back(magnification,
+                               box,
+                               margin,
+                               tileWidth,
+                               tileHeight);
+
+        x=box.GetMaxX()+1;
+      }
+
+      y=maxY+1;
+    }
+
+    return metatiles;
+  }
+}
@@ -21,6 +21,9 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <cstring>
+#include <map>
 #include <set>
 
 #include <sstream>
@@ -28,6 +31,8 @@
 #include <osmscout/system/Assert.h>
 
 #include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
 #include <osmscout/util/Logger.h>
 
 #include <osmscout/oss/Parser.h>
@@ -332,6 +337,96 @@ namespace osmscout {
     return true;
   }
 
+  StyleFingerprint::StyleFingerprint()
+  : oneway(false)
+  {
+    // no code
+  }
+
+  void StyleFingerprint::AddCriteria(const StyleCriteria& criteria)
+  {
+    for (const auto& feature : criteria.GetFeatures()) {
+      if (feature.flagIndex!=std::numeric_limits<size_t>::max()) {
+        if (std::find(flags.begin(),
+                      flags.end(),
+                      feature)==flags.end()) {
+          flags.push_back(feature);
+        }
+      }
+      else if (std::find(features.begin(),
+                         features.end(),
+                         feature.featureFilterIndex)==features.end()) {
+        features.push_back(feature.featureFilterIndex);
+      }
+    }
+
+    if (criteria.GetOneway()) {
+      oneway=true;
+    }
+
+    if (criteria.GetSizeCondition() &&
+        std::find(sizeConditions.begin(),
+                  sizeConditions.end(),
+                  criteria.GetSizeCondition())==sizeConditions.end()) {
+      sizeConditions.push_back(criteria.GetSizeCondition());
+    }
+  }
+
+  /**
+   * Evaluate all conditions (in the same way as StyleCriteria::Matches()) and
+   * set one bit for each condition that is fulfilled.
+   */
+  uint64_t StyleFingerprint::Calculate(const StyleResolveContext& context,
+                                       const FeatureValueBuffer& buffer,
+                                       double meterInPixel,
+                                       double meterInMM) const
+  {
+    uint64_t fingerprint=0;
+    size_t   bit=0;
+
+    for (const auto& feature : features) {
+      if (context.HasFeature(feature,
+                             buffer)) {
+        fingerprint|=uint64_t(1) << bit;
+      }
+
+      bit++;
+    }
+
+    for (const auto& flag : flags) {
+      if (context.HasFeature(flag.featureFilterIndex,
+                             buffer)) {
+        FeatureValue *value=context.GetFeatureValue(flag.featureFilterIndex,
+                                                    buffer);
+
+        if (value!=nullptr &&
+            value->IsFlagSet(flag.flagIndex)) {
+          fingerprint|=uint64_t(1) << bit;
+        }
+      }
+
+      bit++;
+    }
+
+    if (oneway) {
+      if (context.IsOneway(buffer)) {
+        fingerprint|=uint64_t(1) << bit;
+      }
+
+      bit++;
+    }
+
+    for (const auto& sizeCondition : sizeConditions) {
+      if (sizeCondition->Evaluate(meterInPixel,meterInMM)) {
+        fingerprint|=uint64_t(1) << bit;
+      }
+
+      bit++;
+    }
+
+    return fingerprint;
+  }
+
   StyleConfig::StyleConfig(const TypeConfigRef& typeConfig)
    : typeConfig(typeConfig),
      styleResolveContext(typeConfig)
@@ -394,6 +489,49 @@ namespace osmscout {
     areaTypeSets.clear();
 
     constants.clear();
+
+    fingerprints.clear();
+    ClearStyleCaches();
+  }
+
+  void StyleConfig::ClearStyleCaches()
+  {
+    nodeTextStyleCache.Clear();
+    nodeIconStyleCache.Clear();
+    wayLineStyleCache.Clear();
+    wayPathTextStyleCache.Clear();
+    wayPathSymbolStyleCache.Clear();
+    wayPathShieldStyleCache.Clear();
+    areaFillStyleCache.Clear();
+    areaBorderStyleCache.Clear();
+    areaTextStyleCache.Clear();
+    areaIconStyleCache.Clear();
+    areaBorderTextStyleCache.Clear();
+    areaBorderSymbolStyleCache.Clear();
+  }
+
+  /**
+   * Return the key for the style caches. Returns false, if the styles of the given type
+   * cannot be cached, because its conditions do not fit into a fingerprint.
+   */
+  bool StyleConfig::GetStyleCacheKey(const TypeInfoRef& type,
+                                     const FeatureValueBuffer& buffer,
+                                     const Projection& projection,
+                                     StyleCacheKey& key) const
+  {
+    if (type->GetIndex()>=fingerprints.size() ||
+        !fingerprints[type->GetIndex()].IsValid()) {
+      return false;
+    }
+
+    key.fingerprint=fingerprints[type->GetIndex()].Calculate(styleResolveContext,
+                                                             buffer,
+                                                             projection.GetMeterInPixel(),
+                                                             projection.GetMeterInMM());
+    key.typeIndex=type->GetIndex();
+    key.level=projection.GetMagnification().GetLevel();
+
+    return true;
   }
 
   bool StyleConfig::RegisterLabelProviderFactory(const std::string& name,
@@ -914,6 +1052,58 @@ namespace osmscout {
     }
   }
 
+  template <class S, class A>
+  static void AddFingerprintCriteria(const std::vector<std::vector<std::list<StyleSelector<S,A> > > >& styleSelectors,
+                                     std::vector<StyleFingerprint>& fingerprints)
+  {
+    if (fingerprints.size()<styleSelectors.size()) {
+      fingerprints.resize(styleSelectors.size());
+    }
+
+    for (size_t typeIndex=0; typeIndex<styleSelectors.size(); typeIndex++) {
+      for (const auto& selectors : styleSelectors[typeIndex]) {
+        for (const auto& selector : selectors) {
+          fingerprints[typeIndex].AddCriteria(selector.criteria);
+        }
+      }
+    }
+  }
+
+  void StyleConfig::PostprocessFingerprints()
+  {
+    fingerprints.clear();
+    fingerprints.resize(typeConfig->GetTypeCount());
+
+    for (const auto& styleSelectors : nodeTextStyleSelectors) {
+      AddFingerprintCriteria(styleSelectors,fingerprints);
+    }
+
+    AddFingerprintCriteria(nodeIconStyleSelectors,fingerprints);
+
+    for (const auto& styleSelectors : wayLineStyleSelectors) {
+      AddFingerprintCriteria(styleSelectors,fingerprints);
+    }
+
+    AddFingerprintCriteria(wayPathTextStyleSelectors,fingerprints);
+    AddFingerprintCriteria(wayPathSymbolStyleSelectors,fingerprints);
+    AddFingerprintCriteria(wayPathShieldStyleSelectors,fingerprints);
+    AddFingerprintCriteria(areaFillStyleSelectors,fingerprints);
+
+    for (const auto& styleSelectors : areaBorderStyleSelectors) {
+      AddFingerprintCriteria(styleSelectors,fingerprints);
+    }
+
+    for (const auto& styleSelectors : areaTextStyleSelectors) {
+      AddFingerprintCriteria(styleSelectors,fingerprints);
+    }
+
+    AddFingerprintCriteria(areaIconStyleSelectors,fingerprints);
+    AddFingerprintCriteria(areaBorderTextStyleSelectors,fingerprints);
+    AddFingerprintCriteria(areaBorderSymbolStyleSelectors,fingerprints);
+
+    ClearStyleCaches();
+  }
+
   void StyleConfig::Postprocess()
   {
     PostprocessNodes();
@@ -922,6 +1112,8 @@ namespace osmscout {
 
     PostprocessIconId();
     PostprocessPatternId();
+
+    PostprocessFingerprints();
   }
 
   TypeConfigRef StyleConfig::GetTypeConfig() const
@@ -1143,6 +1335,16 @@ namespace osmscout {
                                       const Projection& projection,
                                       std::vector<TextStyleRef>& textStyles) const
   {
+    StyleCacheKey key;
+    bool          cacheable=GetStyleCacheKey(buffer.GetType(),
+                                             buffer,
+                                             projection,
+                                             key);
+
+    if (cacheable &&
+        nodeTextStyleCache.Get(key,textStyles)) {
+      return;
+    }
 
     textStyles.clear();
     textStyles.reserve(nodeTextStyleSelectors.size());
@@ -1157,21 +1359,54 @@ namespace osmscout {
         textStyles.push_back(style);
       }
     }
+
+    if (cacheable) {
+      nodeTextStyleCache.Set(key,textStyles);
+    }
   }
 
   IconStyleRef StyleConfig::GetNodeIconStyle(const FeatureValueBuffer& buffer,
                                              const Projection& projection) const
   {
-    return GetFeatureStyle(styleResolveContext,
-                           nodeIconStyleSelectors[buffer.GetType()->GetIndex()],
-                           buffer,
-                           projection);
+    StyleCacheKey key;
+    IconStyleRef  style;
+    bool          cacheable=GetStyleCacheKey(buffer.GetType(),
+                                             buffer,
+                                             projection,
+                                             key);
+
+    if (cacheable &&
+        nodeIconStyleCache.Get(key,style)) {
+      return style;
+    }
+
+    style=GetFeatureStyle(styleResolveContext,
+                          nodeIconStyleSelectors[buffer.GetType()->GetIndex()],
+                          buffer,
+                          projection);
+
+    if (cacheable) {
+      nodeIconStyleCache.Set(key,style);
+    }
+
+    return style;
   }
 
   void StyleConfig::GetWayLineStyles(const FeatureValueBuffer& buffer,
                                      const Projection& projection,
                                      std::vector<LineStyleRef>& lineStyles) const
   {
+    StyleCacheKey key;
+    bool          cacheable=GetStyleCacheKey(buffer.GetType(),
+                                             buffer,
+                                             projection,
+                                             key);
+
+    if (cacheable &&
+        wayLineStyleCache.Get(key,lineStyles)) {
+      return;
+    }
+
     lineStyles.clear();
     lineStyles.reserve(wayLineStyleSelectors.size());
 
@@ -1200,43 +1435,119 @@ namespace osmscout {
                   return a->GetSlot()<b->GetSlot();
       });
     }
+
+    if (cacheable) {
+      wayLineStyleCache.Set(key,lineStyles);
+    }
   }
 
   PathTextStyleRef StyleConfig::GetWayPathTextStyle(const FeatureValueBuffer& buffer,
                                                     const Projection& projection) const
   {
-    return GetFeatureStyle(styleResolveContext,
-                           wayPathTextStyleSelectors[buffer.GetType()->GetIndex()],
-                           buffer,
-                           projection);
+    StyleCacheKey    key;
+    PathTextStyleRef style;
+    bool             cacheable=GetStyleCacheKey(buffer.GetType(),
+                                                buffer,
+                                                projection,
+                                                key);
+
+    if (cacheable &&
+        wayPathTextStyleCache.Get(key,style)) {
+      return style;
+    }
+
+    style=GetFeatureStyle(styleResolveContext,
+                          wayPathTextStyleSelectors[buffer.GetType()->GetIndex()],
+                          buffer,
+                          projection);
+
+    if (cacheable) {
+      wayPathTextStyleCache.Set(key,style);
+    }
+
+    return style;
   }
 
   PathSymbolStyleRef StyleConfig::GetWayPathSymbolStyle(const FeatureValueBuffer& buffer,
                                                         const Projection& projection) const
   {
-    return GetFeatureStyle(styleResolveContext,
-                           wayPathSymbolStyleSelectors[buffer.GetType()->GetIndex()],
-                           buffer,
-                           projection);
+    StyleCacheKey      key;
+    PathSymbolStyleRef style;
+    bool               cacheable=GetStyleCacheKey(buffer.GetType(),
+                                                  buffer,
+                                                  projection,
+                                                  key);
+
+    if (cacheable &&
+        wayPathSymbolStyleCache.Get(key,style)) {
+      return style;
+    }
+
+    style=GetFeatureStyle(styleResolveContext,
+                          wayPathSymbolStyleSelectors[buffer.GetType()->GetIndex()],
+                          buffer,
+                          projection);
+
+    if (cacheable) {
+      wayPathSymbolStyleCache.Set(key,style);
+    }
+
+    return style;
   }
 
   PathShieldStyleRef StyleConfig::GetWayPathShieldStyle(const FeatureValueBuffer& buffer,
                                                         const Projection& projection) const
   {
-    return GetFeatureStyle(styleResolveContext,
-                           wayPathShieldStyleSelectors[buffer.GetType()->GetIndex()],
-                           buffer,
-                           projection);
+    StyleCacheKey      key;
+    PathShieldStyleRef style;
+    bool               cacheable=GetStyleCacheKey(buffer.GetType(),
+                                                  buffer,
+                                                  projection,
+                                                  key);
+
+    if (cacheable &&
+        wayPathShieldStyleCache.Get(key,style)) {
+      return style;
+    }
+
+    style=GetFeatureStyle(styleResolveContext,
+                          wayPathShieldStyleSelectors[buffer.GetType()->GetIndex()],
+                          buffer,
+                          projection);
+
+    if (cacheable) {
+      wayPathShieldStyleCache.Set(key,style);
+    }
+
+    return style;
   }
 
   FillStyleRef StyleConfig::GetAreaFillStyle(const TypeInfoRef& type,
                                              const FeatureValueBuffer& buffer,
                                              const Projection& projection) const
   {
-    return GetFeatureStyle(styleResolveContext,
-                           areaFillStyleSelectors[type->GetIndex()],
-                           buffer,
-                           projection);
+    StyleCacheKey key;
+    FillStyleRef  style;
+    bool          cacheable=GetStyleCacheKey(type,
+                                             buffer,
+                                             projection,
+                                             key);
+
+    if (cacheable &&
+        areaFillStyleCache.Get(key,style)) {
+      return style;
+    }
+
+    style=GetFeatureStyle(styleResolveContext,
+                          areaFillStyleSelectors[type->GetIndex()],
+                          buffer,
+                          projection);
+
+    if (cacheable) {
+      areaFillStyleCache.Set(key,style);
+    }
+
+    return style;
   }
 
   void StyleConfig::GetAreaBorderStyles(const TypeInfoRef& type,
@@ -1244,6 +1555,17 @@ namespace osmscout {
                                         const Projection& projection,
                                         std::vector<BorderStyleRef>& borderStyles) const
   {
+    StyleCacheKey key;
+    bool          cacheable=GetStyleCacheKey(type,
+                                             buffer,
+                                             projection,
+                                             key);
+
+    if (cacheable &&
+        areaBorderStyleCache.Get(key,borderStyles)) {
+      return;
+    }
+
     borderStyles.clear();
     borderStyles.reserve(areaBorderStyleSelectors.size());
 
@@ -1257,6 +1579,10 @@ namespace osmscout {
         borderStyles.push_back(style);
       }
     }
+
+    if (cacheable) {
+      areaBorderStyleCache.Set(key,borderStyles);
+    }
   }
 
   bool StyleConfig::HasAreaTextStyles(const TypeInfoRef& type,
@@ -1282,6 +1608,17 @@ namespace osmscout {
                                       const Projection& projection,
                                       std::vector<TextStyleRef>& textStyles) const
   {
+    StyleCacheKey key;
+    bool          cacheable=GetStyleCacheKey(type,
+                                             buffer,
+                                             projection,
+                                             key);
+
+    if (cacheable &&
+        areaTextStyleCache.Get(key,textStyles)) {
+      return;
+    }
+
     textStyles.clear();
     textStyles.reserve(areaTextStyleSelectors.size());
 
@@ -1295,36 +1632,94 @@ namespace osmscout {
         textStyles.push_back(style);
       }
     }
+
+    if (cacheable) {
+      areaTextStyleCache.Set(key,textStyles);
+    }
   }
 
   IconStyleRef StyleConfig::GetAreaIconStyle(const TypeInfoRef& type,
                                              const FeatureValueBuffer& buffer,
                                              const Projection& projection) const
   {
-    return GetFeatureStyle(styleResolveContext,
-                           areaIconStyleSelectors[type->GetIndex()],
-                           buffer,
-                           projection);
+    StyleCacheKey key;
+    IconStyleRef  style;
+    bool          cacheable=GetStyleCacheKey(type,
+                                             buffer,
+                                             projection,
+                                             key);
+
+    if (cacheable &&
+        areaIconStyleCache.Get(key,style)) {
+      return style;
+    }
+
+    style=GetFeatureStyle(styleResolveContext,
+                          areaIconStyleSelectors[type->GetIndex()],
+                          buffer,
+                          projection);
+
+    if (cacheable) {
+      areaIconStyleCache.Set(key,style);
+    }
+
+    return style;
   }
 
   PathTextStyleRef StyleConfig::GetAreaBorderTextStyle(const TypeInfoRef& type,
                                                        const FeatureValueBuffer& buffer,
                                                        const Projection& projection) const
   {
-    return GetFeatureStyle(styleResolveContext,
-                           areaBorderTextStyleSelectors[type->GetIndex()],
-                           buffer,
-                           projection);
+    StyleCacheKey    key;
+    PathTextStyleRef style;
+    bool             cacheable=GetStyleCacheKey(type,
+                                                buffer,
+                                                projection,
+                                                key);
+
+    if (cacheable &&
+        areaBorderTextStyleCache.Get(key,style)) {
+      return style;
+    }
+
+    style=GetFeatureStyle(styleResolveContext,
+                          areaBorderTextStyleSelectors[type->GetIndex()],
+                          buffer,
+                          projection);
+
+    if (cacheable) {
+      areaBorderTextStyleCache.Set(key,style);
+    }
+
+    return style;
   }
 
   PathSymbolStyleRef StyleConfig::GetAreaBorderSymbolStyle(const TypeInfoRef& type,
                                                            const FeatureValueBuffer& buffer,
                                                            const Projection& projection) const
   {
-    return GetFeatureStyle(styleResolveContext,
-                           areaBorderSymbolStyleSelectors[type->GetIndex()],
-                           buffer,
-                           projection);
+    StyleCacheKey      key;
+    PathSymbolStyleRef style;
+    bool               cacheable=GetStyleCacheKey(type,
+                                                  buffer,
+                                                  projection,
+                                                  key);
+
+    if (cacheable &&
+        areaBorderSymbolStyleCache.Get(key,style)) {
+      return style;
+    }
+
+    style=GetFeatureStyle(styleResolveContext,
+                          areaBorderSymbolStyleSelectors[type->GetIndex()],
+                          buffer,
+                          projection);
+
+    if (cacheable) {
+      areaBorderSymbolStyleCache.Set(key,style);
+    }
+
+    return style;
   }
 
   FillStyleRef StyleConfig::GetLandFillStyle(const Projection& projection) const
@@ -1460,52 +1855,1422 @@ namespace osmscout {
     }
   }
 
-  bool StyleConfig::LoadContent(const std::string& content,
-                                ColorPostprocessor colorPostprocessor)
+  static const char compiledStyleMagic[]={'O','S','S','C'};
+
+  static void WriteDouble(FileWriter& writer,
+                          double value)
   {
-    oss::Scanner *scanner=new oss::Scanner((const unsigned char *)content.c_str(),
-                                           content.length());
-    oss::Parser  *parser=new oss::Parser(scanner,
-                                         *this,
-                                         colorPostprocessor);
-    parser->Parse();
+    uint64_t bits;
 
-    bool success=!parser->errors->hasErrors;
+    std::memcpy(&bits,&value,sizeof(bits));
+    writer.Write(bits);
+  }
 
-    errors.clear();
-    warnings.clear();
+  static double ReadDouble(FileScanner& scanner)
+  {
+    uint64_t bits;
+    double   value;
 
-    for (const auto& err : parser->errors->errors) {
-      switch(err.type) {
-        case oss::Errors::Err::Symbol:
-          errors.push_back(std::to_string(err.line)+","+std::to_string(err.column)+std::string(" Symbol:")+err.text);
-          break;
-        case oss::Errors::Err::Error:
-          errors.push_back(std::to_string(err.line)+","+std::to_string(err.column)+std::string(" Error:")+err.text);
-          break;
-        case oss::Errors::Err::Warning:
-          warnings.push_back(std::to_string(err.line)+","+std::to_string(err.column)+std::string(" Warning:")+err.text);
-          break;
-        case oss::Errors::Err::Exception:
-          errors.push_back(std::to_string(err.line)+","+std::to_string(err.column)+std::string(" Exception:")+err.text);
-          break;
-        default:
-          break;
+    scanner.Read(bits);
+    std::memcpy(&value,&bits,sizeof(value));
+
+    return value;
+  }
+
+  /**
+   * Helper class for writing the compiled form of a style sheet. Styles, size conditions and
+   * features used by the lookup tables are collected into pools first, so that entries
+   * shared by multiple selectors are only written once.
+   */
+  class CompiledStyleWriter CLASS_FINAL
+  {
+  public:
+    template<class S>
+    class Pool
+    {
+    private:
+      std::vector<std::shared_ptr<S>>       entries;
+      std::unordered_map<const S*,uint32_t> indexes;
+
+    public:
+      void Add(const std::shared_ptr<S>& entry)
+      {
+        if (indexes.find(entry.get())==indexes.end()) {
+          indexes.insert(std::make_pair(entry.get(),(uint32_t)entries.size()));
+          entries.push_back(entry);
+        }
+      }
+
+      uint32_t GetIndex(const std::shared_ptr<S>& entry) const
+      {
+        return indexes.at(entry.get());
+      }
+
+      const std::vector<std::shared_ptr<S>>& GetEntries() const
+      {
+        return entries;
+      }
+    };
+
+  private:
+    FileWriter&                          writer;
+    const StyleResolveContext&           context;
+    std::unordered_map<size_t,uint32_t>  featureIndexes; //!< Index in the feature pool by feature reader index
+    std::vector<std::string>             featureNames;   //!< Feature pool
+    Pool<SizeCondition>                  sizeConditions; //!< Size condition pool
+
+  public:
+    Pool<LineStyle>                      lineStyles;
+    Pool<FillStyle>                      fillStyles;
+    Pool<BorderStyle>                    borderStyles;
+    Pool<TextStyle>                      textStyles;
+    Pool<PathShieldStyle>                pathShieldStyles;
+    Pool<PathTextStyle>                  pathTextStyles;
+    Pool<IconStyle>                      iconStyles;
+    Pool<PathSymbolStyle>                pathSymbolStyles;
+
+  private:
+    void WriteColor(const Color& color)
+    {
+      WriteDouble(writer,color.GetR());
+      WriteDouble(writer,color.GetG());
+      WriteDouble(writer,color.GetB());
+      WriteDouble(writer,color.GetA());
+    }
+
+    void WriteDoubles(const std::vector<double>& values)
+    {
+      writer.WriteNumber((uint32_t)values.size());
+
+      for (const auto& value : values) {
+        WriteDouble(writer,value);
       }
     }
 
-    delete parser;
-    delete scanner;
+    void WriteLabel(const LabelProviderRef& label)
+    {
+      writer.Write(label ? label->GetName() : std::string());
+    }
+
+    void WriteSymbolName(const SymbolRef& symbol)
+    {
+      writer.Write(symbol ? symbol->GetName() : std::string());
+    }
+
+    void WriteVertex(const Vertex2D& vertex)
+    {
+      WriteDouble(writer,vertex.GetX());
+      WriteDouble(writer,vertex.GetY());
+    }
+
+    void Write(const LineStyle& style)
+    {
+      writer.Write(style.GetSlot());
+      WriteColor(style.GetLineColor());
+      WriteColor(style.GetGapColor());
+      WriteDouble(writer,style.GetDisplayWidth());
+      WriteDouble(writer,style.GetWidth());
+      WriteDouble(writer,style.GetDisplayOffset());
+      WriteDouble(writer,style.GetOffset());
+      writer.Write((uint8_t)style.GetJoinCap());
+      writer.Write((uint8_t)style.GetEndCap());
+      WriteDoubles(style.GetDash());
+      writer.Write((int32_t)style.GetPriority());
+      writer.Write((int32_t)style.GetZIndex());
+      writer.Write((uint8_t)style.GetOffsetRel());
+    }
+
+    void Write(const FillStyle& style)
+    {
+      WriteColor(style.GetFillColor());
+      writer.Write(style.GetPatternName());
+      WriteDouble(writer,style.GetPatternMinMag().GetMagnification());
+    }
+
+    void Write(const BorderStyle& style)
+    {
+      writer.Write(style.GetSlot());
+      WriteColor(style.GetColor());
+      WriteColor(style.GetGapColor());
+      WriteDouble(writer,style.GetWidth());
+      WriteDoubles(style.GetDash());
+      WriteDouble(writer,style.GetDisplayOffset());
+      WriteDouble(writer,style.GetOffset());
+      writer.Write((int32_t)style.GetPriority());
+    }
+
+    void Write(const TextStyle& style)
+    {
+      writer.Write(style.GetSlot());
+      writer.Write((uint64_t)style.GetPriority());
+      WriteDouble(writer,style.GetSize());
+      WriteLabel(style.GetLabel());
+      writer.Write((uint64_t)style.GetPosition());
+      WriteColor(style.GetTextColor());
+      writer.Write((uint8_t)style.GetStyle());
+      WriteDouble(writer,style.GetScaleAndFadeMag().GetMagnification());
+      writer.Write(style.GetAutoSize());
+    }
+
+    void Write(const PathShieldStyle& style)
+    {
+      WriteLabel(style.GetLabel());
+      writer.Write((uint64_t)style.GetPriority());
+      WriteDouble(writer,style.GetSize());
+      WriteColor(style.GetTextColor());
+      WriteColor(style.GetBgColor());
+      WriteColor(style.GetBorderColor());
+      WriteDouble(writer,style.GetShieldSpace());
+    }
+
+    void Write(const PathTextStyle& style)
+    {
+      WriteLabel(style.GetLabel());
+      WriteDouble(writer,style.GetSize());
+      WriteColor(style.GetTextColor());
+      WriteDouble(writer,style.GetDisplayOffset());
+      WriteDouble(writer,style.GetOffset());
+      writer.Write((uint64_t)style.GetPriority());
+    }
+
+    void Write(const IconStyle& style)
+    {
+      WriteSymbolName(style.GetSymbol());
+      writer.Write(style.GetIconName());
+      writer.Write((uint32_t)style.GetWidth());
+      writer.Write((uint32_t)style.GetHeight());
+      writer.Write((uint64_t)style.GetPosition());
+    }
+
+    void Write(const PathSymbolStyle& style)
+    {
+      WriteSymbolName(style.GetSymbol());
+      WriteDouble(writer,style.GetSymbolSpace());
+      WriteDouble(writer,style.GetDisplayOffset());
+      WriteDouble(writer,style.GetOffset());
+    }
+
+    void Write(const SizeCondition& condition)
+    {
+      writer.Write(condition.HasMinMM());
+      WriteDouble(writer,condition.GetMinMM());
+      writer.Write(condition.HasMinPx());
+      WriteDouble(writer,condition.GetMinPx());
+      writer.Write(condition.HasMaxMM());
+      WriteDouble(writer,condition.GetMaxMM());
+      writer.Write(condition.HasMaxPx());
+      WriteDouble(writer,condition.GetMaxPx());
+    }
+
+    void Write(const StyleCriteria& criteria)
+    {
+      writer.WriteNumber((uint32_t)criteria.GetFeatures().size());
+
+      for (const auto& feature : criteria.GetFeatures()) {
+        writer.WriteNumber(featureIndexes.at(feature.featureFilterIndex));
+        writer.Write((uint64_t)feature.flagIndex);
+      }
 
-    Postprocess();
-    return success;
-  }
+      writer.Write(criteria.GetOneway());
 
-  bool StyleConfig::Load(const std::string& styleFile,
-                         ColorPostprocessor colorPostprocessor)
-  {
-    StopClock  timer;
-    bool       success=false;
+      if (criteria.GetSizeCondition()) {
+        writer.WriteNumber(sizeConditions.GetIndex(criteria.GetSizeCondition())+1);
+      }
+      else {
+        writer.WriteNumber((uint32_t)0);
+      }
+    }
+
+    void Collect(const StyleCriteria& criteria)
+    {
+      for (const auto& feature : criteria.GetFeatures()) {
+        if (featureIndexes.find(feature.featureFilterIndex)==featureIndexes.end()) {
+          featureIndexes.insert(std::make_pair(feature.featureFilterIndex,(uint32_t)featureNames.size()));
+          featureNames.push_back(context.GetFeatureName(feature.featureFilterIndex));
+        }
+      }
+
+      if (criteria.GetSizeCondition()) {
+        sizeConditions.Add(criteria.GetSizeCondition());
+      }
+    }
+
+    template<class S, class A>
+    static bool IsEqual(const std::list<StyleSelector<S,A>>& a,
+                        const std::list<StyleSelector<S,A>>& b)
+    {
+      return a.size()==b.size() &&
+             std::equal(a.begin(),a.end(),
+                        b.begin(),
+                        [](const StyleSelector<S,A>& x,
+                           const StyleSelector<S,A>& y) {
+                          return x.style==y.style &&
+                                 x.attributes==y.attributes &&
+                                 x.criteria==y.criteria;
+                        });
+    }
+
+  public:
+    CompiledStyleWriter(FileWriter& writer,
+                        const StyleResolveContext& context)
+    : writer(writer),
+      context(context)
+    {
+      // no code
+    }
+
+    void WriteFillStyle(const FillStyleRef& style)
+    {
+      writer.Write((bool)style);
+
+      if (style) {
+        Write(*style);
+      }
+    }
+
+    void WriteBorderStyle(const BorderStyleRef& style)
+    {
+      writer.Write((bool)style);
+
+      if (style) {
+        Write(*style);
+      }
+    }
+
+    void WriteSymbol(const Symbol& symbol)
+    {
+      writer.Write(symbol.GetName());
+      writer.WriteNumber((uint32_t)symbol.GetPrimitives().size());
+
+      for (const auto& primitive : symbol.GetPrimitives()) {
+        const DrawPrimitive *primitivePtr=primitive.get();
+
+        if (const auto *polygon=dynamic_cast<const PolygonPrimitive*>(primitivePtr)) {
+          writer.Write((uint8_t)0);
+          writer.Write((uint8_t)polygon->GetProjectionMode());
+          WriteFillStyle(polygon->GetFillStyle());
+          WriteBorderStyle(polygon->GetBorderStyle());
+          writer.WriteNumber((uint32_t)polygon->GetCoords().size());
+
+          for (const auto& coord : polygon->GetCoords()) {
+            WriteVertex(coord);
+          }
+        }
+        else if (const auto *rectangle=dynamic_cast<const RectanglePrimitive*>(primitivePtr)) {
+          writer.Write((uint8_t)1);
+          writer.Write((uint8_t)rectangle->GetProjectionMode());
+          WriteFillStyle(rectangle->GetFillStyle());
+          WriteBorderStyle(rectangle->GetBorderStyle());
+          WriteVertex(rectangle->GetTopLeft());
+          WriteDouble(writer,rectangle->GetWidth());
+          WriteDouble(writer,rectangle->GetHeight());
+        }
+        else if (const auto *circle=dynamic_cast<const CirclePrimitive*>(primitivePtr)) {
+          writer.Write((uint8_t)2);
+          writer.Write((uint8_t)circle->GetProjectionMode());
+          WriteFillStyle(circle->GetFillStyle());
+          WriteBorderStyle(circle->GetBorderStyle());
+          WriteVertex(circle->GetCenter());
+          WriteDouble(writer,circle->GetRadius());
+        }
+        else {
+          throw IOException(writer.GetFilename(),
+                            "Cannot write symbol",
+                            "Unsupported primitive in symbol '"+symbol.GetName()+"'");
+        }
+      }
+    }
+
+    void WriteTypeSets(const std::vector<TypeInfoSet>& typeSets)
+    {
+      writer.WriteNumber((uint32_t)typeSets.size());
+
+      for (const auto& typeSet : typeSets) {
+        std::vector<uint32_t> typeIndexes;
+
+        for (const auto& type : typeSet) {
+          typeIndexes.push_back((uint32_t)type->GetIndex());
+        }
+
+        writer.WriteNumber((uint32_t)typeIndexes.size());
+
+        for (const auto& typeIndex : typeIndexes) {
+          writer.WriteNumber(typeIndex);
+        }
+      }
+    }
+
+    /**
+     * Adds styles and conditions of the given lookup table to the pools
+     */
+    template<class S, class A>
+    void CollectTable(const std::vector<std::vector<std::list<StyleSelector<S,A>>>>& table,
+                      Pool<S>& styles)
+    {
+      for (const auto& levels : table) {
+        for (const auto& selectors : levels) {
+          for (const auto& selector : selectors) {
+            Collect(selector.criteria);
+            styles.Add(selector.style);
+          }
+        }
+      }
+    }
+
+    /**
+     * Write the feature and size condition pools
+     */
+    void WriteCriteriaPools()
+    {
+      writer.WriteNumber((uint32_t)featureNames.size());
+
+      for (const auto& featureName : featureNames) {
+        writer.Write(featureName);
+      }
+
+      writer.WriteNumber((uint32_t)sizeConditions.GetEntries().size());
+
+      for (const auto& condition : sizeConditions.GetEntries()) {
+        Write(*condition);
+      }
+    }
+
+    template<class S>
+    void WritePool(const Pool<S>& styles)
+    {
+      writer.WriteNumber((uint32_t)styles.GetEntries().size());
+
+      for (const auto& style : styles.GetEntries()) {
+        Write(*style);
+      }
+    }
+
+    template<class S, class A>
+    void WriteTable(const std::vector<std::vector<std::list<StyleSelector<S,A>>>>& table,
+                    const Pool<S>& styles)
+    {
+      writer.WriteNumber((uint32_t)table.size());
+
+      for (const auto& levels : table) {
+        writer.WriteNumber((uint32_t)levels.size());
+
+        // Consecutive levels with the same selectors are written only once, together
+        // with the number of levels they apply to
+        size_t level=0;
+
+        while (level<levels.size()) {
+          size_t runEnd=level+1;
+
+          while (runEnd<levels.size() &&
+                 IsEqual(levels[runEnd],levels[level])) {
+            runEnd++;
+          }
+
+          writer.WriteNumber((uint32_t)(runEnd-level));
+          writer.WriteNumber((uint32_t)levels[level].size());
+
+          for (const auto& selector : levels[level]) {
+            Write(selector.criteria);
+
+            writer.WriteNumber((uint32_t)selector.attributes.size());
+
+            for (const auto& attribute : selector.attributes) {
+              writer.WriteNumber((uint32_t)attribute);
+            }
+
+            writer.WriteNumber(styles.GetIndex(selector.style));
+          }
+
+          level=runEnd;
+        }
+      }
+    }
+  };
+
+  /**
+   * Helper class for reading the compiled form of a style sheet written by CompiledStyleWriter.
+   */
+  class CompiledStyleReader CLASS_FINAL
+  {
+  private:
+    FileScanner&                                     scanner;
+    const StyleConfig&                               styleConfig;
+    const TypeConfig&                                typeConfig;
+    std::unordered_map<std::string,LabelProviderRef> labels;         //!< Already resolved label providers by name
+    std::vector<size_t>                              featureIndexes; //!< Feature reader index by index in the feature pool
+    std::vector<SizeConditionRef>                    sizeConditions; //!< Size condition pool
+
+  public:
+    std::vector<LineStyleRef>                        lineStyles;
+    std::vector<FillStyleRef>                        fillStyles;
+    std::vector<BorderStyleRef>                      borderStyles;
+    std::vector<TextStyleRef>                        textStyles;
+    std::vector<PathShieldStyleRef>                  pathShieldStyles;
+    std::vector<PathTextStyleRef>                    pathTextStyles;
+    std::vector<IconStyleRef>                        iconStyles;
+    std::vector<PathSymbolStyleRef>                  pathSymbolStyles;
+
+  private:
+    uint32_t ReadIndex(size_t size,
+                       const std::string& context)
+    {
+      uint32_t index;
+
+      scanner.ReadNumber(index);
+
+      if (index>=size) {
+        throw IOException(scanner.GetFilename(),
+                          "Cannot read "+context,
+                          "Index "+std::to_string(index)+" is out of range");
+      }
+
+      return index;
+    }
+
+    Color ReadColor()
+    {
+      double r=ReadDouble(scanner);
+      double g=ReadDouble(scanner);
+      double b=ReadDouble(scanner);
+      double a=ReadDouble(scanner);
+
+      return Color(r,g,b,a);
+    }
+
+    std::vector<double> ReadDoubles()
+    {
+      uint32_t            count;
+      std::vector<double> values;
+
+      scanner.ReadNumber(count);
+      values.reserve(count);
+
+      for (uint32_t i=0; i<count; i++) {
+        values.push_back(ReadDouble(scanner));
+      }
+
+      return values;
+    }
+
+    size_t ReadSize()
+    {
+      uint64_t value;
+
+      scanner.Read(value);
+
+      return (size_t)value;
+    }
+
+    LabelProviderRef ReadLabel()
+    {
+      std::string name;
+
+      scanner.Read(name);
+
+      if (name.empty()) {
+        return nullptr;
+      }
+
+      auto entry=labels.find(name);
+
+      if (entry!=labels.end()) {
+        return entry->second;
+      }
+
+      LabelProviderRef label;
+      size_t           separator=name.find('.');
+
+      if (separator!=std::string::npos) {
+        std::string featureName=name.substr(0,separator);
+        std::string labelName=name.substr(separator+1);
+        FeatureRef  feature=typeConfig.GetFeature(featureName);
+        size_t      labelIndex;
+
+        if (feature &&
+            feature->HasLabel() &&
+            feature->GetLabelIndex(labelName,labelIndex)) {
+          label=std::make_shared<DynamicFeatureLabelReader>(typeConfig,
+                                                            featureName,
+                                                            labelName);
+        }
+      }
+      else {
+        label=styleConfig.GetLabelProvider(name);
+      }
+
+      if (!label) {
+        throw IOException(scanner.GetFilename(),
+                          "Cannot read label",
+                          "There is no label provider with name '"+name+"'");
+      }
+
+      labels.insert(std::make_pair(name,label));
+
+      return label;
+    }
+
+    SymbolRef ReadSymbolName()
+    {
+      std::string name;
+
+      scanner.Read(name);
+
+      if (name.empty()) {
+        return nullptr;
+      }
+
+      SymbolRef symbol=styleConfig.GetSymbol(name);
+
+      if (!symbol) {
+        throw IOException(scanner.GetFilename(),
+                          "Cannot read symbol",
+                          "There is no symbol with name '"+name+"'");
+      }
+
+      return symbol;
+    }
+
+    Vertex2D ReadVertex()
+    {
+      double x=ReadDouble(scanner);
+      double y=ReadDouble(scanner);
+
+      return Vertex2D(x,y);
+    }
+
+    void Read(LineStyle& style)
+    {
+      std::string slot;
+      uint8_t     joinCap;
+      uint8_t     endCap;
+      int32_t     priority;
+      int32_t     zIndex;
+      uint8_t     offsetRel;
+
+      scanner.Read(slot);
+      style.SetSlot(slot);
+      style.SetLineColor(ReadColor());
+      style.SetGapColor(ReadColor());
+      style.SetDisplayWidth(ReadDouble(scanner));
+      style.SetWidth(ReadDouble(scanner));
+      style.SetDisplayOffset(ReadDouble(scanner));
+      style.SetOffset(ReadDouble(scanner));
+      scanner.Read(joinCap);
+      style.SetJoinCap((LineStyle::CapStyle)joinCap);
+      scanner.Read(endCap);
+      style.SetEndCap((LineStyle::CapStyle)endCap);
+      style.SetDashes(ReadDoubles());
+      scanner.Read(priority);
+      style.SetPriority(priority);
+      scanner.Read(zIndex);
+      style.SetZIndex(zIndex);
+      scanner.Read(offsetRel);
+      style.SetOffsetRel((LineStyle::OffsetRel)offsetRel);
+    }
+
+    void Read(FillStyle& style)
+    {
+      std::string pattern;
+
+      style.SetFillColor(ReadColor());
+      scanner.Read(pattern);
+      style.SetPattern(pattern);
+      style.SetPatternMinMag(Magnification(ReadDouble(scanner)));
+    }
+
+    void Read(BorderStyle& style)
+    {
+      std::string slot;
+      int32_t     priority;
+
+      scanner.Read(slot);
+      style.SetSlot(slot);
+      style.SetColor(ReadColor());
+      style.SetGapColor(ReadColor());
+      style.SetWidth(ReadDouble(scanner));
+      style.SetDashes(ReadDoubles());
+      style.SetDisplayOffset(ReadDouble(scanner));
+      style.SetOffset(ReadDouble(scanner));
+      scanner.Read(priority);
+      style.SetPriority(priority);
+    }
+
+    void Read(TextStyle& style)
+    {
+      std::string slot;
+      uint8_t     textStyle;
+      bool        autoSize;
+
+      scanner.Read(slot);
+      style.SetSlot(slot);
+      style.SetPriority(ReadSize());
+      style.SetSize(ReadDouble(scanner));
+      style.SetLabel(ReadLabel());
+      style.SetPosition(ReadSize());
+      style.SetTextColor(ReadColor());
+      scanner.Read(textStyle);
+      style.SetStyle((TextStyle::Style)textStyle);
+      style.SetScaleAndFadeMag(Magnification(ReadDouble(scanner)));
+      scanner.Read(autoSize);
+      style.SetAutoSize(autoSize);
+    }
+
+    void Read(PathShieldStyle& style)
+    {
+      style.SetLabel(ReadLabel());
+      style.SetPriority(ReadSize());
+      style.SetSize(ReadDouble(scanner));
+      style.SetTextColor(ReadColor());
+      style.SetBgColor(ReadColor());
+      style.SetBorderColor(ReadColor());
+      style.SetShieldSpace(ReadDouble(scanner));
+    }
+
+    void Read(PathTextStyle& style)
+    {
+      style.SetLabel(ReadLabel());
+      style.SetSize(ReadDouble(scanner));
+      style.SetTextColor(ReadColor());
+      style.SetDisplayOffset(ReadDouble(scanner));
+      style.SetOffset(ReadDouble(scanner));
+      style.SetPriority(ReadSize());
+    }
+
+    void Read(IconStyle& style)
+    {
+      std::string iconName;
+      uint32_t    width;
+      uint32_t    height;
+
+      style.SetSymbol(ReadSymbolName());
+      scanner.Read(iconName);
+      style.SetIconName(iconName);
+      scanner.Read(width);
+      style.SetWidth(width);
+      scanner.Read(height);
+      style.SetHeight(height);
+      style.SetPosition(ReadSize());
+    }
+
+    void Read(PathSymbolStyle& style)
+    {
+      style.SetSymbol(ReadSymbolName());
+      style.SetSymbolSpace(ReadDouble(scanner));
+      style.SetDisplayOffset(ReadDouble(scanner));
+      style.SetOffset(ReadDouble(scanner));
+    }
+
+    SizeConditionRef ReadSizeCondition()
+    {
+      SizeConditionRef condition=std::make_shared<SizeCondition>();
+      bool             isSet;
+      double           value;
+
+      scanner.Read(isSet);
+      value=ReadDouble(scanner);
+      if (isSet) {
+        condition->SetMinMM(value);
+      }
+
+      scanner.Read(isSet);
+      value=ReadDouble(scanner);
+      if (isSet) {
+        condition->SetMinPx(value);
+      }
+
+      scanner.Read(isSet);
+      value=ReadDouble(scanner);
+      if (isSet) {
+        condition->SetMaxMM(value);
+      }
+
+      scanner.Read(isSet);
+      value=ReadDouble(scanner);
+      if (isSet) {
+        condition->SetMaxPx(value);
+      }
+
+      return condition;
+    }
+
+    StyleCriteria ReadCriteria()
+    {
+      StyleFilter filter;
+      uint32_t    featureCount;
+      bool        oneway;
+      uint32_t    sizeConditionIndex;
+
+      scanner.ReadNumber(featureCount);
+
+      for (uint32_t i=0; i<featureCount; i++) {
+        uint32_t featureIndex=ReadIndex(featureIndexes.size(),"feature filter");
+
+        filter.AddFeature(featureIndexes[featureIndex],
+                          ReadSize());
+      }
+
+      scanner.Read(oneway);
+      filter.SetOneway(oneway);
+
+      scanner.ReadNumber(sizeConditionIndex);
+
+      if (sizeConditionIndex>0) {
+        if (sizeConditionIndex>sizeConditions.size()) {
+          throw IOException(scanner.GetFilename(),
+                            "Cannot read size condition",
+                            "Index "+std::to_string(sizeConditionIndex)+" is out of range");
+        }
+
+        filter.SetSizeCondition(sizeConditions[sizeConditionIndex-1]);
+      }
+
+      return StyleCriteria(filter);
+    }
+
+  public:
+    CompiledStyleReader(FileScanner& scanner,
+                        const StyleConfig& styleConfig)
+    : scanner(scanner),
+      styleConfig(styleConfig),
+      typeConfig(*styleConfig.GetTypeConfig())
+    {
+      // no code
+    }
+
+    FillStyleRef ReadFillStyle()
+    {
+      bool hasStyle;
+
+      scanner.Read(hasStyle);
+
+      if (!hasStyle) {
+        return nullptr;
+      }
+
+      FillStyleRef style=std::make_shared<FillStyle>();
+
+      Read(*style);
+
+      return style;
+    }
+
+    BorderStyleRef ReadBorderStyle()
+    {
+      bool hasStyle;
+
+      scanner.Read(hasStyle);
+
+      if (!hasStyle) {
+        return nullptr;
+      }
+
+      BorderStyleRef style=std::make_shared<BorderStyle>();
+
+      Read(*style);
+
+      return style;
+    }
+
+    SymbolRef ReadSymbol()
+    {
+      std::string name;
+      uint32_t    primitiveCount;
+
+      scanner.Read(name);
+
+      SymbolRef symbol=std::make_shared<Symbol>(name);
+
+      scanner.ReadNumber(primitiveCount);
+
+      for (uint32_t i=0; i<primitiveCount; i++) {
+        uint8_t                        kind;
+        uint8_t                        projectionMode;
+        DrawPrimitive::ProjectionMode  mode;
+
+        scanner.Read(kind);
+        scanner.Read(projectionMode);
+        mode=(DrawPrimitive::ProjectionMode)projectionMode;
+
+        FillStyleRef   fillStyle=ReadFillStyle();
+        BorderStyleRef borderStyle=ReadBorderStyle();
+
+        if (kind==0) {
+          PolygonPrimitiveRef polygon=std::make_shared<PolygonPrimitive>(mode,
+                                                                         fillStyle,
+                                                                         borderStyle);
+          uint32_t            coordCount;
+
+          scanner.ReadNumber(coordCount);
+
+          for (uint32_t c=0; c<coordCount; c++) {
+            polygon->AddCoord(ReadVertex());
+          }
+
+          symbol->AddPrimitive(polygon);
+        }
+        else if (kind==1) {
+          Vertex2D topLeft=ReadVertex();
+          double   width=ReadDouble(scanner);
+          double   height=ReadDouble(scanner);
+
+          symbol->AddPrimitive(std::make_shared<RectanglePrimitive>(mode,
+                                                                    topLeft,
+                                                                    width,
+                                                                    height,
+                                                                    fillStyle,
+                                                                    borderStyle));
+        }
+        else if (kind==2) {
+          Vertex2D center=ReadVertex();
+          double   radius=ReadDouble(scanner);
+
+          symbol->AddPrimitive(std::make_shared<CirclePrimitive>(mode,
+                                                                 center,
+                                                                 radius,
+                                                                 fillStyle,
+                                                                 borderStyle));
+        }
+        else {
+          throw IOException(scanner.GetFilename(),
+                            "Cannot read symbol",
+                            "Unsupported primitive in symbol '"+name+"'");
+        }
+      }
+
+      return symbol;
+    }
+
+    void ReadTypeSets(std::vector<TypeInfoSet>& typeSets)
+    {
+      uint32_t levelCount;
+
+      scanner.ReadNumber(levelCount);
+
+      typeSets.reserve(levelCount);
+
+      for (uint32_t level=0; level<levelCount; level++) {
+        TypeInfoSet typeSet(typeConfig);
+        uint32_t    typeCount;
+
+        scanner.ReadNumber(typeCount);
+
+        for (uint32_t i=0; i<typeCount; i++) {
+          typeSet.Set(typeConfig.GetTypeInfo(ReadIndex(typeConfig.GetTypeCount(),"type set")));
+        }
+
+        typeSets.push_back(std::move(typeSet));
+      }
+    }
+
+    /**
+     * Read the feature and size condition pools
+     */
+    void ReadCriteriaPools()
+    {
+      uint32_t featureCount;
+      uint32_t sizeConditionCount;
+
+      scanner.ReadNumber(featureCount);
+
+      for (uint32_t i=0; i<featureCount; i++) {
+        std::string featureName;
+
+        scanner.Read(featureName);
+
+        FeatureRef feature=typeConfig.GetFeature(featureName);
+
+        if (!feature) {
+          throw IOException(scanner.GetFilename(),
+                            "Cannot read feature filter",
+                            "There is no feature with name '"+featureName+"'");
+        }
+
+        featureIndexes.push_back(styleConfig.GetFeatureFilterIndex(*feature));
+      }
+
+      scanner.ReadNumber(sizeConditionCount);
+
+      for (uint32_t i=0; i<sizeConditionCount; i++) {
+        sizeConditions.push_back(ReadSizeCondition());
+      }
+    }
+
+    template<class S>
+    void ReadPool(std::vector<std::shared_ptr<S>>& styles)
+    {
+      uint32_t count;
+
+      scanner.ReadNumber(count);
+
+      styles.reserve(count);
+
+      for (uint32_t i=0; i<count; i++) {
+        std::shared_ptr<S> style=std::make_shared<S>();
+
+        Read(*style);
+
+        styles.push_back(style);
+      }
+    }
+
+    template<class S, class A>
+    void ReadTable(std::vector<std::vector<std::list<StyleSelector<S,A>>>>& table,
+                   const std::vector<std::shared_ptr<S>>& styles)
+    {
+      uint32_t typeCount;
+
+      scanner.ReadNumber(typeCount);
+
+      if (typeCount>typeConfig.GetTypeCount()) {
+        throw IOException(scanner.GetFilename(),
+                          "Cannot read style table",
+                          "Table has more entries than there are types");
+      }
+
+      table.resize(typeCount);
+
+      for (auto& levels : table) {
+        uint32_t levelCount;
+
+        scanner.ReadNumber(levelCount);
+
+        levels.resize(levelCount);
+
+        size_t level=0;
+
+        while (level<levels.size()) {
+          uint32_t runLength;
+          uint32_t selectorCount;
+
+          scanner.ReadNumber(runLength);
+
+          if (runLength==0 ||
+              runLength>levels.size()-level) {
+            throw IOException(scanner.GetFilename(),
+                              "Cannot read style table",
+                              "Invalid number of levels");
+          }
+
+          scanner.ReadNumber(selectorCount);
+
+          for (uint32_t i=0; i<selectorCount; i++) {
+            StyleCriteria criteria=ReadCriteria();
+            std::set<A>   attributes;
+            uint32_t      attributeCount;
+
+            scanner.ReadNumber(attributeCount);
+
+            for (uint32_t a=0; a<attributeCount; a++) {
+              uint32_t attribute;
+
+              scanner.ReadNumber(attribute);
+              attributes.insert((A)attribute);
+            }
+
+            levels[level].emplace_back(criteria,
+                                       attributes,
+                                       styles[ReadIndex(styles.size(),"style")]);
+          }
+
+          for (size_t l=level+1; l<level+runLength; l++) {
+            levels[l]=levels[level];
+          }
+
+          level+=runLength;
+        }
+      }
+    }
+  };
+
+  bool StyleConfig::IsCompiled(const std::string& filename)
+  {
+    FILE *file=fopen(filename.c_str(),"rb");
+
+    if (file==nullptr) {
+      return false;
+    }
+
+    char magic[sizeof(compiledStyleMagic)];
+    bool result=fread(magic,1,sizeof(magic),file)==sizeof(magic) &&
+                std::memcmp(magic,compiledStyleMagic,sizeof(magic))==0;
+
+    fclose(file);
+
+    return result;
+  }
+
+  /**
+   * Store the postprocessed style sheet in its compiled binary form. Loading the compiled
+   * form skips parsing and postprocessing of the style sheet.
+   */
+  bool StyleConfig::StoreCompiled(const std::string& filename) const
+  {
+    FileWriter writer;
+
+    try {
+      CompiledStyleWriter styleWriter(writer,
+                                      styleResolveContext);
+
+      writer.Open(filename);
+
+      writer.Write(compiledStyleMagic,sizeof(compiledStyleMagic));
+      writer.Write(COMPILED_FORMAT_VERSION);
+
+      // Type configuration, the compiled style sheet depends on the type indexes
+
+      writer.WriteNumber((uint32_t)typeConfig->GetTypeCount());
+
+      for (const auto& type : typeConfig->GetTypes()) {
+        writer.Write(type->GetName());
+      }
+
+      // Flags, sorted for reproducible output
+
+      std::map<std::string,bool> sortedFlags(flags.begin(),flags.end());
+
+      writer.WriteNumber((uint32_t)sortedFlags.size());
+
+      for (const auto& flag : sortedFlags) {
+        writer.Write(flag.first);
+        writer.Write(flag.second);
+      }
+
+      std::map<std::string,SymbolRef> sortedSymbols(symbols.begin(),symbols.end());
+
+      writer.WriteNumber((uint32_t)sortedSymbols.size());
+
+      for (const auto& symbol : sortedSymbols) {
+        styleWriter.WriteSymbol(*symbol.second);
+      }
+
+      writer.WriteNumber((uint32_t)wayPrio.size());
+
+      for (const auto& prio : wayPrio) {
+        writer.Write((uint64_t)prio);
+      }
+
+      styleWriter.WriteTypeSets(nodeTypeSets);
+      styleWriter.WriteTypeSets(wayTypeSets);
+      styleWriter.WriteTypeSets(areaTypeSets);
+
+      for (const auto& table : nodeTextStyleSelectors) {
+        styleWriter.CollectTable(table,styleWriter.textStyles);
+      }
+
+      styleWriter.CollectTable(nodeIconStyleSelectors,styleWriter.iconStyles);
+
+      for (const auto& table : wayLineStyleSelectors) {
+        styleWriter.CollectTable(table,styleWriter.lineStyles);
+      }
+
+      styleWriter.CollectTable(wayPathTextStyleSelectors,styleWriter.pathTextStyles);
+      styleWriter.CollectTable(wayPathSymbolStyleSelectors,styleWriter.pathSymbolStyles);
+      styleWriter.CollectTable(wayPathShieldStyleSelectors,styleWriter.pathShieldStyles);
+      styleWriter.CollectTable(areaFillStyleSelectors,styleWriter.fillStyles);
+
+      for (const auto& table : areaBorderStyleSelectors) {
+        styleWriter.CollectTable(table,styleWriter.borderStyles);
+      }
+
+      for (const auto& table : areaTextStyleSelectors) {
+        styleWriter.CollectTable(table,styleWriter.textStyles);
+      }
+
+      styleWriter.CollectTable(areaIconStyleSelectors,styleWriter.iconStyles);
+      styleWriter.CollectTable(areaBorderTextStyleSelectors,styleWriter.pathTextStyles);
+      styleWriter.CollectTable(areaBorderSymbolStyleSelectors,styleWriter.pathSymbolStyles);
+
+      styleWriter.WriteCriteriaPools();
+
+      styleWriter.WritePool(styleWriter.lineStyles);
+      styleWriter.WritePool(styleWriter.fillStyles);
+      styleWriter.WritePool(styleWriter.borderStyles);
+      styleWriter.WritePool(styleWriter.textStyles);
+      styleWriter.WritePool(styleWriter.pathShieldStyles);
+      styleWriter.WritePool(styleWriter.pathTextStyles);
+      styleWriter.WritePool(styleWriter.iconStyles);
+      styleWriter.WritePool(styleWriter.pathSymbolStyles);
+
+      writer.WriteNumber((uint32_t)nodeTextStyleSelectors.size());
+
+      for (const auto& table : nodeTextStyleSelectors) {
+        styleWriter.WriteTable(table,styleWriter.textStyles);
+      }
+
+      styleWriter.WriteTable(nodeIconStyleSelectors,styleWriter.iconStyles);
+
+      writer.WriteNumber((uint32_t)wayLineStyleSelectors.size());
+
+      for (const auto& table : wayLineStyleSelectors) {
+        styleWriter.WriteTable(table,styleWriter.lineStyles);
+      }
+
+      styleWriter.WriteTable(wayPathTextStyleSelectors,styleWriter.pathTextStyles);
+      styleWriter.WriteTable(wayPathSymbolStyleSelectors,styleWriter.pathSymbolStyles);
+      styleWriter.WriteTable(wayPathShieldStyleSelectors,styleWriter.pathShieldStyles);
+      styleWriter.WriteTable(areaFillStyleSelectors,styleWriter.fillStyles);
+
+      writer.WriteNumber((uint32_t)areaBorderStyleSelectors.size());
+
+      for (const auto& table : areaBorderStyleSelectors) {
+        styleWriter.WriteTable(table,styleWriter.borderStyles);
+      }
+
+      writer.WriteNumber((uint32_t)areaTextStyleSelectors.size());
+
+      for (const auto& table : areaTextStyleSelectors) {
+        styleWriter.WriteTable(table,styleWriter.textStyles);
+      }
+
+      styleWriter.WriteTable(areaIconStyleSelectors,styleWriter.iconStyles);
+      styleWriter.WriteTable(areaBorderTextStyleSelectors,styleWriter.pathTextStyles);
+      styleWriter.WriteTable(areaBorderSymbolStyleSelectors,styleWriter.pathSymbolStyles);
+
+      writer.Close();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      writer.CloseFailsafe();
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Load a style sheet in the compiled form as written by StoreCompiled(). The type
+   * configuration must match the one the style sheet was compiled with. Flags set
+   * before loading must have the same value as at compile time.
+   */
+  bool StyleConfig::LoadCompiled(const std::string& filename)
+  {
+    StopClock   timer;
+    FileScanner scanner;
+
+    Reset();
+
+    errors.clear();
+    warnings.clear();
+
+    try {
+      CompiledStyleReader styleReader(scanner,
+                                      *this);
+      char                magic[sizeof(compiledStyleMagic)];
+      uint32_t            version;
+      uint32_t            typeCount;
+      uint32_t            flagCount;
+      uint32_t            symbolCount;
+      uint32_t            wayPrioCount;
+      uint32_t            tableCount;
+
+      scanner.Open(filename,
+                   FileScanner::Sequential,
+                   true);
+
+      scanner.Read(magic,sizeof(magic));
+
+      if (std::memcmp(magic,compiledStyleMagic,sizeof(magic))!=0) {
+        throw IOException(filename,
+                          "Cannot load compiled style sheet",
+                          "File is not a compiled style sheet");
+      }
+
+      scanner.Read(version);
+
+      if (version!=COMPILED_FORMAT_VERSION) {
+        throw IOException(filename,
+                          "Cannot load compiled style sheet",
+                          "Format version "+std::to_string(version)+" is not supported");
+      }
+
+      scanner.ReadNumber(typeCount);
+
+      if (typeCount!=typeConfig->GetTypeCount()) {
+        throw IOException(filename,
+                          "Cannot load compiled style sheet",
+                          "Style sheet was compiled for a different type configuration");
+      }
+
+      for (const auto& type : typeConfig->GetTypes()) {
+        std::string typeName;
+
+        scanner.Read(typeName);
+
+        if (typeName!=type->GetName()) {
+          throw IOException(filename,
+                            "Cannot load compiled style sheet",
+                            "Style sheet was compiled for a different type configuration");
+        }
+      }
+
+      scanner.ReadNumber(flagCount);
+
+      for (uint32_t i=0; i<flagCount; i++) {
+        std::string name;
+        bool        value;
+
+        scanner.Read(name);
+        scanner.Read(value);
+
+        if (HasFlag(name) &&
+            GetFlagByName(name)!=value) {
+          throw IOException(filename,
+                            "Cannot load compiled style sheet",
+                            "Style sheet was compiled with a different value for flag '"+name+"'");
+        }
+
+        AddFlag(name,value);
+      }
+
+      scanner.ReadNumber(symbolCount);
+
+      for (uint32_t i=0; i<symbolCount; i++) {
+        RegisterSymbol(styleReader.ReadSymbol());
+      }
+
+      scanner.ReadNumber(wayPrioCount);
+
+      wayPrio.reserve(wayPrioCount);
+
+      for (uint32_t i=0; i<wayPrioCount; i++) {
+        uint64_t prio;
+
+        scanner.Read(prio);
+        wayPrio.push_back((size_t)prio);
+      }
+
+      styleReader.ReadTypeSets(nodeTypeSets);
+      styleReader.ReadTypeSets(wayTypeSets);
+      styleReader.ReadTypeSets(areaTypeSets);
+
+      styleReader.ReadCriteriaPools();
+
+      styleReader.ReadPool(styleReader.lineStyles);
+      styleReader.ReadPool(styleReader.fillStyles);
+      styleReader.ReadPool(styleReader.borderStyles);
+      styleReader.ReadPool(styleReader.textStyles);
+      styleReader.ReadPool(styleReader.pathShieldStyles);
+      styleReader.ReadPool(styleReader.pathTextStyles);
+      styleReader.ReadPool(styleReader.iconStyles);
+      styleReader.ReadPool(styleReader.pathSymbolStyles);
+
+      scanner.ReadNumber(tableCount);
+      nodeTextStyleSelectors.resize(tableCount);
+
+      for (auto& table : nodeTextStyleSelectors) {
+        styleReader.ReadTable(table,styleReader.textStyles);
+      }
+
+      styleReader.ReadTable(nodeIconStyleSelectors,styleReader.iconStyles);
+
+      scanner.ReadNumber(tableCount);
+      wayLineStyleSelectors.resize(tableCount);
+
+      for (auto& table : wayLineStyleSelectors) {
+        styleReader.ReadTable(table,styleReader.lineStyles);
+      }
+
+      styleReader.ReadTable(wayPathTextStyleSelectors,styleReader.pathTextStyles);
+      styleReader.ReadTable(wayPathSymbolStyleSelectors,styleReader.pathSymbolStyles);
+      styleReader.ReadTable(wayPathShieldStyleSelectors,styleReader.pathShieldStyles);
+      styleReader.ReadTable(areaFillStyleSelectors,styleReader.fillStyles);
+
+      scanner.ReadNumber(tableCount);
+      areaBorderStyleSelectors.resize(tableCount);
+
+      for (auto& table : areaBorderStyleSelectors) {
+        styleReader.ReadTable(table,styleReader.borderStyles);
+      }
+
+      scanner.ReadNumber(tableCount);
+      areaTextStyleSelectors.resize(tableCount);
+
+      for (auto& table : areaTextStyleSelectors) {
+        styleReader.ReadTable(table,styleReader.textStyles);
+      }
+
+      styleReader.ReadTable(areaIconStyleSelectors,styleReader.iconStyles);
+      styleReader.ReadTable(areaBorderTextStyleSelectors,styleReader.pathTextStyles);
+      styleReader.ReadTable(areaBorderSymbolStyleSelectors,styleReader.pathSymbolStyles);
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      errors.push_back(e.GetDescription());
+      scanner.CloseFailsafe();
+      Reset();
+
+      return false;
+    }
+
+    PostprocessIconId();
+    PostprocessPatternId();
+    PostprocessFingerprints();
+
+    timer.Stop();
+
+    log.Debug() << "Opening compiled StyleConfig: " << timer.ResultString();
+
+    return true;
+  }
+
+  bool StyleConfig::LoadContent(const std::string& content,
+                                ColorPostprocessor colorPostprocessor)
+  {
+    oss::Scanner *scanner=new oss::Scanner((const unsigned char *)content.c_str(),
+                                           content.length());
+    oss::Parser  *parser=new oss::Parser(scanner,
+                                         *this,
+                                         colorPostprocessor);
+    parser->Parse();
+
+    bool success=!parser->errors->hasErrors;
+
+    errors.clear();
+    warnings.clear();
+
+    for (const auto& err : parser->errors->errors) {
+      switch(err.type) {
+        case oss::Errors::Err::Symbol:
+          errors.push_back(std::to_string(err.line)+","+std::to_string(err.column)+std::string(" Symbol:")+err.text);
+          break;
+        case oss::Errors::Err::Error:
+          errors.push_back(std::to_string(err.line)+","+std::to_string(err.column)+std::string(" Error:")+err.text);
+          break;
+        case oss::Errors::Err::Warning:
+          warnings.push_back(std::to_string(err.line)+","+std::to_string(err.column)+std::string(" Warning:")+err.text);
+          break;
+        case oss::Errors::Err::Exception:
+          errors.push_back(std::to_string(err.line)+","+std::to_string(err.column)+std::string(" Exception:")+err.text);
+          break;
+        default:
+          break;
+      }
+    }
+
+    delete parser;
+    delete scanner;
+
+    Postprocess();
+    return success;
+  }
+
+  bool StyleConfig::Load(const std::string& styleFile,
+                         ColorPostprocessor colorPostprocessor)
+  {
+    StopClock  timer;
+    bool       success=false;
+
+    if (IsCompiled(styleFile)) {
+      if (colorPostprocessor!=nullptr) {
+        log.Error() << "Cannot apply color postprocessor to compiled style sheet '" << styleFile << "'";
+
+        return false;
+      }
+
+      return LoadCompiled(styleFile);
+    }
 
     try {
       FILE*      file;
@@ -0,0 +1,632 @@
+/*
+  This source is part of the libosmscout-map library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+
+#include <osmscout/TileSeeder.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include <osmscout/util/Logger.h>
+#include <osmscout/util/StopClock.h>
+
+#include <osmscout/system/Assert.h>
+
+namespace osmscout {
+
+  MetatileRenderer::~MetatileRenderer()
+  {
+    // no code
+  }
+
+  TileSeederParameter::TileSeederParameter()
+  : metatileSize(8),
+    metatileMargin(0),
+    tileWidth(256),
+    tileHeight(256),
+    dpi(96.0),
+    resume(true)
+  {
+    searchParameter.SetUseLowZoomOptimization(true);
+  }
+
+  void TileSeederParameter::SetMetatileSize(uint32_t metatileSize)
+  {
+    assert(metatileSize>0);
+
+    this->metatileSize=metatileSize;
+  }
+
+  void TileSeederParameter::SetMetatileMargin(uint32_t metatileMargin)
+  {
+    this->metatileMargin=metatileMargin;
+  }
+
+  void TileSeederParameter::SetTileSize(size_t tileWidth,
+                                        size_t tileHeight)
+  {
+    this->tileWidth=tileWidth;
+    this->tileHeight=tileHeight;
+  }
+
+  void TileSeederParameter::SetDPI(double dpi)
+  {
+    this->dpi=dpi;
+  }
+
+  void TileSeederParameter::SetResume(bool resume)
+  {
+    this->resume=resume;
+  }
+
+  void TileSeederParameter::SetSearchParameter(const AreaSearchParameter& searchParameter)
+  {
+    this->searchParameter=searchParameter;
+  }
+
+  void TileSeederParameter::SetBreaker(const BreakerRef& breaker)
+  {
+    this->breaker=breaker;
+  }
+
+  bool TileSeederParameter::IsAborted() const
+  {
+    if (breaker) {
+      return breaker->IsAborted();
+    }
+
+    return false;
+  }
+
+  TileSeederStatistics::TileSeederStatistics()
+  : metatilesRendered(0),
+    tilesRendered(0),
+    tilesSkipped(0),
+    bytesWritten(0),
+    dataTileHits(0),
+    dataTileMisses(0),
+    steals(0),
+    seconds(0.0)
+  {
+    // no code
+  }
+
+  double TileSeederStatistics::GetTilesPerSecond() const
+  {
+    if (seconds<=0.0) {
+      return 0.0;
+    }
+
+    return tilesRendered/seconds;
+  }
+
+  double TileSeederStatistics::GetDataTileHitRate() const
+  {
+    if (dataTileHits+dataTileMisses==0) {
+      return 0.0;
+    }
+
+    return (double)dataTileHits/(dataTileHits+dataTileMisses);
+  }
+
+  TileSeeder::TileSeeder(const MapServiceRef& mapService,
+                         const StyleConfigRef& styleConfig,
+                         const TileStorageRef& storage,
+                         const TileSeederParameter& parameter)
+  : mapService(mapService),
+    styleConfig(styleConfig),
+    storage(storage),
+    parameter(parameter),
+    pending(0),
+    queueChanges(0),
+    processed(0),
+    failed(false),
+    metatilesRendered(0),
+    tilesRendered(0),
+    tilesSkipped(0),
+    bytesWritten(0),
+    dataTileHits(0),
+    dataTileMisses(0),
+    steals(0),
+    seconds(0.0)
+  {
+    // no code
+  }
+
+  /**
+   * Return the index of the given cell on a Hilbert curve filling a square of
+   * size x size cells. Size must be a power of two.
+   */
+  uint64_t TileSeeder::GetHilbertIndex(uint32_t size,
+                                       uint32_t x,
+                                       uint32_t y)
+  {
+    uint64_t index=0;
+
+    for (uint32_t s=size/2; s>0; s/=2) {
+      uint32_t rx=(x & s)>0 ? 1 : 0;
+      uint32_t ry=(y & s)>0 ? 1 : 0;
+
+      index+=(uint64_t)s*s*((3*rx)^ry);
+
+      // Rotate the quadrant, so the curve is continuous
+      if (ry==0) {
+        if (rx==1) {
+          x=size-1-x;
+          y=size-1-y;
+        }
+
+        std::swap(x,y);
+      }
+    }
+
+    return index;
+  }
+
+  /**
+   * Return the metatiles covering the given tiles, ordered along a Hilbert curve over
+   * the aligned metatile grid of the magnification. The order only depends on the
+   * position of the metatiles, so it is the same for every run.
+   */
+  std::vector<Metatile> TileSeeder::GetOrderedMetatiles(const Magnification& magnification,
+                                                        const OSMTileIdBox& tiles,
+                                                        uint32_t metatileSize,
+                                                        uint32_t metatileMargin,
+                                                        size_t tileWidth,
+                                                        size_t tileHeight)
+  {
+    std::list<Metatile> metatiles=Metatile::GetMetatiles(magnification,
+                                                         tiles,
+                                                         metatileSize,
+                                                         metatileMargin,
+                                                         tileWidth,
+                                                         tileHeight);
+    uint32_t            gridSize=1;
+    uint64_t            tileCount=(uint64_t)magnification.GetMagnification();
+
+    while ((uint64_t)gridSize*metatileSize<tileCount) {
+      gridSize*=2;
+    }
+
+    std::vector<std::pair<uint64_t,const Metatile*>> order;
+
+    order.reserve(metatiles.size());
+
+    for (const auto& metatile : metatiles) {
+      order.push_back(std::make_pair(GetHilbertIndex(gridSize,
+                                                     metatile.GetTiles().GetMinX()/metatileSize,
+                                                     metatile.GetTiles().GetMinY()/metatileSize),
+                                     &metatile));
+    }
+
+    std::sort(order.begin(),
+              order.end(),
+              [](const std::pair<uint64_t,const Metatile*>& a,
+                 const std::pair<uint64_t,const Metatile*>& b) {
+      return a.first<b.first;
+    });
+
+    std::vector<Metatile> result;
+
+    result.reserve(order.size());
+
+    for (const auto& entry : order) {
+      result.push_back(*entry.second);
+    }
+
+    return result;
+  }
+
+  /**
+   * Wake up all workers waiting for metatiles to be moved between other workers
+   */
+  void TileSeeder::NotifyQueueChange()
+  {
+    {
+      std::lock_guard<std::mutex> guard(queueChangeMutex);
+
+      queueChanges++;
+    }
+
+    queueChanged.notify_all();
+  }
+
+  /**
+   * Take the next metatile for the given worker. The worker takes metatiles from the
+   * front of its own queue. If its queue is empty, it steals half of the metatiles
+   * from the back of the queue of the worker with the most remaining metatiles.
+   * If all other queues are empty while metatiles are still pending, they are just
+   * being moved by a steal and the worker waits until the steal is finished.
+   *
+   * Returns false, if there are no metatiles left.
+   */
+  bool TileSeeder::PopMetatile(size_t worker,
+                               size_t& metatile)
+  {
+    WorkerQueue& own=*queues[worker];
+
+    while (pending>0) {
+      size_t changes;
+      bool   popped=false;
+      bool   last=false;
+
+      {
+        std::lock_guard<std::mutex> guard(queueChangeMutex);
+
+        changes=queueChanges;
+      }
+
+      {
+        std::lock_guard<std::mutex> guard(own.mutex);
+
+        if (!own.metatiles.empty()) {
+          metatile=own.metatiles.front();
+          own.metatiles.pop_front();
+          popped=true;
+          last=--pending==0;
+        }
+      }
+
+      if (popped) {
+        // Waiting workers must not wait for steals, if there is nothing left
+        if (last) {
+          NotifyQueueChange();
+        }
+
+        return true;
+      }
+
+      size_t victim=worker;
+      size_t victimSize=0;
+
+      for (size_t i=0; i<queues.size(); i++) {
+        if (i==worker) {
+          continue;
+        }
+
+        std::lock_guard<std::mutex> guard(queues[i]->mutex);
+
+        if (queues[i]->metatiles.size()>victimSize) {
+          victim=i;
+          victimSize=queues[i]->metatiles.size();
+        }
+      }
+
+      if (victimSize==0) {
+        std::unique_lock<std::mutex> lock(queueChangeMutex);
+
+        queueChanged.wait(lock,[this,changes] {
+          return queueChanges!=changes;
+        });
+
+        continue;
+      }
+
+      WorkerQueue& other=*queues[victim];
+
+      {
+        std::lock(own.mutex,other.mutex);
+        std::lock_guard<std::mutex> ownGuard(own.mutex,std::adopt_lock);
+        std::lock_guard<std::mutex> otherGuard(other.mutex,std::adopt_lock);
+
+        size_t count=(other.metatiles.size()+1)/2;
+
+        if (count==0) {
+          continue;
+        }
+
+        own.metatiles.insert(own.metatiles.end(),
+                             other.metatiles.end()-count,
+                             other.metatiles.end());
+        other.metatiles.erase(other.metatiles.end()-count,
+                              other.metatiles.end());
+      }
+
+      steals++;
+
+      NotifyQueueChange();
+    }
+
+    return false;
+  }
+
+  /**
+   * Load the data of the given metatile, render it and store the resulting tiles
+   * that are part of the seeded tiles
+   */
+  bool TileSeeder::ProcessMetatile(const Metatile& metatile,
+                                   const OSMTileIdBox& seededTiles,
+                                   MetatileRenderer& renderer)
+  {
+    MagnificationLevel level(metatile.GetMagnification().GetLevel());
+    size_t             tileCount=0;
+
+    for (const auto& tile : metatile.GetTiles()) {
+      if (seededTiles.Includes(tile)) {
+        tileCount++;
+      }
+    }
+
+    if (parameter.GetResume()) {
+      bool complete=true;
+
+      for (const auto& tile : metatile.GetTiles()) {
+        if (seededTiles.Includes(tile) &&
+            !storage->HasTile(level,tile)) {
+          complete=false;
+          break;
+        }
+      }
+
+      if (complete) {
+        tilesSkipped+=tileCount;
+        return true;
+      }
+    }
+
+    TileProjection projection;
+
+    if (!metatile.GetProjection(projection,
+                                parameter.GetDPI())) {
+      log.Error() << "Cannot calculate projection for metatile " << level.Get() << " " << metatile.GetTiles().GetDisplayText();
+      return false;
+    }
+
+    std::list<TileRef> dataTiles;
+    MapData            data;
+
+    mapService->LookupTiles(metatile.GetMagnification(),
+                            metatile.GetBoundingBox(),
+                            dataTiles);
+
+    for (const auto& tile : dataTiles) {
+      if (tile->IsComplete()) {
+        dataTileHits++;
+      }
+      else {
+        dataTileMisses++;
+      }
+    }
+
+    if (!mapService->LoadMissingTileData(parameter.GetSearchParameter(),
+                                         *styleConfig,
+                                         dataTiles)) {
+      log.Error() << "Cannot load data for metatile " << level.Get() << " " << metatile.GetTiles().GetDisplayText();
+      return false;
+    }
+
+    mapService->AddTileDataToMapData(dataTiles,
+                                     data);
+
+    dataTiles.clear();
+
+    std::vector<std::string> tiles;
+
+    if (!renderer.RenderMetatile(metatile,
+                                 projection,
+                                 data,
+                                 tiles)) {
+      log.Error() << "Cannot render metatile " << level.Get() << " " << metatile.GetTiles().GetDisplayText();
+      return false;
+    }
+
+    if (tiles.size()!=metatile.GetTiles().GetCount()) {
+      log.Error() << "Renderer returned " << tiles.size() << " instead of " << metatile.GetTiles().GetCount() << " tiles for metatile " << level.Get() << " " << metatile.GetTiles().GetDisplayText();
+      return false;
+    }
+
+    size_t idx=0;
+
+    for (const auto& tile : metatile.GetTiles()) {
+      // Tiles outside of the seeded region are only rendered to keep the metatile aligned
+      if (!seededTiles.Includes(tile)) {
+        idx++;
+        continue;
+      }
+
+      if (!storage->StoreTile(level,
+                              tile,
+                              tiles[idx])) {
+        log.Error() << "Cannot store tile " << level.Get() << " " << tile.GetDisplayText();
+        return false;
+      }
+
+      bytesWritten+=tiles[idx].size();
+      idx++;
+    }
+
+    metatilesRendered++;
+    tilesRendered+=tileCount;
+
+    // Keep the data cache within its limits
+    mapService->CleanupTileCache();
+
+    return true;
+  }
+
+  void TileSeeder::ProcessMetatiles(size_t worker,
+                                    MetatileRenderer* renderer,
+                                    const std::vector<Metatile>* metatiles,
+                                    const OSMTileIdBox* seededTiles)
+  {
+    size_t metatile;
+
+    while (!failed &&
+           !parameter.IsAborted() &&
+           PopMetatile(worker,
+                       metatile)) {
+      if (!ProcessMetatile((*metatiles)[metatile],
+                           *seededTiles,
+                           *renderer)) {
+        failed=true;
+      }
+
+      processed++;
+    }
+  }
+
+  /**
+   * Render all tiles within the given bounding box for the given range of levels.
+   * One worker thread is started for each renderer.
+   *
+   * Returns false, if there was an error or if seeding was interrupted by the breaker.
+   * In both cases all stored tiles are flushed before returning, so seeding can
+   * be resumed.
+   */
+  bool TileSeeder::Seed(const GeoBox& boundingBox,
+                        const MagnificationLevel& startLevel,
+                        const MagnificationLevel& endLevel,
+                        const std::vector<MetatileRendererRef>& renderers,
+                        Progress& progress)
+  {
+    StopClock overallTime;
+
+    if (renderers.empty()) {
+      log.Error() << "No renderers given";
+      return false;
+    }
+
+    failed=false;
+    metatilesRendered=0;
+    tilesRendered=0;
+    tilesSkipped=0;
+    bytesWritten=0;
+    dataTileHits=0;
+    dataTileMisses=0;
+    steals=0;
+
+    queues.clear();
+
+    for (size_t i=0; i<renderers.size(); i++) {
+      queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+
+    for (MagnificationLevel level=std::min(startLevel,endLevel);
+         level<=std::max(startLevel,endLevel) && !failed && !parameter.IsAborted();
+         level++) {
+      Magnification         magnification(level);
+      OSMTileIdBox          tiles(OSMTileId::GetOSMTile(magnification,
+                                                        boundingBox.GetMinCoord()),
+                                  OSMTileId::GetOSMTile(magnification,
+                                                        boundingBox.GetMaxCoord()));
+      std::vector<Metatile> metatiles=GetOrderedMetatiles(magnification,
+                                                          tiles,
+                                                          parameter.GetMetatileSize(),
+                                                          parameter.GetMetatileMargin(),
+                                                          parameter.GetTileWidth(),
+                                                          parameter.GetTileHeight());
+
+      progress.SetAction("Seeding level "+std::to_string(level.Get())+", "+
+                         std::to_string(tiles.GetCount())+" tiles in "+
+                         std::to_string(metatiles.size())+" metatiles");
+
+      // Each worker starts with a contiguous part of the curve
+      for (size_t i=0; i<queues.size(); i++) {
+        size_t start=metatiles.size()*i/queues.size();
+        size_t end=metatiles.size()*(i+1)/queues.size();
+
+        queues[i]->metatiles.clear();
+
+        for (size_t idx=start; idx<end; idx++) {
+          queues[i]->metatiles.push_back(idx);
+        }
+      }
+
+      pending=metatiles.size();
+      processed=0;
+
+      std::vector<std::thread> workers;
+
+      for (size_t i=0; i<renderers.size(); i++) {
+        workers.push_back(std::thread(&TileSeeder::ProcessMetatiles,
+                                      this,
+                                      i,
+                                      renderers[i].get(),
+                                      &metatiles,
+                                      &tiles));
+      }
+
+      while (processed<metatiles.size() &&
+             !failed &&
+             !parameter.IsAborted()) {
+        progress.SetProgress(processed.load(),
+                             metatiles.size());
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      }
+
+      for (auto& worker : workers) {
+        worker.join();
+      }
+
+      progress.SetProgress(processed.load(),
+                           metatiles.size());
+    }
+
+    bool flushed=storage->Flush();
+
+    overallTime.Stop();
+
+    seconds=overallTime.GetMilliseconds()/1000.0;
+
+    TileSeederStatistics statistics=GetStatistics();
+
+    progress.Info("Rendered "+std::to_string(statistics.tilesRendered)+" tiles in "+
+                  std::to_string(statistics.metatilesRendered)+" metatiles, skipped "+
+                  std::to_string(statistics.tilesSkipped)+" stored tiles");
+    progress.Info(std::to_string(statistics.GetTilesPerSecond())+" tiles/s, "+
+                  std::to_string(statistics.bytesWritten)+" bytes, data cache hit rate "+
+                  std::to_string(statistics.GetDataTileHitRate()*100.0)+"%, "+
+                  std::to_string(statistics.steals)+" steals");
+
+    if (!flushed) {
+      progress.Error("Cannot flush tile storage");
+      return false;
+    }
+
+    if (failed) {
+      progress.Error("Seeding failed");
+      return false;
+    }
+
+    if (parameter.IsAborted()) {
+      progress.Warning("Seeding interrupted");
+      return false;
+    }
+
+    return true;
+  }
+
+  TileSeederStatistics TileSeeder::GetStatistics() const
+  {
+    TileSeederStatistics statistics;
+
+    statistics.metatilesRendered=metatilesRendered;
+    statistics.tilesRendered=tilesRendered;
+    statistics.tilesSkipped=tilesSkipped;
+    statistics.bytesWritten=bytesWritten;
+    statistics.dataTileHits=dataTileHits;
+    statistics.dataTileMisses=dataTileMisses;
+    statistics.steals=steals;
+    statistics.seconds=seconds;
+
+    return statistics;
+  }
+}
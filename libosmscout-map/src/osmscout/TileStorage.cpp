@@ -0,0 +1,418 @@
+/*
+  This source is part of the libosmscout-map library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/TileStorage.h>
+
+#include <algorithm>
+
+#include <osmscout/util/Exception.h>
+#include <osmscout/util/File.h>
+#include <osmscout/util/Logger.h>
+
+namespace osmscout {
+
+  static const char     packMagic[]={'O','S','T','P'};
+  static const uint32_t packRecordHeaderSize=4*sizeof(uint32_t);
+
+  TileStorage::~TileStorage()
+  {
+    // no code
+  }
+
+  DirectoryTileStorage::DirectoryTileStorage(const std::string& directory,
+                                             const std::string& extension)
+  : directory(directory),
+    extension(extension)
+  {
+    // no code
+  }
+
+  std::string DirectoryTileStorage::GetTileDirectory(const MagnificationLevel& level,
+                                                     const OSMTileId& tile) const
+  {
+    return AppendFileToDir(AppendFileToDir(directory,
+                                           std::to_string(level.Get())),
+                           std::to_string(tile.GetX()));
+  }
+
+  std::string DirectoryTileStorage::GetTileFilename(const MagnificationLevel& level,
+                                                    const OSMTileId& tile) const
+  {
+    return AppendFileToDir(GetTileDirectory(level,
+                                            tile),
+                           std::to_string(tile.GetY())+"."+extension);
+  }
+
+  bool DirectoryTileStorage::HasTile(const MagnificationLevel& level,
+                                     const OSMTileId& tile) const
+  {
+    try {
+      return ExistsInFilesystem(GetTileFilename(level,
+                                                tile));
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+  }
+
+  bool DirectoryTileStorage::StoreTile(const MagnificationLevel& level,
+                                       const OSMTileId& tile,
+                                       const std::string& content)
+  {
+    std::string tileDirectory=GetTileDirectory(level,
+                                               tile);
+    std::string filename=GetTileFilename(level,
+                                         tile);
+    std::string tmpFilename=filename+".tmp";
+
+    try {
+      {
+        std::lock_guard<std::mutex> guard(mutex);
+
+        if (!MakeDirectory(AppendFileToDir(directory,
+                                           std::to_string(level.Get()))) ||
+            !MakeDirectory(tileDirectory)) {
+          log.Error() << "Cannot create directory '" << tileDirectory << "'";
+          return false;
+        }
+      }
+
+      FileWriter writer;
+
+      writer.Open(tmpFilename);
+      writer.Write(content.data(),
+                   content.size());
+      writer.Close();
+
+      // Replacing the file in one step, so there are never partial tiles
+      if (!RenameFile(tmpFilename,
+                      filename)) {
+        log.Error() << "Cannot rename '" << tmpFilename << "' to '" << filename << "'";
+        return false;
+      }
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool DirectoryTileStorage::Flush()
+  {
+    // Every tile is already written on its own
+    return true;
+  }
+
+  const char*    TilePackStorage::FILE_TILES_PACK="tiles.pack";
+  const uint32_t TilePackStorage::FILE_FORMAT_VERSION=1;
+  const size_t   TilePackStorage::DEFAULT_COMMIT_INTERVAL=256;
+
+  TilePackStorage::TilePackStorage()
+  : commitInterval(DEFAULT_COMMIT_INTERVAL),
+    dataEnd(0),
+    uncommittedTiles(0)
+  {
+    // no code
+  }
+
+  TilePackStorage::~TilePackStorage()
+  {
+    if (IsOpen()) {
+      Close();
+    }
+  }
+
+  TilePackStorage::TileKey TilePackStorage::GetKey(const MagnificationLevel& level,
+                                                   const OSMTileId& tile)
+  {
+    return std::make_pair(level.Get(),
+                          std::make_pair(tile.GetX(),
+                                         tile.GetY()));
+  }
+
+  /**
+   * Set the number of tiles written between two commits. A higher value reduces
+   * the number of writes to the header, a lower value reduces the number of tiles
+   * that must be rendered again after an interruption.
+   */
+  void TilePackStorage::SetCommitInterval(size_t commitInterval)
+  {
+    this->commitInterval=commitInterval;
+  }
+
+  /**
+   * Read the header and rebuild the index from the committed tile records
+   *
+   * @throws IOException
+   */
+  void TilePackStorage::ReadIndex()
+  {
+    FileScanner indexScanner;
+    char        magic[sizeof(packMagic)];
+    uint32_t    version;
+
+    indexScanner.Open(filename,
+                      FileScanner::Sequential,
+                      false);
+
+    indexScanner.Read(magic,
+                      sizeof(magic));
+
+    if (!std::equal(magic,magic+sizeof(magic),packMagic)) {
+      throw IOException(filename,"Cannot read tile pack","Not a tile pack");
+    }
+
+    indexScanner.Read(version);
+
+    if (version!=FILE_FORMAT_VERSION) {
+      throw IOException(filename,"Cannot read tile pack","Unsupported file format version "+std::to_string(version));
+    }
+
+    indexScanner.Read(dataEnd);
+
+    FileOffset offset=indexScanner.GetPos();
+
+    while (offset<dataEnd) {
+      uint32_t  level;
+      uint32_t  x;
+      uint32_t  y;
+      TileEntry entry;
+
+      indexScanner.SetPos(offset);
+
+      indexScanner.Read(level);
+      indexScanner.Read(x);
+      indexScanner.Read(y);
+      indexScanner.Read(entry.size);
+
+      entry.offset=offset+packRecordHeaderSize;
+      offset=entry.offset+entry.size;
+
+      if (offset>dataEnd) {
+        throw IOException(filename,"Cannot read tile pack","Tile record exceeds committed data");
+      }
+
+      // Later records replace earlier ones
+      index[GetKey(MagnificationLevel(level),OSMTileId(x,y))]=entry;
+    }
+
+    indexScanner.Close();
+  }
+
+  /**
+   * Write all pending data and store the end of the tile records in the header.
+   * Tile records are synced to disk before the header is written, so even after
+   * a system crash the header never points to records that have not been written.
+   * The header is synced afterwards, so the commit is durable on return.
+   *
+   * @throws IOException
+   */
+  void TilePackStorage::Commit()
+  {
+    writer.Sync();
+
+    writer.SetPos(sizeof(packMagic)+sizeof(uint32_t));
+    writer.Write((uint64_t)dataEnd);
+    writer.Sync();
+
+    writer.SetPos(dataEnd);
+
+    uncommittedTiles=0;
+  }
+
+  /**
+   * Open the given file. If the file already exists, the committed tiles are
+   * loaded into the index and new tiles get appended, else a new file is created.
+   */
+  bool TilePackStorage::Open(const std::string& filename)
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    this->filename=filename;
+
+    index.clear();
+    uncommittedTiles=0;
+
+    try {
+      if (ExistsInFilesystem(filename)) {
+        ReadIndex();
+
+        writer.OpenExisting(filename);
+        writer.SetPos(dataEnd);
+      }
+      else {
+        writer.Open(filename);
+
+        writer.Write(packMagic,
+                     sizeof(packMagic));
+        writer.Write(FILE_FORMAT_VERSION);
+
+        dataEnd=writer.GetPos()+sizeof(uint64_t);
+
+        writer.Write((uint64_t)dataEnd);
+        writer.Sync();
+      }
+
+      scanner.Open(filename,
+                   FileScanner::LowMemRandom,
+                   false);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      writer.CloseFailsafe();
+      scanner.CloseFailsafe();
+      index.clear();
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Commit all written tiles and close the file
+   */
+  bool TilePackStorage::Close()
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    try {
+      Commit();
+
+      writer.Close();
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      writer.CloseFailsafe();
+      scanner.CloseFailsafe();
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Return the number of (distinct) tiles in the file
+   */
+  size_t TilePackStorage::GetTileCount() const
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    return index.size();
+  }
+
+  /**
+   * Read the content of the given tile. Returns false, if the tile is not
+   * stored or if there was an error.
+   */
+  bool TilePackStorage::GetTile(const MagnificationLevel& level,
+                                const OSMTileId& tile,
+                                std::string& content) const
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    auto entry=index.find(GetKey(level,tile));
+
+    if (entry==index.end()) {
+      return false;
+    }
+
+    try {
+      // The tile might still be in the write buffer
+      writer.Flush();
+
+      content.resize(entry->second.size);
+
+      scanner.SetPos(entry->second.offset);
+
+      if (entry->second.size>0) {
+        scanner.Read(&content[0],
+                     entry->second.size);
+      }
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool TilePackStorage::HasTile(const MagnificationLevel& level,
+                                const OSMTileId& tile) const
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    return index.find(GetKey(level,tile))!=index.end();
+  }
+
+  bool TilePackStorage::StoreTile(const MagnificationLevel& level,
+                                  const OSMTileId& tile,
+                                  const std::string& content)
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    TileEntry                   entry;
+
+    try {
+      writer.Write((uint32_t)level.Get());
+      writer.Write(tile.GetX());
+      writer.Write(tile.GetY());
+      writer.Write((uint32_t)content.size());
+
+      entry.offset=writer.GetPos();
+      entry.size=(uint32_t)content.size();
+
+      writer.Write(content.data(),
+                   content.size());
+
+      dataEnd=writer.GetPos();
+
+      index[GetKey(level,tile)]=entry;
+      uncommittedTiles++;
+
+      if (uncommittedTiles>=commitInterval) {
+        Commit();
+      }
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    return true;
+  }
+
+  bool TilePackStorage::Flush()
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+
+    try {
+      Commit();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    return true;
+  }
+}
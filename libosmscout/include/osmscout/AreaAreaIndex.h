@@ -28,9 +28,11 @@
 
 #include <osmscout/TypeInfoSet.h>
 
+#include <osmscout/util/AsyncFileReader.h>
 #include <osmscout/util/Cache.h>
 #include <osmscout/util/Geometry.h>
 #include <osmscout/util/FileScanner.h>
+#include <osmscout/util/MemoryBudget.h>
 
 namespace osmscout {
 
@@ -47,8 +49,13 @@ namespace osmscout {
 
     Internally the index is implemented as quadtree. As a result each index entry
     has 4 children (besides entries in the lowest level).
+
+    The index cell cache can be controlled by a MemoryBudget.
+
+    If enabled using SetAsyncPrefetch(), the cells of a level are read using an
+    AsyncFileReader with many reads in flight and decoded from the read buffers.
     */
-  class OSMSCOUT_API AreaAreaIndex
+  class OSMSCOUT_API AreaAreaIndex : public MemoryBudget::Consumer
   {
   public:
     static const char* AREA_AREA_IDX;
@@ -105,17 +112,41 @@ namespace osmscout {
 
     mutable std::mutex    lookupMutex;
 
+    bool                             asyncPrefetch; //!< Read the cells of a level using an AsyncFileReader
+    FileOffset                       fileSize;      //!< Size of the index file, if asyncPrefetch is set
+    std::unique_ptr<AsyncFileReader> asyncReader;   //!< Reader for the cells, if asyncPrefetch is set
+
   private:
+    void ReadIndexCell(FileScanner& cellScanner,
+                       FileOffset offset,
+                       IndexCell& indexCell) const;
+
     bool GetIndexCell(uint32_t level,
                       FileOffset offset,
+                      FileScanner* bufferScanner,
                       IndexCell& indexCell,
                       FileOffset& dataOffset) const;
 
     bool ReadCellData(const TypeConfig& typeConfig,
                       const TypeInfoSet& types,
+                      FileScanner* bufferScanner,
                       FileOffset dataOffset,
                       std::vector<DataBlockSpan>& spans) const;
 
+    bool ReadCell(const TypeConfig& typeConfig,
+                  const TypeInfoSet& types,
+                  uint32_t level,
+                  FileOffset offset,
+                  FileScanner* bufferScanner,
+                  IndexCell& indexCell,
+                  std::vector<DataBlockSpan>& spans) const;
+
+    void ReadCells(const std::vector<CellRef>& cellRefs,
+                   size_t begin,
+                   size_t end,
+                   std::vector<char>& buffer,
+                   std::vector<AsyncFileReader::ReadRequest>& requests) const;
+
     void PushCellsForNextLevel(double minlon,
                                double minlat,
                                double maxlon,
@@ -130,6 +161,8 @@ namespace osmscout {
     explicit AreaAreaIndex(size_t cacheSize);
     virtual ~AreaAreaIndex();
 
+    void SetAsyncPrefetch(bool asyncPrefetch);
+
     void Close();
     bool Open(const std::string& path, bool memoryMappedData);
 
@@ -150,6 +183,16 @@ namespace osmscout {
                         std::vector<DataBlockSpan>& spans,
                         TypeInfoSet& loadedTypes) const;
 
+    std::string GetMemoryConsumerName() const override;
+    size_t GetMemoryUsage() const override;
+    void GetCacheStatistics(size_t& hits,
+                            size_t& misses) const override;
+    void SetMemoryLimit(size_t bytes) override;
+
+    void GetCachedCellOffsets(std::vector<FileOffset>& offsets) const;
+    bool LoadCells(const std::vector<FileOffset>& offsets,
+                   FileOffset& bytesRead) const;
+
     void DumpStatistics();
   };
 
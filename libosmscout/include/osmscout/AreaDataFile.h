@@ -37,7 +37,11 @@ namespace osmscout {
     static const char* AREAS_IDMAP;
 
   public:
-    AreaDataFile(size_t cacheSize);
+    AreaDataFile(size_t cacheSize,
+                 size_t cacheShardCount=1);
+
+  protected:
+    size_t GetValueMemory(const Area& area) const override;
   };
 
   typedef std::shared_ptr<AreaDataFile> AreaDataFileRef;
@@ -71,6 +71,11 @@ namespace osmscout {
 
       FileOffset GetDataOffset() const;
       FileOffset GetCellOffset(size_t x, size_t y) const;
+      bool GetCellRange(const GeoBox& boundingBox,
+                        uint32_t& minxc,
+                        uint32_t& maxxc,
+                        uint32_t& minyc,
+                        uint32_t& maxyc) const;
     };
 
   private:
@@ -85,6 +90,9 @@ namespace osmscout {
     bool GetOffsets(const TypeData& typeData,
                     const GeoBox& boundingBox,
                     std::vector<FileOffset>& offsets) const;
+    bool GetOffsets(const TypeData& typeData,
+                    const std::vector<GeoBox>& boundingBoxes,
+                    std::vector<FileOffset>& offsets) const;
 
   public:
     AreaNodeIndex();
@@ -107,6 +115,15 @@ namespace osmscout {
                     const TypeInfoSet& requestedTypes,
                     std::vector<FileOffset>& offsets,
                     TypeInfoSet& loadedTypes) const;
+
+    /**
+     * Returns the offsets of all nodes of the requested types in any of the given
+     * bounding boxes. Index cells covered by more than one box are read only once.
+     */
+    bool GetOffsets(const std::vector<GeoBox>& boundingBoxes,
+                    const TypeInfoSet& requestedTypes,
+                    std::vector<FileOffset>& offsets,
+                    TypeInfoSet& loadedTypes) const;
   };
 
   typedef std::shared_ptr<AreaNodeIndex> AreaNodeIndexRef;
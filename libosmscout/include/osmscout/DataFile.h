@@ -20,18 +20,26 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <mutex>
 #include <set>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <osmscout/NumericIndex.h>
 #include <osmscout/TypeConfig.h>
 
+#include <osmscout/util/AsyncFileReader.h>
 #include <osmscout/util/Cache.h>
+#include <osmscout/util/File.h>
 #include <osmscout/util/FileScanner.h>
 #include <osmscout/util/Logger.h>
+#include <osmscout/util/MemoryBudget.h>
+
+#include <osmscout/system/Compiler.h>
 
 namespace osmscout {
 
@@ -67,9 +75,24 @@ namespace osmscout {
    * Access to standard format data files.
    *
    * Allows to load data objects by offset using various standard library data structures.
+   *
+   * The data file is designed for concurrent readers:
+   * * The value cache is split into a number of shards (selected by file offset), each
+   *   secured by its own mutex. Cache lookups of different threads thus only
+   *   contend, if they hit the same shard and a lookup never waits for disk access.
+   * * Reading is done using a pool of FileScanner instances. Each reading thread
+   *   leases its own scanner, so cache misses for different offsets
+   *   are loaded in parallel.
+   *
+   * The size of the value cache is either given as number of entries or controlled by
+   * a MemoryBudget, in which case the cache is limited in bytes.
+   *
+   * Bulk requests are prefetched by advising the kernel (see FileScanner::Prefetch()) or,
+   * if enabled using SetAsyncPrefetch(), read with an AsyncFileReader and decoded from
+   * the read buffers.
    */
   template <class N>
-  class DataFile
+  class DataFile : public MemoryBudget::Consumer
   {
   public:
     typedef std::shared_ptr<N> ValueType;
@@ -79,17 +102,111 @@ namespace osmscout {
     typedef typename Cache<FileOffset,ValueType>::CacheRef ValueCacheRef;
 
   private:
-    std::string         datafile;        //!< Basename part of the data file name
-    std::string         datafilename;    //!< complete filename for data file
+    /**
+     * One stripe of the value cache together with the mutex guarding it
+     */
+    struct CacheShard
+    {
+      std::mutex mutex; //!< Mutex to secure multi-thread access to the cache
+      ValueCache cache; //!< The actual cache
+
+      explicit CacheShard(size_t cacheSize)
+      : cache(cacheSize)
+      {
+        // no code
+      }
+    };
+
+    typedef std::unique_ptr<CacheShard>  CacheShardRef;
+    typedef std::unique_ptr<FileScanner> FileScannerRef;
+
+    /**
+     * A range of the data file holding the requests [first,last) of a bulk request
+     */
+    struct Extent
+    {
+      FileOffset offset; //!< Offset of the first byte
+      FileOffset length; //!< Number of bytes
+      size_t     first;  //!< Index of the first request
+      size_t     last;   //!< Index after the last request
+    };
+
+    /**
+     * Returns the memory of a cache entry as estimated by the data file
+     */
+    struct ValueSizer : public ValueCache::ValueSizer
+    {
+      const DataFile& dataFile;
+
+      explicit ValueSizer(const DataFile& dataFile)
+      : dataFile(dataFile)
+      {
+        // no code
+      }
+
+      size_t GetSize(const ValueType& value) const override
+      {
+        return sizeof(ValueCacheEntry)+dataFile.GetValueMemory(*value);
+      }
+    };
+
+    /**
+     * Scoped, exclusive usage of one scanner of the scanner pool. The
+     * scanner is acquired on first usage and returned to the pool on destruction.
+     */
+    class ScannerLease CLASS_FINAL
+    {
+    private:
+      const DataFile& dataFile;
+      FileScannerRef  scanner;
+
+    public:
+      explicit ScannerLease(const DataFile& dataFile)
+      : dataFile(dataFile)
+      {
+        // no code
+      }
+
+      ~ScannerLease()
+      {
+        if (scanner) {
+          dataFile.ReleaseScanner(std::move(scanner));
+        }
+      }
+
+      /**
+       * Return the leased scanner or nullptr, if no scanner could be opened
+       */
+      FileScanner* Get()
+      {
+        if (!scanner) {
+          scanner=dataFile.AcquireScanner();
+        }
+
+        return scanner.get();
+      }
+    };
+
+  private:
+    std::string                         datafile;         //!< Basename part of the data file name
+    std::string                         datafilename;     //!< complete filename for data file
+    bool                                memoryMappedData; //!< Open scanners with mmap support
+    bool                                asyncPrefetch;    //!< Prefetch bulk requests using an AsyncFileReader
+    bool                                isOpen;           //!< true, if opened
+    FileOffset                          datafileSize;     //!< Size of the data file
+
+    std::unique_ptr<AsyncFileReader>    asyncReader;      //!< Reader used for prefetching, if asyncPrefetch is set
 
-    mutable ValueCache  cache;
+    std::vector<CacheShardRef>          cacheShards;      //!< Value cache, striped by file offset
 
-    mutable FileScanner scanner;         //!< File stream to the data file
+    mutable std::vector<FileScannerRef> idleScanners;     //!< Pool of opened file streams currently not in use
+    mutable std::mutex                  scannerMutex;     //!< Mutex to secure multi-thread access to the scanner pool
 
-    mutable std::mutex  accessMutex;     //!< Mutex to secure multi-thread access
+  protected:
+    TypeConfigRef                       typeConfig;
 
   protected:
-    TypeConfigRef       typeConfig;
+    virtual size_t GetValueMemory(const N& value) const;
 
   private:
     bool ReadData(const TypeConfig& typeConfig,
@@ -100,8 +217,47 @@ namespace osmscout {
                   FileOffset offset,
                   N& data) const;
 
+    FileScannerRef AcquireScanner() const;
+    void ReleaseScanner(FileScannerRef&& scanner) const;
+
+    inline CacheShard& GetCacheShard(FileOffset offset) const
+    {
+      return *cacheShards[offset % cacheShards.size()];
+    }
+
+    bool GetFromCache(FileOffset offset,
+                      ValueType& value) const;
+    void StoreInCache(FileOffset offset,
+                      const ValueType& value) const;
+
+    bool GetValue(FileOffset offset,
+                  ScannerLease& lease,
+                  ValueType& value) const;
+
+    bool DecodeValues(FileScanner& scanner,
+                      FileScanner* bufferScanner,
+                      const std::vector<std::pair<FileOffset,size_t>>& requests,
+                      size_t begin,
+                      size_t end,
+                      std::vector<ValueType>& data,
+                      FileOffset* bytesRead) const;
+    size_t ReadBuffer(const std::vector<Extent>& extents,
+                      size_t begin,
+                      std::vector<char>& buffer,
+                      std::vector<bool>& complete) const;
+    bool DecodeSpan(ScannerLease& lease,
+                    FileScanner* bufferScanner,
+                    const DataBlockSpan& span,
+                    std::vector<ValueType>& data) const;
+
+    bool ReadValues(std::vector<std::pair<FileOffset,size_t>>& requests,
+                    std::vector<ValueType>& data,
+                    FileOffset* bytesRead=nullptr) const;
+
   public:
-    DataFile(const std::string& datafile, size_t cacheSize);
+    DataFile(const std::string& datafile,
+             size_t cacheSize,
+             size_t cacheShardCount=1);
 
     virtual ~DataFile();
 
@@ -116,6 +272,26 @@ namespace osmscout {
       return datafilename;
     }
 
+    inline size_t GetCacheShardCount() const
+    {
+      return cacheShards.size();
+    }
+
+    void SetCachePolicy(CachePolicy policy);
+    void SetAsyncPrefetch(bool asyncPrefetch);
+
+    std::string GetMemoryConsumerName() const override;
+    size_t GetMemoryUsage() const override;
+    void GetCacheStatistics(size_t& hits,
+                            size_t& misses) const override;
+    void SetMemoryLimit(size_t bytes) override;
+
+    void GetCachedOffsets(std::vector<FileOffset>& offsets) const;
+    bool LoadIntoCache(const std::vector<FileOffset>& offsets,
+                       FileOffset& bytesRead) const;
+
+    void DumpStatistics() const;
+
     bool GetByOffset(FileOffset offset,
                      ValueType& entry) const;
 
@@ -138,133 +314,814 @@ namespace osmscout {
     template<typename IteratorIn>
     bool GetByBlockSpans(IteratorIn begin, IteratorIn end,
                          std::vector<ValueType>& data) const;
+
+    template<typename V, typename IteratorIn, typename Visitor>
+    bool VisitByOffset(IteratorIn begin, IteratorIn end,
+                       Visitor visitor) const;
   };
 
+  /**
+   * Create a new data file.
+   *
+   * @param datafile
+   *    Basename of the data file
+   * @param cacheSize
+   *    Overall number of entries cached
+   * @param cacheShardCount
+   *    Number of independently locked cache shards the cache size is
+   *    distributed over. Values bigger than 1 reduce lock contention if
+   *    many threads access the data file in parallel.
+   */
+  template <class N>
+  DataFile<N>::DataFile(const std::string& datafile,
+                        size_t cacheSize,
+                        size_t cacheShardCount)
+  : datafile(datafile),
+    memoryMappedData(false),
+    asyncPrefetch(false),
+    isOpen(false),
+    datafileSize(0)
+  {
+    if (cacheShardCount==0) {
+      cacheShardCount=1;
+    }
+
+    size_t shardCacheSize=(cacheSize+cacheShardCount-1)/cacheShardCount;
+
+    cacheShards.reserve(cacheShardCount);
+
+    for (size_t i=0; i<cacheShardCount; i++) {
+      cacheShards.push_back(CacheShardRef(new CacheShard(shardCacheSize)));
+    }
+  }
+
+  template <class N>
+  DataFile<N>::~DataFile()
+  {
+    if (IsOpen()) {
+      Close();
+    }
+  }
+
+  /**
+   * Read one data value from the given file offset.
+   *
+   * Method is NOT thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::ReadData(const TypeConfig& typeConfig,
+                             FileScanner& scanner,
+                             FileOffset offset,
+                             N& data) const
+  {
+    try {
+      scanner.SetPos(offset);
+
+      data.Read(typeConfig,
+                scanner);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Read one data value from the current position of the stream
+   *
+   * Method is NOT thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::ReadData(const TypeConfig& typeConfig,
+                             FileScanner& scanner,
+                             N& data) const
+  {
+    try {
+      data.Read(typeConfig,
+                scanner);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Take an idle scanner from the pool or open a new one, if all
+   * scanners are currently in use. Returns nullptr on error.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  typename DataFile<N>::FileScannerRef DataFile<N>::AcquireScanner() const
+  {
+    {
+      std::lock_guard<std::mutex> lock(scannerMutex);
+
+      if (!idleScanners.empty()) {
+        FileScannerRef scanner=std::move(idleScanners.back());
+
+        idleScanners.pop_back();
+
+        return scanner;
+      }
+    }
+
+    FileScannerRef scanner(new FileScanner());
+
+    try {
+      scanner->Open(datafilename,
+                    FileScanner::LowMemRandom,
+                    memoryMappedData);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner->CloseFailsafe();
+      return nullptr;
+    }
+
+    return scanner;
+  }
+
+  /**
+   * Return a scanner to the pool.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  void DataFile<N>::ReleaseScanner(FileScannerRef&& scanner) const
+  {
+    std::lock_guard<std::mutex> lock(scannerMutex);
+
+    idleScanners.push_back(std::move(scanner));
+  }
+
+  /**
+   * Lookup the value for the given offset in the cache.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::GetFromCache(FileOffset offset,
+                                 ValueType& value) const
+  {
+    CacheShard&                 shard=GetCacheShard(offset);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ValueCacheRef               entryRef;
+
+    if (shard.cache.GetEntry(offset,entryRef)) {
+      value=entryRef->value;
+
+      return true;
+    }
+
+    return false;
+  }
+
+  /**
+   * Store the value for the given offset in the cache.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  void DataFile<N>::StoreInCache(FileOffset offset,
+                                 const ValueType& value) const
+  {
+    CacheShard&                 shard=GetCacheShard(offset);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    shard.cache.SetEntry(ValueCacheEntry(offset,value));
+  }
+
+  /**
+   * Return the value at the given offset either from the cache or
+   * by reading it using the leased scanner.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::GetValue(FileOffset offset,
+                             ScannerLease& lease,
+                             ValueType& value) const
+  {
+    if (GetFromCache(offset,value)) {
+      return true;
+    }
+
+    FileScanner* scanner=lease.Get();
+
+    if (scanner==nullptr) {
+      return false;
+    }
+
+    value=std::make_shared<N>();
+
+    if (!ReadData(*typeConfig,
+                  *scanner,
+                  offset,
+                  *value)) {
+      log.Error() << "Error while reading data from offset " << offset << " of file " << datafilename << "!";
+      return false;
+    }
+
+    StoreInCache(offset,value);
+
+    return true;
+  }
+
+  /**
+   * Decode the values for the requests [begin,end) (sorted by file offset) and store
+   * them at the requested index.
+   *
+   * If bufferScanner is given, values are decoded from it (see ReadExtents()). A value
+   * reaching beyond the end of the buffer and all following values are decoded using
+   * the file scanner.
+   *
+   * If bytesRead is given, the number of bytes of the decoded values is added to it.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::DecodeValues(FileScanner& scanner,
+                                 FileScanner* bufferScanner,
+                                 const std::vector<std::pair<FileOffset,size_t>>& requests,
+                                 size_t begin,
+                                 size_t end,
+                                 std::vector<ValueType>& data,
+                                 FileOffset* bytesRead) const
+  {
+    ValueType value;
+
+    for (size_t i=begin; i<end; i++) {
+      FileOffset offset=requests[i].first;
+
+      if (i>begin &&
+          offset==requests[i-1].first) {
+        data[requests[i].second]=value;
+        continue;
+      }
+
+      value=std::make_shared<N>();
+
+      if (bufferScanner!=nullptr) {
+        try {
+          bufferScanner->SetPos(offset);
+
+          value->Read(*typeConfig,
+                      *bufferScanner);
+
+          if (bytesRead!=nullptr) {
+            *bytesRead+=bufferScanner->GetPos()-offset;
+          }
+
+          StoreInCache(offset,value);
+
+          data[requests[i].second]=value;
+
+          continue;
+        }
+        catch (IOException& /*e*/) {
+          // The buffer ends within the value, not an error
+          bufferScanner=nullptr;
+          value=std::make_shared<N>();
+        }
+      }
+
+      try {
+        // Avoid seeking (and dropping read buffers), if we are already at the right position
+        if (scanner.GetPos()!=offset) {
+          scanner.SetPos(offset);
+        }
+
+        value->Read(*typeConfig,
+                    scanner);
+      }
+      catch (IOException& e) {
+        log.Error() << e.GetDescription();
+        log.Error() << "Error while reading data from offset " << offset << " of file " << datafilename << "!";
+        return false;
+      }
+
+      if (bytesRead!=nullptr) {
+        *bytesRead+=scanner.GetPos()-offset;
+      }
+
+      StoreInCache(offset,value);
+
+      data[requests[i].second]=value;
+    }
+
+    return true;
+  }
+
+  /**
+   * Read the extents starting at index begin into one buffer (one extent after the
+   * other) using the AsyncFileReader with many reads in flight. To limit the size of
+   * the buffer only a group of extents is read. For each read extent complete is set,
+   * if it could be read completely.
+   *
+   * Returns the index of the first extent not read.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  size_t DataFile<N>::ReadBuffer(const std::vector<Extent>& extents,
+                                 size_t begin,
+                                 std::vector<char>& buffer,
+                                 std::vector<bool>& complete) const
+  {
+    // Extents are split into chunks of this size
+    const FileOffset chunkSize=64*1024;
+    // Maximum size of the buffer
+    const FileOffset maxBufferSize=4*1024*1024;
+
+    size_t     end=begin;
+    FileOffset bufferSize=0;
+
+    while (end<extents.size() &&
+           (end==begin || bufferSize+extents[end].length<=maxBufferSize)) {
+      bufferSize+=extents[end].length;
+      end++;
+    }
+
+    std::vector<AsyncFileReader::ReadRequest> chunks;
+    std::vector<size_t>                       chunkExtent;
+    FileOffset                                bufferOffset=0;
+
+    buffer.resize((size_t)bufferSize);
+
+    for (size_t e=begin; e<end; e++) {
+      for (FileOffset offset=0; offset<extents[e].length; offset+=chunkSize) {
+        chunks.push_back(AsyncFileReader::ReadRequest{extents[e].offset+offset,
+                                                      (size_t)std::min(chunkSize,extents[e].length-offset),
+                                                      buffer.data()+bufferOffset+offset,
+                                                      false});
+        chunkExtent.push_back(e-begin);
+      }
+
+      bufferOffset+=extents[e].length;
+    }
+
+    complete.assign(end-begin,true);
+
+    for (size_t e=begin; e<end; e++) {
+      complete[e-begin]=extents[e].length>0;
+    }
+
+    // Errors are reported by the reader, affected extents are read using a file scanner
+    asyncReader->Read(chunks);
+
+    for (size_t c=0; c<chunks.size(); c++) {
+      if (!chunks[c].success) {
+        complete[chunkExtent[c]]=false;
+      }
+    }
+
+    return end;
+  }
+
+  /**
+   * Read the values for the given list of (file offset, index into data) requests
+   * and store them at the requested index.
+   *
+   * Requests are sorted by file offset and decoded in file order. Neighbouring requests
+   * are coalesced into extents, so that random I/O is reduced and the storage can process
+   * many reads at once: Extents are either prefetched by advising the kernel or read
+   * using the AsyncFileReader, in which case the values are decoded from the read buffers.
+   * Requests for the same offset are only read once.
+   *
+   * If bytesRead is given, the number of bytes of the decoded values is added to it.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::ReadValues(std::vector<std::pair<FileOffset,size_t>>& requests,
+                               std::vector<ValueType>& data,
+                               FileOffset* bytesRead) const
+  {
+    // Requests closer than this are coalesced into one extent
+    const FileOffset maxExtentGap=64*1024;
+    // Maximum size of an extent, before a new one is started
+    const FileOffset maxExtentSize=1024*1024;
+    // Estimated size of the last object of an extent, since we do not know its actual size
+    const FileOffset objectSizeEstimate=4*1024;
+
+    ScannerLease lease(*this);
+    FileScanner* scanner=lease.Get();
+
+    if (scanner==nullptr) {
+      return false;
+    }
+
+    std::sort(requests.begin(),
+              requests.end());
+
+    if (requests.size()<=1) {
+      return DecodeValues(*scanner,
+                          nullptr,
+                          requests,
+                          0,
+                          requests.size(),
+                          data,
+                          bytesRead);
+    }
+
+    std::vector<Extent> extents;
+    Extent              extent{requests.front().first,0,0,0};
+    FileOffset          extentEnd=extent.offset;
+
+    for (size_t i=0; i<requests.size(); i++) {
+      FileOffset offset=requests[i].first;
+
+      if (offset-extentEnd>maxExtentGap ||
+          (offset!=extentEnd && offset-extent.offset>=maxExtentSize)) {
+        extent.length=extentEnd-extent.offset+objectSizeEstimate;
+        extent.last=i;
+        extents.push_back(extent);
+
+        extent.offset=offset;
+        extent.first=i;
+      }
+
+      extentEnd=offset;
+    }
+
+    extent.length=extentEnd-extent.offset+objectSizeEstimate;
+    extent.last=requests.size();
+    extents.push_back(extent);
+
+    if (asyncReader) {
+      std::vector<char> buffer;
+      std::vector<bool> complete;
+      size_t            groupStart=0;
+
+      for (auto& e : extents) {
+        e.length=e.offset<datafileSize ? std::min(e.length,datafileSize-e.offset) : 0;
+      }
+
+      while (groupStart<extents.size()) {
+        size_t     groupEnd=ReadBuffer(extents,
+                                       groupStart,
+                                       buffer,
+                                       complete);
+        FileOffset bufferOffset=0;
+
+        for (size_t e=groupStart; e<groupEnd; e++) {
+          FileScanner bufferScanner;
+          FileScanner *decodeScanner=nullptr;
+
+          if (complete[e-groupStart]) {
+            try {
+              bufferScanner.Open(datafilename,
+                                 buffer.data()+bufferOffset,
+                                 extents[e].offset,
+                                 (size_t)extents[e].length);
+              decodeScanner=&bufferScanner;
+            }
+            catch (IOException& ex) {
+              log.Warn() << ex.GetDescription();
+            }
+          }
+
+          bool success=DecodeValues(*scanner,
+                                    decodeScanner,
+                                    requests,
+                                    extents[e].first,
+                                    extents[e].last,
+                                    data,
+                                    bytesRead);
+
+          bufferScanner.CloseFailsafe();
+
+          if (!success) {
+            return false;
+          }
+
+          bufferOffset+=extents[e].length;
+        }
+
+        groupStart=groupEnd;
+      }
+
+      return true;
+    }
+
+    for (const auto& e : extents) {
+      scanner->Prefetch(e.offset,
+                        e.length);
+    }
+
+    return DecodeValues(*scanner,
+                        nullptr,
+                        requests,
+                        0,
+                        requests.size(),
+                        data,
+                        bytesRead);
+  }
+
+  /**
+   * Open the index file.
+   *
+   * Method is NOT thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::Open(const TypeConfigRef& typeConfig,
+                         const std::string& path,
+                         bool memoryMappedData)
+  {
+    this->typeConfig=typeConfig;
+    this->memoryMappedData=memoryMappedData;
+
+    datafilename=AppendFileToDir(path,datafile);
+
+    // Open the first scanner to make sure the file is accessible
+    FileScannerRef scanner=AcquireScanner();
+
+    if (!scanner) {
+      return false;
+    }
+
+    ReleaseScanner(std::move(scanner));
+
+    if (asyncPrefetch) {
+      try {
+        datafileSize=GetFileSize(datafilename);
+
+        asyncReader.reset(new AsyncFileReader());
+        asyncReader->Open(datafilename);
+      }
+      catch (IOException& e) {
+        // Not fatal, we fall back to advisory prefetching
+        log.Warn() << e.GetDescription();
+        asyncReader.reset();
+      }
+    }
+
+    isOpen=true;
+
+    return true;
+  }
+
+  /**
+   * Return true, if index is currently opened.
+   *
+   * Method is NOT thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::IsOpen() const
+  {
+    return isOpen;
+  }
+
+  /**
+   * Close the index.
+   *
+   * Method is NOT thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::Close()
+  {
+    bool result=true;
+
+    typeConfig=nullptr;
+
+    asyncReader.reset();
+
+    std::lock_guard<std::mutex> lock(scannerMutex);
+
+    for (auto& scanner : idleScanners) {
+      try  {
+        if (scanner->IsOpen()) {
+          scanner->Close();
+        }
+      }
+      catch (IOException& e) {
+        log.Error() << e.GetDescription();
+        scanner->CloseFailsafe();
+        result=false;
+      }
+    }
+
+    idleScanners.clear();
+
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> shardLock(shard->mutex);
+
+      shard->cache.Flush();
+    }
+
+    isOpen=false;
+
+    return result;
+  }
+
+  /**
+   * Change the eviction policy of the value cache.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  void DataFile<N>::SetCachePolicy(CachePolicy policy)
+  {
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+
+      shard->cache.SetPolicy(policy);
+    }
+  }
+
+  /**
+   * If set, bulk requests (see GetByOffset()) are read ahead using an AsyncFileReader
+   * with many reads in flight, instead of only advising the kernel to prefetch
+   * the data. This helps on storage where advisory prefetching has no effect
+   * (network or FUSE file systems) or where the kernel does not read ahead with
+   * a sufficient queue depth.
+   *
+   * Must be called before Open().
+   */
   template <class N>
-  DataFile<N>::DataFile(const std::string& datafile, size_t cacheSize)
-  : datafile(datafile),cache(cacheSize)
+  void DataFile<N>::SetAsyncPrefetch(bool asyncPrefetch)
   {
-    // no code
+    this->asyncPrefetch=asyncPrefetch;
   }
 
+  /**
+   * Return the estimated memory of the given value (including the
+   * object itself), used if the cache is limited by a MemoryBudget.
+   * The default implementation returns the size of the object.
+   */
   template <class N>
-  DataFile<N>::~DataFile()
+  size_t DataFile<N>::GetValueMemory(const N& /*value*/) const
   {
-    if (IsOpen()) {
-      Close();
-    }
+    return sizeof(N);
+  }
+
+  template <class N>
+  std::string DataFile<N>::GetMemoryConsumerName() const
+  {
+    return datafile;
   }
 
   /**
-   * Read one data value from the given file offset.
+   * Return the memory of the cached values. Only available, if the cache
+   * is limited by memory using SetMemoryLimit(), else 0 is returned.
    *
-   * Method is NOT thread-safe.
+   * Method is thread-safe.
    */
   template <class N>
-  bool DataFile<N>::ReadData(const TypeConfig& typeConfig,
-                             FileScanner& scanner,
-                             FileOffset offset,
-                             N& data) const
+  size_t DataFile<N>::GetMemoryUsage() const
   {
-    try {
-      scanner.SetPos(offset);
+    size_t memory=0;
 
-      data.Read(typeConfig,
-                scanner);
-    }
-    catch (IOException& e) {
-      log.Error() << e.GetDescription();
-      return false;
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+
+      memory+=shard->cache.GetCurrentMemory();
     }
 
-    return true;
+    return memory;
   }
 
   /**
-   * Read one data value from the current position of the stream
+   * Return the accumulated hits and misses of the value cache.
    *
-   * Method is NOT thread-safe.
+   * Method is thread-safe.
    */
   template <class N>
-  bool DataFile<N>::ReadData(const TypeConfig& typeConfig,
-                             FileScanner& scanner,
-                             N& data) const
+  void DataFile<N>::GetCacheStatistics(size_t& hits,
+                                       size_t& misses) const
   {
-    try {
-      data.Read(typeConfig,
-                scanner);
-    }
-    catch (IOException& e) {
-      log.Error() << e.GetDescription();
-      return false;
-    }
+    hits=0;
+    misses=0;
 
-    return true;
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+
+      hits+=shard->cache.GetHits();
+      misses+=shard->cache.GetMisses();
+    }
   }
 
   /**
-   * Open the index file.
+   * Limit the value cache to the given number of bytes (evenly distributed
+   * over all cache shards) instead of a number of entries.
    *
-   * Method is NOT thread-safe.
+   * Method is thread-safe.
    */
   template <class N>
-  bool DataFile<N>::Open(const TypeConfigRef& typeConfig,
-                         const std::string& path,
-                         bool memoryMappedData)
+  void DataFile<N>::SetMemoryLimit(size_t bytes)
   {
-    this->typeConfig=typeConfig;
+    auto   sizer=std::make_shared<ValueSizer>(*this);
+    size_t shardBytes=bytes/cacheShards.size();
+    // Every entry needs at least this amount of memory
+    size_t shardEntries=std::max(shardBytes/(sizeof(ValueCacheEntry)+sizeof(N)),(size_t)1);
 
-    datafilename=AppendFileToDir(path,datafile);
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
 
-    try {
-      scanner.Open(datafilename,
-                   FileScanner::LowMemRandom,
-                   memoryMappedData);
-    }
-    catch (IOException& e) {
-      log.Error() << e.GetDescription();
-      scanner.CloseFailsafe();
-      return false;
+      shard->cache.SetMaxSize(shardEntries);
+      shard->cache.SetMaxMemory(std::max(shardBytes,(size_t)1),
+                                sizer);
     }
-
-    return true;
   }
 
   /**
-   * Return true, if index is currently opened.
+   * Append the file offsets of all cached values to the given vector, the most
+   * valuable entries first. The entries of the cache shards are interleaved, so
+   * that every prefix of the result contains the most valuable entries of all shards.
    *
-   * Method is NOT thread-safe.
+   * Method is thread-safe.
    */
   template <class N>
-  bool DataFile<N>::IsOpen() const
+  void DataFile<N>::GetCachedOffsets(std::vector<FileOffset>& offsets) const
   {
-    return scanner.IsOpen();
+    std::vector<std::vector<FileOffset>> shardOffsets(cacheShards.size());
+    size_t                               maxCount=0;
+
+    for (size_t s=0; s<cacheShards.size(); s++) {
+      std::lock_guard<std::mutex> lock(cacheShards[s]->mutex);
+
+      cacheShards[s]->cache.GetKeys(shardOffsets[s]);
+      maxCount=std::max(maxCount,shardOffsets[s].size());
+    }
+
+    for (size_t i=0; i<maxCount; i++) {
+      for (const auto& shard : shardOffsets) {
+        if (i<shard.size()) {
+          offsets.push_back(shard[i]);
+        }
+      }
+    }
   }
 
   /**
-   * Close the index.
+   * Load the values at the given file offsets into the cache. The values are
+   * read in file order, but inserted in reverse order of the given offsets, so
+   * that (within each cache shard) the first offset ends up as the most valuable entry.
+   * Passing the result of GetCachedOffsets() thus restores the order of the cache.
    *
-   * Method is NOT thread-safe.
+   * The number of bytes of the read values is added to bytesRead.
+   *
+   * Method is thread-safe.
    */
   template <class N>
-  bool DataFile<N>::Close()
+  bool DataFile<N>::LoadIntoCache(const std::vector<FileOffset>& offsets,
+                                  FileOffset& bytesRead) const
   {
-    typeConfig=nullptr;
+    std::vector<std::pair<FileOffset,size_t>> requests;
+    std::vector<ValueType>                    data(offsets.size());
 
-    try  {
-      if (scanner.IsOpen()) {
-        scanner.Close();
-      }
+    requests.reserve(offsets.size());
+
+    for (size_t i=0; i<offsets.size(); i++) {
+      requests.push_back(std::make_pair(offsets[i],i));
     }
-    catch (IOException& e) {
-      log.Error() << e.GetDescription();
-      scanner.CloseFailsafe();
+
+    if (!ReadValues(requests,
+                    data,
+                    &bytesRead)) {
       return false;
     }
 
+    // ReadValues() filled the cache in file order
+    for (size_t i=offsets.size(); i>0; i--) {
+      StoreInCache(offsets[i-1],
+                   data[i-1]);
+    }
+
     return true;
   }
 
+  /**
+   * Log size and hit, miss and eviction counters of the value cache.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  void DataFile<N>::DumpStatistics() const
+  {
+    size_t entries=0;
+    size_t hits=0;
+    size_t misses=0;
+    size_t evictions=0;
+
+    for (auto& shard : cacheShards) {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+
+      entries+=shard->cache.GetSize();
+      hits+=shard->cache.GetHits();
+      misses+=shard->cache.GetMisses();
+      evictions+=shard->cache.GetEvictions();
+    }
+
+    log.Info() << "DataFile " << datafile << ": " << entries << " entries, hits " << hits << ", misses " << misses << ", evictions " << evictions;
+  }
+
   /**
    * Reads data for the given file offsets. File offsets are passed by iterator over
    * some container. the size parameter hints as the number of entries returned by the iterators
@@ -298,29 +1155,31 @@ namespace osmscout {
       return true;
     }
 
+    size_t                                    initialSize=data.size();
+    std::vector<std::pair<FileOffset,size_t>> requests;
+
     data.reserve(data.size()+size);
-    std::lock_guard<std::mutex> lock(accessMutex);
 
+    // Resolve cache hits directly and reserve a slot for each miss
     for (IteratorIn offsetIter=begin; offsetIter!=end; ++offsetIter) {
-      ValueCacheRef entryRef;
+      ValueType value;
 
-      if (cache.GetEntry(*offsetIter,entryRef)) {
-        data.push_back(entryRef->value);
+      if (!GetFromCache(*offsetIter,value)) {
+        requests.push_back(std::make_pair(*offsetIter,data.size()));
       }
-      else {
-        ValueType value=std::make_shared<N>();
 
-        if (!ReadData(*typeConfig,
-                      scanner,
-                      *offsetIter,
-                      *value)) {
-          log.Error() << "Error while reading data from offset " << *offsetIter << " of file " << datafilename << "!";
-          return false;
-        }
+      data.push_back(value);
+    }
 
-        cache.SetEntry(ValueCacheEntry(*offsetIter,value));
-        data.push_back(value);
-      }
+    if (requests.empty()) {
+      return true;
+    }
+
+    if (!ReadValues(requests,
+                    data)) {
+      data.resize(initialSize);
+
+      return false;
     }
 
     return true;
@@ -342,32 +1201,21 @@ namespace osmscout {
       return true;
     }
 
-    data.reserve(data.size()+size);
-    std::lock_guard<std::mutex> lock(accessMutex);
+    std::vector<ValueType> values;
 
-    for (IteratorIn offsetIter=begin; offsetIter!=end; ++offsetIter) {
-      ValueType value=std::make_shared<N>();
-
-      ValueCacheRef entryRef;
-      if (cache.GetEntry(*offsetIter,entryRef)){
-        value=entryRef->value;
-      }else{
-        if (!ReadData(*typeConfig,
-                      scanner,
-                      *offsetIter,
-                      *value)) {
-          log.Error() << "Error while reading data from offset " << *offsetIter << " of file " << datafilename << "!";
-          return false;
-        }
+    if (!GetByOffset(begin,
+                     end,
+                     size,
+                     values)) {
+      return false;
+    }
 
-        cache.SetEntry(ValueCacheEntry(*offsetIter,value));
-      }
+    data.reserve(data.size()+values.size());
 
-      if (!value->Intersects(boundingBox)) {
-        continue;
+    for (auto& value : values) {
+      if (value->Intersects(boundingBox)) {
+        data.push_back(std::move(value));
       }
-
-      data.push_back(value);
     }
 
     return true;
@@ -413,28 +1261,12 @@ namespace osmscout {
   bool DataFile<N>::GetByOffset(FileOffset offset,
                                 ValueType& entry) const
   {
-    std::lock_guard<std::mutex> lock(accessMutex);
-
-    ValueCacheRef entryRef;
-    if (cache.GetEntry(offset,entryRef)){
-      entry=entryRef->value;
-    }else{
-      ValueType value=std::make_shared<N>();
-
-      if (!ReadData(*typeConfig,
-                    scanner,
-                    offset,
-                    *value)) {
-        log.Error() << "Error while reading data from offset " << offset << " of file " << datafilename << "!";
-        // TODO: Remove broken entry from cache
-        return false;
-      }
-
-      cache.SetEntry(ValueCacheEntry(offset,value));
-      entry=value;
-    }
+    ScannerLease lease(*this);
 
-    return true;
+    // TODO: Remove broken entry from cache
+    return GetValue(offset,
+                    lease,
+                    entry);
   }
 
   /**
@@ -446,56 +1278,102 @@ namespace osmscout {
   bool DataFile<N>::GetByBlockSpan(const DataBlockSpan& span,
                                    std::vector<ValueType>& data) const
   {
-    if (span.count==0) {
-      return true;
-    }
+    std::array<DataBlockSpan,1> spans={{span}};
 
-    std::lock_guard<std::mutex> lock(accessMutex);
+    return GetByBlockSpans(spans.begin(),
+                           spans.end(),
+                           data);
+  }
 
-    try {
-      bool offsetSetup=false;
-      FileOffset offset=span.startOffset;
-
-      data.reserve(data.size()+span.count);
-
-      for (uint32_t i=1; i<=span.count; i++) {
-        ValueCacheRef entryRef;
-        if (cache.GetEntry(offset,entryRef)){
-          data.push_back(entryRef->value);
-          offset=entryRef->value->GetNextFileOffset();
-          offsetSetup=false;
-        }else{
-          if (!offsetSetup){
-            scanner.SetPos(offset);
-          }
+  /**
+   * Read the values of the given span, using the cache and either the buffer scanner
+   * (see ReadBuffer()) or the file scanner of the lease. If a value reaches beyond the end
+   * of the buffer, it and all following values are read using the file scanner.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  bool DataFile<N>::DecodeSpan(ScannerLease& lease,
+                               FileScanner* bufferScanner,
+                               const DataBlockSpan& span,
+                               std::vector<ValueType>& data) const
+  {
+    bool       offsetSetup=false;
+    FileOffset offset=span.startOffset;
 
-          ValueType value=std::make_shared<N>();
+    for (uint32_t i=1; i<=span.count; i++) {
+      ValueType value;
 
-          if (!ReadData(*typeConfig,
-                        scanner,
-                        *value)) {
-            log.Error() << "Error while reading data #" << i << " starting from offset " << span.startOffset << " of file " << datafilename << "!";
-            return false;
-          }
+      if (GetFromCache(offset,value)) {
+        data.push_back(value);
+        offset=value->GetNextFileOffset();
+        offsetSetup=false;
+        continue;
+      }
+
+      if (bufferScanner!=nullptr) {
+        try {
+          value=std::make_shared<N>();
+
+          bufferScanner->SetPos(offset);
+
+          value->Read(*typeConfig,
+                      *bufferScanner);
 
-          cache.SetEntry(ValueCacheEntry(offset,value));
+          StoreInCache(offset,value);
           offset=value->GetNextFileOffset();
-          offsetSetup=true;
           data.push_back(value);
+
+          continue;
+        }
+        catch (IOException& /*e*/) {
+          // The buffer ends within the value, not an error
+          bufferScanner=nullptr;
         }
       }
 
-      return true;
-    }
-    catch (IOException& e) {
-      log.Error() << e.GetDescription();
-      return false;
+      FileScanner* scanner=lease.Get();
+
+      if (scanner==nullptr) {
+        return false;
+      }
+
+      try {
+        if (!offsetSetup) {
+          scanner->SetPos(offset);
+        }
+      }
+      catch (IOException& e) {
+        log.Error() << e.GetDescription();
+        return false;
+      }
+
+      value=std::make_shared<N>();
+
+      if (!ReadData(*typeConfig,
+                    *scanner,
+                    *value)) {
+        log.Error() << "Error while reading data #" << i << " starting from offset " << span.startOffset <<
+        " of file " << datafilename << "!";
+        return false;
+      }
+
+      StoreInCache(offset,value);
+      offset=value->GetNextFileOffset();
+      offsetSetup=true;
+      data.push_back(value);
     }
+
+    return true;
   }
 
   /**
    * Read data values from the given DataBlockSpans.
    *
+   * If more than one span is given, the spans are prefetched in advance. If enabled
+   * using SetAsyncPrefetch(), the spans are instead read using the AsyncFileReader
+   * and the values are decoded from the read buffers.
+   *
    * Method is thread-safe.
    */
   template <class N>
@@ -503,58 +1381,158 @@ namespace osmscout {
   bool DataFile<N>::GetByBlockSpans(IteratorIn begin, IteratorIn end,
                                     std::vector<ValueType>& data) const
   {
-    uint32_t overallCount=0;
+    // Estimated size of one object, since spans only give the number of objects
+    const FileOffset objectSizeEstimate=512;
+    // Maximum number of bytes read ahead for one span
+    const FileOffset maxExtentSize=1024*1024;
+
+    uint32_t                   overallCount=0;
+    std::vector<DataBlockSpan> spans;
+    std::vector<Extent>        extents;
 
     for (IteratorIn spanIter=begin; spanIter!=end; ++spanIter) {
       overallCount+=spanIter->count;
+
+      if (spanIter->count>0) {
+        spans.push_back(*spanIter);
+        extents.push_back(Extent{spanIter->startOffset,
+                                 spanIter->count*objectSizeEstimate,
+                                 0,
+                                 0});
+      }
+    }
+
+    if (overallCount==0) {
+      return true;
     }
 
     data.reserve(data.size()+overallCount);
 
-    try {
-      std::lock_guard<std::mutex> lock(accessMutex);
-      for (IteratorIn spanIter=begin; spanIter!=end; ++spanIter) {
-        if (spanIter->count==0) {
-          continue;
+    ScannerLease lease(*this);
+
+    if (!asyncReader) {
+      if (extents.size()>1) {
+        FileScanner* scanner=lease.Get();
+
+        if (scanner==nullptr) {
+          return false;
         }
 
-        bool offsetSetup=false;
-        FileOffset offset=spanIter->startOffset;
-
-        for (uint32_t i=1; i<=spanIter->count; i++) {
-          ValueCacheRef entryRef;
-          if (cache.GetEntry(offset,entryRef)){
-            data.push_back(entryRef->value);
-            offset=entryRef->value->GetNextFileOffset();
-            offsetSetup=false;
-          }else{
-            if (!offsetSetup){
-              scanner.SetPos(offset);
-            }
+        for (const auto& extent : extents) {
+          scanner->Prefetch(extent.offset,
+                            extent.length);
+        }
+      }
+
+      for (const auto& span : spans) {
+        if (!DecodeSpan(lease,
+                        nullptr,
+                        span,
+                        data)) {
+          return false;
+        }
+      }
 
-            ValueType value=std::make_shared<N>();
+      return true;
+    }
 
-            if (!ReadData(*typeConfig,
-                          scanner,
-                          *value)) {
-              log.Error() << "Error while reading data #" << i << " starting from offset " << spanIter->startOffset <<
-              " of file " << datafilename << "!";
-              return false;
-            }
+    std::vector<char> buffer;
+    std::vector<bool> complete;
+    size_t            groupStart=0;
 
-            cache.SetEntry(ValueCacheEntry(offset,value));
-            offset=value->GetNextFileOffset();
-            offsetSetup=true;
-            data.push_back(value);
+    for (auto& extent : extents) {
+      extent.length=extent.offset<datafileSize ? std::min(std::min(extent.length,maxExtentSize),datafileSize-extent.offset) : 0;
+    }
+
+    while (groupStart<extents.size()) {
+      size_t     groupEnd=ReadBuffer(extents,
+                                     groupStart,
+                                     buffer,
+                                     complete);
+      FileOffset bufferOffset=0;
+
+      for (size_t s=groupStart; s<groupEnd; s++) {
+        FileScanner bufferScanner;
+        FileScanner *decodeScanner=nullptr;
+
+        if (complete[s-groupStart]) {
+          try {
+            bufferScanner.Open(datafilename,
+                               buffer.data()+bufferOffset,
+                               extents[s].offset,
+                               (size_t)extents[s].length);
+            decodeScanner=&bufferScanner;
           }
+          catch (IOException& e) {
+            log.Warn() << e.GetDescription();
+          }
+        }
+
+        bool success=DecodeSpan(lease,
+                                decodeScanner,
+                                spans[s],
+                                data);
+
+        bufferScanner.CloseFailsafe();
+
+        if (!success) {
+          return false;
         }
+
+        bufferOffset+=extents[s].length;
       }
+
+      groupStart=groupEnd;
     }
-    catch (IOException& e) {
-      log.Error() << e.GetDescription();
+
+    return true;
+  }
+
+  /**
+   * Read the objects at the given file offsets into a view of type V (like WayView)
+   * and pass the view to the visitor, one after the other.
+   *
+   * In contrast to GetByOffset() no objects are allocated and the cache is neither
+   * queried nor filled. If the file is memory mapped, the view directly references
+   * the mapped data. The view passed to the visitor is only valid during the call
+   * and gets reused for the next object.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  template<typename V, typename IteratorIn, typename Visitor>
+  bool DataFile<N>::VisitByOffset(IteratorIn begin, IteratorIn end,
+                                  Visitor visitor) const
+  {
+    if (begin==end) {
+      return true;
+    }
+
+    ScannerLease lease(*this);
+    FileScanner* scanner=lease.Get();
+
+    if (scanner==nullptr) {
       return false;
     }
 
+    V view;
+
+    for (IteratorIn offsetIter=begin; offsetIter!=end; ++offsetIter) {
+      try {
+        scanner->SetPos(*offsetIter);
+
+        view.Read(*typeConfig,
+                  *scanner);
+      }
+      catch (IOException& e) {
+        log.Error() << e.GetDescription();
+        log.Error() << "Error while reading data from offset " << *offsetIter << " of file " << datafilename << "!";
+        return false;
+      }
+
+      visitor(view);
+    }
+
     return true;
   }
 
@@ -592,6 +1570,19 @@ namespace osmscout {
 
     bool IsOpen() const;
 
+    void SetIndexCachePolicy(CachePolicy policy);
+    void SetIndexMemoryLimit(size_t bytes);
+    void SetSharedIndexCache(const SharedMemoryCacheRef& cache);
+
+    /**
+     * Return the index as consumer, so that its page cache can be registered at
+     * a MemoryBudget (the data file itself is registered separately)
+     */
+    inline MemoryBudget::Consumer& GetIndexMemoryConsumer()
+    {
+      return index;
+    }
+
     bool GetOffset(I id,
                    FileOffset& offset) const;
 
@@ -664,6 +1655,32 @@ namespace osmscout {
            index.IsOpen();
   }
 
+  template <class I, class N>
+  void IndexedDataFile<I,N>::SetIndexCachePolicy(CachePolicy policy)
+  {
+    index.SetCachePolicy(policy);
+  }
+
+  /**
+   * Limit the page cache of the index to the given number of bytes, see
+   * NumericIndex::SetMemoryLimit().
+   */
+  template <class I, class N>
+  void IndexedDataFile<I,N>::SetIndexMemoryLimit(size_t bytes)
+  {
+    index.SetMemoryLimit(bytes);
+  }
+
+  /**
+   * Set a cache shared with other processes for the index pages, see
+   * NumericIndex::SetSharedCache(). Must be called before Open().
+   */
+  template <class I, class N>
+  void IndexedDataFile<I,N>::SetSharedIndexCache(const SharedMemoryCacheRef& cache)
+  {
+    index.SetSharedCache(cache);
+  }
+
   template <class I, class N>
   template<typename IteratorIn>
   bool IndexedDataFile<I,N>::GetOffsets(IteratorIn begin, IteratorIn end, size_t size,
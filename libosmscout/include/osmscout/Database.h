@@ -20,10 +20,13 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <atomic>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -54,6 +57,8 @@
 #include <osmscout/routing/Route.h>
 
 #include <osmscout/util/GeoBox.h>
+#include <osmscout/util/MemoryBudget.h>
+#include <osmscout/util/SharedMemoryCache.h>
 
 #include <osmscout/system/Compiler.h>
 
@@ -72,6 +77,11 @@ namespace osmscout {
 
     The following attributes are currently available:
     * cache sizes.
+    * number of cache shards of the data files (for concurrent access).
+    * cache eviction policy of the data files.
+    * an optional overall memory budget (in bytes) for the data and index caches.
+    * an optional cache snapshot file for warm starts.
+    * an optional shared memory cache for index pages, shared by all processes on the host.
     */
   class OSMSCOUT_API DatabaseParameter CLASS_FINAL
   {
@@ -82,6 +92,18 @@ namespace osmscout {
     unsigned long wayDataCacheSize;
     unsigned long areaDataCacheSize;
 
+    unsigned long dataCacheShardCount;
+    CachePolicy   dataCachePolicy;
+    bool          dataAsyncPrefetch;
+
+    size_t        cacheMemoryBudget;
+
+    std::string   cacheSnapshotFile;
+    size_t        cacheWarmupLimit;
+
+    std::string   sharedCacheName;
+    size_t        sharedCacheSize;
+
     bool routerDataMMap;
     bool nodesDataMMap;
     bool areasDataMMap;
@@ -96,6 +118,18 @@ namespace osmscout {
     void SetWayDataCacheSize(unsigned long  size);
     void SetAreaDataCacheSize(unsigned long  size);
 
+    void SetDataCacheShardCount(unsigned long count);
+    void SetDataCachePolicy(CachePolicy policy);
+    void SetDataAsyncPrefetch(bool asyncPrefetch);
+
+    void SetCacheMemoryBudget(size_t bytes);
+
+    void SetCacheSnapshotFile(const std::string& filename);
+    void SetCacheWarmupLimit(size_t limit);
+
+    void SetSharedCacheName(const std::string& name);
+    void SetSharedCacheSize(size_t bytes);
+
     void SetRouterDataMMap(bool mmap);
     void SetNodesDataMMap(bool mmap);
     void SetAreasDataMMap(bool mmap);
@@ -108,6 +142,18 @@ namespace osmscout {
     unsigned long GetWayDataCacheSize() const;
     unsigned long GetAreaDataCacheSize() const;
 
+    unsigned long GetDataCacheShardCount() const;
+    CachePolicy GetDataCachePolicy() const;
+    bool GetDataAsyncPrefetch() const;
+
+    size_t GetCacheMemoryBudget() const;
+
+    std::string GetCacheSnapshotFile() const;
+    size_t GetCacheWarmupLimit() const;
+
+    std::string GetSharedCacheName() const;
+    size_t GetSharedCacheSize() const;
+
     bool GetRouterDataMMap() const;
     bool GetNodesDataMMap() const;
     bool GetAreasDataMMap() const;
@@ -275,6 +321,9 @@ namespace osmscout {
 
     TypeConfigRef                   typeConfig;               //!< Type config for the currently opened map
 
+    MemoryBudgetRef                 memoryBudget;             //!< Shared memory budget of the caches, if configured
+    SharedMemoryCacheRef            sharedCache;              //!< Cache shared with other processes, if configured
+
     mutable BoundingBoxDataFileRef  boundingBoxDataFile;      //!< Cached access to the bounding box data file
     mutable std::mutex              boundingBoxDataFileMutex; //!< Mutex to make lazy initialisation of node DataFile thread-safe
 
@@ -308,6 +357,9 @@ namespace osmscout {
     mutable OptimizeWaysLowZoomRef  optimizeWaysLowZoom;      //!< Optimized data for low zoom situations
     mutable std::mutex              optimizeWaysMutex;        //!< Mutex to make lazy initialisation of optimized ways index thread-safe
 
+    std::thread                     warmupThread;             //!< Background thread loading the cache snapshot
+    std::atomic<bool>               warmupAbort;              //!< Signals the warmup thread to stop
+
   public:
     explicit Database(const DatabaseParameter& parameter);
     virtual ~Database();
@@ -324,6 +376,24 @@ namespace osmscout {
       return parameter;
     }
 
+    /**
+     * Return the memory budget shared by the data and index caches, or an
+     * empty reference, if no budget was configured.
+     */
+    inline MemoryBudgetRef GetMemoryBudget() const
+    {
+      return memoryBudget;
+    }
+
+    /**
+     * Return the cache shared with other processes, or an empty reference,
+     * if no shared cache was configured or it could not be opened.
+     */
+    inline SharedMemoryCacheRef GetSharedCache() const
+    {
+      return sharedCache;
+    }
+
     BoundingBoxDataFileRef GetBoundingBoxDataFile() const;
 
     NodeDataFileRef GetNodeDataFile() const;
@@ -343,6 +413,10 @@ namespace osmscout {
 
     bool GetBoundingBox(GeoBox& boundingBox) const;
 
+    bool SaveCacheSnapshot(const std::string& filename) const;
+    bool LoadCacheSnapshot(const std::string& filename,
+                           size_t limit);
+
     bool GetNodeByOffset(const FileOffset& offset,
                          NodeRef& node) const;
     bool GetNodesByOffset(const std::vector<FileOffset>& offsets,
@@ -37,7 +37,11 @@ namespace osmscout {
     static const char* NODES_IDMAP;
 
   public:
-    NodeDataFile(size_t cacheSize);
+    NodeDataFile(size_t cacheSize,
+                 size_t cacheShardCount=1);
+
+  protected:
+    size_t GetValueMemory(const Node& node) const override;
   };
 
   typedef std::shared_ptr<NodeDataFile> NodeDataFileRef;
@@ -20,25 +20,47 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
 */
 
+#include <algorithm>
+#include <memory>
 #include <mutex>
+#include <type_traits>
 #include <vector>
 
+#include <osmscout/util/AlignedAllocator.h>
 #include <osmscout/util/Cache.h>
 #include <osmscout/util/File.h>
 #include <osmscout/util/FileScanner.h>
 #include <osmscout/util/Logger.h>
+#include <osmscout/util/MemoryBudget.h>
 #include <osmscout/util/Number.h>
+#include <osmscout/util/SharedMemoryCache.h>
 #include <osmscout/util/String.h>
 
+#include <osmscout/system/Compiler.h>
+
 namespace osmscout {
 
   /**
     \ingroup Database
     Numeric index handles an index over instance of class <T> where the index criteria
     is of type <N>, where <N> has a numeric nature (usually Id).
+
+    All upper index levels that completely fit into the cache are loaded on Open()
+    and merged into one immutable, sorted array (stored in Eytzinger layout
+    for cache friendly binary search). Lookups in this array do not need any locking.
+    Only the remaining lower levels are read on demand via a page cache, that is
+    split into shards (each secured by its own mutex) per level. Pages are read
+    from a pool of file scanners outside of any lock. If the cache is big enough
+    for the complete index, lookups do not lock at all.
+
+    Optionally pages missing in the page cache are looked up in (and stored to) a
+    SharedMemoryCache, so several processes using the same index decode each
+    page only once.
+
+    The page cache of the lower levels can be controlled by a MemoryBudget.
     */
   template <class N>
-  class NumericIndex
+  class NumericIndex : public MemoryBudget::Consumer
   {
   private:
     /**
@@ -62,7 +84,6 @@ namespace osmscout {
 
     typedef std::shared_ptr<Page>         PageRef;
     typedef Cache<N,PageRef>              PageCache;
-    typedef std::unordered_map<N,PageRef> PageSimpleCache;
 
     /**
       Returns the size of a individual cache entry
@@ -75,34 +96,124 @@ namespace osmscout {
       }
     };
 
+    /**
+     * One shard of the page cache of a level together with the mutex guarding it
+     */
+    struct CacheShard
+    {
+      std::mutex mutex; //!< Mutex to secure multi-thread access to the cache
+      PageCache  cache; //!< The actual cache
+
+      CacheShard(size_t cacheSize,
+                 CachePolicy policy)
+      : cache(cacheSize,policy)
+      {
+        // no code
+      }
+    };
+
+    typedef std::unique_ptr<CacheShard>  CacheShardRef;
+    typedef std::unique_ptr<FileScanner> FileScannerRef;
+
+    /**
+     * Scoped, exclusive usage of one scanner of the scanner pool. The
+     * scanner is acquired on first usage and returned to the pool on destruction.
+     */
+    class ScannerLease CLASS_FINAL
+    {
+    private:
+      const NumericIndex& index;
+      FileScannerRef      scanner;
+
+    public:
+      explicit ScannerLease(const NumericIndex& index)
+      : index(index)
+      {
+        // no code
+      }
+
+      ~ScannerLease()
+      {
+        if (scanner) {
+          index.ReleaseScanner(std::move(scanner));
+        }
+      }
+
+      /**
+       * Return the leased scanner or nullptr, if no scanner could be opened
+       */
+      FileScanner* Get()
+      {
+        if (!scanner) {
+          scanner=index.AcquireScanner();
+        }
+
+        return scanner.get();
+      }
+    };
+
   private:
     std::string                         filepart;             //!< Name of the index file
     std::string                         filename;             //!< Complete file name including directory
 
-    mutable FileScanner                  scanner;             //!< FileScanner instance for file access
+    mutable FileScanner                  scanner;             //!< FileScanner instance for reading the header and the upper levels
+    bool                                 memoryMapped;        //!< Open scanners with mmap support
+    mutable std::vector<FileScannerRef>  idleScanners;        //!< Pool of opened file streams for the lower levels currently not in use
+    mutable std::mutex                   scannerMutex;        //!< Mutex to secure multi-thread access to the scanner pool
 
     size_t                               cacheSize;           //!< Maximum umber of index pages cached
+    size_t                               cacheShardCount;     //!< Number of shards of the page cache of each lower level
+    size_t                               memoryLimit;         //!< Maximum memory of the cached lower level pages, 0 if unlimited
+    CachePolicy                          cachePolicy;         //!< Eviction policy of the page caches
     uint32_t                             pageSize;            //!< Size of one page as stated by the actual index file
     uint32_t                             levels;              //!< Number of index levels as stated by the actual index file
     std::vector<uint32_t>                pageCounts;          //!< Number of pages per level as stated by the actual index file
-    char                                 *buffer;             //!< Temporary buffer for reading page data
 
-    PageRef                              root;                //!< Reference to the root page
-    size_t                               simpleCacheMaxLevel; //!< Maximum level for simple caching
-    mutable std::vector<PageSimpleCache> simplePageCache;     //!< Simple map to cache all entries
-    mutable std::vector<PageCache>       pageCaches;          //!< Complex cache with LRU characteristics
+    uint32_t                             upperLevels;         //!< Number of levels (starting with the root level) held in the upper level array
+    size_t                               upperPageCount;      //!< Number of pages loaded into the upper level array
+    size_t                               lowerCacheSize;      //!< Maximum number of pages cached for the lower levels
+    std::vector<N,AlignedAllocator<N>>   upperIds;            //!< Ids of the deepest upper level, in Eytzinger order, index 0 is unused
+    std::vector<FileOffset,AlignedAllocator<FileOffset>> upperOffsets; //!< File offsets belonging to upperIds
+    std::vector<std::vector<CacheShardRef>> pageCaches;       //!< Sharded cache with LRU or Clock characteristics for each level below the upper levels
 
-    mutable std::mutex                   accessMutex;         //!< Mutex to secure multi-thread access
+    SharedMemoryCacheRef                 sharedCache;         //!< Optional cache shared with other processes
+    uint64_t                             sharedFileKey;       //!< Key of the index file in the shared cache
 
   private:
+    FileScannerRef AcquireScanner() const;
+    void ReleaseScanner(FileScannerRef&& scanner) const;
+
+    inline CacheShard& GetCacheShard(size_t level,
+                                     N startId) const
+    {
+      const std::vector<CacheShardRef>& shards=pageCaches[level-upperLevels];
+      uint64_t                          value=(uint64_t)startId;
+
+      // Page start ids of one level are not evenly distributed, so mix all bits
+      value^=value >> 33;
+      value*=0xff51afd7ed558ccdULL;
+      value^=value >> 33;
+
+      return *shards[value % shards.size()];
+    }
+
     size_t GetPageIndex(const Page& page, N id) const;
-    void ReadPage(FileOffset offset, PageRef& page) const;
-    void InitializeCache();
+    void ReadPage(FileScanner& scanner, FileOffset offset, PageRef& page) const;
+    void LoadPage(FileScanner& scanner, FileOffset offset, PageRef& page) const;
+    size_t BuildUpperLevel(const std::vector<Entry>& entries,
+                           size_t entryIndex,
+                           size_t node);
+    void LoadUpperLevels(FileOffset rootPageOffset);
+    void ApplyMemoryLimit();
+    bool GetUpperOffset(const N& id,
+                        N& startId,
+                        FileOffset& offset) const;
 
   public:
     NumericIndex(const std::string& filename,
-                 size_t cacheSize);
-    virtual ~NumericIndex();
+                 size_t cacheSize,
+                 size_t cacheShardCount=8);
+    ~NumericIndex() override;
 
     bool Open(const std::string& path,
               bool memoryMaped);
@@ -110,6 +221,15 @@ namespace osmscout {
 
     bool IsOpen() const;
 
+    void SetCachePolicy(CachePolicy policy);
+    void SetSharedCache(const SharedMemoryCacheRef& cache);
+
+    std::string GetMemoryConsumerName() const override;
+    size_t GetMemoryUsage() const override;
+    void GetCacheStatistics(size_t& hits,
+                            size_t& misses) const override;
+    void SetMemoryLimit(size_t bytes) override;
+
     bool GetOffset(const N& id, FileOffset& offset) const;
 
     template<typename IteratorIn>
@@ -121,14 +241,26 @@ namespace osmscout {
     void DumpStatistics() const;
   };
 
+  /**
+   * The page cache of each lower level is split into the given number of shards,
+   * so that concurrent lookups of different pages do not block each other.
+   */
   template <class N>
   NumericIndex<N>::NumericIndex(const std::string& filename,
-                                size_t cacheSize)
+                                size_t cacheSize,
+                                size_t cacheShardCount)
    : filepart(filename),
+     memoryMapped(false),
      cacheSize(cacheSize),
+     cacheShardCount(std::max(cacheShardCount,(size_t)1)),
+     memoryLimit(0),
+     cachePolicy(CachePolicy::LRU),
      pageSize(0),
      levels(0),
-     buffer(NULL)
+     upperLevels(0),
+     upperPageCount(0),
+     lowerCacheSize(0),
+     sharedFileKey(0)
   {
     // no code
   }
@@ -137,8 +269,56 @@ namespace osmscout {
   NumericIndex<N>::~NumericIndex()
   {
     Close();
+  }
+
+  /**
+   * Take an idle scanner from the pool or open a new one, if all
+   * scanners are currently in use. Returns nullptr on error.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  typename NumericIndex<N>::FileScannerRef NumericIndex<N>::AcquireScanner() const
+  {
+    {
+      std::lock_guard<std::mutex> lock(scannerMutex);
+
+      if (!idleScanners.empty()) {
+        FileScannerRef scanner=std::move(idleScanners.back());
+
+        idleScanners.pop_back();
+
+        return scanner;
+      }
+    }
+
+    FileScannerRef scanner(new FileScanner());
+
+    try {
+      scanner->Open(filename,
+                    FileScanner::FastRandom,
+                    memoryMapped);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner->CloseFailsafe();
+      return nullptr;
+    }
 
-    delete [] buffer;
+    return scanner;
+  }
+
+  /**
+   * Return a scanner to the pool.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  void NumericIndex<N>::ReleaseScanner(FileScannerRef&& scanner) const
+  {
+    std::lock_guard<std::mutex> lock(scannerMutex);
+
+    idleScanners.push_back(std::move(scanner));
   }
 
   /**
@@ -179,7 +359,9 @@ namespace osmscout {
   }
 
   template <class N>
-  inline void NumericIndex<N>::ReadPage(FileOffset offset, PageRef& page) const
+  inline void NumericIndex<N>::ReadPage(FileScanner& scanner,
+                                        FileOffset offset,
+                                        PageRef& page) const
   {
     if (!page) {
       page=std::make_shared<Page>();
@@ -190,9 +372,12 @@ namespace osmscout {
 
     page->entries.reserve(pageSize/4);
 
+    std::vector<char> pageData(pageSize);
+    const char        *buffer=pageData.data();
+
     scanner.SetPos(offset);
 
-    scanner.Read(buffer,
+    scanner.Read(pageData.data(),
                  pageSize);
 
     size_t     currentPos=0;
@@ -231,8 +416,80 @@ namespace osmscout {
     }
   }
 
+  /**
+    Load the page at the given offset, using the shared cache if available
+    */
+  template <class N>
+  void NumericIndex<N>::LoadPage(FileScanner& scanner,
+                                 FileOffset offset,
+                                 PageRef& page) const
+  {
+    static_assert(std::is_trivially_copyable<Entry>::value,
+                  "Entries are copied to shared memory as is");
+
+    if (sharedCache) {
+      size_t maxEntries=sharedCache->GetMaxValueSize()/sizeof(Entry);
+      size_t valueSize;
+
+      if (!page) {
+        page=std::make_shared<Page>();
+      }
+
+      page->entries.resize(maxEntries);
+
+      if (maxEntries>0 &&
+          sharedCache->Get(sharedFileKey,
+                           offset,
+                           page->entries.data(),
+                           maxEntries*sizeof(Entry),
+                           valueSize) &&
+          valueSize%sizeof(Entry)==0) {
+        page->entries.resize(valueSize/sizeof(Entry));
+
+        return;
+      }
+    }
+
+    ReadPage(scanner,offset,page);
+
+    if (sharedCache) {
+      sharedCache->Put(sharedFileKey,
+                       offset,
+                       page->entries.data(),
+                       page->entries.size()*sizeof(Entry));
+    }
+  }
+
+  /**
+    Store the given sorted entries (starting with the given entry index) in
+    Eytzinger order into the subtree starting with the given node of the
+    upper level array. Returns the index of the next unused entry.
+    */
   template <class N>
-  void NumericIndex<N>::InitializeCache()
+  size_t NumericIndex<N>::BuildUpperLevel(const std::vector<Entry>& entries,
+                                          size_t entryIndex,
+                                          size_t node)
+  {
+    if (node>=upperIds.size()) {
+      return entryIndex;
+    }
+
+    entryIndex=BuildUpperLevel(entries,entryIndex,2*node);
+
+    upperIds[node]=entries[entryIndex].startId;
+    upperOffsets[node]=entries[entryIndex].fileOffset;
+    entryIndex++;
+
+    return BuildUpperLevel(entries,entryIndex,2*node+1);
+  }
+
+  /**
+    Load all levels starting with the root level that completely fit into the
+    cache and store the entries of the deepest loaded level in the upper level
+    array. Remaining cache space is assigned to the page cache of the next level.
+    */
+  template <class N>
+  void NumericIndex<N>::LoadUpperLevels(FileOffset rootPageOffset)
   {
     size_t currentCacheSize=cacheSize; // Available free space in cache
     size_t requiredCacheSize=0;        // Space needed for caching everything
@@ -245,25 +502,108 @@ namespace osmscout {
       log.Warn() << "Warning: Index " << filepart << " has cache size " << cacheSize<< ", but requires cache size " << requiredCacheSize << " to load index completely into cache!";
     }
 
-    simpleCacheMaxLevel=0;
-    for (size_t level=1; level<pageCounts.size(); level++) {
-      size_t resultingCacheSize; // Cache size we actually use for this level
+    std::vector<Entry> entries;
+    PageRef            page;
 
-      simplePageCache.push_back(PageSimpleCache());
+    upperLevels=0;
+    upperPageCount=0;
+    lowerCacheSize=0;
+    pageCaches.clear();
 
-      if (pageCounts[level]>currentCacheSize) {
-        resultingCacheSize=currentCacheSize;
-        currentCacheSize=0;
+    if (levels>0) {
+      LoadPage(scanner,rootPageOffset,page);
 
-        pageCaches.push_back(PageCache(resultingCacheSize));
+      entries=page->entries;
+      upperLevels=1;
+      upperPageCount=1;
+    }
+
+    // The root page is always loaded, it does not count against the cache size
+    while (upperLevels<levels &&
+           pageCounts[upperLevels]<=currentCacheSize) {
+      std::vector<Entry> levelEntries;
+
+      for (const auto& entry : entries) {
+        LoadPage(scanner,entry.fileOffset,page);
+
+        levelEntries.insert(levelEntries.end(),
+                            page->entries.begin(),
+                            page->entries.end());
       }
-      else {
-        resultingCacheSize=pageCounts[level];
-        currentCacheSize-=pageCounts[level];
 
-        simpleCacheMaxLevel=level;
+      currentCacheSize-=pageCounts[upperLevels];
+      upperPageCount+=entries.size();
+      upperLevels++;
+
+      entries.swap(levelEntries);
+    }
 
-        pageCaches.push_back(PageCache(0));
+    upperIds.assign(entries.size()+1,0);
+    upperOffsets.assign(entries.size()+1,0);
+    upperIds.shrink_to_fit();
+    upperOffsets.shrink_to_fit();
+
+    BuildUpperLevel(entries,0,1);
+
+    if (upperLevels<levels) {
+      lowerCacheSize=currentCacheSize;
+    }
+
+    // Do not create more shards than pages fit into the cache
+    size_t shardCount=std::max(std::min(cacheShardCount,lowerCacheSize),(size_t)1);
+    size_t shardCacheSize=(lowerCacheSize+shardCount-1)/shardCount;
+
+    for (size_t level=upperLevels; level<levels; level++) {
+      std::vector<CacheShardRef> shards;
+
+      shards.reserve(shardCount);
+
+      for (size_t i=0; i<shardCount; i++) {
+        shards.push_back(CacheShardRef(new CacheShard(shardCacheSize,cachePolicy)));
+      }
+
+      pageCaches.push_back(std::move(shards));
+    }
+
+    ApplyMemoryLimit();
+  }
+
+  /**
+   * Distribute the size of the lower level page cache over its shards and
+   * limit the shards by memory, if requested. The memory limit is shared by
+   * all lower levels. The number of pages is then only limited by the minimum
+   * page memory.
+   */
+  template <class N>
+  void NumericIndex<N>::ApplyMemoryLimit()
+  {
+    size_t shardCount=0;
+
+    for (const auto& shards : pageCaches) {
+      shardCount+=shards.size();
+    }
+
+    for (auto& shards : pageCaches) {
+      size_t shardCacheSize=(lowerCacheSize+shards.size()-1)/shards.size();
+      size_t shardMemoryLimit=memoryLimit/shardCount;
+
+      for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        if (!shard->cache.IsActive()) {
+          continue;
+        }
+
+        if (memoryLimit>0) {
+          shard->cache.SetMaxSize(std::max(shardMemoryLimit/(sizeof(PageRef)+sizeof(Page)),(size_t)1));
+          shard->cache.SetMaxMemory(std::max(shardMemoryLimit,(size_t)1),
+                                    std::make_shared<NumericIndexCacheValueSizer>());
+        }
+        else {
+          shard->cache.SetMaxSize(shardCacheSize);
+          shard->cache.SetMaxMemory(0,
+                                    nullptr);
+        }
       }
     }
   }
@@ -277,6 +617,8 @@ namespace osmscout {
     FileOffset  indexPageCountsOffset;
 
     filename=AppendFileToDir(path,filepart);
+    sharedFileKey=SharedMemoryCache::GetFileKey(filename);
+    memoryMapped=memoryMaped;
 
     try {
        scanner.Open(filename,
@@ -302,14 +644,9 @@ namespace osmscout {
         scanner.ReadNumber(pageCounts[level]);
       }
 
-      delete [] buffer;
-      buffer=new char[pageSize];
-
       //std::cout << "Index " << filename << ": " << entries << " entries to index, " << levels << " levels, pageSize " << pageSize << ", cache size " << cacheSize << std::endl;
 
-      ReadPage(lastLevelPageStart,root);
-
-      InitializeCache();
+      LoadUpperLevels(lastLevelPageStart);
     }
     catch (IOException& e) {
       log.Error() << e.GetDescription();
@@ -323,6 +660,33 @@ namespace osmscout {
   template <class N>
   bool NumericIndex<N>::Close()
   {
+    upperLevels=0;
+    upperPageCount=0;
+    upperIds.clear();
+    upperOffsets.clear();
+    pageCaches.clear();
+
+    bool result=true;
+
+    {
+      std::lock_guard<std::mutex> lock(scannerMutex);
+
+      for (auto& idleScanner : idleScanners) {
+        try {
+          if (idleScanner->IsOpen()) {
+            idleScanner->Close();
+          }
+        }
+        catch (IOException& e) {
+          log.Error() << e.GetDescription();
+          idleScanner->CloseFailsafe();
+          result=false;
+        }
+      }
+
+      idleScanners.clear();
+    }
+
     try {
       if (scanner.IsOpen()) {
         scanner.Close();
@@ -334,7 +698,7 @@ namespace osmscout {
       return false;
     }
 
-    return true;
+    return result;
   }
 
   template <class N>
@@ -343,6 +707,39 @@ namespace osmscout {
     return scanner.IsOpen();
   }
 
+  /**
+   * Search the upper level array for the entry with the biggest start id
+   * less or equal to the given id. Does not need any locking.
+   */
+  template <class N>
+  inline bool NumericIndex<N>::GetUpperOffset(const N& id,
+                                              N& startId,
+                                              FileOffset& offset) const
+  {
+    size_t size=upperIds.size();
+    size_t node=1;
+    size_t match=0;
+
+    while (node<size) {
+      if (upperIds[node]<=id) {
+        match=node;
+        node=2*node+1;
+      }
+      else {
+        node=2*node;
+      }
+    }
+
+    if (match==0) {
+      return false;
+    }
+
+    startId=upperIds[match];
+    offset=upperOffsets[match];
+
+    return true;
+  }
+
   /**
    * Return the file offset in the data file for the given object id.
    *
@@ -352,55 +749,56 @@ namespace osmscout {
   bool NumericIndex<N>::GetOffset(const N& id,
                                   FileOffset& offset) const
   {
-    try
-    {
-      std::lock_guard<std::mutex> lock(accessMutex);
+    N startId;
 
-      //std::cout << "Looking up " << id << " in index...." << std::endl;
-
-      size_t                      r=GetPageIndex(*root,id);
-      PageRef                     pageRef;
-
-      if (!root->IndexIsValid(r)) {
-        //std::cerr << "Id " << id << " not found in root index, " << root->entries.front().startId << "-" << root->entries.back().startId << std::endl;
-        return false;
-      }
-
-      const Entry& rootEntry=root->entries[r];
+    if (!GetUpperOffset(id,
+                        startId,
+                        offset)) {
+      //std::cerr << "Id " << id << " not found in upper index levels" << std::endl;
+      return false;
+    }
 
-      //std::cout << "Root entry index: " << r << " " << rootEntry.startId << " " << rootEntry.fileOffset << std::endl;
+    if (upperLevels>=levels) {
+      return startId==id;
+    }
 
-      offset=rootEntry.fileOffset;
+    try
+    {
+      ScannerLease lease(*this);
+      PageRef      pageRef;
 
-      N startId=rootEntry.startId;
-      for (size_t level=0; level+2<=levels; level++) {
+      for (size_t level=upperLevels; level<levels; level++) {
         //std::cout << "Level " << level << "/" << levels << std::endl;
-        if (level<=simpleCacheMaxLevel) {
-          auto cacheRef=simplePageCache[level].find(startId);
+        CacheShard& shard=GetCacheShard(level,startId);
+        bool        cached;
 
-          if (cacheRef==simplePageCache[level].end()) {
-            pageRef=NULL; // Make sure, that we allocate a new page and not reuse an old one
+        {
+          std::lock_guard<std::mutex>  lock(shard.mutex);
+          typename PageCache::CacheRef cacheRef;
 
-            ReadPage(offset,pageRef);
+          cached=shard.cache.GetEntry(startId,cacheRef);
 
-            simplePageCache[level].insert(std::make_pair(startId,pageRef));
-          }
-          else {
-            pageRef=cacheRef->second;
+          if (cached) {
+            pageRef=cacheRef->value;
           }
         }
-        else {
-          typename PageCache::CacheRef cacheRef;
-
-          if (!pageCaches[level].GetEntry(startId,cacheRef)) {
-            typename PageCache::CacheEntry cacheEntry(startId);
 
-            cacheRef=pageCaches[level].SetEntry(cacheEntry);
+        if (!cached) {
+          FileScanner* pageScanner=lease.Get();
 
-            ReadPage(offset,cacheRef->value);
+          if (pageScanner==nullptr) {
+            return false;
           }
 
-          pageRef=cacheRef->value;
+          // Load a new page before storing it, the cache calculates its memory on insertion.
+          // Pages are immutable once loaded, so they can be used after the lock is released
+          pageRef=nullptr;
+
+          LoadPage(*pageScanner,offset,pageRef);
+
+          std::lock_guard<std::mutex> lock(shard.mutex);
+
+          shard.cache.SetEntry(typename PageCache::CacheEntry(startId,pageRef));
         }
 
         Page& page=*pageRef;
@@ -408,7 +806,7 @@ namespace osmscout {
         size_t i=GetPageIndex(page,id);
 
         if (!page.IndexIsValid(i)) {
-          //std::cerr << "Id " << id << " not found in index level " << level+2 << "!" << std::endl;
+          //std::cerr << "Id " << id << " not found in index level " << level+1 << "!" << std::endl;
           return false;
         }
 
@@ -459,22 +857,124 @@ namespace osmscout {
     return true;
   }
 
+  /**
+   * Change the eviction policy of the page caches. If the index is already
+   * open, the policy of the existing caches is changed, too.
+   */
+  template <class N>
+  void NumericIndex<N>::SetCachePolicy(CachePolicy policy)
+  {
+    cachePolicy=policy;
+
+    for (auto& shards : pageCaches) {
+      for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        shard->cache.SetPolicy(policy);
+      }
+    }
+  }
+
+  template <class N>
+  std::string NumericIndex<N>::GetMemoryConsumerName() const
+  {
+    return filepart;
+  }
+
+  /**
+   * Return the memory of the cached lower level pages. Only available, if the
+   * cache is limited by memory using SetMemoryLimit(), else 0 is returned.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  size_t NumericIndex<N>::GetMemoryUsage() const
+  {
+    size_t memory=0;
+
+    for (const auto& shards : pageCaches) {
+      for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        memory+=shard->cache.GetCurrentMemory();
+      }
+    }
+
+    return memory;
+  }
+
+  /**
+   * Return the accumulated hits and misses of the lower level page caches.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  void NumericIndex<N>::GetCacheStatistics(size_t& hits,
+                                           size_t& misses) const
+  {
+    hits=0;
+    misses=0;
+
+    for (const auto& shards : pageCaches) {
+      for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+
+        hits+=shard->cache.GetHits();
+        misses+=shard->cache.GetMisses();
+      }
+    }
+  }
+
+  /**
+   * Limit the page cache of the index to the given number of bytes instead of
+   * a number of pages. The number of pages passed in the constructor still
+   * decides, which upper levels are held completely in memory. Passing 0
+   * removes the limit. If the index is already open, the limit is applied to the
+   * existing caches, too.
+   *
+   * Method is thread-safe.
+   */
+  template <class N>
+  void NumericIndex<N>::SetMemoryLimit(size_t bytes)
+  {
+    memoryLimit=bytes;
+
+    ApplyMemoryLimit();
+  }
+
+  /**
+   * Set a cache shared with other processes, that is consulted before
+   * reading pages from disk. Must be called before Open().
+   */
+  template <class N>
+  void NumericIndex<N>::SetSharedCache(const SharedMemoryCacheRef& cache)
+  {
+    sharedCache=cache;
+  }
+
   template <class N>
   void NumericIndex<N>::DumpStatistics() const
   {
     size_t memory=0;
     size_t pages=0;
+    size_t hits=0;
+    size_t misses=0;
 
-    pages+=1;
-    memory+=root->entries.size()*sizeof(Entry);
+    pages+=upperPageCount;
+    memory+=upperIds.size()*(sizeof(N)+sizeof(FileOffset));
 
+    for (const auto& shards : pageCaches) {
+      for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
 
-    for (size_t i=0; i<pageCaches.size(); i++) {
-      pages+=pageCaches[i].GetSize();
-      memory+=sizeof(pageCaches[i])+pageCaches[i].GetMemory(NumericIndexCacheValueSizer());
+        pages+=shard->cache.GetSize();
+        memory+=sizeof(*shard)+shard->cache.GetMemory(NumericIndexCacheValueSizer());
+        hits+=shard->cache.GetHits();
+        misses+=shard->cache.GetMisses();
+      }
     }
 
-    log.Info() << "Index " << filepart << ": " << pages << " pages, memory " << memory;
+    log.Info() << "Index " << filepart << ": " << pages << " pages, memory " << memory << ", cache hits " << hits << ", cache misses " << misses;
   }
 }
 
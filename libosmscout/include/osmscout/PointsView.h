@@ -0,0 +1,254 @@
+#ifndef OSMSCOUT_POINTSVIEW_H
+#define OSMSCOUT_POINTSVIEW_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include <osmscout/CoreImportExport.h>
+
+#include <osmscout/GeoCoord.h>
+#include <osmscout/Point.h>
+
+#include <osmscout/util/GeoBox.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  class FileScanner;
+
+  /**
+   * \ingroup Geometry
+   *
+   * Read-only view of a list of points as written by
+   * FileWriter::Write(const std::vector<Point>&,bool).
+   *
+   * The view does not decode the points in advance, it directly iterates the
+   * delta encoded data. If the data was read from a memory mapped file,
+   * the view references the mapped bytes directly and no copy is made at all,
+   * else the encoded bytes are copied into an internal buffer that is reused
+   * for the next read.
+   *
+   * A view referencing memory mapped data is only valid as long as the
+   * file it was read from is open.
+   */
+  class OSMSCOUT_API PointsView CLASS_FINAL
+  {
+    friend class FileScanner;
+
+  public:
+    class OSMSCOUT_API const_iterator CLASS_FINAL
+    {
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef Point                     value_type;
+      typedef std::ptrdiff_t            difference_type;
+      typedef const Point*              pointer;
+      typedef const Point&              reference;
+
+    private:
+      const PointsView* view;
+      size_t            index;
+      const uint8_t*    deltaPos;
+      const uint8_t*    serialPos;
+      uint8_t           serialBits;
+      uint32_t          latValue;
+      uint32_t          lonValue;
+      Point             current;
+
+    private:
+      inline uint8_t NextSerial()
+      {
+        if (!view->hasSerials) {
+          return 0;
+        }
+
+        if (index%8==0) {
+          serialBits=*serialPos;
+          serialPos++;
+        }
+
+        if ((serialBits & (1u << index%8))!=0) {
+          uint8_t serial=*serialPos;
+
+          serialPos++;
+
+          return serial;
+        }
+
+        return 0;
+      }
+
+      inline void NextDelta()
+      {
+        int32_t latDelta;
+        int32_t lonDelta;
+
+        if (view->coordBitSize==16) {
+          latDelta=(int8_t)deltaPos[0];
+          lonDelta=(int8_t)deltaPos[1];
+          deltaPos+=2;
+        }
+        else if (view->coordBitSize==32) {
+          latDelta=(int16_t)(uint16_t)(deltaPos[0] | (deltaPos[1] << 8));
+          lonDelta=(int16_t)(uint16_t)(deltaPos[2] | (deltaPos[3] << 8));
+          deltaPos+=4;
+        }
+        else {
+          uint32_t latUDelta=deltaPos[0] | (deltaPos[1] << 8) | (deltaPos[2] << 16);
+          uint32_t lonUDelta=deltaPos[3] | (deltaPos[4] << 8) | (deltaPos[5] << 16);
+
+          latDelta=(int32_t)((latUDelta & 0x800000) ? (latUDelta | 0xff000000) : latUDelta);
+          lonDelta=(int32_t)((lonUDelta & 0x800000) ? (lonUDelta | 0xff000000) : lonUDelta);
+          deltaPos+=6;
+        }
+
+        latValue+=latDelta;
+        lonValue+=lonDelta;
+      }
+
+      inline void Decode()
+      {
+        uint8_t serial=NextSerial();
+
+        current.Set(serial,
+                    GeoCoord(latValue/latConversionFactor-90.0,
+                             lonValue/lonConversionFactor-180.0));
+      }
+
+    public:
+      inline const_iterator(const PointsView* view,
+                            size_t index)
+      : view(view),
+        index(index),
+        deltaPos(view->deltaData),
+        serialPos(view->serialData),
+        serialBits(0),
+        latValue(view->firstLat),
+        lonValue(view->firstLon)
+      {
+        if (index<view->nodeCount) {
+          Decode();
+        }
+      }
+
+      inline const Point& operator*() const
+      {
+        return current;
+      }
+
+      inline const Point* operator->() const
+      {
+        return &current;
+      }
+
+      inline const_iterator& operator++()
+      {
+        index++;
+
+        if (index<view->nodeCount) {
+          NextDelta();
+          Decode();
+        }
+
+        return *this;
+      }
+
+      inline const_iterator operator++(int)
+      {
+        const_iterator tmp(*this);
+
+        ++(*this);
+
+        return tmp;
+      }
+
+      inline bool operator==(const const_iterator& other) const
+      {
+        return index==other.index;
+      }
+
+      inline bool operator!=(const const_iterator& other) const
+      {
+        return index!=other.index;
+      }
+    };
+
+  private:
+    size_t               nodeCount;    //!< Number of points
+    uint8_t              coordBitSize; //!< Number of bits used for encoding the lat and lon delta of one point
+    bool                 hasSerials;   //!< Serial data is available
+    bool                 memoryMapped; //!< Data references memory mapped file data
+    uint32_t             firstLat;     //!< Encoded latitude of the first point
+    uint32_t             firstLon;     //!< Encoded longitude of the first point
+    const uint8_t        *deltaData;   //!< Start of the delta encoded points following the first point
+    const uint8_t        *serialData;  //!< Start of the serial data (if any)
+    std::vector<uint8_t> storage;      //!< Copy of the encoded data, if the data was not memory mapped
+
+  public:
+    PointsView();
+
+    PointsView(const PointsView& other)=delete;
+    PointsView(PointsView&& other)=default;
+
+    PointsView& operator=(const PointsView& other)=delete;
+    PointsView& operator=(PointsView&& other)=default;
+
+    void Clear();
+
+    inline size_t size() const
+    {
+      return nodeCount;
+    }
+
+    inline bool empty() const
+    {
+      return nodeCount==0;
+    }
+
+    inline const_iterator begin() const
+    {
+      return const_iterator(this,0);
+    }
+
+    inline const_iterator end() const
+    {
+      return const_iterator(this,nodeCount);
+    }
+
+    /**
+     * Returns true, if the view directly references memory mapped data
+     */
+    inline bool IsMemoryMapped() const
+    {
+      return memoryMapped;
+    }
+
+    GeoBox GetBoundingBox() const;
+
+    void CopyTo(std::vector<Point>& nodes) const;
+  };
+}
+
+#endif
@@ -714,6 +714,20 @@ namespace osmscout {
       return type;
     }
 
+    /**
+     * Returns the (estimated) number of bytes allocated by the buffer on the heap.
+     * Memory allocated by individual feature values (like strings) is not included.
+     */
+    inline size_t GetAllocatedMemory() const
+    {
+      if (!type) {
+        return 0;
+      }
+
+      return (featureBits!=nullptr ? type->GetSpecialFeatureMaskBytes() : 0)+
+             (featureValueBuffer!=nullptr ? type->GetFeatureValueBufferSize() : 0);
+    }
+
     /**
      * Return the numbe rof features defined for this type
      */
@@ -24,6 +24,7 @@
 
 #include <osmscout/GeoCoord.h>
 #include <osmscout/Point.h>
+#include <osmscout/PointsView.h>
 #include <osmscout/Tag.h>
 #include <osmscout/TypeConfig.h>
 
@@ -193,6 +194,75 @@ namespace osmscout {
   };
 
   typedef std::shared_ptr<Way> WayRef;
+
+  /**
+   * Read-only view of a way as stored in the 'ways.dat' file.
+   *
+   * In contrast to Way a WayView does not decode the list of nodes but
+   * iterates the encoded data directly (see PointsView). A WayView is
+   * meant to be reused for reading a sequence of ways, internal buffers
+   * are kept between calls to Read().
+   *
+   * If the file was opened memory mapped, the view is only valid
+   * as long as the file is open and until the next call to Read().
+   */
+  class OSMSCOUT_API WayView CLASS_FINAL
+  {
+  private:
+    FeatureValueBuffer featureValueBuffer; //!< List of features
+    PointsView         nodes;              //!< List of nodes
+
+    FileOffset         fileOffset;         //!< Offset into the data file of this way
+    FileOffset         nextFileOffset;     //!< Offset after this way
+
+  public:
+    inline WayView()
+    : fileOffset(0),nextFileOffset(0)
+    {
+      // no code
+    }
+
+    WayView(const WayView& other)=delete;
+    WayView& operator=(const WayView& other)=delete;
+
+    inline FileOffset GetFileOffset() const
+    {
+      return fileOffset;
+    }
+
+    inline FileOffset GetNextFileOffset() const
+    {
+      return nextFileOffset;
+    }
+
+    inline ObjectFileRef GetObjectFileRef() const
+    {
+      return {fileOffset,refWay};
+    }
+
+    inline TypeInfoRef GetType() const
+    {
+      return featureValueBuffer.GetType();
+    }
+
+    inline const FeatureValueBuffer& GetFeatureValueBuffer() const
+    {
+      return featureValueBuffer;
+    }
+
+    inline const PointsView& GetNodes() const
+    {
+      return nodes;
+    }
+
+    inline GeoBox GetBoundingBox() const
+    {
+      return nodes.GetBoundingBox();
+    }
+
+    void Read(const TypeConfig& typeConfig,
+              FileScanner& scanner);
+  };
 }
 
 #endif
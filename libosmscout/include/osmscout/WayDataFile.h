@@ -37,7 +37,11 @@ namespace osmscout {
     static const char* WAYS_IDMAP;
 
   public:
-    WayDataFile(size_t cacheSize);
+    WayDataFile(size_t cacheSize,
+                size_t cacheShardCount=1);
+
+  protected:
+    size_t GetValueMemory(const Way& way) const override;
   };
 
   typedef std::shared_ptr<WayDataFile> WayDataFileRef;
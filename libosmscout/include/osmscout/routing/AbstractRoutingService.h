@@ -24,9 +24,12 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <osmscout/CoreFeatures.h>
 #include <osmscout/TypeConfig.h>
@@ -49,6 +52,116 @@ namespace osmscout {
   template <class RoutingState>
   class OSMSCOUT_API AbstractRoutingService: public RoutingService
   {
+  protected:
+    /**
+     * State of one direction of the bidirectional search
+     *
+     * In the forward search RNode::access signals, that the route from the start
+     * to the node does not use restricted ways. In the backward search RNode::access
+     * signals, that the route from the node to the target uses at least one
+     * unrestricted way (and so the node must not be reached via a restricted way).
+     * Nodes with access are closed in the closedSet, the others in the closedRestrictedSet.
+     *
+     * In the backward search RNode::prev is the next route node in route direction
+     * and RNode::object is the object used to get from the node to the next route node.
+     */
+    struct SearchDirection
+    {
+      GeoCoord                                startCoord;          //!< Coordinate the search starts from
+      GeoCoord                                targetCoord;         //!< Coordinate the search is heading to
+      OpenList                                openList;
+      OpenMap                                 openMap;
+      DBIdHashMap<RNodeRef>                   closedSet;           //!< Closed nodes with access
+      DBIdHashMap<RNodeRef>                   closedRestrictedSet; //!< Closed nodes without access
+      Distance                                currentMaxDistance;  //!< Maximum distance reached in direction of the target
+      std::unordered_map<DBFileOffset,WayRef> ways;                //!< Ways loaded by GetIncomingPaths() during the search
+      DBIdHashMap<std::vector<ObjectFileRef>> junctions;           //!< Junction objects loaded by GetIncomingPaths() during the search
+      size_t                                  nodesLoadedCount;
+      size_t                                  nodesIgnoredCount;
+      size_t                                  maxOpenList;
+    };
+
+    /**
+     * Best route found so far by the bidirectional search
+     */
+    struct SearchMeeting
+    {
+      double costs;        //!< Costs of the route
+      RNode  forwardNode;  //!< Node of the forward search at the meeting point
+      RNode  backwardNode; //!< Node of the backward search at the meeting point
+    };
+
+    /**
+     * Search state of one A* route calculation. Contexts are pooled and reused
+     * by later calculations, so the containers are only allocated once for
+     * each concurrently running calculation.
+     */
+    struct QueryContext
+    {
+      OpenList  openList;            //!< Heap (smallest cost first) of route nodes to check
+      OpenMap   openMap;             //!< Route nodes in the open list by id
+      ClosedSet closedSet;           //!< Closed route nodes reached without access restrictions
+      ClosedSet closedRestrictedSet; //!< Closed route nodes reached via restricted ways
+
+      std::shared_ptr<const std::vector<double>> pathCosts; //!< Costs of all paths of the routing graph, if set by PrepareQuery()
+
+      QueryContext()
+      {
+        openList.reserve(10000);
+        openMap.reserve(10000);
+        closedSet.reserve(100000);
+        closedRestrictedSet.reserve(1000);
+      }
+
+      void Clear()
+      {
+        openList.clear();
+        openMap.clear();
+        closedSet.clear();
+        closedRestrictedSet.clear();
+        pathCosts.reset();
+      }
+    };
+
+    typedef std::unique_ptr<QueryContext> QueryContextRef;
+
+    /**
+     * Scoped, exclusive usage of one context of the query context pool. The
+     * context is returned to the pool on destruction.
+     */
+    class QueryContextLease CLASS_FINAL
+    {
+    private:
+      AbstractRoutingService& service;
+      QueryContextRef         context;
+
+    public:
+      explicit QueryContextLease(AbstractRoutingService& service)
+      : service(service),
+        context(service.AcquireQueryContext())
+      {
+        // no code
+      }
+
+      ~QueryContextLease()
+      {
+        service.ReleaseQueryContext(std::move(context));
+      }
+
+      inline QueryContext& Get()
+      {
+        return *context;
+      }
+    };
+
+  private:
+    std::vector<QueryContextRef> idleQueryContexts; //!< Pool of query contexts currently not in use
+    std::mutex                   queryContextMutex; //!< Mutex to secure multi-thread access to the query context pool
+
+  private:
+    QueryContextRef AcquireQueryContext();
+    void ReleaseQueryContext(QueryContextRef&& context);
+
   protected:
     bool debugPerformance;
 
@@ -124,6 +237,14 @@ namespace osmscout {
                                            const DatabaseId database,
                                            const Id id) = 0;
 
+    /**
+     * Return all routable objects that meet at the given route node, including
+     * objects that cannot be used to leave the route node (like oneways ending
+     * at the node)
+     */
+    virtual bool GetJunctionObjects(const DBId& id,
+                                    std::vector<ObjectFileRef>& objects) = 0;
+
     void GetStartForwardRouteNode(const RoutingState& state,
                                   const DatabaseId& database,
                                   const WayRef& way,
@@ -209,7 +330,11 @@ namespace osmscout {
                                       const ClosedSet &closedSet,
                                       const ClosedSet &closedRestrictedSet);
 
+    virtual bool PrepareQuery(const RoutingState& state,
+                              QueryContext& context);
+
     virtual bool WalkPaths(const RoutingState& state,
+                           const QueryContext& context,
                            RNodeRef &current,
                            RouteNodeRef &currentRouteNode,
                            OpenList &openList,
@@ -224,6 +349,41 @@ namespace osmscout {
                            Distance &currentMaxDistance,
                            const Distance &overallDistance,
                            const double &costLimit);
+
+    bool GetIncomingPaths(const RoutingState& state,
+                          SearchDirection& search,
+                          const DBId& id,
+                          const RouteNode& routeNode,
+                          std::vector<std::pair<RouteNodeRef,size_t>>& paths);
+
+    bool CanMeet(const RouteNode& routeNode,
+                 const RNode& forwardNode,
+                 const RNode& backwardNode) const;
+
+    void UpdateMeeting(const RNode& node,
+                       const RouteNode& routeNode,
+                       bool forward,
+                       const SearchDirection& other,
+                       SearchMeeting& meeting) const;
+
+    bool WalkBidirectional(const RoutingState& state,
+                           bool forward,
+                           SearchDirection& search,
+                           const SearchDirection& other,
+                           const RNode& current,
+                           const DBId& id,
+                           const RouteNodeRef& routeNode,
+                           const ObjectFileRef& object,
+                           double currentCost,
+                           bool access,
+                           double costLimit,
+                           SearchMeeting& meeting);
+
+    RoutingResult CalculateRouteBidirectional(RoutingState& state,
+                                              const RoutePosition& start,
+                                              const RoutePosition& target,
+                                              const RoutingParameter& parameter);
+
   public:
     explicit AbstractRoutingService(const RouterParameter& parameter);
     ~AbstractRoutingService() override;
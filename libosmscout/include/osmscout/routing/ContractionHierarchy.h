@@ -0,0 +1,171 @@
+#ifndef OSMSCOUT_CONTRACTIONHIERARCHY_H
+#define OSMSCOUT_CONTRACTIONHIERARCHY_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <osmscout/CoreImportExport.h>
+
+#include <osmscout/ObjectRef.h>
+#include <osmscout/OSMScoutTypes.h>
+
+#include <osmscout/routing/RoutingProfile.h>
+
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * Contraction hierarchy of the routing graph for one vehicle.
+   *
+   * The nodes of the routing graph are contracted one after another during
+   * import. Contracting a node removes it from the graph and adds shortcut
+   * edges between its neighbours where necessary to keep shortest paths.
+   * Every edge is stored at its lower ranked (earlier contracted) node,
+   * "up" edges leave the node, "down" edges enter it. A query only follows edges
+   * to higher ranked nodes, from the start forward over up edges and from the target
+   * backward over down edges, and thus only settles a small number of nodes.
+   *
+   * The costs of the edges are the costs of a FastestPathRoutingProfile. The speeds
+   * used are stored, a hierarchy can only be used for a profile with
+   * the same speeds (see IsCompatible()). Paths that are restricted for
+   * the vehicle and turn restrictions are not part of the hierarchy. Nodes with
+   * turn restrictions are marked, so that a route can be checked.
+   */
+  class OSMSCOUT_API ContractionHierarchy CLASS_FINAL
+  {
+  public:
+    static const uint32_t fileFormatVersion=1;
+    static const uint32_t noNode=std::numeric_limits<uint32_t>::max();
+
+    /**
+     * An edge of the hierarchy
+     */
+    struct OSMSCOUT_API Edge
+    {
+      uint32_t      target;  //!< Index of the higher ranked node
+      uint32_t      middle;  //!< Contracted node of a shortcut or noNode for an edge of the routing graph
+      double        costs;   //!< Costs of the edge
+      ObjectFileRef object;  //!< Object (way/area) of an edge of the routing graph
+    };
+
+    /**
+     * Start or target of a query together with the costs to reach it
+     */
+    struct OSMSCOUT_API Terminal
+    {
+      Id     id;     //!< Id of the route node
+      double costs;  //!< Initial costs
+    };
+
+    /**
+     * One route node of the resulting route
+     */
+    struct OSMSCOUT_API Step
+    {
+      Id            id;      //!< Id of the route node
+      ObjectFileRef object;  //!< Object used to reach this route node, invalid for the first route node
+    };
+
+  private:
+    Vehicle               vehicle;          //!< Vehicle of the hierarchy
+    double                vehicleMaxSpeed;  //!< Maximum speed of the vehicle
+    std::vector<double>   speeds;           //!< Speed per type index
+    std::vector<Id>       ids;              //!< Route node ids, sorted, the index is the node index
+    std::vector<uint8_t>  excludes;         //!< Per node, 1 if the route node has turn restrictions
+    std::vector<uint32_t> upOffsets;        //!< Index of the first up edge of each node (plus end)
+    std::vector<Edge>     upEdges;          //!< Up edges of all nodes
+    std::vector<uint32_t> downOffsets;      //!< Index of the first down edge of each node (plus end)
+    std::vector<Edge>     downEdges;        //!< Down edges of all nodes
+
+  private:
+    const Edge* FindUpEdge(uint32_t node,
+                           uint32_t target) const;
+    const Edge* FindDownEdge(uint32_t node,
+                             uint32_t source) const;
+
+    void Unpack(uint32_t from,
+                uint32_t to,
+                const Edge& edge,
+                std::vector<Step>& steps) const;
+
+  public:
+    ContractionHierarchy();
+
+    void SetMetric(Vehicle vehicle,
+                   double vehicleMaxSpeed,
+                   const std::vector<double>& speeds);
+    void SetNodes(std::vector<Id>&& ids,
+                  std::vector<uint8_t>&& excludes);
+    void SetEdges(std::vector<uint32_t>&& upOffsets,
+                  std::vector<Edge>&& upEdges,
+                  std::vector<uint32_t>&& downOffsets,
+                  std::vector<Edge>&& downEdges);
+
+    inline Vehicle GetVehicle() const
+    {
+      return vehicle;
+    }
+
+    inline size_t GetNodeCount() const
+    {
+      return ids.size();
+    }
+
+    inline size_t GetEdgeCount() const
+    {
+      return upEdges.size()+downEdges.size();
+    }
+
+    bool IsCompatible(const RoutingProfile& profile) const;
+
+    uint32_t GetNodeIndex(Id id) const;
+
+    /**
+     * Returns true, if the given node has turn restrictions
+     */
+    inline bool HasExcludes(uint32_t node) const
+    {
+      return excludes[node]!=0;
+    }
+
+    bool CalculateRoute(const std::vector<Terminal>& sources,
+                        const std::vector<Terminal>& targets,
+                        std::vector<Step>& steps,
+                        double& costs,
+                        size_t& settledNodes) const;
+
+    void Read(FileScanner& scanner);
+    void Write(FileWriter& writer) const;
+  };
+
+  typedef std::shared_ptr<ContractionHierarchy> ContractionHierarchyRef;
+}
+
+#endif
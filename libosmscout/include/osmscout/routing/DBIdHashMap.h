@@ -0,0 +1,357 @@
+#ifndef OSMSCOUT_DBIDHASHMAP_H
+#define OSMSCOUT_DBIDHASHMAP_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <osmscout/routing/DBFileOffset.h>
+
+#include <osmscout/system/Assert.h>
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * Hash map from DBId to a value as used for the node state during routing.
+   *
+   * All entries are stored in one flat array (open addressing with linear
+   * probing), so in contrast to std::unordered_map inserting a value does not
+   * allocate memory (besides growing the array) and lookups do not follow
+   * pointers. An entry with an invalid key (see DBId::IsValid()) marks an
+   * empty slot, so invalid keys cannot be stored. Erasing shifts following
+   * entries back, so there are no tombstones.
+   *
+   * Pointers to values are only valid until the next insert or erase.
+   *
+   * Iterating over the map returns the values in undefined order.
+   */
+  template<class V>
+  class DBIdHashMap CLASS_FINAL
+  {
+  private:
+    struct Entry
+    {
+      DBId key;
+      V    value;
+    };
+
+  public:
+    class const_iterator
+    {
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef V                         value_type;
+      typedef std::ptrdiff_t            difference_type;
+      typedef const V*                  pointer;
+      typedef const V&                  reference;
+
+    private:
+      const Entry *current;
+      const Entry *end;
+
+    private:
+      void SkipEmpty()
+      {
+        while (current!=end &&
+               !current->key.IsValid()) {
+          ++current;
+        }
+      }
+
+    public:
+      const_iterator(const Entry* current,
+                     const Entry* end)
+      : current(current),
+        end(end)
+      {
+        SkipEmpty();
+      }
+
+      inline reference operator*() const
+      {
+        return current->value;
+      }
+
+      inline pointer operator->() const
+      {
+        return &current->value;
+      }
+
+      inline const_iterator& operator++()
+      {
+        ++current;
+        SkipEmpty();
+
+        return *this;
+      }
+
+      inline bool operator==(const const_iterator& other) const
+      {
+        return current==other.current;
+      }
+
+      inline bool operator!=(const const_iterator& other) const
+      {
+        return current!=other.current;
+      }
+    };
+
+  private:
+    std::vector<Entry> entries; //!< Slots, size is always zero or a power of two
+    size_t             count;   //!< Number of used slots
+
+  private:
+    static inline size_t Hash(const DBId& key)
+    {
+      // Route node ids are node ids and thus not evenly distributed in the lower bits
+      uint64_t hash=(uint64_t)key.id ^ ((uint64_t)key.database << 56);
+
+      hash^=hash >> 33;
+      hash*=0xff51afd7ed558ccdULL;
+      hash^=hash >> 33;
+
+      return (size_t)hash;
+    }
+
+    inline size_t GetMask() const
+    {
+      return entries.size()-1;
+    }
+
+    size_t FindSlot(const DBId& key) const
+    {
+      size_t mask=GetMask();
+      size_t slot=Hash(key) & mask;
+
+      while (entries[slot].key.IsValid() &&
+             entries[slot].key!=key) {
+        slot=(slot+1) & mask;
+      }
+
+      return slot;
+    }
+
+    void Rehash(size_t slotCount)
+    {
+      std::vector<Entry> oldEntries(slotCount);
+
+      entries.swap(oldEntries);
+
+      for (auto& entry : oldEntries) {
+        if (entry.key.IsValid()) {
+          Entry& target=entries[FindSlot(entry.key)];
+
+          target.key=entry.key;
+          target.value=std::move(entry.value);
+        }
+      }
+    }
+
+  public:
+    DBIdHashMap()
+    : count(0)
+    {
+      // no code
+    }
+
+    inline size_t size() const
+    {
+      return count;
+    }
+
+    inline bool empty() const
+    {
+      return count==0;
+    }
+
+    /**
+     * Remove all values. The internal array is kept, so the map can be
+     * refilled without allocating memory.
+     */
+    void clear()
+    {
+      if (count>0) {
+        for (auto& entry : entries) {
+          entry=Entry();
+        }
+      }
+
+      count=0;
+    }
+
+    /**
+     * Make sure that the given number of values can be stored without
+     * growing the internal array
+     */
+    void reserve(size_t size)
+    {
+      size_t slotCount=16;
+
+      // Keep the load factor below 3/4
+      while (slotCount*3<size*4) {
+        slotCount*=2;
+      }
+
+      if (slotCount>entries.size()) {
+        Rehash(slotCount);
+      }
+    }
+
+    inline const_iterator begin() const
+    {
+      return const_iterator(entries.data(),
+                            entries.data()+entries.size());
+    }
+
+    inline const_iterator end() const
+    {
+      return const_iterator(entries.data()+entries.size(),
+                            entries.data()+entries.size());
+    }
+
+    inline bool Contains(const DBId& key) const
+    {
+      return Find(key)!=nullptr;
+    }
+
+    /**
+     * Return the value for the given key or nullptr, if there is no entry
+     * for the key
+     */
+    const V* Find(const DBId& key) const
+    {
+      if (entries.empty()) {
+        return nullptr;
+      }
+
+      const Entry& entry=entries[FindSlot(key)];
+
+      return entry.key.IsValid() ? &entry.value : nullptr;
+    }
+
+    V* Find(const DBId& key)
+    {
+      if (entries.empty()) {
+        return nullptr;
+      }
+
+      Entry& entry=entries[FindSlot(key)];
+
+      return entry.key.IsValid() ? &entry.value : nullptr;
+    }
+
+    /**
+     * Return the value for the given key. If there is no entry for the key,
+     * a default constructed value is inserted.
+     */
+    V& operator[](const DBId& key)
+    {
+      assert(key.IsValid());
+
+      if ((count+1)*4>entries.size()*3) {
+        reserve(count+1);
+      }
+
+      Entry& entry=entries[FindSlot(key)];
+
+      if (!entry.key.IsValid()) {
+        entry.key=key;
+        entry.value=V();
+        count++;
+      }
+
+      return entry.value;
+    }
+
+    /**
+     * Insert the value for the given key. If there is already an entry
+     * for the key, the existing value is kept and false is returned.
+     */
+    bool Insert(const DBId& key,
+                const V& value)
+    {
+      size_t oldCount=count;
+      V&     entry=(*this)[key];
+
+      if (count==oldCount) {
+        return false;
+      }
+
+      entry=value;
+
+      return true;
+    }
+
+    /**
+     * Remove the entry for the given key. Returns false, if there was no
+     * entry for the key.
+     */
+    bool Erase(const DBId& key)
+    {
+      if (entries.empty()) {
+        return false;
+      }
+
+      size_t mask=GetMask();
+      size_t slot=FindSlot(key);
+
+      if (!entries[slot].key.IsValid()) {
+        return false;
+      }
+
+      // Move following entries of the same probe sequence into the gap
+      size_t next=slot;
+
+      while (true) {
+        next=(next+1) & mask;
+
+        if (!entries[next].key.IsValid()) {
+          break;
+        }
+
+        size_t home=Hash(entries[next].key) & mask;
+
+        // Skip the entry, if its home slot lies cyclically in (slot,next]
+        if (slot<=next ? (slot<home && home<=next) : (slot<home || home<=next)) {
+          continue;
+        }
+
+        entries[slot].key=entries[next].key;
+        entries[slot].value=std::move(entries[next].value);
+        slot=next;
+      }
+
+      entries[slot].key=DBId();
+      entries[slot].value=V();
+      count--;
+
+      return true;
+    }
+  };
+}
+
+#endif
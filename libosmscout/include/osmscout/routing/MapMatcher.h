@@ -0,0 +1,227 @@
+#ifndef OSMSCOUT_ROUTING_MAPMATCHER_H
+#define OSMSCOUT_ROUTING_MAPMATCHER_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include <osmscout/CoreImportExport.h>
+
+#include <osmscout/Database.h>
+#include <osmscout/GeoCoord.h>
+
+#include <osmscout/routing/RouteData.h>
+#include <osmscout/routing/RouteSegmentIndex.h>
+#include <osmscout/routing/RoutingProfile.h>
+#include <osmscout/routing/RoutingService.h>
+#include <osmscout/routing/SimpleRoutingService.h>
+
+#include <osmscout/util/Distance.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * Parameter of the map matching
+   */
+  class OSMSCOUT_API MapMatcherParameter CLASS_FINAL
+  {
+  private:
+    Distance searchRadius;     //!< Maximum distance of a candidate from its point
+    size_t   candidateCount;   //!< Maximum number of candidates per point
+    Distance minPointDistance; //!< Points closer than this to the previous used point are ignored
+    double   sigma;            //!< Standard deviation of the GPS error in meter
+    double   beta;             //!< Expected difference between route and great circle distance in meter
+    size_t   windowSize;       //!< Maximum number of points held before a part of the trace is decided
+    size_t   maxCachedNodes;   //!< Maximum number of route nodes cached for the routing between candidates
+
+  public:
+    MapMatcherParameter();
+
+    void SetSearchRadius(const Distance& searchRadius);
+    void SetCandidateCount(size_t candidateCount);
+    void SetMinPointDistance(const Distance& minPointDistance);
+    void SetSigma(double sigma);
+    void SetBeta(double beta);
+    void SetWindowSize(size_t windowSize);
+    void SetMaxCachedNodes(size_t maxCachedNodes);
+
+    inline Distance GetSearchRadius() const
+    {
+      return searchRadius;
+    }
+
+    inline size_t GetCandidateCount() const
+    {
+      return candidateCount;
+    }
+
+    inline Distance GetMinPointDistance() const
+    {
+      return minPointDistance;
+    }
+
+    inline double GetSigma() const
+    {
+      return sigma;
+    }
+
+    inline double GetBeta() const
+    {
+      return beta;
+    }
+
+    inline size_t GetWindowSize() const
+    {
+      return windowSize;
+    }
+
+    inline size_t GetMaxCachedNodes() const
+    {
+      return maxCachedNodes;
+    }
+  };
+
+  /**
+   * \ingroup Routing
+   *
+   * Matches a trace of GPS positions (for example the points of a gpx::TrackSegment)
+   * onto the routable ways of a SimpleRoutingService using a hidden Markov model:
+   *
+   * - The states of each point are the closest route segments
+   *   (SimpleRoutingService::GetClosestRouteSegments()), the emission probability
+   *   follows a normal distribution of the distance between point and segment.
+   * - The transition probability between the states of consecutive points decreases
+   *   exponentially with the difference between the routing distance of the states
+   *   and the great circle distance of the points. Routing distances are calculated
+   *   as matrix between all states of consecutive points, route nodes loaded for
+   *   one point are reused for the following points.
+   * - The most probable sequence of states is calculated by the Viterbi algorithm.
+   *
+   * Points are passed one after the other and only a window of points is held in
+   * memory. As soon as all possible sequences of the window share the same
+   * states for the oldest points, these points are decided. If the window is full
+   * before, the most probable sequence is decided. Decided points are connected
+   * by routes and appended to the resulting RouteData, which can be taken at any time.
+   * If no state of a point can be reached from the states of the previous point,
+   * the trace is split at this point.
+   *
+   * The resulting RouteData can be passed to RoutingService::TransformRouteDataToRouteDescription()
+   * and RoutePostprocessor like the result of a route calculation.
+   *
+   * Methods are NOT thread-safe, use one instance per trace. Multiple instances
+   * can share the same routing service.
+   */
+  class OSMSCOUT_API MapMatcher CLASS_FINAL
+  {
+  private:
+    /**
+     * A possible position of a point on the road network
+     */
+    struct Candidate
+    {
+      RouteSegmentMatch match;       //!< The segment and the projection of the point
+      RoutePosition     position;    //!< The position for routing
+      double            probability; //!< Logarithm of the probability of the most probable sequence ending here
+      size_t            previous;    //!< Index of the candidate of the previous point in this sequence
+    };
+
+    /**
+     * A point of the trace together with its candidates
+     */
+    struct Step
+    {
+      GeoCoord               coord;
+      std::vector<Candidate> candidates;
+    };
+
+  private:
+    DatabaseRef                           database;         //!< Database for loading ways
+    SimpleRoutingService&                 router;           //!< Router for candidate search and routing
+    RoutingProfile&                       profile;          //!< Profile of the vehicle
+    MapMatcherParameter                   parameter;        //!< Parameter of the matching
+    RoutingParameter                      routingParameter; //!< Parameter for route and matrix calculations
+    RouteNodeCache                        routeNodeCache;   //!< Route nodes loaded by matrix calculations
+    std::unordered_map<FileOffset,WayRef> wayCache;         //!< Ways loaded for distances along a way
+
+    std::deque<Step>                      window;           //!< Points not decided yet
+    bool                                  hasLastPosition;  //!< true, if lastPosition is valid
+    RoutePosition                         lastPosition;     //!< Position of the last decided point
+    RouteData                             route;            //!< Route of the decided points not yet taken
+    bool                                  pendingTarget;    //!< true, if the last entry of route is continued by the next part
+    size_t                                pointCount;       //!< Number of points passed
+    size_t                                matchedCount;     //!< Number of points with candidates
+    size_t                                breakCount;       //!< Number of splits of the trace
+
+  private:
+    void GetCandidates(const GeoCoord& coord,
+                       std::vector<Candidate>& candidates);
+
+    bool GetSameWayDistance(const Candidate& from,
+                            const Candidate& to,
+                            Distance& distance);
+
+    bool CalculateTransitions(const Step& previous,
+                              Step& current);
+
+    bool AppendRoute(const RoutePosition& position);
+
+    bool Decide(size_t count,
+                size_t candidate);
+    bool DecideConverged();
+    bool DecideAll();
+
+  public:
+    MapMatcher(const DatabaseRef& database,
+               SimpleRoutingService& router,
+               RoutingProfile& profile,
+               const MapMatcherParameter& parameter,
+               const RoutingParameter& routingParameter);
+
+    bool AddPoint(const GeoCoord& coord);
+    bool Finish();
+
+    RouteData TakeRoute();
+
+    RoutingResult Match(const std::vector<GeoCoord>& coords);
+
+    inline size_t GetPointCount() const
+    {
+      return pointCount;
+    }
+
+    inline size_t GetMatchedCount() const
+    {
+      return matchedCount;
+    }
+
+    inline size_t GetBreakCount() const
+    {
+      return breakCount;
+    }
+  };
+}
+
+#endif
@@ -112,6 +112,9 @@ namespace osmscout {
                                    DatabaseId database,
                                    Id id) override;
 
+    bool GetJunctionObjects(const DBId& id,
+                            std::vector<ObjectFileRef>& objects) override;
+
     bool CanUse(const MultiDBRoutingState& state,
                 DatabaseId databaseId,
                 const RouteNode& routeNode,
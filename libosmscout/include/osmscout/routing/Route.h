@@ -674,6 +674,8 @@ namespace osmscout {
 
       void AddDescription(const char* name,
                           const DescriptionRef& description);
+      void AddDescriptions(const Node& node,
+                           size_t offset);
     };
 
   private:
@@ -0,0 +1,213 @@
+#ifndef OSMSCOUT_ROUTING_ROUTEGRAPH_H
+#define OSMSCOUT_ROUTING_ROUTEGRAPH_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <osmscout/CoreImportExport.h>
+
+#include <osmscout/GeoCoord.h>
+#include <osmscout/ObjectRef.h>
+#include <osmscout/OSMScoutTypes.h>
+
+#include <osmscout/routing/RouteNode.h>
+#include <osmscout/routing/RoutingProfile.h>
+
+#include <osmscout/util/Distance.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * The complete routing graph of a database in a compact flat (compressed
+   * sparse row) in-memory layout.
+   *
+   * Nodes are addressed by their index. All attributes of nodes and paths
+   * are held in separate contiguous arrays. The paths, objects and excludes
+   * of node i are stored in the range [start[i],start[i+1]) of the
+   * corresponding arrays. The target of a path is stored as node index, so
+   * walking the graph does not require any lookup or allocation.
+   *
+   * The graph is filled by calling AddNode() for every route node followed
+   * by a call to Finish().
+   */
+  class OSMSCOUT_API RouteGraph CLASS_FINAL
+  {
+  public:
+    static const uint32_t invalidIndex=std::numeric_limits<uint32_t>::max();
+
+  private:
+    // Nodes
+    std::vector<Id>            nodeIds;              //!< Id of each node
+    std::vector<double>        nodeLats;             //!< Latitude of each node
+    std::vector<double>        nodeLons;             //!< Longitude of each node
+    std::vector<uint32_t>      pathStart;            //!< Index of the first path of each node
+    std::vector<uint32_t>      objectStart;          //!< Index of the first object of each node
+    std::vector<uint32_t>      excludeStart;         //!< Index of the first exclude of each node
+
+    // Paths
+    std::vector<uint32_t>      pathTargets;          //!< Index of the target node of each path
+    std::vector<Distance>      pathDistances;        //!< Distance of each path
+    std::vector<uint8_t>       pathObjectIndexes;    //!< Index of the object of each path relative to the node
+    std::vector<uint8_t>       pathFlags;            //!< Flags of each path (see RouteNode)
+
+    // Objects
+    std::vector<ObjectFileRef> objects;              //!< Objects of all nodes
+    std::vector<uint16_t>      objectVariantIndexes; //!< Object variant index of each object
+
+    // Excludes
+    std::vector<ObjectFileRef> excludeSources;       //!< Source object of each exclude
+    std::vector<uint8_t>       excludeTargetIndexes; //!< Index of the target object of each exclude relative to the node
+
+    // Lookup of nodes by id
+    std::vector<Id>            sortedIds;            //!< Ids of all nodes in ascending order
+    std::vector<uint32_t>      sortedIndexes;        //!< Node index for each entry in sortedIds
+
+    std::vector<Id>            pathTargetIds;        //!< Target ids of the paths until Finish() is called
+
+  public:
+    RouteGraph();
+
+    void AddNode(const RouteNode& node);
+    void Finish();
+
+    size_t GetMemoryUsage() const;
+
+    std::vector<double> CalculateCosts(const RoutingProfile& profile,
+                                       const std::vector<ObjectVariantData>& objectVariantData) const;
+
+    inline size_t GetNodeCount() const
+    {
+      return nodeIds.size();
+    }
+
+    inline size_t GetPathCount() const
+    {
+      return pathTargets.size();
+    }
+
+    /**
+     * Return the index of the node with the given id or invalidIndex,
+     * if the graph does not contain the node
+     */
+    inline uint32_t GetNodeIndex(Id id) const
+    {
+      auto entry=std::lower_bound(sortedIds.begin(),
+                                  sortedIds.end(),
+                                  id);
+
+      if (entry==sortedIds.end() ||
+          *entry!=id) {
+        return invalidIndex;
+      }
+
+      return sortedIndexes[entry-sortedIds.begin()];
+    }
+
+    inline Id GetNodeId(uint32_t node) const
+    {
+      return nodeIds[node];
+    }
+
+    inline GeoCoord GetNodeCoord(uint32_t node) const
+    {
+      return GeoCoord(nodeLats[node],
+                      nodeLons[node]);
+    }
+
+    inline uint32_t GetPathBegin(uint32_t node) const
+    {
+      return pathStart[node];
+    }
+
+    inline uint32_t GetPathEnd(uint32_t node) const
+    {
+      return pathStart[node+1];
+    }
+
+    inline uint32_t GetExcludeBegin(uint32_t node) const
+    {
+      return excludeStart[node];
+    }
+
+    inline uint32_t GetExcludeEnd(uint32_t node) const
+    {
+      return excludeStart[node+1];
+    }
+
+    /**
+     * Return the index of the target node of the path or invalidIndex, if the
+     * target node is not part of the graph
+     */
+    inline uint32_t GetPathTarget(uint32_t path) const
+    {
+      return pathTargets[path];
+    }
+
+    inline Distance GetPathDistance(uint32_t path) const
+    {
+      return pathDistances[path];
+    }
+
+    inline const ObjectFileRef& GetPathObject(uint32_t node,
+                                              uint32_t path) const
+    {
+      return objects[objectStart[node]+pathObjectIndexes[path]];
+    }
+
+    inline bool IsPathRestricted(uint32_t path,
+                                 Vehicle vehicle) const
+    {
+      switch (vehicle) {
+      case vehicleFoot:
+        return (pathFlags[path] & RouteNode::restrictedForFoot) != 0;
+      case vehicleBicycle:
+        return (pathFlags[path] & RouteNode::restrictedForBicycle) != 0;
+      case vehicleCar:
+        return (pathFlags[path] & RouteNode::restrictedForCar) != 0;
+      }
+
+      return false;
+    }
+
+    inline const ObjectFileRef& GetExcludeSource(uint32_t exclude) const
+    {
+      return excludeSources[exclude];
+    }
+
+    inline const ObjectFileRef& GetExcludeTarget(uint32_t node,
+                                                 uint32_t exclude) const
+    {
+      return objects[objectStart[node]+excludeTargetIndexes[exclude]];
+    }
+  };
+
+  typedef std::shared_ptr<RouteGraph> RouteGraphRef;
+}
+
+#endif
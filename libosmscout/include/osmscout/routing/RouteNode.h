@@ -148,6 +148,44 @@ namespace osmscout {
       this->point=point;
     }
 
+    /**
+     * Resolves the index (into objects) of the object of the target path of the
+     * given exclude. Returns false, if the exclude references a path or an object,
+     * that does not exist.
+     */
+    inline bool GetExcludeTargetObjectIndex(const Exclude& exclude,
+                                            uint8_t& objectIndex) const
+    {
+      if (exclude.targetIndex>=paths.size() ||
+          paths[exclude.targetIndex].objectIndex>=objects.size()) {
+        return false;
+      }
+
+      objectIndex=paths[exclude.targetIndex].objectIndex;
+
+      return true;
+    }
+
+    /**
+     * Returns true, if no exclude forbids to continue from the source object
+     * onto the target object at this route node.
+     */
+    inline bool IsTurnAllowed(const ObjectFileRef& source,
+                              const ObjectFileRef& target) const
+    {
+      for (const auto& exclude : excludes) {
+        uint8_t objectIndex;
+
+        if (exclude.source==source &&
+            GetExcludeTargetObjectIndex(exclude,objectIndex) &&
+            objects[objectIndex].object==target) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
     uint8_t AddObject(const ObjectFileRef& object,
                       uint16_t objectVariantIndex);
 
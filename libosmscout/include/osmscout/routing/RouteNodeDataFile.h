@@ -21,40 +21,73 @@
 */
 
 #include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include <osmscout/DataFile.h>
 #include <osmscout/Pixel.h>
 
+#include <osmscout/util/AsyncFileReader.h>
+#include <osmscout/util/MemoryBudget.h>
 #include <osmscout/util/TileId.h>
 
+#include <osmscout/routing/RouteGraph.h>
 #include <osmscout/routing/RouteNode.h>
 
 namespace osmscout {
   /**
    * \ingroup Routing
+   *
+   * Access to the route nodes of the routing graph.
+   *
+   * Route nodes are loaded per tile of the index (page) and cached. Loaded pages
+   * are never changed afterwards, so the page cache can be shared by multiple
+   * threads routing concurrently: Threads only synchronize for the lookup
+   * and insertion of pages, while searching a page needs no locking. Loading
+   * a page from disk is serialized, since all threads share one file scanner,
+   * unless SetAsyncPrefetch() is enabled: Pages are then read using an
+   * AsyncFileReader and decoded from the read buffer without locking.
+   *
+   * The page cache can be controlled by a MemoryBudget.
    */
-  class OSMSCOUT_API RouteNodeDataFile CLASS_FINAL
+  class OSMSCOUT_API RouteNodeDataFile CLASS_FINAL : public MemoryBudget::Consumer
   {
   private:
     struct IndexEntry
     {
       FileOffset fileOffset;
       uint32_t   count;
+      FileOffset size;       //!< Number of bytes of the page
     };
 
+    /**
+     * All route nodes of one tile of the index
+     */
     struct IndexPage
     {
-      FileOffset                          fileOffset;
-      uint32_t                            remaining;
       std::unordered_map<Id,RouteNodeRef> nodeMap;
+      size_t                              memory;  //!< Estimated memory of the page including its route nodes
 
-      RouteNodeRef find(FileScanner& scanner,
-                        Id id);
+      RouteNodeRef find(Id id) const;
     };
 
+    typedef std::shared_ptr<const IndexPage> IndexPageRef;
+
   private:
-    typedef Cache<Id,IndexPage> ValueCache;
+    typedef Cache<Id,IndexPageRef> ValueCache;
+
+    /**
+     * Returns the memory of a cached page as estimated while loading it
+     */
+    struct ValueSizer : public ValueCache::ValueSizer
+    {
+      size_t GetSize(const IndexPageRef& value) const override
+      {
+        return value->memory;
+      }
+    };
 
   private:
     std::string                datafile;        //!< Basename part of the data file name
@@ -65,15 +98,24 @@ namespace osmscout {
     std::map<Pixel,IndexEntry> index;
 
     mutable FileScanner        scanner;         //!< File stream to the data file
+    mutable std::mutex         scannerMutex;    //!< Mutex to secure multi-thread access to the scanner
+    size_t                     cacheSize;       //!< Maximum number of pages cached, if not limited by memory
     mutable ValueCache         cache;           //!< Cache of loaded route node pages
-    mutable std::mutex         accessMutex;     //!< Mutex to secure multi-thread access
+    mutable std::mutex         accessMutex;     //!< Mutex to secure multi-thread access to the cache
     mutable Magnification      magnification;   //!< Magnification of tiled index
+    bool                       asyncPrefetch;   //!< Read pages using an AsyncFileReader
+    std::unique_ptr<AsyncFileReader> asyncReader; //!< Reader for the pages, if asyncPrefetch is set
 
   private:
+    void ReadIndexPage(FileScanner& pageScanner,
+                       const IndexEntry& entry,
+                       IndexPage& page) const;
+    bool ReadIndexPageBuffer(const IndexEntry& entry,
+                             IndexPage& page) const;
     bool LoadIndexPage(const osmscout::Pixel& tile,
-                       ValueCache::CacheRef& cacheRef) const;
+                       IndexPageRef& page) const;
     bool GetIndexPage(const osmscout::Pixel& tile,
-                      ValueCache::CacheRef& cacheRef) const;
+                      IndexPageRef& page) const;
 
   public:
     explicit RouteNodeDataFile(const std::string& datafile,
@@ -85,6 +127,15 @@ namespace osmscout {
     bool IsOpen() const;
     bool Close();
 
+    void SetAsyncPrefetch(bool asyncPrefetch);
+    void SetCachePolicy(CachePolicy policy);
+
+    std::string GetMemoryConsumerName() const override;
+    size_t GetMemoryUsage() const override;
+    void GetCacheStatistics(size_t& hits,
+                            size_t& misses) const override;
+    void SetMemoryLimit(size_t bytes) override;
+
     Pixel GetTile(const GeoCoord& coord) const;
     bool IsCovered(const Pixel& tile) const;
 
@@ -93,6 +144,8 @@ namespace osmscout {
     bool Get(Id id,
              RouteNodeRef& node) const;
 
+    bool Load(RouteGraph& graph) const;
+
     template<typename IteratorIn>
     bool Get(IteratorIn begin, IteratorIn end, size_t size,
              std::vector<RouteNodeRef>& data) const
@@ -100,8 +153,8 @@ namespace osmscout {
       data.reserve(size);
 
       for (IteratorIn idIter=begin; idIter!=end; ++idIter) {
-        Id                   id=*idIter;
-        ValueCache::CacheRef cacheRef;
+        Id           id=*idIter;
+        IndexPageRef page;
 
         GeoCoord coord=Point::GetCoordFromId(id);
         osmscout::Pixel tile=TileId::GetTile(magnification,coord).AsPixel();
@@ -109,12 +162,11 @@ namespace osmscout {
         //std::cout << "Tile " << tile.GetDisplayText() << " " << tile.GetId() << "..." << std::endl;
 
         if (!GetIndexPage(tile,
-                          cacheRef)) {
+                          page)) {
           return false;
         }
 
-        auto node=cacheRef->value.find(scanner,
-                                       id);
+        auto node=page->find(id);
 
         if (node==nullptr) {
           return false;
@@ -131,8 +183,8 @@ namespace osmscout {
              std::unordered_map<Id,RouteNodeRef>& dataMap) const
     {
       for (IteratorIn idIter=begin; idIter!=end; ++idIter) {
-        Id                   id=*idIter;
-        ValueCache::CacheRef cacheRef;
+        Id           id=*idIter;
+        IndexPageRef page;
 
         GeoCoord coord=Point::GetCoordFromId(id);
         osmscout::Pixel tile=TileId::GetTile(magnification,coord).AsPixel();
@@ -140,12 +192,11 @@ namespace osmscout {
         //std::cout << "Tile " << tile.GetDisplayText() << " " << tile.GetId() << "..." << std::endl;
 
         if (!GetIndexPage(tile,
-                          cacheRef)) {
+                          page)) {
           return false;
         }
 
-        auto node=cacheRef->value.find(scanner,
-                                       id);
+        auto node=page->find(id);
 
         if (node==nullptr) {
           return false;
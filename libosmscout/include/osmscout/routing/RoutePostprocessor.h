@@ -23,7 +23,9 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <osmscout/CoreFeatures.h>
 
@@ -38,6 +40,8 @@
 #include <osmscout/routing/DBFileOffset.h>
 #include <osmscout/routing/RoutingProfile.h>
 
+#include <osmscout/util/WorkQueue.h>
+
 namespace osmscout {
 
   /**
@@ -65,6 +69,8 @@ namespace osmscout {
 
       virtual bool Process(const RoutePostprocessor& postprocessor,
                            RouteDescription& description) = 0;
+
+      virtual bool IsIndependent() const;
     };
 
     typedef std::shared_ptr<Postprocessor> PostprocessorRef;
@@ -83,6 +89,8 @@ namespace osmscout {
 
       bool Process(const RoutePostprocessor& postprocessor,
                    RouteDescription& description) override;
+
+      bool IsIndependent() const override;
     };
 
     /**
@@ -99,6 +107,8 @@ namespace osmscout {
 
       bool Process(const RoutePostprocessor& postprocessor,
                    RouteDescription& description) override;
+
+      bool IsIndependent() const override;
     };
 
     /**
@@ -125,6 +135,8 @@ namespace osmscout {
 
       bool Process(const RoutePostprocessor& postprocessor,
                    RouteDescription& description) override;
+
+      bool IsIndependent() const override;
     };
 
     /**
@@ -138,6 +150,8 @@ namespace osmscout {
 
       bool Process(const RoutePostprocessor& postprocessor,
                    RouteDescription& description) override;
+
+      bool IsIndependent() const override;
     };
 
     /**
@@ -158,6 +172,8 @@ namespace osmscout {
 
       bool Process(const RoutePostprocessor& postprocessor,
                    RouteDescription& description) override;
+
+      bool IsIndependent() const override;
     };
 
     /**
@@ -178,6 +194,8 @@ namespace osmscout {
 
       bool Process(const RoutePostprocessor& postprocessor,
                    RouteDescription& description) override;
+
+      bool IsIndependent() const override;
     };
 
     /**
@@ -191,6 +209,8 @@ namespace osmscout {
 
       bool Process(const RoutePostprocessor& postprocessor,
                    RouteDescription& description) override;
+
+      bool IsIndependent() const override;
     };
 
     /**
@@ -204,6 +224,8 @@ namespace osmscout {
 
       bool Process(const RoutePostprocessor& postprocessor,
                    RouteDescription& description) override;
+
+      bool IsIndependent() const override;
     };
 
     /**
@@ -217,6 +239,8 @@ namespace osmscout {
 
       bool Process(const RoutePostprocessor& postprocessor,
                    RouteDescription& description) override;
+
+      bool IsIndependent() const override;
     };
 
     /**
@@ -304,10 +328,22 @@ namespace osmscout {
 
       bool Process(const RoutePostprocessor& postprocessor,
                    RouteDescription& description) override;
+
+      bool IsIndependent() const override;
     };
 
     typedef std::shared_ptr<POIsPostprocessor> POIsPostprocessorRef;
 
+  private:
+    /**
+     * Name and reference of a motorway junction
+     */
+    struct Junction
+    {
+      std::string ref;
+      std::string name;
+    };
+
   private:
     std::vector<RoutingProfileRef>                                profiles;
     std::vector<DatabaseRef>                                      databases;
@@ -326,10 +362,25 @@ namespace osmscout {
     std::unordered_map<DatabaseId,TypeInfoSet>                    motorwayLinkTypes;
     std::unordered_map<DatabaseId,TypeInfoSet>                    junctionTypes;
 
+    std::unordered_map<DatabaseId,std::map<GeoCoord,Junction>>    junctions;   //!< Prefetched motorway junctions by coordinate
+
+    std::vector<double>                                           timings;     //!< Execution time of each postprocessor in milliseconds
+
+    WorkQueue<bool>                                               workerQueue; //!< Postprocessors to be executed concurrently
+    std::vector<std::thread>                                      workers;     //!< Worker threads, started on demand and kept until destruction
+
   private:
     bool ResolveAllAreasAndWays(const RouteDescription& description,
                                 DatabaseId dbId,
                                 Database& database);
+    bool ResolveAllJunctions(const RouteDescription& description,
+                             DatabaseId dbId,
+                             Database& database);
+    bool ExecutePostprocessors(RouteDescription& description,
+                               const std::vector<PostprocessorRef>& processors,
+                               size_t start,
+                               size_t end);
+    void WorkerLoop();
     void Cleanup();
 
   private:
@@ -351,8 +402,8 @@ namespace osmscout {
 
     bool LoadJunction(DatabaseId database,
                       GeoCoord coord,
-                      std::string junctionRef,
-                      std::string junctionName) const;
+                      std::string& junctionRef,
+                      std::string& junctionName) const;
 
     bool IsMotorwayLink(const RouteDescription::Node& node) const;
     bool IsMotorway(const RouteDescription::Node& node) const;
@@ -402,6 +453,7 @@ namespace osmscout {
     friend Postprocessor;
 
     RoutePostprocessor();
+    ~RoutePostprocessor();
 
     bool PostprocessRouteDescription(RouteDescription& description,
                                      const std::vector<RoutingProfileRef>& profiles,
@@ -410,6 +462,16 @@ namespace osmscout {
                                      const std::set<std::string>& motorwayTypeNames=std::set<std::string>(),
                                      const std::set<std::string>& motorwayLinkTypeNames=std::set<std::string>(),
                                      const std::set<std::string>& junctionTypeNames=std::set<std::string>());
+
+    /**
+     * Return the execution time of each postprocessor of the last
+     * PostprocessRouteDescription() call in milliseconds, in the order of the
+     * postprocessors
+     */
+    inline const std::vector<double>& GetTimings() const
+    {
+      return timings;
+    }
   };
 }
 
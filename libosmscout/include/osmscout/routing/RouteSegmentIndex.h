@@ -0,0 +1,204 @@
+#ifndef OSMSCOUT_ROUTING_ROUTESEGMENTINDEX_H
+#define OSMSCOUT_ROUTING_ROUTESEGMENTINDEX_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <osmscout/CoreImportExport.h>
+
+#include <osmscout/GeoCoord.h>
+#include <osmscout/ObjectRef.h>
+#include <osmscout/OSMScoutTypes.h>
+
+#include <osmscout/util/Distance.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Routing
+   *
+   * A segment of a routable way between two consecutive nodes of the way together
+   * with the route nodes enclosing it.
+   */
+  struct OSMSCOUT_API RouteSegment
+  {
+    GeoCoord   from;               //!< Coordinate of the first node of the segment
+    GeoCoord   to;                 //!< Coordinate of the second node of the segment
+    FileOffset way;                //!< File offset of the way
+    uint32_t   nodeIndex;          //!< Index of the first node of the segment within the way
+    uint16_t   typeIndex;          //!< Index of the type of the way
+    uint8_t    access;             //!< Access of the way (see AccessFeatureValue)
+    Id         prevRouteNode;      //!< Id of the last route node at or before the first node, 0 if there is none
+    uint32_t   prevRouteNodeIndex; //!< Index of prevRouteNode within the way
+    Id         nextRouteNode;      //!< Id of the first route node at or after the second node, 0 if there is none
+    uint32_t   nextRouteNodeIndex; //!< Index of nextRouteNode within the way
+
+    //! Number of bytes of a segment in the file
+    static const size_t recordSize=2*coordByteSize+8+4+2+1+2*(8+4);
+
+    RouteSegment();
+
+    inline ObjectFileRef GetObjectFileRef() const
+    {
+      return ObjectFileRef(way,refWay);
+    }
+
+    void Read(FileScanner& scanner);
+    void Write(FileWriter& writer) const;
+  };
+
+  /**
+   * \ingroup Routing
+   *
+   * A segment close to a given coordinate
+   */
+  struct OSMSCOUT_API RouteSegmentMatch
+  {
+    RouteSegment segment;    //!< The segment
+    GeoCoord     projection; //!< The point of the segment closest to the coordinate
+    double       fraction;   //!< Position of the projection on the segment, 0.0 at the first and 1.0 at the second node
+    Distance     distance;   //!< Distance between the coordinate and the projection
+
+    /**
+     * Return the index of the way node of the segment closest to the projection
+     */
+    inline uint32_t GetClosestNodeIndex() const
+    {
+      return fraction<0.5 ? segment.nodeIndex : segment.nodeIndex+1;
+    }
+  };
+
+  /**
+   * \ingroup Routing
+   *
+   * Spatial index of all routable way segments of a router for fast lookup of the
+   * segments closest to a coordinate (snapping of positions to the road network).
+   *
+   * The index is a packed R-tree: The segments are sorted by the Hilbert value of
+   * their center, groups of nodeSize consecutive segments form the leaves and groups of
+   * nodeSize consecutive nodes form the next level up to the single root node.
+   * Each node stores its bounding box and the combined access of all its
+   * segments, so subtrees that cannot be used by the requested vehicle are skipped.
+   *
+   * The bounding boxes are held in memory, the segments are read on demand from
+   * the file. Lookups are thread-safe.
+   *
+   * The index only contains the ways routable by the vehicles of the router it was
+   * generated for (see GetVehicleMask()). It is generated by the import
+   * (RouteSegmentIndexGenerator) and does not exist in databases imported before, in
+   * which case RoutingDatabase does not offer it.
+   */
+  class OSMSCOUT_API RouteSegmentIndex CLASS_FINAL
+  {
+  public:
+    //! Version of the file format, the index is ignored for other versions
+    static const uint32_t fileFormatVersion=1;
+    //! Number of children of each node of the tree
+    static const uint32_t nodeSize=16;
+
+    /**
+     * Bounding box and access of a node of the tree. Coordinates are stored
+     * in the encoding of the data files (see latConversionFactor and lonConversionFactor).
+     */
+    struct OSMSCOUT_API Node
+    {
+      uint32_t minLat;
+      uint32_t minLon;
+      uint32_t maxLat;
+      uint32_t maxLon;
+      uint8_t  access; //!< Combined access of all segments below the node
+
+      //! Number of bytes of a node in the file
+      static const size_t recordSize=4*4+1;
+
+      void Read(FileScanner& scanner);
+      void Write(FileWriter& writer) const;
+    };
+
+    //! Filter for segments, only segments for which the filter returns true are returned
+    typedef std::function<bool(const RouteSegment&)> SegmentFilter;
+
+  private:
+    std::string                    filename;       //!< Name of the index file
+    std::vector<std::vector<Node>> levels;         //!< Nodes of the tree, level 0 are the leaves, the last level is the root
+    VehicleMask                    vehicleMask;    //!< Vehicles the segments were selected for
+    uint32_t                       segmentCount;   //!< Number of segments
+    FileOffset                     segmentOffset;  //!< File offset of the first segment
+
+    mutable FileScanner            scanner;        //!< File stream to the index file
+    mutable std::mutex             scannerMutex;   //!< Mutex to secure multi-thread access to the scanner
+
+  private:
+    bool ReadSegments(uint32_t leaf,
+                      std::vector<RouteSegment>& segments) const;
+
+  public:
+    RouteSegmentIndex();
+    ~RouteSegmentIndex();
+
+    bool Open(const std::string& filename,
+              bool memoryMappedData);
+    bool IsOpen() const;
+    bool Close();
+
+    inline size_t GetSegmentCount() const
+    {
+      return segmentCount;
+    }
+
+    inline VehicleMask GetVehicleMask() const
+    {
+      return vehicleMask;
+    }
+
+    /**
+     * Return true, if the index contains all segments routable by the given vehicle
+     */
+    inline bool SupportsVehicle(Vehicle vehicle) const
+    {
+      return (vehicleMask & vehicle)!=0;
+    }
+
+    bool GetClosestSegments(const GeoCoord& coord,
+                            Vehicle vehicle,
+                            const Distance& maxDistance,
+                            size_t maxCount,
+                            const SegmentFilter& filter,
+                            std::vector<RouteSegmentMatch>& matches) const;
+
+    static void Project(const GeoCoord& coord,
+                        const RouteSegment& segment,
+                        RouteSegmentMatch& match);
+  };
+
+  typedef std::shared_ptr<RouteSegmentIndex> RouteSegmentIndexRef;
+}
+
+#endif
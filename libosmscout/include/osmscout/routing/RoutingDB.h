@@ -21,14 +21,18 @@
 */
 
 #include <memory>
+#include <mutex>
 
 #include <osmscout/Database.h>
 #include <osmscout/DataFile.h>
 #include <osmscout/Intersection.h>
 #include <osmscout/ObjectVariantDataFile.h>
 
+#include <osmscout/routing/ContractionHierarchy.h>
+#include <osmscout/routing/RouteGraph.h>
 #include <osmscout/routing/RouteNode.h>
 #include <osmscout/routing/RouteNodeDataFile.h>
+#include <osmscout/routing/RouteSegmentIndex.h>
 
 namespace osmscout {
 
@@ -36,6 +40,9 @@ namespace osmscout {
    * \ingroup Routing
    *
    * Encapsulation of the routing relevant data files, similar to Database.
+   *
+   * After Open() all data access methods are thread-safe, so one instance (and
+   * its caches) can be shared by multiple threads routing concurrently.
    */
   class RoutingDatabase CLASS_FINAL
   {
@@ -44,14 +51,28 @@ namespace osmscout {
     std::string                      path;
     RouteNodeDataFile                routeNodeDataFile;
     IndexedDataFile<Id,Intersection> junctionDataFile;      //!< Cached access to the 'junctions.dat' file
+    std::mutex                       junctionMutex;         //!< Mutex to secure multi-thread access to the junction data file
     ObjectVariantDataFile            objectVariantDataFile;
+    std::vector<ContractionHierarchyRef> contractionHierarchies; //!< Optional contraction hierarchies, one per vehicle
+    RouteGraphRef                    routeGraph;            //!< Optional flat in-memory copy of the routing graph
+    RouteSegmentIndexRef             segmentIndex;          //!< Optional spatial index of the routable way segments
+    MemoryBudgetRef                  memoryBudget;          //!< Memory budget of the database, if configured
+
+  private:
+    bool OpenJunctionDataFile();
+    bool CloseJunctionDataFile();
+    bool LoadContractionHierarchies();
+    void LoadSegmentIndex(bool memoryMappedData);
 
   public:
     RoutingDatabase();
+    ~RoutingDatabase();
 
     bool Open(const DatabaseRef& database);
     void Close();
 
+    bool LoadRouteGraph();
+
     inline bool GetRouteNode(const Id& id,
                              RouteNodeRef& node)
     {
@@ -82,11 +103,46 @@ namespace osmscout {
     bool GetJunctions(const std::set<Id>& ids,
                       std::vector<JunctionRef>& junctions);
 
+    bool GetJunction(Id id,
+                     JunctionRef& junction);
+
     inline const std::vector<ObjectVariantData>& GetObjectVariantData() const
     {
       return objectVariantDataFile.GetData();
     }
 
+    /**
+     * Return the contraction hierarchy for the given vehicle or nullptr,
+     * if the database does not contain one
+     */
+    inline ContractionHierarchyRef GetContractionHierarchy(Vehicle vehicle) const
+    {
+      for (const auto& hierarchy : contractionHierarchies) {
+        if (hierarchy->GetVehicle()==vehicle) {
+          return hierarchy;
+        }
+      }
+
+      return nullptr;
+    }
+
+    /**
+     * Return the flat in-memory routing graph or nullptr, if it has not been loaded
+     */
+    inline const RouteGraphRef& GetRouteGraph() const
+    {
+      return routeGraph;
+    }
+
+    /**
+     * Return the spatial index of the routable way segments or nullptr, if the
+     * database does not contain one
+     */
+    inline RouteSegmentIndexRef GetSegmentIndex() const
+    {
+      return segmentIndex;
+    }
+
     inline bool ContainsNode(const Id id) const
     {
       RouteNodeRef node;
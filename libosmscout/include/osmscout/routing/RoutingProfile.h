@@ -22,6 +22,7 @@
 
 #include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <osmscout/OSMScoutTypes.h>
@@ -51,11 +52,15 @@ namespace osmscout {
     virtual Distance GetCostLimitDistance() const = 0;
     virtual double GetCostLimitFactor() const = 0;
 
+    virtual std::string GetCostsKey() const;
+
     virtual bool CanUse(const RouteNode& currentNode,
                         const std::vector<ObjectVariantData>& objectVariantData,
                         size_t pathIndex) const = 0;
     virtual bool CanUse(const Area& area) const = 0;
     virtual bool CanUse(const Way& way) const = 0;
+    virtual bool CanUse(const TypeInfo& type,
+                        const AccessFeatureValue& access) const = 0;
     virtual bool CanUseForward(const Way& way) const = 0;
     virtual bool CanUseBackward(const Way& way) const = 0;
 
@@ -68,6 +73,9 @@ namespace osmscout {
                             const Distance &distance) const = 0;
     virtual double GetCosts(const Distance &distance) const = 0;
 
+    virtual double GetTime(const RouteNode& currentNode,
+                           const std::vector<ObjectVariantData>& objectVariantData,
+                           size_t pathIndex) const;
     virtual double GetTime(const Area& area,
                            const Distance &distance) const = 0;
     virtual double GetTime(const Way& way,
@@ -96,6 +104,9 @@ namespace osmscout {
     double                     maxSpeed;
     double                     vehicleMaxSpeed;
 
+  protected:
+    std::string BuildCostsKey(const std::string& costFunction) const;
+
   public:
     AbstractRoutingProfile(const TypeConfigRef& typeConfig);
 
@@ -115,6 +126,19 @@ namespace osmscout {
       return vehicle;
     }
 
+    inline double GetVehicleMaxSpeed() const
+    {
+      return vehicleMaxSpeed;
+    }
+
+    /**
+     * Return the speed for each type index, 0.0 if the type cannot be used
+     */
+    inline const std::vector<double>& GetSpeeds() const
+    {
+      return speeds;
+    }
+
     void SetCostLimitDistance(const Distance &costLimitDistance);
 
     inline Distance GetCostLimitDistance() const
@@ -136,9 +160,32 @@ namespace osmscout {
                 size_t pathIndex) const;
     bool CanUse(const Area& area) const;
     bool CanUse(const Way& way) const;
+    bool CanUse(const TypeInfo& type,
+                const AccessFeatureValue& access) const;
     bool CanUseForward(const Way& way) const;
     bool CanUseBackward(const Way& way) const;
 
+    inline double GetTime(const RouteNode& currentNode,
+                          const std::vector<ObjectVariantData>& objectVariantData,
+                          size_t pathIndex) const
+    {
+      double speed;
+      size_t index=currentNode.paths[pathIndex].objectIndex;
+
+      if (objectVariantData[currentNode.objects[index].objectVariantIndex].maxSpeed>0) {
+        speed=objectVariantData[currentNode.objects[index].objectVariantIndex].maxSpeed;
+      }
+      else {
+        TypeInfoRef type=objectVariantData[currentNode.objects[index].objectVariantIndex].type;
+
+        speed=speeds[type->GetIndex()];
+      }
+
+      speed=std::min(vehicleMaxSpeed,speed);
+
+      return currentNode.paths[pathIndex].distance.As<Kilometer>()/speed;
+    }
+
     inline double GetTime(const Area& area,
                           const Distance &distance) const
     {
@@ -179,6 +226,8 @@ namespace osmscout {
   public:
     ShortestPathRoutingProfile(const TypeConfigRef& typeConfig);
 
+    std::string GetCostsKey() const override;
+
     inline double GetCosts(const RouteNode& currentNode,
                            const std::vector<ObjectVariantData>& /*objectVariantData*/,
                            size_t pathIndex) const
@@ -216,25 +265,15 @@ namespace osmscout {
   public:
     FastestPathRoutingProfile(const TypeConfigRef& typeConfig);
 
+    std::string GetCostsKey() const override;
+
     inline double GetCosts(const RouteNode& currentNode,
                            const std::vector<ObjectVariantData>& objectVariantData,
                            size_t pathIndex) const
     {
-      double speed;
-      size_t index=currentNode.paths[pathIndex].objectIndex;
-
-      if (objectVariantData[currentNode.objects[index].objectVariantIndex].maxSpeed>0) {
-        speed=objectVariantData[currentNode.objects[index].objectVariantIndex].maxSpeed;
-      }
-      else {
-        TypeInfoRef type=objectVariantData[currentNode.objects[index].objectVariantIndex].type;
-
-        speed=speeds[type->GetIndex()];
-      }
-
-      speed=std::min(vehicleMaxSpeed,speed);
-
-      return currentNode.paths[pathIndex].distance.As<Kilometer>()/speed;
+      return GetTime(currentNode,
+                     objectVariantData,
+                     pathIndex);
     }
 
     inline double GetCosts(const Area& area,
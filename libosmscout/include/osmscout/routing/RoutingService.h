@@ -22,11 +22,13 @@
 
 #include <atomic>
 #include <functional>
+#include <limits>
 #include <list>
 #include <memory>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <osmscout/CoreFeatures.h>
 
@@ -48,6 +50,7 @@
 #include <osmscout/routing/RouteNodeDataFile.h>
 #include <osmscout/routing/RoutingProfile.h>
 #include <osmscout/routing/DBFileOffset.h>
+#include <osmscout/routing/DBIdHashMap.h>
 
 #include <osmscout/util/Breaker.h>
 #include <osmscout/util/Cache.h>
@@ -103,18 +106,36 @@ namespace osmscout {
    *
    * The following groups attributes are currently available:
    * - Switch for showing debug information
+   * - Switch for loading the complete routing graph into memory
    */
   class OSMSCOUT_API RouterParameter CLASS_FINAL
   {
   private:
     bool          debugPerformance;
+    bool          flatRouteGraph;
 
   public:
     RouterParameter();
 
     void SetDebugPerformance(bool debug);
+    void SetFlatRouteGraph(bool flatRouteGraph);
 
     bool IsDebugPerformance() const;
+    bool IsFlatRouteGraph() const;
+  };
+
+  /**
+   * \ingroup Routing
+   *
+   * A route node reachable from the start position of an isochrone calculation
+   */
+  struct OSMSCOUT_API ReachableNode
+  {
+    Id       id;       //!< Id of the route node
+    GeoCoord coord;    //!< Coordinate of the route node
+    double   costs;    //!< Costs to reach the route node
+    double   time;     //!< Time in hours to reach the route node
+    Distance distance; //!< Distance travelled to reach the route node
   };
 
   /**
@@ -141,6 +162,15 @@ namespace osmscout {
      */
     virtual void Progress(const Distance &currentMaxDistance,
                           const Distance &overallDistance) = 0;
+
+    /**
+     * Called by isochrone calculations with the route nodes reached since
+     * the last call, in the order of increasing costs. Together the calls
+     * describe the growing frontier of the reachable area.
+     *
+     * The default implementation does nothing.
+     */
+    virtual void Reached(const std::vector<ReachableNode>& nodes);
   };
 
   /**
@@ -159,10 +189,16 @@ namespace osmscout {
   private:
     BreakerRef         breaker;
     RoutingProgressRef progress;
+    bool               bidirectional; //!< Search from start and target at the same time
+    size_t             threadCount;   //!< Number of threads used by calculations that can run in parallel
 
   public:
+    RoutingParameter();
+
     void SetBreaker(const BreakerRef& breaker);
     void SetProgress(const RoutingProgressRef& progress);
+    void SetBidirectional(bool bidirectional);
+    void SetThreadCount(size_t threadCount);
 
     inline BreakerRef GetBreaker() const
     {
@@ -173,6 +209,16 @@ namespace osmscout {
     {
       return progress;
     }
+
+    inline bool IsBidirectional() const
+    {
+      return bidirectional;
+    }
+
+    inline size_t GetThreadCount() const
+    {
+      return threadCount;
+    }
   };
 
   /**
@@ -228,6 +274,168 @@ namespace osmscout {
     }
   };
 
+  /**
+   * Result of a many-to-many calculation. Costs, times and distances are stored
+   * in dense row major arrays with one row per source and one column per target,
+   * so they can be handed over to other code without copying.
+   *
+   * Unreachable targets have infinite costs, times and distances.
+   */
+  class OSMSCOUT_API RoutingMatrix CLASS_FINAL
+  {
+  private:
+    size_t              sourceCount;
+    size_t              targetCount;
+    std::vector<double> costs;     //!< Costs as defined by the routing profile
+    std::vector<double> times;     //!< Travel times in hours
+    std::vector<double> distances; //!< Travel distances in kilometers
+
+  public:
+    RoutingMatrix();
+    RoutingMatrix(size_t sourceCount,
+                  size_t targetCount);
+
+    void Set(size_t source,
+             size_t target,
+             double costs,
+             double time,
+             const Distance& distance);
+
+    inline size_t GetSourceCount() const
+    {
+      return sourceCount;
+    }
+
+    inline size_t GetTargetCount() const
+    {
+      return targetCount;
+    }
+
+    inline bool IsReachable(size_t source,
+                            size_t target) const
+    {
+      return costs[source*targetCount+target]!=std::numeric_limits<double>::infinity();
+    }
+
+    inline double GetCosts(size_t source,
+                           size_t target) const
+    {
+      return costs[source*targetCount+target];
+    }
+
+    inline double GetTime(size_t source,
+                          size_t target) const
+    {
+      return times[source*targetCount+target];
+    }
+
+    inline Distance GetDistance(size_t source,
+                                size_t target) const
+    {
+      return Distance::Of<Kilometer>(distances[source*targetCount+target]);
+    }
+
+    inline const std::vector<double>& GetCosts() const
+    {
+      return costs;
+    }
+
+    inline const std::vector<double>& GetTimes() const
+    {
+      return times;
+    }
+
+    inline const std::vector<double>& GetDistances() const
+    {
+      return distances;
+    }
+  };
+
+  /**
+   * \ingroup Routing
+   *
+   * Parameter object for isochrone calculations. At least one of the
+   * budgets (time or distance) must be set.
+   */
+  class OSMSCOUT_API IsochroneParameter CLASS_FINAL
+  {
+  private:
+    double   maxTime;         //!< Maximum travel time in hours, 0.0 for no limit
+    Distance maxDistance;     //!< Maximum travel distance, 0 for no limit
+    Distance polygonCellSize; //!< Cell size for the rasterized polygon, 0 for no polygon
+    size_t   frontierSize;    //!< Number of route nodes passed to RoutingProgress::Reached() at once, 0 for no streaming
+
+  public:
+    IsochroneParameter();
+
+    void SetMaxTime(double maxTime);
+    void SetMaxDistance(const Distance& maxDistance);
+    void SetPolygonCellSize(const Distance& polygonCellSize);
+    void SetFrontierSize(size_t frontierSize);
+
+    inline double GetMaxTime() const
+    {
+      return maxTime;
+    }
+
+    inline Distance GetMaxDistance() const
+    {
+      return maxDistance;
+    }
+
+    inline Distance GetPolygonCellSize() const
+    {
+      return polygonCellSize;
+    }
+
+    inline size_t GetFrontierSize() const
+    {
+      return frontierSize;
+    }
+  };
+
+  /**
+   * \ingroup Routing
+   *
+   * Result of an isochrone calculation: All route nodes reachable within the
+   * given budget in the order of increasing costs and, if requested, the outline
+   * of the reachable area.
+   */
+  class OSMSCOUT_API IsochroneResult CLASS_FINAL
+  {
+  private:
+    std::vector<ReachableNode> nodes;
+    std::vector<GeoCoord>      polygon;
+
+  public:
+    IsochroneResult();
+
+    inline std::vector<ReachableNode>& GetNodes()
+    {
+      return nodes;
+    }
+
+    inline const std::vector<ReachableNode>& GetNodes() const
+    {
+      return nodes;
+    }
+
+    inline std::vector<GeoCoord>& GetPolygon()
+    {
+      return polygon;
+    }
+
+    inline const std::vector<GeoCoord>& GetPolygon() const
+    {
+      return polygon;
+    }
+
+    inline bool Success() const
+    {
+      return !nodes.empty();
+    }
+  };
+
   /**
    * \ingroup Routing
    *
@@ -254,9 +462,13 @@ namespace osmscout {
       double        overallCost;   //!< The overall costs (currentCost+estimateCost)
 
       bool          access;        //!< Flags to signal, if we had access ("access restrictions") to this node
+      bool          prevAccess;    //!< The access flag of the previous node, to find it in the closed sets
+
+      size_t        heapIndex;     //!< Position in the OpenList, only valid while the node is in the open list
 
       RNode()
-      : id()
+      : id(),
+        heapIndex(0)
       {
         // no code
       }
@@ -271,7 +483,9 @@ namespace osmscout {
         currentCost(0),
         estimateCost(0),
         overallCost(0),
-        access(true)
+        access(true),
+        prevAccess(true),
+        heapIndex(0)
       {
         // no code
       }
@@ -287,7 +501,9 @@ namespace osmscout {
         currentCost(0),
         estimateCost(0),
         overallCost(0),
-        access(true)
+        access(true),
+        prevAccess(true),
+        heapIndex(0)
       {
         // no code
       }
@@ -349,6 +565,11 @@ namespace osmscout {
         return currentNode==other.currentNode;
       }
 
+      VNode()
+      {
+        // no code
+      }
+
       /**
        * Simple inline constructor for searching for VNodes in the
        * ClosedSet.
@@ -385,23 +606,78 @@ namespace osmscout {
     };
 
     /**
-     * Helper class for calculating hash codes for
-     * VNode instances to make it usable in std::unordered_set.
+     * \ingroup Routing
+     *
+     * The open list of the A* algorithm, a 4-ary min heap of RNodes
+     * ordered by RNodeCostCompare.
+     *
+     * Every RNode in the list stores its position in the heap (RNode::heapIndex),
+     * so the costs of a node in the list can be changed in place by calling Update()
+     * afterwards. Use the OpenMap to find the RNode for a route node id.
+     *
+     * Iterating over the list returns the nodes in undefined order.
      */
-    struct ClosedNodeHasher
+    class OSMSCOUT_API OpenList CLASS_FINAL
     {
-      inline size_t operator()(const VNode& node) const
+    private:
+      std::vector<RNodeRef> heap;
+
+    private:
+      void MoveTo(const RNodeRef& node,
+                  size_t index);
+      void SiftUp(size_t index);
+      void SiftDown(size_t index);
+
+    public:
+      typedef std::vector<RNodeRef>::const_iterator const_iterator;
+
+      inline bool empty() const
       {
-        return std::hash<Id>()(node.currentNode.id) ^
-               std::hash<DatabaseId>()(node.currentNode.database);
+        return heap.empty();
+      }
+
+      inline size_t size() const
+      {
+        return heap.size();
+      }
+
+      inline void reserve(size_t size)
+      {
+        heap.reserve(size);
+      }
+
+      inline void clear()
+      {
+        heap.clear();
       }
-    };
 
-    typedef std::set<RNodeRef,RNodeCostCompare>           OpenList;
-    typedef std::set<RNodeRef,RNodeCostCompare>::iterator OpenListRef;
+      inline const_iterator begin() const
+      {
+        return heap.begin();
+      }
+
+      inline const_iterator end() const
+      {
+        return heap.end();
+      }
+
+      /**
+       * Return the node with the lowest costs
+       */
+      inline const RNodeRef& Top() const
+      {
+        return heap.front();
+      }
+
+      void Push(const RNodeRef& node);
+      RNodeRef Pop();
+      void Update(const RNode& node);
+    };
 
-    typedef std::unordered_map<DBId,OpenListRef>          OpenMap;
-    typedef std::unordered_set<VNode,ClosedNodeHasher>    ClosedSet;
+    //! Nodes in the OpenList by route node id
+    typedef DBIdHashMap<RNode*>                           OpenMap;
+    //! VNodes of all handled route nodes by route node id
+    typedef DBIdHashMap<VNode>                            ClosedSet;
 
   public:
     //! Relative filename of the intersection data file
@@ -415,6 +691,8 @@ namespace osmscout {
     static std::string GetDataFilename(const std::string& filenamebase);
     static std::string GetData2Filename(const std::string& filenamebase);
     static std::string GetIndexFilename(const std::string& filenamebase);
+    static std::string GetContractionHierarchyFilename(const std::string& filenamebase);
+    static std::string GetSegmentIndexFilename(const std::string& filenamebase);
 
   public:
     RoutingService();
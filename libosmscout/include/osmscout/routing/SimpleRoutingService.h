@@ -24,7 +24,9 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -43,8 +45,10 @@
 
 // Routing
 #include <osmscout/Intersection.h>
+#include <osmscout/routing/ContractionHierarchy.h>
 #include <osmscout/routing/Route.h>
 #include <osmscout/routing/RouteData.h>
+#include <osmscout/routing/RouteSegmentIndex.h>
 #include <osmscout/routing/RoutingDB.h>
 #include <osmscout/routing/RoutingProfile.h>
 #include <osmscout/routing/RoutingService.h>
@@ -52,6 +56,7 @@
 
 #include <osmscout/util/Breaker.h>
 #include <osmscout/util/Cache.h>
+#include <osmscout/util/WorkQueue.h>
 
 #include <osmscout/system/Compiler.h>
 
@@ -97,17 +102,51 @@ namespace osmscout {
     }
   };
 
+  /**
+   * \ingroup Routing
+   *
+   * Route nodes loaded by matrix calculations. Passing the same cache to consecutive
+   * matrix calculations in the same region (for example while map matching a trace)
+   * avoids loading the same route nodes again. The cache is never cleared
+   * automatically, the caller is responsible for limiting its size.
+   *
+   * Methods are thread-safe.
+   */
+  class OSMSCOUT_API RouteNodeCache CLASS_FINAL
+  {
+  private:
+    mutable std::mutex                  mutex; //!< Mutex to secure multi-thread access to nodes
+    std::unordered_map<Id,RouteNodeRef> nodes; //!< The cached route nodes
+
+  public:
+    bool Get(Id id,
+             RouteNodeRef& node) const;
+    void Set(Id id,
+             const RouteNodeRef& node);
+
+    size_t GetSize() const;
+    void Clear();
+  };
+
   /**
    * \ingroup Service
    * \ingroup Routing
    * The RoutingService implements functionality in the context of routing.
    * The following functions are available:
    * - Calculation of a route from a start node to a target node
+   * - Calculation of costs, times and distances from many start nodes to many target nodes
+   * - Calculation of all route nodes reachable from a start node within a given time or distance
    * - Transformation of the resulting route to a Way
    * - Transformation of the resulting route to a simple list of points
    * - Transformation of the resulting route to a routing description with is the base
    * for further transformations to a textual or visual description of the route
    * - Returning the closest routeable node to  given geolocation
+   * - Returning the routable way segments closest to a given geolocation
+   *
+   * After Open() routes, matrices and isochrones can be calculated by multiple threads
+   * concurrently. All threads share the route node cache (and the flat routing graph,
+   * if enabled), while the search state of each calculation is taken from a pool of
+   * reusable contexts. A profile must not be changed while it is in use.
    */
   class OSMSCOUT_API SimpleRoutingService: public AbstractRoutingService<RoutingProfile>
   {
@@ -120,11 +159,111 @@ namespace osmscout {
 
     std::string                          path;                  //!< Path to the directory containing all files
 
+    bool                                 flatRouteGraph;        //!< Load the complete routing graph into memory on Open()
     RoutingDatabase                      routingDatabase;       //!< Access to routing data and index files
 
+  private:
+    /**
+     * A route node reached by SearchReachableNodes()
+     */
+    struct ReachedNode
+    {
+      Id            id;       //!< Id of the route node
+      RouteNodeRef  node;     //!< The route node
+      ObjectFileRef object;   //!< The object used to reach the route node
+      double        costs;    //!< Costs to reach the route node
+      double        time;     //!< Time in hours to reach the route node
+      Distance      distance; //!< Distance travelled to reach the route node
+    };
+
+    /**
+     * Limits of SearchReachableNodes(), route nodes exceeding one of them are not reached
+     */
+    struct SearchLimit
+    {
+      double   costs;    //!< Maximum costs
+      double   time;     //!< Maximum time in hours
+      Distance distance; //!< Maximum distance
+    };
+
+    /**
+     * A target of a matrix calculation as reached from one of its route nodes
+     */
+    struct MatrixTarget
+    {
+      size_t   index;    //!< Index of the target
+      double   costs;    //!< Costs from the route node to the target position
+      double   time;     //!< Time in hours from the route node to the target position
+      Distance distance; //!< Distance from the route node to the target position
+    };
+
+    //! Costs of each path of the flat routing graph, infinity if the path cannot be used
+    typedef std::shared_ptr<const std::vector<double>>        RouteGraphCostsRef;
+
+    typedef std::function<bool(Id,RouteNodeRef&)>              RouteNodeLoader;
+    typedef std::function<bool(const ReachedNode&)>            ReachedNodeVisitor;
+    typedef std::unordered_map<Id,std::vector<MatrixTarget>>   MatrixTargetMap;
+    //! Path costs of the flat routing graph by the costs key of the profile, most recently used first
+    typedef std::list<std::pair<std::string,RouteGraphCostsRef>> RouteGraphCostsList;
+
+    RouteGraphCostsList                  routeGraphCosts;       //!< Path costs of the flat routing graph for the last used profile costs
+    std::mutex                           routeGraphCostsMutex;  //!< Mutex to secure multi-thread access to routeGraphCosts
+
+    WorkQueue<bool>                      matrixQueue;           //!< Matrix rows to be calculated by the matrix threads
+    std::vector<std::thread>             matrixThreads;         //!< Threads for matrix calculation, started on demand and kept until destruction
+    std::mutex                           matrixThreadsMutex;    //!< Mutex to secure multi-thread access to matrixThreads
+
   private:
     bool HasNodeWithId(const std::vector<Point>& nodes) const;
 
+    bool GetClosestRouteSegmentsFromWays(const GeoCoord& coord,
+                                         const RoutingProfile& profile,
+                                         const Distance& radius,
+                                         std::vector<RouteSegmentMatch>& matches) const;
+
+    RouteGraphCostsRef GetRouteGraphCosts(const RoutingProfile& profile);
+
+    bool SearchReachableNodes(const RoutingProfile& profile,
+                              const std::vector<ReachedNode>& startNodes,
+                              const SearchLimit& limit,
+                              const RouteNodeLoader& loader,
+                              const BreakerRef& breaker,
+                              const ReachedNodeVisitor& visitor);
+
+    bool GetSearchStartNodes(const RoutingProfile& profile,
+                             const RoutePosition& position,
+                             GeoCoord& coord,
+                             std::vector<ReachedNode>& nodes);
+
+    bool GetMatrixTargetNodes(const RoutingProfile& profile,
+                              const RoutePosition& position,
+                              size_t index,
+                              GeoCoord& coord,
+                              MatrixTargetMap& targetMap);
+
+    bool CalculateMatrixRow(const RoutingProfile& profile,
+                            size_t source,
+                            const std::vector<ReachedNode>& startNodes,
+                            double costLimit,
+                            const MatrixTargetMap& targetMap,
+                            const RouteNodeLoader& loader,
+                            const BreakerRef& breaker,
+                            RoutingMatrix& matrix);
+
+    void MatrixThreadLoop();
+
+    bool IsRouteAllowed(const ContractionHierarchy& hierarchy,
+                        DatabaseId database,
+                        const ObjectFileRef& startObject,
+                        const std::vector<ContractionHierarchy::Step>& steps);
+
+    bool CalculateRouteByContractionHierarchy(const ContractionHierarchy& hierarchy,
+                                              RoutingProfile& profile,
+                                              const RoutePosition& start,
+                                              const RoutePosition& target,
+                                              const RoutingParameter& parameter,
+                                              RoutingResult& result);
+
   protected:
     Vehicle GetVehicle(const RoutingProfile& profile) override;
 
@@ -183,6 +322,29 @@ namespace osmscout {
                                    DatabaseId database,
                                    Id id) override;
 
+    bool GetJunctionObjects(const DBId& id,
+                            std::vector<ObjectFileRef>& objects) override;
+
+    bool PrepareQuery(const RoutingProfile& profile,
+                      QueryContext& context) override;
+
+    bool WalkPaths(const RoutingProfile& profile,
+                   const QueryContext& context,
+                   RNodeRef &current,
+                   RouteNodeRef &currentRouteNode,
+                   OpenList &openList,
+                   OpenMap &openMap,
+                   ClosedSet &closedSet,
+                   ClosedSet &closedRestrictedSet,
+                   RoutingResult &result,
+                   const RoutingParameter& parameter,
+                   const GeoCoord &targetCoord,
+                   const Vehicle &vehicle,
+                   size_t &nodesIgnoredCount,
+                   Distance &currentMaxDistance,
+                   const Distance &overallDistance,
+                   const double &costLimit) override;
+
   public:
     SimpleRoutingService(const DatabaseRef& database,
                          const RouterParameter& parameter,
@@ -195,6 +357,29 @@ namespace osmscout {
 
     TypeConfigRef GetTypeConfig() const;
 
+    void ClearRouteGraphCosts();
+
+    RoutingResult CalculateRoute(RoutingProfile& profile,
+                                 const RoutePosition& start,
+                                 const RoutePosition& target,
+                                 const RoutingParameter& parameter);
+
+    RoutingMatrix CalculateMatrix(RoutingProfile& profile,
+                                  const std::vector<RoutePosition>& sources,
+                                  const std::vector<RoutePosition>& targets,
+                                  const RoutingParameter& parameter);
+
+    RoutingMatrix CalculateMatrix(RoutingProfile& profile,
+                                  const std::vector<RoutePosition>& sources,
+                                  const std::vector<RoutePosition>& targets,
+                                  const RoutingParameter& parameter,
+                                  RouteNodeCache& cache);
+
+    IsochroneResult CalculateIsochrone(RoutingProfile& profile,
+                                       const RoutePosition& start,
+                                       const IsochroneParameter& isochroneParameter,
+                                       const RoutingParameter& parameter);
+
     RoutingResult CalculateRouteViaCoords(RoutingProfile& profile,
                                           std::vector<GeoCoord> via,
                                           const Distance &radius,
@@ -204,6 +389,11 @@ namespace osmscout {
                                          const RoutingProfile& profile,
                                          const Distance &radius) const;
 
+    std::vector<RouteSegmentMatch> GetClosestRouteSegments(const GeoCoord& coord,
+                                                           const RoutingProfile& profile,
+                                                           const Distance& radius,
+                                                           size_t count) const;
+
     ClosestRoutableObjectResult GetClosestRoutableObject(const GeoCoord& location,
                                                          Vehicle vehicle,
                                                          const Distance &maxRadius);
@@ -0,0 +1,100 @@
+#ifndef OSMSCOUT_UTIL_ALIGNEDALLOCATOR_H
+#define OSMSCOUT_UTIL_ALIGNEDALLOCATOR_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace osmscout {
+
+  //! Assumed size of a cache line
+  static const size_t CACHE_LINE_SIZE=64;
+
+  /**
+   * \ingroup Util
+   *
+   * Allocator for standard containers, that aligns the allocated memory
+   * to the given alignment (by default the size of a cache line), so that
+   * the first element starts at the beginning of a cache line.
+   *
+   * The pointer returned by operator new is stored directly in front of the
+   * aligned memory.
+   */
+  template<typename T, size_t Alignment=CACHE_LINE_SIZE>
+  class AlignedAllocator
+  {
+  public:
+    typedef T         value_type;
+    typedef T*        pointer;
+    typedef const T*  const_pointer;
+    typedef T&        reference;
+    typedef const T&  const_reference;
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<typename U>
+    struct rebind
+    {
+      typedef AlignedAllocator<U,Alignment> other;
+    };
+
+  public:
+    AlignedAllocator() = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U,Alignment>& /*other*/)
+    {
+      // no code
+    }
+
+    T* allocate(size_t n)
+    {
+      char      *memory=static_cast<char*>(::operator new(n*sizeof(T)+Alignment+sizeof(void*)));
+      uintptr_t address=reinterpret_cast<uintptr_t>(memory+sizeof(void*));
+      char      *aligned=memory+sizeof(void*)+(Alignment-address%Alignment)%Alignment;
+
+      reinterpret_cast<void**>(aligned)[-1]=memory;
+
+      return reinterpret_cast<T*>(aligned);
+    }
+
+    void deallocate(T* p,
+                    size_t /*n*/)
+    {
+      if (p!=nullptr) {
+        ::operator delete(reinterpret_cast<void**>(p)[-1]);
+      }
+    }
+
+    bool operator==(const AlignedAllocator& /*other*/) const
+    {
+      return true;
+    }
+
+    bool operator!=(const AlignedAllocator& /*other*/) const
+    {
+      return false;
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef OSMSCOUT_UTIL_ASYNCFILEREADER_H
+#define OSMSCOUT_UTIL_ASYNCFILEREADER_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osmscout/CoreImportExport.h>
+
+#include <osmscout/OSMScoutTypes.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+    \ingroup File
+
+    AsyncFileReader reads a number of byte ranges of a file while keeping
+    many reads in flight at the same time. This hides the latency of the storage
+    if it is able to process requests in parallel (SSDs, network storage, cold
+    page cache).
+
+    On Linux io_uring is used, if it is available at compile time and can be
+    initialized at runtime. Else the requests are processed by a pool of worker
+    threads, each reading using its own FileScanner.
+
+    Read() can be called by multiple threads at the same time. The io_uring
+    implementation then uses a ring per thread, so their requests are not
+    serialized.
+    */
+  class OSMSCOUT_API AsyncFileReader CLASS_FINAL
+  {
+  public:
+    /**
+     * A single read request
+     */
+    struct OSMSCOUT_API ReadRequest
+    {
+      FileOffset offset;  //!< Offset of the first byte to read
+      size_t     length;  //!< Number of bytes to read
+      char       *buffer; //!< Buffer to read into, must have room for at least length bytes
+      bool       success; //!< Set on completion, true, if all bytes could be read
+    };
+
+    /**
+     * Called for each completed request, in the order of completion.
+     */
+    typedef std::function<void(ReadRequest&)> CompletionHandler;
+
+    /**
+     * Interface of the actual I/O implementation
+     */
+    class OSMSCOUT_API Backend
+    {
+    public:
+      virtual ~Backend();
+
+      virtual bool IsKernelAsync() const = 0;
+
+      virtual void Read(std::vector<ReadRequest>& requests,
+                        const CompletionHandler& handler) = 0;
+    };
+
+  private:
+    std::string              filename; //!< Filename
+    std::unique_ptr<Backend> backend;  //!< I/O implementation, valid, if the file is open
+
+  public:
+    AsyncFileReader();
+    ~AsyncFileReader();
+
+    void Open(const std::string& filename,
+              size_t maxRequestsInFlight=64);
+    void Close();
+
+    inline bool IsOpen() const
+    {
+      return (bool)backend;
+    }
+
+    inline std::string GetFilename() const
+    {
+      return filename;
+    }
+
+    bool IsKernelAsync() const;
+
+    bool Read(std::vector<ReadRequest>& requests,
+              const CompletionHandler& handler=CompletionHandler());
+  };
+}
+
+#endif
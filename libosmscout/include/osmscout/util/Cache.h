@@ -22,9 +22,10 @@
 
 #include <osmscout/CoreFeatures.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <limits>
-#include <list>
-#include <unordered_map>
+#include <memory>
 #include <vector>
 
 #include <osmscout/system/Assert.h>
@@ -37,7 +38,17 @@ namespace osmscout {
 
   /**
    * \ingroup Util
-   * Generic FIFO cache implementation with O(n log n) semantic.
+   * Eviction strategy of a Cache
+   */
+  enum class CachePolicy
+  {
+    LRU,  //!< Evict the least recently used entry
+    Clock //!< Generalized CLOCK: Entries earn credit by being hit and lose it, if the clock hand passes them. Scan resistant.
+  };
+
+  /**
+   * \ingroup Util
+   * Generic cache implementation with O(1) lookup, insertion and eviction.
    *
    * Template parameter class K holds the key value (must be a numerical value),
    * parameter class V holds the data class that is to be cached,
@@ -45,14 +56,19 @@ namespace osmscout {
    * default is PageId.
    *
    * * The cache is not threadsafe.
-   * * It uses a std::vector<std::list>> as a hash table for data lookup
-   * * It uses an std::list for implementing FIFO characteristics.
-   *
-   * Implementation details: If std::unordered_map ist available we use this
-   * for fast detection (O(1)) if an object is already in the cast. If it is not
-   * available, we use a vector as a hashtable via the key value with list
-   * as entry type for hash code conflict handling.
+   * * All entries are stored in one contiguous array of slots. Once the cache
+   *   has reached its maximum size, inserting new entries does not allocate
+   *   memory anymore.
+   * * Lookup is done using an open addressing hash table (linear probing)
+   *   mapping keys to slot indexes.
+   * * The eviction strategy is selectable (see CachePolicy). LRU keeps an
+   *   intrusive doubly linked list of slot indexes, Clock an usage counter
+   *   per slot.
+   * * Optionally the cache can be limited by memory, using a ValueSizer
+   *   to calculate the size of individual entries.
    *
+   * A CacheRef returned by GetEntry() or SetEntry() stays valid until the next
+   * call of a method changing the cache.
    */
   template <class K, class V, class IK = PageId>
   class Cache
@@ -66,15 +82,27 @@ namespace osmscout {
       K key;
       V value;
 
-      CacheEntry(const CacheEntry& entry)
-      : key(entry.key),
-        value(entry.value)
-      {
-        // no code
-      }
+    private:
+      uint32_t prev;   //!< LRU: Index of the previous (more recently used) slot
+      uint32_t next;   //!< LRU: Index of the next (less recently used) slot
+      uint8_t  credit; //!< Clock: Number of clock rounds the entry survives
+      size_t   memory; //!< Memory of the value as returned by the ValueSizer
+
+      friend class Cache;
+
+    public:
+      CacheEntry(const CacheEntry& entry) = default;
+      CacheEntry(CacheEntry&& entry) = default;
+
+      CacheEntry& operator=(const CacheEntry& entry) = default;
+      CacheEntry& operator=(CacheEntry&& entry) = default;
 
       explicit CacheEntry(const K& key)
-      : key(key)
+      : key(key),
+        prev(0),
+        next(0),
+        credit(0),
+        memory(0)
       {
         // no code
       }
@@ -82,7 +110,11 @@ namespace osmscout {
       CacheEntry(const K& key,
                  const V& value)
       : key(key),
-        value(value)
+        value(value),
+        prev(0),
+        next(0),
+        credit(0),
+        memory(0)
       {
         // no code
       }
@@ -101,55 +133,343 @@ namespace osmscout {
       virtual size_t GetSize(const V& value) const = 0;
     };
 
-    typedef std::list<CacheEntry>                              OrderList;
-    typedef typename OrderList::iterator                       CacheRef;
-    typedef std::unordered_map<K,typename OrderList::iterator> Map;
+    typedef std::shared_ptr<ValueSizer> ValueSizerRef;
+    typedef CacheEntry*                 CacheRef;
 
   private:
-    size_t    size;          //<! Current size fo the cache
-    size_t    maxSize;       //<! Maximum size of the cache
-    OrderList order;         //<! Order list (by cache access) of cache entries for least recently used cache flush
-    Map       map;           //<! Key=>Value map
-    CacheRef  previousEntry; //<! Reference to the last access cache entry
+    static const uint32_t noSlot=std::numeric_limits<uint32_t>::max();
+    static const uint8_t  maxCredit=3;
 
   private:
+    CachePolicy             policy;       //<! Eviction policy
+    size_t                  maxSize;      //<! Maximum number of entries in the cache
+    size_t                  maxMemory;    //<! Maximum memory of the cached values, 0 if unlimited
+    ValueSizerRef           sizer;        //<! Sizer for calculating value memory, if memory is limited
+    size_t                  memory;       //<! Current memory of the cached values (only if sizer is set)
+
+    std::vector<CacheEntry> slots;        //<! Cache entries
+    std::vector<uint32_t>   table;        //<! Open addressing hash table of slot indexes
+    size_t                  tableMask;    //<! table.size()-1, table size is always a power of 2
+
+    uint32_t                head;         //<! LRU: Most recently used slot
+    uint32_t                tail;         //<! LRU: Least recently used slot
+    size_t                  hand;         //<! Clock: Current position of the clock hand
+    uint32_t                lastSlot;     //<! Slot of the last accessed entry
+
+    size_t                  hits;         //<! Number of successful lookups
+    size_t                  misses;       //<! Number of failed lookups
+    size_t                  evictions;    //<! Number of entries removed because of size or memory constraints
 
+  private:
     inline IK KeyToInternalKey(K key)
     {
       return key - std::numeric_limits<K>::min();
     }
 
+    inline size_t GetBucket(const K& key) const
+    {
+      // Keys (file offsets, ids) are often sequential, which would cause clustering with
+      // linear probing, so all bits are mixed into the bucket index
+      uint64_t value=(uint64_t)key;
+
+      value^=value >> 33;
+      value*=0xff51afd7ed558ccdULL;
+      value^=value >> 33;
+
+      return (size_t)value & tableMask;
+    }
+
+    uint32_t FindSlot(const K& key) const
+    {
+      if (table.empty()) {
+        return noSlot;
+      }
+
+      size_t bucket=GetBucket(key);
+
+      while (table[bucket]!=noSlot) {
+        if (slots[table[bucket]].key==key) {
+          return table[bucket];
+        }
+
+        bucket=(bucket+1) & tableMask;
+      }
+
+      return noSlot;
+    }
+
+    void InsertIntoTable(const K& key,
+                         uint32_t slot)
+    {
+      size_t bucket=GetBucket(key);
+
+      while (table[bucket]!=noSlot) {
+        bucket=(bucket+1) & tableMask;
+      }
+
+      table[bucket]=slot;
+    }
+
     /**
-      Clear the cache deleting the oldest cache entries
-      until it has the given max size.
-      */
-    void StripCache()
+     * Change the slot index stored for the given key from oldSlot to newSlot
+     */
+    void UpdateTable(const K& key,
+                     uint32_t oldSlot,
+                     uint32_t newSlot)
+    {
+      size_t bucket=GetBucket(key);
+
+      while (table[bucket]!=oldSlot) {
+        bucket=(bucket+1) & tableMask;
+      }
+
+      table[bucket]=newSlot;
+    }
+
+    /**
+     * Remove the given key from the table using backward shift deletion
+     * (no tombstones needed for linear probing)
+     */
+    void RemoveFromTable(const K& key)
+    {
+      size_t bucket=GetBucket(key);
+
+      while (slots[table[bucket]].key!=key) {
+        bucket=(bucket+1) & tableMask;
+      }
+
+      size_t hole=bucket;
+
+      bucket=(bucket+1) & tableMask;
+
+      while (table[bucket]!=noSlot) {
+        size_t home=GetBucket(slots[table[bucket]].key);
+
+        // Move the entry into the hole, if its home bucket is not between hole and current bucket
+        if (((bucket-home) & tableMask)>=((bucket-hole) & tableMask)) {
+          table[hole]=table[bucket];
+          hole=bucket;
+        }
+
+        bucket=(bucket+1) & tableMask;
+      }
+
+      table[hole]=noSlot;
+    }
+
+    /**
+     * Make sure that the table has room for the given number of entries,
+     * while keeping the load factor at or below 0.5.
+     */
+    void AssureTableSize(size_t entries)
+    {
+      size_t requiredSize=16;
+
+      while (requiredSize<2*entries) {
+        requiredSize*=2;
+      }
+
+      if (requiredSize<=table.size()) {
+        return;
+      }
+
+      table.assign(requiredSize,noSlot);
+      tableMask=requiredSize-1;
+
+      for (size_t i=0; i<slots.size(); i++) {
+        InsertIntoTable(slots[i].key,(uint32_t)i);
+      }
+    }
+
+    void LinkFront(uint32_t slot)
+    {
+      slots[slot].prev=noSlot;
+      slots[slot].next=head;
+
+      if (head!=noSlot) {
+        slots[head].prev=slot;
+      }
+
+      head=slot;
+
+      if (tail==noSlot) {
+        tail=slot;
+      }
+    }
+
+    void Unlink(uint32_t slot)
+    {
+      CacheEntry& entry=slots[slot];
+
+      if (entry.prev!=noSlot) {
+        slots[entry.prev].next=entry.next;
+      }
+      else {
+        head=entry.next;
+      }
+
+      if (entry.next!=noSlot) {
+        slots[entry.next].prev=entry.prev;
+      }
+      else {
+        tail=entry.prev;
+      }
+    }
+
+    /**
+     * Register a hit of the given slot with the eviction policy
+     */
+    void Touch(uint32_t slot)
+    {
+      if (policy==CachePolicy::LRU) {
+        if (head!=slot) {
+          Unlink(slot);
+          LinkFront(slot);
+        }
+      }
+      else if (slots[slot].credit<maxCredit) {
+        slots[slot].credit++;
+      }
+    }
+
+    void UpdateMemory(uint32_t slot)
+    {
+      if (!sizer) {
+        return;
+      }
+
+      memory-=slots[slot].memory;
+      slots[slot].memory=sizer->GetSize(slots[slot].value);
+      memory+=slots[slot].memory;
+    }
+
+    /**
+     * Select the slot to evict next. The given slot is never selected.
+     */
+    uint32_t SelectVictim(uint32_t protectedSlot)
     {
-      while (size>maxSize) {
-        // Remove oldest entry from cache...
+      assert(slots.size()>1 || protectedSlot==noSlot);
+
+      if (policy==CachePolicy::LRU) {
+        if (tail!=protectedSlot) {
+          return tail;
+        }
+
+        return slots[tail].prev;
+      }
 
-        // Get oldest entry an dremove it from the map
-        map.erase(map.find(order.back().key));
+      while (true) {
+        if (hand>=slots.size()) {
+          hand=0;
+        }
 
-        // Remove it from order list
-        order.pop_back();
+        uint32_t slot=(uint32_t)hand;
 
-        previousEntry=order.end();
+        hand++;
 
-        size--;
+        if (slot==protectedSlot) {
+          continue;
+        }
+
+        if (slots[slot].credit==0) {
+          return slot;
+        }
+
+        slots[slot].credit--;
       }
     }
 
+    /**
+     * Remove the given slot, keeping the slot array dense by moving the last
+     * slot into its place. Returns the new index of the given protected slot.
+     */
+    uint32_t RemoveSlot(uint32_t slot,
+                        uint32_t protectedSlot)
+    {
+      uint32_t last=(uint32_t)(slots.size()-1);
+
+      RemoveFromTable(slots[slot].key);
+
+      if (policy==CachePolicy::LRU) {
+        Unlink(slot);
+      }
+
+      memory-=slots[slot].memory;
+
+      if (slot!=last) {
+        slots[slot]=std::move(slots[last]);
+
+        UpdateTable(slots[slot].key,last,slot);
+
+        if (policy==CachePolicy::LRU) {
+          CacheEntry& entry=slots[slot];
+
+          if (entry.prev!=noSlot) {
+            slots[entry.prev].next=slot;
+          }
+          else {
+            head=slot;
+          }
+
+          if (entry.next!=noSlot) {
+            slots[entry.next].prev=slot;
+          }
+          else {
+            tail=slot;
+          }
+        }
+
+        if (protectedSlot==last) {
+          protectedSlot=slot;
+        }
+      }
+
+      slots.pop_back();
+      lastSlot=noSlot;
+
+      return protectedSlot;
+    }
+
+    /**
+      Remove entries until the cache fulfills its size and memory
+      constraints. The given slot is never removed, its (possibly changed)
+      index is returned.
+      */
+    uint32_t StripCache(uint32_t protectedSlot=noSlot)
+    {
+      size_t minSize=protectedSlot!=noSlot ? 1 : 0;
+
+      while (slots.size()>minSize &&
+             (slots.size()>maxSize ||
+              (maxMemory>0 && memory>maxMemory))) {
+        protectedSlot=RemoveSlot(SelectVictim(protectedSlot),
+                                 protectedSlot);
+        evictions++;
+      }
+
+      return protectedSlot;
+    }
+
   public:
     /**
      Create a new cache object with the given max size.
       */
-    explicit Cache(size_t maxSize)
-     : size(0),
-       maxSize(maxSize)
+    explicit Cache(size_t maxSize,
+                   CachePolicy policy=CachePolicy::LRU)
+     : policy(policy),
+       maxSize(maxSize),
+       maxMemory(0),
+       memory(0),
+       tableMask(0),
+       head(noSlot),
+       tail(noSlot),
+       hand(0),
+       lastSlot(noSlot),
+       hits(0),
+       misses(0),
+       evictions(0)
     {
-      map.reserve(maxSize);
-      previousEntry=order.end();
+      // no code
     }
 
     /**
@@ -167,8 +487,8 @@ namespace osmscout {
       returned and the reference will be untouched.
 
       If there is a value with the given key, reference will return
-      a reference to the value and the value will moved to the
-      front position of the cache to assure FIFO behaviour.
+      a reference to the value and the eviction policy will be informed
+      about the access.
       */
     bool GetEntry(const K& key,
                   CacheRef& reference)
@@ -177,70 +497,103 @@ namespace osmscout {
         return false;
       }
 
+      uint32_t slot;
+
       // Cached cache access
-      if (previousEntry!=order.end() &&
-          previousEntry->key==key) {
-        reference=previousEntry;
-        return true;
+      if (lastSlot!=noSlot &&
+          slots[lastSlot].key==key) {
+        slot=lastSlot;
       }
+      else {
+        slot=FindSlot(key);
 
-      typename Map::iterator iter=map.find(key);
-
-      if (iter!=map.end()) {
-        // Move key/value to the start of the order list
-        order.splice(order.begin(),order,iter->second);
-
-        // Update the map with the new iterator into the order list
-        iter->second=order.begin();
+        if (slot==noSlot) {
+          misses++;
+          return false;
+        }
+      }
 
-        reference=order.begin();
-        previousEntry=reference;
+      Touch(slot);
 
-        return true;
-      }
+      hits++;
+      lastSlot=slot;
+      reference=&slots[slot];
 
-      return false;
+      return true;
     }
 
     /**
       Set or update the cache with the given value for the given key.
 
       If the key is not available in the cache the value will be added
-      to the front of the cache (FIFO semantic) else the value will be updated
-      (also moving it to the front of the cache (FIFO again).
+      to the cache, possibly evicting other entries, else the value will be updated.
       */
-    typename Cache::CacheRef SetEntry(const CacheEntry& entry)
+    CacheRef SetEntry(const CacheEntry& entry)
     {
       if (!IsActive()) {
-        order.clear();
+        slots.clear();
+        slots.push_back(entry);
+
+        return &slots.front();
+      }
 
-        order.push_front(entry);
+      uint32_t slot=FindSlot(entry.key);
 
-        return order.begin();
+      if (slot!=noSlot) {
+        slots[slot].value=entry.value;
+        Touch(slot);
       }
+      else if (slots.size()>=maxSize) {
+        // Reuse the slot of the evicted entry
+        slot=SelectVictim(noSlot);
+        evictions++;
 
-      typename Map::iterator iter=map.find(entry.key);
+        RemoveFromTable(slots[slot].key);
 
-      if (iter!=map.end()) {
-        // Move key/value to the start of the order list
-        order.splice(order.begin(),order,iter->second);
+        if (policy==CachePolicy::LRU) {
+          Unlink(slot);
+        }
 
-        // Update the map with the new iterator into the order list
-        iter->second=order.begin();
+        memory-=slots[slot].memory;
 
-        order.front().value=entry.value;
+        slots[slot].key=entry.key;
+        slots[slot].value=entry.value;
+        slots[slot].credit=0;
+        slots[slot].memory=0;
+
+        InsertIntoTable(entry.key,slot);
+
+        if (policy==CachePolicy::LRU) {
+          LinkFront(slot);
+        }
       }
       else {
-        // Place key/value to the start of the order list
-        order.push_front(entry);
-        size++;
-        // Update the map with the new iterator into the order list
-        map[entry.key]=order.begin();
+        slot=(uint32_t)slots.size();
+
+        // Grow in steps but never beyond maxSize, so the slot array does not waste memory
+        if (slots.size()==slots.capacity()) {
+          slots.reserve(std::min(std::max(2*slots.capacity(),(size_t)16),maxSize));
+        }
 
-        StripCache();
+        slots.push_back(entry);
+        slots[slot].credit=0;
+        slots[slot].memory=0;
+
+        AssureTableSize(slots.capacity());
+        InsertIntoTable(entry.key,slot);
+
+        if (policy==CachePolicy::LRU) {
+          LinkFront(slot);
+        }
       }
 
-      return order.begin();
+      UpdateMemory(slot);
+
+      slot=StripCache(slot);
+
+      lastSlot=slot;
+
+      return &slots[slot];
     }
 
     /**
@@ -252,8 +605,6 @@ namespace osmscout {
       this->maxSize=maxSize;
 
       StripCache();
-
-      map.reserve(maxSize);
     }
 
     /**
@@ -264,14 +615,117 @@ namespace osmscout {
       return maxSize;
     }
 
+    /**
+      Limit the memory of the cached values to the given number of bytes.
+      Memory of individual values is calculated using the given sizer.
+      Passing a maxMemory of 0 or no sizer, removes the limit.
+      The size of a value is only calculated when it is stored via SetEntry(),
+      so cached values must not change their size afterwards.
+      */
+    void SetMaxMemory(size_t maxMemory,
+                      const ValueSizerRef& sizer)
+    {
+      this->maxMemory=sizer ? maxMemory : 0;
+      this->sizer=sizer;
+
+      memory=0;
+
+      for (auto& slot : slots) {
+        slot.memory=sizer ? sizer->GetSize(slot.value) : 0;
+        memory+=slot.memory;
+      }
+
+      StripCache();
+    }
+
+    /**
+     * Returns the memory of the cached values as calculated by the sizer
+     * passed to SetMaxMemory(), 0 if the memory is not limited
+     */
+    size_t GetCurrentMemory() const
+    {
+      return memory;
+    }
+
+    /**
+     * Returns the maximum memory of the cache, 0 if unlimited
+     */
+    size_t GetMaxMemory() const
+    {
+      return maxMemory;
+    }
+
+    /**
+     * Change the eviction policy. Existing entries are kept, the
+     * access history however is lost.
+     */
+    void SetPolicy(CachePolicy policy)
+    {
+      this->policy=policy;
+
+      head=noSlot;
+      tail=noSlot;
+      hand=0;
+
+      for (size_t i=0; i<slots.size(); i++) {
+        slots[i].credit=0;
+
+        if (policy==CachePolicy::LRU && IsActive()) {
+          LinkFront((uint32_t)i);
+        }
+      }
+    }
+
+    /**
+     * Return the current eviction policy
+     */
+    CachePolicy GetPolicy() const
+    {
+      return policy;
+    }
+
     /**
       Completely flush the cache removing all entries from it.
       */
     void Flush()
     {
-      order.clear();
-      map.clear();
-      size=0;
+      slots.clear();
+      table.assign(table.size(),noSlot);
+
+      memory=0;
+      head=noSlot;
+      tail=noSlot;
+      hand=0;
+      lastSlot=noSlot;
+    }
+
+    /**
+      Append the keys of all cached entries to the given vector. For the LRU
+      policy the most recently used keys come first, for Clock keys with a
+      higher credit come first.
+      */
+    void GetKeys(std::vector<K>& keys) const
+    {
+      if (!IsActive()) {
+        return;
+      }
+
+      keys.reserve(keys.size()+slots.size());
+
+      if (policy==CachePolicy::LRU) {
+        for (uint32_t slot=head; slot!=noSlot; slot=slots[slot].next) {
+          keys.push_back(slots[slot].key);
+        }
+      }
+      else {
+        for (int credit=maxCredit; credit>=0; credit--) {
+          for (const auto& slot : slots) {
+            if (slot.credit==credit) {
+              keys.push_back(slot.key);
+            }
+          }
+        }
+      }
     }
 
     /**
@@ -279,26 +733,58 @@ namespace osmscout {
       */
     size_t GetSize() const
     {
-      return size;
+      return IsActive() ? slots.size() : 0;
     }
 
     size_t GetMemory(const ValueSizer& sizer) const
     {
-      size_t memory=0;
+      size_t result=0;
 
-      // Size of map
-      memory+=map.size()*sizeof(CacheRef);
+      // Size of hash table
+      result+=table.size()*sizeof(uint32_t);
 
-      // Size of list
-      memory+=size*sizeof(CacheEntry);
+      // Size of slots
+      result+=slots.capacity()*sizeof(CacheEntry);
 
-      for (typename std::list<CacheEntry>::const_iterator entry=order.begin();
-           entry!=order.end();
-           ++entry) {
-        memory+=sizer.GetSize(entry->value);
+      for (const auto& entry : slots) {
+        result+=sizer.GetSize(entry.value);
       }
 
-      return memory;
+      return result;
+    }
+
+    /**
+     * Returns the number of successful lookups
+     */
+    size_t GetHits() const
+    {
+      return hits;
+    }
+
+    /**
+     * Returns the number of failed lookups
+     */
+    size_t GetMisses() const
+    {
+      return misses;
+    }
+
+    /**
+     * Returns the number of entries removed because of size or memory constraints
+     */
+    size_t GetEvictions() const
+    {
+      return evictions;
+    }
+
+    /**
+     * Reset the hit, miss and eviction counters
+     */
+    void ResetStatistics()
+    {
+      hits=0;
+      misses=0;
+      evictions=0;
     }
 
     /**
@@ -306,9 +792,16 @@ namespace osmscout {
       */
     void DumpStatistics(const char* cacheName, const ValueSizer& sizer)
     {
-      log.Debug() << cacheName << " entries: " << size << ", memory " << GetMemory(sizer);
+      log.Debug() << cacheName << " entries: " << GetSize() << ", memory " << GetMemory(sizer)
+                  << ", hits " << hits << ", misses " << misses << ", evictions " << evictions;
     }
   };
+
+  template <class K, class V, class IK>
+  const uint32_t Cache<K,V,IK>::noSlot;
+
+  template <class K, class V, class IK>
+  const uint8_t Cache<K,V,IK>::maxCredit;
 }
 
 #endif
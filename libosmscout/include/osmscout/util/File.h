@@ -104,6 +104,16 @@ namespace osmscout {
    */
   extern OSMSCOUT_API bool IsDirectory(const std::string& filename);
 
+  /**
+   * \ingroup File
+   *
+   * Creates the given directory, if it does not already exist. Parent directories
+   * are not created. Returns true, if the directory exists afterwards, else false.
+   *
+   * @throws IOException if the function is not implemented.
+   */
+  extern OSMSCOUT_API bool MakeDirectory(const std::string& dirname);
+
   extern OSMSCOUT_API bool ReadFile(const std::string& filename, std::vector<char>& content);
 }
 
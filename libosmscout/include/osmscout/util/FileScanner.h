@@ -31,6 +31,7 @@
 #include <osmscout/GeoCoord.h>
 #include <osmscout/ObjectRef.h>
 #include <osmscout/Point.h>
+#include <osmscout/PointsView.h>
 #include <osmscout/OSMScoutTypes.h>
 
 #include <osmscout/util/Exception.h>
@@ -55,6 +56,10 @@ namespace osmscout {
     mapping the complete file into the memory of the process (without
     allocating real memory) resulting in measurable speed increase because of
     exchanging buffered file access with in memory array access.
+
+    FileScanner can also read from a memory buffer holding a part of a file
+    (for example filled by an AsyncFileReader). File positions stay the same
+    as in the file itself.
     */
   class OSMSCOUT_API FileScanner CLASS_FINAL
   {
@@ -76,6 +81,7 @@ namespace osmscout {
     char                 *buffer;        //!< Pointer to the file memory
     FileOffset           size;           //!< Size of the memory/file
     FileOffset           offset;         //!< Current offset into the file memory
+    FileOffset           bufferOffset;   //!< File offset of the first byte of the memory, if reading from a memory buffer
 
     // For std::vector<GeoCoord> loading
     uint8_t              *byteBuffer;    //!< Temporary buffer for loading of std::vector<GeoCoord>
@@ -89,6 +95,10 @@ namespace osmscout {
   private:
     void AssureByteBufferSize(size_t size);
     void FreeBuffer();
+    bool ReadPointsHeader(bool readIds,
+                          size_t& nodeCount,
+                          size_t& coordBitSize,
+                          bool& hasNodes);
 
   public:
     FileScanner();
@@ -97,19 +107,23 @@ namespace osmscout {
     void Open(const std::string& filename,
               Mode mode,
               bool useMmap);
+    void Open(const std::string& filename,
+              const char* data,
+              FileOffset dataOffset,
+              size_t dataSize);
     void Close();
     void CloseFailsafe();
 
     inline bool IsOpen() const
     {
-      return file!=NULL;
+      return file!=NULL || buffer!=NULL;
     }
 
     bool IsEOF() const;
 
     inline  bool HasError() const
     {
-      return file==NULL || hasError;
+      return !IsOpen() || hasError;
     }
 
     std::string GetFilename() const;
@@ -118,6 +132,9 @@ namespace osmscout {
     void SetPos(FileOffset pos);
     FileOffset GetPos() const;
 
+    void Prefetch(FileOffset pos,
+                  FileOffset length);
+
     void Read(char* buffer, size_t bytes);
 
     void Read(std::string& value);
@@ -157,6 +174,7 @@ namespace osmscout {
                               bool& isSet);
 
     void Read(std::vector<Point>& nodes, bool readIds);
+    void Read(PointsView& nodes, bool readIds);
 
     void ReadBox(GeoBox& box);
 
@@ -61,6 +61,7 @@ namespace osmscout {
     virtual ~FileWriter();
 
     void Open(const std::string& filename);
+    void OpenExisting(const std::string& filename);
     void Close();
     void CloseFailsafe();
     inline bool IsOpen() const
@@ -132,6 +133,7 @@ namespace osmscout {
     void WriteTypeId(TypeId id, uint8_t maxBytes);
 
     void Flush();
+    void Sync();
     void FlushCurrentBlockWithZeros(size_t blockSize);
   };
 
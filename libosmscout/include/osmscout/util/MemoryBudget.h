@@ -0,0 +1,141 @@
+#ifndef OSMSCOUT_UTIL_MEMORYBUDGET_H
+#define OSMSCOUT_UTIL_MEMORYBUDGET_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <osmscout/CoreImportExport.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Util
+   *
+   * A memory budget (in bytes) shared by a number of caches.
+   *
+   * Caches register as Consumer. The budget distributes its memory over all
+   * registered consumers:
+   * * A quarter of the budget is always shared equally, so every cache is able
+   *   to collect hits.
+   * * The rest is distributed based on the observed benefit of each cache since
+   *   the last rebalancing. Hits count fully, misses count weighted by the hit rate
+   *   (a miss in a cache with a high hit rate would likely have been a hit
+   *   with more memory, a miss in a cache without any hits is likely
+   *   streaming access that does not profit from more memory).
+   * * On rebalancing, caches that use less than 3/4 of their current limit only get
+   *   their current usage plus 50% headroom, the rest goes to the other caches.
+   *
+   * The distribution is adapted to the current load on registration, on SetBudget() and
+   * by RebalanceIfDue(), which users of the caches (like Database) call on access and
+   * which rebalances at most once per rebalance interval. Rebalance() can be called
+   * explicitly, for example after rendering a map or calculating a route. Call
+   * SetBudget() to grow or shrink the overall budget, for example on memory pressure.
+   *
+   * All methods are thread-safe. Consumers must not call the budget from within
+   * SetMemoryLimit().
+   */
+  class OSMSCOUT_API MemoryBudget CLASS_FINAL
+  {
+  public:
+    /**
+     * Interface to be implemented by caches that are controlled by a MemoryBudget.
+     *
+     * All methods must be thread-safe.
+     */
+    class OSMSCOUT_API Consumer
+    {
+    public:
+      virtual ~Consumer();
+
+      /**
+       * Name of the cache, used for logging
+       */
+      virtual std::string GetMemoryConsumerName() const = 0;
+
+      /**
+       * Current memory usage of the cache in bytes
+       */
+      virtual size_t GetMemoryUsage() const = 0;
+
+      /**
+       * Accumulated number of cache hits and misses
+       */
+      virtual void GetCacheStatistics(size_t& hits,
+                                      size_t& misses) const = 0;
+
+      /**
+       * Limit the memory usage of the cache to the given number of bytes,
+       * evicting entries if necessary
+       */
+      virtual void SetMemoryLimit(size_t bytes) = 0;
+    };
+
+  private:
+    struct Registration
+    {
+      Consumer *consumer;   //!< The consumer
+      size_t   limit;       //!< Currently assigned limit
+      size_t   lastHits;    //!< Hits at the last rebalancing
+      size_t   lastMisses;  //!< Misses at the last rebalancing
+      double   weight;      //!< Smoothed benefit of the consumer
+    };
+
+  private:
+    mutable std::mutex                    mutex;             //!< Mutex to secure multi-thread access
+    size_t                                budget;            //!< Overall budget in bytes
+    std::vector<Registration>             registrations;     //!< All registered consumers
+    std::chrono::milliseconds             rebalanceInterval; //!< Minimum time between two automatic rebalancings
+    std::chrono::steady_clock::time_point lastRebalance;     //!< Time of the last rebalancing
+
+  private:
+    void UpdateWeights();
+    void Distribute(bool considerUsage);
+
+  public:
+    explicit MemoryBudget(size_t budget);
+
+    void Register(Consumer& consumer);
+    void Unregister(Consumer& consumer);
+
+    void SetBudget(size_t budget);
+    size_t GetBudget() const;
+
+    size_t GetMemoryLimit(const Consumer& consumer) const;
+    size_t GetMemoryUsage() const;
+
+    void SetRebalanceInterval(std::chrono::milliseconds interval);
+
+    void Rebalance();
+    void RebalanceIfDue();
+
+    void DumpStatistics() const;
+  };
+
+  typedef std::shared_ptr<MemoryBudget> MemoryBudgetRef;
+}
+
+#endif
@@ -26,6 +26,8 @@
 
 #include <osmscout/CoreImportExport.h>
 
+#include <osmscout/util/MemoryBudget.h>
+
 #include <osmscout/system/Compiler.h>
 
 namespace osmscout {
@@ -38,6 +40,10 @@ namespace osmscout {
    *
    * Implementation is OS specific, if GetValue() retutns 0.0 for each value there is likely no
    * implementation for your OS.
+   *
+   * Optionally a MemoryBudget can be attached using SetMemoryBudget(). On every measurement
+   * the budget is then shrunk, if the resident set exceeds the given limit, and grown again
+   * (up to its size on attachment), if there is room below the limit.
    */
   class OSMSCOUT_API MemoryMonitor CLASS_FINAL
   {
@@ -46,12 +52,16 @@ namespace osmscout {
     std::mutex        mutex;
     double            maxVMUsage;
     double            maxResidentSet;
+    MemoryBudgetRef   budget;           //!< Budget adapted to the memory usage, if set
+    size_t            residentSetLimit; //!< Resident set, the budget is shrunk above
+    size_t            maxBudget;        //!< Size of the budget on attachment, the budget does not grow above
     std::thread       thread;
 
   private:
     void SignalStop();
     void BackgroundJob();
     void Measure();
+    void AdaptBudget(double residentSet);
 
   public:
     MemoryMonitor();
@@ -61,6 +71,9 @@ namespace osmscout {
                      double& residentSet);
 
     void Reset();
+
+    void SetMemoryBudget(const MemoryBudgetRef& budget,
+                         size_t residentSetLimit);
   };
 
 }
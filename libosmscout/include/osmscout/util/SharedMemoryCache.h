@@ -0,0 +1,114 @@
+#ifndef OSMSCOUT_UTIL_SHAREDMEMORYCACHE_H
+#define OSMSCOUT_UTIL_SHAREDMEMORYCACHE_H
+
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <osmscout/CoreImportExport.h>
+
+#include <osmscout/system/Compiler.h>
+
+namespace osmscout {
+
+  /**
+   * \ingroup Util
+   *
+   * A cache of small binary values in a named POSIX shared memory segment,
+   * shared by all processes on a host opening a segment with the same name.
+   *
+   * Values are identified by a file key (see GetFileKey()) and a key within the file
+   * (usually a file offset). The segment contains a fixed number of slots of
+   * the same size, organized as an open addressing hash table. The segment does
+   * not contain any pointers, so every process can map it at a different address.
+   *
+   * Access is lock-free: each slot is protected by a sequence counter. Readers
+   * never wait, a slot that is written concurrently is reported as a miss.
+   * Writers that cannot acquire a slot immediately drop the value. If all
+   * candidate slots are used, an existing value is replaced.
+   *
+   * The segment outlives the processes using it, call Remove() to delete it.
+   * On platforms without shm_open() Open() always fails.
+   *
+   * All methods except Open() and Close() are thread-safe.
+   */
+  class OSMSCOUT_API SharedMemoryCache CLASS_FINAL
+  {
+  private:
+    std::string name;         //!< Name of the shared memory segment
+    int         handle;       //!< File descriptor of the shared memory segment
+    char        *memory;      //!< Start of the mapped segment
+    size_t      memorySize;   //!< Size of the mapped segment
+    size_t      slotCount;    //!< Number of slots in the segment
+    size_t      slotSize;     //!< Size of one slot including its header
+    size_t      maxValueSize; //!< Maximum size of one value
+
+  private:
+    bool Initialize(bool create,
+                    size_t size,
+                    size_t valueSize);
+
+  public:
+    SharedMemoryCache();
+    ~SharedMemoryCache();
+
+    SharedMemoryCache(const SharedMemoryCache& other)=delete;
+    SharedMemoryCache& operator=(const SharedMemoryCache& other)=delete;
+
+    static bool IsSupported();
+
+    bool Open(const std::string& name,
+              size_t size,
+              size_t maxValueSize);
+    void Close();
+
+    inline bool IsOpen() const
+    {
+      return memory!=nullptr;
+    }
+
+    inline size_t GetMaxValueSize() const
+    {
+      return maxValueSize;
+    }
+
+    bool Get(uint64_t fileKey,
+             uint64_t key,
+             void* value,
+             size_t bufferSize,
+             size_t& valueSize) const;
+    bool Put(uint64_t fileKey,
+             uint64_t key,
+             const void* value,
+             size_t valueSize);
+
+    void GetStatistics(size_t& hits,
+                       size_t& misses) const;
+
+    static bool Remove(const std::string& name);
+    static uint64_t GetFileKey(const std::string& filename);
+  };
+
+  typedef std::shared_ptr<SharedMemoryCache> SharedMemoryCacheRef;
+}
+
+#endif
@@ -228,6 +228,14 @@ namespace osmscout {
       return GetWidth()*GetHeight();
     }
 
+    inline bool Includes(const OSMTileId& tile) const
+    {
+      return tile.GetX()>=minTile.GetX() &&
+             tile.GetX()<=maxTile.GetX() &&
+             tile.GetY()>=minTile.GetY() &&
+             tile.GetY()<=maxTile.GetY();
+    }
+
     inline OSMTileIdBoxConstIterator begin() const
     {
       return OSMTileIdBoxConstIterator(minTile,
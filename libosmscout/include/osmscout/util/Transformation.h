@@ -181,6 +181,20 @@ namespace osmscout {
     void Reset();
     size_t PushCoord(double x, double y);
 
+    /**
+     * Append all points of the other buffer. Ranges referring to the other buffer
+     * have to be moved by the returned offset to refer to the appended points.
+     *
+     * @param other buffer to copy the points from
+     * @return index of the first appended point
+     */
+    size_t PushCoords(const CoordBuffer& other);
+
+    inline size_t GetSize() const
+    {
+      return usedPoints;
+    }
+
     /**
      * Generate parallel way to way stored in this buffer on range orgStart, orgEnd (inclusive)
      * Result is stored after the last valid point. Generated way offsets are returned
@@ -36,7 +36,9 @@ namespace osmscout {
   AreaAreaIndex::AreaAreaIndex(size_t cacheSize)
   : maxLevel(0),
     topLevelOffset(0),
-    indexCache(cacheSize)
+    indexCache(cacheSize),
+    asyncPrefetch(false),
+    fileSize(0)
   {
     // no code
   }
@@ -46,8 +48,21 @@ namespace osmscout {
     Close();
   }
 
+  /**
+   * If set, the cells of a level are read using an AsyncFileReader with many
+   * reads in flight and decoded from the read buffers, see DataFile::SetAsyncPrefetch().
+   *
+   * Must be called before Open().
+   */
+  void AreaAreaIndex::SetAsyncPrefetch(bool asyncPrefetch)
+  {
+    this->asyncPrefetch=asyncPrefetch;
+  }
+
   void AreaAreaIndex::Close()
   {
+    asyncReader.reset();
+
     try {
       if (scanner.IsOpen()) {
         scanner.Close();
@@ -59,14 +74,44 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Read the child offsets of the cell at the given offset using the given scanner.
+   */
+  void AreaAreaIndex::ReadIndexCell(FileScanner& cellScanner,
+                                    FileOffset offset,
+                                    IndexCell& indexCell) const
+  {
+    cellScanner.SetPos(offset);
+
+    for (FileOffset& c : indexCell.children) {
+      FileOffset childOffset;
+
+      cellScanner.ReadNumber(childOffset);
+
+      if (childOffset==0) {
+        c=0;
+      }
+      else {
+        c=offset-childOffset;
+      }
+    }
+
+    indexCell.data=cellScanner.GetPos();
+  }
+
+  /**
+   * Return the index cell at the given offset, either from the cache or by reading
+   * it from the buffer scanner (if given) or the index file.
+   */
   bool AreaAreaIndex::GetIndexCell(uint32_t level,
                                    FileOffset offset,
+                                   FileScanner* bufferScanner,
                                    IndexCell &indexCell,
                                    FileOffset &dataOffset) const
   {
     if (level<maxLevel) {
-      std::lock_guard<std::mutex> guard(lookupMutex);
-      IndexCache::CacheRef        cacheRef;
+      std::unique_lock<std::mutex> guard(lookupMutex);
+      IndexCache::CacheRef         cacheRef;
 
 #if defined(ANALYZE_CACHE)
       if (indexCache.GetSize()==indexCache.GetMaxSize()) {
@@ -77,28 +122,22 @@ namespace osmscout {
 #endif
 
       if (!indexCache.GetEntry(offset,cacheRef)) {
-        IndexCache::CacheEntry cacheEntry(offset);
-
-        cacheRef=indexCache.SetEntry(cacheEntry);
-
-        scanner.SetPos(offset);
-
-        for (FileOffset& c : cacheRef->value.children) {
-          FileOffset childOffset;
-
-          scanner.ReadNumber(childOffset);
-
-          if (childOffset==0) {
-            c=0;
-          }
-          else {
-            c=offset-childOffset;
-          }
+        if (bufferScanner!=nullptr) {
+          // The buffer is not shared
+          guard.unlock();
+          ReadIndexCell(*bufferScanner,
+                        offset,
+                        indexCell);
+          guard.lock();
+        }
+        else {
+          ReadIndexCell(scanner,
+                        offset,
+                        indexCell);
         }
 
-        cacheRef->value.data=scanner.GetPos();
-
-        indexCell=cacheRef->value;
+        indexCache.SetEntry(IndexCache::CacheEntry(offset,
+                                                   indexCell));
       }
       else {
         indexCell=cacheRef->value;
@@ -119,16 +158,23 @@ namespace osmscout {
 
   bool AreaAreaIndex::ReadCellData(const TypeConfig& typeConfig,
                                    const TypeInfoSet& types,
+                                   FileScanner* bufferScanner,
                                    FileOffset dataOffset,
                                    std::vector<DataBlockSpan>& spans) const
   {
-    std::lock_guard<std::mutex> guard(lookupMutex);
+    std::unique_lock<std::mutex> guard(lookupMutex,std::defer_lock);
+    FileScanner                  *cellScanner=bufferScanner;
 
-    scanner.SetPos(dataOffset);
+    if (cellScanner==nullptr) {
+      guard.lock();
+      cellScanner=&scanner;
+    }
+
+    cellScanner->SetPos(dataOffset);
 
     uint32_t typeCount;
 
-    scanner.ReadNumber(typeCount);
+    cellScanner->ReadNumber(typeCount);
 
     FileOffset prevDataFileOffset=0;
 
@@ -137,9 +183,9 @@ namespace osmscout {
       uint32_t   dataCount;
       FileOffset dataFileOffset;
 
-      scanner.ReadTypeId(typeId,typeConfig.GetAreaTypeIdBytes());
-      scanner.ReadNumber(dataCount);
-      scanner.ReadNumber(dataFileOffset);
+      cellScanner->ReadTypeId(typeId,typeConfig.GetAreaTypeIdBytes());
+      cellScanner->ReadNumber(dataCount);
+      cellScanner->ReadNumber(dataFileOffset);
 
       dataFileOffset+=prevDataFileOffset;
       prevDataFileOffset=dataFileOffset;
@@ -163,6 +209,79 @@ namespace osmscout {
     return true;
   }
 
+  /**
+   * Read the index cell at the given offset and the spans of its data.
+   */
+  bool AreaAreaIndex::ReadCell(const TypeConfig& typeConfig,
+                               const TypeInfoSet& types,
+                               uint32_t level,
+                               FileOffset offset,
+                               FileScanner* bufferScanner,
+                               IndexCell& indexCell,
+                               std::vector<DataBlockSpan>& spans) const
+  {
+    FileOffset dataOffset;
+
+    if (!GetIndexCell(level,
+                      offset,
+                      bufferScanner,
+                      indexCell,
+                      dataOffset)) {
+      log.Error() << "Cannot find offset " << offset
+                  << " in level " << level
+                  << " in file '" << scanner.GetFilename() << "'";
+
+      return false;
+    }
+
+    // Now read the area offsets by type in this index entry
+
+    if (!ReadCellData(typeConfig,
+                      types,
+                      bufferScanner,
+                      dataOffset,
+                      spans)) {
+      log.Error() << "Cannot read index data for level " << level
+                  << " at offset " << dataOffset
+                  << " in file '" << scanner.GetFilename() << "'";
+
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Read the data of the cells [begin,end) using the AsyncFileReader. Since the size
+   * of a cell is not known, a fixed number of bytes is read for each cell.
+   * requests[i] holds the result for cell begin+i.
+   */
+  void AreaAreaIndex::ReadCells(const std::vector<CellRef>& cellRefs,
+                                size_t begin,
+                                size_t end,
+                                std::vector<char>& buffer,
+                                std::vector<AsyncFileReader::ReadRequest>& requests) const
+  {
+    // Estimated size of a cell including its data
+    const FileOffset cellSizeEstimate=1024;
+
+    buffer.resize((end-begin)*cellSizeEstimate);
+    requests.clear();
+
+    for (size_t c=begin; c<end; c++) {
+      FileOffset offset=cellRefs[c].offset;
+      size_t     length=offset<fileSize ? (size_t)std::min(cellSizeEstimate,fileSize-offset) : 0;
+
+      requests.push_back(AsyncFileReader::ReadRequest{offset,
+                                                      length,
+                                                      buffer.data()+(c-begin)*cellSizeEstimate,
+                                                      false});
+    }
+
+    // Errors are reported by the reader, affected cells are read from the index file
+    asyncReader->Read(requests);
+  }
+
   void AreaAreaIndex::PushCellsForNextLevel(double minlon,
                                             double minlat,
                                             double maxlon,
@@ -235,14 +354,28 @@ namespace osmscout {
 
       scanner.ReadNumber(maxLevel);
       scanner.ReadFileOffset(topLevelOffset);
-
-      return !scanner.HasError();
     }
     catch (IOException& e) {
       log.Error() << e.GetDescription();
 
       return false;
     }
+
+    if (asyncPrefetch) {
+      try {
+        fileSize=GetFileSize(datafilename);
+
+        asyncReader.reset(new AsyncFileReader());
+        asyncReader->Open(datafilename);
+      }
+      catch (IOException& e) {
+        // Not fatal, cells are read using the scanner
+        log.Warn() << e.GetDescription();
+        asyncReader.reset();
+      }
+    }
+
+    return !scanner.HasError();
   }
 
   /**
@@ -267,14 +400,20 @@ namespace osmscout {
                                      std::vector<DataBlockSpan>& spans,
                                      TypeInfoSet& loadedTypes) const
   {
-    StopClock            time;
+    // Number of cells read ahead at once, if asyncPrefetch is set
+    const size_t                              cellGroupSize=1024;
 
-    std::vector<CellRef> cellRefs;     // cells to scan in this level
-    std::vector<CellRef> nextCellRefs; // cells to scan for the next level
-    double               minlon=boundingBox.GetMinLon()+180.0;
-    double               maxlon=boundingBox.GetMaxLon()+180.0;
-    double               minlat=boundingBox.GetMinLat()+90.0;
-    double               maxlat=boundingBox.GetMaxLat()+90.0;
+    StopClock                                 time;
+
+    std::vector<CellRef>                      cellRefs;     // cells to scan in this level
+    std::vector<CellRef>                      nextCellRefs; // cells to scan for the next level
+    std::vector<DataBlockSpan>                cellSpans;    // spans of the current cell
+    std::vector<char>                         buffer;       // data of the cells read ahead
+    std::vector<AsyncFileReader::ReadRequest> requests;     // read requests of the cells read ahead
+    double                                    minlon=boundingBox.GetMinLon()+180.0;
+    double                                    maxlon=boundingBox.GetMaxLon()+180.0;
+    double                                    minlat=boundingBox.GetMinLat()+90.0;
+    double                                    maxlat=boundingBox.GetMaxLat()+90.0;
 
     // Clear result data structures
     spans.clear();
@@ -303,47 +442,92 @@ namespace osmscout {
            level++) {
         nextCellRefs.clear();
 
-        for (const auto& cellRef : cellRefs) {
-          IndexCell  cellIndexData;
-          FileOffset cellDataOffset;
-
-          if (!GetIndexCell(level,
-                            cellRef.offset,
-                            cellIndexData,
-                            cellDataOffset)) {
-            log.Error() << "Cannot find offset " << cellRef.offset
-                        << " in level " << level
-                        << " in file '" << scanner.GetFilename() << "'";
-
-            return false;
-          }
-
-          // Now read the area offsets by type in this index entry
+        for (size_t groupStart=0; groupStart<cellRefs.size(); groupStart+=cellGroupSize) {
+          size_t groupEnd=std::min(groupStart+cellGroupSize,cellRefs.size());
+          bool   buffered=asyncReader && groupEnd-groupStart>1;
 
-          if (!ReadCellData(typeConfig,
-                            types,
-                            cellDataOffset,
-                            spans)) {
-            log.Error() << "Cannot read index data for level " << level
-                        << " at offset " << cellDataOffset
-                        << " in file '" << scanner.GetFilename() << "'";
-
-            return false;
+          if (buffered) {
+            ReadCells(cellRefs,
+                      groupStart,
+                      groupEnd,
+                      buffer,
+                      requests);
           }
 
-          if (level<this->maxLevel) {
-            size_t cx=cellRef.x*2;
-            size_t cy=cellRef.y*2;
-
-            PushCellsForNextLevel(minlon,
-                                  minlat,
-                                  maxlon,
-                                  maxlat,
-                                  cellIndexData,
-                                  cellDimension[level+1],
-                                  cx,
-                                  cy,
-                                  nextCellRefs);
+          for (size_t c=groupStart; c<groupEnd; c++) {
+            const CellRef& cellRef=cellRefs[c];
+            IndexCell      cellIndexData;
+            FileScanner    bufferScanner;
+            FileScanner    *cellScanner=nullptr;
+            bool           success;
+
+            if (buffered &&
+                requests[c-groupStart].success) {
+              try {
+                bufferScanner.Open(datafilename,
+                                   requests[c-groupStart].buffer,
+                                   requests[c-groupStart].offset,
+                                   requests[c-groupStart].length);
+                cellScanner=&bufferScanner;
+              }
+              catch (IOException& e) {
+                log.Warn() << e.GetDescription();
+              }
+            }
+
+            cellSpans.clear();
+
+            try {
+              success=ReadCell(typeConfig,
+                               types,
+                               level,
+                               cellRef.offset,
+                               cellScanner,
+                               cellIndexData,
+                               cellSpans);
+            }
+            catch (IOException& /*e*/) {
+              if (cellScanner==nullptr) {
+                throw;
+              }
+
+              // The cell is bigger than the data read ahead, not an error
+              bufferScanner.CloseFailsafe();
+              cellSpans.clear();
+
+              success=ReadCell(typeConfig,
+                               types,
+                               level,
+                               cellRef.offset,
+                               nullptr,
+                               cellIndexData,
+                               cellSpans);
+            }
+
+            bufferScanner.CloseFailsafe();
+
+            if (!success) {
+              return false;
+            }
+
+            spans.insert(spans.end(),
+                         cellSpans.begin(),
+                         cellSpans.end());
+
+            if (level<this->maxLevel) {
+              size_t cx=cellRef.x*2;
+              size_t cy=cellRef.y*2;
+
+              PushCellsForNextLevel(minlon,
+                                    minlat,
+                                    maxlon,
+                                    maxlat,
+                                    cellIndexData,
+                                    cellDimension[level+1],
+                                    cx,
+                                    cy,
+                                    nextCellRefs);
+            }
           }
         }
 
@@ -368,6 +552,86 @@ namespace osmscout {
     return true;
   }
 
+  std::string AreaAreaIndex::GetMemoryConsumerName() const
+  {
+    return AREA_AREA_IDX;
+  }
+
+  size_t AreaAreaIndex::GetMemoryUsage() const
+  {
+    std::lock_guard<std::mutex> guard(lookupMutex);
+
+    return indexCache.GetSize()*(sizeof(IndexCache::CacheEntry)+sizeof(uint32_t));
+  }
+
+  void AreaAreaIndex::GetCacheStatistics(size_t& hits,
+                                         size_t& misses) const
+  {
+    std::lock_guard<std::mutex> guard(lookupMutex);
+
+    hits=indexCache.GetHits();
+    misses=indexCache.GetMisses();
+  }
+
+  /**
+   * Limit the index cell cache to the given number of bytes. All index cells
+   * have the same size, so the limit is converted to a number of entries.
+   */
+  void AreaAreaIndex::SetMemoryLimit(size_t bytes)
+  {
+    std::lock_guard<std::mutex> guard(lookupMutex);
+
+    // Slot and hash table entry
+    indexCache.SetMaxSize(std::max(bytes/(sizeof(IndexCache::CacheEntry)+sizeof(uint32_t)),(size_t)1));
+  }
+
+  /**
+   * Append the file offsets of all cached index cells to the given vector,
+   * most valuable cells first.
+   */
+  void AreaAreaIndex::GetCachedCellOffsets(std::vector<FileOffset>& offsets) const
+  {
+    std::lock_guard<std::mutex> guard(lookupMutex);
+
+    indexCache.GetKeys(offsets);
+  }
+
+  /**
+   * Load the index cells at the given file offsets into the cache (as
+   * returned by GetCachedCellOffsets() of an earlier instance). Cells are
+   * loaded in reverse order, so the first cell ends up as the most valuable one.
+   * The size of the loaded cell headers is added to bytesRead.
+   */
+  bool AreaAreaIndex::LoadCells(const std::vector<FileOffset>& offsets,
+                                FileOffset& bytesRead) const
+  {
+    if (maxLevel==0) {
+      return true;
+    }
+
+    try {
+      for (auto offset=offsets.rbegin(); offset!=offsets.rend(); ++offset) {
+        IndexCell  indexCell;
+        FileOffset dataOffset;
+
+        // Cells of all levels below maxLevel are cached
+        GetIndexCell(0,
+                     *offset,
+                     nullptr,
+                     indexCell,
+                     dataOffset);
+
+        bytesRead+=dataOffset-*offset;
+      }
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    return true;
+  }
+
   void AreaAreaIndex::DumpStatistics()
   {
     indexCache.DumpStatistics(AREA_AREA_IDX,IndexCacheValueSizer());
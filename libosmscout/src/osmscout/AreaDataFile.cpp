@@ -24,9 +24,26 @@ namespace osmscout {
   const char* AreaDataFile::AREAS_DAT="areas.dat";
   const char* AreaDataFile::AREAS_IDMAP="areas.idmap";
 
-  AreaDataFile::AreaDataFile(size_t cacheSize)
-  : DataFile<Area>(AREAS_DAT, cacheSize)
+  AreaDataFile::AreaDataFile(size_t cacheSize,
+                             size_t cacheShardCount)
+  : DataFile<Area>(AREAS_DAT,cacheSize,cacheShardCount)
   {
     // no code
   }
+
+  /**
+   * Return the estimated memory of the area including its nodes
+   */
+  size_t AreaDataFile::GetValueMemory(const Area& area) const
+  {
+    size_t memory=sizeof(Area)+
+                  area.rings.capacity()*sizeof(Area::Ring);
+
+    for (const auto& ring : area.rings) {
+      memory+=ring.GetFeatureValueBuffer().GetAllocatedMemory()+
+              ring.nodes.capacity()*sizeof(Point);
+    }
+
+    return memory;
+  }
 }
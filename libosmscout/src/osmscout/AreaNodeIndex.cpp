@@ -20,6 +20,7 @@
 #include <osmscout/AreaNodeIndex.h>
 
 #include <algorithm>
+#include <set>
 
 #include <osmscout/util/File.h>
 #include <osmscout/util/Geometry.h>
@@ -43,6 +44,38 @@ namespace osmscout {
     return indexOffset+((y-cellYStart)*cellXCount+x-cellXStart)*dataOffsetBytes;
   }
 
+  /**
+   * Calculates the range of index cells covered by the given bounding box. Returns false,
+   * if the bounding box does not overlap with the cells of this type at all.
+   */
+  bool AreaNodeIndex::TypeData::GetCellRange(const GeoBox& boundingBox,
+                                             uint32_t& minxc,
+                                             uint32_t& maxxc,
+                                             uint32_t& minyc,
+                                             uint32_t& maxyc) const
+  {
+    if (boundingBox.GetMaxLon()<minLon ||
+        boundingBox.GetMinLon()>=maxLon ||
+        boundingBox.GetMaxLat()<minLat ||
+        boundingBox.GetMinLat()>=maxLat) {
+      return false;
+    }
+
+    minxc=(uint32_t)floor((boundingBox.GetMinLon()+180.0)/cellWidth);
+    maxxc=(uint32_t)floor((boundingBox.GetMaxLon()+180.0)/cellWidth);
+
+    minyc=(uint32_t)floor((boundingBox.GetMinLat()+90.0)/cellHeight);
+    maxyc=(uint32_t)floor((boundingBox.GetMaxLat()+90.0)/cellHeight);
+
+    minxc=std::max(minxc,cellXStart);
+    maxxc=std::min(maxxc,cellXEnd);
+
+    minyc=std::max(minyc,cellYStart);
+    maxyc=std::min(maxyc,cellYEnd);
+
+    return true;
+  }
+
   AreaNodeIndex::TypeData::TypeData()
   : indexLevel(0),
     indexOffset(0),
@@ -141,27 +174,21 @@ namespace osmscout {
       return true;
     }
 
-    if (boundingBox.GetMaxLon()<typeData.minLon ||
-        boundingBox.GetMinLon()>=typeData.maxLon ||
-        boundingBox.GetMaxLat()<typeData.minLat ||
-        boundingBox.GetMinLat()>=typeData.maxLat) {
+    uint32_t minxc;
+    uint32_t maxxc;
+    uint32_t minyc;
+    uint32_t maxyc;
+
+    if (!typeData.GetCellRange(boundingBox,
+                               minxc,
+                               maxxc,
+                               minyc,
+                               maxyc)) {
 
       // No data available in given bounding box
       return true;
     }
 
-    uint32_t minxc=(uint32_t)floor((boundingBox.GetMinLon()+180.0)/typeData.cellWidth);
-    uint32_t maxxc=(uint32_t)floor((boundingBox.GetMaxLon()+180.0)/typeData.cellWidth);
-
-    uint32_t minyc=(uint32_t)floor((boundingBox.GetMinLat()+90.0)/typeData.cellHeight);
-    uint32_t maxyc=(uint32_t)floor((boundingBox.GetMaxLat()+90.0)/typeData.cellHeight);
-
-    minxc=std::max(minxc,typeData.cellXStart);
-    maxxc=std::min(maxxc,typeData.cellXEnd);
-
-    minyc=std::max(minyc,typeData.cellYStart);
-    maxyc=std::min(maxyc,typeData.cellYEnd);
-
     FileOffset dataOffset=typeData.GetDataOffset();
 
     // For each row
@@ -227,6 +254,84 @@ namespace osmscout {
     return true;
   }
 
+  bool AreaNodeIndex::GetOffsets(const TypeData& typeData,
+                                 const std::vector<GeoBox>& boundingBoxes,
+                                 std::vector<FileOffset>& offsets) const
+  {
+    if (typeData.indexOffset==0) {
+
+      // No data for this type available
+      return true;
+    }
+
+    // Cells by row and column, which is also the order in the file
+    std::set<std::pair<uint32_t,uint32_t>> cells;
+
+    for (const auto& boundingBox : boundingBoxes) {
+      uint32_t minxc;
+      uint32_t maxxc;
+      uint32_t minyc;
+      uint32_t maxyc;
+
+      if (!typeData.GetCellRange(boundingBox,
+                                 minxc,
+                                 maxxc,
+                                 minyc,
+                                 maxyc)) {
+        continue;
+      }
+
+      for (uint32_t y=minyc; y<=maxyc; y++) {
+        for (uint32_t x=minxc; x<=maxxc; x++) {
+          cells.insert(std::make_pair(y,x));
+        }
+      }
+    }
+
+    if (cells.empty()) {
+      return true;
+    }
+
+    std::lock_guard<std::mutex> guard(lookupMutex);
+    FileOffset                  dataOffset=typeData.GetDataOffset();
+
+    for (const auto& cell : cells) {
+      FileOffset cellDataOffset;
+
+      scanner.SetPos(typeData.GetCellOffset(cell.second,cell.first));
+      scanner.ReadFileOffset(cellDataOffset,
+                             typeData.dataOffsetBytes);
+
+      if (cellDataOffset==0) {
+        continue;
+      }
+
+      // We added +1 during import and now substract it again
+      cellDataOffset--;
+
+      scanner.SetPos(dataOffset+cellDataOffset);
+
+      uint32_t   dataCount;
+      FileOffset lastOffset=0;
+
+      scanner.ReadNumber(dataCount);
+
+      for (size_t d=0; d<dataCount; d++) {
+        FileOffset objectOffset;
+
+        scanner.ReadNumber(objectOffset);
+
+        objectOffset+=lastOffset;
+
+        offsets.push_back(objectOffset);
+
+        lastOffset=objectOffset;
+      }
+    }
+
+    return true;
+  }
+
   bool AreaNodeIndex::GetOffsets(const GeoBox& boundingBox,
                                  const TypeInfoSet& requestedTypes,
                                  std::vector<FileOffset>& offsets,
@@ -271,4 +376,46 @@ namespace osmscout {
 
     return true;
   }
+
+  bool AreaNodeIndex::GetOffsets(const std::vector<GeoBox>& boundingBoxes,
+                                 const TypeInfoSet& requestedTypes,
+                                 std::vector<FileOffset>& offsets,
+                                 TypeInfoSet& loadedTypes) const
+  {
+    StopClock time;
+
+    loadedTypes.Clear();
+
+    try {
+      for (const TypeInfoRef& type : requestedTypes) {
+        if (type->IsInternal()) {
+          continue;
+        }
+
+        auto typeNodeId=type->GetNodeId();
+        if (typeNodeId<nodeTypeData.size() &&
+            !GetOffsets(nodeTypeData[typeNodeId],boundingBoxes,offsets)) {
+          return false;
+        }
+
+        loadedTypes.Set(type);
+      }
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+
+      return false;
+    }
+
+    time.Stop();
+
+    if (time.GetMilliseconds()>100) {
+      log.Warn() << "Retrieving " << offsets.size()
+                 << " node offsets from area index for "
+                 << boundingBoxes.size() << " bounding boxes"
+                 << " took " << time.ResultString();
+    }
+
+    return true;
+  }
 }
@@ -20,6 +20,7 @@
 #include <osmscout/Database.h>
 
 #include <algorithm>
+#include <map>
 
 #if _OPENMP
 #include <omp.h>
@@ -28,17 +29,57 @@
 #include <osmscout/system/Assert.h>
 #include <osmscout/system/Math.h>
 
+#include <osmscout/util/File.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/FileWriter.h>
 #include <osmscout/util/Geometry.h>
 #include <osmscout/util/Logger.h>
 #include <osmscout/util/StopClock.h>
 
 namespace osmscout {
 
+  static const uint32_t cacheSnapshotVersion=1;
+  static const size_t   sharedCacheValueSize=4096; //!< Maximum size of a value in the shared cache
+
+  static const size_t   cacheWarmupChunkSize=256; //!< Number of snapshot entries loaded at once
+
+  /**
+   * Load the next chunk of the given offsets (most valuable first, as returned by
+   * DataFile::GetCachedOffsets()) into the cache of the given data file, starting
+   * at next. Returns false, if there are no offsets left.
+   */
+  template<class F>
+  static bool WarmupDataFile(const F& dataFile,
+                             const std::vector<FileOffset>& offsets,
+                             size_t& next,
+                             FileOffset& bytesRead)
+  {
+    if (next>=offsets.size()) {
+      return false;
+    }
+
+    size_t end=std::min(next+cacheWarmupChunkSize,offsets.size());
+
+    dataFile.LoadIntoCache(std::vector<FileOffset>(offsets.begin()+next,
+                                                   offsets.begin()+end),
+                           bytesRead);
+
+    next=end;
+
+    return true;
+  }
+
   DatabaseParameter::DatabaseParameter()
   : areaAreaIndexCacheSize(5000),
     nodeDataCacheSize(5000),
     wayDataCacheSize(10000),
     areaDataCacheSize(5000),
+    dataCacheShardCount(1),
+    dataCachePolicy(CachePolicy::LRU),
+    dataAsyncPrefetch(false),
+    cacheMemoryBudget(0),
+    cacheWarmupLimit(32*1024*1024),
+    sharedCacheSize(64*1024*1024),
     routerDataMMap(true),
     nodesDataMMap(true),
     areasDataMMap(true),
@@ -69,6 +110,81 @@ namespace osmscout {
     this->areaDataCacheSize=size;
   }
 
+  /**
+   * Number of independently locked shards the node, way and area data caches
+   * are split into. Increase this value (for example to the number of threads
+   * accessing the database in parallel) to reduce lock contention.
+   */
+  void DatabaseParameter::SetDataCacheShardCount(unsigned long count)
+  {
+    this->dataCacheShardCount=count;
+  }
+
+  void DatabaseParameter::SetDataCachePolicy(CachePolicy policy)
+  {
+    this->dataCachePolicy=policy;
+  }
+
+  /**
+   * If set, the node, way and area data files read the data of bulk requests
+   * using an AsyncFileReader instead of only advising the kernel. This
+   * helps on storage where advisory prefetching has no effect (network or
+   * FUSE file systems), see DataFile::SetAsyncPrefetch(). The same holds for
+   * the cells of the area index and the route node pages of the router.
+   */
+  void DatabaseParameter::SetDataAsyncPrefetch(bool asyncPrefetch)
+  {
+    this->dataAsyncPrefetch=asyncPrefetch;
+  }
+
+  /**
+   * Set an overall memory budget in bytes for the node, way and area data caches
+   * and the area area index cache. If set (not 0), the individual cache sizes
+   * are ignored and the budget is distributed dynamically, see MemoryBudget.
+   */
+  void DatabaseParameter::SetCacheMemoryBudget(size_t bytes)
+  {
+    this->cacheMemoryBudget=bytes;
+  }
+
+  /**
+   * Set the name of a file the hot cache entries are written to on Close()
+   * and read from on Open(). On Open() the entries are loaded in the background
+   * so the first requests after a restart hit warm caches. An empty filename
+   * (the default) disables the snapshot.
+   */
+  void DatabaseParameter::SetCacheSnapshotFile(const std::string& filename)
+  {
+    this->cacheSnapshotFile=filename;
+  }
+
+  /**
+   * Maximum number of bytes read while loading the cache snapshot on Open(),
+   * limiting the I/O caused by the warmup.
+   */
+  void DatabaseParameter::SetCacheWarmupLimit(size_t limit)
+  {
+    this->cacheWarmupLimit=limit;
+  }
+
+  /**
+   * Set the name of a POSIX shared memory segment used as an additional cache
+   * for index pages. All processes on the host using the same name share
+   * the decoded pages. An empty name (the default) disables the shared cache.
+   */
+  void DatabaseParameter::SetSharedCacheName(const std::string& name)
+  {
+    this->sharedCacheName=name;
+  }
+
+  /**
+   * Size in bytes of the shared memory segment, if it has to be created
+   */
+  void DatabaseParameter::SetSharedCacheSize(size_t bytes)
+  {
+    this->sharedCacheSize=bytes;
+  }
+
   void DatabaseParameter::SetRouterDataMMap(bool mmap)
   {
     routerDataMMap=mmap;
@@ -119,6 +235,46 @@ namespace osmscout {
     return areaDataCacheSize;
   }
 
+  unsigned long DatabaseParameter::GetDataCacheShardCount() const
+  {
+    return dataCacheShardCount;
+  }
+
+  CachePolicy DatabaseParameter::GetDataCachePolicy() const
+  {
+    return dataCachePolicy;
+  }
+
+  bool DatabaseParameter::GetDataAsyncPrefetch() const
+  {
+    return dataAsyncPrefetch;
+  }
+
+  size_t DatabaseParameter::GetCacheMemoryBudget() const
+  {
+    return cacheMemoryBudget;
+  }
+
+  std::string DatabaseParameter::GetCacheSnapshotFile() const
+  {
+    return cacheSnapshotFile;
+  }
+
+  size_t DatabaseParameter::GetCacheWarmupLimit() const
+  {
+    return cacheWarmupLimit;
+  }
+
+  std::string DatabaseParameter::GetSharedCacheName() const
+  {
+    return sharedCacheName;
+  }
+
+  size_t DatabaseParameter::GetSharedCacheSize() const
+  {
+    return sharedCacheSize;
+  }
+
   bool DatabaseParameter::GetRouterDataMMap() const
   {
     return routerDataMMap;
@@ -178,9 +334,14 @@ namespace osmscout {
 
   Database::Database(const DatabaseParameter& parameter)
    : parameter(parameter),
-     isOpen(false)
+     isOpen(false),
+     warmupAbort(false)
   {
     log.Debug() << "Database::Database()";
+
+    if (parameter.GetCacheMemoryBudget()>0) {
+      memoryBudget=std::make_shared<MemoryBudget>(parameter.GetCacheMemoryBudget());
+    }
   }
 
   Database::~Database()
@@ -205,8 +366,28 @@ namespace osmscout {
       return false;
     }
 
+    if (!parameter.GetSharedCacheName().empty()) {
+      sharedCache=std::make_shared<SharedMemoryCache>();
+
+      if (!sharedCache->Open(parameter.GetSharedCacheName(),
+                             parameter.GetSharedCacheSize(),
+                             sharedCacheValueSize)) {
+        log.Warn() << "Cannot open shared cache '" << parameter.GetSharedCacheName() << "', continuing without";
+        sharedCache=nullptr;
+      }
+    }
+
     isOpen=true;
 
+    if (!parameter.GetCacheSnapshotFile().empty() &&
+        ExistsInFilesystem(parameter.GetCacheSnapshotFile())) {
+      warmupAbort=false;
+      warmupThread=std::thread([this]() {
+        LoadCacheSnapshot(this->parameter.GetCacheSnapshotFile(),
+                          this->parameter.GetCacheWarmupLimit());
+      });
+    }
+
     return true;
   }
 
@@ -217,23 +398,51 @@ namespace osmscout {
 
   void Database::Close()
   {
+    if (warmupThread.joinable()) {
+      warmupAbort=true;
+      warmupThread.join();
+    }
+
+    if (isOpen &&
+        !parameter.GetCacheSnapshotFile().empty()) {
+      SaveCacheSnapshot(parameter.GetCacheSnapshotFile());
+    }
+
     boundingBoxDataFile=nullptr;
 
-    if (nodeDataFile &&
-        nodeDataFile->IsOpen()) {
-      nodeDataFile->Close();
+    if (nodeDataFile) {
+      if (memoryBudget) {
+        memoryBudget->Unregister(*nodeDataFile);
+      }
+
+      if (nodeDataFile->IsOpen()) {
+        nodeDataFile->Close();
+      }
+
       nodeDataFile=nullptr;
     }
 
-    if (areaDataFile &&
-        areaDataFile->IsOpen()) {
-      areaDataFile->Close();
+    if (areaDataFile) {
+      if (memoryBudget) {
+        memoryBudget->Unregister(*areaDataFile);
+      }
+
+      if (areaDataFile->IsOpen()) {
+        areaDataFile->Close();
+      }
+
       areaDataFile=nullptr;
     }
 
-    if (wayDataFile &&
-        wayDataFile->IsOpen()) {
-      wayDataFile->Close();
+    if (wayDataFile) {
+      if (memoryBudget) {
+        memoryBudget->Unregister(*wayDataFile);
+      }
+
+      if (wayDataFile->IsOpen()) {
+        wayDataFile->Close();
+      }
+
       wayDataFile=nullptr;
     }
 
@@ -243,6 +452,10 @@ namespace osmscout {
     }
 
     if (areaAreaIndex) {
+      if (memoryBudget) {
+        memoryBudget->Unregister(*areaAreaIndex);
+      }
+
       areaAreaIndex->Close();
       areaAreaIndex=nullptr;
     }
@@ -271,6 +484,9 @@ namespace osmscout {
       optimizeAreasLowZoom=nullptr;
     }
 
+    // Users of the shared cache still holding a reference keep it mapped
+    sharedCache=nullptr;
+
     isOpen=false;
   }
 
@@ -314,6 +530,10 @@ namespace osmscout {
 
   NodeDataFileRef Database::GetNodeDataFile() const
   {
+    if (memoryBudget) {
+      memoryBudget->RebalanceIfDue();
+    }
+
     std::lock_guard<std::mutex> guard(nodeDataFileMutex);
 
     if (!IsOpen()) {
@@ -321,7 +541,15 @@ namespace osmscout {
     }
 
     if (!nodeDataFile) {
-      nodeDataFile=std::make_shared<NodeDataFile>(parameter.GetNodeDataCacheSize());
+      nodeDataFile=std::make_shared<NodeDataFile>(parameter.GetNodeDataCacheSize(),
+                                                  parameter.GetDataCacheShardCount());
+
+      nodeDataFile->SetCachePolicy(parameter.GetDataCachePolicy());
+      nodeDataFile->SetAsyncPrefetch(parameter.GetDataAsyncPrefetch());
+
+      if (memoryBudget) {
+        memoryBudget->Register(*nodeDataFile);
+      }
     }
 
     if (!nodeDataFile->IsOpen()) {
@@ -344,6 +572,10 @@ namespace osmscout {
 
   AreaDataFileRef Database::GetAreaDataFile() const
   {
+    if (memoryBudget) {
+      memoryBudget->RebalanceIfDue();
+    }
+
     std::lock_guard<std::mutex> guard(areaDataFileMutex);
 
     if (!IsOpen()) {
@@ -351,7 +583,15 @@ namespace osmscout {
     }
 
     if (!areaDataFile) {
-      areaDataFile=std::make_shared<AreaDataFile>(parameter.GetAreaDataCacheSize());
+      areaDataFile=std::make_shared<AreaDataFile>(parameter.GetAreaDataCacheSize(),
+                                                  parameter.GetDataCacheShardCount());
+
+      areaDataFile->SetCachePolicy(parameter.GetDataCachePolicy());
+      areaDataFile->SetAsyncPrefetch(parameter.GetDataAsyncPrefetch());
+
+      if (memoryBudget) {
+        memoryBudget->Register(*areaDataFile);
+      }
     }
 
     if (!areaDataFile->IsOpen()) {
@@ -374,6 +614,10 @@ namespace osmscout {
 
   WayDataFileRef Database::GetWayDataFile() const
   {
+    if (memoryBudget) {
+      memoryBudget->RebalanceIfDue();
+    }
+
     std::lock_guard<std::mutex> guard(wayDataFileMutex);
 
     if (!IsOpen()) {
@@ -381,7 +625,15 @@ namespace osmscout {
     }
 
     if (!wayDataFile) {
-      wayDataFile=std::make_shared<WayDataFile>(parameter.GetWayDataCacheSize());
+      wayDataFile=std::make_shared<WayDataFile>(parameter.GetWayDataCacheSize(),
+                                                parameter.GetDataCacheShardCount());
+
+      wayDataFile->SetCachePolicy(parameter.GetDataCachePolicy());
+      wayDataFile->SetAsyncPrefetch(parameter.GetDataAsyncPrefetch());
+
+      if (memoryBudget) {
+        memoryBudget->Register(*wayDataFile);
+      }
     }
 
     if (!wayDataFile->IsOpen()) {
@@ -432,6 +684,10 @@ namespace osmscout {
 
   AreaAreaIndexRef Database::GetAreaAreaIndex() const
   {
+    if (memoryBudget) {
+      memoryBudget->RebalanceIfDue();
+    }
+
     std::lock_guard<std::mutex> guard(areaAreaIndexMutex);
 
     if (!IsOpen()) {
@@ -441,6 +697,8 @@ namespace osmscout {
     if (!areaAreaIndex) {
       areaAreaIndex=std::make_shared<AreaAreaIndex>(parameter.GetAreaAreaIndexCacheSize());
 
+      areaAreaIndex->SetAsyncPrefetch(parameter.GetDataAsyncPrefetch());
+
       StopClock timer;
 
       if (!areaAreaIndex->Open(path, parameter.GetIndexMMap())) {
@@ -453,6 +711,10 @@ namespace osmscout {
       timer.Stop();
 
       log.Debug() << "Opening AreaAreaIndex: " << timer.ResultString();
+
+      if (memoryBudget) {
+        memoryBudget->Register(*areaAreaIndex);
+      }
     }
 
     return areaAreaIndex;
@@ -614,6 +876,235 @@ namespace osmscout {
     return true;
   }
 
+  /**
+   * Write the keys of the currently cached objects and index cells to the
+   * given file. Only caches of data files and indexes already in use are written.
+   *
+   * Method is thread-safe.
+   */
+  bool Database::SaveCacheSnapshot(const std::string& filename) const
+  {
+    std::map<std::string,std::vector<FileOffset>> sections;
+
+    {
+      std::lock_guard<std::mutex> guard(nodeDataFileMutex);
+
+      if (nodeDataFile) {
+        nodeDataFile->GetCachedOffsets(sections[NodeDataFile::NODES_DAT]);
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(wayDataFileMutex);
+
+      if (wayDataFile) {
+        wayDataFile->GetCachedOffsets(sections[WayDataFile::WAYS_DAT]);
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(areaDataFileMutex);
+
+      if (areaDataFile) {
+        areaDataFile->GetCachedOffsets(sections[AreaDataFile::AREAS_DAT]);
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(areaAreaIndexMutex);
+
+      if (areaAreaIndex) {
+        areaAreaIndex->GetCachedCellOffsets(sections[AreaAreaIndex::AREA_AREA_IDX]);
+      }
+    }
+
+    // Write to a temporary file first, so a crash never leaves a broken snapshot
+    std::string tmpFilename=filename+".tmp";
+    FileWriter  writer;
+
+    try {
+      writer.Open(tmpFilename);
+
+      writer.Write(cacheSnapshotVersion);
+      writer.Write((uint32_t)sections.size());
+
+      for (const auto& section : sections) {
+        writer.Write(section.first);
+        // Allows to detect snapshots of another version of the database
+        writer.WriteFileOffset(GetFileSize(AppendFileToDir(path,section.first)));
+        writer.Write((uint32_t)section.second.size());
+
+        for (const auto offset : section.second) {
+          writer.WriteFileOffset(offset);
+        }
+      }
+
+      writer.Close();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      writer.CloseFailsafe();
+      RemoveFile(tmpFilename);
+      return false;
+    }
+
+    RemoveFile(filename);
+
+    if (!RenameFile(tmpFilename,filename)) {
+      log.Error() << "Cannot rename '" << tmpFilename << "' to '" << filename << "'";
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Load the objects and index cells listed in the given snapshot file (as
+   * written by SaveCacheSnapshot()) into the caches. Loading stops after limit bytes have been read.
+   * Sections of the snapshot written for a different version of a data file
+   * are skipped.
+   *
+   * Method is thread-safe. It is automatically called in the background on Open(),
+   * if a snapshot file is configured.
+   */
+  bool Database::LoadCacheSnapshot(const std::string& filename,
+                                   size_t limit)
+  {
+    std::map<std::string,std::vector<FileOffset>> sections;
+    FileScanner                                   scanner;
+
+    try {
+      FileOffset snapshotSize=GetFileSize(filename);
+      uint32_t   version;
+      uint32_t   sectionCount;
+
+      scanner.Open(filename,
+                   FileScanner::Sequential,
+                   false);
+
+      scanner.Read(version);
+
+      if (version!=cacheSnapshotVersion) {
+        log.Warn() << "Cache snapshot '" << filename << "' has unsupported version " << version;
+        scanner.Close();
+        return false;
+      }
+
+      scanner.Read(sectionCount);
+
+      for (uint32_t s=0; s<sectionCount; s++) {
+        std::string             name;
+        FileOffset              fileSize;
+        uint32_t                count;
+        std::vector<FileOffset> offsets;
+
+        scanner.Read(name);
+        scanner.ReadFileOffset(fileSize);
+        scanner.Read(count);
+
+        // Each entry is a file offset of fixed size
+        if (count>(snapshotSize-scanner.GetPos())/8) {
+          log.Error() << "Cache snapshot '" << filename << "' is corrupt, section '" << name << "' has "
+                      << count << " entries, but the file is too small";
+          scanner.Close();
+          return false;
+        }
+
+        offsets.resize(count);
+
+        for (auto& offset : offsets) {
+          scanner.ReadFileOffset(offset);
+        }
+
+        std::string datafile=AppendFileToDir(path,name);
+
+        if (!ExistsInFilesystem(datafile) ||
+            GetFileSize(datafile)!=fileSize) {
+          log.Warn() << "Cache snapshot for '" << name << "' does not match the database, ignoring";
+          continue;
+        }
+
+        sections[name].swap(offsets);
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner.CloseFailsafe();
+      return false;
+    }
+
+    StopClock  timer;
+    FileOffset bytesRead=0;
+    size_t     loaded=0;
+
+    // Index cells first, they are small and required for every area lookup
+    const std::vector<FileOffset>& cells=sections[AreaAreaIndex::AREA_AREA_IDX];
+
+    if (!cells.empty()) {
+      AreaAreaIndexRef index=GetAreaAreaIndex();
+
+      if (index) {
+        while (loaded<cells.size() &&
+               bytesRead<limit &&
+               !warmupAbort) {
+          size_t end=std::min(loaded+cacheWarmupChunkSize,cells.size());
+
+          index->LoadCells(std::vector<FileOffset>(cells.begin()+loaded,
+                                                   cells.begin()+end),
+                           bytesRead);
+          loaded=end;
+        }
+      }
+    }
+
+    // Load the data files chunk by chunk round robin, most valuable entries first,
+    // so every cache gets its hottest entries before the limit is reached.
+    // Within the cache the order of the chunks is thus not restored.
+    const std::vector<FileOffset>& nodes=sections[NodeDataFile::NODES_DAT];
+    const std::vector<FileOffset>& ways=sections[WayDataFile::WAYS_DAT];
+    const std::vector<FileOffset>& areas=sections[AreaDataFile::AREAS_DAT];
+    NodeDataFileRef                nodeFile=nodes.empty() ? nullptr : GetNodeDataFile();
+    WayDataFileRef                 wayFile=ways.empty() ? nullptr : GetWayDataFile();
+    AreaDataFileRef                areaFile=areas.empty() ? nullptr : GetAreaDataFile();
+    size_t                         nextNode=0;
+    size_t                         nextWay=0;
+    size_t                         nextArea=0;
+    bool                           pending=true;
+
+    while (pending &&
+           bytesRead<limit &&
+           !warmupAbort) {
+      pending=false;
+
+      if (nodeFile &&
+          WarmupDataFile(*nodeFile,nodes,nextNode,bytesRead)) {
+        pending=true;
+      }
+
+      if (wayFile &&
+          bytesRead<limit &&
+          WarmupDataFile(*wayFile,ways,nextWay,bytesRead)) {
+        pending=true;
+      }
+
+      if (areaFile &&
+          bytesRead<limit &&
+          WarmupDataFile(*areaFile,areas,nextArea,bytesRead)) {
+        pending=true;
+      }
+    }
+
+    loaded+=nextNode+nextWay+nextArea;
+
+    timer.Stop();
+
+    log.Debug() << "Loading " << loaded << " cache entries (" << bytesRead << " bytes) from snapshot: " << timer.ResultString();
+
+    return true;
+  }
+
   bool Database::GetNodeByOffset(const FileOffset& offset,
                                  NodeRef& node) const
   {
@@ -990,6 +1481,18 @@ namespace osmscout {
 
   void Database::DumpStatistics()
   {
+    if (nodeDataFile) {
+      nodeDataFile->DumpStatistics();
+    }
+
+    if (areaDataFile) {
+      areaDataFile->DumpStatistics();
+    }
+
+    if (wayDataFile) {
+      wayDataFile->DumpStatistics();
+    }
+
     if (areaAreaIndex) {
       areaAreaIndex->DumpStatistics();
     }
@@ -24,9 +24,19 @@ namespace osmscout {
   const char* NodeDataFile::NODES_DAT="nodes.dat";
   const char* NodeDataFile::NODES_IDMAP="nodes.idmap";
 
-  NodeDataFile::NodeDataFile(size_t cacheSize)
-  : DataFile<Node>(NODES_DAT,cacheSize)
+  NodeDataFile::NodeDataFile(size_t cacheSize,
+                             size_t cacheShardCount)
+  : DataFile<Node>(NODES_DAT,cacheSize,cacheShardCount)
   {
     // no code
   }
+
+  /**
+   * Return the estimated memory of the node
+   */
+  size_t NodeDataFile::GetValueMemory(const Node& node) const
+  {
+    return sizeof(Node)+
+           node.GetFeatureValueBuffer().GetAllocatedMemory();
+  }
 }
@@ -0,0 +1,96 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/PointsView.h>
+
+#include <algorithm>
+
+namespace osmscout {
+
+  PointsView::PointsView()
+  : nodeCount(0),
+    coordBitSize(0),
+    hasSerials(false),
+    memoryMapped(false),
+    firstLat(0),
+    firstLon(0),
+    deltaData(nullptr),
+    serialData(nullptr)
+  {
+    // no code
+  }
+
+  /**
+   * Reset the view to an empty list of points. The internal buffer
+   * is kept for reuse.
+   */
+  void PointsView::Clear()
+  {
+    nodeCount=0;
+    coordBitSize=0;
+    hasSerials=false;
+    memoryMapped=false;
+    firstLat=0;
+    firstLon=0;
+    deltaData=nullptr;
+    serialData=nullptr;
+    storage.clear();
+  }
+
+  /**
+   * Return the bounding box of all points in the view. The box is
+   * invalid, if the view is empty.
+   */
+  GeoBox PointsView::GetBoundingBox() const
+  {
+    if (empty()) {
+      return GeoBox();
+    }
+
+    const_iterator point=begin();
+    double         minLat=point->GetLat();
+    double         maxLat=minLat;
+    double         minLon=point->GetLon();
+    double         maxLon=minLon;
+
+    for (++point; point!=end(); ++point) {
+      minLat=std::min(minLat,point->GetLat());
+      maxLat=std::max(maxLat,point->GetLat());
+      minLon=std::min(minLon,point->GetLon());
+      maxLon=std::max(maxLon,point->GetLon());
+    }
+
+    return GeoBox(GeoCoord(minLat,minLon),
+                  GeoCoord(maxLat,maxLon));
+  }
+
+  /**
+   * Decode all points of the view into the given vector. The result is
+   * identical to FileScanner::Read(std::vector<Point>&,bool).
+   */
+  void PointsView::CopyTo(std::vector<Point>& nodes) const
+  {
+    nodes.clear();
+    nodes.reserve(nodeCount);
+
+    for (const auto& point : *this) {
+      nodes.push_back(point);
+    }
+  }
+}
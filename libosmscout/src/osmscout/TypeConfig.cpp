@@ -330,6 +330,19 @@ namespace osmscout {
 
   void FeatureValueBuffer::SetType(const TypeInfoRef& type)
   {
+    // Same type again (for example when reusing a view for reading
+    // a sequence of objects), keep the buffers and just drop the values
+    if (this->type &&
+        this->type==type) {
+      ClearFeatureValues();
+
+      if (featureBits!=nullptr) {
+        std::fill(featureBits,featureBits+type->GetFeatureMaskBytes(),0);
+      }
+
+      return;
+    }
+
     if (this->type) {
       DeleteData();
     }
@@ -153,4 +153,32 @@ namespace osmscout {
 
     writer.Write(nodes,false);
   }
+
+  /**
+   * Read the data from the given FileScanner. The list of nodes is not decoded
+   * but referenced in its encoded form.
+   *
+   * @throws IOException
+   */
+  void WayView::Read(const TypeConfig& typeConfig,
+                     FileScanner& scanner)
+  {
+    TypeId typeId;
+
+    fileOffset=scanner.GetPos();
+
+    scanner.ReadTypeId(typeId,
+                       typeConfig.GetWayTypeIdBytes());
+
+    TypeInfoRef type=typeConfig.GetWayTypeInfo(typeId);
+
+    featureValueBuffer.SetType(type);
+
+    featureValueBuffer.Read(scanner);
+
+    scanner.Read(nodes,
+                 type->CanRoute() ||
+                 type->GetOptimizeLowZoom());
+    nextFileOffset=scanner.GetPos();
+  }
 }
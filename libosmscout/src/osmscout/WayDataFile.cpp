@@ -24,9 +24,20 @@ namespace osmscout {
   const char* WayDataFile::WAYS_DAT="ways.dat";
   const char* WayDataFile::WAYS_IDMAP="ways.idmap";
 
-  WayDataFile::WayDataFile(size_t cacheSize)
-  : DataFile<Way>(WAYS_DAT,cacheSize)
+  WayDataFile::WayDataFile(size_t cacheSize,
+                           size_t cacheShardCount)
+  : DataFile<Way>(WAYS_DAT,cacheSize,cacheShardCount)
   {
     // no code
   }
+
+  /**
+   * Return the estimated memory of the way including its nodes
+   */
+  size_t WayDataFile::GetValueMemory(const Way& way) const
+  {
+    return sizeof(Way)+
+           way.GetFeatureValueBuffer().GetAllocatedMemory()+
+           way.nodes.capacity()*sizeof(Point);
+  }
 }
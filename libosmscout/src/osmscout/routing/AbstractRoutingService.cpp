@@ -34,6 +34,7 @@
 
 #include <iomanip>
 #include <iostream>
+#include <limits>
 
 //#define DEBUG_ROUTING
 
@@ -50,6 +51,45 @@ namespace osmscout {
   {
   }
 
+  /**
+   * Take an idle query context from the pool or create a new one, if all
+   * contexts are currently in use.
+   *
+   * Method is thread-safe.
+   */
+  template <class RoutingState>
+  typename AbstractRoutingService<RoutingState>::QueryContextRef AbstractRoutingService<RoutingState>::AcquireQueryContext()
+  {
+    {
+      std::lock_guard<std::mutex> lock(queryContextMutex);
+
+      if (!idleQueryContexts.empty()) {
+        QueryContextRef context=std::move(idleQueryContexts.back());
+
+        idleQueryContexts.pop_back();
+
+        return context;
+      }
+    }
+
+    return QueryContextRef(new QueryContext());
+  }
+
+  /**
+   * Clear the given query context and return it to the pool.
+   *
+   * Method is thread-safe.
+   */
+  template <class RoutingState>
+  void AbstractRoutingService<RoutingState>::ReleaseQueryContext(QueryContextRef&& context)
+  {
+    context->Clear();
+
+    std::lock_guard<std::mutex> lock(queryContextMutex);
+
+    idleQueryContexts.push_back(std::move(context));
+  }
+
   template <class RoutingState>
   void AbstractRoutingService<RoutingState>::ResolveRNodeChainToList(DBId finalRouteNode,
                                                                      const ClosedSet& closedSet,
@@ -57,11 +97,11 @@ namespace osmscout {
                                                                      std::list<VNode>& nodes)
   {
     bool restricted=false;
-    auto current=closedSet.find(VNode(finalRouteNode));
+    const VNode* current=closedSet.Find(finalRouteNode);
 
-    if (current==closedSet.end()){
-      current=closedRestrictedSet.find(VNode(finalRouteNode));
-      assert(current!=closedSet.end());
+    if (current==nullptr){
+      current=closedRestrictedSet.Find(finalRouteNode);
+      assert(current!=nullptr);
       restricted=true;
     }
 
@@ -69,19 +109,19 @@ namespace osmscout {
 #if defined(DEBUG_ROUTING)
       std::cout << "Chain item " << current->currentNode << " -> " << current->previousNode << std::endl;
 #endif
-      ClosedSet::const_iterator prev;
+      const VNode* prev;
       if (!restricted){
-        prev=closedSet.find(VNode(current->previousNode));
-        if (prev==closedSet.end()){
-          prev=closedRestrictedSet.find(VNode(current->previousNode));
-          assert(prev!=closedRestrictedSet.end());
+        prev=closedSet.Find(current->previousNode);
+        if (prev==nullptr){
+          prev=closedRestrictedSet.Find(current->previousNode);
+          assert(prev!=nullptr);
           restricted=true;
         }
       }else{
-        prev=closedRestrictedSet.find(VNode(current->previousNode));
-        if (prev==closedRestrictedSet.end()){
-          prev=closedSet.find(VNode(current->previousNode));
-          assert(prev!=closedSet.end());
+        prev=closedRestrictedSet.Find(current->previousNode);
+        if (prev==nullptr){
+          prev=closedSet.Find(current->previousNode);
+          assert(prev!=nullptr);
           restricted=false;
         }
       }
@@ -522,7 +562,7 @@ namespace osmscout {
   template <class RoutingState>
   bool AbstractRoutingService<RoutingState>::WalkToOtherDatabases(const RoutingState& state,
                                                                   RNodeRef &current,
-                                                                  RouteNodeRef &currentRouteNode,
+                                                                  RouteNodeRef &/*currentRouteNode*/,
                                                                   OpenList &openList,
                                                                   OpenMap &openMap,
                                                                   const ClosedSet &closedSet,
@@ -531,22 +571,22 @@ namespace osmscout {
     // add twin nodes to nextNode from other databases to open list
     std::vector<DBId> twins=GetNodeTwins(state,
                                          current->id.database,
-                                         currentRouteNode->GetId());
+                                         current->id.id);
     for (const auto& twin : twins) {
       if ((current->access &&
-           closedSet.find(VNode(twin))!=closedSet.end()) ||
+           closedSet.Contains(twin)) ||
           (!current->access &&
-            closedRestrictedSet.find(VNode(twin))!=closedRestrictedSet.end())){
+           closedRestrictedSet.Contains(twin))){
 #if defined(DEBUG_ROUTING)
         std::cout << "Twin node " << twin << " is closed already, ignore it" << std::endl;
 #endif
         continue;
       }
 
-      auto twinIt=openMap.find(twin);
+      RNode** twinEntry=openMap.Find(twin);
 
-      if (twinIt!=openMap.end()){
-        RNodeRef rn=(*twinIt->second);
+      if (twinEntry!=nullptr){
+        RNode* rn=*twinEntry;
         if (rn->currentCost > current->currentCost) {
           // this is cheaper path to twin
 
@@ -558,10 +598,7 @@ namespace osmscout {
           rn->overallCost=current->overallCost;
           rn->access=current->access;
 
-          openList.erase(twinIt->second);
-
-          std::pair<OpenListRef,bool> insertResult=openList.insert(rn);
-          twinIt->second=insertResult.first;
+          openList.Update(*rn);
 
 #if defined(DEBUG_ROUTING)
           std::cout << "Better transition from " << rn->prev << " to " << rn->id << std::endl;
@@ -584,8 +621,8 @@ namespace osmscout {
         rn->overallCost=current->overallCost;
         rn->access=current->access;
 
-        std::pair<OpenListRef,bool> insertResult=openList.insert(rn);
-        openMap[rn->id]=insertResult.first;
+        openList.Push(rn);
+        openMap[rn->id]=rn.get();
 
 #if defined(DEBUG_ROUTING)
         std::cout << "Transition from " << rn->prev << " to " << rn->id << std::endl;
@@ -595,8 +632,21 @@ namespace osmscout {
     return true;
   }
 
+  /**
+   * Called once per route calculation before the search starts. Derived classes may
+   * fill the query context with data, that stays the same during the whole search,
+   * instead of retrieving it again for each route node.
+   */
+  template <class RoutingState>
+  bool AbstractRoutingService<RoutingState>::PrepareQuery(const RoutingState& /*state*/,
+                                                          QueryContext& /*context*/)
+  {
+    return true;
+  }
+
   template <class RoutingState>
   bool AbstractRoutingService<RoutingState>::WalkPaths(const RoutingState &state,
+                                                       const QueryContext& /*context*/,
                                                        RNodeRef &current,
                                                        RouteNodeRef &currentRouteNode,
                                                        OpenList &openList,
@@ -658,9 +708,9 @@ namespace osmscout {
       }
 
       if ((current->access &&
-           closedSet.find(VNode(DBId(dbId,path.id)))!=closedSet.end()) ||
+           closedSet.Contains(DBId(dbId,path.id))) ||
           (!current->access &&
-           closedRestrictedSet.find(VNode(DBId(dbId,path.id)))!=closedRestrictedSet.end())) {
+           closedRestrictedSet.Contains(DBId(dbId,path.id)))) {
 #if defined(DEBUG_ROUTING)
         std::cout << "  Skipping route";
         std::cout << " to " << dbId << " / " << path.id;
@@ -672,45 +722,35 @@ namespace osmscout {
         continue;
       }
 
-      if (!currentRouteNode->excludes.empty()) {
-        bool canTurnedInto=true;
-
-        for (const auto& exclude : currentRouteNode->excludes) {
-          if (exclude.source==current->object &&
-              currentRouteNode->objects[exclude.targetIndex].object==currentRouteNode->objects[path.objectIndex].object) {
+      if (!currentRouteNode->IsTurnAllowed(current->object,
+                                           currentRouteNode->objects[path.objectIndex].object)) {
 #if defined(DEBUG_ROUTING)
-            std::cout << "  Skipping route";
-            std::cout << " to " << dbId << " / " << path.id;
-            std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetName() << ")";
-            std::cout << " => turn not allowed" << std::endl;
+        std::cout << "  Skipping route";
+        std::cout << " to " << dbId << " / " << path.id;
+        std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetName() << ")";
+        std::cout << " => turn not allowed" << std::endl;
 #endif
-            canTurnedInto=false;
-            break;
-          }
-        }
-
-        if (!canTurnedInto) {
-          nodesIgnoredCount++;
-          i++;
+        nodesIgnoredCount++;
+        i++;
 
-          continue;
-        }
+        continue;
       }
 
       double currentCost=current->currentCost+GetCosts(state,dbId,*currentRouteNode,i);
 
-      auto openEntry=openMap.find(DBId(current->id.database,
-                                       path.id));
+      RNode** openEntryRef=openMap.Find(DBId(current->id.database,
+                                             path.id));
+      RNode*  openEntry=openEntryRef!=nullptr ? *openEntryRef : nullptr;
 
       // Check, if we already have a cheaper path to the new node. If yes, do not put the new path
       // into the open list
-      if (openEntry!=openMap.end() &&
-          (*openEntry->second)->currentCost<=currentCost) {
+      if (openEntry!=nullptr &&
+          openEntry->currentCost<=currentCost) {
 #if defined(DEBUG_ROUTING)
         std::cout << "  Skipping route";
         std::cout << " to " << dbId << " / " << path.id;
         std::cout << " (" << currentRouteNode->objects[path.objectIndex].object.GetName() << ")";
-        std::cout << " => cheaper route exists " << currentCost << "<=>" << (*openEntry->second)->object.GetName() << " " << (*openEntry->second)->node->GetId() << " " << (*openEntry->second)->currentCost << std::endl;
+        std::cout << " => cheaper route exists " << currentCost << "<=>" << openEntry->object.GetName() << " " << openEntry->node->GetId() << " " << openEntry->currentCost << std::endl;
 #endif
         i++;
 
@@ -719,8 +759,8 @@ namespace osmscout {
 
       RouteNodeRef nextNode;
 
-      if (openEntry!=openMap.end()) {
-        nextNode=(*openEntry->second)->node;
+      if (openEntry!=nullptr) {
+        nextNode=openEntry->node;
       }
       else if (!GetRouteNode(DBId(current->id.database,
                                   path.id),
@@ -759,8 +799,8 @@ namespace osmscout {
 
       // If we already have the node in the open list, but the new path is cheaper (as tested above),
       // update the existing entry
-      if (openEntry!=openMap.end()) {
-        RNodeRef node=*openEntry->second;
+      if (openEntry!=nullptr) {
+        RNode* node=openEntry;
 
         node->prev=current->id;
         node->object=currentRouteNode->objects[path.objectIndex].object;
@@ -774,10 +814,7 @@ namespace osmscout {
         std::cout << "  Updating route " << current->id << " via " << node->object.GetTypeName() << " " << node->object.GetFileOffset() << " " << currentCost << " " << estimateCost << " " << overallCost << " " << currentRouteNode->GetId() << std::endl;
 #endif
 
-        openList.erase(openEntry->second);
-
-        std::pair<OpenListRef,bool> insertResult=openList.insert(node);
-        openEntry->second=insertResult.first;
+        openList.Update(*node);
       }
       else {
         RNodeRef node=std::make_shared<RNode>(DBId(dbId,path.id),
@@ -796,8 +833,8 @@ namespace osmscout {
         std::cout << " " << currentCost << " " << estimateCost << " " << overallCost << " " << currentRouteNode->GetId() << std::endl;
 #endif
 
-        std::pair<OpenListRef,bool> insertResult=openList.insert(node);
-        openMap[node->id]=insertResult.first;
+        openList.Push(node);
+        openMap[node->id]=node.get();
       }
 
       i++;
@@ -828,6 +865,13 @@ namespace osmscout {
                                                                      const RoutePosition& target,
                                                                      const RoutingParameter& parameter)
   {
+    if (parameter.IsBidirectional()) {
+      return CalculateRouteBidirectional(state,
+                                         start,
+                                         target,
+                                         parameter);
+    }
+
     RoutingResult            result;
     Vehicle                  vehicle=GetVehicle(state);
     RouteNodeRef             startForwardRouteNode;
@@ -841,26 +885,29 @@ namespace osmscout {
     RouteNodeRef             targetForwardRouteNode;
     RouteNodeRef             targetBackwardRouteNode;
 
-    // Sorted list (smallest cost first) of ways to check (we are using a std::set)
-    OpenList                 openList;
+    QueryContextLease        context(*this);
+
+    // Heap (smallest cost first) of ways to check
+    OpenList&                openList=context.Get().openList;
     // Map routing nodes by id
-    OpenMap                  openMap;
+    OpenMap&                 openMap=context.Get().openMap;
 
     // Restricted way (access=destination) is a way that may be used just
     // in case when target is on this way. Some routing nodes may be accessed
     // from two different ways - one without any access restriction (closedSet)
     // and second with restriction (closedRestrictedSet)
-    ClosedSet                closedSet;
-    ClosedSet                closedRestrictedSet;
+    ClosedSet&               closedSet=context.Get().closedSet;
+    ClosedSet&               closedRestrictedSet=context.Get().closedRestrictedSet;
 
     size_t                   nodesLoadedCount=0;
     size_t                   nodesIgnoredCount=0;
     size_t                   maxOpenList=0;
     size_t                   maxClosedSet=0;
 
-    openMap.reserve(10000);
-    closedSet.reserve(300000);
-    closedRestrictedSet.reserve(10000);
+    if (!PrepareQuery(state,
+                      context.Get())) {
+      return result;
+    }
 
     if (!GetTargetNodes(state,
                         target,
@@ -906,15 +953,13 @@ namespace osmscout {
     }
 
     if (startForwardNode) {
-      std::pair<OpenListRef,bool> insertResult=openList.insert(startForwardNode);
-
-      openMap[startForwardNode->id]=insertResult.first;
+      openList.Push(startForwardNode);
+      openMap[startForwardNode->id]=startForwardNode.get();
     }
 
     if (startBackwardNode) {
-      std::pair<OpenListRef,bool> insertResult=openList.insert(startBackwardNode);
-
-      openMap[startBackwardNode->id]=insertResult.first;
+      openList.Push(startBackwardNode);
+      openMap[startBackwardNode->id]=startBackwardNode.get();
     }
 
 
@@ -946,10 +991,9 @@ namespace osmscout {
         return result;
       }
 
-      current=*openList.begin();
+      current=openList.Pop();
 
-      openMap.erase(current->id);
-      openList.erase(openList.begin());
+      openMap.Erase(current->id);
 
       currentRouteNode=current->node;
       dbId=current->id.database;
@@ -959,12 +1003,13 @@ namespace osmscout {
       // Get potential follower in the current way
 
 #if defined(DEBUG_ROUTING)
-      std::cout << "Analysing follower of node " << dbId << " / " << currentRouteNode->GetId();
-      std::cout << " (" << current->object.GetName() << "["  << currentRouteNode->GetId() << "]" << ")";
+      std::cout << "Analysing follower of node " << dbId << " / " << current->id.id;
+      std::cout << " (" << current->object.GetName() << "["  << current->id.id << "]" << ")";
       std::cout << " " << current->currentCost << " " << current->estimateCost << " " << current->overallCost << std::endl;
 #endif
 
       if (!WalkPaths(state,
+                     context.Get(),
                      current,
                      currentRouteNode,
                      openList,
@@ -980,7 +1025,7 @@ namespace osmscout {
                      overallDistance,
                      costLimit)){
 
-        log.Error() << "Failed to walk paths from " << dbId << " / " << currentRouteNode->GetId();
+        log.Error() << "Failed to walk paths from " << dbId << " / " << current->id.id;
         return result;
       }
 
@@ -996,7 +1041,7 @@ namespace osmscout {
                                 openMap,
                                 closedSet,
                                 closedRestrictedSet)) {
-        log.Error() << "Failed to walk to other databases from " << dbId << " / " << currentRouteNode->GetFileOffset();
+        log.Error() << "Failed to walk to other databases from " << dbId << " / " << current->id.id;
         return result;
       }
 
@@ -1008,12 +1053,14 @@ namespace osmscout {
         std::cout << "Closing " << current->id << " (previous " << current->prev << ")" << std::endl;
 #endif
       if (current->access) {
-        closedSet.insert(VNode(current->id,
+        closedSet.Insert(current->id,
+                         VNode(current->id,
                                current->object,
                                current->prev));
       }
       else {
-        closedRestrictedSet.insert(VNode(current->id,
+        closedRestrictedSet.Insert(current->id,
+                                   VNode(current->id,
                                          current->object,
                                          current->prev));
       }
@@ -1061,11 +1108,10 @@ namespace osmscout {
 
     // If we have keep the last node open because of access violations, add it
     // after routing is done
-    if (closedSet.find(VNode(current->id))==closedSet.end()) {
-      closedSet.insert(VNode(current->id,
-                             current->object,
-                             current->prev));
-    }
+    closedSet.Insert(current->id,
+                     VNode(current->id,
+                           current->object,
+                           current->prev));
     RNodeRef  targetFinalNode;
 
     if (targetBackwardFinalNode && targetForwardFinalNode) {
@@ -1182,6 +1228,777 @@ namespace osmscout {
     return result;
   }
 
+  /**
+   * Return all paths (as route node and index of the path within the route node) leading
+   * to the given route node, that can be used by the current vehicle.
+   *
+   * Route nodes only store their outgoing paths. Candidates for incoming paths are
+   * the targets of the outgoing paths and the neighbouring route nodes on all ways
+   * meeting at the route node (including ways that can only be used towards the
+   * route node, which are not part of the route node itself).
+   *
+   * Ways are shared by many route nodes and a route node may be expanded twice (with and
+   * without access), so junctions and ways are cached in the search for the duration
+   * of the query.
+   */
+  template <class RoutingState>
+  bool AbstractRoutingService<RoutingState>::GetIncomingPaths(const RoutingState& state,
+                                                              SearchDirection& search,
+                                                              const DBId& id,
+                                                              const RouteNode& routeNode,
+                                                              std::vector<std::pair<RouteNodeRef,size_t>>& paths)
+  {
+    std::vector<Id> candidates;
+
+    paths.clear();
+
+    for (const auto& path : routeNode.paths) {
+      candidates.push_back(path.id);
+    }
+
+    std::vector<ObjectFileRef>* cachedObjects=search.junctions.Find(id);
+
+    if (cachedObjects==nullptr) {
+      std::vector<ObjectFileRef> junctionObjects;
+
+      if (!GetJunctionObjects(id,
+                              junctionObjects)) {
+        log.Error() << "Cannot load junction for route node " << id.database << " / " << id.id;
+        return false;
+      }
+
+      for (const auto& object : routeNode.objects) {
+        if (std::find(junctionObjects.begin(),junctionObjects.end(),object.object)==junctionObjects.end()) {
+          junctionObjects.push_back(object.object);
+        }
+      }
+
+      cachedObjects=&search.junctions[id];
+      cachedObjects->swap(junctionObjects);
+    }
+
+    const std::vector<ObjectFileRef>& objects=*cachedObjects;
+
+    // Return the first route node on the way starting at the given index in the given direction
+    auto findRouteNode=[this,&id](const Way& way,
+                                  size_t nodeIndex,
+                                  bool forward,
+                                  Id& routeNodeId) {
+      size_t index=nodeIndex;
+
+      for (size_t step=1; step<way.nodes.size(); step++) {
+        if (forward) {
+          if (index+1<way.nodes.size()) {
+            index++;
+          }
+          else if (way.IsCircular()) {
+            index=0;
+          }
+          else {
+            return false;
+          }
+        }
+        else {
+          if (index>0) {
+            index--;
+          }
+          else if (way.IsCircular()) {
+            index=way.nodes.size()-1;
+          }
+          else {
+            return false;
+          }
+        }
+
+        if (!way.nodes[index].IsRelevant() ||
+            way.GetId(index)==id.id) {
+          continue;
+        }
+
+        RouteNodeRef routeNode;
+
+        GetRouteNode(DBId(id.database,
+                          way.GetId(index)),
+                     routeNode);
+
+        if (routeNode) {
+          routeNodeId=routeNode->GetId();
+          return true;
+        }
+      }
+
+      return false;
+    };
+
+    for (const auto& object : objects) {
+      // Paths of areas are always bidirectional
+      if (object.GetType()!=refWay) {
+        continue;
+      }
+
+      size_t pathCount=0;
+
+      for (const auto& path : routeNode.paths) {
+        if (routeNode.objects[path.objectIndex].object==object) {
+          pathCount++;
+        }
+      }
+
+      // Both neighbours on the way are already known
+      if (pathCount>=2) {
+        continue;
+      }
+
+      DBFileOffset wayOffset(id.database,
+                             object.GetFileOffset());
+      WayRef&      way=search.ways[wayOffset];
+      size_t       nodeIndex;
+      Id           routeNodeId;
+
+      if (!way &&
+          !GetWayByOffset(wayOffset,
+                          way)) {
+        log.Error() << "Cannot load way " << object.GetName();
+        search.ways.erase(wayOffset);
+        return false;
+      }
+
+      if (!way->GetNodeIndexByNodeId(id.id,
+                                     nodeIndex)) {
+        continue;
+      }
+
+      if (findRouteNode(*way,nodeIndex,false,routeNodeId)) {
+        candidates.push_back(routeNodeId);
+      }
+
+      if (findRouteNode(*way,nodeIndex,true,routeNodeId)) {
+        candidates.push_back(routeNodeId);
+      }
+    }
+
+    std::sort(candidates.begin(),candidates.end());
+    candidates.erase(std::unique(candidates.begin(),candidates.end()),
+                     candidates.end());
+
+    for (const auto& candidate : candidates) {
+      RouteNodeRef candidateNode;
+
+      if (!GetRouteNode(DBId(id.database,
+                             candidate),
+                        candidateNode) ||
+          !candidateNode) {
+        log.Error() << "Cannot load route node with id " << candidate;
+        return false;
+      }
+
+      for (size_t i=0; i<candidateNode->paths.size(); i++) {
+        if (candidateNode->paths[i].id==id.id &&
+            CanUse(state,
+                   id.database,
+                   *candidateNode,
+                   i)) {
+          paths.push_back(std::make_pair(candidateNode,i));
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Check, if the route found by the forward search up to the given route node can be
+   * continued by the route found by the backward search starting at the given route node.
+   */
+  template <class RoutingState>
+  bool AbstractRoutingService<RoutingState>::CanMeet(const RouteNode& routeNode,
+                                                     const RNode& forwardNode,
+                                                     const RNode& backwardNode) const
+  {
+    // Moving from non-accessible way back to accessible way
+    if (!forwardNode.access &&
+        backwardNode.access) {
+      return false;
+    }
+
+    // Back to the last node visited
+    if (forwardNode.prev.IsValid() &&
+        forwardNode.prev==backwardNode.prev) {
+      return false;
+    }
+
+    return routeNode.IsTurnAllowed(forwardNode.object,
+                                   backwardNode.object);
+  }
+
+  /**
+   * Check all nodes of the other search direction for the route node of the given node
+   * and update the meeting, if the resulting route is cheaper than the current one.
+   */
+  template <class RoutingState>
+  void AbstractRoutingService<RoutingState>::UpdateMeeting(const RNode& node,
+                                                           const RouteNode& routeNode,
+                                                           bool forward,
+                                                           const SearchDirection& other,
+                                                           SearchMeeting& meeting) const
+  {
+    auto check=[&](const RNode& otherNode) {
+      double costs=node.currentCost+otherNode.currentCost;
+
+      if (costs>=meeting.costs) {
+        return;
+      }
+
+      const RNode& forwardNode=forward ? node : otherNode;
+      const RNode& backwardNode=forward ? otherNode : node;
+
+      if (!CanMeet(routeNode,
+                   forwardNode,
+                   backwardNode)) {
+        return;
+      }
+
+      meeting.costs=costs;
+      meeting.forwardNode=forwardNode;
+      meeting.backwardNode=backwardNode;
+
+      // Do not keep the route node in memory
+      meeting.forwardNode.node=nullptr;
+      meeting.backwardNode.node=nullptr;
+    };
+
+    RNode* const* openEntry=other.openMap.Find(node.id);
+
+    if (openEntry!=nullptr) {
+      check(**openEntry);
+    }
+
+    const RNodeRef* closedEntry=other.closedSet.Find(node.id);
+
+    if (closedEntry!=nullptr) {
+      check(**closedEntry);
+    }
+
+    closedEntry=other.closedRestrictedSet.Find(node.id);
+
+    if (closedEntry!=nullptr) {
+      check(**closedEntry);
+    }
+  }
+
+  /**
+   * Walk from the current node of the given search direction to the route node with the given id
+   * and insert or update the node in the open list.
+   */
+  template <class RoutingState>
+  bool AbstractRoutingService<RoutingState>::WalkBidirectional(const RoutingState& state,
+                                                               bool forward,
+                                                               SearchDirection& search,
+                                                               const SearchDirection& other,
+                                                               const RNode& current,
+                                                               const DBId& id,
+                                                               const RouteNodeRef& routeNode,
+                                                               const ObjectFileRef& object,
+                                                               double currentCost,
+                                                               bool access,
+                                                               double costLimit,
+                                                               SearchMeeting& meeting)
+  {
+    if ((access &&
+         search.closedSet.Contains(id)) ||
+        (!access &&
+         search.closedRestrictedSet.Contains(id))) {
+      return true;
+    }
+
+    RNode** openEntryRef=search.openMap.Find(id);
+    RNode*  openEntry=openEntryRef!=nullptr ? *openEntryRef : nullptr;
+
+    // Check, if we already have a cheaper path to the new node
+    if (openEntry!=nullptr &&
+        openEntry->currentCost<=currentCost) {
+      return true;
+    }
+
+    RouteNodeRef nextNode=routeNode;
+
+    if (!nextNode) {
+      if (openEntry!=nullptr) {
+        nextNode=openEntry->node;
+      }
+      else if (!GetRouteNode(id,
+                             nextNode) ||
+               !nextNode) {
+        log.Error() << "Cannot load route node with id " << id.database << " / " << id.id;
+        return false;
+      }
+    }
+
+    Distance distanceToTarget=GetSphericalDistance(nextNode->GetCoord(),
+                                                   search.targetCoord);
+    double   targetEstimateCost=GetEstimateCosts(state,id.database,distanceToTarget);
+
+    if (currentCost+targetEstimateCost>costLimit) {
+      search.nodesIgnoredCount++;
+
+      return true;
+    }
+
+    // Average of the estimates to the target and from the start, so that the estimates
+    // of both search directions are consistent with each other
+    double startEstimateCost=GetEstimateCosts(state,
+                                              id.database,
+                                              GetSphericalDistance(nextNode->GetCoord(),
+                                                                   search.startCoord));
+    double estimateCost=(targetEstimateCost-startEstimateCost)/2;
+
+    if (openEntry!=nullptr) {
+      openEntry->prev=current.id;
+      openEntry->object=object;
+      openEntry->currentCost=currentCost;
+      openEntry->estimateCost=estimateCost;
+      openEntry->overallCost=currentCost+estimateCost;
+      openEntry->access=access;
+      openEntry->prevAccess=current.access;
+
+      search.openList.Update(*openEntry);
+
+      UpdateMeeting(*openEntry,
+                    *nextNode,
+                    forward,
+                    other,
+                    meeting);
+    }
+    else {
+      RNodeRef node=std::make_shared<RNode>(id,
+                                            nextNode,
+                                            object,
+                                            current.id);
+
+      node->currentCost=currentCost;
+      node->estimateCost=estimateCost;
+      node->overallCost=currentCost+estimateCost;
+      node->access=access;
+      node->prevAccess=current.access;
+
+      search.openList.Push(node);
+      search.openMap[node->id]=node.get();
+
+      UpdateMeeting(*node,
+                    *nextNode,
+                    forward,
+                    other,
+                    meeting);
+    }
+
+    return true;
+  }
+
+  /**
+   * Calculate a route using a bidirectional A* search
+   *
+   * The route is searched from the start and from the target at the same time. Both searches
+   * use the average of the estimate to the target and the estimate from the start as
+   * (consistent) potential, so the search can stop as soon as the sum of the smallest
+   * costs of both open lists reaches the costs of the best route found so far.
+   *
+   * The backward search needs the incoming paths of a route node, which are not stored
+   * in the route node and have to be collected using GetIncomingPaths().
+   *
+   * @param state
+   *    State to use
+   * @param start
+   *    Start of the route
+   * @param target
+   *    Target of the route
+   * @param parameter
+   *    Optional parameter for the routing calculation
+   * @return
+   *    The routing result, containing the route on success
+   */
+  template <class RoutingState>
+  RoutingResult AbstractRoutingService<RoutingState>::CalculateRouteBidirectional(RoutingState& state,
+                                                                                  const RoutePosition& start,
+                                                                                  const RoutePosition& target,
+                                                                                  const RoutingParameter& parameter)
+  {
+    RoutingResult   result;
+    Vehicle         vehicle=GetVehicle(state);
+    RouteNodeRef    startForwardRouteNode;
+    RouteNodeRef    startBackwardRouteNode;
+    RNodeRef        startForwardNode;
+    RNodeRef        startBackwardNode;
+
+    GeoCoord        startCoord;
+    GeoCoord        targetCoord;
+
+    RouteNodeRef    targetForwardRouteNode;
+    RouteNodeRef    targetBackwardRouteNode;
+
+    SearchDirection forward;
+    SearchDirection backward;
+    SearchMeeting   meeting;
+
+    if (!GetTargetNodes(state,
+                        target,
+                        targetCoord,
+                        targetForwardRouteNode,
+                        targetBackwardRouteNode)) {
+      return result;
+    }
+
+    if (!GetStartNodes(state,
+                       start,
+                       startCoord,
+                       targetCoord,
+                       startForwardRouteNode,
+                       startBackwardRouteNode,
+                       startForwardNode,
+                       startBackwardNode)) {
+      return result;
+    }
+
+    if (parameter.GetBreaker() &&
+        parameter.GetBreaker()->IsAborted()) {
+      return result;
+    }
+
+    for (SearchDirection* search : {&forward,&backward}) {
+      search->openList.reserve(10000);
+      search->openMap.reserve(10000);
+      search->closedSet.reserve(100000);
+      search->closedRestrictedSet.reserve(1000);
+      search->nodesLoadedCount=0;
+      search->nodesIgnoredCount=0;
+      search->maxOpenList=0;
+    }
+
+    forward.startCoord=startCoord;
+    forward.targetCoord=targetCoord;
+    backward.startCoord=targetCoord;
+    backward.targetCoord=startCoord;
+
+    meeting.costs=std::numeric_limits<double>::max();
+
+    auto initializeNode=[&](SearchDirection& search,
+                            const RNodeRef& node) {
+      if (search.openMap.Contains(node->id)) {
+        return;
+      }
+
+      node->estimateCost=(GetEstimateCosts(state,
+                                           node->id.database,
+                                           GetSphericalDistance(node->node->GetCoord(),
+                                                                search.targetCoord))-
+                          GetEstimateCosts(state,
+                                           node->id.database,
+                                           GetSphericalDistance(node->node->GetCoord(),
+                                                                search.startCoord)))/2;
+      node->overallCost=node->currentCost+node->estimateCost;
+
+      search.openList.Push(node);
+      search.openMap[node->id]=node.get();
+    };
+
+    if (startForwardNode) {
+      initializeNode(forward,startForwardNode);
+    }
+
+    if (startBackwardNode) {
+      initializeNode(forward,startBackwardNode);
+    }
+
+    // The target route nodes can be reached via any way, so they start without access
+    for (const auto& routeNode : {targetForwardRouteNode,targetBackwardRouteNode}) {
+      if (routeNode) {
+        RNodeRef node=std::make_shared<RNode>(DBId(target.GetDatabaseId(),
+                                                   routeNode->GetId()),
+                                              routeNode,
+                                              ObjectFileRef());
+
+        node->access=false;
+
+        initializeNode(backward,node);
+      }
+    }
+
+    Distance overallDistance=GetSphericalDistance(startCoord,
+                                                  targetCoord);
+    double   overallCost=GetEstimateCosts(state,start.GetDatabaseId(),overallDistance);
+    double   costLimit=GetCostLimit(state,start.GetDatabaseId(),overallDistance);
+    StopClock clock;
+
+    result.SetOverallDistance(overallDistance);
+    result.SetCurrentMaxDistance(Distance());
+
+    while (!forward.openList.empty() &&
+           !backward.openList.empty()) {
+      if (parameter.GetBreaker() &&
+          parameter.GetBreaker()->IsAborted()) {
+        return result;
+      }
+
+      // No cheaper route possible
+      if (forward.openList.Top()->overallCost+backward.openList.Top()->overallCost>=meeting.costs) {
+        break;
+      }
+
+      // Continue with the direction with fewer alternatives
+      bool             isForward=forward.openList.size()<=backward.openList.size();
+      SearchDirection& search=isForward ? forward : backward;
+      SearchDirection& other=isForward ? backward : forward;
+      RNodeRef         current=search.openList.Pop();
+
+      search.openMap.Erase(current->id);
+
+      if ((current->access &&
+           search.closedSet.Contains(current->id)) ||
+          (!current->access &&
+           search.closedRestrictedSet.Contains(current->id))) {
+        continue;
+      }
+
+      RouteNodeRef currentRouteNode=current->node;
+      DatabaseId   dbId=current->id.database;
+
+      search.nodesLoadedCount++;
+
+#if defined(DEBUG_ROUTING)
+      std::cout << "Analysing " << (isForward ? "follower" : "predecessor") << " of node " << current->id;
+      std::cout << " (" << current->object.GetName() << ")";
+      std::cout << " " << current->currentCost << " " << current->estimateCost << " " << current->overallCost << std::endl;
+#endif
+
+      UpdateMeeting(*current,
+                    *currentRouteNode,
+                    isForward,
+                    other,
+                    meeting);
+
+      if (isForward) {
+        for (size_t i=0; i<currentRouteNode->paths.size(); i++) {
+          const RouteNode::Path& path=currentRouteNode->paths[i];
+
+          if (path.id==current->prev.id ||
+              (!current->access &&
+               !path.IsRestricted(vehicle)) ||
+              !CanUse(state,
+                      dbId,
+                      *currentRouteNode,
+                      i)) {
+            search.nodesIgnoredCount++;
+            continue;
+          }
+
+          if (!currentRouteNode->IsTurnAllowed(current->object,
+                                               currentRouteNode->objects[path.objectIndex].object)) {
+            search.nodesIgnoredCount++;
+            continue;
+          }
+
+          if (!WalkBidirectional(state,
+                                 isForward,
+                                 search,
+                                 other,
+                                 *current,
+                                 DBId(dbId,path.id),
+                                 nullptr,
+                                 currentRouteNode->objects[path.objectIndex].object,
+                                 current->currentCost+GetCosts(state,dbId,*currentRouteNode,i),
+                                 !path.IsRestricted(vehicle),
+                                 costLimit,
+                                 meeting)) {
+            log.Error() << "Failed to walk paths from " << current->id.database << " / " << current->id.id;
+            return result;
+          }
+        }
+      }
+      else {
+        std::vector<std::pair<RouteNodeRef,size_t>> incomingPaths;
+
+        if (!GetIncomingPaths(state,
+                              search,
+                              current->id,
+                              *currentRouteNode,
+                              incomingPaths)) {
+          log.Error() << "Failed to collect incoming paths of " << current->id.database << " / " << current->id.id;
+          return result;
+        }
+
+        for (const auto& incomingPath : incomingPaths) {
+          const RouteNode&       sourceNode=*incomingPath.first;
+          const RouteNode::Path& path=sourceNode.paths[incomingPath.second];
+          const ObjectFileRef&   object=sourceNode.objects[path.objectIndex].object;
+
+          if (sourceNode.GetId()==current->prev.id ||
+              (current->access &&
+               path.IsRestricted(vehicle))) {
+            search.nodesIgnoredCount++;
+            continue;
+          }
+
+          if (!currentRouteNode->IsTurnAllowed(object,
+                                               current->object)) {
+            search.nodesIgnoredCount++;
+            continue;
+          }
+
+          if (!WalkBidirectional(state,
+                                 isForward,
+                                 search,
+                                 other,
+                                 *current,
+                                 DBId(dbId,sourceNode.GetId()),
+                                 incomingPath.first,
+                                 object,
+                                 current->currentCost+GetCosts(state,dbId,sourceNode,incomingPath.second),
+                                 current->access || !path.IsRestricted(vehicle),
+                                 costLimit,
+                                 meeting)) {
+            log.Error() << "Failed to walk paths to " << current->id.database << " / " << current->id.id;
+            return result;
+          }
+        }
+      }
+
+      // Twin nodes from other databases are reached without additional costs
+      for (const auto& twin : GetNodeTwins(state,
+                                           dbId,
+                                           currentRouteNode->GetId())) {
+        if (!WalkBidirectional(state,
+                               isForward,
+                               search,
+                               other,
+                               *current,
+                               twin,
+                               nullptr,
+                               ObjectFileRef(),
+                               current->currentCost,
+                               current->access,
+                               costLimit,
+                               meeting)) {
+          log.Error() << "Failed to walk to other databases from " << current->id.database << " / " << current->id.id;
+          return result;
+        }
+      }
+
+      if (current->access) {
+        search.closedSet.Insert(current->id,
+                                current);
+      }
+      else {
+        search.closedRestrictedSet.Insert(current->id,
+                                          current);
+      }
+
+      search.currentMaxDistance=Distance::Max(search.currentMaxDistance,
+                                              overallDistance-GetSphericalDistance(currentRouteNode->GetCoord(),
+                                                                                   search.targetCoord));
+      search.maxOpenList=std::max(search.maxOpenList,search.openMap.size());
+
+      current->node=nullptr;
+
+      Distance currentMaxDistance=Distance::Min(forward.currentMaxDistance+backward.currentMaxDistance,
+                                                overallDistance);
+
+      result.SetCurrentMaxDistance(currentMaxDistance);
+
+      if (parameter.GetProgress()) {
+        parameter.GetProgress()->Progress(currentMaxDistance,overallDistance);
+      }
+    }
+
+    clock.Stop();
+
+    bool routeFound=meeting.costs<std::numeric_limits<double>::max();
+
+    if (debugPerformance) {
+      std::cout << "From:                " << startCoord.GetDisplayText() << " " << start.GetObjectFileRef().GetName() << "[" << start.GetNodeIndex() << "]" << std::endl;
+      std::cout << "To:                  " << targetCoord.GetDisplayText() << " " << target.GetObjectFileRef().GetName() << "[" << target.GetNodeIndex() << "]" << std::endl;
+      std::cout << "Time:                " << clock << std::endl;
+      std::cout << "Air-line distance:   " << std::fixed << std::setprecision(1) << overallDistance.As<Kilometer>() << "km" << std::endl;
+      std::cout << "Minimum cost:        " << overallCost << std::endl;
+      if (routeFound) {
+        std::cout << "Actual cost:         " << meeting.costs << std::endl;
+      }
+      std::cout << "Cost limit:          " << costLimit << std::endl;
+      std::cout << "Route nodes loaded:  " << forward.nodesLoadedCount << " + " << backward.nodesLoadedCount << std::endl;
+      std::cout << "Route nodes ignored: " << forward.nodesIgnoredCount << " + " << backward.nodesIgnoredCount << std::endl;
+      std::cout << "Max. OpenList size:  " << forward.maxOpenList << " + " << backward.maxOpenList << std::endl;
+      std::cout << "Max. ClosedSet size: " << forward.closedSet.size()+forward.closedRestrictedSet.size() << " + " << backward.closedSet.size()+backward.closedRestrictedSet.size() << std::endl;
+    }
+
+    if (!routeFound) {
+      log.Warn() << "No route found!";
+
+      return result;
+    }
+
+    if (parameter.GetBreaker() &&
+        parameter.GetBreaker()->IsAborted()) {
+      return result;
+    }
+
+    std::list<VNode> nodes;
+    const RNode*     node;
+
+    // From the meeting node back to the start
+
+    node=&meeting.forwardNode;
+
+    nodes.push_front(VNode(node->id,
+                           node->object,
+                           node->prev));
+
+    while (node->prev.IsValid()) {
+      const RNodeRef* prev=node->prevAccess ? forward.closedSet.Find(node->prev) : forward.closedRestrictedSet.Find(node->prev);
+
+      assert(prev!=nullptr);
+
+      node=prev->get();
+
+      nodes.push_front(VNode(node->id,
+                             node->object,
+                             node->prev));
+    }
+
+    // From the meeting node to the target, the object of a backward node is the object
+    // leading to the next node
+
+    node=&meeting.backwardNode;
+
+    while (node->prev.IsValid()) {
+      const RNodeRef* next=node->prevAccess ? backward.closedSet.Find(node->prev) : backward.closedRestrictedSet.Find(node->prev);
+
+      assert(next!=nullptr);
+
+      nodes.push_back(VNode((*next)->id,
+                            node->object,
+                            node->id));
+
+      node=next->get();
+    }
+
+#if defined(DEBUG_ROUTING)
+    std::cout << "VNode List:" << std::endl;
+    for (const auto& node : nodes) {
+      std::cout << node.object.GetName() << " " << node.currentNode.database << "/" << node.currentNode.id << std::endl;
+    }
+#endif
+
+    if (!ResolveRNodesToRouteData(state,
+                                  nodes,
+                                  start,
+                                  target,
+                                  result.GetRoute())) {
+      return result;
+    }
+
+    ResolveRouteDataJunctions(result.GetRoute());
+
+    return result;
+  }
+
   template <class RoutingState>
   void AbstractRoutingService<RoutingState>::AddNodes(RouteData& route,
                                                       DatabaseId database,
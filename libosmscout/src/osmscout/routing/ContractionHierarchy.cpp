@@ -0,0 +1,541 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/routing/ContractionHierarchy.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+
+#include <osmscout/system/Assert.h>
+
+namespace osmscout {
+
+  /**
+   * Label of a node during a query
+   */
+  struct ContractionHierarchyLabel
+  {
+    double   costs; //!< Costs from the start (forward) or to the target (backward)
+    uint32_t node;  //!< Previous (forward) or next (backward) node on the route, or noNode
+    uint32_t edge;  //!< Index of the edge to the previous or next node
+  };
+
+  typedef std::unordered_map<uint32_t,ContractionHierarchyLabel> ContractionHierarchyLabelMap;
+  typedef std::pair<double,uint32_t>                             ContractionHierarchyQueueEntry;
+  typedef std::priority_queue<ContractionHierarchyQueueEntry,
+                              std::vector<ContractionHierarchyQueueEntry>,
+                              std::greater<ContractionHierarchyQueueEntry>> ContractionHierarchyQueue;
+
+  // The file format has no floating point type, costs are stored as their binary representation
+
+  static void WriteDouble(FileWriter& writer,
+                          double value)
+  {
+    uint64_t bits;
+
+    std::memcpy(&bits,&value,sizeof(bits));
+    writer.Write(bits);
+  }
+
+  static double ReadDouble(FileScanner& scanner)
+  {
+    uint64_t bits;
+    double   value;
+
+    scanner.Read(bits);
+    std::memcpy(&value,&bits,sizeof(value));
+
+    return value;
+  }
+
+  static void WriteEdges(FileWriter& writer,
+                         const std::vector<uint32_t>& offsets,
+                         const std::vector<ContractionHierarchy::Edge>& edges)
+  {
+    for (size_t node=0; node+1<offsets.size(); node++) {
+      writer.WriteNumber(offsets[node+1]-offsets[node]);
+
+      for (uint32_t e=offsets[node]; e<offsets[node+1]; e++) {
+        const ContractionHierarchy::Edge& edge=edges[e];
+
+        writer.WriteNumber(edge.target);
+        writer.WriteNumber(edge.middle==ContractionHierarchy::noNode ? 0 : edge.middle+1);
+        WriteDouble(writer,edge.costs);
+
+        if (edge.middle==ContractionHierarchy::noNode) {
+          writer.Write(edge.object);
+        }
+      }
+    }
+  }
+
+  static void ReadEdges(FileScanner& scanner,
+                        size_t nodeCount,
+                        std::vector<uint32_t>& offsets,
+                        std::vector<ContractionHierarchy::Edge>& edges)
+  {
+    offsets.resize(nodeCount+1);
+    edges.clear();
+
+    for (size_t node=0; node<nodeCount; node++) {
+      uint32_t edgeCount;
+
+      offsets[node]=(uint32_t)edges.size();
+
+      scanner.ReadNumber(edgeCount);
+
+      for (uint32_t e=0; e<edgeCount; e++) {
+        ContractionHierarchy::Edge edge;
+        uint32_t                   middle;
+
+        scanner.ReadNumber(edge.target);
+        scanner.ReadNumber(middle);
+        edge.middle=middle==0 ? ContractionHierarchy::noNode : middle-1;
+        edge.costs=ReadDouble(scanner);
+
+        if (edge.middle==ContractionHierarchy::noNode) {
+          scanner.Read(edge.object);
+        }
+
+        edges.push_back(edge);
+      }
+    }
+
+    offsets[nodeCount]=(uint32_t)edges.size();
+  }
+
+  ContractionHierarchy::ContractionHierarchy()
+  : vehicle(vehicleCar),
+    vehicleMaxSpeed(0.0)
+  {
+    // no code
+  }
+
+  /**
+   * Set the parameter of the FastestPathRoutingProfile used for the costs of the edges
+   */
+  void ContractionHierarchy::SetMetric(Vehicle vehicle,
+                                       double vehicleMaxSpeed,
+                                       const std::vector<double>& speeds)
+  {
+    this->vehicle=vehicle;
+    this->vehicleMaxSpeed=vehicleMaxSpeed;
+    this->speeds=speeds;
+  }
+
+  /**
+   * Set the route nodes, ids must be sorted
+   */
+  void ContractionHierarchy::SetNodes(std::vector<Id>&& ids,
+                                      std::vector<uint8_t>&& excludes)
+  {
+    assert(ids.size()==excludes.size());
+    assert(std::is_sorted(ids.begin(),ids.end()));
+
+    this->ids=std::move(ids);
+    this->excludes=std::move(excludes);
+  }
+
+  /**
+   * Set the edges, the edges of node i are the edges from offsets[i] to offsets[i+1]
+   */
+  void ContractionHierarchy::SetEdges(std::vector<uint32_t>&& upOffsets,
+                                      std::vector<Edge>&& upEdges,
+                                      std::vector<uint32_t>&& downOffsets,
+                                      std::vector<Edge>&& downEdges)
+  {
+    assert(upOffsets.size()==ids.size()+1);
+    assert(downOffsets.size()==ids.size()+1);
+
+    this->upOffsets=std::move(upOffsets);
+    this->upEdges=std::move(upEdges);
+    this->downOffsets=std::move(downOffsets);
+    this->downEdges=std::move(downEdges);
+  }
+
+  /**
+   * Returns true, if the hierarchy was build using the costs of the given profile
+   * and thus routes calculated by the hierarchy are the same as routes
+   * calculated by the routing graph.
+   */
+  bool ContractionHierarchy::IsCompatible(const RoutingProfile& profile) const
+  {
+    const FastestPathRoutingProfile *fastestProfile=dynamic_cast<const FastestPathRoutingProfile*>(&profile);
+
+    if (fastestProfile==nullptr ||
+        fastestProfile->GetVehicle()!=vehicle ||
+        fastestProfile->GetVehicleMaxSpeed()!=vehicleMaxSpeed) {
+      return false;
+    }
+
+    const std::vector<double>& profileSpeeds=fastestProfile->GetSpeeds();
+
+    for (size_t i=0; i<std::max(speeds.size(),profileSpeeds.size()); i++) {
+      double speed=i<speeds.size() ? speeds[i] : 0.0;
+      double profileSpeed=i<profileSpeeds.size() ? profileSpeeds[i] : 0.0;
+
+      if (speed!=profileSpeed) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Return the index of the given route node or noNode, if the route
+   * node is not part of the hierarchy
+   */
+  uint32_t ContractionHierarchy::GetNodeIndex(Id id) const
+  {
+    auto entry=std::lower_bound(ids.begin(),ids.end(),id);
+
+    if (entry==ids.end() ||
+        *entry!=id) {
+      return noNode;
+    }
+
+    return (uint32_t)(entry-ids.begin());
+  }
+
+  const ContractionHierarchy::Edge* ContractionHierarchy::FindUpEdge(uint32_t node,
+                                                                     uint32_t target) const
+  {
+    for (uint32_t e=upOffsets[node]; e<upOffsets[node+1]; e++) {
+      if (upEdges[e].target==target) {
+        return &upEdges[e];
+      }
+    }
+
+    return nullptr;
+  }
+
+  const ContractionHierarchy::Edge* ContractionHierarchy::FindDownEdge(uint32_t node,
+                                                                       uint32_t source) const
+  {
+    for (uint32_t e=downOffsets[node]; e<downOffsets[node+1]; e++) {
+      if (downEdges[e].target==source) {
+        return &downEdges[e];
+      }
+    }
+
+    return nullptr;
+  }
+
+  /**
+   * Append the route nodes of the edge from "from" to "to" (without "from")
+   * to the steps. Shortcuts are resolved recursively into the edges of the
+   * routing graph.
+   */
+  void ContractionHierarchy::Unpack(uint32_t from,
+                                    uint32_t to,
+                                    const Edge& edge,
+                                    std::vector<Step>& steps) const
+  {
+    std::vector<std::tuple<uint32_t,uint32_t,const Edge*>> stack;
+
+    stack.emplace_back(from,to,&edge);
+
+    while (!stack.empty()) {
+      uint32_t    source=std::get<0>(stack.back());
+      uint32_t    target=std::get<1>(stack.back());
+      const Edge* current=std::get<2>(stack.back());
+
+      stack.pop_back();
+
+      if (current->middle==noNode) {
+        steps.push_back(Step{ids[target],current->object});
+        continue;
+      }
+
+      // The middle node was contracted before source and target, so both
+      // edges are stored at the middle node
+      const Edge* first=FindDownEdge(current->middle,source);
+      const Edge* second=FindUpEdge(current->middle,target);
+
+      assert(first!=nullptr && second!=nullptr);
+
+      stack.emplace_back(current->middle,target,second);
+      stack.emplace_back(source,current->middle,first);
+    }
+  }
+
+  /**
+   * Calculate the route with the lowest costs from one of the sources to
+   * one of the targets using a bidirectional search.
+   *
+   * @param sources
+   *    Possible start route nodes together with the costs to reach them
+   * @param targets
+   *    Possible target route nodes together with the costs from them to the target
+   * @param steps
+   *    The route nodes of the route from the source to the target
+   * @param costs
+   *    Costs of the route
+   * @param settledNodes
+   *    Number of nodes handled during the search
+   * @return
+   *    false, if there is no route
+   */
+  bool ContractionHierarchy::CalculateRoute(const std::vector<Terminal>& sources,
+                                            const std::vector<Terminal>& targets,
+                                            std::vector<Step>& steps,
+                                            double& costs,
+                                            size_t& settledNodes) const
+  {
+    ContractionHierarchyLabelMap forwardLabels;
+    ContractionHierarchyLabelMap backwardLabels;
+    ContractionHierarchyQueue    forwardQueue;
+    ContractionHierarchyQueue    backwardQueue;
+
+    steps.clear();
+    settledNodes=0;
+
+    for (const auto& source : sources) {
+      uint32_t node=GetNodeIndex(source.id);
+
+      if (node==noNode) {
+        continue;
+      }
+
+      auto label=forwardLabels.find(node);
+
+      if (label==forwardLabels.end() ||
+          source.costs<label->second.costs) {
+        forwardLabels[node]=ContractionHierarchyLabel{source.costs,noNode,0};
+        forwardQueue.push(std::make_pair(source.costs,node));
+      }
+    }
+
+    for (const auto& target : targets) {
+      uint32_t node=GetNodeIndex(target.id);
+
+      if (node==noNode) {
+        continue;
+      }
+
+      auto label=backwardLabels.find(node);
+
+      if (label==backwardLabels.end() ||
+          target.costs<label->second.costs) {
+        backwardLabels[node]=ContractionHierarchyLabel{target.costs,noNode,0};
+        backwardQueue.push(std::make_pair(target.costs,node));
+      }
+    }
+
+    double   bestCosts=std::numeric_limits<double>::max();
+    uint32_t meetingNode=noNode;
+    bool     forwardTurn=true;
+
+    while (true) {
+      // A direction is finished, if it cannot improve the best route anymore
+      if (!forwardQueue.empty() &&
+          forwardQueue.top().first>=bestCosts) {
+        forwardQueue=ContractionHierarchyQueue();
+      }
+
+      if (!backwardQueue.empty() &&
+          backwardQueue.top().first>=bestCosts) {
+        backwardQueue=ContractionHierarchyQueue();
+      }
+
+      if (forwardQueue.empty() &&
+          backwardQueue.empty()) {
+        break;
+      }
+
+      bool forward=!forwardQueue.empty() &&
+                   (backwardQueue.empty() || forwardTurn);
+
+      forwardTurn=!forwardTurn;
+
+      ContractionHierarchyQueue&          queue=forward ? forwardQueue : backwardQueue;
+      ContractionHierarchyLabelMap&       labels=forward ? forwardLabels : backwardLabels;
+      const ContractionHierarchyLabelMap& otherLabels=forward ? backwardLabels : forwardLabels;
+      const std::vector<uint32_t>&        offsets=forward ? upOffsets : downOffsets;
+      const std::vector<Edge>&            edges=forward ? upEdges : downEdges;
+
+      ContractionHierarchyQueueEntry entry=queue.top();
+
+      queue.pop();
+
+      uint32_t node=entry.second;
+      double   nodeCosts=labels[node].costs;
+
+      if (entry.first>nodeCosts) {
+        // Outdated entry
+        continue;
+      }
+
+      settledNodes++;
+
+      auto otherLabel=otherLabels.find(node);
+
+      if (otherLabel!=otherLabels.end() &&
+          nodeCosts+otherLabel->second.costs<bestCosts) {
+        bestCosts=nodeCosts+otherLabel->second.costs;
+        meetingNode=node;
+      }
+
+      for (uint32_t e=offsets[node]; e<offsets[node+1]; e++) {
+        const Edge& edge=edges[e];
+        double      newCosts=nodeCosts+edge.costs;
+        auto        label=labels.find(edge.target);
+
+        if (label==labels.end() ||
+            newCosts<label->second.costs) {
+          labels[edge.target]=ContractionHierarchyLabel{newCosts,node,e};
+          queue.push(std::make_pair(newCosts,edge.target));
+        }
+      }
+    }
+
+    if (meetingNode==noNode) {
+      return false;
+    }
+
+    costs=bestCosts;
+
+    // Forward part, collected from the meeting node back to the source
+    std::vector<std::pair<uint32_t,uint32_t>> forwardHops;
+    uint32_t                                  node=meetingNode;
+
+    while (forwardLabels[node].node!=noNode) {
+      const ContractionHierarchyLabel& label=forwardLabels[node];
+
+      forwardHops.emplace_back(label.node,label.edge);
+      node=label.node;
+    }
+
+    steps.push_back(Step{ids[node],ObjectFileRef()});
+
+    for (auto hop=forwardHops.rbegin(); hop!=forwardHops.rend(); ++hop) {
+      const Edge& edge=upEdges[hop->second];
+
+      Unpack(hop->first,
+             edge.target,
+             edge,
+             steps);
+    }
+
+    // Backward part, from the meeting node to the target
+    node=meetingNode;
+
+    while (backwardLabels[node].node!=noNode) {
+      const ContractionHierarchyLabel& label=backwardLabels[node];
+
+      Unpack(node,
+             label.node,
+             downEdges[label.edge],
+             steps);
+
+      node=label.node;
+    }
+
+    return true;
+  }
+
+  /**
+   * Read the hierarchy from the given FileScanner
+   *
+   * @throws IOException
+   */
+  void ContractionHierarchy::Read(FileScanner& scanner)
+  {
+    uint8_t  vehicleValue;
+    uint32_t speedCount;
+    uint32_t nodeCount;
+
+    scanner.Read(vehicleValue);
+    vehicle=(Vehicle)vehicleValue;
+    vehicleMaxSpeed=ReadDouble(scanner);
+
+    scanner.ReadNumber(speedCount);
+    speeds.resize(speedCount);
+
+    for (auto& speed : speeds) {
+      speed=ReadDouble(scanner);
+    }
+
+    scanner.Read(nodeCount);
+
+    ids.resize(nodeCount);
+    excludes.resize(nodeCount);
+
+    Id previousId=0;
+
+    for (size_t i=0; i<nodeCount; i++) {
+      Id idDelta;
+
+      scanner.ReadNumber(idDelta);
+      scanner.Read(excludes[i]);
+
+      ids[i]=previousId+idDelta;
+      previousId=ids[i];
+    }
+
+    ReadEdges(scanner,
+              nodeCount,
+              upOffsets,
+              upEdges);
+    ReadEdges(scanner,
+              nodeCount,
+              downOffsets,
+              downEdges);
+  }
+
+  /**
+   * Write the hierarchy to the given FileWriter
+   *
+   * @throws IOException
+   */
+  void ContractionHierarchy::Write(FileWriter& writer) const
+  {
+    writer.Write((uint8_t)vehicle);
+    WriteDouble(writer,vehicleMaxSpeed);
+
+    writer.WriteNumber((uint32_t)speeds.size());
+
+    for (double speed : speeds) {
+      WriteDouble(writer,speed);
+    }
+
+    writer.Write((uint32_t)ids.size());
+
+    Id previousId=0;
+
+    for (size_t i=0; i<ids.size(); i++) {
+      writer.WriteNumber(ids[i]-previousId);
+      writer.Write(excludes[i]);
+
+      previousId=ids[i];
+    }
+
+    WriteEdges(writer,
+               upOffsets,
+               upEdges);
+    WriteEdges(writer,
+               downOffsets,
+               downEdges);
+  }
+}
@@ -0,0 +1,624 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/routing/MapMatcher.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+
+#include <osmscout/util/Geometry.h>
+#include <osmscout/util/Logger.h>
+
+namespace osmscout {
+
+  /**
+   * Maximum number of ways held in the way cache of the matcher
+   */
+  static const size_t maxCachedWays=1000;
+
+  MapMatcherParameter::MapMatcherParameter()
+  : searchRadius(Distance::Of<Meter>(50.0)),
+    candidateCount(5),
+    minPointDistance(Distance::Of<Meter>(10.0)),
+    sigma(5.0),
+    beta(50.0),
+    windowSize(100),
+    maxCachedNodes(100000)
+  {
+    // no code
+  }
+
+  void MapMatcherParameter::SetSearchRadius(const Distance& searchRadius)
+  {
+    this->searchRadius=searchRadius;
+  }
+
+  void MapMatcherParameter::SetCandidateCount(size_t candidateCount)
+  {
+    this->candidateCount=candidateCount;
+  }
+
+  void MapMatcherParameter::SetMinPointDistance(const Distance& minPointDistance)
+  {
+    this->minPointDistance=minPointDistance;
+  }
+
+  void MapMatcherParameter::SetSigma(double sigma)
+  {
+    this->sigma=sigma;
+  }
+
+  void MapMatcherParameter::SetBeta(double beta)
+  {
+    this->beta=beta;
+  }
+
+  void MapMatcherParameter::SetWindowSize(size_t windowSize)
+  {
+    this->windowSize=std::max(windowSize,(size_t)2);
+  }
+
+  void MapMatcherParameter::SetMaxCachedNodes(size_t maxCachedNodes)
+  {
+    this->maxCachedNodes=maxCachedNodes;
+  }
+
+  /**
+   * Create a matcher for one trace
+   *
+   * @param database
+   *    The database the router is based on
+   * @param router
+   *    An opened router
+   * @param profile
+   *    The profile of the vehicle that recorded the trace
+   * @param parameter
+   *    Parameter of the matching
+   * @param routingParameter
+   *    Parameter for the route and matrix calculations
+   */
+  MapMatcher::MapMatcher(const DatabaseRef& database,
+                         SimpleRoutingService& router,
+                         RoutingProfile& profile,
+                         const MapMatcherParameter& parameter,
+                         const RoutingParameter& routingParameter)
+  : database(database),
+    router(router),
+    profile(profile),
+    parameter(parameter),
+    routingParameter(routingParameter),
+    hasLastPosition(false),
+    pendingTarget(false),
+    pointCount(0),
+    matchedCount(0),
+    breakCount(0)
+  {
+    // no code
+  }
+
+  /**
+   * Collect the candidates of a point and set their probabilities to the
+   * logarithm of the emission probability.
+   */
+  void MapMatcher::GetCandidates(const GeoCoord& coord,
+                                 std::vector<Candidate>& candidates)
+  {
+    std::vector<RouteSegmentMatch> matches=router.GetClosestRouteSegments(coord,
+                                                                          profile,
+                                                                          parameter.GetSearchRadius(),
+                                                                          parameter.GetCandidateCount());
+
+    candidates.reserve(matches.size());
+
+    for (const auto& match : matches) {
+      double distance=match.distance.AsMeter()/parameter.GetSigma();
+
+      candidates.push_back(Candidate{match,
+                                     RoutePosition(match.segment.GetObjectFileRef(),
+                                                   match.GetClosestNodeIndex(),
+                                                   /*database*/0),
+                                     -0.5*distance*distance,
+                                     0});
+    }
+  }
+
+  /**
+   * Calculate the distance between two candidates on the same way along the way,
+   * if the way can be used in this direction.
+   */
+  bool MapMatcher::GetSameWayDistance(const Candidate& from,
+                                      const Candidate& to,
+                                      Distance& distance)
+  {
+    FileOffset offset=from.match.segment.way;
+    auto       entry=wayCache.find(offset);
+    WayRef     way;
+
+    if (entry!=wayCache.end()) {
+      way=entry->second;
+    }
+    else {
+      if (!database->GetWayByOffset(offset,
+                                    way)) {
+        log.Error() << "Cannot load way " << offset;
+        return false;
+      }
+
+      if (wayCache.size()>=maxCachedWays) {
+        wayCache.clear();
+      }
+
+      wayCache[offset]=way;
+    }
+
+    const Candidate* first=&from;
+    const Candidate* last=&to;
+    bool             forward=from.match.segment.nodeIndex<to.match.segment.nodeIndex ||
+                             (from.match.segment.nodeIndex==to.match.segment.nodeIndex &&
+                              from.match.fraction<=to.match.fraction);
+
+    if (forward) {
+      if (!profile.CanUseForward(*way)) {
+        return false;
+      }
+    }
+    else {
+      if (!profile.CanUseBackward(*way)) {
+        return false;
+      }
+
+      std::swap(first,last);
+    }
+
+    size_t firstIndex=first->match.segment.nodeIndex;
+    size_t lastIndex=last->match.segment.nodeIndex;
+
+    if (lastIndex>=way->nodes.size()) {
+      return false;
+    }
+
+    if (firstIndex==lastIndex) {
+      distance=GetSphericalDistance(first->match.projection,
+                                    last->match.projection);
+
+      return true;
+    }
+
+    distance=GetSphericalDistance(first->match.projection,
+                                  way->nodes[firstIndex+1].GetCoord());
+
+    for (size_t i=firstIndex+1; i<lastIndex; i++) {
+      distance+=GetSphericalDistance(way->nodes[i].GetCoord(),
+                                     way->nodes[i+1].GetCoord());
+    }
+
+    distance+=GetSphericalDistance(way->nodes[lastIndex].GetCoord(),
+                                   last->match.projection);
+
+    return true;
+  }
+
+  /**
+   * Calculate the probabilities of the candidates of the current point (Viterbi step)
+   * based on the routing distances from the candidates of the previous point.
+   * Candidates that cannot be reached get a probability of minus infinity.
+   */
+  bool MapMatcher::CalculateTransitions(const Step& previous,
+                                        Step& current)
+  {
+    std::vector<RoutePosition> sources;
+    std::vector<size_t>        sourceIndexes;
+    std::vector<RoutePosition> targets;
+
+    for (size_t i=0; i<previous.candidates.size(); i++) {
+      if (previous.candidates[i].probability!=-std::numeric_limits<double>::infinity()) {
+        sources.push_back(previous.candidates[i].position);
+        sourceIndexes.push_back(i);
+      }
+    }
+
+    for (const auto& candidate : current.candidates) {
+      targets.push_back(candidate.position);
+    }
+
+    RoutingMatrix matrix=router.CalculateMatrix(profile,
+                                                sources,
+                                                targets,
+                                                routingParameter,
+                                                routeNodeCache);
+
+    if (matrix.GetSourceCount()!=sources.size()) {
+      log.Error() << "Cannot calculate routes between candidates";
+      return false;
+    }
+
+    if (routeNodeCache.GetSize()>parameter.GetMaxCachedNodes()) {
+      routeNodeCache.Clear();
+    }
+
+    double greatCircleDistance=GetSphericalDistance(previous.coord,
+                                                    current.coord).AsMeter();
+    double maxProbability=-std::numeric_limits<double>::infinity();
+
+    for (size_t t=0; t<current.candidates.size(); t++) {
+      Candidate& candidate=current.candidates[t];
+      double     bestProbability=-std::numeric_limits<double>::infinity();
+      size_t     bestPrevious=0;
+
+      for (size_t s=0; s<sources.size(); s++) {
+        const Candidate& source=previous.candidates[sourceIndexes[s]];
+        double           routeDistance=std::numeric_limits<double>::infinity();
+        Distance         sameWayDistance;
+
+        if (matrix.IsReachable(s,t)) {
+          routeDistance=matrix.GetDistance(s,t).AsMeter();
+        }
+
+        if (source.match.segment.way==candidate.match.segment.way &&
+            GetSameWayDistance(source,
+                               candidate,
+                               sameWayDistance)) {
+          routeDistance=std::min(routeDistance,
+                                 sameWayDistance.AsMeter());
+        }
+
+        if (routeDistance==std::numeric_limits<double>::infinity()) {
+          continue;
+        }
+
+        double probability=source.probability-std::fabs(routeDistance-greatCircleDistance)/parameter.GetBeta();
+
+        if (probability>bestProbability) {
+          bestProbability=probability;
+          bestPrevious=sourceIndexes[s];
+        }
+      }
+
+      candidate.probability+=bestProbability;
+      candidate.previous=bestPrevious;
+
+      maxProbability=std::max(maxProbability,
+                              candidate.probability);
+    }
+
+    // Normalize, so that probabilities of long traces do not drift
+    if (maxProbability!=-std::numeric_limits<double>::infinity()) {
+      for (auto& candidate : current.candidates) {
+        candidate.probability-=maxProbability;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Connect the last decided position with the given position by a route
+   * and append it to the resulting route.
+   */
+  bool MapMatcher::AppendRoute(const RoutePosition& position)
+  {
+    if (!hasLastPosition) {
+      hasLastPosition=true;
+      lastPosition=position;
+
+      return true;
+    }
+
+    if (lastPosition.GetObjectFileRef()==position.GetObjectFileRef() &&
+        lastPosition.GetNodeIndex()==position.GetNodeIndex()) {
+      return true;
+    }
+
+    RoutingResult result=router.CalculateRoute(profile,
+                                               lastPosition,
+                                               position,
+                                               routingParameter);
+
+    lastPosition=position;
+
+    if (!result.Success()) {
+      log.Warn() << "Cannot connect matched positions, splitting trace";
+      pendingTarget=false;
+      breakCount++;
+
+      return true;
+    }
+
+    // The target of the previous part is the start of this part
+    if (pendingTarget) {
+      route.PopEntry();
+    }
+
+    route.Append(result.GetRoute());
+    pendingTarget=true;
+
+    return true;
+  }
+
+  /**
+   * Decide the first count points of the window along the sequence ending in
+   * the given candidate of the last decided point.
+   */
+  bool MapMatcher::Decide(size_t count,
+                          size_t candidate)
+  {
+    std::vector<RoutePosition> positions(count);
+
+    for (size_t i=count; i>0; i--) {
+      const Candidate& current=window[i-1].candidates[candidate];
+
+      positions[i-1]=current.position;
+      candidate=current.previous;
+    }
+
+    for (const auto& position : positions) {
+      if (!AppendRoute(position)) {
+        return false;
+      }
+    }
+
+    window.erase(window.begin(),
+                 window.begin()+count);
+
+    return true;
+  }
+
+  /**
+   * Decide all points up to the latest point, at which all remaining sequences
+   * pass the same candidate.
+   */
+  bool MapMatcher::DecideConverged()
+  {
+    if (window.size()<2) {
+      return true;
+    }
+
+    std::set<size_t> candidates;
+
+    for (size_t i=0; i<window.back().candidates.size(); i++) {
+      if (window.back().candidates[i].probability!=-std::numeric_limits<double>::infinity()) {
+        candidates.insert(i);
+      }
+    }
+
+    for (size_t step=window.size()-1; step>0; step--) {
+      std::set<size_t> previous;
+
+      for (size_t candidate : candidates) {
+        previous.insert(window[step].candidates[candidate].previous);
+      }
+
+      candidates.swap(previous);
+
+      if (candidates.size()==1) {
+        return Decide(step,
+                      *candidates.begin());
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Decide all points of the window along the most probable sequence.
+   */
+  bool MapMatcher::DecideAll()
+  {
+    if (window.empty()) {
+      return true;
+    }
+
+    const std::vector<Candidate>& candidates=window.back().candidates;
+    size_t                        best=0;
+
+    for (size_t i=1; i<candidates.size(); i++) {
+      if (candidates[i].probability>candidates[best].probability) {
+        best=i;
+      }
+    }
+
+    return Decide(window.size(),
+                  best);
+  }
+
+  /**
+   * Add the next point of the trace.
+   *
+   * @param coord
+   *    The position of the point
+   * @return
+   *    false, if an error occurred, else true
+   */
+  bool MapMatcher::AddPoint(const GeoCoord& coord)
+  {
+    pointCount++;
+
+    if (!window.empty() &&
+        GetSphericalDistance(window.back().coord,
+                             coord)<parameter.GetMinPointDistance()) {
+      return true;
+    }
+
+    Step step;
+
+    step.coord=coord;
+
+    GetCandidates(coord,
+                  step.candidates);
+
+    if (step.candidates.empty()) {
+      return true;
+    }
+
+    matchedCount++;
+
+    if (window.empty()) {
+      window.push_back(std::move(step));
+
+      return true;
+    }
+
+    std::vector<double> emissions;
+
+    emissions.reserve(step.candidates.size());
+
+    for (const auto& candidate : step.candidates) {
+      emissions.push_back(candidate.probability);
+    }
+
+    if (!CalculateTransitions(window.back(),
+                              step)) {
+      return false;
+    }
+
+    bool reachable=std::any_of(step.candidates.begin(),
+                               step.candidates.end(),
+                               [](const Candidate& candidate) {
+      return candidate.probability!=-std::numeric_limits<double>::infinity();
+    });
+
+    if (!reachable) {
+      // No candidate can be reached, finish the trace so far and start a new one
+      if (!DecideAll()) {
+        return false;
+      }
+
+      hasLastPosition=false;
+      pendingTarget=false;
+      breakCount++;
+
+      for (size_t i=0; i<step.candidates.size(); i++) {
+        step.candidates[i].probability=emissions[i];
+        step.candidates[i].previous=0;
+      }
+
+      window.push_back(std::move(step));
+
+      return true;
+    }
+
+    window.push_back(std::move(step));
+
+    if (!DecideConverged()) {
+      return false;
+    }
+
+    if (window.size()>parameter.GetWindowSize()) {
+      // Decide all but the last point along the most probable sequence and
+      // drop the candidates of the last point not continuing this sequence
+      std::vector<Candidate>& candidates=window.back().candidates;
+      size_t                  best=0;
+
+      for (size_t i=1; i<candidates.size(); i++) {
+        if (candidates[i].probability>candidates[best].probability) {
+          best=i;
+        }
+      }
+
+      size_t decided=candidates[best].previous;
+
+      if (!Decide(window.size()-1,
+                  decided)) {
+        return false;
+      }
+
+      for (auto& candidate : candidates) {
+        if (candidate.previous!=decided) {
+          candidate.probability=-std::numeric_limits<double>::infinity();
+        }
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Decide the remaining points of the trace. Afterwards the complete route can
+   * be taken and further points start a new trace.
+   *
+   * @return
+   *    false, if an error occurred, else true
+   */
+  bool MapMatcher::Finish()
+  {
+    bool success=DecideAll();
+
+    window.clear();
+    hasLastPosition=false;
+    pendingTarget=false;
+
+    return success;
+  }
+
+  /**
+   * Return the route of the points decided so far and remove it from the matcher.
+   * Before Finish() the last entry is held back, since the following route
+   * continues there.
+   */
+  RouteData MapMatcher::TakeRoute()
+  {
+    RouteData result;
+
+    result.Append(std::move(route));
+    route.Clear();
+
+    if (pendingTarget &&
+        !result.IsEmpty()) {
+      route.Entries().push_back(result.Entries().back());
+      result.PopEntry();
+    }
+
+    return result;
+  }
+
+  /**
+   * Match a complete trace.
+   *
+   * @param coords
+   *    The positions of the trace
+   * @return
+   *    The matched route. In case of an error or if no point could be matched,
+   *    the route is empty.
+   */
+  RoutingResult MapMatcher::Match(const std::vector<GeoCoord>& coords)
+  {
+    RoutingResult result;
+
+    for (const auto& coord : coords) {
+      if (!AddPoint(coord)) {
+        Finish();
+        TakeRoute();
+
+        return result;
+      }
+    }
+
+    if (!Finish()) {
+      TakeRoute();
+
+      return result;
+    }
+
+    result.GetRoute()=TakeRoute();
+
+    return result;
+  }
+}
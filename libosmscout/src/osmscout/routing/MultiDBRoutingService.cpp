@@ -353,6 +353,27 @@ namespace osmscout {
     return twins;
   }
 
+  bool MultiDBRoutingService::GetJunctionObjects(const DBId& id,
+                                                 std::vector<ObjectFileRef>& objects)
+  {
+    assert(handles.size()>id.database);
+
+    JunctionRef junction;
+
+    objects.clear();
+
+    if (!handles[id.database].routingDatabase->GetJunction(id.id,
+                                                           junction)) {
+      return false;
+    }
+
+    if (junction) {
+      objects=junction->GetObjects();
+    }
+
+    return true;
+  }
+
   RoutingResult MultiDBRoutingService::CalculateRoute(const RoutePosition &start,
                                                       const RoutePosition &target,
                                                       const RoutingParameter &parameter)
@@ -19,6 +19,8 @@
 
 #include <osmscout/routing/Route.h>
 
+#include <algorithm>
+#include <iterator>
 #include <sstream>
 
 #include <osmscout/system/Assert.h>
@@ -528,6 +530,30 @@ namespace osmscout {
     descriptionMap[name]=description;
   }
 
+  /**
+   * Add all descriptions of the given node (a copy of this node), starting with
+   * the description at the given offset, in the order they were added to the
+   * given node
+   */
+  void RouteDescription::Node::AddDescriptions(const Node& node,
+                                               size_t offset)
+  {
+    auto description=node.descriptions.begin();
+
+    std::advance(description,std::min(offset,node.descriptions.size()));
+
+    for (; description!=node.descriptions.end(); ++description) {
+      descriptions.push_back(*description);
+
+      for (const auto& entry : node.descriptionMap) {
+        if (entry.second==*description) {
+          descriptionMap[entry.first]=*description;
+          break;
+        }
+      }
+    }
+  }
+
   RouteDescription::RouteDescription()
   {
     // no code
@@ -0,0 +1,203 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/routing/RouteGraph.h>
+
+#include <numeric>
+
+#include <osmscout/util/Logger.h>
+
+namespace osmscout {
+
+  RouteGraph::RouteGraph()
+  {
+    pathStart.push_back(0);
+    objectStart.push_back(0);
+    excludeStart.push_back(0);
+  }
+
+  /**
+   * Append the given route node to the graph. The targets of the paths are
+   * resolved by Finish().
+   */
+  void RouteGraph::AddNode(const RouteNode& node)
+  {
+    GeoCoord coord=node.GetCoord();
+
+    nodeIds.push_back(node.GetId());
+    nodeLats.push_back(coord.GetLat());
+    nodeLons.push_back(coord.GetLon());
+
+    for (const auto& path : node.paths) {
+      pathTargetIds.push_back(path.id);
+      pathDistances.push_back(path.distance);
+      pathObjectIndexes.push_back(path.objectIndex);
+      pathFlags.push_back(path.flags);
+    }
+
+    for (const auto& object : node.objects) {
+      objects.push_back(object.object);
+      objectVariantIndexes.push_back(object.objectVariantIndex);
+    }
+
+    // Excludes referencing a path or object that does not exist can never match
+    for (const auto& exclude : node.excludes) {
+      uint8_t objectIndex;
+
+      if (node.GetExcludeTargetObjectIndex(exclude,objectIndex)) {
+        excludeSources.push_back(exclude.source);
+        excludeTargetIndexes.push_back(objectIndex);
+      }
+    }
+
+    pathStart.push_back((uint32_t)pathDistances.size());
+    objectStart.push_back((uint32_t)objects.size());
+    excludeStart.push_back((uint32_t)excludeSources.size());
+  }
+
+  /**
+   * Build the lookup of nodes by id and resolve the target ids of all paths
+   * to node indexes. Must be called after the last node has been added.
+   */
+  void RouteGraph::Finish()
+  {
+    std::vector<uint32_t> order(nodeIds.size());
+
+    std::iota(order.begin(),order.end(),0);
+    std::sort(order.begin(),order.end(),[this](uint32_t a, uint32_t b) {
+      return nodeIds[a]<nodeIds[b];
+    });
+
+    sortedIds.resize(order.size());
+    sortedIndexes=std::move(order);
+
+    for (size_t i=0; i<sortedIndexes.size(); i++) {
+      sortedIds[i]=nodeIds[sortedIndexes[i]];
+    }
+
+    size_t unresolved=0;
+
+    pathTargets.resize(pathTargetIds.size());
+
+    for (size_t i=0; i<pathTargetIds.size(); i++) {
+      pathTargets[i]=GetNodeIndex(pathTargetIds[i]);
+
+      if (pathTargets[i]==invalidIndex) {
+        unresolved++;
+      }
+    }
+
+    if (unresolved>0) {
+      log.Warn() << unresolved << " paths of the route graph lead to unknown route nodes";
+    }
+
+    pathTargetIds.clear();
+    pathTargetIds.shrink_to_fit();
+
+    nodeIds.shrink_to_fit();
+    nodeLats.shrink_to_fit();
+    nodeLons.shrink_to_fit();
+    pathStart.shrink_to_fit();
+    objectStart.shrink_to_fit();
+    excludeStart.shrink_to_fit();
+    pathDistances.shrink_to_fit();
+    pathObjectIndexes.shrink_to_fit();
+    pathFlags.shrink_to_fit();
+    objects.shrink_to_fit();
+    objectVariantIndexes.shrink_to_fit();
+    excludeSources.shrink_to_fit();
+    excludeTargetIndexes.shrink_to_fit();
+  }
+
+  /**
+   * Return the (approximate) number of bytes used by the graph
+   */
+  size_t RouteGraph::GetMemoryUsage() const
+  {
+    return nodeIds.capacity()*sizeof(Id)+
+           nodeLats.capacity()*sizeof(double)+
+           nodeLons.capacity()*sizeof(double)+
+           pathStart.capacity()*sizeof(uint32_t)+
+           objectStart.capacity()*sizeof(uint32_t)+
+           excludeStart.capacity()*sizeof(uint32_t)+
+           pathTargets.capacity()*sizeof(uint32_t)+
+           pathDistances.capacity()*sizeof(Distance)+
+           pathObjectIndexes.capacity()*sizeof(uint8_t)+
+           pathFlags.capacity()*sizeof(uint8_t)+
+           objects.capacity()*sizeof(ObjectFileRef)+
+           objectVariantIndexes.capacity()*sizeof(uint16_t)+
+           excludeSources.capacity()*sizeof(ObjectFileRef)+
+           excludeTargetIndexes.capacity()*sizeof(uint8_t)+
+           sortedIds.capacity()*sizeof(Id)+
+           sortedIndexes.capacity()*sizeof(uint32_t);
+  }
+
+  /**
+   * Calculate the costs of all paths of the graph for the given profile. Paths
+   * that cannot be used by the profile get infinite costs.
+   *
+   * Costs and usability are evaluated by the profile itself, so the result is the
+   * same as evaluating the profile for each route node during the search.
+   */
+  std::vector<double> RouteGraph::CalculateCosts(const RoutingProfile& profile,
+                                                 const std::vector<ObjectVariantData>& objectVariantData) const
+  {
+    std::vector<double> costs(GetPathCount(),
+                              std::numeric_limits<double>::infinity());
+    RouteNode           node;
+
+    for (uint32_t n=0; n<GetNodeCount(); n++) {
+      uint32_t pathBegin=pathStart[n];
+      uint32_t pathEnd=pathStart[n+1];
+
+      node.Initialize(0,
+                      Point(0,GetNodeCoord(n)));
+
+      node.objects.resize(objectStart[n+1]-objectStart[n]);
+
+      for (size_t i=0; i<node.objects.size(); i++) {
+        node.objects[i].object=objects[objectStart[n]+i];
+        node.objects[i].objectVariantIndex=objectVariantIndexes[objectStart[n]+i];
+      }
+
+      node.paths.resize(pathEnd-pathBegin);
+
+      for (size_t i=0; i<node.paths.size(); i++) {
+        RouteNode::Path& path=node.paths[i];
+
+        path.id=pathTargets[pathBegin+i]!=invalidIndex ? nodeIds[pathTargets[pathBegin+i]] : 0;
+        path.distance=pathDistances[pathBegin+i];
+        path.objectIndex=pathObjectIndexes[pathBegin+i];
+        path.flags=pathFlags[pathBegin+i];
+      }
+
+      for (size_t i=0; i<node.paths.size(); i++) {
+        if (profile.CanUse(node,
+                           objectVariantData,
+                           i)) {
+          costs[pathBegin+i]=profile.GetCosts(node,
+                                              objectVariantData,
+                                              i);
+        }
+      }
+    }
+
+    return costs;
+  }
+}
@@ -19,35 +19,16 @@
 
 #include <osmscout/routing/RouteNodeDataFile.h>
 
+#include <algorithm>
+
 namespace osmscout {
 
-  RouteNodeRef RouteNodeDataFile::IndexPage::find(FileScanner& scanner,
-                                                  Id id)
+  RouteNodeRef RouteNodeDataFile::IndexPage::find(Id id) const
   {
-    if (!nodeMap.empty()) {
-      auto nodeEntry=nodeMap.find(id);
-
-      if (nodeEntry!=nodeMap.end()) {
-        return nodeEntry->second;
-      }
-    }
-
-    if (remaining>0) {
-      scanner.SetPos(fileOffset);
+    auto nodeEntry=nodeMap.find(id);
 
-      while (remaining>0) {
-        remaining--;
-        RouteNodeRef node=std::make_shared<RouteNode>();
-
-        node->Read(scanner);
-        nodeMap.insert(std::make_pair(node->GetId(),node));
-
-        fileOffset=scanner.GetPos();
-
-        if (node->GetId()==id) {
-          return node;
-        }
-      }
+    if (nodeEntry!=nodeMap.end()) {
+      return nodeEntry->second;
     }
 
     return nullptr;
@@ -56,10 +37,24 @@ namespace osmscout {
   RouteNodeDataFile::RouteNodeDataFile(const std::string& datafile,
                                        size_t cacheSize)
   : datafile(datafile),
-    cache(cacheSize)
+    cacheSize(cacheSize),
+    cache(cacheSize),
+    asyncPrefetch(false)
   {
   }
 
+  /**
+   * If set, pages are read using an AsyncFileReader with many reads in flight
+   * and decoded from the read buffer, so that threads loading pages
+   * concurrently do not wait for each other, see DataFile::SetAsyncPrefetch().
+   *
+   * Must be called before Open().
+   */
+  void RouteNodeDataFile::SetAsyncPrefetch(bool asyncPrefetch)
+  {
+    this->asyncPrefetch=asyncPrefetch;
+  }
+
   bool RouteNodeDataFile::Open(const TypeConfigRef& typeConfig,
                                const std::string& path,
                                bool memoryMappedData)
@@ -68,8 +63,9 @@ namespace osmscout {
 
     datafilename=AppendFileToDir(path,datafile);
 
+    FileOffset indexFileOffset;
+
     try {
-      FileOffset indexFileOffset;
       uint32_t   dataCount;
       uint32_t   indexEntryCount;
       uint32_t   tileMag;
@@ -95,6 +91,7 @@ namespace osmscout {
         scanner.Read(cell.y);
         scanner.ReadFileOffset(entry.fileOffset);
         scanner.Read(entry.count);
+        entry.size=0;
 
         index[cell]=entry;
       }
@@ -105,6 +102,39 @@ namespace osmscout {
       return false;
     }
 
+    if (asyncPrefetch) {
+      // Pages are stored one after the other in front of the index
+      std::vector<IndexEntry*> entries;
+
+      entries.reserve(index.size());
+
+      for (auto& entry : index) {
+        entries.push_back(&entry.second);
+      }
+
+      std::sort(entries.begin(),
+                entries.end(),
+                [](const IndexEntry* a, const IndexEntry* b) {
+                  return a->fileOffset<b->fileOffset;
+                });
+
+      for (size_t i=0; i<entries.size(); i++) {
+        FileOffset end=i+1<entries.size() ? entries[i+1]->fileOffset : indexFileOffset;
+
+        entries[i]->size=end>entries[i]->fileOffset ? end-entries[i]->fileOffset : 0;
+      }
+
+      try {
+        asyncReader.reset(new AsyncFileReader());
+        asyncReader->Open(datafilename);
+      }
+      catch (IOException& e) {
+        // Not fatal, pages are read using the scanner
+        log.Warn() << e.GetDescription();
+        asyncReader.reset();
+      }
+    }
+
     return true;
   }
 
@@ -126,6 +156,7 @@ namespace osmscout {
   bool RouteNodeDataFile::Close()
   {
     typeConfig=nullptr;
+    asyncReader.reset();
 
     try  {
       if (scanner.IsOpen()) {
@@ -141,8 +172,159 @@ namespace osmscout {
     return true;
   }
 
+  /**
+   * Change the eviction policy of the route node page cache.
+   *
+   * Method is thread-safe.
+   */
+  void RouteNodeDataFile::SetCachePolicy(CachePolicy policy)
+  {
+    std::lock_guard<std::mutex> lock(accessMutex);
+
+    cache.SetPolicy(policy);
+  }
+
+  std::string RouteNodeDataFile::GetMemoryConsumerName() const
+  {
+    return datafile;
+  }
+
+  /**
+   * Return the memory of the cached pages. Only available, if the cache
+   * is limited by memory using SetMemoryLimit(), else 0 is returned.
+   *
+   * Method is thread-safe.
+   */
+  size_t RouteNodeDataFile::GetMemoryUsage() const
+  {
+    std::lock_guard<std::mutex> lock(accessMutex);
+
+    return cache.GetCurrentMemory();
+  }
+
+  /**
+   * Return the accumulated hits and misses of the page cache.
+   *
+   * Method is thread-safe.
+   */
+  void RouteNodeDataFile::GetCacheStatistics(size_t& hits,
+                                             size_t& misses) const
+  {
+    std::lock_guard<std::mutex> lock(accessMutex);
+
+    hits=cache.GetHits();
+    misses=cache.GetMisses();
+  }
+
+  /**
+   * Limit the route node page cache to the given number of bytes instead of
+   * the number of pages passed in the constructor. Passing 0 restores the
+   * page count limit.
+   *
+   * Method is thread-safe.
+   */
+  void RouteNodeDataFile::SetMemoryLimit(size_t bytes)
+  {
+    std::lock_guard<std::mutex> lock(accessMutex);
+
+    if (bytes>0) {
+      cache.SetMaxSize(std::max(bytes/(sizeof(IndexPageRef)+sizeof(IndexPage)),(size_t)1));
+      cache.SetMaxMemory(bytes,
+                         std::make_shared<ValueSizer>());
+    }
+    else {
+      cache.SetMaxSize(cacheSize);
+      cache.SetMaxMemory(0,
+                         nullptr);
+    }
+  }
+
+  /**
+   * Read the route nodes of the page using the given scanner.
+   */
+  void RouteNodeDataFile::ReadIndexPage(FileScanner& pageScanner,
+                                        const IndexEntry& entry,
+                                        IndexPage& page) const
+  {
+    pageScanner.SetPos(entry.fileOffset);
+
+    for (uint32_t i=0; i<entry.count; i++) {
+      RouteNodeRef node=std::make_shared<RouteNode>();
+
+      node->Read(pageScanner);
+
+      page.nodeMap.insert(std::make_pair(node->GetId(),node));
+
+      page.memory+=sizeof(RouteNode)+
+                   node->objects.capacity()*sizeof(RouteNode::ObjectData)+
+                   node->paths.capacity()*sizeof(RouteNode::Path)+
+                   node->excludes.capacity()*sizeof(RouteNode::Exclude);
+    }
+  }
+
+  /**
+   * Read the page using the AsyncFileReader with many reads in flight and decode
+   * it from the read buffer. Returns false, if the page could not be read, the
+   * page is unchanged in this case.
+   *
+   * Method is thread-safe.
+   */
+  bool RouteNodeDataFile::ReadIndexPageBuffer(const IndexEntry& entry,
+                                              IndexPage& page) const
+  {
+    // The page is split into chunks of this size
+    const FileOffset chunkSize=64*1024;
+
+    std::vector<char>                         buffer((size_t)entry.size);
+    std::vector<AsyncFileReader::ReadRequest> chunks;
+
+    for (FileOffset offset=0; offset<entry.size; offset+=chunkSize) {
+      chunks.push_back(AsyncFileReader::ReadRequest{entry.fileOffset+offset,
+                                                    (size_t)std::min(chunkSize,entry.size-offset),
+                                                    buffer.data()+offset,
+                                                    false});
+    }
+
+    if (!asyncReader->Read(chunks)) {
+      return false;
+    }
+
+    FileScanner pageScanner;
+    IndexPage   bufferPage;
+
+    bufferPage.memory=page.memory;
+    bufferPage.nodeMap.reserve(entry.count);
+
+    try {
+      pageScanner.Open(datafilename,
+                       buffer.data(),
+                       entry.fileOffset,
+                       buffer.size());
+
+      ReadIndexPage(pageScanner,
+                    entry,
+                    bufferPage);
+
+      pageScanner.Close();
+    }
+    catch (IOException& e) {
+      log.Warn() << e.GetDescription();
+      pageScanner.CloseFailsafe();
+      return false;
+    }
+
+    page=std::move(bufferPage);
+
+    return true;
+  }
+
+  /**
+   * Read all route nodes of the given tile.
+   *
+   * Method is thread-safe.
+   */
   bool RouteNodeDataFile::LoadIndexPage(const osmscout::Pixel& tile,
-                                        ValueCache::CacheRef& cacheRef) const
+                                        IndexPageRef& page) const
   {
     assert(IsOpen());
 
@@ -152,53 +334,132 @@ namespace osmscout {
       return false;
     }
 
-    ValueCache::CacheEntry cacheEntry(tile.GetId());
+    std::shared_ptr<IndexPage> newPage=std::make_shared<IndexPage>();
+
+    newPage->nodeMap.reserve(entry->second.count);
+    // Buckets and nodes of the map
+    newPage->memory=sizeof(IndexPage)+
+                    newPage->nodeMap.bucket_count()*sizeof(void*)+
+                    entry->second.count*(sizeof(std::pair<const Id,RouteNodeRef>)+sizeof(void*));
+
+    if (asyncReader &&
+        entry->second.size>0 &&
+        ReadIndexPageBuffer(entry->second,
+                            *newPage)) {
+      page=newPage;
+
+      return true;
+    }
+
+    try {
+      std::lock_guard<std::mutex> lock(scannerMutex);
 
-    cacheEntry.value.fileOffset=entry->second.fileOffset;
-    cacheEntry.value.remaining=entry->second.count;
+      ReadIndexPage(scanner,
+                    entry->second,
+                    *newPage);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
 
-    cacheRef=cache.SetEntry(cacheEntry);
+    page=newPage;
 
     return true;
   }
 
+  /**
+   * Return the page for the given tile either from the cache or by loading it.
+   * If two threads load the same page concurrently, both get a valid
+   * copy and the copy stored last stays in the cache.
+   *
+   * Method is thread-safe.
+   */
   bool RouteNodeDataFile::GetIndexPage(const osmscout::Pixel& tile,
-                                       ValueCache::CacheRef& cacheRef) const
+                                       IndexPageRef& page) const
   {
-    if (!cache.GetEntry(tile.GetId(),
-                        cacheRef)) {
-      //std::cout << "RouteNodeDF::GetIndexPage() Not fond in cache, loading...!" << std::endl;
-      if (!LoadIndexPage(tile,
+    {
+      std::lock_guard<std::mutex> lock(accessMutex);
+      ValueCache::CacheRef        cacheRef;
+
+      if (cache.GetEntry(tile.GetId(),
                          cacheRef)) {
-        return false;
+        page=cacheRef->value;
+
+        return true;
       }
     }
 
+    if (!LoadIndexPage(tile,
+                       page)) {
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(accessMutex);
+
+    cache.SetEntry(ValueCache::CacheEntry(tile.GetId(),
+                                          page));
+
     return true;
   }
 
+  /**
+   * Return the route node with the given id.
+   *
+   * Method is thread-safe.
+   */
   bool RouteNodeDataFile::Get(Id id,
                               RouteNodeRef& node) const
   {
-    //std::cout << "Loading RouteNode " << id << "..." << std::endl;
-    ValueCache::CacheRef cacheRef;
+    IndexPageRef page;
 
     GeoCoord coord=Point::GetCoordFromId(id);
     TileId   tile=TileId::GetTile(magnification,coord);
 
-    //std::cout << "Tile " << tile.GetDisplayText() << " " << tile.GetId() << "..." << std::endl;
-
     if (!GetIndexPage(tile.AsPixel(),
-                      cacheRef)) {
+                      page)) {
       return false;
     }
 
-    node=cacheRef->value.find(scanner,
-                              id);
+    node=page->find(id);
 
     return node!=nullptr;
   }
 
+  /**
+   * Load all route nodes into the given graph. The route node page cache
+   * is not touched.
+   *
+   * Method is thread-safe.
+   */
+  bool RouteNodeDataFile::Load(RouteGraph& graph) const
+  {
+    assert(IsOpen());
+
+    try {
+      std::lock_guard<std::mutex> lock(scannerMutex);
+      RouteNode                   node;
+
+      for (const auto& entry : index) {
+        scanner.SetPos(entry.second.fileOffset);
+
+        for (uint32_t i=0; i<entry.second.count; i++) {
+          node.Read(scanner);
+
+          graph.AddNode(node);
+        }
+      }
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    graph.Finish();
+
+    return true;
+  }
+
   Pixel RouteNodeDataFile::GetTile(const GeoCoord& coord) const
   {
     return TileId::GetTile(magnification,coord).AsPixel();
@@ -23,23 +23,46 @@
 
 #include <osmscout/util/Geometry.h>
 #include <osmscout/util/Logger.h>
+#include <osmscout/util/StopClock.h>
 
 #include <osmscout/LocationDescriptionService.h>
 
+#include <algorithm>
 #include <iostream>
+#include <thread>
+
 namespace osmscout {
 
+  static const double junctionDelta=1E-7;
+
   RoutePostprocessor::Postprocessor::~Postprocessor()
   {
     // no code
   }
 
+  /**
+   * Return true, if the postprocessor only adds descriptions to the nodes of the
+   * route and does not depend on descriptions added by other postprocessors.
+   *
+   * Consecutive independent postprocessors are executed concurrently. The
+   * result is the same as for sequential execution.
+   */
+  bool RoutePostprocessor::Postprocessor::IsIndependent() const
+  {
+    return false;
+  }
+
   RoutePostprocessor::StartPostprocessor::StartPostprocessor(const std::string& startDescription)
   : startDescription(startDescription)
   {
     // no code
   }
 
+  bool RoutePostprocessor::StartPostprocessor::IsIndependent() const
+  {
+    return true;
+  }
+
   bool RoutePostprocessor::StartPostprocessor::Process(const RoutePostprocessor& /*postprocessor*/,
                                                        RouteDescription& description)
   {
@@ -57,6 +80,11 @@ namespace osmscout {
     // no code
   }
 
+  bool RoutePostprocessor::TargetPostprocessor::IsIndependent() const
+  {
+    return true;
+  }
+
   bool RoutePostprocessor::TargetPostprocessor::Process(const RoutePostprocessor& /*postprocessor*/,
                                                         RouteDescription& description)
   {
@@ -160,6 +188,11 @@ namespace osmscout {
     // no code
   }
 
+  bool RoutePostprocessor::WayNamePostprocessor::IsIndependent() const
+  {
+    return true;
+  }
+
   bool RoutePostprocessor::WayNamePostprocessor::Process(const RoutePostprocessor& postprocessor,
                                                          RouteDescription& description)
   {
@@ -215,6 +248,11 @@ namespace osmscout {
     // no code
   }
 
+  bool RoutePostprocessor::WayTypePostprocessor::IsIndependent() const
+  {
+    return true;
+  }
+
   bool RoutePostprocessor::WayTypePostprocessor::Process(const RoutePostprocessor& postprocessor,
                                                          RouteDescription& description)
   {
@@ -287,6 +325,11 @@ namespace osmscout {
     }
   }
 
+  bool RoutePostprocessor::CrossingWaysPostprocessor::IsIndependent() const
+  {
+    return true;
+  }
+
   bool RoutePostprocessor::CrossingWaysPostprocessor::Process(const RoutePostprocessor& postprocessor,
                                                               RouteDescription& description)
   {
@@ -389,6 +432,11 @@ namespace osmscout {
     // no code
   }
 
+  bool RoutePostprocessor::DirectionPostprocessor::IsIndependent() const
+  {
+    return true;
+  }
+
   bool RoutePostprocessor::DirectionPostprocessor::Process(const RoutePostprocessor& postprocessor,
                                                            RouteDescription& description)
   {
@@ -488,6 +536,11 @@ namespace osmscout {
     // no code
   }
 
+  bool RoutePostprocessor::MotorwayJunctionPostprocessor::IsIndependent() const
+  {
+    return true;
+  }
+
   bool RoutePostprocessor::MotorwayJunctionPostprocessor::Process(const RoutePostprocessor& postprocessor,
                                                                   RouteDescription& description)
   {
@@ -561,6 +614,11 @@ namespace osmscout {
     // no code
   }
 
+  bool RoutePostprocessor::DestinationPostprocessor::IsIndependent() const
+  {
+    return true;
+  }
+
   bool RoutePostprocessor::DestinationPostprocessor::Process(const RoutePostprocessor& postprocessor,
                                                              RouteDescription& description)
   {
@@ -601,6 +659,11 @@ namespace osmscout {
     return true;
   }
 
+  bool RoutePostprocessor::MaxSpeedPostprocessor::IsIndependent() const
+  {
+    return true;
+  }
+
   bool RoutePostprocessor::MaxSpeedPostprocessor::Process(const RoutePostprocessor& postprocessor,
                                                           RouteDescription& description)
   {
@@ -1376,6 +1439,11 @@ namespace osmscout {
     }
   }
 
+  bool RoutePostprocessor::POIsPostprocessor::IsIndependent() const
+  {
+    return true;
+  }
+
   bool RoutePostprocessor::POIsPostprocessor::Process(const RoutePostprocessor& postprocessor,
                                                       RouteDescription& description)
   {
@@ -1474,6 +1542,24 @@ namespace osmscout {
   {
   }
 
+  RoutePostprocessor::~RoutePostprocessor()
+  {
+    workerQueue.Stop();
+
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  void RoutePostprocessor::WorkerLoop()
+  {
+    std::packaged_task<bool()> task;
+
+    while (workerQueue.PopTask(task)) {
+      task();
+    }
+  }
+
   bool RoutePostprocessor::ResolveAllAreasAndWays(const RouteDescription& description,
                                                   DatabaseId dbId,
                                                   Database& database)
@@ -1548,10 +1634,129 @@ namespace osmscout {
     return true;
   }
 
+  /**
+   * Load the motorway junctions for all nodes of the route, where the
+   * MotorwayJunctionPostprocessor looks for a junction, in advance. The
+   * junction nodes of all these locations are loaded with a single
+   * lookup in the area node index.
+   */
+  bool RoutePostprocessor::ResolveAllJunctions(const RouteDescription& description,
+                                               DatabaseId dbId,
+                                               Database& database)
+  {
+    auto types=junctionTypes.find(dbId);
+
+    if (types==junctionTypes.end() ||
+        types->second.Empty()) {
+      return true;
+    }
+
+    AreaNodeIndexRef areaNodeIndex=database.GetAreaNodeIndex();
+
+    if (!areaNodeIndex) {
+      return true;
+    }
+
+    auto nameReader=nameReaders.find(dbId);
+    auto refReader=refReaders.find(dbId);
+
+    assert(nameReader!=nameReaders.end());
+    assert(refReader!=refReaders.end());
+
+    std::set<GeoCoord>      coords;
+    ObjectFileRef           prevObject;
+    DatabaseId              prevDatabase=0;
+    std::vector<FileOffset> nodeOffsets;
+    std::vector<NodeRef>    nodes;
+
+    // Same selection of nodes as in MotorwayJunctionPostprocessor
+    for (const auto& node : description.Nodes()) {
+      if (!node.HasPathObject()) {
+        continue;
+      }
+
+      if (node.GetPathObject()==prevObject &&
+          node.GetDatabaseId()==prevDatabase) {
+        continue;
+      }
+
+      if (node.GetDatabaseId()==dbId &&
+          node.GetPathObject().GetType()==refWay) {
+        WayRef way=GetWay(node.GetDBFileOffset());
+
+        coords.insert(way->GetCoord(node.GetCurrentNodeIndex()));
+      }
+
+      prevObject=node.GetPathObject();
+      prevDatabase=node.GetDatabaseId();
+    }
+
+    if (coords.empty()) {
+      return true;
+    }
+
+    std::vector<GeoBox> boundingBoxes;
+    TypeInfoSet         loadedTypes;
+
+    boundingBoxes.reserve(coords.size());
+
+    for (const auto& coord : coords) {
+      boundingBoxes.emplace_back(GeoCoord(coord.GetLat()-junctionDelta,coord.GetLon()-junctionDelta),
+                                 GeoCoord(coord.GetLat()+junctionDelta,coord.GetLon()+junctionDelta));
+    }
+
+    if (!areaNodeIndex->GetOffsets(boundingBoxes,
+                                   types->second,
+                                   nodeOffsets,
+                                   loadedTypes)) {
+      log.Error() << "Error getting nodes from area node index!";
+      return false;
+    }
+
+    std::sort(nodeOffsets.begin(),nodeOffsets.end());
+    nodeOffsets.erase(std::unique(nodeOffsets.begin(),nodeOffsets.end()),
+                      nodeOffsets.end());
+
+    if (!nodeOffsets.empty() &&
+        !database.GetNodesByOffset(nodeOffsets,
+                                   nodes)) {
+      log.Error() << "Error reading nodes in area!";
+      return false;
+    }
+
+    std::map<GeoCoord,Junction>& dbJunctions=junctions[dbId];
+
+    for (const auto& coord : coords) {
+      Junction& junction=dbJunctions[coord];
+
+      for (const auto& node : nodes) {
+        if (fabs(node->GetCoords().GetLat() - coord.GetLat()) < junctionDelta &&
+            fabs(node->GetCoords().GetLon() - coord.GetLon()) < junctionDelta) {
+          RefFeatureValue *refFeatureValue=refReader->second->GetValue(node->GetFeatureValueBuffer());
+
+          if (refFeatureValue!=nullptr) {
+            junction.ref=refFeatureValue->GetRef();
+          }
+
+          NameFeatureValue *nameFeatureValue=nameReader->second->GetValue(node->GetFeatureValueBuffer());
+
+          if (nameFeatureValue!=nullptr) {
+            junction.name=nameFeatureValue->GetName();
+          }
+
+          break;
+        }
+      }
+    }
+
+    return true;
+  }
+
   void RoutePostprocessor::Cleanup()
   {
     areaMap.clear();
     wayMap.clear();
+    junctions.clear();
 
     motorwayTypes.clear();
     motorwayLinkTypes.clear();
@@ -1702,13 +1907,26 @@ namespace osmscout {
 
   bool RoutePostprocessor::LoadJunction(DatabaseId dbId,
                                         GeoCoord coord,
-                                        std::string junctionRef,
-                                        std::string junctionName) const
+                                        std::string& junctionRef,
+                                        std::string& junctionName) const
   {
-    double                  delta=1E-7;
+    double                  delta=junctionDelta;
     std::vector<FileOffset> nodeOffsets;
     std::vector<NodeRef>    nodes;
 
+    auto dbJunctions=junctions.find(dbId);
+
+    if (dbJunctions!=junctions.end()) {
+      auto junction=dbJunctions->second.find(coord);
+
+      if (junction!=dbJunctions->second.end()) {
+        junctionRef=junction->second.ref;
+        junctionName=junction->second.name;
+
+        return true;
+      }
+    }
+
     auto nameReaderIt=nameReaders.find(dbId);
     assert(nameReaderIt!=nameReaders.end());
     NameFeatureValueReader* nameReader=nameReaderIt->second;
@@ -2091,6 +2309,88 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Execute the postprocessors in the range [start,end). If there is more than one
+   * postprocessor, they are executed concurrently by the workers of the
+   * RoutePostprocessor and the calling thread. The first postprocessor works on the
+   * description itself, all others on a copy. The descriptions added to the copies are
+   * merged afterwards in the order of the postprocessors, so the result is the same as for
+   * sequential execution.
+   */
+  bool RoutePostprocessor::ExecutePostprocessors(RouteDescription& description,
+                                                 const std::vector<PostprocessorRef>& processors,
+                                                 size_t start,
+                                                 size_t end)
+  {
+    auto execute=[this,&processors](size_t index,
+                                    RouteDescription& target) {
+      StopClock clock;
+      bool      success=processors[index]->Process(*this,target);
+
+      clock.Stop();
+      timings[index]=clock.GetMilliseconds();
+
+      if (!success) {
+        log.Error() << "Error during execution of postprocessor " << index+1;
+      }
+
+      return success;
+    };
+
+    if (end-start==1) {
+      return execute(start,description);
+    }
+
+    std::vector<RouteDescription>  copies(end-start-1,description);
+    std::vector<size_t>            descriptionCounts;
+    std::vector<std::future<bool>> results;
+    size_t                         maxWorkers=std::max(std::thread::hardware_concurrency(),2u)-1;
+
+    descriptionCounts.reserve(description.Nodes().size());
+
+    for (const auto& node : description.Nodes()) {
+      descriptionCounts.push_back(node.GetDescriptions().size());
+    }
+
+    // The workers are kept for later calls, their number is bounded by the number of cores
+    while (workers.size()<std::min(end-start-1,maxWorkers)) {
+      workers.emplace_back(&RoutePostprocessor::WorkerLoop,this);
+    }
+
+    for (size_t index=start+1; index<end; index++) {
+      std::packaged_task<bool()> task([&execute,&copies,start,index] {
+        return execute(index,copies[index-start-1]);
+      });
+
+      results.push_back(task.get_future());
+      workerQueue.PushTask(task);
+    }
+
+    bool success=execute(start,description);
+
+    for (auto& result : results) {
+      success=result.get() && success;
+    }
+
+    if (!success) {
+      return false;
+    }
+
+    for (const auto& copy : copies) {
+      auto count=descriptionCounts.begin();
+      auto node=description.Nodes().begin();
+
+      for (const auto& copyNode : copy.Nodes()) {
+        node->AddDescriptions(copyNode,*count);
+
+        ++node;
+        ++count;
+      }
+    }
+
+    return true;
+  }
+
   bool RoutePostprocessor::PostprocessRouteDescription(RouteDescription& description,
                                                        const std::vector<RoutingProfileRef>& profiles,
                                                        const std::vector<DatabaseRef>& databases,
@@ -2101,6 +2401,13 @@ namespace osmscout {
   {
     Cleanup(); // We do not trust ourself ;-)
 
+    // Junctions are only of interest for the MotorwayJunctionPostprocessor
+    bool prefetchJunctions=std::any_of(processors.begin(),
+                                       processors.end(),
+                                       [](const PostprocessorRef& processor) {
+                                         return std::dynamic_pointer_cast<MotorwayJunctionPostprocessor>(processor)!=nullptr;
+                                       });
+
     this->databases=databases;
     this->profiles=profiles;
 
@@ -2143,18 +2450,43 @@ namespace osmscout {
         Cleanup();
         return false;
       }
+
+      if (prefetchJunctions &&
+          !ResolveAllJunctions(description,
+                               dbId,
+                               *database)) {
+        Cleanup();
+        return false;
+      }
     }
 
-    size_t pos=1;
-    for (const auto& processor : processors) {
-      if (!processor->Process(*this,description)) {
-        log.Error() << "Error during execution of postprocessor " << pos;
+    // Consecutive independent postprocessors are executed together, all others one by one
+    std::vector<PostprocessorRef> processorList(processors.begin(),
+                                                processors.end());
+    size_t                        start=0;
+
+    timings.assign(processorList.size(),0.0);
+
+    while (start<processorList.size()) {
+      size_t end=start+1;
+
+      if (processorList[start]->IsIndependent()) {
+        while (end<processorList.size() &&
+               processorList[end]->IsIndependent()) {
+          end++;
+        }
+      }
+
+      if (!ExecutePostprocessors(description,
+                                 processorList,
+                                 start,
+                                 end)) {
         Cleanup();
 
         return false;
       }
 
-      pos++;
+      start=end;
     }
 
     Cleanup();
@@ -0,0 +1,398 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/routing/RouteSegmentIndex.h>
+
+#include <algorithm>
+#include <queue>
+
+#include <osmscout/TypeFeatures.h>
+
+#include <osmscout/util/Logger.h>
+
+#include <osmscout/system/Math.h>
+
+namespace osmscout {
+
+  /**
+   * Length of one degree latitude in meter. Distances are calculated in an
+   * equirectangular projection around the searched coordinate, which is exact
+   * enough for the small distances relevant for snapping.
+   */
+  static const double meterPerDegree=6371010.0*M_PI/180.0;
+
+  RouteSegment::RouteSegment()
+  : way(0),
+    nodeIndex(0),
+    typeIndex(0),
+    access(0),
+    prevRouteNode(0),
+    prevRouteNodeIndex(0),
+    nextRouteNode(0),
+    nextRouteNodeIndex(0)
+  {
+    // no code
+  }
+
+  void RouteSegment::Read(FileScanner& scanner)
+  {
+    scanner.ReadCoord(from);
+    scanner.ReadCoord(to);
+    scanner.Read(way);
+    scanner.Read(nodeIndex);
+    scanner.Read(typeIndex);
+    scanner.Read(access);
+    scanner.Read(prevRouteNode);
+    scanner.Read(prevRouteNodeIndex);
+    scanner.Read(nextRouteNode);
+    scanner.Read(nextRouteNodeIndex);
+  }
+
+  void RouteSegment::Write(FileWriter& writer) const
+  {
+    writer.WriteCoord(from);
+    writer.WriteCoord(to);
+    writer.Write(way);
+    writer.Write(nodeIndex);
+    writer.Write(typeIndex);
+    writer.Write(access);
+    writer.Write(prevRouteNode);
+    writer.Write(prevRouteNodeIndex);
+    writer.Write(nextRouteNode);
+    writer.Write(nextRouteNodeIndex);
+  }
+
+  void RouteSegmentIndex::Node::Read(FileScanner& scanner)
+  {
+    scanner.Read(minLat);
+    scanner.Read(minLon);
+    scanner.Read(maxLat);
+    scanner.Read(maxLon);
+    scanner.Read(access);
+  }
+
+  void RouteSegmentIndex::Node::Write(FileWriter& writer) const
+  {
+    writer.Write(minLat);
+    writer.Write(minLon);
+    writer.Write(maxLat);
+    writer.Write(maxLon);
+    writer.Write(access);
+  }
+
+  RouteSegmentIndex::RouteSegmentIndex()
+  : vehicleMask(0),
+    segmentCount(0),
+    segmentOffset(0)
+  {
+    // no code
+  }
+
+  RouteSegmentIndex::~RouteSegmentIndex()
+  {
+    Close();
+  }
+
+  /**
+   * Open the index and load the nodes of the tree.
+   *
+   * Method is NOT thread-safe.
+   */
+  bool RouteSegmentIndex::Open(const std::string& filename,
+                               bool memoryMappedData)
+  {
+    this->filename=filename;
+
+    try {
+      uint32_t version;
+      uint32_t levelCount;
+
+      scanner.Open(filename,
+                   FileScanner::LowMemRandom,
+                   memoryMappedData);
+
+      scanner.Read(version);
+
+      if (version!=fileFormatVersion) {
+        log.Warn() << "File '" << filename << "' has unsupported format version " << version << ", ignoring it";
+        scanner.Close();
+
+        return false;
+      }
+
+      scanner.Read(vehicleMask);
+      scanner.Read(segmentCount);
+      scanner.Read(levelCount);
+
+      levels.resize(levelCount);
+
+      for (auto& level : levels) {
+        uint32_t nodeCount;
+
+        scanner.Read(nodeCount);
+
+        level.resize(nodeCount);
+      }
+
+      for (auto& level : levels) {
+        for (auto& node : level) {
+          node.Read(scanner);
+        }
+      }
+
+      segmentOffset=scanner.GetPos();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner.CloseFailsafe();
+      levels.clear();
+      vehicleMask=0;
+      segmentCount=0;
+
+      return false;
+    }
+
+    return true;
+  }
+
+  bool RouteSegmentIndex::IsOpen() const
+  {
+    return scanner.IsOpen();
+  }
+
+  /**
+   * Close the index.
+   *
+   * Method is NOT thread-safe.
+   */
+  bool RouteSegmentIndex::Close()
+  {
+    levels.clear();
+    vehicleMask=0;
+    segmentCount=0;
+
+    try  {
+      if (scanner.IsOpen()) {
+        scanner.Close();
+      }
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner.CloseFailsafe();
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Read the segments of the given leaf of the tree
+   */
+  bool RouteSegmentIndex::ReadSegments(uint32_t leaf,
+                                       std::vector<RouteSegment>& segments) const
+  {
+    uint32_t first=leaf*nodeSize;
+    uint32_t count=std::min(first+nodeSize,segmentCount)-first;
+
+    segments.resize(count);
+
+    try {
+      std::lock_guard<std::mutex> lock(scannerMutex);
+
+      scanner.SetPos(segmentOffset+(FileOffset)first*RouteSegment::recordSize);
+
+      for (auto& segment : segments) {
+        segment.Read(scanner);
+      }
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Calculate the point of the segment closest to the given coordinate
+   */
+  void RouteSegmentIndex::Project(const GeoCoord& coord,
+                                  const RouteSegment& segment,
+                                  RouteSegmentMatch& match)
+  {
+    double scale=std::cos(coord.GetLat()*M_PI/180.0);
+    double ax=(segment.from.GetLon()-coord.GetLon())*scale;
+    double ay=segment.from.GetLat()-coord.GetLat();
+    double bx=(segment.to.GetLon()-coord.GetLon())*scale;
+    double by=segment.to.GetLat()-coord.GetLat();
+    double dx=bx-ax;
+    double dy=by-ay;
+    double length=dx*dx+dy*dy;
+    double fraction=0.0;
+
+    if (length>0.0) {
+      fraction=std::max(0.0,std::min(1.0,-(ax*dx+ay*dy)/length));
+    }
+
+    double px=ax+fraction*dx;
+    double py=ay+fraction*dy;
+
+    match.segment=segment;
+    match.fraction=fraction;
+    match.projection=GeoCoord(segment.from.GetLat()+fraction*(segment.to.GetLat()-segment.from.GetLat()),
+                              segment.from.GetLon()+fraction*(segment.to.GetLon()-segment.from.GetLon()));
+    match.distance=Distance::Of<Meter>(std::sqrt(px*px+py*py)*meterPerDegree);
+  }
+
+  /**
+   * Return up to maxCount segments usable by the given vehicle within the given distance
+   * of the coordinate, ordered by increasing distance. Only the tree nodes and the
+   * segments of the visited leaves are accessed, no way is loaded.
+   *
+   * Method is thread-safe.
+   *
+   * @param coord
+   *    The coordinate to search for
+   * @param vehicle
+   *    Only segments with access for this vehicle are returned
+   * @param maxDistance
+   *    Maximum distance of the segments
+   * @param maxCount
+   *    Maximum number of segments to return
+   * @param filter
+   *    Optional additional filter
+   * @param matches
+   *    The resulting segments
+   * @return
+   *    false, if the index could not be read, else true
+   */
+  bool RouteSegmentIndex::GetClosestSegments(const GeoCoord& coord,
+                                             Vehicle vehicle,
+                                             const Distance& maxDistance,
+                                             size_t maxCount,
+                                             const SegmentFilter& filter,
+                                             std::vector<RouteSegmentMatch>& matches) const
+  {
+    /**
+     * A node (level>=0) or a candidate segment (level<0) in the queue of the search
+     */
+    struct Entry
+    {
+      double distance;
+      int    level;
+      size_t index;
+
+      inline bool operator<(const Entry& other) const
+      {
+        return distance>other.distance;
+      }
+    };
+
+    matches.clear();
+
+    if (levels.empty() ||
+        maxCount==0) {
+      return true;
+    }
+
+    double                         scale=std::cos(coord.GetLat()*M_PI/180.0);
+    double                         maxDist=maxDistance.AsMeter();
+    std::priority_queue<Entry>     queue;
+    std::vector<RouteSegmentMatch> candidates;
+    std::vector<RouteSegment>      segments;
+
+    auto nodeDistance=[&](const Node& node) {
+      double minLat=node.minLat/latConversionFactor-90.0;
+      double maxLat=node.maxLat/latConversionFactor-90.0;
+      double minLon=node.minLon/lonConversionFactor-180.0;
+      double maxLon=node.maxLon/lonConversionFactor-180.0;
+      double dy=std::max(0.0,std::max(minLat-coord.GetLat(),coord.GetLat()-maxLat));
+      double dx=std::max(0.0,std::max(minLon-coord.GetLon(),coord.GetLon()-maxLon))*scale;
+
+      return std::sqrt(dx*dx+dy*dy)*meterPerDegree;
+    };
+
+    auto pushNode=[&](int level,
+                      size_t index) {
+      const Node& node=levels[level][index];
+
+      if (!AccessFeatureValue(node.access).CanRoute(vehicle)) {
+        return;
+      }
+
+      double distance=nodeDistance(node);
+
+      if (distance<=maxDist) {
+        queue.push(Entry{distance,level,index});
+      }
+    };
+
+    for (size_t i=0; i<levels.back().size(); i++) {
+      pushNode((int)levels.size()-1,i);
+    }
+
+    while (!queue.empty() &&
+           matches.size()<maxCount) {
+      Entry entry=queue.top();
+
+      queue.pop();
+
+      if (entry.level<0) {
+        matches.push_back(candidates[entry.index]);
+        continue;
+      }
+
+      if (entry.level>0) {
+        size_t first=entry.index*nodeSize;
+        size_t last=std::min(first+nodeSize,levels[entry.level-1].size());
+
+        for (size_t i=first; i<last; i++) {
+          pushNode(entry.level-1,i);
+        }
+
+        continue;
+      }
+
+      if (!ReadSegments((uint32_t)entry.index,
+                        segments)) {
+        return false;
+      }
+
+      for (const auto& segment : segments) {
+        if (!AccessFeatureValue(segment.access).CanRoute(vehicle) ||
+            (filter && !filter(segment))) {
+          continue;
+        }
+
+        RouteSegmentMatch match;
+
+        Project(coord,
+                segment,
+                match);
+
+        if (match.distance.AsMeter()<=maxDist) {
+          candidates.push_back(match);
+          queue.push(Entry{match.distance.AsMeter(),-1,candidates.size()-1});
+        }
+      }
+    }
+
+    return true;
+  }
+}
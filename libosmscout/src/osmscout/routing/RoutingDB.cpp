@@ -21,6 +21,8 @@
 
 #include <osmscout/routing/RoutingService.h>
 
+#include <osmscout/util/File.h>
+
 namespace osmscout {
 
   RoutingDatabase::RoutingDatabase()
@@ -35,10 +37,23 @@ namespace osmscout {
   {
   }
 
+  RoutingDatabase::~RoutingDatabase()
+  {
+    // Caches must not be registered at the memory budget after destruction
+    if (memoryBudget) {
+      Close();
+    }
+  }
+
   bool RoutingDatabase::Open(const DatabaseRef& database)
   {
     typeConfig=database->GetTypeConfig();
     path=database->GetPath();
+    memoryBudget=database->GetMemoryBudget();
+
+    junctionDataFile.SetSharedIndexCache(database->GetSharedCache());
+
+    routeNodeDataFile.SetAsyncPrefetch(database->GetParameter().GetDataAsyncPrefetch());
 
     if (!routeNodeDataFile.Open(database->GetTypeConfig(),
                           database->GetPath(),
@@ -47,39 +62,239 @@ namespace osmscout {
       return false;
     }
 
-    return objectVariantDataFile.Load(*(database->GetTypeConfig()),
-                                      AppendFileToDir(database->GetPath(),
-                                                      RoutingService::GetData2Filename(osmscout::RoutingService::DEFAULT_FILENAME_BASE)));
+    if (memoryBudget) {
+      memoryBudget->Register(routeNodeDataFile);
+    }
+
+    if (!objectVariantDataFile.Load(*(database->GetTypeConfig()),
+                                    AppendFileToDir(database->GetPath(),
+                                                    RoutingService::GetData2Filename(osmscout::RoutingService::DEFAULT_FILENAME_BASE)))) {
+      return false;
+    }
+
+    LoadSegmentIndex(database->GetParameter().GetRouterDataMMap());
+
+    return LoadContractionHierarchies();
+  }
+
+  /**
+   * Open the spatial index of the routable way segments, if the import generated it.
+   * Without the index, routable objects are looked up using the area way index.
+   */
+  void RoutingDatabase::LoadSegmentIndex(bool memoryMappedData)
+  {
+    std::string filename=AppendFileToDir(path,
+                                         RoutingService::GetSegmentIndexFilename(osmscout::RoutingService::DEFAULT_FILENAME_BASE));
+
+    segmentIndex.reset();
+
+    if (!ExistsInFilesystem(filename)) {
+      return;
+    }
+
+    RouteSegmentIndexRef index=std::make_shared<RouteSegmentIndex>();
+
+    if (index->Open(filename,
+                    memoryMappedData)) {
+      segmentIndex=index;
+    }
+  }
+
+  /**
+   * Load the contraction hierarchies, if the import generated them. A missing
+   * file is not an error, routing then only uses the routing graph.
+   */
+  bool RoutingDatabase::LoadContractionHierarchies()
+  {
+    std::string filename=AppendFileToDir(path,
+                                         RoutingService::GetContractionHierarchyFilename(osmscout::RoutingService::DEFAULT_FILENAME_BASE));
+
+    contractionHierarchies.clear();
+
+    if (!ExistsInFilesystem(filename)) {
+      return true;
+    }
+
+    FileScanner scanner;
+
+    try {
+      uint32_t fileFormatVersion;
+      uint32_t hierarchyCount;
+
+      scanner.Open(filename,
+                   FileScanner::Sequential,
+                   false);
+
+      scanner.Read(fileFormatVersion);
+
+      if (fileFormatVersion!=ContractionHierarchy::fileFormatVersion) {
+        log.Warn() << "File '" << filename << "' has unsupported format version " << fileFormatVersion << ", ignoring it";
+        scanner.Close();
+
+        return true;
+      }
+
+      scanner.Read(hierarchyCount);
+
+      for (uint32_t i=0; i<hierarchyCount; i++) {
+        ContractionHierarchyRef hierarchy=std::make_shared<ContractionHierarchy>();
+
+        hierarchy->Read(scanner);
+
+        contractionHierarchies.push_back(hierarchy);
+      }
+
+      scanner.Close();
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner.CloseFailsafe();
+      contractionHierarchies.clear();
+
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Load the complete routing graph into memory in a flat layout (see RouteGraph).
+   * The route node data file stays open for access to single route nodes.
+   */
+  bool RoutingDatabase::LoadRouteGraph()
+  {
+    RouteGraphRef graph=std::make_shared<RouteGraph>();
+
+    if (!routeNodeDataFile.Load(*graph)) {
+      log.Error() << "Cannot load routing graph from '" << path << "'!";
+      return false;
+    }
+
+    routeGraph=graph;
+
+    return true;
   }
 
   void RoutingDatabase::Close()
   {
+    if (memoryBudget &&
+        routeNodeDataFile.IsOpen()) {
+      memoryBudget->Unregister(routeNodeDataFile);
+    }
+
     routeNodeDataFile.Close();
-    junctionDataFile.Close();
+
+    {
+      std::lock_guard<std::mutex> lock(junctionMutex);
+
+      CloseJunctionDataFile();
+    }
+
+    contractionHierarchies.clear();
+    routeGraph.reset();
+    segmentIndex.reset();
+    memoryBudget.reset();
 
     typeConfig.reset();
     path.clear();
   }
 
+  /**
+   * Open the junction data file, if not already open, and register its caches
+   * at the memory budget. junctionMutex must be locked.
+   */
+  bool RoutingDatabase::OpenJunctionDataFile()
+  {
+    if (junctionDataFile.IsOpen()) {
+      return true;
+    }
+
+    if (!junctionDataFile.Open(typeConfig,
+                               path,
+                               false,
+                               false)) {
+      return false;
+    }
+
+    if (memoryBudget) {
+      memoryBudget->Register(junctionDataFile);
+      memoryBudget->Register(junctionDataFile.GetIndexMemoryConsumer());
+    }
+
+    return true;
+  }
+
+  /**
+   * Unregister the caches of the junction data file from the memory budget
+   * and close it. junctionMutex must be locked.
+   */
+  bool RoutingDatabase::CloseJunctionDataFile()
+  {
+    if (!junctionDataFile.IsOpen()) {
+      return true;
+    }
+
+    if (memoryBudget) {
+      memoryBudget->Unregister(junctionDataFile.GetIndexMemoryConsumer());
+      memoryBudget->Unregister(junctionDataFile);
+    }
+
+    return junctionDataFile.Close();
+  }
+
+  /**
+   * Return the junctions for the given route node ids.
+   *
+   * Without a memory budget the junction data file is closed again afterwards to
+   * free its caches. With a memory budget the file is kept open, since the budget
+   * limits the memory of its caches.
+   */
   bool RoutingDatabase::GetJunctions(const std::set<Id>& ids,
                                      std::vector<JunctionRef>& junctions)
   {
-    if (!junctionDataFile.IsOpen()) {
-      if (!junctionDataFile.Open(typeConfig,
-                                 path,
-                                 false,
-                                 false)) {
-        return false;
-      }
+    std::lock_guard<std::mutex> lock(junctionMutex);
+
+    if (!OpenJunctionDataFile()) {
+      return false;
     }
 
     bool result=junctionDataFile.Get(ids,
                                      junctions);
 
-    if (!junctionDataFile.Close()) {
+    if (!memoryBudget &&
+        !CloseJunctionDataFile()) {
       result=false;
     }
 
     return result;
   }
+
+  /**
+   * Return the junction for the given route node id. If there is no junction
+   * for the given id, junction is set to nullptr and true is returned.
+   *
+   * In contrast to GetJunctions() the junction data file is kept open for
+   * further calls.
+   */
+  bool RoutingDatabase::GetJunction(Id id,
+                                    JunctionRef& junction)
+  {
+    std::lock_guard<std::mutex> lock(junctionMutex);
+
+    junction=nullptr;
+
+    if (!OpenJunctionDataFile()) {
+      return false;
+    }
+
+    FileOffset offset;
+
+    if (!junctionDataFile.GetOffset(id,
+                                    offset)) {
+      return true;
+    }
+
+    return junctionDataFile.GetByOffset(offset,
+                                        junction);
+  }
 }
@@ -32,6 +32,34 @@ namespace osmscout {
     // no code
   }
 
+  /**
+   * Return the time (in hours) needed to travel the given path of the route node.
+   *
+   * The default implementation does not know anything about speeds and returns 0,
+   * profiles should overwrite it, if they want to deliver times for route node based
+   * calculations like SimpleRoutingService::CalculateMatrix().
+   */
+  double RoutingProfile::GetTime(const RouteNode& /*currentNode*/,
+                                 const std::vector<ObjectVariantData>& /*objectVariantData*/,
+                                 size_t /*pathIndex*/) const
+  {
+    return 0.0;
+  }
+
+  /**
+   * Return a key identifying the costs the profile assigns to the paths of the
+   * routing graph. Profiles with the same non-empty key must return the same costs
+   * and the same usability for all paths, so that costs calculated for one of them
+   * can be reused for the others.
+   *
+   * The default implementation returns an empty key, signaling that the costs of the
+   * profile cannot be identified.
+   */
+  std::string RoutingProfile::GetCostsKey() const
+  {
+    return "";
+  }
+
   AbstractRoutingProfile::AbstractRoutingProfile(const TypeConfigRef& typeConfig)
    : typeConfig(typeConfig),
      accessReader(*typeConfig),
@@ -47,6 +75,28 @@ namespace osmscout {
     // no code
   }
 
+  /**
+   * Build a costs key (see RoutingProfile::GetCostsKey()) from the given name of the
+   * cost function and all parameters of the profile the costs depend on: The vehicle,
+   * the speed of each type, the maximum speed and the maximum speed of the vehicle.
+   * The values are stored as raw bytes, so different values result in different keys.
+   */
+  std::string AbstractRoutingProfile::BuildCostsKey(const std::string& costFunction) const
+  {
+    std::string key(costFunction);
+
+    key.push_back('\0');
+    key.append(reinterpret_cast<const char*>(&vehicle),sizeof(vehicle));
+    key.append(reinterpret_cast<const char*>(&maxSpeed),sizeof(maxSpeed));
+    key.append(reinterpret_cast<const char*>(&vehicleMaxSpeed),sizeof(vehicleMaxSpeed));
+
+    if (!speeds.empty()) {
+      key.append(reinterpret_cast<const char*>(speeds.data()),speeds.size()*sizeof(double));
+    }
+
+    return key;
+  }
+
   void AbstractRoutingProfile::SetVehicle(Vehicle vehicle)
   {
     this->vehicle=vehicle;
@@ -258,6 +308,22 @@ namespace osmscout {
     return false;
   }
 
+  /**
+   * Return true, if an object of the given type with the given access can be used.
+   * For ways the result is the same as for CanUse(const Way&).
+   */
+  bool AbstractRoutingProfile::CanUse(const TypeInfo& type,
+                                      const AccessFeatureValue& access) const
+  {
+    size_t index=type.GetIndex();
+
+    if (index>=speeds.size() || speeds[index]<=0.0) {
+      return false;
+    }
+
+    return access.CanRoute(vehicle);
+  }
+
   bool AbstractRoutingProfile::CanUseForward(const Way& way) const
   {
     size_t index=way.GetType()->GetIndex();
@@ -344,9 +410,19 @@ namespace osmscout {
     // no code
   }
 
+  std::string ShortestPathRoutingProfile::GetCostsKey() const
+  {
+    return BuildCostsKey("shortest");
+  }
+
   FastestPathRoutingProfile::FastestPathRoutingProfile(const TypeConfigRef& typeConfig)
   : AbstractRoutingProfile(typeConfig)
   {
     // no code
   }
+
+  std::string FastestPathRoutingProfile::GetCostsKey() const
+  {
+    return BuildCostsKey("fastest");
+  }
 }
@@ -19,6 +19,12 @@
 
 #include <osmscout/routing/RoutingService.h>
 
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+#include <osmscout/system/Assert.h>
+
 namespace osmscout {
 
   RoutePosition::RoutePosition()
@@ -38,7 +44,8 @@ namespace osmscout {
   }
 
   RouterParameter::RouterParameter()
-  : debugPerformance(false)
+  : debugPerformance(false),
+    flatRouteGraph(false)
   {
     // no code
   }
@@ -48,16 +55,44 @@ namespace osmscout {
     debugPerformance=debug;
   }
 
+  /**
+   * If set, the router loads the complete routing graph into memory in a
+   * compact flat layout when opened (see RouteGraph). Routing then does not need
+   * to load route nodes during the search, at the price of holding the whole
+   * graph in memory. Only use it if there is enough RAM for the routing graph.
+   */
+  void RouterParameter::SetFlatRouteGraph(bool flatRouteGraph)
+  {
+    this->flatRouteGraph=flatRouteGraph;
+  }
+
   bool RouterParameter::IsDebugPerformance() const
   {
     return debugPerformance;
   }
 
+  bool RouterParameter::IsFlatRouteGraph() const
+  {
+    return flatRouteGraph;
+  }
+
   RoutingProgress::~RoutingProgress()
   {
     // no code
   }
 
+  void RoutingProgress::Reached(const std::vector<ReachableNode>& /*nodes*/)
+  {
+    // no code
+  }
+
+  RoutingParameter::RoutingParameter()
+  : bidirectional(false),
+    threadCount(std::max(1u,std::thread::hardware_concurrency()))
+  {
+    // no code
+  }
+
   void RoutingParameter::SetBreaker(const BreakerRef& breaker)
   {
     this->breaker=breaker;
@@ -68,11 +103,110 @@ namespace osmscout {
     this->progress=progress;
   }
 
+  /**
+   * If set, the route is calculated by a bidirectional A* search, searching
+   * from the start and from the target at the same time. This reduces the
+   * number of visited route nodes, but requires additional lookups for the
+   * incoming paths of a route node.
+   */
+  void RoutingParameter::SetBidirectional(bool bidirectional)
+  {
+    this->bidirectional=bidirectional;
+  }
+
+  /**
+   * Set the number of threads used by calculations that can be split into
+   * independent parts, like the rows of a RoutingMatrix. The default is
+   * the number of hardware threads.
+   */
+  void RoutingParameter::SetThreadCount(size_t threadCount)
+  {
+    this->threadCount=std::max((size_t)1,threadCount);
+  }
+
   RoutingResult::RoutingResult()
   {
     // no code
   }
 
+  IsochroneParameter::IsochroneParameter()
+  : maxTime(0.0),
+    frontierSize(0)
+  {
+    // no code
+  }
+
+  /**
+   * Set the maximum travel time in hours
+   */
+  void IsochroneParameter::SetMaxTime(double maxTime)
+  {
+    this->maxTime=maxTime;
+  }
+
+  /**
+   * Set the maximum travel distance
+   */
+  void IsochroneParameter::SetMaxDistance(const Distance& maxDistance)
+  {
+    this->maxDistance=maxDistance;
+  }
+
+  /**
+   * If set, the outline of the reachable area is calculated by rasterizing
+   * the reachable route nodes into cells of the given size
+   */
+  void IsochroneParameter::SetPolygonCellSize(const Distance& polygonCellSize)
+  {
+    this->polygonCellSize=polygonCellSize;
+  }
+
+  /**
+   * If set (and a RoutingProgress is given), the reached route nodes are
+   * passed to RoutingProgress::Reached() in chunks of the given size while
+   * the calculation is running
+   */
+  void IsochroneParameter::SetFrontierSize(size_t frontierSize)
+  {
+    this->frontierSize=frontierSize;
+  }
+
+  IsochroneResult::IsochroneResult()
+  {
+    // no code
+  }
+
+  RoutingMatrix::RoutingMatrix()
+  : sourceCount(0),
+    targetCount(0)
+  {
+    // no code
+  }
+
+  RoutingMatrix::RoutingMatrix(size_t sourceCount,
+                               size_t targetCount)
+  : sourceCount(sourceCount),
+    targetCount(targetCount),
+    costs(sourceCount*targetCount,std::numeric_limits<double>::infinity()),
+    times(sourceCount*targetCount,std::numeric_limits<double>::infinity()),
+    distances(sourceCount*targetCount,std::numeric_limits<double>::infinity())
+  {
+    // no code
+  }
+
+  void RoutingMatrix::Set(size_t source,
+                          size_t target,
+                          double costs,
+                          double time,
+                          const Distance& distance)
+  {
+    size_t index=source*targetCount+target;
+
+    this->costs[index]=costs;
+    this->times[index]=time;
+    this->distances[index]=distance.As<Kilometer>();
+  }
+
   std::string RoutingService::GetDataFilename(const std::string& filenamebase)
   {
     return filenamebase+".dat";
@@ -88,6 +222,16 @@ namespace osmscout {
     return filenamebase+".idx";
   }
 
+  std::string RoutingService::GetContractionHierarchyFilename(const std::string& filenamebase)
+  {
+    return filenamebase+"_ch.dat";
+  }
+
+  std::string RoutingService::GetSegmentIndexFilename(const std::string& filenamebase)
+  {
+    return filenamebase+"_segment.idx";
+  }
+
   const char* const RoutingService::FILENAME_INTERSECTIONS_DAT   = "intersections.dat";
   const char* const RoutingService::FILENAME_INTERSECTIONS_IDX   = "intersections.idx";
 
@@ -100,4 +244,116 @@ namespace osmscout {
   RoutingService::~RoutingService()
   {
   }
+
+  /**
+   * Number of children of each node in the open list heap. A 4-ary heap
+   * is less deep than a binary heap and the children of a node are adjacent
+   * in memory.
+   */
+  static const size_t openListArity=4;
+
+  void RoutingService::OpenList::MoveTo(const RNodeRef& node,
+                                        size_t index)
+  {
+    node->heapIndex=index;
+    heap[index]=node;
+  }
+
+  void RoutingService::OpenList::SiftUp(size_t index)
+  {
+    RNodeCostCompare less;
+    RNodeRef         node=std::move(heap[index]);
+
+    while (index>0) {
+      size_t parent=(index-1)/openListArity;
+
+      if (!less(node,heap[parent])) {
+        break;
+      }
+
+      MoveTo(heap[parent],index);
+      index=parent;
+    }
+
+    MoveTo(node,index);
+  }
+
+  void RoutingService::OpenList::SiftDown(size_t index)
+  {
+    RNodeCostCompare less;
+    RNodeRef         node=std::move(heap[index]);
+
+    while (true) {
+      size_t firstChild=index*openListArity+1;
+
+      if (firstChild>=heap.size()) {
+        break;
+      }
+
+      size_t lastChild=std::min(firstChild+openListArity,heap.size());
+      size_t minChild=firstChild;
+
+      for (size_t child=firstChild+1; child<lastChild; child++) {
+        if (less(heap[child],heap[minChild])) {
+          minChild=child;
+        }
+      }
+
+      if (!less(heap[minChild],node)) {
+        break;
+      }
+
+      MoveTo(heap[minChild],index);
+      index=minChild;
+    }
+
+    MoveTo(node,index);
+  }
+
+  /**
+   * Add a node to the open list. The node must not be in the list already.
+   */
+  void RoutingService::OpenList::Push(const RNodeRef& node)
+  {
+    heap.push_back(node);
+    SiftUp(heap.size()-1);
+  }
+
+  /**
+   * Remove the node with the lowest costs from the list and return it
+   */
+  RoutingService::RNodeRef RoutingService::OpenList::Pop()
+  {
+    assert(!heap.empty());
+
+    RNodeRef top=std::move(heap.front());
+    RNodeRef last=std::move(heap.back());
+
+    heap.pop_back();
+
+    if (!heap.empty()) {
+      heap.front()=std::move(last);
+      SiftDown(0);
+    }
+
+    return top;
+  }
+
+  /**
+   * Restore the heap order after the costs of the given node (which must be in the list)
+   * have been changed
+   */
+  void RoutingService::OpenList::Update(const RNode& node)
+  {
+    assert(node.heapIndex<heap.size() &&
+           heap[node.heapIndex].get()==&node);
+
+    size_t index=node.heapIndex;
+
+    SiftUp(index);
+
+    if (node.heapIndex==index) {
+      SiftDown(index);
+    }
+  }
 }
@@ -20,12 +20,18 @@
 #include <iomanip>
 #include <iostream>
 #include <algorithm>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <thread>
 
 #include <osmscout/system/Assert.h>
 
 #include <osmscout/util/Geometry.h>
 #include <osmscout/util/Logger.h>
 #include <osmscout/util/StopClock.h>
+#include <osmscout/util/WorkQueue.h>
 
 #include <osmscout/routing/RoutingService.h>
 #include <osmscout/routing/SimpleRoutingService.h>
@@ -37,6 +43,48 @@
 
 namespace osmscout {
 
+  static const size_t routeGraphCostsCacheSize=4; //!< Number of profile costs of the flat routing graph kept in memory
+
+  /**
+   * Return the route node with the given id, if it is in the cache.
+   */
+  bool RouteNodeCache::Get(Id id,
+                           RouteNodeRef& node) const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto                        entry=nodes.find(id);
+
+    if (entry==nodes.end()) {
+      return false;
+    }
+
+    node=entry->second;
+
+    return true;
+  }
+
+  void RouteNodeCache::Set(Id id,
+                           const RouteNodeRef& node)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    nodes[id]=node;
+  }
+
+  size_t RouteNodeCache::GetSize() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return nodes.size();
+  }
+
+  void RouteNodeCache::Clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    nodes.clear();
+  }
+
   /**
    * Create a new instance of the routing service.
    *
@@ -52,13 +100,20 @@ namespace osmscout {
      database(database),
      filenamebase(filenamebase),
      accessReader(*database->GetTypeConfig()),
-     isOpen(false)
+     isOpen(false),
+     flatRouteGraph(parameter.IsFlatRouteGraph())
   {
     assert(database);
   }
 
   SimpleRoutingService::~SimpleRoutingService()
   {
+    matrixQueue.Stop();
+
+    for (auto& thread : matrixThreads) {
+      thread.join();
+    }
+
     if (isOpen) {
       Close();
     }
@@ -308,6 +363,262 @@ namespace osmscout {
     return result;
   }
 
+  /**
+   * Return the costs of all paths of the flat routing graph for the given profile.
+   *
+   * Costs are cached by the costs key of the profile (see RoutingProfile::GetCostsKey()),
+   * so profiles with the same parameters share their costs. Only the costs of the
+   * routeGraphCostsCacheSize most recently used keys are kept. Costs of profiles
+   * without costs key are calculated for each call.
+   *
+   * Method is thread-safe.
+   */
+  SimpleRoutingService::RouteGraphCostsRef SimpleRoutingService::GetRouteGraphCosts(const RoutingProfile& profile)
+  {
+    std::string key=profile.GetCostsKey();
+
+    if (!key.empty()) {
+      std::lock_guard<std::mutex> lock(routeGraphCostsMutex);
+
+      for (auto entry=routeGraphCosts.begin(); entry!=routeGraphCosts.end(); ++entry) {
+        if (entry->first==key) {
+          routeGraphCosts.splice(routeGraphCosts.begin(),routeGraphCosts,entry);
+
+          return entry->second;
+        }
+      }
+    }
+
+    // Calculated without holding the lock, so other queries are not blocked
+    RouteGraphCostsRef costs=std::make_shared<std::vector<double>>(routingDatabase.GetRouteGraph()->CalculateCosts(profile,
+                                                                                                                   routingDatabase.GetObjectVariantData()));
+
+    if (key.empty()) {
+      return costs;
+    }
+
+    std::lock_guard<std::mutex> lock(routeGraphCostsMutex);
+
+    // Another query may have calculated the same costs in the meantime
+    for (const auto& entry : routeGraphCosts) {
+      if (entry.first==key) {
+        return entry.second;
+      }
+    }
+
+    routeGraphCosts.push_front(std::make_pair(key,costs));
+
+    if (routeGraphCosts.size()>routeGraphCostsCacheSize) {
+      routeGraphCosts.pop_back();
+    }
+
+    return costs;
+  }
+
+  /**
+   * Fetch the costs of the flat routing graph for the profile once per route calculation.
+   */
+  bool SimpleRoutingService::PrepareQuery(const RoutingProfile& profile,
+                                          QueryContext& context)
+  {
+    if (routingDatabase.GetRouteGraph()) {
+      context.pathCosts=GetRouteGraphCosts(profile);
+    }
+
+    return true;
+  }
+
+  bool SimpleRoutingService::GetJunctionObjects(const DBId& id,
+                                                std::vector<ObjectFileRef>& objects)
+  {
+    JunctionRef junction;
+
+    objects.clear();
+
+    if (!routingDatabase.GetJunction(id.id,
+                                     junction)) {
+      return false;
+    }
+
+    if (junction) {
+      objects=junction->GetObjects();
+    }
+
+    return true;
+  }
+
+  /**
+   * Walk the paths of the current route node using the flat routing graph, if it
+   * has been loaded. Costs, coordinates and targets are taken from the graph, so
+   * no route node needs to be loaded and no path costs are evaluated during the search.
+   * The result is the same as for the default implementation.
+   */
+  bool SimpleRoutingService::WalkPaths(const RoutingProfile& profile,
+                                       const QueryContext& context,
+                                       RNodeRef &current,
+                                       RouteNodeRef &currentRouteNode,
+                                       OpenList &openList,
+                                       OpenMap &openMap,
+                                       ClosedSet &closedSet,
+                                       ClosedSet &closedRestrictedSet,
+                                       RoutingResult &result,
+                                       const RoutingParameter& parameter,
+                                       const GeoCoord &targetCoord,
+                                       const Vehicle &vehicle,
+                                       size_t &nodesIgnoredCount,
+                                       Distance &currentMaxDistance,
+                                       const Distance &overallDistance,
+                                       const double &costLimit)
+  {
+    const RouteGraphRef& graph=routingDatabase.GetRouteGraph();
+
+    if (!graph ||
+        !context.pathCosts) {
+      return AbstractRoutingService<RoutingProfile>::WalkPaths(profile,
+                                                               context,
+                                                               current,
+                                                               currentRouteNode,
+                                                               openList,
+                                                               openMap,
+                                                               closedSet,
+                                                               closedRestrictedSet,
+                                                               result,
+                                                               parameter,
+                                                               targetCoord,
+                                                               vehicle,
+                                                               nodesIgnoredCount,
+                                                               currentMaxDistance,
+                                                               overallDistance,
+                                                               costLimit);
+    }
+
+    const std::vector<double>& costs=*context.pathCosts;
+    DatabaseId                 dbId=current->id.database;
+    uint32_t                   nodeIndex=graph->GetNodeIndex(current->id.id);
+
+    if (nodeIndex==RouteGraph::invalidIndex) {
+      log.Error() << "Route node with id " << current->id.id << " is not part of the routing graph";
+      return false;
+    }
+
+    uint32_t excludeBegin=graph->GetExcludeBegin(nodeIndex);
+    uint32_t excludeEnd=graph->GetExcludeEnd(nodeIndex);
+
+    for (uint32_t path=graph->GetPathBegin(nodeIndex); path<graph->GetPathEnd(nodeIndex); path++) {
+      uint32_t targetIndex=graph->GetPathTarget(path);
+
+      if (targetIndex==RouteGraph::invalidIndex) {
+        nodesIgnoredCount++;
+        continue;
+      }
+
+      Id targetId=graph->GetNodeId(targetIndex);
+
+      // Back to the last node visited
+      if (targetId==current->prev.id) {
+        nodesIgnoredCount++;
+        continue;
+      }
+
+      // Moving from non-accessible way back to accessible way
+      if (!current->access &&
+          !graph->IsPathRestricted(path,vehicle)) {
+        nodesIgnoredCount++;
+        continue;
+      }
+
+      // Cannot be used
+      if (costs[path]==std::numeric_limits<double>::infinity()) {
+        nodesIgnoredCount++;
+        continue;
+      }
+
+      DBId targetDBId(dbId,targetId);
+
+      if ((current->access &&
+           closedSet.Contains(targetDBId)) ||
+          (!current->access &&
+           closedRestrictedSet.Contains(targetDBId))) {
+        continue;
+      }
+
+      const ObjectFileRef& object=graph->GetPathObject(nodeIndex,path);
+      bool                 canTurnedInto=true;
+
+      for (uint32_t exclude=excludeBegin; exclude<excludeEnd; exclude++) {
+        if (graph->GetExcludeSource(exclude)==current->object &&
+            graph->GetExcludeTarget(nodeIndex,exclude)==object) {
+          canTurnedInto=false;
+          break;
+        }
+      }
+
+      if (!canTurnedInto) {
+        nodesIgnoredCount++;
+        continue;
+      }
+
+      double currentCost=current->currentCost+costs[path];
+
+      RNode** openEntryRef=openMap.Find(targetDBId);
+      RNode*  openEntry=openEntryRef!=nullptr ? *openEntryRef : nullptr;
+
+      // Check, if we already have a cheaper path to the new node
+      if (openEntry!=nullptr &&
+          openEntry->currentCost<=currentCost) {
+        continue;
+      }
+
+      Distance distanceToTarget=GetSphericalDistance(graph->GetNodeCoord(targetIndex),
+                                                     targetCoord);
+
+      currentMaxDistance=Distance::Max(currentMaxDistance,overallDistance-distanceToTarget);
+      result.SetCurrentMaxDistance(currentMaxDistance);
+
+      // Estimate costs for the rest of the distance to the target
+      double estimateCost=GetEstimateCosts(profile,dbId,distanceToTarget);
+      double overallCost=currentCost+estimateCost;
+
+      if (overallCost>costLimit) {
+        nodesIgnoredCount++;
+        continue;
+      }
+
+      if (parameter.GetProgress()) {
+        parameter.GetProgress()->Progress(currentMaxDistance,overallDistance);
+      }
+
+      if (openEntry!=nullptr) {
+        openEntry->prev=current->id;
+        openEntry->object=object;
+
+        openEntry->currentCost=currentCost;
+        openEntry->estimateCost=estimateCost;
+        openEntry->overallCost=overallCost;
+        openEntry->access=!graph->IsPathRestricted(path,vehicle);
+
+        openList.Update(*openEntry);
+      }
+      else {
+        // The route node itself is not needed, the graph holds all information
+        RNodeRef node=std::make_shared<RNode>(targetDBId,
+                                              nullptr,
+                                              object,
+                                              current->id);
+
+        node->currentCost=currentCost;
+        node->estimateCost=estimateCost;
+        node->overallCost=overallCost;
+        node->access=!graph->IsPathRestricted(path,vehicle);
+
+        openList.Push(node);
+        openMap[node->id]=node.get();
+      }
+    }
+
+    return true;
+  }
+
   /**
    * Opens the routing service. This loads the routing graph for the given vehicle
    *
@@ -324,6 +635,24 @@ namespace osmscout {
       return false;
     }
 
+    if (flatRouteGraph) {
+      StopClock clock;
+
+      if (!routingDatabase.LoadRouteGraph()) {
+        routingDatabase.Close();
+        return false;
+      }
+
+      clock.Stop();
+
+      if (debugPerformance) {
+        RouteGraphRef graph=routingDatabase.GetRouteGraph();
+
+        std::cout << "Route graph:         " << graph->GetNodeCount() << " nodes, " << graph->GetPathCount() << " paths, ";
+        std::cout << graph->GetMemoryUsage()/1024/1024 << " MiB, " << clock << std::endl;
+      }
+    }
+
     isOpen=true;
 
     return true;
@@ -346,10 +675,24 @@ namespace osmscout {
   void SimpleRoutingService::Close()
   {
     routingDatabase.Close();
+    ClearRouteGraphCosts();
 
     isOpen=false;
   }
 
+  /**
+   * Drop the path costs of the flat routing graph calculated so far, to free
+   * their memory. Queries running at the same time keep the costs they use.
+   *
+   * Method is thread-safe.
+   */
+  void SimpleRoutingService::ClearRouteGraphCosts()
+  {
+    std::lock_guard<std::mutex> lock(routeGraphCostsMutex);
+
+    routeGraphCosts.clear();
+  }
+
   /**
    * Returns the type configuration of the underlying database instance
    *
@@ -362,98 +705,1389 @@ namespace osmscout {
   }
 
   /**
-   * Calculate a route going through all the via points
+   * Turn restrictions are not part of the contraction hierarchy, so check
+   * the resulting route at all route nodes having turn restrictions.
+   */
+  bool SimpleRoutingService::IsRouteAllowed(const ContractionHierarchy& hierarchy,
+                                            DatabaseId database,
+                                            const ObjectFileRef& startObject,
+                                            const std::vector<ContractionHierarchy::Step>& steps)
+  {
+    for (size_t i=0; i+1<steps.size(); i++) {
+      if (!hierarchy.HasExcludes(hierarchy.GetNodeIndex(steps[i].id))) {
+        continue;
+      }
+
+      RouteNodeRef        routeNode;
+      const ObjectFileRef incoming=i==0 ? startObject : steps[i].object;
+
+      if (!GetRouteNode(DBId(database,steps[i].id),
+                        routeNode) ||
+          !routeNode) {
+        log.Error() << "Cannot load route node with id " << steps[i].id;
+        return false;
+      }
+
+      if (!routeNode->IsTurnAllowed(incoming,
+                                    steps[i+1].object)) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Calculate the route using the contraction hierarchy
    *
-   * @param profile
-   *    Profile to use
-   * @param via
-   *    A vector of via points
-   * @param radius
-   *    The maximum radius to search in from the search center
-   * @param parameter
-   *    A RoutingParamater object
    * @return
-   *    A RoutingResult object
+   *    false, if no route was found or the route found violates
+   *    turn restrictions. The caller should then use the routing graph.
    */
-
-  RoutingResult SimpleRoutingService::CalculateRouteViaCoords(RoutingProfile& profile,
-                                                              std::vector<osmscout::GeoCoord> via,
-                                                              const Distance &radius,
-                                                              const RoutingParameter& parameter)
+  bool SimpleRoutingService::CalculateRouteByContractionHierarchy(const ContractionHierarchy& hierarchy,
+                                                                  RoutingProfile& profile,
+                                                                  const RoutePosition& start,
+                                                                  const RoutePosition& target,
+                                                                  const RoutingParameter& parameter,
+                                                                  RoutingResult& result)
   {
-    RoutingResult                        result;
-    std::vector<size_t>                  nodeIndexes;
-    std::vector<osmscout::ObjectFileRef> objects;
+    StopClock    clock;
+    GeoCoord     startCoord;
+    GeoCoord     targetCoord;
+    RouteNodeRef startForwardRouteNode;
+    RouteNodeRef startBackwardRouteNode;
+    RNodeRef     startForwardNode;
+    RNodeRef     startBackwardNode;
+    RouteNodeRef targetForwardRouteNode;
+    RouteNodeRef targetBackwardRouteNode;
+
+    if (start.GetDatabaseId()!=target.GetDatabaseId()) {
+      return false;
+    }
 
-    assert(!via.empty());
+    if (!GetTargetNodes(profile,
+                        target,
+                        targetCoord,
+                        targetForwardRouteNode,
+                        targetBackwardRouteNode)) {
+      return false;
+    }
 
-    for (const auto& etap : via) {
-      Distance r=radius;
-      RoutePosition target=GetClosestRoutableNode(etap,
-                                                  profile,
-                                                  r);
+    if (!GetStartNodes(profile,
+                       start,
+                       startCoord,
+                       targetCoord,
+                       startForwardRouteNode,
+                       startBackwardRouteNode,
+                       startForwardNode,
+                       startBackwardNode)) {
+      return false;
+    }
 
-      if (!target.IsValid()) {
-        return result;
+    std::vector<ContractionHierarchy::Terminal> sources;
+    std::vector<ContractionHierarchy::Terminal> targets;
+
+    for (const RNodeRef& node : {startForwardNode,startBackwardNode}) {
+      if (!node) {
+        continue;
       }
 
-      nodeIndexes.push_back(target.GetNodeIndex());
-      objects.push_back(target.GetObjectFileRef());
+      // Paths with access restrictions are not part of the hierarchy
+      if (!node->access) {
+        return false;
+      }
+
+      sources.push_back(ContractionHierarchy::Terminal{node->id.id,node->currentCost});
     }
 
-    for (size_t index=0; index<nodeIndexes.size()-1; index++) {
-      size_t                     fromNodeIndex=nodeIndexes.at(index);
-      osmscout::ObjectFileRef    fromObject=objects.at(index);
-      size_t                     toNodeIndex=nodeIndexes.at(index+1);
-      osmscout::ObjectFileRef    toObject=objects.at(index+1);
-      RoutingResult              partialResult;
+    for (const RouteNodeRef& node : {targetForwardRouteNode,targetBackwardRouteNode}) {
+      if (node) {
+        targets.push_back(ContractionHierarchy::Terminal{node->GetId(),0.0});
+      }
+    }
 
-      partialResult=CalculateRoute(profile,
-                                   RoutePosition(fromObject,
-                                                 fromNodeIndex,/*database*/
-                                                 0),
-                                   RoutePosition(toObject,
-                                                 toNodeIndex,/*database*/
-                                                 0),
-                                   parameter);
-      if (!partialResult.Success()) {
-        result.GetRoute().Clear();
+    std::vector<ContractionHierarchy::Step> steps;
+    double                                  costs;
+    size_t                                  settledNodes;
 
-        return result;
-      }
+    if (!hierarchy.CalculateRoute(sources,
+                                  targets,
+                                  steps,
+                                  costs,
+                                  settledNodes)) {
+      return false;
+    }
 
-      /* In intermediary via points the end of the previous part is the start of the */
-      /* next part, we need to remove the duplicate point in the calculated route */
-      if (index<nodeIndexes.size()-2) {
-        partialResult.GetRoute().PopEntry();
+    // The start route node the route starts with
+    RNodeRef startNode;
+
+    for (const RNodeRef& node : {startForwardNode,startBackwardNode}) {
+      if (node &&
+          node->id.id==steps.front().id &&
+          (!startNode || node->currentCost<startNode->currentCost)) {
+        startNode=node;
       }
+    }
 
-      result.GetRoute().Append(partialResult.GetRoute());
+    assert(startNode);
+
+    if (!IsRouteAllowed(hierarchy,
+                        start.GetDatabaseId(),
+                        startNode->object,
+                        steps)) {
+      return false;
     }
 
-    return result;
-  }
+    if (parameter.GetBreaker() &&
+        parameter.GetBreaker()->IsAborted()) {
+      return false;
+    }
 
-  void SimpleRoutingService::DumpStatistics()
-  {
-    if (database) {
-      database->DumpStatistics();
+    std::list<VNode> nodes;
+    DBId             previous;
+
+    for (const auto& step : steps) {
+      DBId current(start.GetDatabaseId(),step.id);
+
+      nodes.emplace_back(current,
+                         previous.IsValid() ? step.object : startNode->object,
+                         previous);
+
+      previous=current;
+    }
+
+    result.SetOverallDistance(GetSphericalDistance(startCoord,
+                                                   targetCoord));
+
+    if (!ResolveRNodesToRouteData(profile,
+                                  nodes,
+                                  start,
+                                  target,
+                                  result.GetRoute())) {
+      return false;
+    }
+
+    ResolveRouteDataJunctions(result.GetRoute());
+
+    clock.Stop();
+
+    if (debugPerformance) {
+      std::cout << "Contraction hierarchy:" << std::endl;
+      std::cout << "Time:                " << clock << std::endl;
+      std::cout << "Actual cost:         " << costs << std::endl;
+      std::cout << "Route nodes settled: " << settledNodes << std::endl;
+      std::cout << "Route nodes:         " << steps.size() << std::endl;
     }
+
+    return true;
   }
 
   /**
-   * Returns the closest routeable object (area or way) relative
-   * to the given coordinate.
-   *
-   * The result should be use as imput for the router to define
-   * routing start or end point.
+   * Calculate a route from start to target.
    *
-   * @note The returned node may in fact not be routable, it is just
-   * the closest node to the given position on a routable way or area.
+   * If the database contains a contraction hierarchy for the vehicle that
+   * was build with the costs of the given profile, it is used. Else (or if the
+   * hierarchy does not deliver a valid route) the routing graph is searched.
    *
-   * @note The actual object may not be within the given radius
+   * @param profile
+   *    Profile to use
+   * @param start
+   *    Start of the route
+   * @param target
+   *    Target of the route
+   * @param parameter
+   *    A RoutingParamater object
+   * @return
+   *    A RoutingResult object
+   */
+  RoutingResult SimpleRoutingService::CalculateRoute(RoutingProfile& profile,
+                                                     const RoutePosition& start,
+                                                     const RoutePosition& target,
+                                                     const RoutingParameter& parameter)
+  {
+    ContractionHierarchyRef hierarchy=routingDatabase.GetContractionHierarchy(profile.GetVehicle());
+
+    if (hierarchy &&
+        hierarchy->IsCompatible(profile)) {
+      RoutingResult result;
+
+      if (CalculateRouteByContractionHierarchy(*hierarchy,
+                                               profile,
+                                               start,
+                                               target,
+                                               parameter,
+                                               result)) {
+        return result;
+      }
+
+      if (parameter.GetBreaker() &&
+          parameter.GetBreaker()->IsAborted()) {
+        return RoutingResult();
+      }
+    }
+
+    return AbstractRoutingService<RoutingProfile>::CalculateRoute(profile,
+                                                                  start,
+                                                                  target,
+                                                                  parameter);
+  }
+
+  /**
+   * One-to-many Dijkstra search over the route graph. Starting at the given start
+   * nodes, the reached route nodes are passed to the visitor in the order of
+   * increasing costs, each route node at most once.
+   *
+   * Access and turn restrictions are handled like in the A* search. Since a route
+   * node may be reached via an accessible and via a restricted way, labels are
+   * kept per route node and access state.
+   *
+   * Route nodes exceeding the given limits are not reached. The search stops if
+   * all reachable route nodes were visited or if the visitor returns false.
+   *
+   * @return
+   *    false, if a route node could not be loaded or the search was aborted, else true
+   */
+  bool SimpleRoutingService::SearchReachableNodes(const RoutingProfile& profile,
+                                                  const std::vector<ReachedNode>& startNodes,
+                                                  const SearchLimit& limit,
+                                                  const RouteNodeLoader& loader,
+                                                  const BreakerRef& breaker,
+                                                  const ReachedNodeVisitor& visitor)
+  {
+    struct Label
+    {
+      ReachedNode reached;
+      Id          prev;
+      bool        access;
+      bool        settled;
+    };
+
+    typedef std::pair<double,size_t> QueueEntry;
+
+    const std::vector<ObjectVariantData>& objectVariantData=routingDatabase.GetObjectVariantData();
+    Vehicle                               vehicle=profile.GetVehicle();
+    std::vector<Label>                    labels;
+    std::unordered_map<Id,size_t>         labelIndex[2]; // Index 0 for restricted, 1 for accessible
+    std::unordered_set<Id>                visited;
+    std::priority_queue<QueueEntry,std::vector<QueueEntry>,std::greater<QueueEntry>> queue;
+
+    auto update=[&labels,&labelIndex,&queue](const ReachedNode& reached,
+                                            Id prev,
+                                            bool access) {
+      auto entry=labelIndex[access ? 1 : 0].find(reached.id);
+
+      if (entry==labelIndex[access ? 1 : 0].end()) {
+        labelIndex[access ? 1 : 0][reached.id]=labels.size();
+        queue.push(std::make_pair(reached.costs,labels.size()));
+        labels.push_back(Label{reached,prev,access,false});
+
+        return;
+      }
+
+      Label& label=labels[entry->second];
+
+      if (label.settled ||
+          label.reached.costs<=reached.costs) {
+        return;
+      }
+
+      label.reached=reached;
+      label.prev=prev;
+
+      queue.push(std::make_pair(reached.costs,entry->second));
+    };
+
+    auto withinLimit=[&limit](double costs,
+                              double time,
+                              const Distance& distance) {
+      return costs<=limit.costs &&
+             time<=limit.time &&
+             distance<=limit.distance;
+    };
+
+    for (const auto& startNode : startNodes) {
+      if (withinLimit(startNode.costs,
+                      startNode.time,
+                      startNode.distance)) {
+        update(startNode,0,true);
+      }
+    }
+
+    while (!queue.empty()) {
+      if (breaker &&
+          breaker->IsAborted()) {
+        return false;
+      }
+
+      QueueEntry entry=queue.top();
+
+      queue.pop();
+
+      if (labels[entry.second].settled ||
+          entry.first>labels[entry.second].reached.costs) {
+        continue;
+      }
+
+      labels[entry.second].settled=true;
+
+      // labels may grow while walking the paths, so we work on a copy
+      Label current=labels[entry.second];
+
+      if (visited.insert(current.reached.id).second &&
+          !visitor(current.reached)) {
+        return true;
+      }
+
+      const RouteNode& routeNode=*current.reached.node;
+
+      for (size_t i=0; i<routeNode.paths.size(); i++) {
+        const RouteNode::Path& path=routeNode.paths[i];
+        bool                   access=!path.IsRestricted(vehicle);
+
+        if (path.id==current.prev) {
+          continue;
+        }
+
+        if (!current.access &&
+            access) {
+          continue;
+        }
+
+        auto settledEntry=labelIndex[access ? 1 : 0].find(path.id);
+
+        if (settledEntry!=labelIndex[access ? 1 : 0].end() &&
+            labels[settledEntry->second].settled) {
+          continue;
+        }
+
+        if (!profile.CanUse(routeNode,objectVariantData,i)) {
+          continue;
+        }
+
+        if (!routeNode.IsTurnAllowed(current.reached.object,
+                                     routeNode.objects[path.objectIndex].object)) {
+          continue;
+        }
+
+        double   costs=current.reached.costs+profile.GetCosts(routeNode,objectVariantData,i);
+        double   time=current.reached.time+profile.GetTime(routeNode,objectVariantData,i);
+        Distance distance=current.reached.distance+path.distance;
+
+        if (!withinLimit(costs,
+                         time,
+                         distance)) {
+          continue;
+        }
+
+        RouteNodeRef nextNode;
+
+        if (!loader(path.id,nextNode) ||
+            !nextNode) {
+          log.Error() << "Cannot load route node with id " << path.id;
+          return false;
+        }
+
+        update(ReachedNode{path.id,
+                           nextNode,
+                           routeNode.objects[path.objectIndex].object,
+                           costs,
+                           time,
+                           distance},
+               current.reached.id,
+               access);
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Resolve the start position of a SearchReachableNodes() call to the route nodes in
+   * forward and backward direction, including the costs to reach them.
+   */
+  bool SimpleRoutingService::GetSearchStartNodes(const RoutingProfile& profile,
+                                                 const RoutePosition& position,
+                                                 GeoCoord& coord,
+                                                 std::vector<ReachedNode>& nodes)
+  {
+    RouteNodeRef forwardRouteNode;
+    RouteNodeRef backwardRouteNode;
+    RNodeRef     forwardRNode;
+    RNodeRef     backwardRNode;
+    WayRef       way;
+
+    if (!GetStartNodes(profile,
+                       position,
+                       coord,
+                       coord,
+                       forwardRouteNode,
+                       backwardRouteNode,
+                       forwardRNode,
+                       backwardRNode)) {
+      return false;
+    }
+
+    if (!GetWayByOffset(DBFileOffset(position.GetDatabaseId(),
+                                     position.GetObjectFileRef().GetFileOffset()),
+                        way)) {
+      log.Error() << "Cannot get start way!";
+      return false;
+    }
+
+    for (const auto& rNode : {forwardRNode,backwardRNode}) {
+      if (!rNode) {
+        continue;
+      }
+
+      Distance distance=GetSphericalDistance(coord,
+                                             rNode->node->GetCoord());
+
+      nodes.push_back(ReachedNode{rNode->id.id,
+                                  rNode->node,
+                                  rNode->object,
+                                  rNode->currentCost,
+                                  profile.GetTime(*way,distance),
+                                  distance});
+    }
+
+    return true;
+  }
+
+  /**
+   * Resolve the target position of a matrix calculation to the route nodes
+   * in forward and backward direction and register the target, including the costs
+   * from the route node to the target position, in the target map.
+   */
+  bool SimpleRoutingService::GetMatrixTargetNodes(const RoutingProfile& profile,
+                                                  const RoutePosition& position,
+                                                  size_t index,
+                                                  GeoCoord& coord,
+                                                  MatrixTargetMap& targetMap)
+  {
+    RouteNodeRef forwardRouteNode;
+    RouteNodeRef backwardRouteNode;
+    WayRef       way;
+
+    if (!GetTargetNodes(profile,
+                        position,
+                        coord,
+                        forwardRouteNode,
+                        backwardRouteNode)) {
+      return false;
+    }
+
+    if (!GetWayByOffset(DBFileOffset(position.GetDatabaseId(),
+                                     position.GetObjectFileRef().GetFileOffset()),
+                        way)) {
+      log.Error() << "Cannot get target way!";
+      return false;
+    }
+
+    for (const auto& routeNode : {forwardRouteNode,backwardRouteNode}) {
+      if (!routeNode) {
+        continue;
+      }
+
+      Distance distance=GetSphericalDistance(routeNode->GetCoord(),
+                                             coord);
+
+      targetMap[routeNode->GetId()].push_back(MatrixTarget{index,
+                                                           profile.GetCosts(*way,distance),
+                                                           profile.GetTime(*way,distance),
+                                                           distance});
+    }
+
+    return true;
+  }
+
+  /**
+   * Calculate one row of the matrix by a one-to-many search from the given source,
+   * stopping as soon as all target route nodes were reached.
+   */
+  bool SimpleRoutingService::CalculateMatrixRow(const RoutingProfile& profile,
+                                                size_t source,
+                                                const std::vector<ReachedNode>& startNodes,
+                                                double costLimit,
+                                                const MatrixTargetMap& targetMap,
+                                                const RouteNodeLoader& loader,
+                                                const BreakerRef& breaker,
+                                                RoutingMatrix& matrix)
+  {
+    size_t      remaining=targetMap.size();
+    SearchLimit limit{costLimit,
+                      std::numeric_limits<double>::max(),
+                      Distance::Of<Kilometer>(std::numeric_limits<double>::max())};
+
+    return SearchReachableNodes(profile,
+                                startNodes,
+                                limit,
+                                loader,
+                                breaker,
+                                [source,&targetMap,&matrix,&remaining](const ReachedNode& reached) {
+                                  auto entry=targetMap.find(reached.id);
+
+                                  if (entry==targetMap.end()) {
+                                    return true;
+                                  }
+
+                                  for (const auto& target : entry->second) {
+                                    double costs=reached.costs+target.costs;
+
+                                    if (costs<matrix.GetCosts(source,target.index)) {
+                                      matrix.Set(source,
+                                                 target.index,
+                                                 costs,
+                                                 reached.time+target.time,
+                                                 reached.distance+target.distance);
+                                    }
+                                  }
+
+                                  remaining--;
+
+                                  return remaining>0;
+                                });
+  }
+
+  void SimpleRoutingService::MatrixThreadLoop()
+  {
+    std::packaged_task<bool()> task;
+
+    while (matrixQueue.PopTask(task)) {
+      task();
+    }
+  }
+
+  /**
+   * Calculate the costs, times and distances from each of the given sources to each
+   * of the given targets.
+   *
+   * Sources and targets are resolved to route nodes only once. For each source a
+   * one-to-many search is done, that stops as soon as all targets are reached or the
+   * cost limit for the most distant target is exceeded. Sources are calculated in
+   * parallel by up to RoutingParameter::GetThreadCount() threads of the service, sharing
+   * the loaded route nodes.
+   *
+   * @param profile
+   *    Profile to use
+   * @param sources
+   *    Start positions
+   * @param targets
+   *    Target positions
+   * @param parameter
+   *    A RoutingParamater object
+   * @return
+   *    A RoutingMatrix object. Targets that cannot be reached from a source, for example
+   *    because source or target could not be resolved to a route node, are marked as
+   *    unreachable. In case of errors or if the calculation was aborted, an empty
+   *    matrix is returned.
+   */
+  RoutingMatrix SimpleRoutingService::CalculateMatrix(RoutingProfile& profile,
+                                                      const std::vector<RoutePosition>& sources,
+                                                      const std::vector<RoutePosition>& targets,
+                                                      const RoutingParameter& parameter)
+  {
+    RouteNodeCache cache;
+
+    return CalculateMatrix(profile,
+                           sources,
+                           targets,
+                           parameter,
+                           cache);
+  }
+
+  /**
+   * Calculate the costs, times and distances from each of the given sources to each
+   * of the given targets, like CalculateMatrix() above, but take route nodes from
+   * and add loaded route nodes to the given cache.
+   *
+   * @param profile
+   *    Profile to use
+   * @param sources
+   *    Start positions
+   * @param targets
+   *    Target positions
+   * @param parameter
+   *    A RoutingParamater object
+   * @param cache
+   *    Route nodes already loaded by previous calculations
+   * @return
+   *    A RoutingMatrix object, see above
+   */
+  RoutingMatrix SimpleRoutingService::CalculateMatrix(RoutingProfile& profile,
+                                                      const std::vector<RoutePosition>& sources,
+                                                      const std::vector<RoutePosition>& targets,
+                                                      const RoutingParameter& parameter,
+                                                      RouteNodeCache& cache)
+  {
+    RoutingMatrix                         matrix(sources.size(),
+                                                 targets.size());
+    MatrixTargetMap                       targetMap;
+    std::vector<GeoCoord>                 targetCoords;
+    std::vector<std::vector<ReachedNode>> startNodes(sources.size());
+    std::vector<double>                   costLimits(sources.size());
+    bool                                  success=true;
+
+    for (size_t t=0; t<targets.size(); t++) {
+      GeoCoord coord;
+
+      if (GetMatrixTargetNodes(profile,
+                               targets[t],
+                               t,
+                               coord,
+                               targetMap)) {
+        targetCoords.push_back(coord);
+      }
+      else {
+        log.Warn() << "Cannot resolve target " << t << ", it is not reachable";
+      }
+    }
+
+    for (size_t s=0; s<sources.size(); s++) {
+      GeoCoord coord;
+      Distance maxDistance;
+
+      if (!GetSearchStartNodes(profile,
+                               sources[s],
+                               coord,
+                               startNodes[s])) {
+        log.Warn() << "Cannot resolve source " << s << ", no target is reachable";
+        startNodes[s].clear();
+        continue;
+      }
+
+      for (const auto& targetCoord : targetCoords) {
+        maxDistance=Distance::Max(maxDistance,
+                                  GetSphericalDistance(coord,
+                                                       targetCoord));
+      }
+
+      costLimits[s]=GetCostLimit(profile,
+                                 sources[s].GetDatabaseId(),
+                                 maxDistance);
+    }
+
+    if (targetMap.empty()) {
+      return matrix;
+    }
+
+    // Already loaded route nodes are shared by all sources
+    RouteNodeLoader loader=[this,&cache](Id id,
+                                         RouteNodeRef& node) {
+      if (cache.Get(id,node)) {
+        return true;
+      }
+
+      if (!routingDatabase.GetRouteNode(id,node)) {
+        return false;
+      }
+
+      cache.Set(id,node);
+
+      return true;
+    };
+
+    size_t threadCount=std::min(parameter.GetThreadCount(),
+                                sources.size());
+
+    if (threadCount<=1) {
+      for (size_t s=0; s<sources.size() && success; s++) {
+        if (!startNodes[s].empty()) {
+          success=CalculateMatrixRow(profile,
+                                     s,
+                                     startNodes[s],
+                                     costLimits[s],
+                                     targetMap,
+                                     loader,
+                                     parameter.GetBreaker(),
+                                     matrix);
+        }
+      }
+    }
+    else {
+      std::vector<std::future<bool>> results;
+      std::atomic<size_t>            nextSource(0);
+
+      {
+        std::lock_guard<std::mutex> lock(matrixThreadsMutex);
+
+        // The threads are kept for later calls
+        while (matrixThreads.size()<threadCount) {
+          matrixThreads.emplace_back(&SimpleRoutingService::MatrixThreadLoop,this);
+        }
+      }
+
+      // Each task calculates the next not yet calculated row, so that at most
+      // threadCount rows are calculated concurrently
+      for (size_t i=0; i<threadCount; i++) {
+        std::packaged_task<bool()> task([this,&profile,&nextSource,&startNodes,&costLimits,&targetMap,&loader,&parameter,&matrix] {
+          for (size_t s=nextSource++; s<startNodes.size(); s=nextSource++) {
+            if (!startNodes[s].empty() &&
+                !CalculateMatrixRow(profile,
+                                    s,
+                                    startNodes[s],
+                                    costLimits[s],
+                                    targetMap,
+                                    loader,
+                                    parameter.GetBreaker(),
+                                    matrix)) {
+              return false;
+            }
+          }
+
+          return true;
+        });
+
+        results.push_back(task.get_future());
+        matrixQueue.PushTask(task);
+      }
+
+      for (auto& result : results) {
+        success=result.get() && success;
+      }
+    }
+
+    if (!success) {
+      return RoutingMatrix();
+    }
+
+    return matrix;
+  }
+
+  /**
+   * Calculate the outline of the reachable area by rasterizing the given route
+   * nodes into cells of the given size. Gaps between cells are closed, holes are
+   * filled and the outline of the area around the first route node is returned
+   * as a counter clockwise polygon. Returns false, if no closed outline could be
+   * traced.
+   */
+  static bool GetIsochronePolygon(const std::vector<ReachableNode>& nodes,
+                                  const Distance& cellSize,
+                                  std::vector<GeoCoord>& polygon)
+  {
+    // Empty border to have space for closing the gaps and for the flood fill
+    const int border=2;
+
+    GeoBox boundingBox;
+
+    for (const auto& node : nodes) {
+      boundingBox.Include(GeoBox(node.coord,node.coord));
+    }
+
+    double cellLat=cellSize.As<Kilometer>()/111.195;
+    double cellLon=cellLat/std::cos(DegToRad(boundingBox.GetCenter().GetLat()));
+    double minLat=boundingBox.GetMinLat()-border*cellLat;
+    double minLon=boundingBox.GetMinLon()-border*cellLon;
+    int    width=(int)std::floor(boundingBox.GetWidth()/cellLon)+2*border+1;
+    int    height=(int)std::floor(boundingBox.GetHeight()/cellLat)+2*border+1;
+
+    auto index=[width](int x, int y) {
+      return (size_t)y*width+x;
+    };
+
+    std::vector<bool> marked((size_t)width*height,false);
+
+    for (const auto& node : nodes) {
+      marked[index((int)((node.coord.GetLon()-minLon)/cellLon),
+                    (int)((node.coord.GetLat()-minLat)/cellLat))]=true;
+    }
+
+    // Close gaps by dilating and eroding the marked cells
+    std::vector<bool> dilated((size_t)width*height,false);
+    std::vector<bool> closed((size_t)width*height,false);
+
+    for (int y=1; y<height-1; y++) {
+      for (int x=1; x<width-1; x++) {
+        for (int dy=-1; dy<=1 && !dilated[index(x,y)]; dy++) {
+          for (int dx=-1; dx<=1; dx++) {
+            if (marked[index(x+dx,y+dy)]) {
+              dilated[index(x,y)]=true;
+              break;
+            }
+          }
+        }
+      }
+    }
+
+    for (int y=1; y<height-1; y++) {
+      for (int x=1; x<width-1; x++) {
+        bool all=true;
+
+        for (int dy=-1; dy<=1 && all; dy++) {
+          for (int dx=-1; dx<=1; dx++) {
+            if (!dilated[index(x+dx,y+dy)]) {
+              all=false;
+              break;
+            }
+          }
+        }
+
+        closed[index(x,y)]=all;
+      }
+    }
+
+    // Flood fill the area around the first route node and everything outside of it
+    auto floodFill=[width,height,&index](std::vector<bool>& area,
+                                        int x,
+                                        int y,
+                                        const std::function<bool(size_t)>& include) {
+      std::vector<std::pair<int,int>> stack;
+
+      area[index(x,y)]=true;
+      stack.push_back(std::make_pair(x,y));
+
+      while (!stack.empty()) {
+        std::pair<int,int> cell=stack.back();
+
+        stack.pop_back();
+
+        const int neighbours[4][2]={{1,0},{-1,0},{0,1},{0,-1}};
+
+        for (const auto& neighbour : neighbours) {
+          int nx=cell.first+neighbour[0];
+          int ny=cell.second+neighbour[1];
+
+          if (nx>=0 && nx<width &&
+              ny>=0 && ny<height &&
+              !area[index(nx,ny)] &&
+              include(index(nx,ny))) {
+            area[index(nx,ny)]=true;
+            stack.push_back(std::make_pair(nx,ny));
+          }
+        }
+      }
+    };
+
+    std::vector<bool> region((size_t)width*height,false);
+    std::vector<bool> outside((size_t)width*height,false);
+
+    floodFill(region,
+              (int)((nodes.front().coord.GetLon()-minLon)/cellLon),
+              (int)((nodes.front().coord.GetLat()-minLat)/cellLat),
+              [&closed](size_t cell) {
+                return closed[cell];
+              });
+
+    floodFill(outside,
+              0,
+              0,
+              [&region](size_t cell) {
+                return !region[cell];
+              });
+
+    // Collect the boundary edges between the region and the outside, oriented so
+    // that the region is on the left side. Where two cells of the region only touch
+    // diagonally, the shared corner has two outgoing edges.
+    std::unordered_multimap<size_t,size_t> edges;
+    size_t                                 cornerWidth=(size_t)width+1;
+
+    auto corner=[cornerWidth](int x, int y) {
+      return (size_t)y*cornerWidth+x;
+    };
+
+    for (int y=0; y<height; y++) {
+      for (int x=0; x<width; x++) {
+        if (outside[index(x,y)]) {
+          continue;
+        }
+
+        if (outside[index(x,y-1)]) {
+          edges.emplace(corner(x,y),corner(x+1,y));
+        }
+        if (outside[index(x+1,y)]) {
+          edges.emplace(corner(x+1,y),corner(x+1,y+1));
+        }
+        if (outside[index(x,y+1)]) {
+          edges.emplace(corner(x+1,y+1),corner(x,y+1));
+        }
+        if (outside[index(x-1,y)]) {
+          edges.emplace(corner(x,y+1),corner(x,y));
+        }
+      }
+    }
+
+    if (edges.empty()) {
+      log.Error() << "Isochrone area has no outline";
+      return false;
+    }
+
+    auto getDirection=[cornerWidth](size_t from, size_t to) {
+      return std::make_pair((long)(to%cornerWidth)-(long)(from%cornerWidth),
+                            (long)(to/cornerWidth)-(long)(from/cornerWidth));
+    };
+
+    // Each edge is used exactly once, so the walk ends after at most edges.size() steps,
+    // either back at the start or at a corner without an unused outgoing edge
+    std::vector<size_t>  ring;
+    size_t               start=edges.begin()->first;
+    size_t               current=start;
+    std::pair<long,long> direction(0,0);
+
+    do {
+      auto range=edges.equal_range(current);
+
+      if (range.first==range.second) {
+        log.Error() << "Isochrone outline is not closed";
+        return false;
+      }
+
+      auto edge=range.first;
+
+      // At a diagonal corner take the left turn, so that the outline first follows
+      // the cell it came from
+      for (auto candidate=std::next(range.first); candidate!=range.second; ++candidate) {
+        std::pair<long,long> edgeDirection=getDirection(current,edge->second);
+        std::pair<long,long> candidateDirection=getDirection(current,candidate->second);
+
+        if (direction.first*candidateDirection.second-direction.second*candidateDirection.first>
+            direction.first*edgeDirection.second-direction.second*edgeDirection.first) {
+          edge=candidate;
+        }
+      }
+
+      size_t following=edge->second;
+
+      edges.erase(edge);
+      ring.push_back(current);
+      direction=getDirection(current,following);
+      current=following;
+    } while (current!=start);
+
+    // Skip corners on a straight line
+    for (size_t i=0; i<ring.size(); i++) {
+      size_t previous=ring[(i+ring.size()-1)%ring.size()];
+      size_t after=ring[(i+1)%ring.size()];
+
+      if (getDirection(previous,ring[i])!=getDirection(ring[i],after)) {
+        polygon.emplace_back(minLat+(ring[i]/cornerWidth)*cellLat,
+                             minLon+(ring[i]%cornerWidth)*cellLon);
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Calculate all route nodes reachable from the given start position within the
+   * time and distance budget of the given isochrone parameter. Route nodes are reached
+   * via their cheapest route according to the profile. If the profile does not
+   * optimize for time, a route node may thus be missing, although another, more
+   * expensive route within the budget exists.
+   *
+   * If a RoutingProgress is given and IsochroneParameter::GetFrontierSize() is set,
+   * the reached route nodes are additionally passed to RoutingProgress::Reached()
+   * while the calculation is running.
+   *
+   * @param profile
+   *    Profile to use
+   * @param start
+   *    Start of the isochrone
+   * @param isochroneParameter
+   *    Budget and polygon settings
+   * @param parameter
+   *    A RoutingParamater object
+   * @return
+   *    An IsochroneResult object. In case of errors or if the calculation was aborted,
+   *    the result is empty.
+   */
+  IsochroneResult SimpleRoutingService::CalculateIsochrone(RoutingProfile& profile,
+                                                           const RoutePosition& start,
+                                                           const IsochroneParameter& isochroneParameter,
+                                                           const RoutingParameter& parameter)
+  {
+    IsochroneResult          result;
+    GeoCoord                 startCoord;
+    std::vector<ReachedNode> startNodes;
+    SearchLimit              limit{std::numeric_limits<double>::max(),
+                                   std::numeric_limits<double>::max(),
+                                   Distance::Of<Kilometer>(std::numeric_limits<double>::max())};
+    RoutingProgressRef       progress=parameter.GetProgress();
+    size_t                   frontierSize=progress ? isochroneParameter.GetFrontierSize() : 0;
+    size_t                   frontierStart=0;
+
+    // Without any budget the whole routing graph would be searched
+    if (isochroneParameter.GetMaxTime()<=0.0 &&
+        isochroneParameter.GetMaxDistance().AsMeter()<=0.0) {
+      log.Error() << "Isochrone requires a time or distance budget";
+      return result;
+    }
+
+    if (!GetSearchStartNodes(profile,
+                             start,
+                             startCoord,
+                             startNodes)) {
+      return result;
+    }
+
+    if (isochroneParameter.GetMaxTime()>0.0) {
+      limit.time=isochroneParameter.GetMaxTime();
+    }
+
+    if (isochroneParameter.GetMaxDistance().AsMeter()>0.0) {
+      limit.distance=isochroneParameter.GetMaxDistance();
+      limit.costs=GetCostLimit(profile,
+                               start.GetDatabaseId(),
+                               isochroneParameter.GetMaxDistance());
+    }
+
+    std::vector<ReachableNode>& nodes=result.GetNodes();
+
+    auto reportFrontier=[&progress,&nodes,&frontierStart]() {
+      progress->Reached(std::vector<ReachableNode>(nodes.begin()+frontierStart,
+                                                   nodes.end()));
+      frontierStart=nodes.size();
+    };
+
+    if (!SearchReachableNodes(profile,
+                              startNodes,
+                              limit,
+                              [this](Id id,
+                                     RouteNodeRef& node) {
+                                return routingDatabase.GetRouteNode(id,node);
+                              },
+                              parameter.GetBreaker(),
+                              [&nodes,frontierSize,&frontierStart,&reportFrontier](const ReachedNode& reached) {
+                                nodes.push_back(ReachableNode{reached.id,
+                                                              reached.node->GetCoord(),
+                                                              reached.costs,
+                                                              reached.time,
+                                                              reached.distance});
+
+                                if (frontierSize>0 &&
+                                    nodes.size()-frontierStart>=frontierSize) {
+                                  reportFrontier();
+                                }
+
+                                return true;
+                              })) {
+      return IsochroneResult();
+    }
+
+    if (frontierSize>0 &&
+        frontierStart<nodes.size()) {
+      reportFrontier();
+    }
+
+    if (!nodes.empty() &&
+        isochroneParameter.GetPolygonCellSize().AsMeter()>0.0) {
+      if (!GetIsochronePolygon(nodes,
+                               isochroneParameter.GetPolygonCellSize(),
+                               result.GetPolygon())) {
+        return IsochroneResult();
+      }
+    }
+
+    return result;
+  }
+
+  /**
+   * Calculate a route going through all the via points
+   *
+   * @param profile
+   *    Profile to use
+   * @param via
+   *    A vector of via points
+   * @param radius
+   *    The maximum radius to search in from the search center
+   * @param parameter
+   *    A RoutingParamater object
+   * @return
+   *    A RoutingResult object
+   */
+
+  RoutingResult SimpleRoutingService::CalculateRouteViaCoords(RoutingProfile& profile,
+                                                              std::vector<osmscout::GeoCoord> via,
+                                                              const Distance &radius,
+                                                              const RoutingParameter& parameter)
+  {
+    RoutingResult                        result;
+    std::vector<size_t>                  nodeIndexes;
+    std::vector<osmscout::ObjectFileRef> objects;
+
+    assert(!via.empty());
+
+    for (const auto& etap : via) {
+      Distance r=radius;
+      RoutePosition target=GetClosestRoutableNode(etap,
+                                                  profile,
+                                                  r);
+
+      if (!target.IsValid()) {
+        return result;
+      }
+
+      nodeIndexes.push_back(target.GetNodeIndex());
+      objects.push_back(target.GetObjectFileRef());
+    }
+
+    for (size_t index=0; index<nodeIndexes.size()-1; index++) {
+      size_t                     fromNodeIndex=nodeIndexes.at(index);
+      osmscout::ObjectFileRef    fromObject=objects.at(index);
+      size_t                     toNodeIndex=nodeIndexes.at(index+1);
+      osmscout::ObjectFileRef    toObject=objects.at(index+1);
+      RoutingResult              partialResult;
+
+      partialResult=CalculateRoute(profile,
+                                   RoutePosition(fromObject,
+                                                 fromNodeIndex,/*database*/
+                                                 0),
+                                   RoutePosition(toObject,
+                                                 toNodeIndex,/*database*/
+                                                 0),
+                                   parameter);
+      if (!partialResult.Success()) {
+        result.GetRoute().Clear();
+
+        return result;
+      }
+
+      /* In intermediary via points the end of the previous part is the start of the */
+      /* next part, we need to remove the duplicate point in the calculated route */
+      if (index<nodeIndexes.size()-2) {
+        partialResult.GetRoute().PopEntry();
+      }
+
+      result.GetRoute().Append(partialResult.GetRoute());
+    }
+
+    return result;
+  }
+
+  void SimpleRoutingService::DumpStatistics()
+  {
+    if (database) {
+      database->DumpStatistics();
+    }
+  }
+
+  /**
+   * Fallback for GetClosestRouteSegments() for databases without segment index:
+   * Visit all ways in the radius usable by the profile and evaluate all their segments.
+   */
+  bool SimpleRoutingService::GetClosestRouteSegmentsFromWays(const GeoCoord& coord,
+                                                             const RoutingProfile& profile,
+                                                             const Distance& radius,
+                                                             std::vector<RouteSegmentMatch>& matches) const
+  {
+    TypeConfigRef   typeConfig=database->GetTypeConfig();
+    AreaWayIndexRef areaWayIndex=database->GetAreaWayIndex();
+    WayDataFileRef  wayDataFile=database->GetWayDataFile();
+
+    if (!typeConfig ||
+        !areaWayIndex ||
+        !wayDataFile) {
+      log.Error() << "At least one index file is invalid!";
+      return false;
+    }
+
+    GeoBox                  boundingBox=GeoBox::BoxByCenterAndRadius(coord,radius);
+    TypeInfoSet             wayRoutableTypes;
+    TypeInfoSet             wayLoadedTypes;
+    std::vector<FileOffset> wayOffsets;
+
+    for (const auto& type : typeConfig->GetTypes()) {
+      if (!type->GetIgnore() &&
+          type->CanBeWay() &&
+          type->CanRoute(profile.GetVehicle())) {
+        wayRoutableTypes.Set(type);
+      }
+    }
+
+    if (!areaWayIndex->GetOffsets(boundingBox,
+                                  wayRoutableTypes,
+                                  wayOffsets,
+                                  wayLoadedTypes)) {
+      log.Error() << "Error getting ways from area way index!";
+      return false;
+    }
+
+    std::sort(wayOffsets.begin(),
+              wayOffsets.end());
+
+    // The ways are only needed for evaluating their segments, so they are visited
+    // in their encoded form instead of being loaded
+    std::vector<std::pair<uint32_t,Id>> routeNodes;
+    auto                                visitor=[&](const WayView& way) {
+      const PointsView& nodes=way.GetNodes();
+
+      if (nodes.size()<2) {
+        return;
+      }
+
+      AccessFeatureValue* accessValue=accessReader.GetValue(way.GetFeatureValueBuffer());
+      uint8_t             access=accessValue!=nullptr ? accessValue->GetAccess() : way.GetType()->GetDefaultAccess();
+
+      if (!profile.CanUse(*way.GetType(),
+                          AccessFeatureValue(access))) {
+        return;
+      }
+
+      routeNodes.clear();
+
+      uint32_t index=0;
+
+      for (const auto& node : nodes) {
+        if (node.IsRelevant() &&
+            routingDatabase.ContainsNode(node.GetId())) {
+          routeNodes.push_back(std::make_pair(index,node.GetId()));
+        }
+
+        index++;
+      }
+
+      if (routeNodes.empty()) {
+        return;
+      }
+
+      RouteSegment segment;
+      size_t       nextRouteNode=0;
+      auto         node=nodes.begin();
+
+      segment.way=way.GetFileOffset();
+      segment.typeIndex=(uint16_t)way.GetType()->GetIndex();
+      segment.access=access;
+
+      for (uint32_t i=0; i<nodes.size()-1; i++) {
+        while (nextRouteNode<routeNodes.size() &&
+               routeNodes[nextRouteNode].first<i+1) {
+          nextRouteNode++;
+        }
+
+        segment.from=node->GetCoord();
+        ++node;
+        segment.to=node->GetCoord();
+        segment.nodeIndex=i;
+
+        if (nextRouteNode>0) {
+          segment.prevRouteNodeIndex=routeNodes[nextRouteNode-1].first;
+          segment.prevRouteNode=routeNodes[nextRouteNode-1].second;
+        }
+        else {
+          segment.prevRouteNodeIndex=0;
+          segment.prevRouteNode=0;
+        }
+
+        if (nextRouteNode<routeNodes.size()) {
+          segment.nextRouteNodeIndex=routeNodes[nextRouteNode].first;
+          segment.nextRouteNode=routeNodes[nextRouteNode].second;
+        }
+        else {
+          segment.nextRouteNodeIndex=0;
+          segment.nextRouteNode=0;
+        }
+
+        RouteSegmentMatch match;
+
+        RouteSegmentIndex::Project(coord,
+                                   segment,
+                                   match);
+
+        if (match.distance<=radius) {
+          matches.push_back(match);
+        }
+      }
+    };
+
+    if (!wayDataFile->VisitByOffset<WayView>(wayOffsets.begin(),
+                                             wayOffsets.end(),
+                                             visitor)) {
+      log.Error() << "Error reading ways in area!";
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Returns up to count routable way segments within the given radius of the coordinate
+   * that can be used by the given profile, ordered by increasing distance. Each match
+   * holds the projection of the coordinate onto the segment and the route nodes
+   * enclosing it, so it can directly be used as start or target of a route.
+   *
+   * If the database contains a segment index (see RouteSegmentIndex) the segments are
+   * read from the index without loading any way, else all ways in the radius are loaded.
+   *
+   * Method is thread-safe.
+   *
+   * @param coord
+   *    coordinate of the search center
+   * @param profile
+   *    Routing profile to use
+   * @param radius
+   *    The maximum distance of the segments
+   * @param count
+   *    The maximum number of segments to return
+   * @return
+   *    The closest segments, empty on error or if there is no segment in the radius
+   */
+  std::vector<RouteSegmentMatch> SimpleRoutingService::GetClosestRouteSegments(const GeoCoord& coord,
+                                                                               const RoutingProfile& profile,
+                                                                               const Distance& radius,
+                                                                               size_t count) const
+  {
+    std::vector<RouteSegmentMatch> matches;
+    RouteSegmentIndexRef           segmentIndex=routingDatabase.GetSegmentIndex();
+
+    if (segmentIndex &&
+        segmentIndex->SupportsVehicle(profile.GetVehicle())) {
+      TypeConfigRef typeConfig=database->GetTypeConfig();
+      auto          filter=[&typeConfig,&profile](const RouteSegment& segment) {
+        return segment.typeIndex<typeConfig->GetTypeCount() &&
+               profile.CanUse(*typeConfig->GetTypeInfo(segment.typeIndex),
+                              AccessFeatureValue(segment.access));
+      };
+
+      if (!segmentIndex->GetClosestSegments(coord,
+                                            profile.GetVehicle(),
+                                            radius,
+                                            count,
+                                            filter,
+                                            matches)) {
+        log.Error() << "Error reading route segment index!";
+        matches.clear();
+      }
+
+      return matches;
+    }
+
+    if (!GetClosestRouteSegmentsFromWays(coord,
+                                         profile,
+                                         radius,
+                                         matches)) {
+      matches.clear();
+
+      return matches;
+    }
+
+    std::sort(matches.begin(),
+              matches.end(),
+              [](const RouteSegmentMatch& a,
+                 const RouteSegmentMatch& b) {
+      return a.distance<b.distance;
+    });
+
+    if (matches.size()>count) {
+      matches.resize(count);
+    }
+
+    return matches;
+  }
+
+  /**
+   * Returns the closest routeable object (area or way) relative
+   * to the given coordinate.
+   *
+   * The result should be use as imput for the router to define
+   * routing start or end point.
+   *
+   * @note The returned node may in fact not be routable, it is just
+   * the closest node to the given position on a routable way or area.
+   *
+   * @note The actual object may not be within the given radius
    * due to internal search index resolution.
    *
+   * @note If the database contains a segment index, it is used instead of
+   * loading all ways in the radius and the result is guaranteed to be within the radius.
+   *
    * @param coord
    *    coordinate of the search center
    * @param profile
@@ -468,6 +2102,24 @@ namespace osmscout {
                                                              const RoutingProfile& profile,
                                                              const Distance &radius) const
   {
+    RouteSegmentIndexRef segmentIndex=routingDatabase.GetSegmentIndex();
+
+    if (segmentIndex &&
+        segmentIndex->SupportsVehicle(profile.GetVehicle())) {
+      std::vector<RouteSegmentMatch> matches=GetClosestRouteSegments(coord,
+                                                                     profile,
+                                                                     radius,
+                                                                     1);
+
+      if (matches.empty()) {
+        return RoutePosition();
+      }
+
+      return RoutePosition(matches.front().segment.GetObjectFileRef(),
+                           matches.front().GetClosestNodeIndex(),
+                           /*database*/0);
+    }
+
     TypeConfigRef    typeConfig=database->GetTypeConfig();
     AreaAreaIndexRef areaAreaIndex=database->GetAreaAreaIndex();
     AreaWayIndexRef  areaWayIndex=database->GetAreaWayIndex();
@@ -643,11 +2295,41 @@ namespace osmscout {
       }
     }
 
-    Distance closestDistance=Distance::Max();
-    WayRef   closestWay;
-    AreaRef  closestArea;
-
-    if (!routeableWayTypes.Empty()) {
+    RouteSegmentIndexRef segmentIndex=routingDatabase.GetSegmentIndex();
+    Distance             closestDistance=Distance::Max();
+    WayRef               closestWay;
+    AreaRef              closestArea;
+
+    if (!routeableWayTypes.Empty() &&
+        segmentIndex &&
+        segmentIndex->SupportsVehicle(vehicle)) {
+      TypeConfigRef                  typeConfig=database->GetTypeConfig();
+      std::vector<RouteSegmentMatch> matches;
+      auto                           filter=[&typeConfig,&routeableWayTypes](const RouteSegment& segment) {
+        return segment.typeIndex<typeConfig->GetTypeCount() &&
+               routeableWayTypes.IsSet(typeConfig->GetTypeInfo(segment.typeIndex));
+      };
+
+      if (!segmentIndex->GetClosestSegments(location,
+                                            vehicle,
+                                            maxRadius,
+                                            1,
+                                            filter,
+                                            matches)) {
+        log.Error() << "Error reading route segment index!";
+      }
+      else if (!matches.empty()) {
+        if (database->GetWayByOffset(matches.front().segment.way,
+                                     closestWay)) {
+          closestDistance=matches.front().distance;
+        }
+        else {
+          log.Error() << "Error reading way " << matches.front().segment.way << "!";
+          closestWay.reset();
+        }
+      }
+    }
+    else if (!routeableWayTypes.Empty()) {
       WayRegionSearchResult waySearchResult=database->LoadWaysInRadius(location,
                                                                        routeableWayTypes,
                                                                        maxRadius);
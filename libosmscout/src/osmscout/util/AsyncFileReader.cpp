@@ -0,0 +1,969 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/private/Config.h>
+
+#include <osmscout/util/AsyncFileReader.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+#if defined(HAVE_LINUX_IO_URING_H)
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <string.h>
+  #include <unistd.h>
+
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #include <sys/uio.h>
+#endif
+
+#include <osmscout/util/Exception.h>
+#include <osmscout/util/FileScanner.h>
+#include <osmscout/util/Logger.h>
+
+namespace osmscout {
+
+  AsyncFileReader::Backend::~Backend()
+  {
+    // no code
+  }
+
+  /**
+   * Processes read requests using a pool of worker threads. Each thread
+   * has its own FileScanner and processes one request at a time.
+   */
+  class ThreadPoolBackend CLASS_FINAL : public AsyncFileReader::Backend
+  {
+  private:
+    /**
+     * State of one call to Read()
+     */
+    struct Batch
+    {
+      std::deque<AsyncFileReader::ReadRequest*> completed; //!< Completed, but not yet reported requests
+    };
+
+    struct Job
+    {
+      AsyncFileReader::ReadRequest *request;
+      Batch                        *batch;
+    };
+
+  private:
+    std::string              filename;
+    std::vector<std::thread> workers;
+    std::mutex               mutex;
+    std::condition_variable  jobCondition;
+    std::condition_variable  completionCondition;
+    std::deque<Job>          jobs;
+    bool                     running;
+
+  private:
+    void ProcessJobs();
+
+  public:
+    ThreadPoolBackend(const std::string& filename,
+                      size_t workerCount);
+    ~ThreadPoolBackend() override;
+
+    bool IsKernelAsync() const override
+    {
+      return false;
+    }
+
+    void Read(std::vector<AsyncFileReader::ReadRequest>& requests,
+              const AsyncFileReader::CompletionHandler& handler) override;
+  };
+
+  ThreadPoolBackend::ThreadPoolBackend(const std::string& filename,
+                                       size_t workerCount)
+  : filename(filename),
+    running(true)
+  {
+    for (size_t i=0; i<workerCount; i++) {
+      workers.push_back(std::thread(&ThreadPoolBackend::ProcessJobs,this));
+    }
+  }
+
+  ThreadPoolBackend::~ThreadPoolBackend()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      running=false;
+    }
+
+    jobCondition.notify_all();
+
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  void ThreadPoolBackend::ProcessJobs()
+  {
+    FileScanner scanner;
+
+    try {
+      scanner.Open(filename,
+                   FileScanner::LowMemRandom,
+                   false);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      scanner.CloseFailsafe();
+    }
+
+    while (true) {
+      Job job;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        jobCondition.wait(lock,[this]{return !jobs.empty() || !running;});
+
+        if (jobs.empty()) {
+          break;
+        }
+
+        job=jobs.front();
+        jobs.pop_front();
+      }
+
+      job.request->success=false;
+
+      if (scanner.IsOpen()) {
+        try {
+          scanner.SetPos(job.request->offset);
+          scanner.Read(job.request->buffer,
+                       job.request->length);
+
+          job.request->success=true;
+        }
+        catch (IOException& e) {
+          log.Error() << e.GetDescription();
+
+          // Reopen the scanner to reset the error state
+          scanner.CloseFailsafe();
+
+          try {
+            scanner.Open(filename,
+                         FileScanner::LowMemRandom,
+                         false);
+          }
+          catch (IOException& e) {
+            log.Error() << e.GetDescription();
+            scanner.CloseFailsafe();
+          }
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        job.batch->completed.push_back(job.request);
+      }
+
+      completionCondition.notify_all();
+    }
+
+    scanner.CloseFailsafe();
+  }
+
+  void ThreadPoolBackend::Read(std::vector<AsyncFileReader::ReadRequest>& requests,
+                               const AsyncFileReader::CompletionHandler& handler)
+  {
+    Batch batch;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+
+      for (auto& request : requests) {
+        jobs.push_back(Job{&request,&batch});
+      }
+    }
+
+    jobCondition.notify_all();
+
+    size_t reported=0;
+
+    while (reported<requests.size()) {
+      AsyncFileReader::ReadRequest* request;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        completionCondition.wait(lock,[&batch]{return !batch.completed.empty();});
+
+        request=batch.completed.front();
+        batch.completed.pop_front();
+      }
+
+      reported++;
+
+      if (handler) {
+        try {
+          handler(*request);
+        }
+        catch (...) {
+          // The workers still reference the requests and the batch, wait for them to finish
+          std::unique_lock<std::mutex> lock(mutex);
+
+          completionCondition.wait(lock,[&]{return reported+batch.completed.size()==requests.size();});
+
+          throw;
+        }
+      }
+    }
+  }
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+  //! user_data of cancel requests, read requests use the index of the request
+  static const uint64_t cancelUserData=std::numeric_limits<uint64_t>::max();
+
+  /**
+   * One io_uring instance with its submission and completion queue. The system
+   * calls are used directly, so there is no dependency on liburing.
+   *
+   * A ring is only used by one call to Read() at a time.
+   */
+  class IOUring CLASS_FINAL
+  {
+  private:
+    int                 ringFd;      //!< io_uring handle
+    unsigned            entries;     //!< Size of the submission queue
+
+    void                *sqRing;     //!< Mapped submission queue ring
+    size_t              sqRingSize;
+    void                *cqRing;     //!< Mapped completion queue ring
+    size_t              cqRingSize;
+    struct io_uring_sqe *sqes;       //!< Mapped submission queue entries
+    size_t              sqesSize;
+
+    unsigned            *sqHead;
+    unsigned            *sqTail;
+    unsigned            *sqMask;
+    unsigned            *sqArray;
+    unsigned            *cqHead;
+    unsigned            *cqTail;
+    unsigned            *cqMask;
+    struct io_uring_cqe *cqes;
+
+  private:
+    IOUring();
+
+    void Free();
+
+    void PushRead(int fd,
+                  uint64_t index,
+                  const struct iovec& iovec,
+                  FileOffset offset);
+    void PushCancel(uint64_t index);
+
+    void Withdraw(std::vector<bool>& inKernel,
+                  unsigned& inFlight);
+    bool Drain(std::vector<bool>& inKernel,
+               unsigned& inFlight);
+
+  public:
+    ~IOUring();
+
+    static std::unique_ptr<IOUring> Create(size_t entries);
+
+    inline bool IsValid() const
+    {
+      return ringFd>=0;
+    }
+
+    void Read(int fd,
+              std::vector<AsyncFileReader::ReadRequest>& requests,
+              const AsyncFileReader::CompletionHandler& handler);
+  };
+
+  IOUring::IOUring()
+  : ringFd(-1),
+    entries(0),
+    sqRing(MAP_FAILED),
+    sqRingSize(0),
+    cqRing(MAP_FAILED),
+    cqRingSize(0),
+    sqes(static_cast<struct io_uring_sqe*>(MAP_FAILED)),
+    sqesSize(0),
+    sqHead(nullptr),
+    sqTail(nullptr),
+    sqMask(nullptr),
+    sqArray(nullptr),
+    cqHead(nullptr),
+    cqTail(nullptr),
+    cqMask(nullptr),
+    cqes(nullptr)
+  {
+    // no code
+  }
+
+  IOUring::~IOUring()
+  {
+    Free();
+  }
+
+  void IOUring::Free()
+  {
+    if (sqes!=MAP_FAILED) {
+      munmap(sqes,sqesSize);
+      sqes=static_cast<struct io_uring_sqe*>(MAP_FAILED);
+    }
+
+    if (cqRing!=MAP_FAILED && cqRing!=sqRing) {
+      munmap(cqRing,cqRingSize);
+    }
+
+    cqRing=MAP_FAILED;
+
+    if (sqRing!=MAP_FAILED) {
+      munmap(sqRing,sqRingSize);
+      sqRing=MAP_FAILED;
+    }
+
+    if (ringFd>=0) {
+      close(ringFd);
+      ringFd=-1;
+    }
+  }
+
+  /**
+   * Return a new ring or an empty pointer, if io_uring is not available
+   * (old kernel, blocked by seccomp, resource limits,...).
+   */
+  std::unique_ptr<IOUring> IOUring::Create(size_t entries)
+  {
+    std::unique_ptr<IOUring> ring(new IOUring());
+    struct io_uring_params   params;
+
+    memset(&params,0,sizeof(params));
+
+    ring->ringFd=(int)syscall(__NR_io_uring_setup,
+                              (unsigned)entries,
+                              &params);
+
+    if (ring->ringFd<0) {
+      log.Debug() << "io_uring not available (" << strerror(errno) << ")";
+      return nullptr;
+    }
+
+    ring->entries=params.sq_entries;
+    ring->sqRingSize=params.sq_off.array+params.sq_entries*sizeof(unsigned);
+    ring->cqRingSize=params.cq_off.cqes+params.cq_entries*sizeof(struct io_uring_cqe);
+    ring->sqesSize=params.sq_entries*sizeof(struct io_uring_sqe);
+
+    bool singleMmap=false;
+
+#if defined(IORING_FEAT_SINGLE_MMAP)
+    if ((params.features & IORING_FEAT_SINGLE_MMAP)!=0) {
+      singleMmap=true;
+      ring->sqRingSize=std::max(ring->sqRingSize,ring->cqRingSize);
+      ring->cqRingSize=ring->sqRingSize;
+    }
+#endif
+
+    ring->sqRing=mmap(nullptr,
+                      ring->sqRingSize,
+                      PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE,
+                      ring->ringFd,
+                      IORING_OFF_SQ_RING);
+
+    if (ring->sqRing==MAP_FAILED) {
+      log.Error() << "Cannot map io_uring submission queue (" << strerror(errno) << ")";
+      return nullptr;
+    }
+
+    if (singleMmap) {
+      ring->cqRing=ring->sqRing;
+    }
+    else {
+      ring->cqRing=mmap(nullptr,
+                        ring->cqRingSize,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE,
+                        ring->ringFd,
+                        IORING_OFF_CQ_RING);
+
+      if (ring->cqRing==MAP_FAILED) {
+        log.Error() << "Cannot map io_uring completion queue (" << strerror(errno) << ")";
+        return nullptr;
+      }
+    }
+
+    ring->sqes=static_cast<struct io_uring_sqe*>(mmap(nullptr,
+                                                      ring->sqesSize,
+                                                      PROT_READ | PROT_WRITE,
+                                                      MAP_SHARED | MAP_POPULATE,
+                                                      ring->ringFd,
+                                                      IORING_OFF_SQES));
+
+    if (ring->sqes==MAP_FAILED) {
+      log.Error() << "Cannot map io_uring submission queue entries (" << strerror(errno) << ")";
+      return nullptr;
+    }
+
+    char *sq=static_cast<char*>(ring->sqRing);
+    char *cq=static_cast<char*>(ring->cqRing);
+
+    ring->sqHead=reinterpret_cast<unsigned*>(sq+params.sq_off.head);
+    ring->sqTail=reinterpret_cast<unsigned*>(sq+params.sq_off.tail);
+    ring->sqMask=reinterpret_cast<unsigned*>(sq+params.sq_off.ring_mask);
+    ring->sqArray=reinterpret_cast<unsigned*>(sq+params.sq_off.array);
+    ring->cqHead=reinterpret_cast<unsigned*>(cq+params.cq_off.head);
+    ring->cqTail=reinterpret_cast<unsigned*>(cq+params.cq_off.tail);
+    ring->cqMask=reinterpret_cast<unsigned*>(cq+params.cq_off.ring_mask);
+    ring->cqes=reinterpret_cast<struct io_uring_cqe*>(cq+params.cq_off.cqes);
+
+    return ring;
+  }
+
+  /**
+   * Put a read request into the submission queue. The caller must assure
+   * that the queue has room for one more entry.
+   */
+  void IOUring::PushRead(int fd,
+                         uint64_t index,
+                         const struct iovec& iovec,
+                         FileOffset offset)
+  {
+    unsigned            tail=*sqTail;
+    unsigned            slot=tail & *sqMask;
+    struct io_uring_sqe *sqe=&sqes[slot];
+
+    memset(sqe,0,sizeof(*sqe));
+
+    sqe->opcode=IORING_OP_READV;
+    sqe->fd=fd;
+    sqe->off=offset;
+    sqe->addr=(uint64_t)(uintptr_t)&iovec;
+    sqe->len=1;
+    sqe->user_data=index;
+
+    sqArray[slot]=slot;
+
+    // Make the entry visible to the kernel after it has been filled
+    __atomic_store_n(sqTail,tail+1,__ATOMIC_RELEASE);
+  }
+
+  /**
+   * Put a request to cancel the read with the given index into the submission
+   * queue. The caller must assure that the queue has room for one more entry.
+   */
+  void IOUring::PushCancel(uint64_t index)
+  {
+    unsigned            tail=*sqTail;
+    unsigned            slot=tail & *sqMask;
+    struct io_uring_sqe *sqe=&sqes[slot];
+
+    memset(sqe,0,sizeof(*sqe));
+
+    sqe->opcode=IORING_OP_ASYNC_CANCEL;
+    sqe->fd=-1;
+    sqe->addr=index;
+    sqe->user_data=cancelUserData;
+
+    sqArray[slot]=slot;
+
+    __atomic_store_n(sqTail,tail+1,__ATOMIC_RELEASE);
+  }
+
+  /**
+   * Remove all entries from the submission queue, that have not yet been
+   * consumed by the kernel.
+   */
+  void IOUring::Withdraw(std::vector<bool>& inKernel,
+                         unsigned& inFlight)
+  {
+    unsigned head=__atomic_load_n(sqHead,__ATOMIC_ACQUIRE);
+    unsigned tail=*sqTail;
+
+    for (unsigned i=head; i!=tail; i++) {
+      uint64_t index=sqes[sqArray[i & *sqMask]].user_data;
+
+      if (index!=cancelUserData) {
+        inKernel[(size_t)index]=false;
+        inFlight--;
+      }
+    }
+
+    __atomic_store_n(sqTail,head,__ATOMIC_RELEASE);
+  }
+
+  /**
+   * Called if a batch is aborted: Withdraw the not yet submitted reads, cancel
+   * the submitted ones and wait until the kernel has completed all of them, so
+   * that the kernel does not write into the request buffers afterwards.
+   *
+   * Returns false, if the ring cannot be used anymore.
+   */
+  bool IOUring::Drain(std::vector<bool>& inKernel,
+                      unsigned& inFlight)
+  {
+    Withdraw(inKernel,
+             inFlight);
+
+    unsigned toSubmit=0;
+
+    // IORING_OP_ASYNC_CANCEL is available since the same kernel release as IORING_FEAT_NODROP.
+    // Without it (or if the kernel rejects it) we just wait for the reads to complete.
+#if defined(IORING_FEAT_NODROP)
+    for (size_t index=0; index<inKernel.size(); index++) {
+      if (inKernel[index]) {
+        PushCancel(index);
+        toSubmit++;
+      }
+    }
+#endif
+
+    while (inFlight>0) {
+      int result=(int)syscall(__NR_io_uring_enter,
+                              ringFd,
+                              toSubmit,
+                              1,
+                              IORING_ENTER_GETEVENTS,
+                              nullptr,
+                              0);
+
+      if (result<0) {
+        if (errno==EINTR || errno==EAGAIN || errno==EBUSY) {
+          continue;
+        }
+
+        if (toSubmit>0) {
+          // Give up cancelling, only wait for the reads
+          Withdraw(inKernel,
+                   inFlight);
+          toSubmit=0;
+          continue;
+        }
+
+        log.Error() << "Cannot wait for io_uring requests (" << strerror(errno) << ")";
+        return false;
+      }
+
+      toSubmit-=std::min(toSubmit,(unsigned)result);
+
+      unsigned head=*cqHead;
+      unsigned tail=__atomic_load_n(cqTail,__ATOMIC_ACQUIRE);
+
+      while (head!=tail) {
+        uint64_t index=cqes[head & *cqMask].user_data;
+
+        head++;
+
+        if (index!=cancelUserData) {
+          inKernel[(size_t)index]=false;
+          inFlight--;
+        }
+      }
+
+      __atomic_store_n(cqHead,head,__ATOMIC_RELEASE);
+    }
+
+    return true;
+  }
+
+  void IOUring::Read(int fd,
+                     std::vector<AsyncFileReader::ReadRequest>& requests,
+                     const AsyncFileReader::CompletionHandler& handler)
+  {
+    if (ringFd<0) {
+      throw IOException("io_uring","Cannot submit read requests","Ring is not available");
+    }
+
+    std::vector<struct iovec> iovecs(requests.size());
+    std::vector<size_t>       transferred(requests.size(),0);
+    std::vector<bool>         inKernel(requests.size(),false);
+    std::vector<size_t>       retries;
+    size_t                    next=0;
+    size_t                    completed=0;
+    unsigned                  inFlight=0;
+    unsigned                  toSubmit=0;
+
+    try {
+      while (completed<requests.size()) {
+        // Fill the submission queue, partial reads first
+        while (inFlight<entries &&
+               (!retries.empty() || next<requests.size())) {
+          size_t index;
+
+          if (!retries.empty()) {
+            index=retries.back();
+            retries.pop_back();
+          }
+          else {
+            index=next;
+            next++;
+          }
+
+          iovecs[index].iov_base=requests[index].buffer+transferred[index];
+          iovecs[index].iov_len=requests[index].length-transferred[index];
+
+          PushRead(fd,
+                   index,
+                   iovecs[index],
+                   requests[index].offset+transferred[index]);
+
+          inKernel[index]=true;
+          inFlight++;
+          toSubmit++;
+        }
+
+        int result=(int)syscall(__NR_io_uring_enter,
+                                ringFd,
+                                toSubmit,
+                                1,
+                                IORING_ENTER_GETEVENTS,
+                                nullptr,
+                                0);
+
+        if (result<0) {
+          if (errno==EINTR || errno==EAGAIN || errno==EBUSY) {
+            continue;
+          }
+
+          log.Error() << "Cannot submit io_uring requests (" << strerror(errno) << ")";
+          throw IOException("io_uring","Cannot submit read requests",strerror(errno));
+        }
+
+        toSubmit-=std::min(toSubmit,(unsigned)result);
+
+        unsigned head=*cqHead;
+        unsigned tail=__atomic_load_n(cqTail,__ATOMIC_ACQUIRE);
+
+        while (head!=tail) {
+          struct io_uring_cqe *cqe=&cqes[head & *cqMask];
+          size_t              index=(size_t)cqe->user_data;
+          int                 res=cqe->res;
+          bool                done=true;
+
+          head++;
+          inFlight--;
+          inKernel[index]=false;
+
+          if (res==-EINTR || res==-EAGAIN) {
+            retries.push_back(index);
+            done=false;
+          }
+          else if (res<=0) {
+            requests[index].success=false;
+          }
+          else {
+            transferred[index]+=(size_t)res;
+
+            if (transferred[index]<requests[index].length) {
+              // Partial read, queue the remainder
+              retries.push_back(index);
+              done=false;
+            }
+            else {
+              requests[index].success=true;
+            }
+          }
+
+          if (done) {
+            completed++;
+
+            if (handler) {
+              // Release the entries first, the handler may throw
+              __atomic_store_n(cqHead,head,__ATOMIC_RELEASE);
+
+              handler(requests[index]);
+            }
+          }
+        }
+
+        __atomic_store_n(cqHead,head,__ATOMIC_RELEASE);
+      }
+    }
+    catch (...) {
+      // The requests (and the iovecs) must stay valid until the kernel is done with them
+      if (!Drain(inKernel,
+                 inFlight)) {
+        // Last resort, tearing down the ring makes the kernel cancel the outstanding requests
+        Free();
+      }
+
+      throw;
+    }
+  }
+
+  /**
+   * Processes read requests using the Linux io_uring interface.
+   *
+   * Each call to Read() uses a ring of its own, so threads reading
+   * concurrently do not wait for each other. Rings are kept for reuse.
+   */
+  class IOUringBackend CLASS_FINAL : public AsyncFileReader::Backend
+  {
+  private:
+    int                                   fd;        //!< File handle
+    size_t                                entries;   //!< Requested size of the submission queue of a ring
+    std::mutex                            ringMutex; //!< Mutex to secure multi-thread access to the ring pool
+    std::vector<std::unique_ptr<IOUring>> idleRings; //!< Pool of rings currently not in use
+
+  private:
+    IOUringBackend();
+
+    std::unique_ptr<IOUring> AcquireRing();
+    void ReleaseRing(std::unique_ptr<IOUring>&& ring);
+
+  public:
+    ~IOUringBackend() override;
+
+    static std::unique_ptr<AsyncFileReader::Backend> Create(const std::string& filename,
+                                                            size_t entries);
+
+    bool IsKernelAsync() const override
+    {
+      return true;
+    }
+
+    void Read(std::vector<AsyncFileReader::ReadRequest>& requests,
+              const AsyncFileReader::CompletionHandler& handler) override;
+  };
+
+  IOUringBackend::IOUringBackend()
+  : fd(-1),
+    entries(0)
+  {
+    // no code
+  }
+
+  IOUringBackend::~IOUringBackend()
+  {
+    // Rings must be torn down before the file they read from is closed
+    idleRings.clear();
+
+    if (fd>=0) {
+      close(fd);
+    }
+  }
+
+  /**
+   * Return a new io_uring backend or an empty pointer, if io_uring
+   * is not available (old kernel, blocked by seccomp,...).
+   */
+  std::unique_ptr<AsyncFileReader::Backend> IOUringBackend::Create(const std::string& filename,
+                                                                   size_t entries)
+  {
+    // Creating the first ring checks, if io_uring is available at all
+    std::unique_ptr<IOUring> ring=IOUring::Create(entries);
+
+    if (!ring) {
+      return nullptr;
+    }
+
+    std::unique_ptr<IOUringBackend> backend(new IOUringBackend());
+
+    backend->entries=entries;
+    backend->idleRings.push_back(std::move(ring));
+
+    backend->fd=open(filename.c_str(),O_RDONLY);
+
+    if (backend->fd<0) {
+      throw IOException(filename,"Cannot open file",strerror(errno));
+    }
+
+    return std::unique_ptr<AsyncFileReader::Backend>(std::move(backend));
+  }
+
+  /**
+   * Return an idle ring from the pool or create a new one.
+   *
+   * Method is thread-safe.
+   */
+  std::unique_ptr<IOUring> IOUringBackend::AcquireRing()
+  {
+    {
+      std::lock_guard<std::mutex> lock(ringMutex);
+
+      if (!idleRings.empty()) {
+        std::unique_ptr<IOUring> ring=std::move(idleRings.back());
+
+        idleRings.pop_back();
+
+        return ring;
+      }
+    }
+
+    std::unique_ptr<IOUring> ring=IOUring::Create(entries);
+
+    if (!ring) {
+      throw IOException("io_uring","Cannot submit read requests","Cannot create ring");
+    }
+
+    return ring;
+  }
+
+  /**
+   * Return the ring to the pool. Rings that cannot be used anymore are dropped.
+   *
+   * Method is thread-safe.
+   */
+  void IOUringBackend::ReleaseRing(std::unique_ptr<IOUring>&& ring)
+  {
+    if (!ring->IsValid()) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(ringMutex);
+
+    idleRings.push_back(std::move(ring));
+  }
+
+  void IOUringBackend::Read(std::vector<AsyncFileReader::ReadRequest>& requests,
+                            const AsyncFileReader::CompletionHandler& handler)
+  {
+    std::unique_ptr<IOUring> ring=AcquireRing();
+
+    try {
+      ring->Read(fd,
+                 requests,
+                 handler);
+    }
+    catch (...) {
+      ReleaseRing(std::move(ring));
+      throw;
+    }
+
+    ReleaseRing(std::move(ring));
+  }
+#endif
+
+  AsyncFileReader::AsyncFileReader()
+  {
+    // no code
+  }
+
+  AsyncFileReader::~AsyncFileReader()
+  {
+    Close();
+  }
+
+  /**
+   * Open the given file for reading.
+   *
+   * @param filename
+   *    Name of the file
+   * @param maxRequestsInFlight
+   *    Maximum number of requests processed at the same time. The thread pool
+   *    implementation uses at most 16 threads.
+   *
+   * @throws IOException
+   */
+  void AsyncFileReader::Open(const std::string& filename,
+                             size_t maxRequestsInFlight)
+  {
+    Close();
+
+    this->filename=filename;
+
+    maxRequestsInFlight=std::max(maxRequestsInFlight,(size_t)1);
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+    backend=IOUringBackend::Create(filename,
+                                   maxRequestsInFlight);
+
+    if (backend) {
+      return;
+    }
+#endif
+
+    // Make sure the file is accessible, workers open their own scanners
+    FileScanner scanner;
+
+    scanner.Open(filename,
+                 FileScanner::LowMemRandom,
+                 false);
+    scanner.Close();
+
+    backend.reset(new ThreadPoolBackend(filename,
+                                        std::min(maxRequestsInFlight,(size_t)16)));
+  }
+
+  void AsyncFileReader::Close()
+  {
+    backend.reset();
+  }
+
+  /**
+   * Return true, if the kernel processes the requests asynchronously (io_uring),
+   * false, if blocking reads in worker threads are used.
+   */
+  bool AsyncFileReader::IsKernelAsync() const
+  {
+    return backend && backend->IsKernelAsync();
+  }
+
+  /**
+   * Read all given requests. The method returns after all requests have been completed.
+   * The handler is called for each completed request in the thread calling Read(), so
+   * processing of completed requests overlaps with requests still in flight.
+   *
+   * The handler must not call Read() on the same instance.
+   *
+   * @return
+   *    true, if all requests could be read successfully, else false
+   *
+   * Method is thread-safe.
+   */
+  bool AsyncFileReader::Read(std::vector<ReadRequest>& requests,
+                             const CompletionHandler& handler)
+  {
+    if (!backend) {
+      log.Error() << "File '" << filename << "' is not open";
+      return false;
+    }
+
+    if (requests.empty()) {
+      return true;
+    }
+
+    for (auto& request : requests) {
+      request.success=false;
+    }
+
+    try {
+      backend->Read(requests,
+                    handler);
+    }
+    catch (IOException& e) {
+      log.Error() << e.GetDescription();
+      return false;
+    }
+
+    return std::all_of(requests.begin(),
+                       requests.end(),
+                       [](const ReadRequest& request) {
+                         return request.success;
+                       });
+  }
+}
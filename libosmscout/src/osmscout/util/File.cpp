@@ -187,6 +187,26 @@ namespace osmscout {
 #endif
   }
 
+  bool MakeDirectory(const std::string& dirname)
+  {
+#if defined(__WIN32__) || defined(WIN32)
+    if (CreateDirectory(dirname.c_str(),nullptr)) {
+      return true;
+    }
+#elif defined(HAVE_SYS_STAT_H)
+    if (mkdir(dirname.c_str(),
+              0755)==0) {
+      return true;
+    }
+#else
+    throw IOException(dirname,"Make directory","Not implemented");
+#endif
+
+    // The directory might have already existed (or might just have been created by someone else)
+    return ExistsInFilesystem(dirname) &&
+           IsDirectory(dirname);
+  }
+
   bool ReadFile(const std::string& filename, std::vector<char> &contentOut)
   {
     if (!ExistsInFilesystem(filename)){
@@ -60,6 +60,7 @@ namespace osmscout {
      buffer(NULL),
      size(0),
      offset(0),
+     bufferOffset(0),
      byteBuffer(NULL),
      byteBufferSize(0)
 #if defined(_WIN32)
@@ -94,6 +95,12 @@ namespace osmscout {
 
   void FileScanner::FreeBuffer()
   {
+    if (file==NULL) {
+      // Memory buffer, owned by the caller
+      buffer=NULL;
+      return;
+    }
+
 #if defined(HAVE_MMAP)
     if (buffer!=NULL) {
       if (munmap(buffer,size)!=0) {
@@ -118,12 +125,13 @@ namespace osmscout {
                          Mode mode,
                          bool useMmap)
   {
-    if (file!=NULL) {
+    if (IsOpen()) {
       throw IOException(filename,"Error opening file for reading","File already opened");
     }
 
     hasError=true;
     this->filename=filename;
+    bufferOffset=0;
 
     file=fopen(filename.c_str(),"rb");
 
@@ -272,6 +280,43 @@ namespace osmscout {
     hasError=false;
   }
 
+  /**
+   * Open the scanner for reading from the given memory buffer, which holds
+   * dataSize bytes of the file filename starting at file offset dataOffset.
+   * Positions passed to SetPos() and returned by GetPos() are file offsets.
+   *
+   * The buffer is not copied and must stay valid until the scanner is closed.
+   *
+   * If the platform does not support reading from memory, an exception is thrown.
+   */
+  void FileScanner::Open(const std::string& filename,
+                         const char* data,
+                         FileOffset dataOffset,
+                         size_t dataSize)
+  {
+    if (IsOpen()) {
+      throw IOException(filename,"Error opening file for reading","File already opened");
+    }
+
+    hasError=true;
+    this->filename=filename;
+
+#if defined(HAVE_MMAP) || defined(_WIN32)
+    if (data==NULL || dataSize==0) {
+      throw IOException(filename,"Error opening file for reading","Empty memory buffer");
+    }
+
+    buffer=const_cast<char*>(data);
+    size=(FileOffset)dataSize;
+    offset=0;
+    bufferOffset=dataOffset;
+
+    hasError=false;
+#else
+    throw IOException(filename,"Error opening file for reading","Reading from memory is not supported");
+#endif
+  }
+
   /**
    * Closes the file.
    *
@@ -281,12 +326,16 @@ namespace osmscout {
    */
   void FileScanner::Close()
   {
-    if (file==NULL) {
+    if (!IsOpen()) {
       throw IOException(filename,"Cannot close file","File already closed");
     }
 
     FreeBuffer();
 
+    if (file==NULL) {
+      return;
+    }
+
     if (fclose(file)!=0) {
       file=NULL;
       throw IOException(filename,"Cannot close file");
@@ -304,12 +353,16 @@ namespace osmscout {
    */
   void FileScanner::CloseFailsafe()
   {
-    if (file==NULL) {
+    if (!IsOpen()) {
       return;
     }
 
     FreeBuffer();
 
+    if (file==NULL) {
+      return;
+    }
+
     fclose(file);
 
     file=NULL;
@@ -362,12 +415,13 @@ namespace osmscout {
 
 #if defined(HAVE_MMAP) || defined(_WIN32)
     if (buffer!=NULL) {
-      if (pos>=size) {
+      if (pos<bufferOffset ||
+          pos-bufferOffset>=size) {
         hasError=true;
         throw IOException(filename,"Cannot set position in file to "+std::to_string(pos),"Position beyond file end");
       }
 
-      offset=pos;
+      offset=pos-bufferOffset;
 
       return;
     }
@@ -388,6 +442,47 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Hint the operating system, that the given range of the file will be read soon,
+   * so that it can already be loaded in the background. This is just an
+   * optimization, errors are ignored.
+   */
+  void FileScanner::Prefetch(FileOffset pos,
+                             FileOffset length)
+  {
+    if (HasError() ||
+        file==NULL ||
+        pos>=size ||
+        length==0) {
+      return;
+    }
+
+    if (length>size-pos) {
+      length=size-pos;
+    }
+
+#if defined(HAVE_MMAP) && defined(HAVE_POSIX_MADVISE)
+    if (buffer!=NULL) {
+      // posix_madvise() requires a page aligned start address
+      FileOffset pageSize=(FileOffset)sysconf(_SC_PAGESIZE);
+      FileOffset start=pos-pos%pageSize;
+
+      posix_madvise(buffer+start,
+                    (size_t)(pos+length-start),
+                    POSIX_MADV_WILLNEED);
+
+      return;
+    }
+#endif
+
+#if defined(HAVE_POSIX_FADVISE)
+    posix_fadvise(fileno(file),
+                  (off_t)pos,
+                  (off_t)length,
+                  POSIX_FADV_WILLNEED);
+#endif
+  }
+
   /**
    * Returns the current position of the reading cursor in relation to the begining of the file
    *
@@ -401,7 +496,7 @@ namespace osmscout {
 
 #if defined(HAVE_MMAP) || defined(_WIN32)
     if (buffer!=NULL) {
-      return offset;
+      return bufferOffset+offset;
     }
 #endif
 
@@ -2187,34 +2282,42 @@ namespace osmscout {
     }
   }
 
-  void FileScanner::Read(std::vector<Point>& nodes,bool readIds)
+  /**
+   * Reads the header of an encoded list of points as written by
+   * FileWriter::Write(const std::vector<Point>&,bool).
+   *
+   * @return
+   *    false, if the list is empty, else true
+   *
+   * @throws IOException
+   */
+  bool FileScanner::ReadPointsHeader(bool readIds,
+                                     size_t& nodeCount,
+                                     size_t& coordBitSize,
+                                     bool& hasNodes)
   {
-    size_t  coordBitSize;
     uint8_t sizeByte;
 
     Read(sizeByte);
 
     // Fast exit for empty arrays
     if (sizeByte==0) {
-      return;
+      return false;
     }
 
-    bool   hasNodes;
-    size_t nodeCount;
+    if ((sizeByte & 0x03) == 0) {
+      coordBitSize=16;
+    }
+    else if ((sizeByte & 0x03) == 1) {
+      coordBitSize=32;
+    }
+    else {
+      coordBitSize=48;
+    }
 
     if (readIds) {
       hasNodes=(sizeByte & 0x04)!=0;
 
-      if ((sizeByte & 0x03) == 0) {
-        coordBitSize=16;
-      }
-      else if ((sizeByte & 0x03) == 1) {
-        coordBitSize=32;
-      }
-      else {
-        coordBitSize=48;
-      }
-
       nodeCount=(sizeByte & 0x78) >> 3;
 
       if ((sizeByte & 0x80) != 0) {
@@ -2238,16 +2341,6 @@ namespace osmscout {
     else {
       hasNodes=false;
 
-      if ((sizeByte & 0x03) == 0) {
-        coordBitSize=16;
-      }
-      else if ((sizeByte & 0x03) == 1) {
-        coordBitSize=32;
-      }
-      else {
-        coordBitSize=48;
-      }
-
       nodeCount=(sizeByte & 0x7c) >> 2;
 
       if ((sizeByte & 0x80) != 0) {
@@ -2269,6 +2362,27 @@ namespace osmscout {
       }
     }
 
+    return true;
+  }
+
+  /**
+   * Reads a list of points as written by FileWriter::Write(const std::vector<Point>&,bool).
+   *
+   * @throws IOException
+   */
+  void FileScanner::Read(std::vector<Point>& nodes,bool readIds)
+  {
+    size_t coordBitSize;
+    bool   hasNodes;
+    size_t nodeCount;
+
+    if (!ReadPointsHeader(readIds,
+                          nodeCount,
+                          coordBitSize,
+                          hasNodes)) {
+      return;
+    }
+
     nodes.resize(nodeCount);
 
     size_t byteBufferSize=(nodeCount-1)*coordBitSize/8;
@@ -2281,90 +2395,42 @@ namespace osmscout {
 
     nodes[0].SetCoord(firstCoord);
 
-    uint32_t latValue=(uint32_t)round((nodes[0].GetLat()+90.0)*latConversionFactor);
-    uint32_t lonValue=(uint32_t)round((nodes[0].GetLon()+180.0)*lonConversionFactor);
+    uint32_t latValue=(uint32_t)round((firstCoord.GetLat()+90.0)*latConversionFactor);
+    uint32_t lonValue=(uint32_t)round((firstCoord.GetLon()+180.0)*lonConversionFactor);
 
     Read((char*)byteBuffer,byteBufferSize);
 
     if (coordBitSize==16) {
-      size_t currentCoordPos=1;
-
-      for (size_t i=0; i<byteBufferSize; i+=2) {
-        int32_t latDelta=(int8_t)byteBuffer[i];
-        int32_t lonDelta=(int8_t)byteBuffer[i+1];
-
-        latValue+=latDelta;
-        lonValue+=lonDelta;
+      for (size_t i=1; i<nodeCount; i++) {
+        latValue+=(int8_t)byteBuffer[2*(i-1)];
+        lonValue+=(int8_t)byteBuffer[2*(i-1)+1];
 
-        nodes[currentCoordPos].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
-                                                 lonValue/lonConversionFactor-180.0));
-
-        currentCoordPos++;
+        nodes[i].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
+                                   lonValue/lonConversionFactor-180.0));
       }
     }
     else if (coordBitSize==32) {
-      size_t currentCoordPos=1;
-
-      for (size_t i=0; i<byteBufferSize; i+=4) {
-        uint32_t latUDelta=byteBuffer[i+0] | (byteBuffer[i+1]<<8);
-        uint32_t lonUDelta=byteBuffer[i+2] | (byteBuffer[i+3]<<8);
-        int32_t  latDelta;
-        int32_t  lonDelta;
-
-        if (latUDelta & 0x8000) {
-          latDelta=(int32_t)(latUDelta | 0xffff0000);
-        }
-        else {
-          latDelta=(int32_t)latUDelta;
-        }
-
-        latValue+=latDelta;
-
-        if (lonUDelta & 0x8000) {
-          lonDelta=(int32_t)(lonUDelta | 0xffff0000);
-        }
-        else {
-          lonDelta=(int32_t)lonUDelta;
-        }
+      for (size_t i=1; i<nodeCount; i++) {
+        const uint8_t* delta=&byteBuffer[4*(i-1)];
 
-        lonValue+=lonDelta;
+        latValue+=(int16_t)(uint16_t)(delta[0] | (delta[1] << 8));
+        lonValue+=(int16_t)(uint16_t)(delta[2] | (delta[3] << 8));
 
-        nodes[currentCoordPos].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
-                                                 lonValue/lonConversionFactor-180.0));
-        currentCoordPos++;
+        nodes[i].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
+                                   lonValue/lonConversionFactor-180.0));
       }
     }
     else {
-      size_t currentCoordPos=1;
-
-      for (size_t i=0; i<byteBufferSize; i+=6) {
-        uint32_t latUDelta=(byteBuffer[i+0]) | (byteBuffer[i+1]<<8) | (byteBuffer[i+2]<<16);
-        uint32_t lonUDelta=(byteBuffer[i+3]) | (byteBuffer[i+4]<<8) | (byteBuffer[i+5]<<16);
-        int32_t  latDelta;
-        int32_t  lonDelta;
-
-        if (latUDelta & 0x800000) {
-          latDelta=(int32_t)(latUDelta | 0xff000000);
-        }
-        else {
-          latDelta=(int32_t)latUDelta;
-        }
+      for (size_t i=1; i<nodeCount; i++) {
+        const uint8_t* delta=&byteBuffer[6*(i-1)];
+        uint32_t       latUDelta=delta[0] | (delta[1] << 8) | (delta[2] << 16);
+        uint32_t       lonUDelta=delta[3] | (delta[4] << 8) | (delta[5] << 16);
 
-        latValue+=latDelta;
+        latValue+=(int32_t)((latUDelta & 0x800000) ? (latUDelta | 0xff000000) : latUDelta);
+        lonValue+=(int32_t)((lonUDelta & 0x800000) ? (lonUDelta | 0xff000000) : lonUDelta);
 
-        if (lonUDelta & 0x800000) {
-          lonDelta=(int32_t)(lonUDelta | 0xff000000);
-        }
-        else {
-          lonDelta=(int32_t)lonUDelta;
-        }
-
-        lonValue+=lonDelta;
-
-        nodes[currentCoordPos].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
-                                                 lonValue/lonConversionFactor-180.0));
-
-        currentCoordPos++;
+        nodes[i].SetCoord(GeoCoord(latValue/latConversionFactor-90.0,
+                                   lonValue/lonConversionFactor-180.0));
       }
     }
 
@@ -2373,7 +2439,7 @@ namespace osmscout {
 
       while (idCurrent<nodeCount) {
         uint8_t bitset;
-        size_t bitmask=1;
+        uint8_t bitmask=1;
 
         Read(bitset);
 
@@ -2390,16 +2456,115 @@ namespace osmscout {
           idCurrent++;
         }
       }
+    }
+  }
+
 
-      /*
-      uint8_t serial;
+  /**
+   * Reads a list of points as written by FileWriter::Write(const std::vector<Point>&,bool)
+   * into the given view without decoding the individual points. If the file is memory
+   * mapped, the view directly references the mapped data, else the encoded data is copied
+   * into the internal buffer of the view.
+   *
+   * @throws IOException
+   */
+  void FileScanner::Read(PointsView& nodes,bool readIds)
+  {
+    size_t coordBitSize;
+    bool   hasNodes;
+    size_t nodeCount;
 
-      for (size_t i=0; i<nodes.size(); i++) {
-        Read(serial);
+    nodes.Clear();
 
-        nodes[i].SetSerial(serial);
-      }*/
+    if (!ReadPointsHeader(readIds,
+                          nodeCount,
+                          coordBitSize,
+                          hasNodes)) {
+      return;
     }
+
+    GeoCoord firstCoord;
+
+    ReadCoord(firstCoord);
+
+    nodes.nodeCount=nodeCount;
+    nodes.coordBitSize=(uint8_t)coordBitSize;
+    nodes.hasSerials=hasNodes;
+    nodes.firstLat=(uint32_t)round((firstCoord.GetLat()+90.0)*latConversionFactor);
+    nodes.firstLon=(uint32_t)round((firstCoord.GetLon()+180.0)*lonConversionFactor);
+
+    size_t deltaBytes=(nodeCount-1)*coordBitSize/8;
+
+#if defined(HAVE_MMAP) || defined(_WIN32)
+    if (buffer!=NULL) {
+      if (offset+deltaBytes>size) {
+        hasError=true;
+        throw IOException(filename,"Cannot read coordinates","Cannot read beyond end of file");
+      }
+
+      nodes.memoryMapped=true;
+      nodes.deltaData=(const uint8_t*)&buffer[offset];
+      offset+=deltaBytes;
+
+      if (hasNodes) {
+        nodes.serialData=(const uint8_t*)&buffer[offset];
+
+        // Skip the serial data, one bit set byte for each 8 nodes plus a byte for each bit set
+        for (size_t idCurrent=0; idCurrent<nodeCount; idCurrent+=8) {
+          if (offset>=size) {
+            hasError=true;
+            throw IOException(filename,"Cannot read coordinates","Cannot read beyond end of file");
+          }
+
+          uint8_t bitset=(uint8_t)buffer[offset];
+
+          offset++;
+
+          for (size_t i=0; i<8 && idCurrent+i<nodeCount; i++) {
+            if ((bitset & (1u << i))!=0) {
+              offset++;
+            }
+          }
+        }
+
+        if (offset>size) {
+          hasError=true;
+          throw IOException(filename,"Cannot read coordinates","Cannot read beyond end of file");
+        }
+      }
+
+      return;
+    }
+#endif
+
+    nodes.storage.resize(deltaBytes);
+
+    if (deltaBytes>0) {
+      Read((char*)nodes.storage.data(),deltaBytes);
+    }
+
+    if (hasNodes) {
+      for (size_t idCurrent=0; idCurrent<nodeCount; idCurrent+=8) {
+        uint8_t bitset;
+
+        Read(bitset);
+
+        nodes.storage.push_back(bitset);
+
+        for (size_t i=0; i<8 && idCurrent+i<nodeCount; i++) {
+          if ((bitset & (1u << i))!=0) {
+            uint8_t serial;
+
+            Read(serial);
+
+            nodes.storage.push_back(serial);
+          }
+        }
+      }
+    }
+
+    nodes.deltaData=nodes.storage.data();
+    nodes.serialData=nodes.storage.data()+deltaBytes;
   }
 
   void FileScanner::ReadBox(GeoBox& box)
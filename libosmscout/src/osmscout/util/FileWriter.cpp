@@ -29,6 +29,14 @@
 
 #include <stdio.h>
 
+#if defined(HAVE_UNISTD_H)
+  #include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+  #include <io.h>
+#endif
+
 #include <osmscout/system/Assert.h>
 #include <osmscout/system/Math.h>
 
@@ -76,6 +84,30 @@ namespace osmscout {
     hasError=false;
   }
 
+  /**
+   * Open an existing file for writing without truncating it. The writing
+   * cursor is placed at the start of the file.
+   *
+   * @throws IOException
+   */
+  void FileWriter::OpenExisting(const std::string& filename)
+  {
+    if (file!=NULL) {
+      throw IOException(filename,"Error opening file for writing","File already opened");
+    }
+
+    hasError=true;
+    this->filename=filename;
+
+    file=fopen(filename.c_str(),"r+b");
+
+    if (file==NULL) {
+      throw IOException(filename,"Error opening file for writing");
+    }
+
+    hasError=false;
+  }
+
   /**
    *
    * @throws IOException
@@ -1295,6 +1327,27 @@ namespace osmscout {
     }
   }
 
+  /**
+   * Flush all buffered data and wait until the operating system has written it
+   * to the storage device, so it survives a system crash or power loss.
+   *
+   * @throws IOException
+   */
+  void FileWriter::Sync()
+  {
+    Flush();
+
+#if defined(_WIN32)
+    hasError=_commit(_fileno(file))!=0;
+#elif defined(HAVE_UNISTD_H)
+    hasError=fsync(fileno(file))!=0;
+#endif
+
+    if (hasError) {
+      throw IOException(filename,"Cannot sync file");
+    }
+  }
+
   /**
    *
    * @throws IOException
@@ -0,0 +1,326 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/util/MemoryBudget.h>
+
+#include <algorithm>
+
+#include <osmscout/util/Logger.h>
+
+namespace osmscout {
+
+  MemoryBudget::Consumer::~Consumer()
+  {
+    // no code
+  }
+
+  MemoryBudget::MemoryBudget(size_t budget)
+  : budget(budget),
+    rebalanceInterval(1000),
+    lastRebalance(std::chrono::steady_clock::now())
+  {
+    // no code
+  }
+
+  /**
+   * Update the weight of each consumer from the hits and misses since the
+   * last call.
+   *
+   * Caller must hold the mutex.
+   */
+  void MemoryBudget::UpdateWeights()
+  {
+    for (auto& registration : registrations) {
+      size_t hits;
+      size_t misses;
+
+      registration.consumer->GetCacheStatistics(hits,misses);
+
+      // Statistics may have been reset in between
+      size_t deltaHits=hits>=registration.lastHits ? hits-registration.lastHits : hits;
+      size_t deltaMisses=misses>=registration.lastMisses ? misses-registration.lastMisses : misses;
+      double benefit=deltaHits;
+
+      if (deltaHits+deltaMisses>0) {
+        benefit+=deltaMisses*(double)deltaHits/(deltaHits+deltaMisses);
+      }
+
+      registration.weight=0.5*registration.weight+0.5*benefit;
+      registration.lastHits=hits;
+      registration.lastMisses=misses;
+    }
+
+    lastRebalance=std::chrono::steady_clock::now();
+  }
+
+  /**
+   * Calculate new limits for all consumers and pass them to the consumers.
+   * If considerUsage is true, consumers not using their current limit are
+   * restricted to their usage plus some headroom.
+   *
+   * Caller must hold the mutex.
+   */
+  void MemoryBudget::Distribute(bool considerUsage)
+  {
+    if (registrations.empty()) {
+      return;
+    }
+
+    size_t              count=registrations.size();
+    size_t              baseShare=budget/4/count;
+    std::vector<size_t> extra(count,0);
+    std::vector<double> maxExtra(count,-1.0); // -1: no limit
+    std::vector<bool>   active(count,true);
+    size_t              remaining=budget-baseShare*count;
+    double              weightSum=0.0;
+
+    for (const auto& registration : registrations) {
+      weightSum+=registration.weight;
+    }
+
+    // Consumers that do not use their current limit only need some headroom
+    for (size_t i=0; considerUsage && i<count; i++) {
+      size_t usage=registrations[i].consumer->GetMemoryUsage();
+
+      if (usage<registrations[i].limit/4*3) {
+        maxExtra[i]=std::max(0.0,usage*1.5-baseShare);
+      }
+    }
+
+    // Distribute proportional to the weight, consumers reaching their
+    // maximum are removed and the rest is redistributed
+    bool changed=true;
+
+    while (changed) {
+      changed=false;
+
+      double activeWeight=0.0;
+      size_t activeCount=0;
+
+      for (size_t i=0; i<count; i++) {
+        if (active[i]) {
+          activeWeight+=registrations[i].weight;
+          activeCount++;
+        }
+      }
+
+      if (activeCount==0) {
+        break;
+      }
+
+      for (size_t i=0; i<count; i++) {
+        if (!active[i]) {
+          continue;
+        }
+
+        double share=activeWeight>0.0 ? remaining*registrations[i].weight/activeWeight : (double)remaining/activeCount;
+
+        if (maxExtra[i]>=0.0 &&
+            share>=maxExtra[i]) {
+          extra[i]=(size_t)maxExtra[i];
+          remaining-=extra[i];
+          active[i]=false;
+          changed=true;
+          break;
+        }
+      }
+    }
+
+    double activeWeight=0.0;
+    size_t activeCount=0;
+
+    for (size_t i=0; i<count; i++) {
+      if (active[i]) {
+        activeWeight+=registrations[i].weight;
+        activeCount++;
+      }
+    }
+
+    if (activeCount==0) {
+      // Everybody is satisfied, distribute the rest anyway so caches can grow
+      for (size_t i=0; i<count; i++) {
+        extra[i]+=(size_t)(weightSum>0.0 ? remaining*registrations[i].weight/weightSum : (double)remaining/count);
+      }
+    }
+    else {
+      for (size_t i=0; i<count; i++) {
+        if (active[i]) {
+          extra[i]=(size_t)(activeWeight>0.0 ? remaining*registrations[i].weight/activeWeight : (double)remaining/activeCount);
+        }
+      }
+    }
+
+    for (size_t i=0; i<count; i++) {
+      registrations[i].limit=baseShare+extra[i];
+      registrations[i].consumer->SetMemoryLimit(registrations[i].limit);
+    }
+  }
+
+  /**
+   * Register a new consumer. The weights of the already registered consumers are
+   * updated and the memory of all consumers is redistributed. The new consumer
+   * initially gets the average weight of the already registered consumers.
+   */
+  void MemoryBudget::Register(Consumer& consumer)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    Registration                registration;
+    double                      weightSum=0.0;
+
+    UpdateWeights();
+
+    for (const auto& r : registrations) {
+      weightSum+=r.weight;
+    }
+
+    registration.consumer=&consumer;
+    registration.limit=0;
+    registration.weight=registrations.empty() ? 1.0 : weightSum/registrations.size();
+
+    consumer.GetCacheStatistics(registration.lastHits,
+                                registration.lastMisses);
+
+    registrations.push_back(registration);
+
+    Distribute(false);
+  }
+
+  /**
+   * Remove the given consumer, its memory is distributed over the remaining
+   * consumers. The limit of the removed consumer stays untouched.
+   */
+  void MemoryBudget::Unregister(Consumer& consumer)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    registrations.erase(std::remove_if(registrations.begin(),
+                                       registrations.end(),
+                                       [&consumer](const Registration& registration) {
+                                         return registration.consumer==&consumer;
+                                       }),
+                        registrations.end());
+
+    Distribute(false);
+  }
+
+  /**
+   * Change the overall budget and rebalance. If the budget shrinks, consumers
+   * immediately evict entries to fulfill their new limit.
+   */
+  void MemoryBudget::SetBudget(size_t budget)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->budget=budget;
+
+    UpdateWeights();
+    Distribute(true);
+  }
+
+  size_t MemoryBudget::GetBudget() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return budget;
+  }
+
+  /**
+   * Return the limit currently assigned to the given consumer, 0 if
+   * the consumer is not registered
+   */
+  size_t MemoryBudget::GetMemoryLimit(const Consumer& consumer) const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const auto& registration : registrations) {
+      if (registration.consumer==&consumer) {
+        return registration.limit;
+      }
+    }
+
+    return 0;
+  }
+
+  /**
+   * Return the sum of the current memory usage of all consumers
+   */
+  size_t MemoryBudget::GetMemoryUsage() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t                      usage=0;
+
+    for (const auto& registration : registrations) {
+      usage+=registration.consumer->GetMemoryUsage();
+    }
+
+    return usage;
+  }
+
+  /**
+   * Set the minimum time between two rebalancings triggered by RebalanceIfDue().
+   * The default is one second.
+   */
+  void MemoryBudget::SetRebalanceInterval(std::chrono::milliseconds interval)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    rebalanceInterval=interval;
+  }
+
+  /**
+   * Update the weight of each consumer from the hits and misses since the
+   * last call and redistribute the memory.
+   */
+  void MemoryBudget::Rebalance()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    UpdateWeights();
+    Distribute(true);
+  }
+
+  /**
+   * Rebalance, if the last rebalancing is longer ago than the rebalance interval.
+   * Cheap enough to be called on every access to a consumer. Returns immediately,
+   * if another thread is currently accessing the budget.
+   */
+  void MemoryBudget::RebalanceIfDue()
+  {
+    std::unique_lock<std::mutex> lock(mutex,std::try_to_lock);
+
+    if (!lock.owns_lock() ||
+        std::chrono::steady_clock::now()-lastRebalance<rebalanceInterval) {
+      return;
+    }
+
+    UpdateWeights();
+    Distribute(true);
+  }
+
+  void MemoryBudget::DumpStatistics() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (const auto& registration : registrations) {
+      log.Info() << "Memory budget " << registration.consumer->GetMemoryConsumerName() << ": "
+                 << registration.consumer->GetMemoryUsage() << "/" << registration.limit
+                 << " bytes, weight " << registration.weight;
+    }
+  }
+}
@@ -34,6 +34,8 @@ namespace osmscout {
   : quit(false),
     maxVMUsage(0.0),
     maxResidentSet(0.0),
+    residentSetLimit(0),
+    maxBudget(0),
     thread(&MemoryMonitor::BackgroundJob,this)
   {
     // no code
@@ -83,6 +85,34 @@ namespace osmscout {
 
     maxVMUsage=std::max(maxVMUsage,currentVMUsage);
     maxResidentSet=std::max(maxResidentSet,currentResidentSet);
+
+    if (budget &&
+        currentResidentSet>0.0) {
+      AdaptBudget(currentResidentSet);
+    }
+  }
+
+  /**
+   * Shrink the budget by the amount the resident set exceeds the limit. If the
+   * resident set is below the limit, grow the budget by half of the free room
+   * (so that it does not oscillate), but not beyond its size on attachment.
+   */
+  void MemoryMonitor::AdaptBudget(double residentSet)
+  {
+    size_t current=budget->GetBudget();
+    size_t resident=(size_t)residentSet;
+    size_t newBudget=current;
+
+    if (resident>residentSetLimit) {
+      newBudget=current-std::min(resident-residentSetLimit,current);
+    }
+    else if (current<maxBudget) {
+      newBudget=current+std::min((residentSetLimit-resident)/2,maxBudget-current);
+    }
+
+    if (newBudget!=current) {
+      budget->SetBudget(newBudget);
+    }
   }
 
   /**
@@ -118,5 +148,21 @@ namespace osmscout {
     maxVMUsage=0.0;
     maxResidentSet=0.0;
   }
+
+  /**
+   * Adapt the given budget to the memory usage of the process, so that the
+   * resident set stays below the given limit (in bytes). The current size of the
+   * budget is the maximum, the budget grows back to. Passing nullptr
+   * detaches the budget.
+   */
+  void MemoryMonitor::SetMemoryBudget(const MemoryBudgetRef& budget,
+                                      size_t residentSetLimit)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->budget=budget;
+    this->residentSetLimit=residentSetLimit;
+    this->maxBudget=budget ? budget->GetBudget() : 0;
+  }
 }
 
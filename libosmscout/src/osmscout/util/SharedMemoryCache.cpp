@@ -0,0 +1,494 @@
+/*
+  This source is part of the libosmscout library
+  Copyright (C) 2018  Tim Teulings
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+*/
+
+#include <osmscout/private/Config.h>
+
+#include <osmscout/util/SharedMemoryCache.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#if defined(HAVE_SHM_OPEN)
+  #include <errno.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+#endif
+
+#include <osmscout/util/Logger.h>
+
+namespace osmscout {
+
+  static const uint32_t sharedCacheMagic=0x4f534d43; // "OSMC"
+  static const uint32_t sharedCacheVersion=1;
+  static const size_t   probeCount=4;                // Number of slots checked for a key
+
+  /**
+   * Header at the start of the shared memory segment
+   */
+  struct SegmentHeader
+  {
+    std::atomic<uint32_t> magic;        //!< Set by the creator, after the segment is initialized
+    uint32_t              version;      //!< Version of the segment layout
+    uint64_t              slotCount;    //!< Number of slots
+    uint64_t              slotSize;     //!< Size of one slot including its header
+    uint64_t              maxValueSize; //!< Maximum size of a value
+    std::atomic<uint64_t> hits;         //!< Number of hits of all processes
+    std::atomic<uint64_t> misses;       //!< Number of misses of all processes
+  };
+
+  /**
+   * Header of each slot, followed by the value data
+   */
+  struct SlotHeader
+  {
+    std::atomic<uint64_t> sequence;  //!< Incremented before and after each write, odd while written
+    std::atomic<uint64_t> fileKey;   //!< File key of the value
+    std::atomic<uint64_t> key;       //!< Key of the value within the file
+    std::atomic<uint64_t> valueSize; //!< Size of the value, 0 if the slot is empty
+  };
+
+  static inline uint64_t HashKey(uint64_t fileKey,
+                                 uint64_t key)
+  {
+    // splitmix64 finalizer
+    uint64_t hash=fileKey^(key*0x9e3779b97f4a7c15ull);
+
+    hash=(hash^(hash >> 30))*0xbf58476d1ce4e5b9ull;
+    hash=(hash^(hash >> 27))*0x94d049bb133111ebull;
+
+    return hash^(hash >> 31);
+  }
+
+  SharedMemoryCache::SharedMemoryCache()
+  : handle(-1),
+    memory(nullptr),
+    memorySize(0),
+    slotCount(0),
+    slotSize(0),
+    maxValueSize(0)
+  {
+    // no code
+  }
+
+  SharedMemoryCache::~SharedMemoryCache()
+  {
+    Close();
+  }
+
+  /**
+   * Return true, if shared memory is supported on this platform
+   */
+  bool SharedMemoryCache::IsSupported()
+  {
+#if defined(HAVE_SHM_OPEN)
+    std::atomic<uint64_t> value(0);
+
+    // Atomics in shared memory only work across processes if they are lock-free
+    return value.is_lock_free();
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * Map the segment and either initialize it or wait until the creating
+   * process has initialized it.
+   */
+  bool SharedMemoryCache::Initialize(bool create,
+                                     size_t size,
+                                     size_t valueSize)
+  {
+#if defined(HAVE_SHM_OPEN)
+    if (create) {
+      slotSize=(sizeof(SlotHeader)+valueSize+7)/8*8;
+      slotCount=size>sizeof(SegmentHeader) ? (size-sizeof(SegmentHeader))/slotSize : 0;
+
+      if (slotCount<probeCount) {
+        log.Error() << "Shared memory cache '" << name << "' of " << size << " bytes is too small";
+        return false;
+      }
+
+      memorySize=sizeof(SegmentHeader)+slotCount*slotSize;
+
+      if (ftruncate(handle,(off_t)memorySize)!=0) {
+        log.Error() << "Cannot resize shared memory cache '" << name << "': " << strerror(errno);
+        return false;
+      }
+    }
+    else {
+      struct stat info;
+
+      // The creator might not have resized the segment yet
+      for (size_t i=0; i<100; i++) {
+        if (fstat(handle,&info)!=0) {
+          log.Error() << "Cannot access shared memory cache '" << name << "': " << strerror(errno);
+          return false;
+        }
+
+        if ((size_t)info.st_size>=sizeof(SegmentHeader)) {
+          break;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+
+      if ((size_t)info.st_size<sizeof(SegmentHeader)) {
+        log.Error() << "Shared memory cache '" << name << "' was not initialized";
+        return false;
+      }
+
+      memorySize=(size_t)info.st_size;
+    }
+
+    void* mapped=mmap(nullptr,
+                      memorySize,
+                      PROT_READ|PROT_WRITE,
+                      MAP_SHARED,
+                      handle,
+                      0);
+
+    if (mapped==MAP_FAILED) {
+      log.Error() << "Cannot map shared memory cache '" << name << "': " << strerror(errno);
+      return false;
+    }
+
+    memory=static_cast<char*>(mapped);
+
+    SegmentHeader* header=reinterpret_cast<SegmentHeader*>(memory);
+
+    if (create) {
+      // The new segment is zero filled, this is an empty slot
+      header->version=sharedCacheVersion;
+      header->slotCount=slotCount;
+      header->slotSize=slotSize;
+      header->maxValueSize=valueSize;
+      header->magic.store(sharedCacheMagic,std::memory_order_release);
+      maxValueSize=valueSize;
+
+      return true;
+    }
+
+    for (size_t i=0; i<100 && header->magic.load(std::memory_order_acquire)!=sharedCacheMagic; i++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    if (header->magic.load(std::memory_order_acquire)!=sharedCacheMagic ||
+        header->version!=sharedCacheVersion ||
+        sizeof(SegmentHeader)+header->slotCount*header->slotSize>memorySize) {
+      log.Error() << "Shared memory cache '" << name << "' has an incompatible format";
+      return false;
+    }
+
+    slotCount=header->slotCount;
+    slotSize=header->slotSize;
+    maxValueSize=header->maxValueSize;
+
+    return true;
+#else
+    (void)create;
+    (void)size;
+    (void)valueSize;
+
+    return false;
+#endif
+  }
+
+  /**
+   * Open the shared memory segment with the given name. If the segment does
+   * not yet exist, it is created with the given size (in bytes) and maximum value
+   * size. Else size and maximum value size of the existing segment are used.
+   */
+  bool SharedMemoryCache::Open(const std::string& name,
+                               size_t size,
+                               size_t maxValueSize)
+  {
+    Close();
+
+    if (!IsSupported()) {
+      log.Warn() << "Shared memory cache is not supported on this platform";
+      return false;
+    }
+
+#if defined(HAVE_SHM_OPEN)
+    bool create=true;
+
+    this->name=name.empty() || name[0]!='/' ? "/"+name : name;
+
+    handle=shm_open(this->name.c_str(),
+                    O_RDWR|O_CREAT|O_EXCL,
+                    0600);
+
+    if (handle<0 &&
+        errno==EEXIST) {
+      create=false;
+      handle=shm_open(this->name.c_str(),
+                      O_RDWR,
+                      0600);
+    }
+
+    if (handle<0) {
+      log.Error() << "Cannot open shared memory cache '" << name << "': " << strerror(errno);
+      return false;
+    }
+
+    if (!Initialize(create,
+                    size,
+                    maxValueSize)) {
+      Close();
+
+      if (create) {
+        shm_unlink(this->name.c_str());
+      }
+
+      return false;
+    }
+
+    return true;
+#else
+    (void)name;
+    (void)size;
+    (void)maxValueSize;
+
+    return false;
+#endif
+  }
+
+  /**
+   * Unmap the segment. The segment and its content stay available for other
+   * processes.
+   */
+  void SharedMemoryCache::Close()
+  {
+#if defined(HAVE_SHM_OPEN)
+    if (memory!=nullptr) {
+      munmap(memory,memorySize);
+    }
+
+    if (handle>=0) {
+      close(handle);
+    }
+#endif
+
+    handle=-1;
+    memory=nullptr;
+    memorySize=0;
+    slotCount=0;
+    slotSize=0;
+    maxValueSize=0;
+  }
+
+  /**
+   * Copy the value for the given key into the given buffer.
+   *
+   * @return
+   *    true, if the value was found and fits into the buffer, else false
+   */
+  bool SharedMemoryCache::Get(uint64_t fileKey,
+                              uint64_t key,
+                              void* value,
+                              size_t bufferSize,
+                              size_t& valueSize) const
+  {
+    if (memory==nullptr) {
+      return false;
+    }
+
+    SegmentHeader* header=reinterpret_cast<SegmentHeader*>(memory);
+    char*          slots=memory+sizeof(SegmentHeader);
+    size_t         bucket=(size_t)(HashKey(fileKey,key)%slotCount);
+
+    for (size_t p=0; p<probeCount; p++) {
+      SlotHeader* slot=reinterpret_cast<SlotHeader*>(slots+((bucket+p)%slotCount)*slotSize);
+      uint64_t    sequence=slot->sequence.load(std::memory_order_acquire);
+
+      if ((sequence & 1)!=0 ||
+          slot->fileKey.load(std::memory_order_relaxed)!=fileKey ||
+          slot->key.load(std::memory_order_relaxed)!=key) {
+        continue;
+      }
+
+      uint64_t size=slot->valueSize.load(std::memory_order_relaxed);
+
+      if (size==0 ||
+          size>bufferSize ||
+          size>maxValueSize) {
+        break;
+      }
+
+      memcpy(value,
+             reinterpret_cast<char*>(slot)+sizeof(SlotHeader),
+             size);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      // The slot was overwritten while copying
+      if (slot->sequence.load(std::memory_order_relaxed)!=sequence) {
+        break;
+      }
+
+      valueSize=(size_t)size;
+      header->hits.fetch_add(1,std::memory_order_relaxed);
+
+      return true;
+    }
+
+    header->misses.fetch_add(1,std::memory_order_relaxed);
+
+    return false;
+  }
+
+  /**
+   * Store the given value. Values bigger than the maximum value size are
+   * not stored.
+   *
+   * @return
+   *    true, if the value was stored
+   */
+  bool SharedMemoryCache::Put(uint64_t fileKey,
+                              uint64_t key,
+                              const void* value,
+                              size_t valueSize)
+  {
+    if (memory==nullptr ||
+        valueSize==0 ||
+        valueSize>maxValueSize) {
+      return false;
+    }
+
+    char*       slots=memory+sizeof(SegmentHeader);
+    uint64_t    hash=HashKey(fileKey,key);
+    size_t      bucket=(size_t)(hash%slotCount);
+    SlotHeader* target=nullptr;
+    SlotHeader* empty=nullptr;
+
+    for (size_t p=0; p<probeCount; p++) {
+      SlotHeader* slot=reinterpret_cast<SlotHeader*>(slots+((bucket+p)%slotCount)*slotSize);
+
+      if (slot->fileKey.load(std::memory_order_relaxed)==fileKey &&
+          slot->key.load(std::memory_order_relaxed)==key) {
+        target=slot;
+        break;
+      }
+
+      if (empty==nullptr &&
+          slot->valueSize.load(std::memory_order_relaxed)==0) {
+        empty=slot;
+      }
+    }
+
+    if (target==nullptr) {
+      target=empty;
+    }
+
+    if (target==nullptr) {
+      target=reinterpret_cast<SlotHeader*>(slots+((bucket+(hash >> 32)%probeCount)%slotCount)*slotSize);
+    }
+
+    uint64_t sequence=target->sequence.load(std::memory_order_relaxed);
+
+    // A crashed writer leaves its slot locked forever, this only costs one slot
+    if ((sequence & 1)!=0 ||
+        !target->sequence.compare_exchange_strong(sequence,
+                                                  sequence+1,
+                                                  std::memory_order_acquire)) {
+      return false;
+    }
+
+    std::atomic_thread_fence(std::memory_order_release);
+
+    target->fileKey.store(fileKey,std::memory_order_relaxed);
+    target->key.store(key,std::memory_order_relaxed);
+    target->valueSize.store(valueSize,std::memory_order_relaxed);
+
+    memcpy(reinterpret_cast<char*>(target)+sizeof(SlotHeader),
+           value,
+           valueSize);
+
+    target->sequence.store(sequence+2,std::memory_order_release);
+
+    return true;
+  }
+
+  /**
+   * Return the accumulated hits and misses of all processes using the segment
+   */
+  void SharedMemoryCache::GetStatistics(size_t& hits,
+                                        size_t& misses) const
+  {
+    if (memory==nullptr) {
+      hits=0;
+      misses=0;
+      return;
+    }
+
+    const SegmentHeader* header=reinterpret_cast<const SegmentHeader*>(memory);
+
+    hits=(size_t)header->hits.load(std::memory_order_relaxed);
+    misses=(size_t)header->misses.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Delete the shared memory segment with the given name. Processes that
+   * have the segment open can continue to use it.
+   */
+  bool SharedMemoryCache::Remove(const std::string& name)
+  {
+#if defined(HAVE_SHM_OPEN)
+    std::string shmName=name.empty() || name[0]!='/' ? "/"+name : name;
+
+    return shm_unlink(shmName.c_str())==0;
+#else
+    (void)name;
+
+    return false;
+#endif
+  }
+
+  /**
+   * Return a key identifying the given file. The key is based on the
+   * name, the size and the modification time of the file, so after a file was
+   * replaced by a new version, values of the old version are not found anymore.
+   */
+  uint64_t SharedMemoryCache::GetFileKey(const std::string& filename)
+  {
+    // FNV-1a, stable across processes and builds
+    uint64_t key=0xcbf29ce484222325ull;
+
+    for (const char c : filename) {
+      key^=(unsigned char)c;
+      key*=0x100000001b3ull;
+    }
+
+#if defined(HAVE_SHM_OPEN)
+    struct stat info;
+
+    if (stat(filename.c_str(),&info)==0) {
+      key=HashKey(key,(uint64_t)info.st_size);
+      key=HashKey(key,(uint64_t)info.st_mtime);
+    }
+#endif
+
+    return key;
+  }
+}
@@ -19,6 +19,7 @@
 
 #include <osmscout/util/Transformation.h>
 
+#include <algorithm>
 #include <limits>
 
 namespace osmscout {
@@ -201,6 +202,33 @@ namespace osmscout {
     return usedPoints++;
   }
 
+  size_t CoordBuffer::PushCoords(const CoordBuffer& other)
+  {
+    size_t offset=usedPoints;
+
+    if (usedPoints+other.usedPoints>bufferSize) {
+      while (usedPoints+other.usedPoints>bufferSize) {
+        bufferSize=bufferSize*2;
+      }
+
+      auto* newBuffer=new Vertex2D[bufferSize];
+
+      std::copy(buffer,buffer+usedPoints,newBuffer);
+
+      log.Warn() << "*** Buffer reallocation: " << bufferSize;
+
+      delete [] buffer;
+
+      buffer=newBuffer;
+    }
+
+    std::copy(other.buffer,other.buffer+other.usedPoints,buffer+usedPoints);
+
+    usedPoints+=other.usedPoints;
+
+    return offset;
+  }
+
   bool CoordBuffer::GenerateParallelWay(size_t orgStart,
                                         size_t orgEnd,
                                         double offset,